@@ -7,8 +7,8 @@ void leftEncoderAChange();
 void leftEncoderBChange();
 
 //Global Variables
-int rightEncoderCounter;
-int leftEncoderCounter;
+volatile int rightEncoderCounter;
+volatile int leftEncoderCounter;
 byte _rightEncoderAPin;
 byte _rightEncoderBPin;
 byte _leftEncoderAPin;
@@ -37,36 +37,76 @@ Odometry::Odometry(byte rightEncoderAPin, byte rightEncoderBPin, byte leftEncode
     _wheelDiameter = wheelDiameter;
     _cpr = cpr;
     
-    theta = 0;
-    clock = millis();
+    x = y = theta = 0;
+    vx = vy = vtheta = 0;
+    positionX = 0;
+    positionY = 0;
+    _rightTotal = 0;
+    _leftTotal = 0;
+    _remainderX = 0;
+    _remainderY = 0;
+    clock = micros();
 }
 
 void Odometry::update() {
+    //Take the counts and start counting again in one go, so no count is lost or counted twice
+    noInterrupts();
+    int rightCount = rightEncoderCounter;
+    int leftCount = leftEncoderCounter;
+    rightEncoderCounter = 0;
+    leftEncoderCounter = 0;
+    interrupts();
+    
+    unsigned long now = micros();
+    float dt = (now - clock) / 1000000.0;
+    clock = now;
+    
     //Calculate linear distance that each wheel has traveled
-    float rightWheelDistance = ((float)rightEncoderCounter / _cpr) * _wheelDiameter * PI;
-    float leftWheelDistance = ((float)leftEncoderCounter / _cpr) * _wheelDiameter * PI;
+    float rightWheelDistance = ((float)rightCount / _cpr) * _wheelDiameter * PI;
+    float leftWheelDistance = ((float)leftCount / _cpr) * _wheelDiameter * PI;
     
     //Calculate relative angle that robot has turned
     float dtheta = (rightWheelDistance - leftWheelDistance) / _wheelBase;
-    //Calculate angular velocity
-    vtheta = dtheta / (millis() - clock) * 1000;
-    //Accumulate angles to calculate absolute heading
-    theta += dtheta;
+    
+    //The heading comes from the whole counts since startup, so it does not
+    //pick up the rounding of every update
+    float previousTheta = theta;
+    _rightTotal += rightCount;
+    _leftTotal += leftCount;
+    theta = ((float)(_rightTotal - _leftTotal) / _cpr) * _wheelDiameter * PI / _wheelBase;
     
     //Decompose linear distance into its component values
     float meanWheelDistance = (rightWheelDistance + leftWheelDistance) / 2;
     x = meanWheelDistance * cos(dtheta);
     y = meanWheelDistance * sin(dtheta);
-    //Calculate linear velocity
-    vx = x / (millis() - clock) * 1000;
-    vy = y / (millis() - clock) * 1000;
     
-    //Reset counters
-    rightEncoderCounter = 0;
-    leftEncoderCounter = 0;
+    //Accumulate the position along the mean heading of the step, in whole
+    //um with the rest carried over to the next update
+    float midTheta = previousTheta + dtheta / 2;
+    float stepX = meanWheelDistance * cos(midTheta) * 10000 + _remainderX;
+    float stepY = meanWheelDistance * sin(midTheta) * 10000 + _remainderY;
+    long wholeX = lround(stepX);
+    long wholeY = lround(stepY);
+    _remainderX = stepX - wholeX;
+    _remainderY = stepY - wholeY;
+    positionX += wholeX;
+    positionY += wholeY;
+    
+    //Calculate velocities, two updates within the resolution of micros() leave them as they were
+    if (dt > 0) {
+        vx = x / dt;
+        vy = y / dt;
+        vtheta = dtheta / dt;
+    }
+}
+
+bool Odometry::moved() {
+    //The counters are two bytes wide, keep the encoder interrupts from changing them halfway through the read
+    noInterrupts();
+    bool counted = rightEncoderCounter != 0 || leftEncoderCounter != 0;
+    interrupts();
     
-    //Reset clock
-    clock = millis();
+    return counted;
 }
 
 void rightEncoderAChange() {
@@ -10,16 +10,20 @@ public:
     
     //Functions
     void update();
+    bool moved(); //whether the encoders counted since the last update
     
     //Variables
-    float x, y, theta;
-    float vx, vy, vtheta;
-    long clock;
+    float x, y, theta; //cm, cm since the last update in the rover frame, rad since startup
+    float vx, vy, vtheta; //cm/s, cm/s, rad/s
+    long positionX, positionY; //um since startup in the frame the rover started in
+    unsigned long clock; //micros() of the last update
 
 private:
     //Variables
     float _wheelBase, _wheelDiameter;
     int _cpr;
+    long _rightTotal, _leftTotal; //encoder counts since startup
+    float _remainderX, _remainderY; //parts of a um not yet added to the position
 };
 
 #endif
\ No newline at end of file
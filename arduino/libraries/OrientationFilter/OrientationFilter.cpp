@@ -0,0 +1,115 @@
+#include <OrientationFilter.h>
+
+//Accelerations further than this from 1 g are not used for the tilt (in m/s^2)
+const float accelerationTolerance = 1.0;
+//Once seeded the bias is only learned while every axis turns slower than this
+//(in rad/s)
+const float stillRate = 0.05;
+//How long the rover has to stand still for the first bias (in s)
+const float seedWindow = 1.0;
+
+static float wrapAngle(float angle) {
+    //Into (-PI, PI]
+    while (angle > PI) angle -= 2 * PI;
+    while (angle <= -PI) angle += 2 * PI;
+    return angle;
+}
+
+OrientationFilter::OrientationFilter(float tiltTimeConstant, float headingTimeConstant, float biasTimeConstant) {
+    _tiltTimeConstant = tiltTimeConstant;
+    _headingTimeConstant = headingTimeConstant;
+    _biasTimeConstant = biasTimeConstant;
+    
+    reset();
+}
+
+void OrientationFilter::reset() {
+    roll = pitch = yaw = 0;
+    for (byte i = 0; i < 3; i++) {
+        rate[i] = 0;
+        bias[i] = 0;
+        _seedSum[i] = 0;
+    }
+    _seedTime = 0;
+    _biasSeeded = false;
+    _initialized = false;
+}
+
+//Tilt compensated magnetic heading, from the accelerometer angles before
+//the filter and now from the fused ones
+float OrientationFilter::heading(const float magnetic[3]) {
+    return atan2(-magnetic[1]*cos(roll) + magnetic[2]*sin(roll), magnetic[0]*cos(pitch) + magnetic[1]*sin(pitch)*sin(roll) + magnetic[2]*sin(pitch)*cos(roll)) + PI;
+}
+
+void OrientationFilter::update(const float acceleration[3], const float angularVelocity[3], const float magnetic[3], bool still, float dt) {
+    float accelerationRoll = atan2(acceleration[1], sqrt(pow(acceleration[0],2) + pow(acceleration[2],2)));
+    float accelerationPitch = -atan2(acceleration[0], sqrt(pow(acceleration[1],2) + pow(acceleration[2],2)));
+    
+    //Start from the direct measurements
+    if (!_initialized) {
+        roll = accelerationRoll;
+        pitch = accelerationPitch;
+        yaw = heading(magnetic);
+        for (byte i = 0; i < 3; i++) {
+            rate[i] = angularVelocity[i];
+        }
+        _initialized = true;
+        return;
+    }
+    
+    bool turning = false;
+    for (byte i = 0; i < 3; i++) {
+        rate[i] = angularVelocity[i] - bias[i];
+        turning = turning || fabs(rate[i]) > stillRate;
+    }
+    
+    //The rate gate below only works once the bias is close, so the first
+    //bias is the average of a window the odometry reports no motion in,
+    //started over whenever the rover moves
+    if (!_biasSeeded) {
+        if (!still) {
+            _seedTime = 0;
+            for (byte i = 0; i < 3; i++) {
+                _seedSum[i] = 0;
+            }
+        }
+        else {
+            _seedTime += dt;
+            for (byte i = 0; i < 3; i++) {
+                _seedSum[i] += angularVelocity[i] * dt;
+            }
+            if (_seedTime >= seedWindow) {
+                for (byte i = 0; i < 3; i++) {
+                    bias[i] = _seedSum[i] / _seedTime;
+                }
+                _biasSeeded = true;
+            }
+        }
+    }
+    else if (still && !turning) {
+        float biasGain = dt / (_biasTimeConstant + dt);
+        for (byte i = 0; i < 3; i++) {
+            bias[i] += biasGain * (angularVelocity[i] - bias[i]);
+        }
+    }
+    
+    //The rover stays close to level, so the rates are integrated as the
+    //rates of the angles themselves
+    roll += rate[0] * dt;
+    pitch += rate[1] * dt;
+    yaw += rate[2] * dt;
+    
+    //While accelerating or bumping along the accelerometer does not point down
+    float magnitude = sqrt(pow(acceleration[0],2) + pow(acceleration[1],2) + pow(acceleration[2],2));
+    if (fabs(magnitude - 9.81) < accelerationTolerance) {
+        float tiltGain = dt / (_tiltTimeConstant + dt);
+        roll += tiltGain * (accelerationRoll - roll);
+        pitch += tiltGain * (accelerationPitch - pitch);
+    }
+    
+    float headingGain = dt / (_headingTimeConstant + dt);
+    yaw += headingGain * wrapAngle(heading(magnetic) - yaw);
+    
+    yaw = wrapAngle(yaw - PI) + PI;
+    if (yaw >= 2 * PI) yaw -= 2 * PI;
+}
@@ -0,0 +1,45 @@
+#ifndef OrientationFilter_h
+#define OrientationFilter_h
+
+#include "Arduino.h"
+
+//Complementary filter fusing the gyroscope with the accelerometer and
+//magnetometer. The gyroscope is integrated for a smooth, fast orientation
+//and pulled towards the tilt measured by the accelerometer and the heading
+//measured by the magnetometer over tiltTimeConstant and headingTimeConstant
+//seconds, which takes out the drift without the noise of the direct
+//measurements. The gyroscope bias is learned while the rover stands still,
+//starting from the average over the first second it stands still, since an
+//offset of up to several degrees per second is normal for an uncalibrated
+//gyroscope.
+//
+//Vectors are in the rover frame used by swarmie_control: accelerations in
+//m/s^2 and angular velocities in rad/s. The magnetometer vector is hard
+//iron corrected and normalized in the chip's own axes.
+class OrientationFilter {
+public:
+    //Constructors
+    OrientationFilter(float tiltTimeConstant, float headingTimeConstant, float biasTimeConstant);
+    
+    //Functions
+    void update(const float acceleration[3], const float angularVelocity[3], const float magnetic[3], bool still, float dt);
+    void reset();
+    
+    //Variables
+    float roll, pitch, yaw; //radians, yaw in [0, 2 PI)
+    float rate[3]; //bias corrected angular velocity in rad/s
+    float bias[3]; //gyroscope bias in rad/s
+
+private:
+    //Functions
+    float heading(const float magnetic[3]);
+    
+    //Variables
+    float _tiltTimeConstant, _headingTimeConstant, _biasTimeConstant;
+    bool _initialized;
+    bool _biasSeeded;
+    float _seedSum[3]; //angular velocity integrated over the seed window (in rad)
+    float _seedTime; //length of the seed window so far (in s)
+};
+
+#endif
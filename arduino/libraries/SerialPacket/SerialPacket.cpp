@@ -0,0 +1,34 @@
+#include <SerialPacket.h>
+
+/**
+ *	Constructor arg is the stream frames are written to
+ **/
+SerialPacket::SerialPacket(Stream &port) : _port(port) {
+}
+
+/**
+ *	Frames payload and writes it to the port, args are packet type, payload and payload length
+ **/
+void SerialPacket::send(uint8_t type, const void *payload, uint8_t length) {
+    uint8_t header[4] = {PACKET_SYNC0, PACKET_SYNC1, type, length};
+    uint16_t checksum = crc(header + 2, 2, 0xFFFF);
+    checksum = crc((const uint8_t *)payload, length, checksum);
+
+    _port.write(header, sizeof(header));
+    _port.write((const uint8_t *)payload, length);
+    _port.write((uint8_t)(checksum & 0xFF));
+    _port.write((uint8_t)(checksum >> 8));
+}
+
+/**
+ *	CRC-16/CCITT over length bytes of data, continuing from crc
+ **/
+uint16_t SerialPacket::crc(const uint8_t *data, uint8_t length, uint16_t crc) {
+    for (uint8_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (uint8_t bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
@@ -0,0 +1,76 @@
+#ifndef SerialPacket_h
+#define SerialPacket_h
+
+#include "Arduino.h"
+
+//Binary telemetry framing used between swarmie_control and abridge.
+//The packet layouts must match src/abridge/include/serialPacket.h.
+//
+//Frame layout:
+//  SYNC0 SYNC1 TYPE LENGTH PAYLOAD[LENGTH] CRC_LO CRC_HI
+//
+//The CRC is CRC-16/CCITT (poly 0x1021, init 0xFFFF) over TYPE, LENGTH and PAYLOAD.
+
+#define PACKET_SYNC0 0xA5
+#define PACKET_SYNC1 0x5A
+#define PACKET_MAX_PAYLOAD 64
+#define PACKET_PROTOCOL_VERSION 3
+#define PACKET_STREAM_VERSION 2 //first version that pushes telemetry after the "p" command
+
+#define PACKET_HELLO 0x01
+#define PACKET_GRIPPER 0x10
+#define PACKET_IMU 0x11
+#define PACKET_ODOM 0x12
+#define PACKET_SONAR 0x13
+#define PACKET_ODOM_POSE 0x14 //replaces PACKET_ODOM from version 3
+
+struct HelloPacket {
+    uint8_t version;
+} __attribute__((packed));
+
+struct GripperPacket {
+    uint8_t fingerAttached;
+    uint8_t wristAttached;
+    float fingerAngle;
+    float wristAngle;
+} __attribute__((packed));
+
+struct ImuPacket {
+    uint8_t status;
+    float linearAcceleration[3];
+    float angularVelocity[3];
+    float orientation[3];
+} __attribute__((packed));
+
+struct OdomPacket {
+    float x, y, theta;
+    float vx, vy, vtheta;
+} __attribute__((packed));
+
+struct OdomPosePacket {
+    uint16_t sequence;
+    int32_t x, y;
+    float theta;
+    float vx, vy, vtheta;
+} __attribute__((packed));
+
+struct SonarPacket {
+    uint16_t left;
+    uint16_t center;
+    uint16_t right;
+} __attribute__((packed));
+
+class SerialPacket {
+public:
+    //Constructors
+    SerialPacket(Stream &port);
+
+    //Functions
+    void send(uint8_t type, const void *payload, uint8_t length);
+    static uint16_t crc(const uint8_t *data, uint8_t length, uint16_t crc);
+
+private:
+    Stream &_port;
+};
+
+#endif
@@ -12,6 +12,8 @@
 #include <Movement.h>
 #include <NewPing.h>
 #include <Odometry.h>
+#include <OrientationFilter.h>
+#include <SerialPacket.h>
 #include <Servo.h>
 
 // Constants
@@ -51,14 +53,31 @@ float wheelDiameter = 12.2; //diameter of wheel (in cm)
 int cpr = 8400; //"cycles per revolution" -- number of encoder increments per one wheel revolution
 
 //Serial (USB <--> Intel NUC)
-String rxBuffer;
+char rxBuffer[16]; //the command being received, NUL terminated once complete
+byte rxLength = 0;
 unsigned long watchdogTimer = 1000; //fail-safe in case of communication link failure (in ms)
 unsigned long lastCommTime = 0; //time of last communication from NUC (in ms)
+bool binaryMode = false; //send telemetry as binary frames instead of text, enabled by the "b" command
+bool streamMode = false; //push binary telemetry without waiting for "d", enabled by the "p" command
 
 //Ultrasound (Ping))))
 byte leftSignal = 4;
 byte centerSignal = 5;
 byte rightSignal = 6;
+unsigned long sonarInterval = 33; //time between pings, long enough for the echoes of the last one to die out (in ms)
+
+//Streaming (see streamTelemetry())
+unsigned long imuInterval = 20; //time between IMU frames, the output rate of the accelerometer (in ms)
+unsigned long odomInterval = 10; //shortest time between odometry frames while the wheels turn (in ms)
+unsigned long odomIdleInterval = 100; //longest time between odometry frames while standing still (in ms)
+unsigned long gripperInterval = 100; //time between gripper frames (in ms)
+
+//IMU (see updateIMU())
+unsigned long imuRetryInterval = 1000; //time between checks for an IMU that stopped answering (in ms)
+unsigned long filterInterval = 10; //time between IMU reads, each one steps the orientation filter (in ms)
+float tiltTimeConstant = 1.0; //how slowly roll and pitch follow the accelerometer (in s)
+float headingTimeConstant = 2.0; //how slowly yaw follows the magnetometer (in s)
+float biasTimeConstant = 5.0; //how slowly the gyroscope bias follows the gyroscope while still (in s)
 
 
 ////////////////////////////
@@ -75,6 +94,41 @@ Servo wrist;
 NewPing leftUS(leftSignal, leftSignal, 330);
 NewPing centerUS(centerSignal, centerSignal, 330);
 NewPing rightUS(rightSignal, rightSignal, 330);
+SerialPacket packet = SerialPacket(Serial);
+OrientationFilter orientation = OrientationFilter(tiltTimeConstant, headingTimeConstant, biasTimeConstant);
+
+
+//////////////////
+////Sonar State///
+//////////////////
+
+//The sonars ping one at a time in the background, see updateSonar()
+const byte sonarCount = 3;
+NewPing* sonars[sonarCount] = {&leftUS, &centerUS, &rightUS};
+unsigned int sonarRange[sonarCount] = {0}; //latest completed range of each sonar (in cm), 0 for no echo
+volatile unsigned int sonarEcho[sonarCount] = {0}; //range of the ping in flight, written by the timer interrupt
+volatile byte currentSonar = sonarCount - 1;
+unsigned long lastSonarPing = 0;
+
+
+//////////////////////
+////Streaming State///
+//////////////////////
+
+unsigned long lastImuSend = 0;
+unsigned long lastOdomSend = 0;
+unsigned long lastGripperSend = 0;
+uint16_t odomSequence = 0; //number of odometry frames sent, so lost ones can be counted
+
+
+////////////////
+////IMU State///
+////////////////
+
+bool imuReady = false; //whether the IMU is configured and answered the last read
+unsigned long lastImuCheck = 0;
+unsigned long lastImuRead = 0; //in us
+float imuSample[9] = {0}; //latest linear acceleration, bias corrected angular velocity and fused orientation
 
 
 /////////////
@@ -87,17 +141,17 @@ void setup()
   while (!Serial) {} //wait for Serial to complete initialization before moving on
 
   Wire.begin();
+  Wire.setClock(400000); //the L3G and LSM303 support fast mode, which keeps the reads short
 
   if (imuStatus()) {
     imuInit();
+    imuReady = true;
   }
 
   fingers.attach(fingersPin,fingerMin,fingerMax);
   fingers.writeMicroseconds(fingerMin);
   wrist.attach(wristPin,wristMin,wristMax);
   wrist.writeMicroseconds(wristMin);
-
-  rxBuffer = "";
 }
 
 
@@ -106,19 +160,28 @@ void setup()
 /////////////////
 
 void loop() {
+  bool sonarUpdated = updateSonar();
+  updateIMU();
+  if (streamMode) {
+    streamTelemetry(sonarUpdated);
+  }
+
   if (Serial.available()) {
     char c = Serial.read();
     if (c == ',' || c == '\n') {
+      rxBuffer[rxLength] = '\0';
       parse();
-      rxBuffer = "";
+      rxLength = 0;
       lastCommTime = millis();
     }
-    else if (c > 0) {
-      rxBuffer += c;
+    else if (c > 0 && rxLength < sizeof(rxBuffer) - 1) {
+      //Longer commands are cut short, which no command matches
+      rxBuffer[rxLength++] = c;
     }
   }
   if (millis() - lastCommTime > watchdogTimer) {
     move.stop();
+    streamMode = false; //nobody is listening, the next "p" starts the stream again
   }
 }
 
@@ -128,7 +191,7 @@ void loop() {
 ////////////////////////
 
 void parse() {
-  if (rxBuffer == "v") {
+  if (command("v")) {
     int speedL = Serial.parseInt();
     int speedR = Serial.parseInt();
     
@@ -145,78 +208,60 @@ void parse() {
       move.rotateRight(speedL, speedR*-1);
     }
   }
-  else if (rxBuffer == "s") {
+  else if (command("s")) {
     move.stop();
   }
-  else if (rxBuffer == "d") {
-    Serial.print("GRF,");
-    Serial.print(String(fingers.attached()) + ",");
-    if (fingers.attached()) {
-      Serial.println(String(DEG2RAD(fingers.read())));
-    }
-    else {
-      Serial.println();
-    }
-
-    Serial.print("GRW,");
-    Serial.print(String(wrist.attached()) + ",");
-    if (wrist.attached()) {
-      Serial.println(String(DEG2RAD(wrist.read())));
-    }
-    else {
-      Serial.println();
+  else if (command("b")) {
+    binaryMode = true;
+    HelloPacket hello = {PACKET_PROTOCOL_VERSION};
+    packet.send(PACKET_HELLO, &hello, sizeof(hello));
+  }
+  else if (command("p")) {
+    //Sent again as a keepalive while streaming, only the first one is answered
+    binaryMode = true;
+    if (!streamMode) {
+      streamMode = true;
+      HelloPacket hello = {PACKET_PROTOCOL_VERSION};
+      packet.send(PACKET_HELLO, &hello, sizeof(hello));
     }
+  }
+  else if (command("d") && binaryMode) {
+    sendBinaryTelemetry();
+  }
+  else if (command("d")) {
+    printGripper("GRF", fingers);
+    printGripper("GRW", wrist);
 
     Serial.print("IMU,");
-    bool imuStatusFlag = imuStatus();
-    Serial.print(String(imuStatusFlag) + ",");
+    float imuData[9];
+    bool imuStatusFlag = sampleIMU(imuData);
+    Serial.print(imuStatusFlag);
+    Serial.print(",");
     if (imuStatusFlag) {
-      imuInit();
-      Serial.println(updateIMU());
+      printValues(imuData, 9);
+      Serial.println();
     }
     else {
       Serial.println(",,,,,,,,");
     }
 
-    Serial.println("ODOM," + String(1) + "," + updateOdom());
-
-    Serial.print("USL,");
-    int leftUSValue = leftUS.ping_cm();
-    Serial.print(String(leftUSValue > 0 ? 1 : 0) + ",");
-    if (leftUSValue > 0) {
-      Serial.println(String(leftUSValue));
-    }
-    else {
-      Serial.println();
-    }
-
-    Serial.print("USC,");
-    int centerUSValue = centerUS.ping_cm();
-    Serial.print(String(centerUSValue > 0 ? 1 : 0) + ",");
-    if (centerUSValue > 0) {
-      Serial.println(String(centerUSValue));
-    }
-    else {
-      Serial.println();
-    }
+    odom.update();
+    float odomData[6] = {odom.x, odom.y, odom.theta, odom.vx, odom.vy, odom.vtheta};
+    Serial.print("ODOM,1,");
+    printValues(odomData, 6);
+    Serial.println();
 
-    Serial.print("USR,");
-    int rightUSValue = rightUS.ping_cm();
-    Serial.print(String(rightUSValue > 0 ? 1 : 0) + ",");
-    if (rightUSValue > 0) {
-      Serial.println(String(rightUSValue));
-    }
-    else {
-      Serial.println();
-    }
+    printSonar("USL", sonarRange[0]);
+    printSonar("USC", sonarRange[1]);
+    printSonar("USR", sonarRange[2]);
   }
-  else if (rxBuffer == "f") {
+  else if (command("f")) {
     float radianAngle = Serial.parseFloat();
     int angle = RAD2DEG(radianAngle); // Convert float radians to int degrees
     angle = fingerMin + (fingerMax/370) * angle;
     fingers.writeMicroseconds(angle);
   }
-  else if (rxBuffer == "w") {
+  else if (command("w")) {
     float radianAngle = Serial.parseFloat();
     int angle = RAD2DEG(radianAngle); // Convert float radians to int degrees
     angle = wristMin + (wristMax/370) * angle;
@@ -224,12 +269,108 @@ void parse() {
   }
 }
 
+bool command(const char* name) {
+  return strcmp(rxBuffer, name) == 0;
+}
+
 
 //////////////////////////
 //Update transmit buffer//
 //////////////////////////
 
-String updateIMU() {
+//The text lines are printed a field at a time, which formats the numbers
+//into a buffer on the stack, rather than concatenated as Strings: the loop
+//never touches the heap, so it can neither fragment nor run out of it.
+
+//Prints values comma separated, with two decimals
+void printValues(const float* values, byte count) {
+  for (byte i = 0; i < count; i++) {
+    if (i > 0) {
+      Serial.print(",");
+    }
+    Serial.print(values[i]);
+  }
+}
+
+//Prints e.g. "GRF,1,0.52", or "GRF,0," if the servo is detached
+void printGripper(const char* name, Servo& servo) {
+  Serial.print(name);
+  Serial.print(",");
+  Serial.print(servo.attached());
+  Serial.print(",");
+  if (servo.attached()) {
+    Serial.print(DEG2RAD(servo.read()));
+  }
+  Serial.println();
+}
+
+//Prints e.g. "USL,1,42", or "USL,0," if there was no echo
+void printSonar(const char* name, unsigned int range) {
+  Serial.print(name);
+  Serial.print(",");
+  Serial.print(range > 0 ? 1 : 0);
+  Serial.print(",");
+  if (range > 0) {
+    Serial.print(range);
+  }
+  Serial.println();
+}
+
+//Reads the IMU every filterInterval and steps the orientation filter with
+//it, so the orientation is fused at a steady rate whatever the host asks
+//for. The I2C transfers need interrupts, so this runs from the loop rather
+//than a timer interrupt. The chips are set up once and keep their
+//configuration, so they are only searched for and set up again, at most
+//every imuRetryInterval, after a read fails. Scanning the I2C bus and
+//rewriting the configuration for every sample would hold the loop up for
+//longer than the read itself.
+void updateIMU() {
+  unsigned long now = micros();
+  if (now - lastImuRead < filterInterval * 1000) {
+    return;
+  }
+  float dt = (now - lastImuRead) / 1000000.0;
+  lastImuRead = now;
+
+  if (!imuReady && millis() - lastImuCheck >= imuRetryInterval) {
+    lastImuCheck = millis();
+    if (imuStatus()) {
+      imuInit();
+      imuReady = true;
+      orientation.reset();
+    }
+  }
+
+  float acceleration[3];
+  float angularVelocity[3];
+  float magnetic[3];
+  imuReady = imuReady && readIMU(acceleration, angularVelocity, magnetic);
+  if (!imuReady) {
+    return;
+  }
+
+  //The bias is learned while the wheels are not turning
+  orientation.update(acceleration, angularVelocity, magnetic, !odom.moved(), dt);
+
+  memcpy(imuSample, acceleration, sizeof(acceleration));
+  memcpy(imuSample + 3, orientation.rate, sizeof(orientation.rate));
+  imuSample[6] = orientation.roll;
+  imuSample[7] = orientation.pitch;
+  imuSample[8] = orientation.yaw;
+}
+
+//Fills imuData with the latest linear acceleration, bias corrected angular
+//velocity and fused orientation (roll, pitch, yaw)
+//Returns false if there is no IMU or it did not answer
+bool sampleIMU(float imuData[9]) {
+  memcpy(imuData, imuSample, sizeof(imuSample));
+  return imuReady;
+}
+
+//Reads linear acceleration, angular velocity and the hard iron corrected,
+//normalized magnetic field
+//Returns false if the sensors timed out
+bool readIMU(float acceleration[3], float angularVelocity[3], float magnetic[3]) {
   //Update current sensor values
   gyroscope.read();
   magnetometer_accelerometer.read();
@@ -241,51 +382,131 @@ String updateIMU() {
     LSM303::vector<int16_t> mag = magnetometer_accelerometer.m;
 
     //Convert accelerometer digits to milligravities, then to gravities, and finally to meters per second squared
-    LSM303::vector<float> linear_acceleration = {acc.y*0.061/1000*9.81, -acc.x*0.061/1000*9.81, acc.z*0.061/1000*9.81};
+    acceleration[0] = acc.y*0.061/1000*9.81;
+    acceleration[1] = -acc.x*0.061/1000*9.81;
+    acceleration[2] = acc.z*0.061/1000*9.81;
 
     //Convert gyroscope digits to millidegrees per second, then to degrees per second, and finally to radians per second
-    L3G::vector<float> angular_velocity = {gyro.y*8.75/1000*(PI/180), -gyro.x*8.75/1000*(PI/180), gyro.z*8.75/1000*(PI/180)};
-
-    //Combine normalized magnetometer and accelerometer digits to produce Euler angles, i.e. pitch, roll, and yaw
-    LSM303::vector<float> orientation = {(float)mag.x, (float)mag.y, (float)mag.z};
-    orientation.x -= (magnetometer_accelerometer.m_min.x + magnetometer_accelerometer.m_max.x) / 2;
-    orientation.y -= (magnetometer_accelerometer.m_min.y + magnetometer_accelerometer.m_max.y) / 2;
-    orientation.z -= (magnetometer_accelerometer.m_min.z + magnetometer_accelerometer.m_max.z) / 2;
-    LSM303::vector_normalize(&orientation);
-    float roll = atan2(linear_acceleration.y, sqrt(pow(linear_acceleration.x,2) + pow(linear_acceleration.z,2)));
-    float pitch = -atan2(linear_acceleration.x, sqrt(pow(linear_acceleration.y,2) + pow(linear_acceleration.z,2)));
-    float yaw = atan2(-orientation.y*cos(roll) + orientation.z*sin(roll), orientation.x*cos(pitch) + orientation.y*sin(pitch)*sin(roll) + orientation.z*sin(pitch)*cos(roll)) + PI;
-    orientation = {roll, pitch, yaw};
-
-    //Append data to buffer
-    String txBuffer = String(linear_acceleration.x) + "," +
-               String(linear_acceleration.y) + "," +
-               String(linear_acceleration.z) + "," +
-               String(angular_velocity.x) + "," +
-               String(angular_velocity.y) + "," +
-               String(angular_velocity.z) + "," +
-               String(orientation.x) + "," +
-               String(orientation.y) + "," +
-               String(orientation.z);
-
-    return txBuffer;
+    angularVelocity[0] = gyro.y*8.75/1000*(PI/180);
+    angularVelocity[1] = -gyro.x*8.75/1000*(PI/180);
+    angularVelocity[2] = gyro.z*8.75/1000*(PI/180);
+
+    //Remove the hard iron offset and normalize, the filter works out the heading from it
+    LSM303::vector<float> field = {(float)mag.x, (float)mag.y, (float)mag.z};
+    field.x -= (magnetometer_accelerometer.m_min.x + magnetometer_accelerometer.m_max.x) / 2;
+    field.y -= (magnetometer_accelerometer.m_min.y + magnetometer_accelerometer.m_max.y) / 2;
+    field.z -= (magnetometer_accelerometer.m_min.z + magnetometer_accelerometer.m_max.z) / 2;
+    LSM303::vector_normalize(&field);
+    magnetic[0] = field.x;
+    magnetic[1] = field.y;
+    magnetic[2] = field.z;
+
+    return true;
+  }
+
+  return false;
+}
+
+//Binary equivalent of the "d" text response, one frame per sensor group
+void sendBinaryTelemetry() {
+  sendGripper();
+  sendIMU();
+  sendOdom();
+  sendSonar();
+}
+
+void sendIMU() {
+  ImuPacket imu;
+  float imuData[9] = {0};
+  imu.status = sampleIMU(imuData);
+  memcpy(imu.linearAcceleration, imuData, sizeof(imu.linearAcceleration));
+  memcpy(imu.angularVelocity, imuData + 3, sizeof(imu.angularVelocity));
+  memcpy(imu.orientation, imuData + 6, sizeof(imu.orientation));
+  packet.send(PACKET_IMU, &imu, sizeof(imu));
+}
+
+//Pushes each sensor group as soon as it has something new instead of
+//waiting for "d": the IMU at the accelerometer's rate, the sonars after
+//every ping, odometry while the wheels turn and the gripper now and then.
+void streamTelemetry(bool sonarUpdated) {
+  unsigned long now = millis();
+
+  if (now - lastImuSend >= imuInterval) {
+    lastImuSend = now;
+    sendIMU();
   }
 
-  return "";
+  if (sonarUpdated) {
+    sendSonar();
+  }
+
+  //Still frames keep the velocity at 0 and the stamps fresh
+  if ((now - lastOdomSend >= odomInterval && odom.moved()) || now - lastOdomSend >= odomIdleInterval) {
+    lastOdomSend = now;
+    sendOdom();
+  }
+
+  if (now - lastGripperSend >= gripperInterval) {
+    lastGripperSend = now;
+    sendGripper();
+  }
+}
+
+void sendGripper() {
+  GripperPacket gripper;
+  gripper.fingerAttached = fingers.attached();
+  gripper.wristAttached = wrist.attached();
+  gripper.fingerAngle = gripper.fingerAttached ? DEG2RAD(fingers.read()) : 0;
+  gripper.wristAngle = gripper.wristAttached ? DEG2RAD(wrist.read()) : 0;
+  packet.send(PACKET_GRIPPER, &gripper, sizeof(gripper));
 }
 
-String updateOdom() {
-  String txBuffer;
+void sendOdom() {
   odom.update();
+  OdomPosePacket odomData = {odomSequence++, odom.positionX, odom.positionY, odom.theta, odom.vx, odom.vy, odom.vtheta};
+  packet.send(PACKET_ODOM_POSE, &odomData, sizeof(odomData));
+}
 
-  txBuffer = String(odom.x) + "," +
-             String(odom.y) + "," +
-             String(odom.theta) + "," +
-             String(odom.vx) + "," +
-             String(odom.vy) + "," +
-             String(odom.vtheta);
+void sendSonar() {
+  SonarPacket sonar;
+  sonar.left = sonarRange[0];
+  sonar.center = sonarRange[1];
+  sonar.right = sonarRange[2];
+  packet.send(PACKET_SONAR, &sonar, sizeof(sonar));
+}
 
-  return txBuffer;
+
+//////////////////////////
+////Sonar Functions///////
+//////////////////////////
+
+//Pings the sonars round robin, one every sonarInterval, without waiting for
+//the echo: NewPing's timer interrupt watches for it. A sonar's range is
+//taken over when its slot ends, so requests always get a complete reading
+//at once instead of blocking the loop for up to three echoes.
+//Returns true when a sonar's range was taken over.
+bool updateSonar() {
+  if (millis() - lastSonarPing < sonarInterval) {
+    return false;
+  }
+  lastSonarPing = millis();
+
+  //The interrupt is off once stopped, so the echo can be read safely
+  NewPing::timer_stop();
+  sonarRange[currentSonar] = sonarEcho[currentSonar];
+
+  currentSonar = (currentSonar + 1) % sonarCount;
+  sonarEcho[currentSonar] = NO_ECHO;
+  sonars[currentSonar]->ping_timer(sonarEchoCheck);
+
+  return true;
+}
+
+//Called by the timer interrupt every ECHO_TIMER_FREQ us while a ping is in flight
+void sonarEchoCheck() {
+  if (sonars[currentSonar]->check_timer()) {
+    sonarEcho[currentSonar] = sonars[currentSonar]->ping_result / US_ROUNDTRIP_CM;
+  }
 }
 
 
@@ -27,6 +27,10 @@ else
 fi
 
 
+#Sonar ranges and drive commands between abridge and behaviours through shared memory instead of loopback TCPROS, both need the same setting
+sharedMemoryTransport=${SHARED_MEMORY_TRANSPORT:-false}
+
+
 #Set prefix to fully qualify transforms for each robot
 echo "set prefix to fully qualify transforms for each robot: $HOSTNAME"
 rosparam set tf_prefix $HOSTNAME
@@ -63,7 +67,7 @@ echo $(realpath ..)/camera_info/head_camera.yaml
 # mage_raw:=/$HOSTNAME/camera/image _camera_info_url:=file://${HOME}/rover_workspace/camera_info/head_camera.yaml _image_width:=320 _image_height:=240 &
 
 echo "rosrun behaviours"
-nohup > logs/$HOSTNAME"_behaviours_log.txt" rosrun behaviours behaviours &
+nohup > logs/$HOSTNAME"_behaviours_log.txt" rosrun behaviours behaviours _shared_memory_transport:=$sharedMemoryTransport &
 echo "rosrun obstacle_detection"
 nohup rosrun obstacle_detection obstacle &
 echo "rosrun diagnostics"
@@ -79,7 +83,7 @@ if [ -z "$microcontrollerDevicePath" ]
 then
     echo "Error: Microcontroller device not found"
 else
-    nohup > logs/$HOSTNAME"_abridge_log.txt" rosrun abridge abridge _device:=/dev/$microcontrollerDevicePath &
+    nohup > logs/$HOSTNAME"_abridge_log.txt" rosrun abridge abridge _device:=/dev/$microcontrollerDevicePath _shared_memory_transport:=$sharedMemoryTransport &
 fi
 
 gpsDevicePath=$(findDevicePath u-blox)
@@ -0,0 +1,695 @@
+#!/usr/bin/env python
+"""Headless batch runner for Swarmathon simulation trials.
+
+Runs N simulated trials, several at a time, without the GUI. Every trial
+gets its own ROS master and Gazebo master port so trials running at the same
+time do not see each other. The arena, rovers and targets are written into a
+world file up front instead of being spawned one model at a time, using the
+same placement rules as the GUI "Build Simulation" button. Targets are
+placed from a per trial seed so a trial can be rebuilt exactly, and the
+rovers draw their random numbers from the same seed.
+
+Each trial records the /collectionZone/score time series. When all trials
+have finished the series are merged into one CSV file with the columns
+
+    trial,seed,distribution,targets,sim_time,score
+
+Source devel/setup.bash before running, e.g.
+
+    ./misc/run_trials.py --trials 16 --parallel 4 --distribution powerlaw \\
+        --arena prelim --duration 1200 --seed 1 --output powerlaw.csv
+
+Logs and the generated world of every trial are kept in
+logs/trials/trial_<n>/, with the swarm metrics of the trial in metrics.prom
+(see src/diagnostics/src/SwarmMetrics.h), labelled with --label, the trial
+and its seed.
+
+One Gazebo server cannot keep up with much more than 8 rovers, all their
+sensors and plugins share its physics thread. --shards splits the arena into
+that many sectors around the collection zone, each run by its own Gazebo
+server on its own core:
+
+    ./misc/run_trials.py --arena final --rovers 32 --shards 4 --duration 1200
+
+The rovers and targets of a sector are only in the world of its shard, and
+walls along the sector edges keep the rovers in their own sector. The walls
+stop short of the collection zone, which is in every shard, so the rovers
+of every sector can drop off there. Rovers of other shards are not there
+physically but still beacon, so they keep their distance in the zone. Each
+shard's ScorePlugin counts its own targets and shard 0 publishes the total
+on /collectionZone/score, and the ShardPlugin keeps the shards within a
+tenth of a simulated second of each other. Shard 0 owns /clock and the
+/gazebo services, shard n publishes them under /shards/shard_<n>/ and its
+rovers follow its clock. Rovers do not move between shards.
+"""
+
+from __future__ import print_function
+
+import argparse
+import csv
+import math
+import multiprocessing
+import os
+import random
+import shutil
+import signal
+import subprocess
+import sys
+import threading
+import time
+
+APP_ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+
+# Clearances (xy plane radius) and rover layout, as used by the GUI, see
+# rover_gui_plugin.cpp.
+TARGET_CLUSTER_SIZE_64_CLEARANCE = 0.8
+TARGET_CLUSTER_SIZE_16_CLEARANCE = 0.6
+TARGET_CLUSTER_SIZE_4_CLEARANCE = 0.2
+TARGET_CLUSTER_SIZE_1_CLEARANCE = 0.1
+ROVER_CLEARANCE = 0.45
+COLLECTION_DISK_CLEARANCE = 0.5
+BARRIER_CLEARANCE = 0.5
+
+ROVER_NAMES = ["achilles", "aeneas", "ajax", "diomedes", "hector", "paris", "thor", "zeus"]
+ROVER_TEMPLATE = "achilles"  # the model further rovers are copied from
+ROVER_POSES = [(-1.308, 0.000, 0.000), (0.000, -1.308, 1.571),
+               (1.308, 0.000, -3.142), (0.000, 1.308, -1.571),
+               (1.072, 1.072, -2.356), (-1.072, -1.072, 0.785),
+               (-1.072, 1.072, -0.785), (1.072, -1.072, 2.356)]
+
+# Larger swarms and sharded arenas start on rings around the collection zone
+ROVER_RING_RADIUS = 1.308
+ROVER_SPACING = 1.1
+
+# walls between the sectors of a sharded arena
+SECTOR_WALL_START = 1.0  # distance from the center, leaves the collection zone open
+SECTOR_WALL_THICKNESS = 0.1
+SECTOR_WALL_HEIGHT = 0.5
+
+ROVER_READY_TIMEOUT = 120  # seconds to wait for the first heartbeat of each rover
+
+GROUND_PLANES = {"gravel": "mars_ground_plane",
+                 "concrete": "concrete_ground_plane",
+                 "carpark": "carpark_ground_plane"}
+
+ARENAS = {"prelim": (15.0, "barrier_prelim_round", 3),
+          "final": (23.1, "barrier_final_round", 6)}
+
+# physics profiles known to the SetupWorld plugin, see src/gazebo_plugins/src/SetupWorld.cpp
+PHYSICS_PROFILES = ["default", "fidelity", "fast-eval", "stress"]
+
+
+class World(object):
+    """Models to place in a generated world, with the same occupancy test
+    as GazeboSimManager::isLocationOccupied()."""
+
+    def __init__(self, rng):
+        self.rng = rng
+        self.models = []     # (sdf model, unique name, x, y, z, roll, pitch, yaw)
+        self.locations = []  # (x, y, clearance)
+        self.walls = []      # (unique name, x0, y0, x1, y1)
+        self.rovers = []     # unique names
+        self.shard = None    # (index, count) of a sharded world
+
+    def add(self, model, name, x, y, clearance, yaw=0.0):
+        self.models.append((model, name, x, y, 0.0, 0.0, 0.0, yaw))
+        self.locations.append((x, y, clearance))
+
+    def add_rover(self, name, x, y, yaw):
+        self.add(name, name, x, y, ROVER_CLEARANCE, yaw)
+        self.rovers.append(name)
+
+    def add_wall(self, name, x0, y0, x1, y1):
+        self.walls.append((name, x0, y0, x1, y1))
+
+    def occupied(self, x, y, clearance):
+        for used_x, used_y, used_clearance in self.locations:
+            if math.hypot(x - used_x, y - used_y) < clearance + used_clearance:
+                return True
+        for name, x0, y0, x1, y1 in self.walls:
+            if segment_distance(x, y, x0, y0, x1, y1) < clearance + SECTOR_WALL_THICKNESS / 2:
+                return True
+        return False
+
+    def free_location(self, d, clearance):
+        # d - U(0, 2d) on both axes, retried until nothing overlaps
+        while True:
+            x = d - self.rng.random() * 2 * d
+            y = d - self.rng.random() * 2 * d
+            if not self.occupied(x, y, clearance):
+                return x, y
+
+    def add_cluster(self, x, y, length, width, first_index):
+        index = first_index
+        cluster_y = y - TARGET_CLUSTER_SIZE_1_CLEARANCE * length
+        for j in range(length):
+            cluster_x = x - TARGET_CLUSTER_SIZE_1_CLEARANCE * width
+            for k in range(width):
+                self.add("at0", "at%d" % index, cluster_x, cluster_y, TARGET_CLUSTER_SIZE_1_CLEARANCE)
+                cluster_x += TARGET_CLUSTER_SIZE_1_CLEARANCE
+                index += 1
+            cluster_y += TARGET_CLUSTER_SIZE_1_CLEARANCE
+        return index
+
+    def split(self, shards):
+        """Returns the world of each shard. Rovers and targets are in the
+        shard of their sector, everything else is in all of them."""
+        worlds = []
+        for index in range(shards):
+            world = World(self.rng)
+            world.walls = self.walls
+            world.shard = (index, shards)
+            for entry in self.models:
+                model, name, x, y = entry[:4]
+                owned = name.startswith("at") or name in self.rovers
+                if not owned or sector(x, y, shards) == index:
+                    world.models.append(entry)
+                    if name in self.rovers:
+                        world.rovers.append(name)
+            worlds.append(world)
+        return worlds
+
+    def to_sdf(self):
+        lines = ["<?xml version=\"1.0\" ?>",
+                 "<sdf version=\"1.4\">",
+                 "\t<world name=\"default\">",
+                 "\t\t<include>",
+                 "\t\t\t<uri>model://ground_plane</uri>",
+                 "\t\t</include>",
+                 "",
+                 "\t\t<include>",
+                 "\t\t\t<uri>model://sun</uri>",
+                 "\t\t</include>",
+                 ""]
+        for model, name, x, y, z, roll, pitch, yaw in self.models:
+            lines += ["\t\t<include>",
+                      "\t\t\t<uri>model://%s</uri>" % model,
+                      "\t\t\t<name>%s</name>" % name,
+                      "\t\t\t<pose>%.4f %.4f %.4f %.4f %.4f %.4f</pose>" % (x, y, z, roll, pitch, yaw),
+                      "\t\t</include>"]
+        for name, x0, y0, x1, y1 in self.walls:
+            length = math.hypot(x1 - x0, y1 - y0)
+            size = "%.4f %.4f %.4f" % (length, SECTOR_WALL_THICKNESS, SECTOR_WALL_HEIGHT)
+            lines += ["\t\t<model name=\"%s\">" % name,
+                      "\t\t\t<static>true</static>",
+                      "\t\t\t<pose>%.4f %.4f %.4f 0 0 %.4f</pose>" % ((x0 + x1) / 2, (y0 + y1) / 2,
+                                                                   SECTOR_WALL_HEIGHT / 2,
+                                                                   math.atan2(y1 - y0, x1 - x0)),
+                      "\t\t\t<link name=\"link\">",
+                      "\t\t\t\t<collision name=\"collision\">",
+                      "\t\t\t\t\t<geometry><box><size>%s</size></box></geometry>" % size,
+                      "\t\t\t\t</collision>",
+                      "\t\t\t\t<visual name=\"visual\">",
+                      "\t\t\t\t\t<geometry><box><size>%s</size></box></geometry>" % size,
+                      "\t\t\t\t</visual>",
+                      "\t\t\t</link>",
+                      "\t\t</model>"]
+        lines += ["",
+                  "\t\t<plugin name=\"SetupWorld\" filename=\"libgazebo_plugins.so\"/>"]
+        if self.shard is not None:
+            lines += ["\t\t<plugin name=\"ShardPlugin\" filename=\"libgazebo_plugins_shard.so\"/>"]
+        lines += ["\t</world>",
+                  "</sdf>",
+                  ""]
+        return "\n".join(lines)
+
+
+def segment_distance(x, y, x0, y0, x1, y1):
+    dx, dy = x1 - x0, y1 - y0
+    t = ((x - x0) * dx + (y - y0) * dy) / (dx * dx + dy * dy)
+    t = min(1.0, max(0.0, t))
+    return math.hypot(x - (x0 + t * dx), y - (y0 + t * dy))
+
+
+def sector(x, y, shards):
+    """The sector, counter clockwise from the positive x axis, of a point."""
+    width = 2 * math.pi / shards
+    return int((math.atan2(y, x) % (2 * math.pi)) / width) % shards
+
+
+def rover_name(i):
+    return ROVER_NAMES[i] if i < len(ROVER_NAMES) else "rover%d" % i
+
+
+def rover_poses(n_rovers, shards):
+    """Start poses facing the collection zone, the GUI's for up to 8 rovers in
+    one shard. Otherwise the rovers are shared out between the sectors and
+    placed on rings inside their sector, far enough from its walls."""
+    if shards == 1 and n_rovers <= len(ROVER_POSES):
+        return ROVER_POSES[:n_rovers]
+
+    width = 2 * math.pi / shards
+    poses = []
+    for index in range(shards):
+        count = len(range(index, n_rovers, shards))
+        radius = ROVER_RING_RADIUS
+        while count > 0:
+            on_ring = min(int(radius * width / ROVER_SPACING), count)
+            for i in range(on_ring):
+                angle = index * width + width * (i + 0.5) / on_ring
+                poses.append((radius * math.cos(angle), radius * math.sin(angle),
+                              math.atan2(-math.sin(angle), -math.cos(angle))))
+            count -= on_ring
+            radius += ROVER_SPACING
+    return poses
+
+
+def add_sector_walls(world, arena_dim, shards):
+    # from the edge of the collection zone out to the arena boundary
+    width = 2 * math.pi / shards
+    for index in range(shards):
+        angle = index * width
+        c, s = math.cos(angle), math.sin(angle)
+        end = arena_dim / 2.0 / max(abs(c), abs(s))
+        world.add_wall("Sector_Wall_%d" % index, SECTOR_WALL_START * c, SECTOR_WALL_START * s, end * c, end * s)
+
+
+def add_single_targets(world, arena_dim, first_index, count):
+    d = arena_dim / 2.0 - (BARRIER_CLEARANCE + TARGET_CLUSTER_SIZE_1_CLEARANCE)
+    for i in range(first_index, first_index + count):
+        x, y = world.free_location(d, TARGET_CLUSTER_SIZE_1_CLEARANCE)
+        world.add("at0", "at%d" % i, x, y, TARGET_CLUSTER_SIZE_1_CLEARANCE)
+
+
+def add_uniform_targets(world, arena_dim, number_of_tags):
+    add_single_targets(world, arena_dim, 0, number_of_tags)
+
+
+def add_clustered_targets(world, arena_dim, number_of_tags):
+    # four clusters, length x width each
+    sizes = {256: (8, 8), 128: (8, 4), 64: (4, 4), 32: (4, 2), 16: (2, 2)}
+    length, width = sizes.get(number_of_tags, (1, 1))
+
+    clearance = TARGET_CLUSTER_SIZE_1_CLEARANCE * max(length, width)
+    d = arena_dim / 2.0 - (BARRIER_CLEARANCE + clearance)
+    index = 0
+    for i in range(4):
+        x, y = world.free_location(d, clearance)
+        index = world.add_cluster(x, y, length, width, index)
+
+
+def add_powerlaw_targets(world, arena_dim, number_of_tags):
+    # one pile of 64, four of 16, sixteen of 4 and sixty-four single targets
+    index = 0
+    for piles, side, clearance in [(1, 8, TARGET_CLUSTER_SIZE_64_CLEARANCE),
+                                   (4, 4, TARGET_CLUSTER_SIZE_16_CLEARANCE),
+                                   (16, 2, TARGET_CLUSTER_SIZE_4_CLEARANCE)]:
+        d = arena_dim / 2.0 - (BARRIER_CLEARANCE + clearance)
+        for i in range(piles):
+            x, y = world.free_location(d, clearance)
+            index = world.add_cluster(x, y, side, side, index)
+
+    add_single_targets(world, arena_dim, index, 64)
+
+
+DISTRIBUTIONS = {"uniform": add_uniform_targets,
+                 "clustered": add_clustered_targets,
+                 "powerlaw": add_powerlaw_targets}
+
+
+def build_world(args, seed):
+    """The whole arena, see World.split() for the worlds of its shards."""
+    world = World(random.Random(seed))
+    arena_dim, barrier, n_rovers = arena_settings(args)
+
+    if barrier is not None:
+        # walls have no clearance, BARRIER_CLEARANCE keeps targets off them
+        world.models += [(barrier, "Barrier_West", -arena_dim / 2, 0, 0, 0, 0, 0),
+                         (barrier, "Barrier_North", 0, -arena_dim / 2, 0, 0, 0, math.pi / 2),
+                         (barrier, "Barrier_East", arena_dim / 2, 0, 0, 0, 0, 0),
+                         (barrier, "Barrier_South", 0, arena_dim / 2, 0, 0, 0, math.pi / 2)]
+
+    ground = GROUND_PLANES[args.ground]
+    world.models.append((ground, ground, 0, 0, 0, 0, 0, 0))
+    world.add("collection_disk", "collection_disk", 0, 0, COLLECTION_DISK_CLEARANCE)
+    if args.shards > 1:
+        add_sector_walls(world, arena_dim, args.shards)
+
+    for i, (x, y, yaw) in enumerate(rover_poses(n_rovers, args.shards)):
+        world.add_rover(rover_name(i), x, y, yaw)
+
+    DISTRIBUTIONS[args.distribution](world, arena_dim, args.targets)
+    return world, world.rovers
+
+
+def write_rover_models(models_dir, rovers):
+    """Copies the template rover model for the rovers past the named ones,
+    their topics are under their own name."""
+    with open(os.path.join(APP_ROOT, "simulation", "models", ROVER_TEMPLATE, "model.sdf")) as f:
+        template = f.read()
+    with open(os.path.join(APP_ROOT, "simulation", "models", ROVER_TEMPLATE, "model.config")) as f:
+        config = f.read()
+    for rover in rovers:
+        if rover in ROVER_NAMES:
+            continue
+        model_dir = os.path.join(models_dir, rover)
+        os.makedirs(model_dir)
+        with open(os.path.join(model_dir, "model.sdf"), "w") as f:
+            f.write(template.replace(ROVER_TEMPLATE, rover))
+        with open(os.path.join(model_dir, "model.config"), "w") as f:
+            f.write(config)
+
+
+def shard_namespace(index):
+    """Where shard index publishes its /clock and /gazebo services, shard 0
+    keeps the usual names."""
+    return "" if index == 0 else "/shards/shard_%d" % index
+
+
+def arena_settings(args):
+    if args.arena in ARENAS:
+        arena_dim, barrier, n_rovers = ARENAS[args.arena]
+    else:
+        arena_dim, barrier, n_rovers = float(args.arena), None, 3
+    if args.rovers is not None:
+        n_rovers = args.rovers
+    return arena_dim, barrier, n_rovers
+
+
+def trial_environment(trial_dir, ros_port, gazebo_port, physics_profile):
+    env = dict(os.environ)
+    env["SWARMATHON_PHYSICS_PROFILE"] = physics_profile
+    env["SWARMATHON_APP_ROOT"] = APP_ROOT
+    env["GAZEBO_MODEL_PATH"] = os.pathsep.join([os.path.join(trial_dir, "models"),
+                                                os.path.join(APP_ROOT, "simulation", "models")])
+    env["GAZEBO_PLUGIN_PATH"] = os.path.join(APP_ROOT, "build", "gazebo_plugins")
+    env["ROS_MASTER_URI"] = "http://localhost:%d" % ros_port
+    env["GAZEBO_MASTER_URI"] = "http://localhost:%d" % gazebo_port
+    env["ROS_LOG_DIR"] = os.path.join(trial_dir, "ros")
+    return env
+
+
+class Trial(object):
+    """Starts and cleans up the processes of one simulation trial."""
+
+    def __init__(self, args, number):
+        self.args = args
+        self.number = number
+        self.seed = args.seed + number
+        self.dir = os.path.join(args.workdir, "trial_%d" % number)
+        self.gazebo_port = args.gazebo_port + number * args.shards
+        self.env = trial_environment(self.dir,
+                                     args.ros_port + number,
+                                     self.gazebo_port,
+                                     args.physics)
+        self.processes = []
+        self.score_file = os.path.join(self.dir, "score.csv")
+        self.startup_times = {}  # rover name -> seconds to its first heartbeat
+
+    def shard_environment(self, index):
+        """The environment of the Gazebo server of shard index, each runs its
+        own Gazebo master."""
+        env = dict(self.env)
+        env["GAZEBO_MASTER_URI"] = "http://localhost:%d" % (self.gazebo_port + index)
+        if self.args.shards > 1:
+            env["SWARMATHON_SHARD"] = str(index)
+            env["SWARMATHON_SHARDS"] = str(self.args.shards)
+        return env
+
+    def start(self, name, command, env=None):
+        log = open(os.path.join(self.dir, name + ".log"), "w")
+        # own process group so the whole launch tree can be stopped at once
+        process = subprocess.Popen(command, env=env or self.env, stdout=log, stderr=subprocess.STDOUT,
+                                   preexec_fn=os.setsid)
+        self.processes.append((process, log))
+        return process
+
+    def call(self, command):
+        with open(os.devnull, "w") as devnull:
+            return subprocess.call(command, env=self.env, stdout=devnull, stderr=devnull)
+
+    def wait_for(self, command, timeout):
+        deadline = time.time() + timeout
+        while time.time() < deadline:
+            if self.call(command) == 0:
+                return True
+            time.sleep(0.5)
+        return False
+
+    def wait_for_heartbeats(self, rovers, timeout):
+        """Waits for the first behaviour heartbeat of every rover, all at once,
+        and records how long each took after its launch was started. Returns
+        the rovers that did not report within timeout seconds."""
+        started = time.time()
+        deadline = started + timeout
+        devnull = open(os.devnull, "w")
+
+        def echo_heartbeat(rover):
+            return subprocess.Popen(["rostopic", "echo", "-n", "1", "/" + rover + "/behaviour/heartbeat"],
+                                    env=self.env, stdout=devnull, stderr=devnull)
+
+        waiting = dict((rover, echo_heartbeat(rover)) for rover in rovers)
+        while waiting and time.time() < deadline:
+            for rover, process in list(waiting.items()):
+                if process.poll() is not None:
+                    del waiting[rover]
+                    if process.returncode == 0:
+                        self.startup_times[rover] = time.time() - started
+                    else:
+                        # the topic was not advertised yet, ask again
+                        waiting[rover] = echo_heartbeat(rover)
+            time.sleep(0.2)
+        for process in waiting.values():
+            process.kill()
+            process.wait()
+        devnull.close()
+        return sorted(waiting)
+
+    def run(self):
+        if os.path.isdir(self.dir):
+            shutil.rmtree(self.dir)
+        os.makedirs(self.dir)
+
+        world, rovers = build_world(self.args, self.seed)
+        write_rover_models(os.path.join(self.dir, "models"), rovers)
+        if self.args.shards > 1:
+            worlds = world.split(self.args.shards)
+            world_paths = [os.path.join(self.dir, "trial_shard_%d.world" % index) for index in range(len(worlds))]
+        else:
+            worlds = [world]
+            world_paths = [os.path.join(self.dir, "trial.world")]
+        for shard_world, world_path in zip(worlds, world_paths):
+            with open(world_path, "w") as f:
+                f.write(shard_world.to_sdf())
+
+        try:
+            self.start("roscore", ["roscore", "-p", str(self.args.ros_port + self.number)])
+            if not self.wait_for(["rosparam", "set", "/use_sim_time", "true"], 30):
+                return "could not reach the ROS master"
+
+            # the shards load at the same time, each on its own core
+            for index, world_path in enumerate(world_paths):
+                command = ["rosrun", "gazebo_ros", "gzserver", world_path]
+                if index > 0:
+                    command += ["__ns:=" + shard_namespace(index), "/clock:=" + shard_namespace(index) + "/clock"]
+                self.start("gzserver" if len(worlds) == 1 else "gzserver_%d" % index, command,
+                           self.shard_environment(index))
+            for index in range(len(worlds)):
+                if not self.wait_for(["rosservice", "info", shard_namespace(index) + "/gazebo/get_world_properties"],
+                                     120):
+                    return "gazebo did not start" if len(worlds) == 1 else "gazebo shard %d did not start" % index
+
+            for index, shard_world in enumerate(worlds):
+                for rover in shard_world.rovers:
+                    self.start(rover, ["roslaunch", os.path.join(APP_ROOT, "launch", "swarmie.launch"),
+                                       "name:=" + rover, "clock:=" + shard_namespace(index) + "/clock",
+                                       "random_seed:=%d" % self.seed])
+            # the rovers start in parallel, so wait for each to report rather than a fixed delay
+            silent = self.wait_for_heartbeats(rovers, ROVER_READY_TIMEOUT)
+            if silent:
+                return "no heartbeat from " + ", ".join(silent)
+
+            # 2 puts a rover into autonomous mode, latched like the GUI does
+            for rover in rovers:
+                self.start(rover + "_mode", ["rostopic", "pub", "-l", "/" + rover + "/mode",
+                                             "std_msgs/UInt8", "2"])
+
+            labels = "trial=%d,seed=%d" % (self.number, self.seed)
+            if self.args.shards > 1:
+                labels += ",shards=%d" % self.args.shards
+            if self.args.label:
+                labels = "version=%s,%s" % (self.args.label, labels)
+            self.start("metrics", ["rosrun", "diagnostics", "swarm_metrics",
+                                   "_file:=" + os.path.join(self.dir, "metrics.prom"),
+                                   "_labels:=" + labels])
+
+            monitor = self.start("monitor", [sys.executable, os.path.abspath(__file__),
+                                             "--monitor", self.score_file,
+                                             "--duration", str(self.args.duration)])
+            deadline = time.time() + self.args.timeout
+            while monitor.poll() is None and time.time() < deadline:
+                time.sleep(1)
+            if monitor.poll() is None:
+                return "timed out after %d s wall time" % self.args.timeout
+            return None
+        finally:
+            self.stop()
+
+    def stop(self):
+        for process, log in reversed(self.processes):
+            if process.poll() is None:
+                try:
+                    os.killpg(process.pid, signal.SIGINT)
+                except OSError:
+                    pass
+        deadline = time.time() + 15
+        for process, log in reversed(self.processes):
+            while process.poll() is None and time.time() < deadline:
+                time.sleep(0.2)
+            if process.poll() is None:
+                try:
+                    os.killpg(process.pid, signal.SIGKILL)
+                except OSError:
+                    pass
+                process.wait()
+            log.close()
+        self.processes = []
+
+    def read_scores(self):
+        if not os.path.exists(self.score_file):
+            return []
+        with open(self.score_file) as f:
+            return [row for row in csv.reader(f)]
+
+
+def monitor(score_file, duration):
+    """Runs inside a trial's environment: records the score whenever it
+    changes and exits once the simulation clock reaches duration seconds."""
+    import rospy
+    from rosgraph_msgs.msg import Clock
+    from std_msgs.msg import String
+
+    state = {"score": None, "now": 0.0}
+    lock = threading.Lock()
+    done = threading.Event()
+    out = open(score_file, "w")
+
+    def on_clock(msg):
+        with lock:
+            state["now"] = msg.clock.to_sec()
+        if state["now"] >= duration:
+            done.set()
+
+    def on_score(msg):
+        with lock:
+            if msg.data != state["score"]:
+                state["score"] = msg.data
+                out.write("%.3f,%s\n" % (state["now"], msg.data))
+                out.flush()
+
+    rospy.init_node("trial_monitor", disable_signals=True)
+    rospy.Subscriber("/clock", Clock, on_clock, queue_size=1)
+    rospy.Subscriber("/collectionZone/score", String, on_score, queue_size=10)
+
+    while not done.wait(1.0):
+        if rospy.is_shutdown():
+            break
+
+    with lock:
+        out.write("%.3f,%s\n" % (state["now"], state["score"] if state["score"] is not None else "0"))
+    out.close()
+    rospy.signal_shutdown("trial finished")
+
+
+def run_trial(args, number, print_lock):
+    trial = Trial(args, number)
+    started = time.time()
+    error = trial.run()
+    scores = trial.read_scores()
+    with print_lock:
+        final = scores[-1][1] if scores else "-"
+        status = "failed: " + error if error else "score " + final
+        print("trial %d (seed %d): %s, %.0f s wall" % (number, trial.seed, status, time.time() - started))
+        if trial.startup_times:
+            print("  rover startup: " + ", ".join("%s %.1f s" % (rover, seconds)
+                                                  for rover, seconds in sorted(trial.startup_times.items())))
+        sys.stdout.flush()
+    return trial, scores
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Run headless Swarmathon simulation trials.")
+    parser.add_argument("--trials", type=int, default=1, help="number of trials")
+    parser.add_argument("--parallel", type=int, default=max(1, multiprocessing.cpu_count() // 4),
+                        help="trials running at the same time (default: a quarter of the cores)")
+    parser.add_argument("--distribution", choices=sorted(DISTRIBUTIONS), default="uniform")
+    parser.add_argument("--targets", type=int, default=256,
+                        help="number of targets for uniform and clustered distributions")
+    parser.add_argument("--arena", default="prelim",
+                        help="prelim, final or an unbounded arena size in meters")
+    parser.add_argument("--rovers", type=int,
+                        help="override the number of rovers, past 8 they are copies of %s" % ROVER_TEMPLATE)
+    parser.add_argument("--shards", type=int, default=1,
+                        help="Gazebo servers the arena is split between, one sector each")
+    parser.add_argument("--ground", choices=sorted(GROUND_PLANES), default="gravel")
+    parser.add_argument("--duration", type=float, default=1200, help="simulated seconds per trial")
+    parser.add_argument("--timeout", type=float, default=4 * 3600, help="wall seconds before a trial is abandoned")
+    parser.add_argument("--physics", choices=PHYSICS_PROFILES, default="fast-eval",
+                        help="SetupWorld physics profile")
+    parser.add_argument("--seed", type=int, default=0, help="trial n uses seed + n")
+    parser.add_argument("--ros-port", type=int, default=11411, help="ROS master port of trial 0")
+    parser.add_argument("--gazebo-port", type=int, default=11545, help="Gazebo master port of trial 0")
+    parser.add_argument("--workdir", default=os.path.join(APP_ROOT, "logs", "trials"))
+    parser.add_argument("--output", default="trials.csv")
+    parser.add_argument("--label", default="",
+                        help="code version the swarm metrics of every trial are labelled with")
+    parser.add_argument("--monitor", metavar="SCORE_FILE", help=argparse.SUPPRESS)
+    args = parser.parse_args()
+
+    if args.monitor:
+        monitor(args.monitor, args.duration)
+        return 0
+
+    if args.arena not in ARENAS:
+        try:
+            float(args.arena)
+        except ValueError:
+            parser.error("--arena must be prelim, final or a size in meters")
+
+    if args.rovers is not None and args.rovers < 0:
+        parser.error("--rovers cannot be negative")
+    if args.shards < 1:
+        parser.error("--shards must be at least 1")
+
+    if args.ros_port < args.gazebo_port + args.trials * args.shards and args.gazebo_port < args.ros_port + args.trials:
+        parser.error("the ROS and Gazebo port ranges overlap")
+
+    if args.distribution == "powerlaw":
+        args.targets = 256  # the power law layout always places 256 targets
+
+    print("Running %d %s trials, %d at a time, logs in %s" %
+          (args.trials, args.distribution, args.parallel, args.workdir))
+
+    print_lock = threading.Lock()
+    results = {}
+    pending = list(range(args.trials))
+    pending_lock = threading.Lock()
+
+    def worker():
+        while True:
+            with pending_lock:
+                if not pending:
+                    return
+                number = pending.pop(0)
+            results[number] = run_trial(args, number, print_lock)
+
+    workers = [threading.Thread(target=worker) for i in range(min(args.parallel, args.trials))]
+    for thread in workers:
+        thread.start()
+    for thread in workers:
+        thread.join()
+
+    with open(args.output, "w") as f:
+        writer = csv.writer(f)
+        writer.writerow(["trial", "seed", "distribution", "targets", "sim_time", "score"])
+        for number in sorted(results):
+            trial, scores = results[number]
+            for sim_time, score in scores:
+                writer.writerow([number, trial.seed, args.distribution, args.targets, sim_time, score])
+
+    print("Wrote %s" % args.output)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,60 @@
+#ifndef COMMANDSCHEDULER_H
+#define	COMMANDSCHEDULER_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "usbSerial.h"
+
+// Paces outbound commands to the arduino without blocking ROS callbacks.
+//
+// Each actuator has a single slot holding its latest command. Submitting a
+// new command for an actuator replaces one that has not been sent yet, so
+// bursts of gripper or drive setpoints collapse to the most recent value.
+// A writer thread sends pending slots in priority order, waiting at least
+// the minimum send delay between writes because sending to the arduino too
+// fast causes a disconnect.
+class CommandScheduler {
+public:
+
+    // Listed in send priority order, drive commands always go first
+    enum Actuator {
+        DRIVE = 0,
+        DATA_REQUEST,
+        FINGER,
+        WRIST,
+        NUM_ACTUATORS
+    };
+
+    CommandScheduler(USBSerial& usb);
+    virtual ~CommandScheduler();
+
+    void start(unsigned int minSendDelayMicroseconds);
+    void stop();
+
+    void submit(Actuator actuator, const char* command);
+
+    // Number of commands replaced before they were sent
+    unsigned long coalescedCount();
+
+private:
+
+    void writerLoop();
+
+    static const int maxCommandLength = 16;
+
+    USBSerial& usb;
+    unsigned int minSendDelay;
+
+    std::mutex slotMutex;
+    std::condition_variable slotCondition;
+    std::thread writerThread;
+    bool running;
+
+    char commands[NUM_ACTUATORS][maxCommandLength];
+    bool pending[NUM_ACTUATORS];
+    unsigned long coalesced;
+};
+
+#endif	/* COMMANDSCHEDULER_H */
@@ -0,0 +1,57 @@
+#ifndef SENTENCEPARSER_H
+#define	SENTENCEPARSER_H
+
+#include <stddef.h>
+
+// A single comma separated sentence from the arduino, e.g.
+// "USL,1,45". Fields point into the parser's line buffer and are only
+// valid inside the handler the sentence was passed to.
+class Sentence {
+public:
+
+    static const int maxFields = 16;
+
+    int size() const { return fieldCount; }
+    const char* field(int i) const { return i < fieldCount ? fields[i] : ""; }
+    bool fieldIs(int i, const char* value) const;
+    float number(int i) const;
+
+private:
+
+    friend class SentenceParser;
+
+    const char* fields[maxFields];
+    int fieldCount;
+};
+
+// Streaming, allocation free tokenizer for the ASCII telemetry format.
+// Bytes can be pushed in arbitrary chunks; a line that is split across
+// reads is kept until its terminating newline arrives. Each complete line
+// is split in place on ',' and handed to the handler.
+class SentenceParser {
+public:
+
+    typedef void (*SentenceHandler)(const Sentence& sentence);
+
+    SentenceParser(SentenceHandler handler);
+
+    void push(const char* data, size_t length);
+    void reset();
+
+    unsigned long overflows() const { return overflowCount; }
+
+private:
+
+    void tokenize();
+
+    static const size_t maxLineLength = 200;
+
+    SentenceHandler handler;
+    char line[maxLineLength + 1];
+    size_t lineLength;
+    bool discardLine;
+    unsigned long overflowCount;
+    Sentence sentence;
+};
+
+#endif	/* SENTENCEPARSER_H */
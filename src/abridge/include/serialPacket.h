@@ -0,0 +1,118 @@
+#ifndef SERIALPACKET_H
+#define	SERIALPACKET_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Binary telemetry framing used between abridge and the swarmie_control
+// firmware. The packet layouts below must match
+// arduino/libraries/SerialPacket/SerialPacket.h byte for byte. Both the
+// A-Star and the NUC are little endian so fields are sent as-is.
+//
+// Frame layout:
+//   SYNC0 SYNC1 TYPE LENGTH PAYLOAD[LENGTH] CRC_LO CRC_HI
+//
+// The CRC is CRC-16/CCITT (poly 0x1021, init 0xFFFF) computed over
+// TYPE, LENGTH and PAYLOAD.
+
+#define PACKET_SYNC0 0xA5
+#define PACKET_SYNC1 0x5A
+#define PACKET_MAX_PAYLOAD 64
+#define PACKET_PROTOCOL_VERSION 3
+#define PACKET_STREAM_VERSION 2 // first version that pushes telemetry after the "p" command
+
+enum PacketType {
+    PACKET_HELLO = 0x01,   // reply to the "b" and "p" commands, confirms the mode
+    PACKET_GRIPPER = 0x10,
+    PACKET_IMU = 0x11,
+    PACKET_ODOM = 0x12,
+    PACKET_SONAR = 0x13,
+    PACKET_ODOM_POSE = 0x14 // replaces PACKET_ODOM from version 3
+};
+
+#pragma pack(push, 1)
+
+struct HelloPacket {
+    uint8_t version;
+};
+
+struct GripperPacket {
+    uint8_t fingerAttached;
+    uint8_t wristAttached;
+    float fingerAngle; // radians
+    float wristAngle;  // radians
+};
+
+struct ImuPacket {
+    uint8_t status;
+    float linearAcceleration[3]; // m/s^2
+    float angularVelocity[3];    // rad/s
+    float orientation[3];        // roll, pitch, yaw in radians
+};
+
+struct OdomPacket {
+    float x, y, theta;    // cm, cm, rad since the last packet
+    float vx, vy, vtheta; // cm/s, cm/s, rad/s
+};
+
+// The pose is accumulated on the arduino, so frames that are lost or
+// corrupted cost no distance. The sequence number counts the frames sent
+// since the arduino started and shows how many went missing.
+struct OdomPosePacket {
+    uint16_t sequence;
+    int32_t x, y;         // um since startup in the frame the rover started in
+    float theta;          // rad since startup
+    float vx, vy, vtheta; // cm/s, cm/s, rad/s
+};
+
+struct SonarPacket {
+    uint16_t left;   // cm, 0 means no echo
+    uint16_t center;
+    uint16_t right;
+};
+
+#pragma pack(pop)
+
+uint16_t packetCRC(const uint8_t* data, size_t length, uint16_t crc = 0xFFFF);
+
+// Incremental frame decoder. Bytes are pushed one at a time and push()
+// returns true once a complete frame with a valid CRC has been received.
+// The frame stays available through type()/length()/payload() until the
+// next call to push(). Corrupt or truncated frames are dropped and the
+// decoder resynchronises on the next sync pattern.
+class SerialPacketDecoder {
+public:
+
+    SerialPacketDecoder();
+
+    bool push(uint8_t byte);
+    void reset();
+
+    uint8_t type() const { return packetType; }
+    uint8_t length() const { return packetLength; }
+    const uint8_t* payload() const { return packetPayload; }
+
+    unsigned long crcErrors() const { return crcErrorCount; }
+
+private:
+
+    enum DecoderState {
+        WAIT_SYNC0,
+        WAIT_SYNC1,
+        WAIT_TYPE,
+        WAIT_LENGTH,
+        WAIT_PAYLOAD,
+        WAIT_CRC_LO,
+        WAIT_CRC_HI
+    };
+
+    DecoderState state;
+    uint8_t packetType;
+    uint8_t packetLength;
+    uint8_t payloadIndex;
+    uint8_t packetPayload[PACKET_MAX_PAYLOAD];
+    uint16_t receivedCRC;
+    unsigned long crcErrorCount;
+};
+
+#endif	/* SERIALPACKET_H */
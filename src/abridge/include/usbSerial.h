@@ -9,6 +9,10 @@
 #include <unistd.h>  
 #include <fcntl.h>   
 #include <termios.h> 
+#include <poll.h>
+#include <atomic>
+#include <functional>
+#include <thread>
 
 using namespace std;
 
@@ -18,18 +22,49 @@ public:
     USBSerial();
     virtual ~USBSerial();
   
+    // Called from the reader thread with each chunk of bytes as it arrives.
+    typedef std::function<void(const unsigned char* data, int length)> DataHandler;
+
+    // Called from the reader thread after the port was reopened, before
+    // reading resumes, so it may use readBytes(). Reopening resets the
+    // arduino, which has to be set up again.
+    typedef std::function<void()> ReopenHandler;
+
     void openUSBPort(string devicePath, int baud);
     void sendData(char data[]);
-    string readData();
+    int readBytes(unsigned char buffer[], int length);
     void closeUSBPort();
 
+    // Start a dedicated thread that waits on the port with poll() and
+    // passes every byte read to handler. No data is ever flushed, so
+    // partial frames are completed by the next read instead of lost. When
+    // the adapter goes away the thread closes the port and reopens it,
+    // waiting longer between tries up to maxReopenDelay, then calls the
+    // reopen handler if one was set.
+    void startReader(DataHandler handler);
+    void stopReader();
+    void setReopenHandler(ReopenHandler handler) { reopenHandler = handler; }
+
 private:
 
+    void readerLoop();
+    int openDevice();
+    bool reopenUSBPort();
+
+    static const int minReopenDelay = 100; // ms
+    static const int maxReopenDelay = 2000; // ms
+
     struct termios ioStruct;
-    int usbFileDescriptor;
-    char serialDataIn[200];
+    string devicePath;
+    std::atomic<int> usbFileDescriptor;
     char dataOut[16];
 
+    DataHandler dataHandler;
+    ReopenHandler reopenHandler;
+    std::thread readerThread;
+    std::atomic<bool> reading;
+    unsigned char readBuffer[1024];
+
 };
 
 #endif	/* USBSERIAL_H */
@@ -13,20 +13,43 @@
 #include <sensor_msgs/Imu.h>
 #include <sensor_msgs/Range.h>
 #include <std_msgs/UInt8.h>
+#include <swarmie_msgs/ControlTrace.h>
 
 //Package include
 #include <usbSerial.h>
+#include <serialPacket.h>
+#include <sentenceParser.h>
+#include <commandScheduler.h>
+#include <shm_transport/SharedRing.h>
+#include <shm_transport/RoverSamples.h>
+#include <sbridge/SkidSteerTable.h>
+
+#include <atomic>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <thread>
 
 using namespace std;
 
 //aBridge functions
 void driveCommandHandler(const geometry_msgs::Twist::ConstPtr& message);
+void driveCommand(const geometry_msgs::Twist& command);
+void sharedDriveLoop();
+void shareSonar();
 void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle);
 void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle);
 void serialActivityTimer(const ros::TimerEvent& e);
 void publishRosTopics();
-void parseData(string data);
+void parseSentence(const Sentence& sentence);
+int requestHello(char* command);
+std::string negotiateProtocol();
+void serialReopenHandler();
+void serialDataHandler(const unsigned char* data, int length);
+void parsePacket(uint8_t type, const uint8_t* payload, uint8_t length);
 std::string getHumanFriendlyTime();
+void driveTraceHandler(const swarmie_msgs::ControlTrace::ConstPtr& message);
+void recordControlLatency(double sonarStamp, double sonarReceived, double workStart, double commandSent);
 
 //Globals
 geometry_msgs::QuaternionStamped fingerAngle;
@@ -37,21 +60,62 @@ sensor_msgs::Range sonarLeft;
 sensor_msgs::Range sonarCenter;
 sensor_msgs::Range sonarRight;
 USBSerial usb;
+CommandScheduler commandScheduler(usb);
 const int baud = 115200;
 char dataCmd[] = "d\n";
+char binaryCmd[] = "b\n";
+char streamCmd[] = "p\n";
 char moveCmd[16];
 char host[128];
-const float deltaTime = 0.1; //abridge's update interval
+float deltaTime = 0.1; //abridge's update interval
 int currentMode = 0;
 string publishedName;
 
 // Allowing messages to be sent to the arduino too fast causes a disconnect
 // This is the minimum time between messages to the arduino in microseconds.
-// Only used with the gripper commands to fix a manual control bug.
+// Enforced by the command scheduler's writer thread for every command.
 unsigned int min_usb_send_delay = 100;
 
+// Shared with sbridge so the simulated rovers take the same motor commands
+SkidSteerTable skidSteer;
+
 float heartbeat_publish_interval = 2;
 
+// When true the arduino sends sensor data as CRC checked binary frames
+// (see serialPacket.h) instead of comma separated text. Enabled at startup,
+// and again after the port was reopened, if the firmware answers the "b"
+// command, otherwise the ASCII format is used.
+bool requestBinaryProtocol = true;
+std::atomic<bool> binaryProtocol(false);
+
+// When true the arduino pushes each sensor group as soon as it is fresh
+// instead of answering "d" (see streamTelemetry() in swarmie_control.ino),
+// and every frame is published as it arrives. Needs the binary protocol.
+bool requestStreamTelemetry = true;
+std::atomic<bool> streamTelemetry(false);
+SerialPacketDecoder packetDecoder;
+unsigned char serialBytesIn[256];
+
+// Odometry frames that never arrived, from gaps in their sequence numbers.
+// Counted on the serial reader thread and reported with the heartbeat.
+bool odomSequenceStarted = false;
+uint16_t nextOdomSequence = 0;
+std::atomic<unsigned long> lostOdomFrames(0);
+unsigned long reportedLostOdomFrames = 0;
+
+// When true the sonar ranges also go to behaviours and the drive commands
+// come from it through shared memory rings (see SharedRing.h in
+// shm_transport) instead of loopback TCPROS. Both nodes need the same
+// shared_memory_transport setting. The sonar topics are still published
+// for the GUI and the rest.
+bool sharedMemoryTransport = false;
+shm_transport::SharedRingWriter<shm_transport::SonarSample> sonarRing;
+shm_transport::SharedRingReader<shm_transport::DriveSample> driveRing;
+
+// Splits the ASCII telemetry into sentences in place, keeping partial lines
+// between reads.
+SentenceParser sentenceParser(parseSentence);
+
 
 //PID constants and arrays
 const int histArrayLength = 1000;
@@ -70,6 +134,33 @@ float prevYaw = 0;
 
 ros::Time prevDriveCommandUpdateTime;
 
+// Control latency from a sonar reading being parsed to the drive command
+// computed from it reaching abridge, split into stages using the trace
+// behaviours sends with its drive commands, on driveControl/trace or in the
+// shared memory sample (see sendDriveCommand() in ROSAdapter.cpp). Published
+// as a summary every controlLatencyInterval.
+enum ControlLatencyStage {
+  SONAR_TO_BEHAVIOURS = 0, // abridge publish to behaviours sonarHandler
+  WAIT_FOR_TICK,           // sonarHandler to the start of DoWork
+  DO_WORK,                 // DoWork start to the drive command being sent
+  COMMAND_TO_ABRIDGE,      // drive command transport back to abridge
+  TOTAL,
+  NUM_CONTROL_LATENCY_STAGES
+};
+
+struct LatencyAccumulator {
+  unsigned long count;
+  double sum;
+  double max;
+};
+
+const char* controlLatencyStageNames[NUM_CONTROL_LATENCY_STAGES] = {
+  "sonar_to_behaviours", "wait_for_tick", "do_work", "command_to_abridge", "total"
+};
+LatencyAccumulator controlLatency[NUM_CONTROL_LATENCY_STAGES];
+std::mutex controlLatencyMutex; // drive commands from shared memory are handled on their own thread
+float controlLatencyInterval = 5;
+
 //Publishers
 ros::Publisher fingerAnglePublish;
 ros::Publisher wristAnglePublish;
@@ -80,9 +171,11 @@ ros::Publisher sonarCenterPublish;
 ros::Publisher sonarRightPublish;
 ros::Publisher infoLogPublisher;
 ros::Publisher heartbeatPublisher;
+ros::Publisher controlLatencyPublisher;
 
 //Subscribers
 ros::Subscriber driveControlSubscriber;
+ros::Subscriber driveTraceSubscriber;
 ros::Subscriber fingerAngleSubscriber;
 ros::Subscriber wristAngleSubscriber;
 ros::Subscriber modeSubscriber;
@@ -90,10 +183,12 @@ ros::Subscriber modeSubscriber;
 //Timers
 ros::Timer publishTimer;
 ros::Timer publish_heartbeat_timer;
+ros::Timer controlLatencyTimer;
 
 //Callback handlers
 void publishHeartBeatTimerEventHandler(const ros::TimerEvent& event);
 void modeHandler(const std_msgs::UInt8::ConstPtr& message);
+void publishControlLatencyTimerEventHandler(const ros::TimerEvent& event);
 
 int main(int argc, char **argv) {
     
@@ -104,6 +199,10 @@ int main(int argc, char **argv) {
     ros::NodeHandle param("~");
     string devicePath;
     param.param("device", devicePath, string("/dev/ttyUSB0"));
+    param.param("binary_protocol", requestBinaryProtocol, requestBinaryProtocol);
+    param.param("stream_telemetry", requestStreamTelemetry, requestStreamTelemetry);
+    param.param("shared_memory_transport", sharedMemoryTransport, false);
+    param.param("update_interval", deltaTime, deltaTime);
     usb.openUSBPort(devicePath, baud);
 
     
@@ -119,6 +218,8 @@ int main(int argc, char **argv) {
         cout << "No Name Selected. Default is: " << publishedName << endl;
     }
     
+    LoadSkidSteerTable(publishedName, skidSteer);
+    
     fingerAnglePublish = aNH.advertise<geometry_msgs::QuaternionStamped>((publishedName + "/fingerAngle/prev_cmd"), 10);
     wristAnglePublish = aNH.advertise<geometry_msgs::QuaternionStamped>((publishedName + "/wristAngle/prev_cmd"), 10);
     imuPublish = aNH.advertise<sensor_msgs::Imu>((publishedName + "/imu"), 10);
@@ -128,15 +229,33 @@ int main(int argc, char **argv) {
     sonarRightPublish = aNH.advertise<sensor_msgs::Range>((publishedName + "/sonarRight"), 10);
     infoLogPublisher = aNH.advertise<std_msgs::String>("/infoLog", 1, true);
     heartbeatPublisher = aNH.advertise<std_msgs::String>((publishedName + "/abridge/heartbeat"), 1, true);
+    controlLatencyPublisher = aNH.advertise<std_msgs::String>((publishedName + "/abridge/control_latency"), 1);
     
-    driveControlSubscriber = aNH.subscribe((publishedName + "/driveControl"), 10, driveCommandHandler);
+    std::thread sharedDriveThread;
+    if (sharedMemoryTransport) {
+        if (!sonarRing.Open(shm_transport::SegmentName(publishedName, "sonar"), shm_transport::sonarRingCapacity)) {
+            ROS_WARN("Could not create the shared memory sonar ring, behaviours will not get sonar ranges");
+        }
+        sharedDriveThread = std::thread(sharedDriveLoop);
+    } else {
+        driveControlSubscriber = aNH.subscribe((publishedName + "/driveControl"), 10, driveCommandHandler);
+        driveTraceSubscriber = aNH.subscribe((publishedName + "/driveControl/trace"), 10, driveTraceHandler);
+    }
     fingerAngleSubscriber = aNH.subscribe((publishedName + "/fingerAngle/cmd"), 1, fingerAngleHandler);
     wristAngleSubscriber = aNH.subscribe((publishedName + "/wristAngle/cmd"), 1, wristAngleHandler);
     modeSubscriber = aNH.subscribe((publishedName + "/mode"), 1, modeHandler);
 
+    std_msgs::String msg;
+    msg.data = negotiateProtocol();
+    infoLogPublisher.publish(msg);
     
+    usb.setReopenHandler(serialReopenHandler);
+    usb.startReader(serialDataHandler);
+    commandScheduler.start(min_usb_send_delay);
+
     publishTimer = aNH.createTimer(ros::Duration(deltaTime), serialActivityTimer);
     publish_heartbeat_timer = aNH.createTimer(ros::Duration(heartbeat_publish_interval), publishHeartBeatTimerEventHandler);
+    controlLatencyTimer = aNH.createTimer(ros::Duration(controlLatencyInterval), publishControlLatencyTimerEventHandler);
     
     imu.header.frame_id = publishedName+"/base_link";
     
@@ -152,6 +271,10 @@ int main(int argc, char **argv) {
     prevDriveCommandUpdateTime = ros::Time::now();
 
     ros::spin();
+
+    if (sharedDriveThread.joinable()) {
+        sharedDriveThread.join();
+    }
     
     return EXIT_SUCCESS;
 }
@@ -161,51 +284,97 @@ int main(int argc, char **argv) {
 //See the following paper for description of PID controllers.
 //Bennett, Stuart (November 1984). "Nicholas Minorsky and the automatic steering of ships". IEEE Control Systems Magazine. 4 (4): 10–15. doi:10.1109/MCS.1984.1104827. ISSN 0272-1708.
 void driveCommandHandler(const geometry_msgs::Twist::ConstPtr& message) {
-   
-
-  float left = (message->linear.x); //target linear velocity in meters per second
-  float right = (message->angular.z); //angular error in radians
+  driveCommand(*message);
+}
 
-  // Cap motor commands at 120. Experimentally determined that high values (tested 180 and 255) can cause 
-  // the hardware to fail when the robot moves itself too violently.
-  int max_motor_cmd = 120;
+void driveCommand(const geometry_msgs::Twist& command) {
 
-  // Check that the resulting motor commands do not exceed the specified safe maximum value
-  if (left > max_motor_cmd)
-  {
-    left = max_motor_cmd;
-  }
-  else if (left < -max_motor_cmd)
-  {
-    left = - max_motor_cmd;
-  }
+  float left = (command.linear.x); //target linear velocity in meters per second
+  float right = (command.angular.z); //angular error in radians
 
-  if (right > max_motor_cmd)
-  {
-    right = max_motor_cmd;
-  }
-  else if (right < -max_motor_cmd)
-  {
-    right = -max_motor_cmd;
-  }
+  // Cap motor commands at the skid steer table's max_motor_command, the same
+  // limit sbridge drives the simulated rovers with
+  left = skidSteer.ClampCommand(left);
+  right = skidSteer.ClampCommand(right);
 
   int leftInt = left;
   int rightInt = right;
     
   sprintf(moveCmd, "v,%d,%d\n", leftInt, rightInt); //format data for arduino into c string
-  usb.sendData(moveCmd);                      //send movement command to arduino over usb
+  commandScheduler.submit(CommandScheduler::DRIVE, moveCmd); //queue movement command, replaces any unsent one
   memset(&moveCmd, '\0', sizeof (moveCmd));   //clear the movement command string
 }
 
+// The trace follows its drive command, so it arrives about when the command did
+void driveTraceHandler(const swarmie_msgs::ControlTrace::ConstPtr& message) {
+  recordControlLatency(message->sonar_stamp.toSec(), message->sonar_received.toSec(),
+                       message->work_start.toSec(), message->command_sent.toSec());
+}
+
+// Takes the drive commands behaviours writes to shared memory, opening the
+// ring once behaviours has created it
+void sharedDriveLoop() {
+  std::string name = shm_transport::SegmentName(publishedName, "driveControl");
+  while (ros::ok()) {
+    if (!driveRing.IsOpen() && !driveRing.Open(name)) {
+      usleep(100000);
+      continue;
+    }
+
+    shm_transport::DriveSample sample;
+    if (driveRing.Next(sample, 100)) {
+      geometry_msgs::Twist command;
+      command.linear.x = sample.left;
+      command.angular.z = sample.right;
+      driveCommand(command);
+      recordControlLatency(sample.sonarStamp, sample.sonarReceived, sample.workStart, sample.commandSent);
+    }
+  }
+}
+
+// Hands the sonar ranges just published to behaviours through shared memory
+void shareSonar() {
+  if (!sharedMemoryTransport) {
+    return;
+  }
+
+  shm_transport::SonarSample sample;
+  sample.stamp = std::max(sonarLeft.header.stamp, std::max(sonarCenter.header.stamp, sonarRight.header.stamp)).toSec();
+  sample.left = sonarLeft.range;
+  sample.center = sonarCenter.range;
+  sample.right = sonarRight.range;
+  sonarRing.Write(sample);
+}
+
+// Adds the stages of a traced drive command to the control latency
+// statistics. Commands without a trace (joystick, mode changes) are ignored.
+void recordControlLatency(double sonarStamp, double sonarReceived, double workStart, double commandSent) {
+  if (sonarStamp <= 0) {
+    return;
+  }
+
+  double stamps[NUM_CONTROL_LATENCY_STAGES + 1] = {
+    sonarStamp, sonarReceived, workStart, commandSent, ros::Time::now().toSec()
+  };
+
+  std::lock_guard<std::mutex> lock(controlLatencyMutex);
+  for (int i = 0; i < NUM_CONTROL_LATENCY_STAGES; i++) {
+    double latency = (i == TOTAL) ? stamps[TOTAL] - stamps[0] : stamps[i + 1] - stamps[i];
+    LatencyAccumulator& stage = controlLatency[i];
+    stage.count++;
+    stage.sum += latency;
+    if (stage.count == 1 || latency > stage.max) {
+      stage.max = latency;
+    }
+  }
+}
+
 
 // The finger and wrist handlers receive gripper angle commands in floating point
 // radians, write them to a string and send that to the arduino
 // for processing.
 void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
 
-  // To throttle the message rate so we don't lose connection to the arduino
-  usleep(min_usb_send_delay);
-  
   char cmd[16]={'\0'};
 
   // Avoid dealing with negative exponents which confuse the conversion to string by checking if the angle is small
@@ -215,14 +384,11 @@ void fingerAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
   } else {
     sprintf(cmd, "f,%.4g\n", angle->data);
   }
-  usb.sendData(cmd);
+  commandScheduler.submit(CommandScheduler::FINGER, cmd);
   memset(&cmd, '\0', sizeof (cmd));
 }
 
 void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
-  // To throttle the message rate so we don't lose connection to the arduino
-  usleep(min_usb_send_delay);
-  
     char cmd[16]={'\0'};
 
     // Avoid dealing with negative exponents which confuse the conversion to string by checking if the angle is small
@@ -232,14 +398,88 @@ void wristAngleHandler(const std_msgs::Float32::ConstPtr& angle) {
   } else {
     sprintf(cmd, "w,%.4g\n", angle->data);
   }
-  usb.sendData(cmd);
+  commandScheduler.submit(CommandScheduler::WRIST, cmd);
   memset(&cmd, '\0', sizeof (cmd));
 }
 
+// Requests a new set of sensor data. The response is parsed and published
+// by serialDataHandler on the serial reader thread as soon as it arrives.
+// While streaming the data comes by itself and "p" only keeps the arduino's
+// watchdog from stopping the motors and the stream.
 void serialActivityTimer(const ros::TimerEvent& e) {
-    usb.sendData(dataCmd);
-    parseData(usb.readData());
-    publishRosTopics();
+    commandScheduler.submit(CommandScheduler::DATA_REQUEST, streamTelemetry ? streamCmd : dataCmd);
+}
+
+// Ask the arduino to switch telemetry mode, "b" for binary frames and "p"
+// for streaming them. Firmware that supports the mode answers with a HELLO
+// frame carrying its protocol version, which is returned. Older firmware
+// ignores the command, in which case 0 is returned and we stay as we are.
+int requestHello(char* command) {
+    usb.sendData(command);
+
+    packetDecoder.reset();
+    ros::Time deadline = ros::Time::now() + ros::Duration(1.0);
+    while (ros::Time::now() < deadline) {
+        int count = usb.readBytes(serialBytesIn, sizeof (serialBytesIn));
+        for (int i = 0; i < count; i++) {
+            if (packetDecoder.push(serialBytesIn[i]) && packetDecoder.type() == PACKET_HELLO
+                && packetDecoder.length() == sizeof (HelloPacket)) {
+                const HelloPacket* hello = reinterpret_cast<const HelloPacket*>(packetDecoder.payload());
+                return hello->version;
+            }
+        }
+        usleep(10000);
+    }
+    return 0;
+}
+
+// Switches the arduino to the best telemetry mode both sides support and
+// returns a log message naming it. The arduino starts in the ASCII mode.
+std::string negotiateProtocol() {
+    binaryProtocol = false;
+    streamTelemetry = false;
+
+    int version = requestBinaryProtocol ? requestHello(binaryCmd) : 0;
+    if (version < 1 || version > PACKET_PROTOCOL_VERSION) {
+        return publishedName + " abridge: using ASCII serial protocol";
+    }
+
+    bool stream = requestStreamTelemetry && version >= PACKET_STREAM_VERSION && requestHello(streamCmd) > 0;
+    sentenceParser.reset();
+    binaryProtocol = true;
+    streamTelemetry = stream;
+    return publishedName + " abridge: using binary serial protocol" + (stream ? ", streaming" : "");
+}
+
+// Runs on the serial reader thread once the port was reopened. Opening the
+// port resets the arduino, which starts over in the ASCII mode, so the
+// telemetry is read as text until the mode has been negotiated again.
+void serialReopenHandler() {
+    binaryProtocol = false;
+    streamTelemetry = false;
+    sentenceParser.reset();
+    odomSequenceStarted = false;
+
+    // The same wait for the arduino to boot as at startup
+    sleep(5);
+
+    std_msgs::String msg;
+    msg.data = negotiateProtocol() + " after reconnecting";
+    infoLogPublisher.publish(msg);
+}
+
+// Runs on the serial reader thread. The sensor messages are only touched
+// from this thread, so no locking is needed around them.
+void serialDataHandler(const unsigned char* data, int length) {
+    if (binaryProtocol) {
+        for (int i = 0; i < length; i++) {
+            if (packetDecoder.push(data[i])) {
+                parsePacket(packetDecoder.type(), packetDecoder.payload(), packetDecoder.length());
+            }
+        }
+    } else {
+        sentenceParser.push(reinterpret_cast<const char*>(data), length);
+    }
 }
 
 void publishRosTopics() {
@@ -250,70 +490,161 @@ void publishRosTopics() {
     sonarLeftPublish.publish(sonarLeft);
     sonarCenterPublish.publish(sonarCenter);
     sonarRightPublish.publish(sonarRight);
+    shareSonar();
 }
 
-void parseData(string str) {
-    istringstream oss(str);
-    string sentence;
-    
-    while (getline(oss, sentence, '\n')) {
-		istringstream wss(sentence);
-		string word;
+void parseSentence(const Sentence& sentence) {
+    // USR is the last sentence of each response, publish the full set once
+    // it arrives even if the right sonar reported no echo.
+    if (sentence.fieldIs(0, "USR") && !sentence.fieldIs(1, "1")) {
+        publishRosTopics();
+    }
 
-		vector<string> dataSet;
-		while (getline(wss, word, ',')) {
-			dataSet.push_back(word);
-		}
+    if (sentence.size() < 3 || !sentence.fieldIs(1, "1")) {
+        return;
+    }
 
-		if (dataSet.size() >= 3 && dataSet.at(1) == "1") {
+    if (sentence.fieldIs(0, "GRF")) {
+        fingerAngle.header.stamp = ros::Time::now();
+        fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(sentence.number(2), 0.0, 0.0);
+    }
+    else if (sentence.fieldIs(0, "GRW")) {
+        wristAngle.header.stamp = ros::Time::now();
+        wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(sentence.number(2), 0.0, 0.0);
+    }
+    else if (sentence.fieldIs(0, "IMU") && sentence.size() >= 11) {
+        imu.header.stamp = ros::Time::now();
+        imu.linear_acceleration.x = sentence.number(2);
+        imu.linear_acceleration.y = 0; //sentence.number(3);
+        imu.linear_acceleration.z = sentence.number(4);
+        imu.angular_velocity.x = sentence.number(5);
+        imu.angular_velocity.y = sentence.number(6);
+        imu.angular_velocity.z = sentence.number(7);
+        imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(sentence.number(8), sentence.number(9), sentence.number(10));
+    }
+    else if (sentence.fieldIs(0, "ODOM") && sentence.size() >= 8) {
+        odom.header.stamp = ros::Time::now();
+        odom.pose.pose.position.x += sentence.number(2) / 100.0;
+        odom.pose.pose.position.y += sentence.number(3) / 100.0;
+        odom.pose.pose.position.z = 0.0;
+        odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(sentence.number(4));
+        odom.twist.twist.linear.x = sentence.number(5) / 100.0;
+        odom.twist.twist.linear.y = sentence.number(6) / 100.0;
+        odom.twist.twist.angular.z = sentence.number(7);
+    }
+    else if (sentence.fieldIs(0, "USL")) {
+        sonarLeft.header.stamp = ros::Time::now();
+        sonarLeft.range = sentence.number(2) / 100.0;
+    }
+    else if (sentence.fieldIs(0, "USC")) {
+        sonarCenter.header.stamp = ros::Time::now();
+        sonarCenter.range = sentence.number(2) / 100.0;
+    }
+    else if (sentence.fieldIs(0, "USR")) {
+        sonarRight.header.stamp = ros::Time::now();
+        sonarRight.range = sentence.number(2) / 100.0;
+        publishRosTopics();
+    }
+}
 
-            if (dataSet.at(0) == "GRF") {
-                fingerAngle.header.stamp = ros::Time::now();
-                fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(2).c_str()), 0.0, 0.0);
+// Binary counterpart of parseSentence. Frames whose length does not match the
+// expected layout are ignored.
+void parsePacket(uint8_t type, const uint8_t* payload, uint8_t length) {
+    if (type == PACKET_GRIPPER && length == sizeof (GripperPacket)) {
+        const GripperPacket* gripper = reinterpret_cast<const GripperPacket*>(payload);
+        if (gripper->fingerAttached) {
+            fingerAngle.header.stamp = ros::Time::now();
+            fingerAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(gripper->fingerAngle, 0.0, 0.0);
+        }
+        if (gripper->wristAttached) {
+            wristAngle.header.stamp = ros::Time::now();
+            wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(gripper->wristAngle, 0.0, 0.0);
+        }
+        if (streamTelemetry) {
+            fingerAnglePublish.publish(fingerAngle);
+            wristAnglePublish.publish(wristAngle);
+        }
+    }
+    else if (type == PACKET_IMU && length == sizeof (ImuPacket)) {
+        const ImuPacket* imuData = reinterpret_cast<const ImuPacket*>(payload);
+        if (imuData->status) {
+            imu.header.stamp = ros::Time::now();
+            imu.linear_acceleration.x = imuData->linearAcceleration[0];
+            imu.linear_acceleration.y = 0; //imuData->linearAcceleration[1];
+            imu.linear_acceleration.z = imuData->linearAcceleration[2];
+            imu.angular_velocity.x = imuData->angularVelocity[0];
+            imu.angular_velocity.y = imuData->angularVelocity[1];
+            imu.angular_velocity.z = imuData->angularVelocity[2];
+            imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(imuData->orientation[0], imuData->orientation[1], imuData->orientation[2]);
+            if (streamTelemetry) {
+                imuPublish.publish(imu);
             }
-			else if (dataSet.at(0) == "GRW") {
-				wristAngle.header.stamp = ros::Time::now();
-				wristAngle.quaternion = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(2).c_str()), 0.0, 0.0);
-			}
-			else if (dataSet.at(0) == "IMU") {
-				imu.header.stamp = ros::Time::now();
-				imu.linear_acceleration.x = atof(dataSet.at(2).c_str());
-				imu.linear_acceleration.y = 0; //atof(dataSet.at(3).c_str());
-				imu.linear_acceleration.z = atof(dataSet.at(4).c_str());
-				imu.angular_velocity.x = atof(dataSet.at(5).c_str());
-				imu.angular_velocity.y = atof(dataSet.at(6).c_str());
-				imu.angular_velocity.z = atof(dataSet.at(7).c_str());
-				imu.orientation = tf::createQuaternionMsgFromRollPitchYaw(atof(dataSet.at(8).c_str()), atof(dataSet.at(9).c_str()), atof(dataSet.at(10).c_str()));
-			}
-			else if (dataSet.at(0) == "ODOM") {
-				odom.header.stamp = ros::Time::now();
-				odom.pose.pose.position.x += atof(dataSet.at(2).c_str()) / 100.0;
-				odom.pose.pose.position.y += atof(dataSet.at(3).c_str()) / 100.0;
-				odom.pose.pose.position.z = 0.0;
-				odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(atof(dataSet.at(4).c_str()));
-				odom.twist.twist.linear.x = atof(dataSet.at(5).c_str()) / 100.0;
-				odom.twist.twist.linear.y = atof(dataSet.at(6).c_str()) / 100.0;
-				odom.twist.twist.angular.z = atof(dataSet.at(7).c_str());
-			}
-			else if (dataSet.at(0) == "USL") {
-				sonarLeft.header.stamp = ros::Time::now();
-				sonarLeft.range = atof(dataSet.at(2).c_str()) / 100.0;
-			}
-			else if (dataSet.at(0) == "USC") {
-				sonarCenter.header.stamp = ros::Time::now();
-				sonarCenter.range = atof(dataSet.at(2).c_str()) / 100.0;
-			}
-			else if (dataSet.at(0) == "USR") {
-				sonarRight.header.stamp = ros::Time::now();
-				sonarRight.range = atof(dataSet.at(2).c_str()) / 100.0;
-			}
-
-		}
-	}
+        }
+    }
+    else if (type == PACKET_ODOM && length == sizeof (OdomPacket)) {
+        // Firmware before protocol version 3 sends the motion since the
+        // last frame
+        const OdomPacket* odomData = reinterpret_cast<const OdomPacket*>(payload);
+        odom.header.stamp = ros::Time::now();
+        odom.pose.pose.position.x += odomData->x / 100.0;
+        odom.pose.pose.position.y += odomData->y / 100.0;
+        odom.pose.pose.position.z = 0.0;
+        odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(odomData->theta);
+        odom.twist.twist.linear.x = odomData->vx / 100.0;
+        odom.twist.twist.linear.y = odomData->vy / 100.0;
+        odom.twist.twist.angular.z = odomData->vtheta;
+        if (streamTelemetry) {
+            odomPublish.publish(odom);
+        }
+    }
+    else if (type == PACKET_ODOM_POSE && length == sizeof (OdomPosePacket)) {
+        const OdomPosePacket* odomData = reinterpret_cast<const OdomPosePacket*>(payload);
+        if (odomSequenceStarted && odomData->sequence != nextOdomSequence) {
+            lostOdomFrames += (uint16_t)(odomData->sequence - nextOdomSequence);
+        }
+        odomSequenceStarted = true;
+        nextOdomSequence = odomData->sequence + 1;
+
+        odom.header.stamp = ros::Time::now();
+        odom.pose.pose.position.x = odomData->x / 1e6;
+        odom.pose.pose.position.y = odomData->y / 1e6;
+        odom.pose.pose.position.z = 0.0;
+        odom.pose.pose.orientation = tf::createQuaternionMsgFromYaw(odomData->theta);
+        odom.twist.twist.linear.x = odomData->vx / 100.0;
+        odom.twist.twist.linear.y = odomData->vy / 100.0;
+        odom.twist.twist.angular.z = odomData->vtheta;
+        if (streamTelemetry) {
+            odomPublish.publish(odom);
+        }
+    }
+    else if (type == PACKET_SONAR && length == sizeof (SonarPacket)) {
+        const SonarPacket* sonar = reinterpret_cast<const SonarPacket*>(payload);
+        if (sonar->left > 0) {
+            sonarLeft.header.stamp = ros::Time::now();
+            sonarLeft.range = sonar->left / 100.0;
+        }
+        if (sonar->center > 0) {
+            sonarCenter.header.stamp = ros::Time::now();
+            sonarCenter.range = sonar->center / 100.0;
+        }
+        if (sonar->right > 0) {
+            sonarRight.header.stamp = ros::Time::now();
+            sonarRight.range = sonar->right / 100.0;
+        }
+
+        // The three ranges go out together for the synchronizer in
+        // behaviours. When polling, sonar is the last frame of each response.
+        if (streamTelemetry) {
+            sonarLeftPublish.publish(sonarLeft);
+            sonarCenterPublish.publish(sonarCenter);
+            sonarRightPublish.publish(sonarRight);
+            shareSonar();
+        } else {
+            publishRosTopics();
+        }
+    }
 }
 
-
-
 void modeHandler(const std_msgs::UInt8::ConstPtr& message) {
 	currentMode = message->data;
 }
@@ -322,4 +653,40 @@ void publishHeartBeatTimerEventHandler(const ros::TimerEvent&) {
     std_msgs::String msg;
     msg.data = "";
     heartbeatPublisher.publish(msg);
+
+    // The pose is accumulated on the arduino, so lost frames only cost
+    // samples, but a link that keeps losing them is worth knowing about
+    unsigned long lost = lostOdomFrames;
+    if (lost != reportedLostOdomFrames) {
+        std_msgs::String log;
+        log.data = publishedName + " abridge: " + to_string(lost - reportedLostOdomFrames) + " odometry frames lost, " + to_string(lost) + " in total";
+        infoLogPublisher.publish(log);
+        reportedLostOdomFrames = lost;
+    }
+}
+
+// Publishes the mean and maximum latency of each control stage in ms since
+// the last summary, for example
+// "commands 48 sonar_to_behaviours 1.2/3.4 wait_for_tick 52.0/99.1 ...".
+void publishControlLatencyTimerEventHandler(const ros::TimerEvent&) {
+    std::lock_guard<std::mutex> lock(controlLatencyMutex);
+    unsigned long count = controlLatency[TOTAL].count;
+    if (count == 0) {
+        return;
+    }
+
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(1) << "commands " << count;
+    for (int i = 0; i < NUM_CONTROL_LATENCY_STAGES; i++) {
+        LatencyAccumulator& stage = controlLatency[i];
+        summary << " " << controlLatencyStageNames[i] << " "
+                << stage.sum / stage.count * 1e3 << "/" << stage.max * 1e3;
+        stage.count = 0;
+        stage.sum = 0;
+        stage.max = 0;
+    }
+
+    std_msgs::String msg;
+    msg.data = summary.str();
+    controlLatencyPublisher.publish(msg);
 }
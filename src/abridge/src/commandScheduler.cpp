@@ -0,0 +1,86 @@
+#include "commandScheduler.h"
+
+using namespace std;
+
+CommandScheduler::CommandScheduler(USBSerial& usb) : usb(usb) {
+    minSendDelay = 0;
+    running = false;
+    coalesced = 0;
+    for (int i = 0; i < NUM_ACTUATORS; i++) {
+        pending[i] = false;
+        memset(commands[i], '\0', maxCommandLength);
+    }
+}
+
+void CommandScheduler::start(unsigned int minSendDelayMicroseconds) {
+    lock_guard<mutex> lock(slotMutex);
+    if (running) {
+        return;
+    }
+    minSendDelay = minSendDelayMicroseconds;
+    running = true;
+    writerThread = thread(&CommandScheduler::writerLoop, this);
+}
+
+void CommandScheduler::stop() {
+    {
+        lock_guard<mutex> lock(slotMutex);
+        running = false;
+    }
+    slotCondition.notify_one();
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+}
+
+void CommandScheduler::submit(Actuator actuator, const char* command) {
+    {
+        lock_guard<mutex> lock(slotMutex);
+        if (pending[actuator]) {
+            coalesced++;
+        }
+        strncpy(commands[actuator], command, maxCommandLength - 1);
+        commands[actuator][maxCommandLength - 1] = '\0';
+        pending[actuator] = true;
+    }
+    slotCondition.notify_one();
+}
+
+unsigned long CommandScheduler::coalescedCount() {
+    lock_guard<mutex> lock(slotMutex);
+    return coalesced;
+}
+
+void CommandScheduler::writerLoop() {
+    char command[maxCommandLength];
+
+    while (true) {
+        {
+            unique_lock<mutex> lock(slotMutex);
+
+            int next = NUM_ACTUATORS;
+            while (running) {
+                for (next = 0; next < NUM_ACTUATORS && !pending[next]; next++);
+                if (next < NUM_ACTUATORS) {
+                    break;
+                }
+                slotCondition.wait(lock);
+            }
+            if (!running) {
+                return;
+            }
+
+            memcpy(command, commands[next], maxCommandLength);
+            pending[next] = false;
+        }
+
+        // The write and the pacing delay happen outside the lock so that
+        // callbacks can keep replacing commands in the meantime.
+        usb.sendData(command);
+        usleep(minSendDelay);
+    }
+}
+
+CommandScheduler::~CommandScheduler() {
+    stop();
+}
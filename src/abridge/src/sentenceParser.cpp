@@ -0,0 +1,64 @@
+#include "sentenceParser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+bool Sentence::fieldIs(int i, const char* value) const {
+    return strcmp(field(i), value) == 0;
+}
+
+float Sentence::number(int i) const {
+    return strtof(field(i), NULL);
+}
+
+SentenceParser::SentenceParser(SentenceHandler handler) : handler(handler) {
+    overflowCount = 0;
+    reset();
+}
+
+void SentenceParser::reset() {
+    lineLength = 0;
+    discardLine = false;
+}
+
+void SentenceParser::push(const char* data, size_t length) {
+    for (size_t i = 0; i < length; i++) {
+        char c = data[i];
+
+        if (c == '\n') {
+            if (!discardLine) {
+                tokenize();
+            }
+            reset();
+        }
+        else if (c == '\r' || c == '\0') {
+            // println() terminates with "\r\n" and the port may hand us
+            // padding, neither is part of the sentence.
+        }
+        else if (lineLength < maxLineLength) {
+            line[lineLength++] = c;
+        }
+        else if (!discardLine) {
+            // Garbage or a lost newline, drop everything up to the next one
+            discardLine = true;
+            overflowCount++;
+        }
+    }
+}
+
+void SentenceParser::tokenize() {
+    line[lineLength] = '\0';
+
+    sentence.fieldCount = 0;
+    sentence.fields[sentence.fieldCount++] = line;
+    for (size_t i = 0; i < lineLength; i++) {
+        if (line[i] == ',') {
+            line[i] = '\0';
+            if (sentence.fieldCount < Sentence::maxFields) {
+                sentence.fields[sentence.fieldCount++] = &line[i + 1];
+            }
+        }
+    }
+
+    handler(sentence);
+}
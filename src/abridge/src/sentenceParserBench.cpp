@@ -0,0 +1,138 @@
+// abridge_bench: replays serial captures of the arduino's ASCII telemetry
+// through SentenceParser and through the istringstream parser abridge used
+// before it (parseData), for comparing their throughput.
+//
+// usage: abridge_bench [capture...] [--benchmark_filter=<regex>]
+//
+// A capture is the raw bytes the port delivered, e.g. recorded with
+// "cat /dev/ttyUSB0 > capture.txt" while the rover streams. Without one a
+// synthetic stream of the sentences abridge reads is used. Each capture is
+// pushed in chunks of the size given as the benchmark's argument, as read()
+// hands them over.
+
+#include "sentenceParser.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// Something for the handlers to do with the numbers, so neither parser's
+// conversions can be optimized away
+static float numberSum;
+
+// The fields abridge converts, see parseSentence() in abridge.cpp
+static void sumSentence(const Sentence& sentence) {
+    if (sentence.size() < 3 || !sentence.fieldIs(1, "1")) {
+        return;
+    }
+    for (int i = 2; i < sentence.size(); i++) {
+        numberSum += sentence.number(i);
+    }
+}
+
+// parseData() as it was, less the message fields it filled in
+static void legacyParseData(string str) {
+    istringstream oss(str);
+    string sentence;
+
+    while (getline(oss, sentence, '\n')) {
+        istringstream wss(sentence);
+        string word;
+
+        vector<string> dataSet;
+        while (getline(wss, word, ',')) {
+            dataSet.push_back(word);
+        }
+
+        if (dataSet.size() >= 3 && dataSet.at(1) == "1") {
+            for (size_t i = 2; i < dataSet.size(); i++) {
+                numberSum += atof(dataSet.at(i).c_str());
+            }
+        }
+    }
+}
+
+// About a second of the ASCII stream: the IMU and odometry at 10 Hz and the
+// sonar and gripper in between
+static string syntheticCapture() {
+    string capture;
+    char line[128];
+    for (int i = 0; i < 10; i++) {
+        snprintf(line, sizeof line, "IMU,1,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f\r\n",
+                 0.012 * i, -0.004, 0.981, 0.001 * i, -0.002, 0.015, 0.01, -0.02, 0.1 * i);
+        capture += line;
+        snprintf(line, sizeof line, "ODOM,1,%.2f,%.2f,%.3f,%.2f,%.2f,%.3f\r\n",
+                 0.5 * i, 0.1, 0.05 * i, 20.0, 0.0, 0.12);
+        capture += line;
+        snprintf(line, sizeof line, "USL,1,%d\r\nUSC,1,%d\r\nUSR,1,%d\r\n", 300 - i, 120 + i, 280);
+        capture += line;
+        snprintf(line, sizeof line, "GRF,1,%.3f\r\nGRW,1,%.3f\r\n", 0.2, 1.1);
+        capture += line;
+    }
+    return capture;
+}
+
+static void BM_SentenceParser(benchmark::State& state, const string& capture) {
+    SentenceParser parser(sumSentence);
+    size_t chunk = state.range(0);
+    for (auto _ : state) {
+        for (size_t i = 0; i < capture.size(); i += chunk) {
+            parser.push(capture.data() + i, min(chunk, capture.size() - i));
+        }
+    }
+    benchmark::DoNotOptimize(numberSum);
+    state.SetBytesProcessed(state.iterations() * capture.size());
+}
+
+// Lines split across chunks are lost here, as they were
+static void BM_LegacyParseData(benchmark::State& state, const string& capture) {
+    size_t chunk = state.range(0);
+    for (auto _ : state) {
+        for (size_t i = 0; i < capture.size(); i += chunk) {
+            legacyParseData(capture.substr(i, chunk));
+        }
+    }
+    benchmark::DoNotOptimize(numberSum);
+    state.SetBytesProcessed(state.iterations() * capture.size());
+}
+
+static void registerCapture(const string& name, const string& capture) {
+    benchmark::RegisterBenchmark(("BM_SentenceParser/" + name).c_str(), BM_SentenceParser, capture)
+        ->Arg(16)->Arg(64)->Arg(1024);
+    benchmark::RegisterBenchmark(("BM_LegacyParseData/" + name).c_str(), BM_LegacyParseData, capture)
+        ->Arg(16)->Arg(64)->Arg(1024);
+}
+
+int main(int argc, char** argv) {
+    benchmark::Initialize(&argc, argv);
+
+    // Initialize() took the --benchmark flags, the rest are captures
+    int captures = 0;
+    for (int i = 1; i < argc; i++) {
+        ifstream file(argv[i], ios::binary);
+        if (!file) {
+            fprintf(stderr, "abridge_bench: cannot read capture %s\n", argv[i]);
+            return 1;
+        }
+        stringstream bytes;
+        bytes << file.rdbuf();
+
+        const char* name = strrchr(argv[i], '/');
+        registerCapture(name != NULL ? name + 1 : argv[i], bytes.str());
+        captures++;
+    }
+    if (captures == 0) {
+        registerCapture("synthetic", syntheticCapture());
+    }
+
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
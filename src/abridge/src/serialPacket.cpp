@@ -0,0 +1,88 @@
+#include "serialPacket.h"
+
+uint16_t packetCRC(const uint8_t* data, size_t length, uint16_t crc) {
+    for (size_t i = 0; i < length; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+        }
+    }
+    return crc;
+}
+
+SerialPacketDecoder::SerialPacketDecoder() {
+    crcErrorCount = 0;
+    reset();
+}
+
+void SerialPacketDecoder::reset() {
+    state = WAIT_SYNC0;
+    packetType = 0;
+    packetLength = 0;
+    payloadIndex = 0;
+    receivedCRC = 0;
+}
+
+bool SerialPacketDecoder::push(uint8_t byte) {
+    switch (state) {
+    case WAIT_SYNC0:
+        if (byte == PACKET_SYNC0) {
+            state = WAIT_SYNC1;
+        }
+        break;
+
+    case WAIT_SYNC1:
+        if (byte == PACKET_SYNC1) {
+            state = WAIT_TYPE;
+        }
+        else if (byte != PACKET_SYNC0) {
+            state = WAIT_SYNC0;
+        }
+        break;
+
+    case WAIT_TYPE:
+        packetType = byte;
+        state = WAIT_LENGTH;
+        break;
+
+    case WAIT_LENGTH:
+        if (byte > PACKET_MAX_PAYLOAD) {
+            // Cannot be a valid frame, look for the next sync pattern
+            reset();
+            break;
+        }
+        packetLength = byte;
+        payloadIndex = 0;
+        state = (packetLength > 0) ? WAIT_PAYLOAD : WAIT_CRC_LO;
+        break;
+
+    case WAIT_PAYLOAD:
+        packetPayload[payloadIndex++] = byte;
+        if (payloadIndex >= packetLength) {
+            state = WAIT_CRC_LO;
+        }
+        break;
+
+    case WAIT_CRC_LO:
+        receivedCRC = byte;
+        state = WAIT_CRC_HI;
+        break;
+
+    case WAIT_CRC_HI: {
+        receivedCRC |= (uint16_t)byte << 8;
+        state = WAIT_SYNC0;
+
+        uint8_t header[2] = {packetType, packetLength};
+        uint16_t crc = packetCRC(header, sizeof (header));
+        crc = packetCRC(packetPayload, packetLength, crc);
+
+        if (crc == receivedCRC) {
+            return true;
+        }
+        crcErrorCount++;
+        break;
+    }
+    }
+
+    return false;
+}
@@ -1,8 +1,10 @@
 #include "usbSerial.h"
 
+#include <errno.h>
+
 using namespace std;
 
-USBSerial::USBSerial() {
+USBSerial::USBSerial() : usbFileDescriptor(-1), reading(false) {
 
 }
 
@@ -14,15 +16,58 @@ void USBSerial::openUSBPort(string devicePath, int baud) {
     ioStruct.c_lflag = 0;
     ioStruct.c_cc[VMIN] = 1;
     ioStruct.c_cc[VTIME] = 5;
+    cfsetospeed(&ioStruct, B115200);
+    cfsetispeed(&ioStruct, B115200);
 
-    usbFileDescriptor = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
-    if (usbFileDescriptor <= 0) {
+    this->devicePath = devicePath;
+    usbFileDescriptor = openDevice();
+    if (usbFileDescriptor < 0) {
         cout << "Opening USB0 FAILED " << usbFileDescriptor << endl;
         exit(1);
     }
-    cfsetospeed(&ioStruct, B115200);
-    cfsetispeed(&ioStruct, B115200);
-    tcsetattr(usbFileDescriptor, TCSANOW, &ioStruct);
+}
+
+// Opens and configures the device, -1 on failure
+int USBSerial::openDevice() {
+    int fd = open(devicePath.c_str(), O_RDWR | O_NONBLOCK);
+    if (fd < 0) {
+        return -1;
+    }
+    tcsetattr(fd, TCSANOW, &ioStruct);
+    return fd;
+}
+
+// Closes the port and tries to open it again until it succeeds or the
+// reader is stopped
+bool USBSerial::reopenUSBPort() {
+    int fd = usbFileDescriptor.exchange(-1);
+    if (fd >= 0) {
+        close(fd);
+    }
+    cout << "Lost " << devicePath << ", reopening" << endl;
+
+    int delay = minReopenDelay;
+    while (reading) {
+        // Sleep in short steps so stopReader() does not wait for the delay
+        for (int slept = 0; slept < delay && reading; slept += minReopenDelay) {
+            usleep(minReopenDelay * 1000);
+        }
+        if (!reading) {
+            break;
+        }
+
+        fd = openDevice();
+        if (fd >= 0) {
+            usbFileDescriptor = fd;
+            cout << "Reopened " << devicePath << endl;
+            if (reopenHandler) {
+                reopenHandler();
+            }
+            return true;
+        }
+        delay = min(2 * delay, (int)maxReopenDelay);
+    }
+    return false;
 }
 
 void USBSerial::sendData(char data[]) {
@@ -31,21 +76,81 @@ void USBSerial::sendData(char data[]) {
     memset(&dataOut, '\0', sizeof (dataOut));
 }
 
-string USBSerial::readData() {
-    if (read(usbFileDescriptor, &serialDataIn, sizeof (serialDataIn)) > 0) {
-        read(usbFileDescriptor, &serialDataIn, sizeof (serialDataIn));
+// Reads up to length raw bytes without flushing the port. Only meant for
+// use before the reader thread is started.
+int USBSerial::readBytes(unsigned char buffer[], int length) {
+    int count = read(usbFileDescriptor, buffer, length);
+    return count > 0 ? count : 0;
+}
+
+void USBSerial::startReader(DataHandler handler) {
+    if (reading) {
+        return;
+    }
+    dataHandler = handler;
+    reading = true;
+    readerThread = std::thread(&USBSerial::readerLoop, this);
+}
+
+void USBSerial::stopReader() {
+    reading = false;
+    if (readerThread.joinable()) {
+        readerThread.join();
+    }
+}
+
+void USBSerial::readerLoop() {
+    struct pollfd usbPoll;
+    usbPoll.fd = usbFileDescriptor;
+    usbPoll.events = POLLIN;
+
+    while (reading) {
+        // Wake up periodically so stopReader() does not block forever
+        int ready = poll(&usbPoll, 1, 100);
+        if (ready <= 0) {
+            continue;
+        }
+
+        // An unplugged adapter reports these without POLLIN, and keeps
+        // reporting them at once on every poll
+        if (!(usbPoll.revents & POLLIN) && (usbPoll.revents & (POLLERR | POLLHUP | POLLNVAL))) {
+            if (!reopenUSBPort()) {
+                break;
+            }
+            usbPoll.fd = usbFileDescriptor;
+            continue;
+        }
+        if (!(usbPoll.revents & POLLIN)) {
+            continue;
+        }
+
+        // Drain everything the driver has buffered before polling again
+        int count;
+        while ((count = read(usbFileDescriptor, readBuffer, sizeof (readBuffer))) > 0) {
+            dataHandler(readBuffer, count);
+        }
+
+        // A hung up tty can report POLLIN with nothing to read: read()
+        // returns 0, or fails with something other than "no data yet", and
+        // the next poll returns at once again
+        if (count == 0 || (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)) {
+            if (!reopenUSBPort()) {
+                break;
+            }
+            usbPoll.fd = usbFileDescriptor;
+        }
     }
-    string str(serialDataIn);
-    tcflush(usbFileDescriptor, TCIOFLUSH);
-    memset(&serialDataIn, '\0', sizeof (serialDataIn));
-    return str;
 }
 
 void USBSerial::closeUSBPort() {
-    close(usbFileDescriptor);
+    int fd = usbFileDescriptor.exchange(-1);
+    if (fd >= 0) {
+        close(fd);
+    }
 }
 
 USBSerial::~USBSerial() {
+    stopReader();
     closeUSBPort();
 }
 
@@ -0,0 +1,93 @@
+#!/usr/bin/env python
+"""Decode a flight record written by FlightRecorder (src/FlightRecorder.h).
+
+usage: decode_flight_record.py RECORD_FILE [--last N]
+
+Reads the ring file of a running or crashed behaviour node, or a dump of
+it, and prints one line per behaviour tick, oldest first: seconds before
+the newest tick, the states, the controller that had the tick, pose, sonar,
+tags and the Result. The tables below must match the enums in
+FlightRecorder.h, LogicController.h and Result.h.
+"""
+
+import argparse
+import struct
+import sys
+
+PROCESS_STATES = ['searching', 'pickedup', 'dropoff', 'last', 'manual']
+
+LOGIC_STATES = ['interrupt', 'waiting', 'precision']
+
+CONTROLLERS = ['none', 'search', 'obstacle', 'pickup', 'range', 'dropoff', 'waypoint', 'drive']
+
+RESULT_TYPES = ['behavior', 'waypoint', 'precision']
+
+TRIGGERS = ['wait', 'prev', 'nochange', 'next']
+
+HEADER = struct.Struct('<4sHHIIQ')
+RECORD = struct.Struct('<q11f3Hh3f6B4fI')
+
+
+def name(table, index):
+    return table[index] if index < len(table) else str(index)
+
+
+def decode(record_file, last):
+    header = record_file.read(HEADER.size)
+    if len(header) != HEADER.size:
+        sys.exit('flight record is empty')
+    magic, version, record_size, capacity, reserved, written = HEADER.unpack(header)
+    if magic != b'SWFR':
+        sys.exit('not a flight record')
+    if version != 1 or record_size != RECORD.size:
+        sys.exit('unsupported flight record version %d (record size %d)' % (version, record_size))
+
+    slots = []
+    for _ in range(capacity):
+        data = record_file.read(RECORD.size)
+        if len(data) < RECORD.size:
+            break
+        slots.append(RECORD.unpack(data))
+
+    # Record n is in slot n % capacity. Slots whose sequence number is not
+    # the one expected were being written when the node stopped.
+    count = min(written, capacity)
+    if last:
+        count = min(count, last)
+    records = []
+    for number in range(written - count, written):
+        slot = number % capacity
+        if slot < len(slots) and slots[slot][-1] == number & 0xffffffff:
+            records.append(slots[slot])
+    if not records:
+        return
+
+    newest = records[-1][0]
+    for (time, x, y, theta, map_x, map_y, map_theta, linear, angular,
+         sonar_left, sonar_center, sonar_right,
+         tags, targets, centers, closest_target, closest_range, centers_distance, centers_bearing,
+         process_state, logic_state, controller, work_mask, result_type, trigger,
+         left, right, finger, wrist, sequence) in records:
+        result = name(RESULT_TYPES, result_type)
+        if result_type == 0:
+            result += ' ' + name(TRIGGERS, trigger)
+        print('%9.1f %-9s %-9s %-8s work=%02x odom=%.2f,%.2f,%.2f map=%.2f,%.2f,%.2f v=%.2f,%.2f '
+              'sonar=%.2f,%.2f,%.2f tags=%d targets=%d centers=%d closest=%d@%.2f '
+              '%s left=%.1f right=%.1f finger=%.2f wrist=%.2f'
+              % ((time - newest) / 1e3, name(PROCESS_STATES, process_state), name(LOGIC_STATES, logic_state),
+                 name(CONTROLLERS, controller), work_mask, x, y, theta, map_x, map_y, map_theta, linear, angular,
+                 sonar_left, sonar_center, sonar_right, tags, targets, centers, closest_target, closest_range,
+                 result, left, right, finger, wrist))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a behaviour flight record.')
+    parser.add_argument('record_file')
+    parser.add_argument('--last', type=int, default=0, help='only print the newest N ticks')
+    args = parser.parse_args()
+    with open(args.record_file, 'rb') as record_file:
+        decode(record_file, args.last)
+
+
+if __name__ == '__main__':
+    main()
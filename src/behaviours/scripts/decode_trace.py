@@ -0,0 +1,83 @@
+#!/usr/bin/env python
+"""Decode a behaviour trace file written by TraceLog (src/TraceLog.h).
+
+usage: decode_trace.py TRACE_FILE [--source NAME ...]
+
+Prints one line per record: seconds since the first record, source, event
+and the event's arguments. The tables below must match the TraceSource and
+TraceEvent enums in TraceLog.h.
+"""
+
+import argparse
+import struct
+import sys
+
+SOURCES = ['adapter', 'logic', 'search', 'obstacle', 'pickup', 'dropoff', 'range', 'drive']
+
+LEVELS = ['off', 'info', 'debug']
+
+# event id: (name, format of the used arguments)
+EVENTS = [
+    ('tick', 'result={arg} left={v0:.1f} right={v1:.1f}'),
+    ('tags_received', 'count={arg}'),
+    ('logic_reset', ''),
+    ('search_set_tags', 'count={arg}'),
+    ('pickup_reset_interrupt_free', ''),
+    ('pickup_block_yaw_error', 'target={arg} yaw_error={v0:.4f}'),
+    ('range_do_work', 'x={v0:.2f} y={v1:.2f}'),
+    ('range_interrupt', ''),
+    ('range_has_work', 'x={v0:.2f} y={v1:.2f}'),
+]
+
+HEADER = struct.Struct('<4sHH')
+RECORD = struct.Struct('<QBBHi4f')
+
+
+def decode(trace, sources):
+    header = trace.read(HEADER.size)
+    if len(header) != HEADER.size:
+        sys.exit('trace file is empty')
+    magic, version, record_size = HEADER.unpack(header)
+    if magic != b'SWTR':
+        sys.exit('not a behaviour trace file')
+    if version != 1 or record_size != RECORD.size:
+        sys.exit('unsupported trace version %d (record size %d)' % (version, record_size))
+
+    records = []
+    while True:
+        data = trace.read(RECORD.size)
+        if len(data) < RECORD.size:
+            break
+        records.append(RECORD.unpack(data))
+    if not records:
+        return
+
+    # Each producing thread is drained in batches, restore time order.
+    records.sort(key=lambda record: record[0])
+    start = records[0][0]
+
+    for time, source, level, event, arg, v0, v1, v2, v3 in records:
+        source_name = SOURCES[source] if source < len(SOURCES) else 'source%d' % source
+        if sources and source_name not in sources:
+            continue
+        if event < len(EVENTS):
+            name, fmt = EVENTS[event]
+        else:
+            name, fmt = 'event%d' % event, 'arg={arg} values={v0} {v1} {v2} {v3}'
+        level_name = LEVELS[level] if level < len(LEVELS) else str(level)
+        print('%12.6f %-8s %-5s %s %s' % ((time - start) / 1e9, source_name, level_name, name,
+                                          fmt.format(arg=arg, v0=v0, v1=v1, v2=v2, v3=v3)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description='Decode a behaviour trace file.')
+    parser.add_argument('trace_file')
+    parser.add_argument('--source', action='append', choices=SOURCES,
+                        help='only print records from this source, may be repeated')
+    args = parser.parse_args()
+    with open(args.trace_file, 'rb') as trace:
+        decode(trace, args.source)
+
+
+if __name__ == '__main__':
+    main()
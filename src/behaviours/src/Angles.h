@@ -0,0 +1,23 @@
+#ifndef ANGLES_H
+#define ANGLES_H
+
+#include <cmath>
+
+// The two functions the controllers used from the ROS angles package, so
+// behaviours_core builds without ROS. Same results as angles::.
+
+// An angle in radians, wrapped to [-pi, pi]
+inline double NormalizeAngle(double angle)
+{
+  double positive = fmod(fmod(angle, 2.0 * M_PI) + 2.0 * M_PI, 2.0 * M_PI);
+  if (positive > M_PI) positive -= 2.0 * M_PI;
+  return positive;
+}
+
+// The signed turn in radians from one heading to another, the short way
+inline double ShortestAngularDistance(double from, double to)
+{
+  return NormalizeAngle(to - from);
+}
+
+#endif // ANGLES_H
@@ -0,0 +1,286 @@
+// behaviours_bench: microbenchmarks of the behaviour hot path, built from
+// behaviours_core only so the numbers do not depend on ROS.
+//
+// usage: behaviours_bench [--benchmark_filter=<regex>] [--benchmark_format=json]
+//
+// Run it on the same machine before and after a change to compare them.
+
+#include "LogicController.h"
+#include "PID.h"
+#include "RangeController.h"
+#include "Tag.h"
+
+#include <benchmark/benchmark.h>
+
+#include <cmath>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+static PIDConfig BenchPIDConfig()
+{
+  PIDConfig config;
+  config.Kp = 140;
+  config.Ki = 10;
+  config.Kd = 120;
+  config.feedForwardMultiplier = 610;
+  config.alwaysIntegral = true;
+  return config;
+}
+
+// A cluster of cubes in front of the camera, every other one a nest tag
+static vector<Tag> BenchTags(int count)
+{
+  vector<Tag> tags(count);
+  for (int i = 0; i < count; i++)
+  {
+    float angle = i * 0.3f;
+    tags[i].setID(i % 2 == 0 ? 0 : 256);
+    tags[i].setPosition(0.1f * cos(angle), -0.02f + 0.01f * (i % 5), 0.25f + 0.02f * i);
+    tags[i].setOrientation(0.1f * sin(angle), 0.7f, 0.05f, 0.7f);
+  }
+  return tags;
+}
+
+// A searching rover at the side of the collection zone
+static void SetUpLogicController(LogicController& logicController)
+{
+  Point center = {0, 0, 0};
+  logicController.SetCenterLocationOdom(center);
+  logicController.SetCenterLocationMap(center);
+
+  PoseSample sample;
+  sample.pose.x = 2;
+  sample.pose.y = 1;
+  sample.pose.theta = 0.5;
+  sample.linearVelocity = 0.2;
+  sample.angularVelocity = 0;
+  logicController.SetPositionData(sample);
+  logicController.SetMapPositionData(sample);
+
+  logicController.SetSonarData(3, 3, 3);
+  logicController.SetCurrentTimeInMilliSecs(1000);
+  logicController.SetModeAuto();
+}
+
+static void BM_PIDOut(benchmark::State& state)
+{
+  PID pid(BenchPIDConfig());
+  float error = 0.5;
+  for (auto _ : state)
+  {
+    error = -error * 0.99f + 0.01f;
+    benchmark::DoNotOptimize(pid.PIDOut(error, 0.3, 0.1));
+  }
+}
+BENCHMARK(BM_PIDOut);
+
+static void BM_VelocityPIDOut(benchmark::State& state)
+{
+  VelocityPID pid(BenchPIDConfig());
+  float error = 0.5;
+  for (auto _ : state)
+  {
+    error = -error * 0.99f + 0.01f;
+    benchmark::DoNotOptimize(pid.PIDOut(error, 0.3, 0.1));
+  }
+}
+BENCHMARK(BM_VelocityPIDOut);
+
+// A setpoint change every call, so every call also resets the histories
+static void BM_PIDOutSetpointChange(benchmark::State& state)
+{
+  PID pid(BenchPIDConfig());
+  float error = 0.5;
+  float setPoint = 0.3;
+  for (auto _ : state)
+  {
+    error = -error * 0.99f + 0.01f;
+    setPoint = -setPoint;
+    benchmark::DoNotOptimize(pid.PIDOut(error, setPoint, 0.1));
+  }
+}
+BENCHMARK(BM_PIDOutSetpointChange);
+
+// The error and integral history as PIDOut() kept them before they became
+// rings: the newest error inserted at the front of a vector, the integral
+// window re-zeroed on a setpoint change and summed in full every call. Only
+// the history is kept, so the difference to BM_PIDOut and
+// BM_PIDOutSetpointChange is what the rings saved.
+class VectorPIDHistory
+{
+public:
+  VectorPIDHistory(const PIDConfig& config) : config(config)
+  {
+    integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+  }
+
+  float Update(float error, float setPoint, float dt)
+  {
+    if ((int)Error.size() >= config.errorHistLength)
+    {
+      Error.pop_back();
+    }
+    Error.insert(Error.begin(), error);
+
+    if (setPoint != prevSetPoint && config.resetOnSetpoint)
+    {
+      Error.clear();
+      integralErrorHistArray.clear();
+      prevSetPoint = setPoint;
+      step = 0;
+      integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+      Error.push_back(error);
+    }
+
+    integralErrorHistArray[step] = Error.front() * dt;
+    step++;
+    if (step >= config.integralErrorHistoryLength) step = 0;
+
+    float sum = 0;
+    for (size_t i = 0; i < integralErrorHistArray.size(); i++)
+    {
+      sum += integralErrorHistArray[i];
+    }
+    return sum + Error.back();
+  }
+
+private:
+  PIDConfig config;
+  vector<float> Error;
+  vector<float> integralErrorHistArray;
+  float prevSetPoint = 0;
+  int step = 0;
+};
+
+static void BM_VectorPIDHistory(benchmark::State& state)
+{
+  VectorPIDHistory history(BenchPIDConfig());
+  float error = 0.5;
+  float setPoint = 0.3;
+  for (auto _ : state)
+  {
+    error = -error * 0.99f + 0.01f;
+    if (state.range(0)) setPoint = -setPoint;
+    benchmark::DoNotOptimize(history.Update(error, setPoint, 0.1));
+  }
+}
+// 0 keeps the setpoint, 1 changes it every call
+BENCHMARK(BM_VectorPIDHistory)->Arg(0)->Arg(1);
+
+// One behaviour tick with the sensors changing every tick, as they do on the
+// rover. The argument is the number of tags in view.
+static void BM_DoWork(benchmark::State& state)
+{
+  LogicController logicController;
+  SetUpLogicController(logicController);
+
+  vector<Tag> tags = BenchTags(state.range(0));
+  long time = 1000;
+  PoseSample sample;
+  sample.pose.x = 2;
+  sample.pose.y = 1;
+  sample.pose.theta = 0.5;
+  sample.linearVelocity = 0.2;
+  sample.angularVelocity = 0.1;
+
+  for (auto _ : state)
+  {
+    time += 100;
+    sample.pose.x += 0.01f * cos(sample.pose.theta);
+    sample.pose.y += 0.01f * sin(sample.pose.theta);
+    sample.pose.theta += 0.01f;
+
+    logicController.SetCurrentTimeInMilliSecs(time);
+    logicController.SetPositionData(sample);
+    logicController.SetMapPositionData(sample);
+    logicController.SetSonarData(3, 2.5f + 0.1f * sin(time * 0.001f), 3);
+    if (!tags.empty()) logicController.SetAprilTags(tags);
+
+    benchmark::DoNotOptimize(logicController.DoWork());
+  }
+}
+BENCHMARK(BM_DoWork)->Arg(0)->Arg(4)->Arg(16);
+
+static void BM_SetAprilTags(benchmark::State& state)
+{
+  LogicController logicController;
+  SetUpLogicController(logicController);
+
+  vector<Tag> tags = BenchTags(state.range(0));
+  for (auto _ : state)
+  {
+    logicController.SetAprilTags(tags);
+  }
+  state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_SetAprilTags)->Arg(1)->Arg(8)->Arg(32);
+
+// Points on a spiral out past the fence, so both answers come up
+static vector<Point> FencePoints()
+{
+  vector<Point> points(256);
+  for (size_t i = 0; i < points.size(); i++)
+  {
+    float angle = i * 0.37f;
+    float radius = 0.05f * i;
+    points[i].x = radius * cos(angle);
+    points[i].y = radius * sin(angle);
+    points[i].theta = 0;
+  }
+  return points;
+}
+
+static void FenceCheck(benchmark::State& state, const RangeShape& fence)
+{
+  vector<Point> points = FencePoints();
+  size_t i = 0;
+  for (auto _ : state)
+  {
+    benchmark::DoNotOptimize(fence.isInside(points[i]));
+    i = (i + 1) % points.size();
+  }
+}
+
+static void BM_FenceCircle(benchmark::State& state)
+{
+  Point center = {0, 0, 0};
+  FenceCheck(state, RangeCircle(center, 6));
+}
+BENCHMARK(BM_FenceCircle);
+
+static void BM_FenceRectangle(benchmark::State& state)
+{
+  Point center = {0, 0, 0};
+  FenceCheck(state, RangeRectangle(center, 12, 8));
+}
+BENCHMARK(BM_FenceRectangle);
+
+static void BM_FencePolygon(benchmark::State& state)
+{
+  vector<Point> vertices(state.range(0));
+  for (size_t i = 0; i < vertices.size(); i++)
+  {
+    float angle = 2 * M_PI * i / vertices.size();
+    float radius = i % 2 == 0 ? 7 : 5;
+    vertices[i].x = radius * cos(angle);
+    vertices[i].y = radius * sin(angle);
+    vertices[i].theta = 0;
+  }
+  FenceCheck(state, RangePolygon(vertices));
+}
+BENCHMARK(BM_FencePolygon)->Arg(4)->Arg(16)->Arg(64);
+
+static void BM_FenceMultiRegion(benchmark::State& state)
+{
+  Point left = {-4, 0, 0};
+  Point right = {4, 0, 0};
+  vector< shared_ptr<const RangeShape> > regions;
+  regions.push_back(make_shared<RangeCircle>(left, 4));
+  regions.push_back(make_shared<RangeRectangle>(right, 6, 6));
+  FenceCheck(state, RangeMultiRegion(regions));
+}
+BENCHMARK(BM_FenceMultiRegion);
+
+BENCHMARK_MAIN();
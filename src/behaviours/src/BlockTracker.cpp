@@ -0,0 +1,131 @@
+#include "BlockTracker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+void BlockTracker::Axis::Init(float measured, float variance)
+{
+  position = measured;
+  velocity = 0;
+  p00 = variance;
+  p01 = 0;
+  p11 = 0.1 * 0.1;
+}
+
+void BlockTracker::Axis::Predict(float dt, float accelerationVariance)
+{
+  position += velocity * dt;
+
+  // P = F P F' + Q for F = [1 dt; 0 1] and white acceleration noise
+  float dt2 = dt * dt;
+  p00 += 2 * dt * p01 + dt2 * p11 + accelerationVariance * dt2 * dt2 / 4;
+  p01 += dt * p11 + accelerationVariance * dt2 * dt / 2;
+  p11 += accelerationVariance * dt2;
+}
+
+void BlockTracker::Axis::Update(float measured, float variance)
+{
+  float innovation = measured - position;
+  float s = p00 + variance;
+  float k0 = p00 / s;
+  float k1 = p01 / s;
+
+  position += k0 * innovation;
+  velocity += k1 * innovation;
+
+  float q00 = p00, q01 = p01;
+  p00 -= k0 * q00;
+  p01 -= k0 * q01;
+  p11 -= k1 * q01;
+}
+
+BlockTracker::BlockTracker(float gate, long maxAge, int maxTracks)
+{
+  this->gate = gate;
+  this->maxAge = maxAge;
+  this->maxTracks = maxTracks;
+}
+
+Point BlockTracker::Predicted(const Track& track, long time) const
+{
+  float dt = max(0l, time - track.updated) / 1e3;
+
+  // A fast track is a bad velocity estimate, not a rolling cube
+  float speed = hypot(track.x.velocity, track.y.velocity);
+  float scale = speed > maxPredictSpeed ? maxPredictSpeed / speed : 1;
+
+  Point predicted;
+  predicted.x = track.x.PredictedPosition(dt * scale);
+  predicted.y = track.y.PredictedPosition(dt * scale);
+  predicted.theta = 0;
+  return predicted;
+}
+
+void BlockTracker::Expire(long time)
+{
+  tracks.erase(remove_if(tracks.begin(), tracks.end(), [&](const Track& track) {
+    // Also drop tracks from before a clock reset
+    return time - track.updated > maxAge || time < track.updated;
+  }), tracks.end());
+}
+
+void BlockTracker::AddSighting(Point position, long time)
+{
+  Track* nearest = nullptr;
+  float nearestDistance = gate;
+  for (Track& track : tracks)
+  {
+    Point predicted = Predicted(track, time);
+    float distance = hypot(predicted.x - position.x, predicted.y - position.y);
+    if (distance <= nearestDistance)
+    {
+      nearest = &track;
+      nearestDistance = distance;
+    }
+  }
+
+  if (nearest != nullptr)
+  {
+    float dt = max(0l, time - nearest->updated) / 1e3;
+    nearest->x.Predict(dt, accelerationVariance);
+    nearest->y.Predict(dt, accelerationVariance);
+    nearest->x.Update(position.x, measurementVariance);
+    nearest->y.Update(position.y, measurementVariance);
+    nearest->updated = time;
+    return;
+  }
+
+  if ((int)tracks.size() >= maxTracks)
+  {
+    // Make room by dropping the track seen longest ago
+    tracks.erase(min_element(tracks.begin(), tracks.end(), [](const Track& a, const Track& b) {
+      return a.updated < b.updated;
+    }));
+  }
+
+  Track track;
+  track.x.Init(position.x, measurementVariance);
+  track.y.Init(position.y, measurementVariance);
+  track.updated = time;
+  tracks.push_back(track);
+}
+
+bool BlockTracker::PredictNearest(Point location, long time, Point& predicted) const
+{
+  float nearestDistance = numeric_limits<float>::max();
+  for (const Track& track : tracks)
+  {
+    Point candidate = Predicted(track, time);
+    float distance = hypot(candidate.x - location.x, candidate.y - location.y);
+    if (distance < nearestDistance)
+    {
+      predicted = candidate;
+      nearestDistance = distance;
+    }
+  }
+
+  return !tracks.empty();
+}
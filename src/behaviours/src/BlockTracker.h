@@ -0,0 +1,65 @@
+#ifndef BLOCKTRACKER_H
+#define BLOCKTRACKER_H
+
+#include <vector>
+
+#include "Point.h"
+
+// Follows the cubes the camera sees so the pickup can steer on a prediction
+// between camera frames. Each candidate cube has a constant velocity Kalman
+// filter per axis in the odometry frame; a cube sitting still only moves
+// there through odometry error, which the velocity soaks up.
+//
+// Sightings within gate meters of a track's prediction update it, the
+// others start new tracks. Tracks not seen for maxAge ms are dropped and at
+// most maxTracks are kept.
+class BlockTracker
+{
+public:
+  BlockTracker(float gate = 0.15, long maxAge = 1000, int maxTracks = 8);
+
+  // A cube seen at position at time ms
+  void AddSighting(Point position, long time);
+
+  // Drops old tracks. Call once per frame before adding its sightings.
+  void Expire(long time);
+
+  // The predicted position of the track nearest to location. Returns false
+  // if there are no tracks.
+  bool PredictNearest(Point location, long time, Point& predicted) const;
+
+  void Clear() { tracks.clear(); }
+
+private:
+  // Position and velocity along one axis
+  struct Axis {
+    float position;
+    float velocity;
+    float p00, p01, p11; // covariance
+
+    void Init(float measured, float variance);
+    void Predict(float dt, float accelerationVariance);
+    void Update(float measured, float variance);
+    float PredictedPosition(float dt) const { return position + velocity * dt; }
+  };
+
+  struct Track {
+    Axis x;
+    Axis y;
+    long updated;
+  };
+
+  Point Predicted(const Track& track, long time) const;
+
+  const float measurementVariance = 0.02 * 0.02; // meters squared
+  const float accelerationVariance = 0.05 * 0.05; // (meters per second squared) squared
+  const float maxPredictSpeed = 0.5; // meters per second, faster tracks are noise
+
+  float gate;
+  long maxAge;
+  int maxTracks;
+
+  std::vector<Track> tracks;
+};
+
+#endif // BLOCKTRACKER_H
@@ -0,0 +1,70 @@
+#include "CenterEstimator.h"
+
+#include <cmath>
+
+CenterEstimator::CenterEstimator(float priorError, float sightingError, float driftRate, long maxAge)
+{
+  this->priorError = priorError;
+  this->sightingError = sightingError;
+  this->driftRate = driftRate;
+  this->maxAge = maxAge;
+}
+
+void CenterEstimator::SetCurrentLocation(Point location)
+{
+  if (hasLocation)
+  {
+    distanceDriven += hypot(location.x - lastLocation.x, location.y - lastLocation.y);
+  }
+  lastLocation = location;
+  hasLocation = true;
+}
+
+void CenterEstimator::AddSighting(Point center, long time)
+{
+  sighting = center;
+  sightingTime = time;
+  sightingDistance = distanceDriven;
+  hasSighting = true;
+}
+
+bool CenterEstimator::HasSighting(long time) const
+{
+  // Also ignore sightings from before a clock reset
+  return hasSighting && time >= sightingTime && time - sightingTime <= maxAge;
+}
+
+float CenterEstimator::SightingError() const
+{
+  return sightingError + driftRate * (distanceDriven - sightingDistance);
+}
+
+Point CenterEstimator::Estimate(long time) const
+{
+  if (!HasSighting(time)) return prior;
+
+  // Inverse variance weighting
+  float priorWeight = 1 / (priorError * priorError);
+  float error = SightingError();
+  float sightingWeight = 1 / (error * error);
+  float total = priorWeight + sightingWeight;
+
+  Point estimate;
+  estimate.x = (prior.x * priorWeight + sighting.x * sightingWeight) / total;
+  estimate.y = (prior.y * priorWeight + sighting.y * sightingWeight) / total;
+  estimate.theta = prior.theta;
+  return estimate;
+}
+
+float CenterEstimator::Error(long time) const
+{
+  if (!HasSighting(time)) return priorError;
+
+  float error = SightingError();
+  return 1 / sqrt(1 / (priorError * priorError) + 1 / (error * error));
+}
+
+void CenterEstimator::Clear()
+{
+  hasSighting = false;
+}
@@ -0,0 +1,54 @@
+#ifndef CENTERESTIMATOR_H
+#define CENTERESTIMATOR_H
+
+#include "Point.h"
+
+// Where the rover should drive to find the collection zone, in the odometry
+// frame. The center location the rover was given is only as good as the
+// GPS fused map frame, so the last confident sighting of the collection
+// zone tags is kept as well and the two are averaged, weighted by how far
+// each can be off.
+//
+// A sighting is trusted to sightingError meters when it is made. Odometry
+// drifts with the distance driven, so it then loses driftRate meters per
+// meter the rover drives. Sightings older than maxAge ms are dropped.
+class CenterEstimator
+{
+public:
+  CenterEstimator(float priorError = 1.0, float sightingError = 0.3, float driftRate = 0.05, long maxAge = 300000);
+
+  void SetPrior(Point center) { prior = center; }
+  void SetCurrentLocation(Point location);
+
+  // center is where the tags put the collection zone
+  void AddSighting(Point center, long time);
+
+  Point Estimate(long time) const;
+
+  // How far off the estimate may be, in meters
+  float Error(long time) const;
+
+  bool HasSighting(long time) const;
+  void Clear();
+
+private:
+  float SightingError() const;
+
+  float priorError;
+  float sightingError;
+  float driftRate;
+  long maxAge;
+
+  Point prior = {0, 0, 0};
+
+  Point lastLocation = {0, 0, 0};
+  bool hasLocation = false;
+  float distanceDriven = 0; // meters since the start
+
+  bool hasSighting = false;
+  Point sighting = {0, 0, 0};
+  long sightingTime = 0;
+  float sightingDistance = 0; // distanceDriven when the sighting was made
+};
+
+#endif // CENTERESTIMATOR_H
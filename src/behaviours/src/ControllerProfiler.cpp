@@ -0,0 +1,136 @@
+#include "ControllerProfiler.h"
+
+#include <sstream>
+
+using namespace std;
+
+void ControllerProfiler::Register(const Controller* controller, const string& name)
+{
+  if (numEntries >= MAX_CONTROLLERS)
+  {
+    return;
+  }
+
+  entries[numEntries].controller = controller;
+  entries[numEntries].name = name;
+  numEntries++;
+}
+
+void ControllerProfiler::Record(const Controller* controller, CallType type, long long nanoseconds)
+{
+  for (int i = 0; i < numEntries; i++)
+  {
+    if (entries[i].controller == controller)
+    {
+      entries[i].calls[type].Add(nanoseconds);
+      return;
+    }
+  }
+}
+
+string ControllerProfiler::Summary() const
+{
+  static const char* callNames[NUM_CALL_TYPES] = {"si", "hw", "dw"};
+
+  stringstream ss;
+  ss << fixed;
+  ss.precision(2);
+  for (int i = 0; i < numEntries; i++)
+  {
+    bool named = false;
+    for (int type = 0; type < NUM_CALL_TYPES; type++)
+    {
+      const Histogram& calls = entries[i].calls[type];
+      if (calls.count == 0)
+      {
+        continue;
+      }
+
+      if (!named)
+      {
+        ss << entries[i].name;
+        named = true;
+      }
+      ss << " " << callNames[type]
+         << " n=" << calls.count
+         << " p50=" << calls.Percentile(0.5) / 1e3 << "us"
+         << " p99=" << calls.Percentile(0.99) / 1e3 << "us"
+         << " max=" << calls.max / 1e3 << "us";
+    }
+    if (named)
+    {
+      ss << "\n";
+    }
+  }
+  return ss.str();
+}
+
+void ControllerProfiler::Reset()
+{
+  for (int i = 0; i < numEntries; i++)
+  {
+    for (int type = 0; type < NUM_CALL_TYPES; type++)
+    {
+      entries[i].calls[type] = Histogram();
+    }
+  }
+}
+
+// Values below 4 ns get a bucket each, above that every power of two is
+// split into BUCKETS_PER_OCTAVE equal parts.
+int ControllerProfiler::Bucket(long long nanoseconds)
+{
+  if (nanoseconds < 4)
+  {
+    return nanoseconds < 0 ? 0 : (int)nanoseconds;
+  }
+
+  int octave = 63 - __builtin_clzll((unsigned long long)nanoseconds);
+  int sub = (nanoseconds >> (octave - 2)) & (BUCKETS_PER_OCTAVE - 1);
+  int bucket = octave * BUCKETS_PER_OCTAVE + sub;
+  return bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS - 1;
+}
+
+long long ControllerProfiler::BucketUpperBound(int bucket)
+{
+  if (bucket < 4)
+  {
+    return bucket + 1;
+  }
+
+  int octave = bucket / BUCKETS_PER_OCTAVE;
+  int sub = bucket % BUCKETS_PER_OCTAVE;
+  return (long long)(BUCKETS_PER_OCTAVE + sub + 1) << (octave - 2);
+}
+
+void ControllerProfiler::Histogram::Add(long long nanoseconds)
+{
+  buckets[Bucket(nanoseconds)]++;
+  count++;
+  if (nanoseconds > max)
+  {
+    max = nanoseconds;
+  }
+}
+
+long long ControllerProfiler::Histogram::Percentile(double fraction) const
+{
+  unsigned long rank = (unsigned long)(fraction * count);
+  if (rank >= count)
+  {
+    rank = count - 1;
+  }
+
+  unsigned long seen = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++)
+  {
+    seen += buckets[i];
+    if (seen > rank)
+    {
+      // the bucket bound can overshoot the largest value actually seen
+      long long bound = BucketUpperBound(i);
+      return bound < max ? bound : max;
+    }
+  }
+  return max;
+}
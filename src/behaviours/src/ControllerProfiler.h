@@ -0,0 +1,91 @@
+#ifndef CONTROLLERPROFILER_H
+#define CONTROLLERPROFILER_H
+
+#include "Controller.h"
+
+#include <chrono>
+#include <string>
+
+// Times the Controller calls LogicController makes each tick and keeps a
+// latency histogram per controller and call type. Histograms use four
+// buckets per power of two nanoseconds, so percentiles are reported with
+// about 20% resolution and recording never allocates.
+//
+// A profiler is only touched from the thread that runs
+// LogicController::DoWork() and the summary is built on that same thread,
+// so recording needs neither locks nor atomics.
+class ControllerProfiler
+{
+public:
+
+  enum CallType {
+    SHOULD_INTERRUPT = 0,
+    HAS_WORK,
+    DO_WORK,
+    NUM_CALL_TYPES
+  };
+
+  static const int MAX_CONTROLLERS = 8;
+
+  // Controllers must be registered before their calls are profiled, calls
+  // for unregistered controllers are ignored.
+  void Register(const Controller* controller, const std::string& name);
+
+  void Record(const Controller* controller, CallType type, long long nanoseconds);
+
+  // One line per controller with calls since the last Reset(), e.g.
+  // "pickup dw n=50 p50=12us p99=40us max=95us hw ..."
+  std::string Summary() const;
+  void Reset();
+
+  // Times a single call for as long as it is in scope.
+  class Scope
+  {
+  public:
+    Scope(ControllerProfiler& profiler, const Controller* controller, CallType type) :
+      profiler(profiler), controller(controller), type(type),
+      start(std::chrono::steady_clock::now())
+    {
+    }
+
+    ~Scope()
+    {
+      std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start;
+      profiler.Record(controller, type, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+    }
+
+  private:
+    ControllerProfiler& profiler;
+    const Controller* controller;
+    CallType type;
+    std::chrono::steady_clock::time_point start;
+  };
+
+private:
+
+  static const int BUCKETS_PER_OCTAVE = 4;
+  static const int NUM_BUCKETS = 40 * BUCKETS_PER_OCTAVE; // up to ~1000 s
+
+  struct Histogram {
+    unsigned long count = 0;
+    long long max = 0;
+    unsigned int buckets[NUM_BUCKETS] = {};
+
+    void Add(long long nanoseconds);
+    long long Percentile(double fraction) const; // bucket upper bound in ns
+  };
+
+  struct Entry {
+    const Controller* controller = nullptr;
+    std::string name;
+    Histogram calls[NUM_CALL_TYPES];
+  };
+
+  static int Bucket(long long nanoseconds);
+  static long long BucketUpperBound(int bucket);
+
+  Entry entries[MAX_CONTROLLERS];
+  int numEntries = 0;
+};
+
+#endif // CONTROLLERPROFILER_H
@@ -0,0 +1,64 @@
+#include "DeadlineMonitor.h"
+
+#include <cmath>
+
+DeadlineMonitor::DeadlineMonitor(double period)
+{
+  this->period = period;
+}
+
+void DeadlineMonitor::SetPeriod(double period)
+{
+  this->period = period;
+  Reset();
+}
+
+bool DeadlineMonitor::Record(double interval, double workTime)
+{
+  ticks++;
+
+  totalWorkTime += workTime;
+  if (workTime > worstWorkTime)
+  {
+    worstWorkTime = workTime;
+  }
+
+  if (interval > 0)
+  {
+    double jitter = fabs(interval - period);
+    intervals++;
+    totalJitter += jitter;
+    if (jitter > worstJitter)
+    {
+      worstJitter = jitter;
+    }
+  }
+
+  if (workTime > period)
+  {
+    overruns++;
+    return true;
+  }
+  return false;
+}
+
+void DeadlineMonitor::Reset()
+{
+  ticks = 0;
+  intervals = 0;
+  overruns = 0;
+  totalWorkTime = 0;
+  worstWorkTime = 0;
+  totalJitter = 0;
+  worstJitter = 0;
+}
+
+double DeadlineMonitor::MeanWorkTime() const
+{
+  return ticks > 0 ? totalWorkTime / ticks : 0;
+}
+
+double DeadlineMonitor::MeanJitter() const
+{
+  return intervals > 0 ? totalJitter / intervals : 0;
+}
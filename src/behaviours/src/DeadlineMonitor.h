@@ -0,0 +1,40 @@
+#ifndef DEADLINEMONITOR_H
+#define DEADLINEMONITOR_H
+
+// Keeps timing statistics for a periodic loop. Each tick records the time
+// since the previous tick started and how long the tick's work took, both
+// in seconds. A tick whose work takes longer than the period is an overrun.
+// Jitter is how far the measured interval was from the nominal period.
+class DeadlineMonitor
+{
+public:
+  DeadlineMonitor(double period = 0.1);
+
+  void SetPeriod(double period);
+  double GetPeriod() const { return period; }
+
+  // Pass interval <= 0 when it is not known (e.g. for the first tick).
+  // Returns true if this tick overran its deadline.
+  bool Record(double interval, double workTime);
+  void Reset();
+
+  unsigned long Ticks() const { return ticks; }
+  unsigned long Overruns() const { return overruns; }
+  double WorstWorkTime() const { return worstWorkTime; }
+  double MeanWorkTime() const;
+  double WorstJitter() const { return worstJitter; }
+  double MeanJitter() const;
+
+private:
+  double period;
+
+  unsigned long ticks = 0;
+  unsigned long intervals = 0; // ticks that had a known interval
+  unsigned long overruns = 0;
+  double totalWorkTime = 0;
+  double worstWorkTime = 0;
+  double totalJitter = 0;
+  double worstJitter = 0;
+};
+
+#endif // DEADLINEMONITOR_H
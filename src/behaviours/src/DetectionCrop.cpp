@@ -0,0 +1,137 @@
+// The crop stage in front of the tag detector. It republishes each camera
+// frame cropped to the region given by the behaviour node's detection hint,
+// see DetectionHint.h, with the camera info moved to match, so the detector
+// only searches the part of the image where the tags it is asked for are.
+// Frames are passed through whole while there is no region or the last hint
+// is older than ~hint_timeout, e.g. when the behaviour node is not running.
+//
+// Subscribes to "image" and "camera_info" through image_transport, with the
+// transport taken from ~image_transport, and to "hint". Publishes raw images
+// on "roi/image" and their camera info on "roi/camera_info".
+
+#include <ros/ros.h>
+#include <image_transport/image_transport.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/CameraInfo.h>
+#include <sensor_msgs/image_encodings.h>
+#include "swarmie_msgs/DetectionHint.h"
+
+#include "DetectionHint.h"
+
+#include <cstring>
+#include <vector>
+
+using namespace std;
+
+ros::Publisher imagePublisher;
+ros::Publisher infoPublisher;
+
+swarmie_msgs::DetectionHint::ConstPtr lastHint;
+vector<DetectionHint::Point> hintPoints;
+
+double hintTimeout = 0.5; // seconds
+int pad = 24; // pixels around the projected tags
+int minSize = 64; // pixels on a side
+
+unsigned long croppedFrames = 0;
+unsigned long passedFrames = 0;
+
+void hintHandler(const swarmie_msgs::DetectionHint::ConstPtr& message)
+{
+  lastHint = message;
+
+  hintPoints.resize(message->x.size());
+  for (size_t i = 0; i < hintPoints.size(); i++)
+  {
+    hintPoints[i].x = message->x[i];
+    hintPoints[i].y = i < message->y.size() ? message->y[i] : 0;
+    hintPoints[i].z = i < message->z.size() ? message->z[i] : 0;
+  }
+}
+
+void imageHandler(const sensor_msgs::ImageConstPtr& image, const sensor_msgs::CameraInfoConstPtr& info)
+{
+  bool fresh = lastHint && (image->header.stamp - lastHint->stamp).toSec() < hintTimeout;
+
+  DetectionHint::Roi roi = {0, 0, (int)image->width, (int)image->height};
+  if (fresh && !hintPoints.empty())
+  {
+    roi = DetectionHint::Project(hintPoints, lastHint->margin,
+                                 info->K[0], info->K[4], info->K[2], info->K[5],
+                                 image->width, image->height, pad, minSize);
+  }
+
+  if (roi.width == (int)image->width && roi.height == (int)image->height)
+  {
+    passedFrames++;
+    imagePublisher.publish(image);
+    infoPublisher.publish(info);
+    return;
+  }
+
+  int pixelBytes = sensor_msgs::image_encodings::numChannels(image->encoding) *
+    sensor_msgs::image_encodings::bitDepth(image->encoding) / 8;
+
+  sensor_msgs::ImagePtr cropped(new sensor_msgs::Image);
+  cropped->header = image->header;
+  cropped->encoding = image->encoding;
+  cropped->is_bigendian = image->is_bigendian;
+  cropped->width = roi.width;
+  cropped->height = roi.height;
+  cropped->step = roi.width * pixelBytes;
+  cropped->data.resize(cropped->step * roi.height);
+
+  for (int row = 0; row < roi.height; row++)
+  {
+    memcpy(&cropped->data[row * cropped->step],
+           &image->data[(roi.y + row) * image->step + roi.x * pixelBytes],
+           cropped->step);
+  }
+
+  // The detector works the tag poses out from the principal point, which
+  // moves with the crop
+  sensor_msgs::CameraInfoPtr croppedInfo(new sensor_msgs::CameraInfo(*info));
+  croppedInfo->width = roi.width;
+  croppedInfo->height = roi.height;
+  croppedInfo->K[2] -= roi.x;
+  croppedInfo->K[5] -= roi.y;
+  croppedInfo->P[2] -= roi.x;
+  croppedInfo->P[6] -= roi.y;
+
+  croppedFrames++;
+  imagePublisher.publish(cropped);
+  infoPublisher.publish(croppedInfo);
+}
+
+void statsTimerEventHandler(const ros::TimerEvent& event)
+{
+  ROS_INFO("detection crop: %lu frames cropped, %lu passed whole",
+           croppedFrames, passedFrames);
+}
+
+int main(int argc, char **argv)
+{
+  ros::init(argc, argv, "detection_crop");
+  ros::NodeHandle nh;
+  ros::NodeHandle privateNH("~");
+
+  privateNH.param("hint_timeout", hintTimeout, hintTimeout);
+  privateNH.param("pad", pad, pad);
+  privateNH.param("min_size", minSize, minSize);
+
+  imagePublisher = nh.advertise<sensor_msgs::Image>("roi/image", 1);
+  infoPublisher = nh.advertise<sensor_msgs::CameraInfo>("roi/camera_info", 1);
+
+  ros::Subscriber hintSubscriber = nh.subscribe("hint", 1, hintHandler);
+
+  image_transport::ImageTransport it(nh);
+  image_transport::CameraSubscriber cameraSubscriber = it.subscribeCamera(
+    "image", 1, imageHandler, ros::VoidPtr(),
+    image_transport::TransportHints("raw", ros::TransportHints(), privateNH));
+
+  ros::Timer statsTimer = nh.createTimer(ros::Duration(60), statsTimerEventHandler);
+
+  ros::spin();
+
+  return 0;
+}
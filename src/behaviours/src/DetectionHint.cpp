@@ -0,0 +1,115 @@
+#include "DetectionHint.h"
+#include "TagSummary.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+bool DetectionHint::Update(Mode next, const vector<Tag>& tags)
+{
+  bool changed = next != mode;
+  mode = next;
+
+  if (mode == DETECT_ALL)
+  {
+    changed = changed || !points.empty();
+    points.clear();
+    missedTicks = 0;
+    return changed;
+  }
+
+  int wanted = mode == DETECT_TARGETS ? TagSummary::TARGET_ID : TagSummary::CENTER_ID;
+
+  seen.clear();
+  for (const Tag& tag : tags)
+  {
+    if (tag.getID() == wanted)
+    {
+      seen.push_back(Point{tag.getPositionX(), tag.getPositionY(), tag.getPositionZ()});
+    }
+  }
+
+  if (seen.empty())
+  {
+    // Keep looking where the tags were for a few frames, then in the whole
+    // image
+    if (!points.empty() && ++missedTicks > holdTicks)
+    {
+      points.clear();
+      missedTicks = 0;
+      return true;
+    }
+    return changed;
+  }
+
+  missedTicks = 0;
+  changed = changed || seen.size() != points.size() ||
+    !equal(seen.begin(), seen.end(), points.begin(), [](const Point& a, const Point& b) {
+        return a.x == b.x && a.y == b.y && a.z == b.z;
+      });
+  points.swap(seen);
+  return changed;
+}
+
+DetectionHint::Roi DetectionHint::Project(const vector<Point>& points, float margin,
+                                          double fx, double fy, double cx, double cy,
+                                          int width, int height, int pad, int minSize)
+{
+  Roi full = {0, 0, width, height};
+
+  // Tags this close are not in focus and are not projected
+  const float minRange = 0.05;
+
+  double left = width, right = 0, top = height, bottom = 0;
+  bool inFront = false;
+  for (const Point& p : points)
+  {
+    if (p.z < minRange)
+    {
+      continue;
+    }
+    inFront = true;
+
+    double u = cx + fx * p.x / p.z;
+    double v = cy + fy * p.y / p.z;
+    double ru = fx * margin / p.z + pad;
+    double rv = fy * margin / p.z + pad;
+    left = min(left, u - ru);
+    right = max(right, u + ru);
+    top = min(top, v - rv);
+    bottom = max(bottom, v + rv);
+  }
+
+  if (!inFront)
+  {
+    return full;
+  }
+
+  // Grow small regions about their center
+  if (right - left < minSize)
+  {
+    double center = (left + right) / 2;
+    left = center - minSize / 2.0;
+    right = center + minSize / 2.0;
+  }
+  if (bottom - top < minSize)
+  {
+    double center = (top + bottom) / 2;
+    top = center - minSize / 2.0;
+    bottom = center + minSize / 2.0;
+  }
+
+  Roi roi;
+  roi.x = max(0, (int)floor(left));
+  roi.y = max(0, (int)floor(top));
+  roi.width = min(width, (int)ceil(right)) - roi.x;
+  roi.height = min(height, (int)ceil(bottom)) - roi.y;
+
+  // Every tag is outside the image, search all of it
+  if (roi.width <= 0 || roi.height <= 0)
+  {
+    return full;
+  }
+  return roi;
+}
@@ -0,0 +1,76 @@
+#ifndef DETECTIONHINT_H
+#define DETECTIONHINT_H
+
+#include <vector>
+
+#include "Tag.h"
+
+// Where the tags the running controller needs are expected in the camera
+// image. During the pick up approach only the cube being picked up matters,
+// and during the drop off center approach only the collection zone tags, so
+// the tag detector need not search the whole image for them.
+//
+// The behaviour loop calls Update() each tick with the tags of the tick.
+// The hint keeps the camera frame positions of the tags of the wanted kind,
+// and keeps the last ones for a few ticks when a frame misses them. It falls
+// back to the whole image when the mode does not want a region or the tags
+// have been missed for longer, so a tag that left the region is searched for
+// in the whole image again.
+//
+// Project() turns the positions into the pixel region to crop the image to,
+// given the camera intrinsics. It is used by the crop stage in front of the
+// detector, see DetectionCrop.cpp.
+class DetectionHint
+{
+public:
+
+  // Numbered like the swarmie_msgs/DetectionHint constants
+  enum Mode {
+    DETECT_ALL = 0,
+    DETECT_TARGETS,
+    DETECT_CENTER
+  };
+
+  struct Point {
+    float x, y, z; // camera frame meters, as in the tag poses
+  };
+
+  struct Roi {
+    int x, y, width, height; // pixels
+  };
+
+  // Meters kept around each tag position
+  void SetMargin(float meters) { margin = meters; }
+  float GetMargin() const { return margin; }
+
+  // Ticks the last positions are kept through when no wanted tag is seen
+  void SetHoldTicks(int ticks) { holdTicks = ticks; }
+
+  // Returns true when the hint changed
+  bool Update(Mode mode, const std::vector<Tag>& tags);
+
+  Mode GetMode() const { return mode; }
+  const std::vector<Point>& GetPoints() const { return points; }
+
+  // Whether the whole image has to be searched
+  bool IsFullFrame() const { return points.empty(); }
+
+  // The region of a width by height image that holds every point with margin
+  // meters and pad pixels around it, at least minSize pixels on a side. The
+  // whole image when no point is in front of the camera.
+  static Roi Project(const std::vector<Point>& points, float margin,
+                     double fx, double fy, double cx, double cy,
+                     int width, int height, int pad, int minSize);
+
+private:
+
+  Mode mode = DETECT_ALL;
+  std::vector<Point> points;
+  std::vector<Point> seen; // reused by Update()
+
+  float margin = 0.05;
+  int holdTicks = 5;
+  int missedTicks = 0;
+};
+
+#endif // DETECTIONHINT_H
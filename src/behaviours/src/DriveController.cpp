@@ -2,16 +2,16 @@
 
 DriveController::DriveController() {
 
-  fastVelPID.SetConfiguration(fastVelConfig());
-  fastYawPID.SetConfiguration(fastYawConfig());
+  pidConfigsMatchPolicies = true;
 
-  slowVelPID.SetConfiguration(slowVelConfig());
-  slowYawPID.SetConfiguration(slowYawConfig());
-
-  constVelPID.SetConfiguration(constVelConfig());
-  constYawPID.SetConfiguration(constYawConfig());
+  pidConfigsMatchPolicies &= fastVelPID.SetConfiguration(fastVelConfig());
+  pidConfigsMatchPolicies &= fastYawPID.SetConfiguration(fastYawConfig());
 
+  pidConfigsMatchPolicies &= slowVelPID.SetConfiguration(slowVelConfig());
+  pidConfigsMatchPolicies &= slowYawPID.SetConfiguration(slowYawConfig());
 
+  pidConfigsMatchPolicies &= constVelPID.SetConfiguration(constVelConfig());
+  pidConfigsMatchPolicies &= constYawPID.SetConfiguration(constYawConfig());
 }
 
 DriveController::~DriveController() {}
@@ -19,6 +19,8 @@ DriveController::~DriveController() {}
 void DriveController::Reset()
 {
   waypoints.clear();
+  route.clear();
+  planner.Cancel();
 
   if (stateMachineState == STATE_MACHINE_ROTATE || stateMachineState == STATE_MACHINE_SKID_STEER)
   {
@@ -103,6 +105,8 @@ Result DriveController::DoWork()
     //if we are out of waypoints then interupt and return to logic controller
     if (waypoints.empty())
     {
+      route.clear();
+      planner.Cancel();
       stateMachineState = STATE_MACHINE_WAITING;
       result.type = behavior;
       interupt = true;
@@ -110,10 +114,19 @@ Result DriveController::DoWork()
     }
     else
     {
+      UpdateRoute();
+
+      //skip the corners of the route we are already at
+      while (!route.empty() && hypot(route.back().x-currentLocation.x, route.back().y-currentLocation.y) < routeTolerance)
+      {
+        route.pop_back();
+      }
+
       //select setpoint for heading and begin driving to the next waypoint
       stateMachineState = STATE_MACHINE_ROTATE;
-      waypoints.back().theta = atan2(waypoints.back().y - currentLocation.y, waypoints.back().x - currentLocation.x);
-      result.pd.setPointYaw = waypoints.back().theta;
+      Point& target = DriveTarget();
+      target.theta = atan2(target.y - currentLocation.y, target.x - currentLocation.x);
+      result.pd.setPointYaw = target.theta;
 
       //cout << "**************************************************************************" << endl; //DEBUGGING CODE
       //cout << "Waypoint x : " << waypoints.back().x << " y : " << waypoints.back().y << endl; //DEBUGGING CODE
@@ -128,10 +141,12 @@ Result DriveController::DoWork()
     // Rotate left or right depending on sign of angle
     // Stay in this state until angle is minimized
 
-    waypoints.back().theta = atan2(waypoints.back().y - currentLocation.y, waypoints.back().x - currentLocation.x);
+    UpdateRoute();
+    Point& target = DriveTarget();
+    target.theta = atan2(target.y - currentLocation.y, target.x - currentLocation.x);
 
     // Calculate the diffrence between current and desired heading in radians.
-    float errorYaw = angles::shortest_angular_distance(currentLocation.theta, waypoints.back().theta);
+    float errorYaw = ShortestAngularDistance(currentLocation.theta, target.theta);
 
     //cout << "ROTATE Error yaw:  " << errorYaw << " target heading : " << waypoints.back().theta << " current heading : " << currentLocation.theta << endl; //DEBUGGING CODE
     //cout << "Waypoint x : " << waypoints.back().x << " y : " << waypoints.back().y << " currentLoc x : " << currentLocation.x << " y : " << currentLocation.y << endl; //DEBUGGING CODE
@@ -139,7 +154,7 @@ Result DriveController::DoWork()
     result.pd.setPointVel = 0.0;
     //Calculate absolute value of angle
 
-    float abs_error = fabs(angles::shortest_angular_distance(currentLocation.theta, waypoints.back().theta));
+    float abs_error = fabs(ShortestAngularDistance(currentLocation.theta, target.theta));
 
     // If angle > rotateOnlyAngleTolerance radians rotate but dont drive forward.
     if (abs_error > rotateOnlyAngleTolerance)
@@ -168,9 +183,12 @@ Result DriveController::DoWork()
       // Stay in this state until angle is at least PI/2
 
     // calculate the distance between current and desired heading in radians
-    waypoints.back().theta = atan2(waypoints.back().y - currentLocation.y, waypoints.back().x - currentLocation.x);
-    float errorYaw = angles::shortest_angular_distance(currentLocation.theta, waypoints.back().theta);
-    float distance = hypot(waypoints.back().x - currentLocation.x, waypoints.back().y - currentLocation.y);
+    UpdateRoute();
+    Point& target = DriveTarget();
+    target.theta = atan2(target.y - currentLocation.y, target.x - currentLocation.x);
+    float errorYaw = ShortestAngularDistance(currentLocation.theta, target.theta);
+    float distance = hypot(target.x - currentLocation.x, target.y - currentLocation.y);
+    float tolerance = route.empty() ? waypointTolerance : routeTolerance;
 
     //cout << "Skid steer, Error yaw:  " << errorYaw << " target heading : " << waypoints.back().theta << " current heading : " << currentLocation.theta << " error distance : " << distance << endl; //DEBUGGING CODE
     //cout << "Waypoint x : " << waypoints.back().x << " y : " << waypoints.back().y << " currentLoc x : " << currentLocation.x << " y : " << currentLocation.y << endl; //DEBUGGING CODE
@@ -178,7 +196,7 @@ Result DriveController::DoWork()
 
 
     // goal not yet reached drive while maintaining proper heading.
-    if (fabs(errorYaw) < M_PI_2 &&  distance > waypointTolerance)
+    if (fabs(errorYaw) < M_PI_2 &&  distance > tolerance)
     {
       // drive and turn simultaniously
       result.pd.setPointVel = searchVelocity;
@@ -217,6 +235,67 @@ Result DriveController::DoWork()
 
 }
 
+void DriveController::UpdateRoute()
+{
+  if (waypoints.empty()) return;
+
+  const Point& goal = waypoints.back();
+  bool newGoal = planner.GetStatus() == GridPlanner::IDLE || goal.x != routeGoal.x || goal.y != routeGoal.y;
+  bool retry = planner.GetStatus() == GridPlanner::FAILED && current_time >= routeRetryTime;
+
+  //cells next to the rover stay passable as it drives along the route
+  planner.SetPosition(currentLocation);
+
+  if (newGoal || retry || (!route.empty() && RouteBlocked()))
+  {
+    route.clear();
+    routeGoal = goal;
+    if (newGoal)
+    {
+      routeRetryDelay = minRouteRetryDelay;
+      routeRetryTime = 0;
+    }
+
+    if (hypot(goal.x - currentLocation.x, goal.y - currentLocation.y) > minPlanDistance)
+    {
+      planner.Start(currentLocation, goal);
+    }
+    else
+    {
+      planner.Cancel();
+    }
+  }
+
+  //the search is spread over ticks, meanwhile drive straight at the waypoint
+  bool searching = planner.GetStatus() == GridPlanner::SEARCHING;
+  GridPlanner::Status status = searching ? planner.Step() : planner.GetStatus();
+
+  if (searching && status == GridPlanner::FOUND)
+  {
+    //the last corner is the waypoint itself
+    const vector<Point>& path = planner.Path();
+    if (path.size() > 1) route.assign(path.rbegin() + 1, path.rend());
+    routeRetryDelay = minRouteRetryDelay;
+  }
+  else if (status == GridPlanner::FAILED && current_time >= routeRetryTime)
+  {
+    //the obstacles may have moved or been seen better by then
+    routeRetryTime = current_time + routeRetryDelay;
+    routeRetryDelay = min(2 * routeRetryDelay, maxRouteRetryDelay);
+  }
+}
+
+bool DriveController::RouteBlocked() const
+{
+  //only the segments ahead of the next corner, the rover may be closer
+  //to an obstacle than the planner allows
+  for (size_t i = route.size() - 1; i > 0; i--)
+  {
+    if (planner.Blocked(route[i], route[i-1])) return true;
+  }
+  return planner.Blocked(route.front(), waypoints.back());
+}
+
 bool DriveController::ShouldInterrupt()
 {
   if (interupt)
@@ -230,7 +309,7 @@ bool DriveController::ShouldInterrupt()
   }
 }
 
-bool DriveController::HasWork() {   }
+bool DriveController::HasWork() { return false; }
 
 
 
@@ -285,13 +364,25 @@ void DriveController::ProcessData()
 }
 
 
+void DriveController::SetCurrentTimeInMilliSecs( long int time )
+{
+  // Ignore the first call and clock jumps (sim resets, long pauses) so the
+  // PIDs are never handed a nonsensical time step.
+  float dt = (time - current_time) / 1e3;
+  if (current_time > 0 && dt > 0 && dt < 1.0)
+  {
+    tickDt = dt;
+  }
+  current_time = time;
+}
+
 void DriveController::fastPID(float errorVel, float errorYaw , float setPointVel, float setPointYaw)
 {
 
   // cout << "PID FAST" << endl; //DEBUGGING CODE
 
-  float velOut = fastVelPID.PIDOut(errorVel, setPointVel); //returns PWM target to try and get error vel to 0
-  float yawOut = fastYawPID.PIDOut(errorYaw, setPointYaw); //returns PWM target to try and get yaw error to 0
+  float velOut = fastVelPID.PIDOut(errorVel, setPointVel, tickDt); //returns PWM target to try and get error vel to 0
+  float yawOut = fastYawPID.PIDOut(errorYaw, setPointYaw, tickDt); //returns PWM target to try and get yaw error to 0
 
   int left = velOut - yawOut; //combine yaw and vel PWM values
   int right = velOut + yawOut; //left and right are the same for vel output but opposite for yaw output
@@ -310,8 +401,8 @@ void DriveController::slowPID(float errorVel,float errorYaw, float setPointVel,
 {
   //cout << "PID SLOW" << endl; //DEBUGGING CODE
 
-  float velOut = slowVelPID.PIDOut(errorVel, setPointVel);
-  float yawOut = slowYawPID.PIDOut(errorYaw, setPointYaw);
+  float velOut = slowVelPID.PIDOut(errorVel, setPointVel, tickDt);
+  float yawOut = slowYawPID.PIDOut(errorYaw, setPointYaw, tickDt);
 
   int left = velOut - yawOut;
   int right = velOut + yawOut;
@@ -331,8 +422,8 @@ void DriveController::constPID(float erroVel,float constAngularError, float setP
 
   //cout << "PID CONST" << endl; //DEBUGGING CODE
 
-  float velOut = constVelPID.PIDOut(erroVel, setPointVel);
-  float yawOut = constYawPID.PIDOut(constAngularError, setPointYaw);
+  float velOut = constVelPID.PIDOut(erroVel, setPointVel, tickDt);
+  float yawOut = constYawPID.PIDOut(constAngularError, setPointYaw, tickDt);
 
   int left = velOut - yawOut;
   int right = velOut + yawOut;
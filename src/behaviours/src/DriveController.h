@@ -3,7 +3,8 @@
 
 #include "PID.h"
 #include "Controller.h"
-#include <angles/angles.h>
+#include "GridPlanner.h"
+#include "Angles.h"
 
 class DriveController : virtual Controller
 {
@@ -19,9 +20,20 @@ public:
   void SetResultData(Result result) {this->result = result;}
   void SetVelocityData(float linearVelocity,float angularVelocity);
   void SetCurrentLocation(Point currentLocation) {this->currentLocation = currentLocation;}
+  void SetCurrentTimeInMilliSecs( long int time );
+
+  // Waypoints are reached by a way around the obstacles in the grid, see
+  // GridPlanner. Without a grid they are driven to in a straight line.
+  void SetOccupancyGrid(const OccupancyGrid* grid) { planner.SetGrid(grid); }
+
+  // False if a PID config sets switches its compiled policy ignores, see
+  // PID.h. The library does not log, the adapter reports it.
+  bool PIDConfigsMatchPolicies() const { return pidConfigsMatchPolicies; }
 
 private:
 
+  bool pidConfigsMatchPolicies;
+
   Result result;
 
   //MAX PWM is 255
@@ -41,6 +53,9 @@ private:
   float linearVelocity = 0;
   float angularVelocity = 0;
 
+  long int current_time = 0;
+  float tickDt = 0.1; // seconds between the last two ticks, passed to the PIDs
+
   // Numeric Variables for rover positioning
   Point currentLocation;
   Point currentLocationMap;
@@ -52,6 +67,27 @@ private:
 
   vector<Point> waypoints;
 
+  // The corners planned on the way to waypoints.back(), the next one last
+  GridPlanner planner;
+  vector<Point> route;
+  Point routeGoal;
+  const float routeTolerance = 0.2; // meters, corners need not be hit exactly
+  const float minPlanDistance = 0.5; // meters, closer waypoints are driven to directly
+
+  // A failed plan is tried again after routeRetryDelay, which doubles
+  // with every failure for the same waypoint up to maxRouteRetryDelay
+  const long int minRouteRetryDelay = 1000; // milliseconds
+  const long int maxRouteRetryDelay = 8000;
+  long int routeRetryDelay = minRouteRetryDelay;
+  long int routeRetryTime = 0;
+
+  // Starts, continues or repeats the plan to waypoints.back()
+  void UpdateRoute();
+  bool RouteBlocked() const;
+
+  // The next corner of the route, or the waypoint itself
+  Point& DriveTarget() { return route.empty() ? waypoints.back() : route.back(); }
+
   //PID configs************************
   PIDConfig fastVelConfig();
   PIDConfig fastYawConfig();
@@ -66,14 +102,14 @@ private:
 
   //each PID movement paradigm needs at minimum two PIDs to acheive good robot motion.
   //one PID is for linear movement and the second for rotational movements
-  PID fastVelPID;
-  PID fastYawPID;
+  VelocityPID fastVelPID;
+  YawPID fastYawPID;
 
-  PID slowVelPID;
-  PID slowYawPID;
+  VelocityPID slowVelPID;
+  YawPID slowYawPID;
 
-  PID constVelPID;
-  PID constYawPID;
+  VelocityPID constVelPID;
+  ConstYawPID constYawPID;
 
   // state machine states
   enum StateMachineStates {
@@ -90,8 +90,38 @@ Result DropOffController::DoWork() {
     return result;
   }
 
+  // Head for where the collection zone was last seen, if that is better
+  // known than the center location
+  Point center = centerEstimator.Estimate(current_time);
+
+  //wait for our turn at the collection zone unless already on the way in
+  if (!nestGranted && !centerApproach && !seenEnoughCenterTags) {
+    holding = true;
+    timerTimeElapsed = -1;
+    circularCenterSearching = false;
+
+    if (!holdingArrived && hypot(holdingPoint.x - currentLocation.x, holdingPoint.y - currentLocation.y) > holdingTolerance) {
+      result.type = waypoint;
+      result.wpts.waypoints.clear();
+      result.wpts.waypoints.push_back(holdingPoint);
+      startWaypoint = false;
+      isPrecisionDriving = false;
+      return result;
+    }
+
+    //face the center so its tags are in view when our turn comes
+    holdingArrived = true;
+    float headingError = atan2(center.y - currentLocation.y, center.x - currentLocation.x) - currentLocation.theta;
+    result.type = precisionDriving;
+    result.pd.cmdVel = 0.0;
+    result.pd.cmdAngularError = atan2(sin(headingError), cos(headingError));
+    return result;
+  }
+  holding = false;
+  holdingArrived = false;
+
   // Calculates the shortest distance to the center location from the current location
-  double distanceToCenter = hypot(this->centerLocation.x - this->currentLocation.x, this->centerLocation.y - this->currentLocation.y);
+  double distanceToCenter = hypot(center.x - this->currentLocation.x, center.y - this->currentLocation.y);
 
   //check to see if we are driving to the center location or if we need to drive in a circle and look.
   if (distanceToCenter > collectionPointVisualDistance && !circularCenterSearching && (count == 0)) {
@@ -100,7 +130,7 @@ Result DropOffController::DoWork() {
     // Clears all the waypoints in the vector
     result.wpts.waypoints.clear();
     // Adds the current location's point into the waypoint vector
-    result.wpts.waypoints.push_back(this->centerLocation);
+    result.wpts.waypoints.push_back(center);
     // Do not start following waypoints
     startWaypoint = false;
     // Disable precision driving
@@ -117,8 +147,8 @@ Result DropOffController::DoWork() {
 
     //sets a goal that is 60cm from the centerLocation and spinner
     //radians counterclockwise from being purly along the x-axis.
-    nextSpinPoint.x = centerLocation.x + (initialSpinSize + spinSizeIncrease) * cos(spinner);
-    nextSpinPoint.y = centerLocation.y + (initialSpinSize + spinSizeIncrease) * sin(spinner);
+    nextSpinPoint.x = center.x + (initialSpinSize + spinSizeIncrease) * cos(spinner);
+    nextSpinPoint.y = center.y + (initialSpinSize + spinSizeIncrease) * sin(spinner);
     nextSpinPoint.theta = atan2(nextSpinPoint.y - currentLocation.y, nextSpinPoint.x - currentLocation.x);
 
     result.type = waypoint;
@@ -246,7 +276,7 @@ Result DropOffController::DoWork() {
       centerApproach = false;
 
       result.type = waypoint;
-      result.wpts.waypoints.push_back(this->centerLocation);
+      result.wpts.waypoints.push_back(center);
       if (isPrecisionDriving) {
         result.type = behavior;
         result.b = prevProcess;
@@ -286,7 +316,9 @@ void DropOffController::Reset() {
   result.wristAngle = 0.7;
   result.reset = false;
   result.wpts.waypoints.clear();
-  spinner = 0;
+  //optionally start the spin search on a different side each time, so a
+  //rover that missed the center does not look where the last one just was
+  spinner = randomSpinStart ? random.Uniform(0, 2*M_PI) : 0;
   spinSizeIncrease = 0;
   prevCount = 0;
   timerTimeElapsed = -1;
@@ -305,33 +337,36 @@ void DropOffController::Reset() {
   targetHeld = false;
   startWaypoint = false;
   first_center = true;
+  holding = false;
+  holdingArrived = false;
+  nestChanged = false;
   //cout << "6" << endl;
 
 }
 
 // Individually calculates and sets the number of tags seen on the right and the left of the rover
-void DropOffController::SetTargetData(vector<Tag> tags) {
+void DropOffController::SetTargetData(const TagSummary& tags) {
   countRight = 0;
   countLeft = 0;
 
-  if(targetHeld) {
-    // if a target is detected and we are looking for center tags
-    if (tags.size() > 0 && !reachedCollectionPoint) {
-
-      // this loop is to get the number of center tags
-      for (int i = 0; i < tags.size(); i++) {
-        if (tags[i].getID() == 256) {
-
-          // checks if tag is on the right or left side of the image
-          if (tags[i].getPositionX() + cameraOffsetCorrection > 0) {
-            countRight++;
+  // Remember where the collection zone is whenever enough of its edge is in
+  // view from outside, carrying a cube or not. The center is about
+  // collectionZoneRadius beyond the edge.
+  if (tags.centers >= confidentCenterTags && tags.facingAwayLeft + tags.facingAwayRight > 0) {
+    float heading = currentLocation.theta + tags.centersBearing;
+    float distance = tags.centersDistance + collectionZoneRadius;
+
+    Point seen;
+    seen.x = currentLocation.x + distance * cos(heading);
+    seen.y = currentLocation.y + distance * sin(heading);
+    seen.theta = 0;
+    centerEstimator.AddSighting(seen, current_time);
+  }
 
-          } else {
-            countLeft++;
-          }
-        }
-      }
-    }
+  // if we are looking for center tags, count them on each side of the image
+  if(targetHeld && !reachedCollectionPoint) {
+    countRight = tags.centersRight;
+    countLeft = tags.centersLeft;
   }
 
 }
@@ -351,6 +386,15 @@ void DropOffController::ProcessData() {
 bool DropOffController::ShouldInterrupt() {
   // Determine the driving mode (precision or waypoint)
   ProcessData();
+
+  // Stop short of the collection zone, or leave the holding point, as soon
+  // as the turn changes rather than when the current waypoint is reached
+  if (nestChanged) {
+    nestChanged = false;
+    if (targetHeld && !reachedCollectionPoint && !centerApproach && !seenEnoughCenterTags) {
+      return true;
+    }
+  }
   if (startWaypoint && !interrupt) {
     interrupt = true;
     precisionInterrupt = false;
@@ -363,6 +407,7 @@ bool DropOffController::ShouldInterrupt() {
   if (finalInterrupt) {
     return true;
   }
+  return false;
 }
 
 
@@ -391,11 +436,13 @@ bool DropOffController::IsChangingMode() {
 // Of the Point class (x, y, theta)
 void DropOffController::SetCenterLocation(Point center) {
   centerLocation = center;
+  centerEstimator.SetPrior(center);
 }
 
 // Setter function to set the current location of the Point class (x, y, theta)
 void DropOffController::SetCurrentLocation(Point current) {
   currentLocation = current;
+  centerEstimator.SetCurrentLocation(current);
 }
 
 // Setter function to set the variable to true if a target (cube) has been picked up
@@ -410,6 +457,21 @@ void DropOffController::SetBlockBlockingUltrasound(bool blockBlock) {
   targetHeld = targetHeld || blockBlock;
 }
 
+// Setter function for the access to the collection zone, see NestScheduler.h
+void DropOffController::SetNestAccess(bool granted, Point holdingPoint) {
+  if (granted != nestGranted) {
+    nestChanged = true;
+  }
+  // A new slot after the queue moved up
+  else if (!granted && hypot(holdingPoint.x - this->holdingPoint.x, holdingPoint.y - this->holdingPoint.y) > holdingTolerance) {
+    nestChanged = true;
+    holdingArrived = false;
+  }
+
+  nestGranted = granted;
+  this->holdingPoint = holdingPoint;
+}
+
 // Setter function to set the current time (in milliseconds)
 void DropOffController::SetCurrentTimeInMilliSecs( long int time )
 {
@@ -4,6 +4,9 @@
 
 #include "Controller.h"
 #include "Tag.h"
+#include "TagSummary.h"
+#include "CenterEstimator.h"
+#include "RandomStream.h"
 #include <math.h>
 
 class DropOffController : virtual Controller
@@ -22,12 +25,29 @@ public:
   void SetCurrentLocation(Point current);
   void SetTargetPickedUp();
   void SetBlockBlockingUltrasound(bool blockBlock);
-  void SetTargetData(vector<Tag> tags);
+  void SetTargetData(const TagSummary& tags);
   bool HasTarget() {return targetHeld;}
 
+  // Lined up on the collection zone tags, and backing out after the drop
+  bool IsApproachingCenter() const {return centerApproach || seenEnoughCenterTags;}
+  bool HasReachedCollectionPoint() const {return reachedCollectionPoint;}
+
+  // Whether this rover's turn at the collection zone has come, see
+  // NestScheduler.h, and where to wait for it otherwise
+  void SetNestAccess(bool granted, Point holdingPoint);
+
   float GetSpinner() {return spinner;}
 
-  void UpdateData(vector<Tag> tags);
+  // With randomSpinStart the spin search for the center starts at an angle
+  // drawn from stream instead of +x. Off by default, so trial results stay
+  // comparable with runs from before the streams.
+  void SetRandomStream(const RandomStream& stream) { random = stream; }
+  void SetRandomSpinStart(bool randomSpinStart) { this->randomSpinStart = randomSpinStart; }
+
+  // Where the rover drives to drop off, see CenterEstimator
+  Point GetCenterEstimate() const { return centerEstimator.Estimate(current_time); }
+
+  void UpdateData(const vector<Tag>& tags);
 
   void SetCurrentTimeInMilliSecs( long int time );
 
@@ -37,7 +57,6 @@ private:
 
   //Constants
 
-  const float cameraOffsetCorrection = 0.020; //meters
   const float centeringTurnRate = 0.15; //radians
   const int centerTagThreshold = 8;
   const int lostCenterCutoff = 4; //seconds before giving up on drop off beacuse center cannot be seen anymore
@@ -46,6 +65,9 @@ private:
   const float spinSizeIncrement = 0.50; //in meters
   const float searchVelocity = 0.15; //in meters per second
   const float dropDelay = 0.5; //delay in seconds for dropOff
+  const float collectionZoneRadius = 0.5; //in meters, from the edge tags to the center
+  const int confidentCenterTags = 3; //fewer tags in view do not give a good direction
+  const float holdingTolerance = 0.2; //in meters, close enough to the holding point to wait there
 
 
 
@@ -57,6 +79,8 @@ private:
 
   //keep track of progression around a circle when driving in a circle
   float spinner;
+  RandomStream random;
+  bool randomSpinStart = false;
 
   //Timer for return code (dropping the cube in the center)- used for timerTimeElapsed
   long int returnTimer;
@@ -80,6 +104,10 @@ private:
   Point centerLocation;
   Point currentLocation;
 
+  //Center location refined by sightings of the collection zone. Kept across
+  //Reset() since it is just as useful on the next return.
+  CenterEstimator centerEstimator;
+
   //Time since modeTimer was started, in seconds
   float timerTimeElapsed;
 
@@ -111,6 +139,14 @@ private:
   //Flag to indicate that we're starting to follow waypoints
   bool startWaypoint;
 
+  //Access to the collection zone. While it is not granted the rover drives
+  //to holdingPoint and waits there facing the center.
+  bool nestGranted = true;
+  Point holdingPoint;
+  bool holding = false;
+  bool holdingArrived = false;
+  bool nestChanged = false;
+
   Result result;
 
   long int current_time;
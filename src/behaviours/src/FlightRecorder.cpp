@@ -0,0 +1,133 @@
+#include "FlightRecorder.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using namespace std;
+
+static void InitHeader(FlightRecordHeader& header, uint32_t capacity, uint64_t written)
+{
+  memcpy(header.magic, "SWFR", 4);
+  header.version = FlightRecorder::FILE_VERSION;
+  header.recordSize = sizeof (FlightRecord);
+  header.capacity = capacity;
+  header.reserved = 0;
+  header.written = written;
+}
+
+bool FlightRecorder::Open(const string& path, uint32_t capacity)
+{
+  Close();
+  if (capacity == 0)
+  {
+    return false;
+  }
+
+  // The ring a crashed node left behind is the record of the crash, so it
+  // is kept as path.prev rather than truncated when the node is relaunched
+  if (rename(path.c_str(), (path + ".prev").c_str()) != 0 && errno != ENOENT)
+  {
+    return false;
+  }
+
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return false;
+  }
+
+  // Allocate the blocks now, so a full disk shows up here and not as a
+  // SIGBUS when a record first touches a page
+  size_t size = sizeof (FlightRecordHeader) + (size_t)capacity * sizeof (FlightRecord);
+  void* mapping = MAP_FAILED;
+  if (posix_fallocate(fd, 0, size) == 0)
+  {
+    mapping = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  if (mapping == MAP_FAILED)
+  {
+    close(fd);
+    fd = -1;
+    return false;
+  }
+
+  mappedSize = size;
+  this->capacity = capacity;
+  header = (FlightRecordHeader*)mapping;
+  records = (FlightRecord*)((char*)mapping + sizeof (FlightRecordHeader));
+  InitHeader(*header, capacity, 0);
+  return true;
+}
+
+void FlightRecorder::Close()
+{
+  if (header == NULL)
+  {
+    return;
+  }
+
+  munmap(header, mappedSize);
+  close(fd);
+  header = NULL;
+  records = NULL;
+  capacity = 0;
+  mappedSize = 0;
+  fd = -1;
+}
+
+void FlightRecorder::Record(const FlightRecord& record)
+{
+  if (header == NULL)
+  {
+    return;
+  }
+
+  // The sequence number goes in after the rest of the record and the count
+  // after that, so a record cut short by a crash is not taken for a whole one
+  uint64_t written = header->written;
+  FlightRecord& slot = records[written % capacity];
+  memcpy(&slot, &record, offsetof(FlightRecord, sequence));
+  atomic_signal_fence(memory_order_release);
+  slot.sequence = (uint32_t)written;
+  atomic_signal_fence(memory_order_release);
+  header->written = written + 1;
+}
+
+bool FlightRecorder::Dump(const string& path) const
+{
+  if (header == NULL)
+  {
+    return false;
+  }
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  uint64_t written = header->written;
+  uint32_t count = written < capacity ? (uint32_t)written : capacity;
+  uint32_t oldest = written < capacity ? 0 : written % capacity;
+
+  FlightRecordHeader dumpHeader;
+  InitHeader(dumpHeader, count, count);
+  bool ok = fwrite(&dumpHeader, sizeof (dumpHeader), 1, file) == 1;
+
+  // Renumber the records to their slots in the dump
+  for (uint32_t i = 0; ok && i < count; i++)
+  {
+    FlightRecord record = records[(oldest + i) % capacity];
+    record.sequence = i;
+    ok = fwrite(&record, sizeof (record), 1, file) == 1;
+  }
+
+  return fclose(file) == 0 && ok;
+}
@@ -0,0 +1,113 @@
+#ifndef FLIGHTRECORDER_H
+#define FLIGHTRECORDER_H
+
+#include <stdint.h>
+#include <string>
+
+// Keeps the last few minutes of behaviour ticks, one fixed size record per
+// LogicController::DoWork(), in a ring file mapped into memory. A record is
+// a copy into the mapping, nothing is written or flushed by the node, so it
+// costs next to nothing next to recording a rosbag. The pages belong to the
+// kernel, so the ring file holds every finished tick even when the node
+// crashes. The next start of the node moves it to <file>.prev, and Dump()
+// copies the ring to another file oldest record first, to keep it longer.
+//
+// The ring file and dumps start with a FlightRecordHeader followed by
+// capacity FlightRecords. Record n is in slot n % capacity. A dump is a ring
+// that is exactly full. scripts/decode_flight_record.py prints either; keep
+// its tables in sync with the enums below.
+//
+// Only use a recorder from the thread that calls DoWork().
+
+// The controller DoWork() handed the tick to. Append new controllers at the
+// end so old files still decode.
+enum FlightController {
+  FLIGHT_NONE = 0,
+  FLIGHT_SEARCH,
+  FLIGHT_OBSTACLE,
+  FLIGHT_PICKUP,
+  FLIGHT_RANGE,
+  FLIGHT_DROPOFF,
+  FLIGHT_WAYPOINT,
+  FLIGHT_DRIVE
+};
+
+#pragma pack(push, 1)
+
+struct FlightRecordHeader {
+  char magic[4];          // "SWFR"
+  uint16_t version;
+  uint16_t recordSize;
+  uint32_t capacity;      // records in the ring
+  uint32_t reserved;
+  uint64_t written;       // records written since the ring was created
+};
+
+struct FlightRecord {
+  int64_t time;           // LogicController time in ms
+
+  float x, y, theta;      // odometry pose
+  float mapX, mapY, mapTheta;
+  float linearVelocity, angularVelocity;
+  float sonarLeft, sonarCenter, sonarRight;
+
+  // TagSummary of the tags the tick used
+  uint16_t tags, targets, centers;
+  int16_t closestTarget;
+  float closestTargetRange;
+  float centersDistance, centersBearing;
+
+  uint8_t processState;
+  uint8_t logicState;
+  uint8_t controller;     // FlightController
+  uint8_t workMask;       // LogicController::workMask
+
+  // The Result returned, b is only meaningful for behavior results
+  uint8_t resultType;
+  uint8_t behaviorTrigger;
+  float left, right;
+  float fingerAngle, wristAngle;
+
+  uint32_t sequence;      // low bits of the record number, written last
+};
+
+#pragma pack(pop)
+
+class FlightRecorder
+{
+public:
+
+  static const uint16_t FILE_VERSION = 1;
+
+  FlightRecorder() : header(NULL), records(NULL), capacity(0), mappedSize(0), fd(-1) {}
+  ~FlightRecorder() { Close(); }
+
+  // Creates a ring of capacity records at path. A file already at path,
+  // e.g. the ring of a node that crashed, is moved to path.prev first,
+  // replacing the one before. Returns false if the old file could not be
+  // moved or the new one could not be made or mapped.
+  bool Open(const std::string& path, uint32_t capacity);
+  void Close();
+  bool IsOpen() const { return header != NULL; }
+
+  // Copies the record into the next slot, overwriting the oldest once the
+  // ring is full
+  void Record(const FlightRecord& record);
+
+  // Writes the records in the ring to path, oldest first. Returns false if
+  // nothing is recording or the file could not be written.
+  bool Dump(const std::string& path) const;
+
+  uint64_t Written() const { return header != NULL ? header->written : 0; }
+  uint32_t Capacity() const { return capacity; }
+
+private:
+
+  FlightRecordHeader* header;
+  FlightRecord* records;
+  uint32_t capacity;
+  size_t mappedSize;
+  int fd;
+};
+
+#endif // FLIGHTRECORDER_H
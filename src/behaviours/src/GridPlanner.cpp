@@ -0,0 +1,205 @@
+#include "GridPlanner.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+GridPlanner::GridPlanner(float inflation, int expansionsPerTick, int maxExpansions)
+{
+  this->inflation = inflation;
+  this->expansionsPerTick = expansionsPerTick;
+  this->maxExpansions = maxExpansions;
+}
+
+void GridPlanner::Start(Point start, Point goal)
+{
+  Cancel();
+
+  this->start = start;
+  this->goal = goal;
+  this->position = start;
+
+  if (grid == nullptr)
+  {
+    status = FAILED;
+    return;
+  }
+
+  goalX = grid->Cell(goal.x);
+  goalY = grid->Cell(goal.y);
+
+  if (BlockedCell(goalX, goalY))
+  {
+    status = FAILED;
+    return;
+  }
+
+  int64_t startKey = Key(grid->Cell(start.x), grid->Cell(start.y));
+  nodes[startKey] = Node{0, startKey, false};
+  open.push(QueueEntry(Heuristic(KeyX(startKey), KeyY(startKey)), startKey));
+  status = SEARCHING;
+}
+
+void GridPlanner::SetPosition(Point position)
+{
+  if (status != SEARCHING) this->position = position;
+}
+
+void GridPlanner::Cancel()
+{
+  status = IDLE;
+  expansions = 0;
+  nodes.clear();
+  open = decltype(open)();
+  path.clear();
+}
+
+GridPlanner::Status GridPlanner::Step()
+{
+  if (status != SEARCHING) return status;
+
+  const float diagonal = sqrt(2.0);
+  float resolution = grid->GetResolution();
+
+  for (int i = 0; i < expansionsPerTick; i++)
+  {
+    if (open.empty() || expansions >= maxExpansions)
+    {
+      status = FAILED;
+      nodes.clear();
+      open = decltype(open)();
+      return status;
+    }
+
+    int64_t key = open.top().second;
+    open.pop();
+
+    Node& node = nodes[key];
+    if (node.closed) continue;
+    node.closed = true;
+    expansions++;
+
+    int cellX = KeyX(key);
+    int cellY = KeyY(key);
+
+    if (cellX == goalX && cellY == goalY)
+    {
+      BuildPath(key);
+      status = FOUND;
+      return status;
+    }
+
+    float cost = node.cost;
+
+    for (int dy = -1; dy <= 1; dy++)
+    {
+      for (int dx = -1; dx <= 1; dx++)
+      {
+        if (dx == 0 && dy == 0) continue;
+
+        int nextX = cellX + dx;
+        int nextY = cellY + dy;
+        if (!grid->InWindow(nextX, nextY) || BlockedCell(nextX, nextY)) continue;
+
+        // Do not cut the corners of blocked cells
+        if (dx != 0 && dy != 0 && (BlockedCell(cellX + dx, cellY) || BlockedCell(cellX, cellY + dy))) continue;
+
+        float nextCost = cost + resolution * (dx != 0 && dy != 0 ? diagonal : 1);
+        int64_t nextKey = Key(nextX, nextY);
+
+        auto found = nodes.find(nextKey);
+        if (found != nodes.end() && (found->second.closed || found->second.cost <= nextCost)) continue;
+
+        nodes[nextKey] = Node{nextCost, key, false};
+        open.push(QueueEntry(nextCost + Heuristic(nextX, nextY), nextKey));
+      }
+    }
+  }
+
+  return status;
+}
+
+bool GridPlanner::BlockedCell(int cellX, int cellY) const
+{
+  float resolution = grid->GetResolution();
+
+  // The rover may be closer to an obstacle than the inflation, it still has
+  // to be able to leave
+  if (hypot(grid->CellCenter(cellX) - position.x, grid->CellCenter(cellY) - position.y) < inflation)
+  {
+    return grid->IsOccupiedCell(cellX, cellY);
+  }
+
+  int cells = (int)ceil(inflation / resolution);
+  for (int dy = -cells; dy <= cells; dy++)
+  {
+    for (int dx = -cells; dx <= cells; dx++)
+    {
+      if (hypot(dx, dy) * resolution > inflation) continue;
+      if (grid->IsOccupiedCell(cellX + dx, cellY + dy)) return true;
+    }
+  }
+
+  return false;
+}
+
+float GridPlanner::Heuristic(int cellX, int cellY) const
+{
+  // Octile distance, exact on an empty grid
+  int dx = abs(cellX - goalX);
+  int dy = abs(cellY - goalY);
+  return grid->GetResolution() * (max(dx, dy) + (sqrt(2.0) - 1) * min(dx, dy));
+}
+
+bool GridPlanner::Blocked(Point from, Point to) const
+{
+  if (grid == nullptr) return false;
+
+  float step = grid->GetResolution() / 2;
+  float length = hypot(to.x - from.x, to.y - from.y);
+  int steps = (int)ceil(length / step);
+
+  for (int i = 0; i <= steps; i++)
+  {
+    float t = steps > 0 ? (float)i / steps : 0;
+    if (BlockedCell(grid->Cell(from.x + t * (to.x - from.x)), grid->Cell(from.y + t * (to.y - from.y)))) return true;
+  }
+
+  return false;
+}
+
+void GridPlanner::BuildPath(int64_t last)
+{
+  vector<Point> cells;
+  for (int64_t key = last;; key = nodes[key].parent)
+  {
+    Point point;
+    point.x = grid->CellCenter(KeyX(key));
+    point.y = grid->CellCenter(KeyY(key));
+    point.theta = 0;
+    cells.push_back(point);
+
+    if (nodes[key].parent == key) break;
+  }
+  reverse(cells.begin(), cells.end());
+
+  cells.front() = start;
+  cells.back() = goal;
+
+  // Keep only the corners: from each kept point go as far along the cells
+  // as the straight line stays clear
+  path.clear();
+  size_t anchor = 0;
+  while (anchor + 1 < cells.size())
+  {
+    size_t next = anchor + 1;
+    while (next + 1 < cells.size() && !Blocked(cells[anchor], cells[next + 1])) next++;
+
+    path.push_back(cells[next]);
+    anchor = next;
+  }
+
+  nodes.clear();
+  open = decltype(open)();
+}
@@ -0,0 +1,88 @@
+#ifndef GRIDPLANNER_H
+#define GRIDPLANNER_H
+
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <vector>
+
+#include "OccupancyGrid.h"
+#include "Point.h"
+
+// Plans a way around the obstacles in an OccupancyGrid with A* over its
+// cells, eight connected. Cells within inflation meters of an occupied cell
+// are blocked so the rover fits through; unknown cells count as free.
+//
+// The search is spread over ticks: Step() expands at most expansionsPerTick
+// cells and a search gives up after maxExpansions. A found path is smoothed
+// into the few corners the rover has to drive to. While driving it only
+// needs replanning if one of its cells became blocked, which Blocked()
+// checks by walking the smoothed segments.
+class GridPlanner
+{
+public:
+  enum Status {
+    IDLE,
+    SEARCHING,
+    FOUND,
+    FAILED,
+  };
+
+  GridPlanner(float inflation = 0.25, int expansionsPerTick = 300, int maxExpansions = 6000);
+
+  void SetGrid(const OccupancyGrid* grid) { this->grid = grid; }
+
+  void Start(Point start, Point goal);
+
+  // Where the rover is now. Cells closer to it than the inflation are only
+  // blocked if occupied themselves, so it can leave an obstacle it got
+  // close to. Start() sets it to start; while SEARCHING it is kept there.
+  void SetPosition(Point position);
+  Status Step();
+  Status GetStatus() const { return status; }
+  void Cancel();
+
+  // The corners from start to goal, excluding start, in driving order.
+  // Valid when FOUND.
+  const std::vector<Point>& Path() const { return path; }
+
+  // Whether the straight line between two points crosses a blocked cell
+  bool Blocked(Point from, Point to) const;
+
+private:
+  struct Node {
+    float cost;
+    int64_t parent;
+    bool closed;
+  };
+
+  typedef std::pair<float, int64_t> QueueEntry; // estimated total cost, cell
+
+  static int64_t Key(int cellX, int cellY) { return ((int64_t)cellX << 32) | (uint32_t)cellY; }
+  static int KeyX(int64_t key) { return (int)(key >> 32); }
+  static int KeyY(int64_t key) { return (int)(uint32_t)key; }
+
+  bool BlockedCell(int cellX, int cellY) const;
+  float Heuristic(int cellX, int cellY) const;
+  void BuildPath(int64_t last);
+
+  const OccupancyGrid* grid = nullptr;
+  float inflation;
+  int expansionsPerTick;
+  int maxExpansions;
+
+  Status status = IDLE;
+  Point start;
+  Point goal;
+  Point position;
+  int goalX = 0;
+  int goalY = 0;
+  int expansions = 0;
+
+  std::unordered_map<int64_t, Node> nodes;
+  std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry> > open;
+
+  std::vector<Point> path;
+};
+
+#endif // GRIDPLANNER_H
@@ -0,0 +1,79 @@
+#include "LocalizationRate.h"
+
+LocalizationRate::LocalizationRate() :
+  state(MOTION_CRUISING),
+  forwarded(0),
+  dropped(0)
+{
+  for (int i = 0; i < NUM_MOTION_STATES; i++)
+  {
+    rates[i] = 0;
+  }
+}
+
+int LocalizationRate::AddInput()
+{
+  inputs.push_back(Input());
+  return inputs.size() - 1;
+}
+
+bool LocalizationRate::Update(double now, bool moving, bool precision)
+{
+  if (moving || precision || !movedBefore)
+  {
+    lastMoved = now;
+    movedBefore = true;
+  }
+
+  MotionState next = MOTION_CRUISING;
+  if (precision)
+  {
+    next = MOTION_PRECISION;
+  }
+  else if (now - lastMoved >= parkDelay)
+  {
+    next = MOTION_PARKED;
+  }
+
+  if (next == State())
+  {
+    return false;
+  }
+
+  state.store(next, std::memory_order_relaxed);
+  return true;
+}
+
+bool LocalizationRate::Accept(int input, double now)
+{
+  MotionState current = State();
+  double rate = rates[current];
+  if (rate <= 0)
+  {
+    forwarded.fetch_add(1, std::memory_order_relaxed);
+    return true;
+  }
+
+  // A wait left from a slower state is not kept in a faster one
+  Input& in = inputs[input];
+  if (in.state != current)
+  {
+    in.state = current;
+    in.nextForward = 0;
+  }
+
+  double& next = in.nextForward;
+  if (now < next)
+  {
+    dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // Step from the last forwarding time so jitter in the arrival times does
+  // not lower the rate, unless the input fell more than a period behind
+  double interval = 1.0 / rate;
+  next = now - next < interval ? next + interval : now + interval;
+
+  forwarded.fetch_add(1, std::memory_order_relaxed);
+  return true;
+}
@@ -0,0 +1,73 @@
+#ifndef LOCALIZATIONRATE_H
+#define LOCALIZATIONRATE_H
+
+#include <atomic>
+#include <vector>
+
+// Decides how many of the sensor messages the localization filters are
+// fed, from what the rover's drive is doing. A parked rover gains nothing
+// from filtering every odometry and IMU message, while the pick up and drop
+// off approaches want every one of them.
+//
+// The behaviour loop reports each tick whether the rover was driven and
+// whether a precision approach is running. The rover counts as parked once
+// it has not moved for the park delay, so it stays on the faster rate
+// through the short stops of normal driving. Moving again or starting a
+// precision approach raises the rate at once.
+//
+// Update() is called by the behaviour loop and Accept() by the thread that
+// receives the sensor messages; only the state is shared between them.
+class LocalizationRate
+{
+public:
+
+  enum MotionState {
+    MOTION_PARKED = 0,
+    MOTION_CRUISING,
+    MOTION_PRECISION,
+    NUM_MOTION_STATES
+  };
+
+  LocalizationRate();
+
+  // Messages per second forwarded on each input in the state, 0 forwards
+  // all of them
+  void SetRate(MotionState state, double rate) { rates[state] = rate; }
+
+  // Seconds without moving before the rover counts as parked
+  void SetParkDelay(double seconds) { parkDelay = seconds; }
+
+  // Returns the number to call Accept() with for one input topic
+  int AddInput();
+
+  // Returns true when the state changed
+  bool Update(double now, bool moving, bool precision);
+  MotionState State() const { return state.load(std::memory_order_relaxed); }
+
+  // Whether a message that arrived on the input at now is forwarded
+  bool Accept(int input, double now);
+
+  unsigned long ForwardedCount() const { return forwarded.load(std::memory_order_relaxed); }
+  unsigned long DroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+  double rates[NUM_MOTION_STATES];
+  double parkDelay = 2;
+
+  std::atomic<MotionState> state;
+  double lastMoved = 0;
+  bool movedBefore = false;
+
+  // Only used by Accept()
+  struct Input {
+    double nextForward = 0; // when the input may forward its next message
+    MotionState state = MOTION_CRUISING; // the state nextForward was set in
+  };
+  std::vector<Input> inputs;
+
+  std::atomic<unsigned long> forwarded;
+  std::atomic<unsigned long> dropped;
+};
+
+#endif // LOCALIZATIONRATE_H
@@ -1,47 +1,80 @@
 #include "LogicController.h"
 
+#include "TraceLog.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
 LogicController::LogicController() {
 
+  profiler.Register((Controller*)(&searchController), "search");
+  profiler.Register((Controller*)(&obstacleController), "obstacle");
+  profiler.Register((Controller*)(&pickUpController), "pickup");
+  profiler.Register((Controller*)(&range_controller), "range");
+  profiler.Register((Controller*)(&dropOffController), "dropoff");
+  profiler.Register((Controller*)(&manualWaypointController), "waypoint");
+  profiler.Register((Controller*)(&driveController), "drive");
+
+  // Waypoints are planned around what the sonars have seen
+  driveController.SetOccupancyGrid(&obstacleController.getOccupancyGrid());
+
   logicState = LOGIC_STATE_INTERRUPT;
   processState = PROCCESS_STATE_SEARCHING;
 
   ProcessData();
 
-  control_queue = priority_queue<PrioritizedController>();
+  activeController = nullptr;
 
+  NoteStateChange(STATE_REASON_RESET);
 }
 
 LogicController::~LogicController() {}
 
 void LogicController::Reset() {
 
-  std::cout << "LogicController.Reset()" << std::endl;
+  Trace(TRACE_LOGIC, TRACE_INFO, TRACE_LOGIC_RESET);
   logicState = LOGIC_STATE_INTERRUPT;
   processState = PROCCESS_STATE_SEARCHING;
 
   ProcessData();
 
-  control_queue = priority_queue<PrioritizedController>();
+  activeController = nullptr;
+
+  NoteStateChange(STATE_REASON_RESET);
 }
 
 //******************************************************************************
-// This function is called every 1/10th of a second by the ROSAdapter
+// This function is called every behaviour loop tick by the ROSAdapter
+// (1/10th of a second by default, see the behaviour_loop_rate parameter)
 // The logical flow if the behaviours is controlled here by using an interrupt,
-// haswork, and priority queue system.
+// haswork, and priority system.
 Result LogicController::DoWork()
 {
   Result result;
 
+  ConsumeSensorSnapshot();
+  recorder.Write("tick");
+
+  // Changes of the active controller alone are down to the priorities
+  stateReason = STATE_REASON_PRIORITY;
+
   // First, a loop runs through all the controllers who have a priority of 0 or
   // above with the largest number being most important. A priority of less than
   // 0 is an ignored controller (we will use -1 as the standard for an ignored
   // controller). If any controller needs an interrupt, the logic state is
   // changed to interrupt
-  for(PrioritizedController cntrlr : prioritizedControllers)
+  for(const PrioritizedController& cntrlr : sortedControllers)
   {
-    if(cntrlr.controller->ShouldInterrupt() && cntrlr.priority >= 0)
+    bool interrupt;
+    {
+      ControllerProfiler::Scope timer(profiler, cntrlr.controller, ControllerProfiler::SHOULD_INTERRUPT);
+      interrupt = cntrlr.controller->ShouldInterrupt();
+    }
+    if(interrupt && cntrlr.priority >= 0)
     {
       logicState = LOGIC_STATE_INTERRUPT;
+      stateReason = STATE_REASON_INTERRUPT;
       // Do not break out of the for loop! All shouldInterupts may need calling
       // in order to properly pre-proccess data.
     }
@@ -54,26 +87,27 @@ Result LogicController::DoWork()
   // ***************************************************************************
 
   // Enter this state when an interrupt has been thrown or there are no pending
-  // control_queue.top().actions.
+  // activeController actions.
   case LOGIC_STATE_INTERRUPT: {
-    // Reset the control queue
-    control_queue = priority_queue<PrioritizedController>();
-
-    // Check what controllers have work to do.. Every controller, where
-    // HasWork() == true, will be added to the priority queue.
-    for(PrioritizedController cntrlr : prioritizedControllers) {
-      if(cntrlr.controller->HasWork()) {
-        if (cntrlr.priority < 0) {
-          continue;
-        }
-        else {
-          control_queue.push(cntrlr);
-        }
+    // Check what controllers have work to do. HasWork() is asked of every
+    // controller since some keep timers up to date in it, but only controllers
+    // with a priority of 0 or above get a bit in the work mask.
+    workMask = 0;
+    for(int i = 0; i < NUM_PRIORITIZED_CONTROLLERS; i++) {
+      bool hasWork;
+      {
+        ControllerProfiler::Scope timer(profiler, sortedControllers[i].controller, ControllerProfiler::HAS_WORK);
+        hasWork = sortedControllers[i].controller->HasWork();
+      }
+      if(hasWork && i < activeControllerCount) {
+        workMask |= 1u << i;
       }
     }
 
     // If no controlers have work, report this to ROS Adapter and do nothing.
-    if(control_queue.empty()) {
+    if(workMask == 0) {
+      activeController = nullptr;
+      stateReason = STATE_REASON_NO_WORK;
       result.type = behavior;
       result.b = wait;
       break;
@@ -84,8 +118,13 @@ Result LogicController::DoWork()
       result.b = noChange;
     }
 
-    // Take the top member of the priority queue and run its do work function.
-    result = control_queue.top().controller->DoWork();
+    // sortedControllers is in descending priority order, so the lowest set
+    // bit is the most important controller with work. Run its do work function.
+    activeController = sortedControllers[__builtin_ctz(workMask)].controller;
+    {
+      ControllerProfiler::Scope timer(profiler, activeController, ControllerProfiler::DO_WORK);
+      result = activeController->DoWork();
+    }
 
     // Analyze the result that was returned and do state changes accordingly.
     // Behavior types are used to indicate behavior changes.
@@ -96,7 +135,7 @@ Result LogicController::DoWork()
       // with other controllers.
       if (result.reset) {
         controllerInterconnect(); // Allow controller to communicate state data before it is reset.
-        control_queue.top().controller->Reset();
+        activeController->Reset();
       }
 
       // Ask for the procces state to change to the next state or loop around to the begining.
@@ -109,6 +148,7 @@ Result LogicController::DoWork()
       //    PROCESS_STATE_MANUAL // robot is under manual control
       //  };
       if(result.b == nextProcess) {
+        stateReason = STATE_REASON_NEXT_PROCESS;
         if (processState == _LAST - 1) {
           processState = _FIRST;
         }
@@ -118,6 +158,7 @@ Result LogicController::DoWork()
       }
       // Ask for the procces state to change to the previouse state or loop around to the end.
       else if(result.b == prevProcess) {
+        stateReason = STATE_REASON_PREV_PROCESS;
         if (processState == _FIRST) {
           processState = (ProcessState)((int)_LAST - 1);
         }
@@ -142,6 +183,7 @@ Result LogicController::DoWork()
     else if(result.type == precisionDriving) {
 
       logicState = LOGIC_STATE_PRECISION_COMMAND;
+      stateReason = STATE_REASON_PRECISION;
       break;
 
     }
@@ -151,6 +193,7 @@ Result LogicController::DoWork()
     else if(result.type == waypoint) {
 
       logicState = LOGIC_STATE_WAITING;
+      stateReason = STATE_REASON_WAYPOINT;
       driveController.SetResultData(result);
       // Fall through on purpose to "case LOGIC_STATE_WAITING:"
     }
@@ -170,14 +213,23 @@ Result LogicController::DoWork()
     // Ask drive controller how to drive: specifically, return commands to be
     // passed to the ROS Adapter such as left and right wheel PWM values in the
     // result struct.
-    result = driveController.DoWork();
+    {
+      ControllerProfiler::Scope timer(profiler, (Controller*)(&driveController), ControllerProfiler::DO_WORK);
+      result = driveController.DoWork();
+    }
 
     // When out of waypoints, the drive controller will throw an interrupt.
     // However, unlike other controllers, drive controller is not on the
     // priority queue so it must be checked here.
     if (result.type == behavior) {
-      if(driveController.ShouldInterrupt()) {
+      bool interrupt;
+      {
+        ControllerProfiler::Scope timer(profiler, (Controller*)(&driveController), ControllerProfiler::SHOULD_INTERRUPT);
+        interrupt = driveController.ShouldInterrupt();
+      }
+      if(interrupt) {
         logicState = LOGIC_STATE_INTERRUPT;
+        stateReason = STATE_REASON_WAYPOINTS_DONE;
       }
     }
     break;
@@ -195,7 +247,10 @@ Result LogicController::DoWork()
 
     // Unlike waypoints, precision commands change every update tick, so we ask
     // the controller for new commands on every update tick.
-    result = control_queue.top().controller->DoWork();
+    {
+      ControllerProfiler::Scope timer(profiler, activeController, ControllerProfiler::DO_WORK);
+      result = activeController->DoWork();
+    }
 
     // Pass the driving commands to the drive controller so it can interpret them.
     driveController.SetResultData(result);
@@ -203,7 +258,10 @@ Result LogicController::DoWork()
     // The interpreted commands are turned into proper initial_spiral_offset
     // motor commands to be passed the ROS Adapter such as left and right wheel
     // PWM values in the result struct.
-    result = driveController.DoWork();
+    {
+      ControllerProfiler::Scope timer(profiler, (Controller*)(&driveController), ControllerProfiler::DO_WORK);
+      result = driveController.DoWork();
+    }
     break;
 
   }
@@ -217,6 +275,21 @@ Result LogicController::DoWork()
   // depending on the processState.
   controllerInterconnect();
 
+  NoteStateChange(stateReason);
+
+  if (recorder.IsOpen())
+  {
+    // b is only meaningful for behavior results and is left unset otherwise.
+    recorder.Write("result %d %d %.9g %.9g %.9g %.9g", (int)result.type,
+                   result.type == behavior ? (int)result.b : 0,
+                   result.pd.left, result.pd.right, result.fingerAngle, result.wristAngle);
+  }
+
+  if (flightRecorder.IsOpen())
+  {
+    RecordFlight(result);
+  }
+
   // Give the ROSAdapter the final decision on how it should drive.
   return result;
 }
@@ -234,52 +307,74 @@ void LogicController::ProcessData()
   // This controller priority is used when searching.
   if (processState == PROCCESS_STATE_SEARCHING)
   {
-    prioritizedControllers = {
+    prioritizedControllers = {{
       PrioritizedController{0, (Controller*)(&searchController)},
       PrioritizedController{10, (Controller*)(&obstacleController)},
       PrioritizedController{15, (Controller*)(&pickUpController)},
       PrioritizedController{5, (Controller*)(&range_controller)},
       PrioritizedController{-1, (Controller*)(&dropOffController)},
       PrioritizedController{-1, (Controller*)(&manualWaypointController)}
-    };
+    }};
   }
 
   // This priority is used when returning a target to the center collection zone.
   else if (processState  == PROCCESS_STATE_TARGET_PICKEDUP)
   {
-    prioritizedControllers = {
+    prioritizedControllers = {{
     PrioritizedController{-1, (Controller*)(&searchController)},
     PrioritizedController{15, (Controller*)(&obstacleController)},
     PrioritizedController{-1, (Controller*)(&pickUpController)},
     PrioritizedController{10, (Controller*)(&range_controller)},
     PrioritizedController{1, (Controller*)(&dropOffController)},
     PrioritizedController{-1, (Controller*)(&manualWaypointController)}
-    };
+    }};
   }
 
   // This priority is used when returning a target to the center collection zone.
   else if (processState  == PROCCESS_STATE_DROP_OFF)
   {
-    prioritizedControllers = {
+    prioritizedControllers = {{
       PrioritizedController{-1, (Controller*)(&searchController)},
       PrioritizedController{-1, (Controller*)(&obstacleController)},
       PrioritizedController{-1, (Controller*)(&pickUpController)},
       PrioritizedController{10, (Controller*)(&range_controller)},
       PrioritizedController{1, (Controller*)(&dropOffController)},
       PrioritizedController{-1, (Controller*)(&manualWaypointController)}
-    };
+    }};
   }
 
   // Under manual control ONLY the manual waypoint controller is active.
   else if (processState == PROCESS_STATE_MANUAL) {
-    prioritizedControllers = {
+    prioritizedControllers = {{
       PrioritizedController{-1, (Controller*)(&searchController)},
       PrioritizedController{-1, (Controller*)(&obstacleController)},
       PrioritizedController{-1, (Controller*)(&pickUpController)},
       PrioritizedController{-1, (Controller*)(&range_controller)},
       PrioritizedController{-1, (Controller*)(&dropOffController)},
       PrioritizedController{5,  (Controller*)(&manualWaypointController)}
-    };
+    }};
+  }
+
+  SortControllers();
+}
+
+// Rebuilds sortedControllers from prioritizedControllers. Only called when
+// the priorities change so DoWork() never has to sort or build a heap.
+void LogicController::SortControllers()
+{
+  sortedControllers = prioritizedControllers;
+
+  // Stable so controllers with equal priority keep their table order.
+  std::stable_sort(sortedControllers.begin(), sortedControllers.end(),
+                   [](const PrioritizedController& a, const PrioritizedController& b) {
+                     return b < a;
+                   });
+
+  activeControllerCount = 0;
+  while (activeControllerCount < NUM_PRIORITIZED_CONTROLLERS &&
+         sortedControllers[activeControllerCount].priority >= 0)
+  {
+    activeControllerCount++;
   }
 }
 
@@ -344,99 +439,610 @@ void LogicController::controllerInterconnect()
 
 }
 
-// Receives position in the world inertial frame (should rename to SetOdomPositionData).
-void LogicController::SetPositionData(Point currentLocation)
+// Receives position in the world inertial frame. The velocity is needed by
+// the drive controller to update the velocity sent back to the RosAdapter
+// correctly.
+void LogicController::SetPositionData(const PoseSample& odom)
 {
-  searchController.SetCurrentLocation(currentLocation);
-  dropOffController.SetCurrentLocation(currentLocation);
-  obstacleController.setCurrentLocation(currentLocation);
-  driveController.SetCurrentLocation(currentLocation);
-  manualWaypointController.SetCurrentLocation(currentLocation);
+  std::lock_guard<std::mutex> lock(sensorWriteMutex);
+  pendingSnapshot.position = odom.pose;
+  pendingSnapshot.positionUpdates++;
+  pendingSnapshot.linearVelocity = odom.linearVelocity;
+  pendingSnapshot.angularVelocity = odom.angularVelocity;
+  pendingSnapshot.velocityUpdates++;
+  sensorSnapshot.Store(pendingSnapshot);
 }
 
 // Recieves position in the world frame with global data (GPS).
-void LogicController::SetMapPositionData(Point currentLocation)
+void LogicController::SetMapPositionData(const PoseSample& map)
 {
-  range_controller.setCurrentLocation(currentLocation);
+  std::lock_guard<std::mutex> lock(sensorWriteMutex);
+  pendingSnapshot.mapPosition = map.pose;
+  pendingSnapshot.mapPositionUpdates++;
+  pendingSnapshot.mapLinearVelocity = map.linearVelocity;
+  pendingSnapshot.mapAngularVelocity = map.angularVelocity;
+  pendingSnapshot.mapVelocityUpdates++;
+  sensorSnapshot.Store(pendingSnapshot);
 }
 
-// Sets the velocity data for the driveController. This information is
-// necessary so that the drive controller can update the velocity sent
-// back to the RosAdapter correctly.
-void LogicController::SetVelocityData(float linearVelocity, float angularVelocity)
+// Give the specified controllers a list of visible april tags.
+void LogicController::SetAprilTags(vector<Tag>& tags)
 {
-  driveController.SetVelocityData(linearVelocity,angularVelocity);
+  incomingTagBatch.Assign(tags);
+  TagSummary summary;
+  summary.Build(incomingTagBatch);
+
+  std::lock_guard<std::mutex> lock(sensorWriteMutex);
+  pendingTags.swap(tags);
+  std::swap(pendingTagBatch, incomingTagBatch);
+  pendingTagSummary = summary;
+  pendingSnapshot.tagUpdates++;
+  sensorSnapshot.Store(pendingSnapshot);
 }
 
-void LogicController::SetMapVelocityData(float linearVelocity, float angularVelocity)
+// Give the specified controllers the sonar sensor values.
+void LogicController::SetSonarData(float left, float center, float right)
 {
+  std::lock_guard<std::mutex> lock(sensorWriteMutex);
+  pendingSnapshot.sonarLeft = left;
+  pendingSnapshot.sonarCenter = center;
+  pendingSnapshot.sonarRight = right;
+  pendingSnapshot.sonarUpdates++;
+  sensorSnapshot.Store(pendingSnapshot);
 }
 
-// Give the specified controllers a list of visible april tags.
-void LogicController::SetAprilTags(vector<Tag> tags)
+SensorSnapshot LogicController::GetSensorSnapshot() const
 {
-  pickUpController.SetTagData(tags);
-  obstacleController.setTagData(tags);
-  dropOffController.SetTargetData(tags);
-  searchController.setTags(tags);
+  return sensorSnapshot.Load();
 }
 
-// Give the specified controllers the sonar sensor values.
-void LogicController::SetSonarData(float left, float center, float right)
+void LogicController::ConsumeSensorSnapshot()
+{
+  SensorSnapshot snapshot = sensorSnapshot.Load();
+
+  if (snapshot.tagUpdates != consumedSnapshot.tagUpdates)
+  {
+    // A batch may have come in since the Load(), so the generation that is
+    // consumed is the one swapped in, not the loaded one
+    std::lock_guard<std::mutex> lock(sensorWriteMutex);
+    tickTags.swap(pendingTags);
+    std::swap(tickTagBatch, pendingTagBatch);
+    tickTagSummary = pendingTagSummary;
+    snapshot.tagUpdates = pendingSnapshot.tagUpdates;
+  }
+
+  if (recorder.IsOpen())
+  {
+    RecordSensorInputs(snapshot);
+  }
+
+  if (snapshot.positionUpdates != consumedSnapshot.positionUpdates)
+  {
+    searchController.SetCurrentLocation(snapshot.position);
+    dropOffController.SetCurrentLocation(snapshot.position);
+    pickUpController.SetCurrentLocation(snapshot.position);
+    obstacleController.setCurrentLocation(snapshot.position);
+    driveController.SetCurrentLocation(snapshot.position);
+    manualWaypointController.SetCurrentLocation(snapshot.position);
+  }
+
+  if (snapshot.mapPositionUpdates != consumedSnapshot.mapPositionUpdates)
+  {
+    range_controller.setCurrentLocation(snapshot.mapPosition);
+  }
+
+  if (snapshot.velocityUpdates != consumedSnapshot.velocityUpdates)
+  {
+    driveController.SetVelocityData(snapshot.linearVelocity, snapshot.angularVelocity);
+  }
+
+  if (snapshot.sonarUpdates != consumedSnapshot.sonarUpdates)
+  {
+    // The pickUpController only needs the center data in order to tell if
+    // an april tag cube has been picked up correctly.
+    pickUpController.SetSonarData(snapshot.sonarCenter);
+
+    obstacleController.setSonarData(snapshot.sonarLeft, snapshot.sonarCenter, snapshot.sonarRight);
+  }
+
+  if (snapshot.tagUpdates != consumedSnapshot.tagUpdates)
+  {
+    pickUpController.SetTagData(tickTagBatch, tickTagSummary);
+    obstacleController.setTagData(tickTagSummary);
+    dropOffController.SetTargetData(tickTagSummary);
+    searchController.setTags(tickTags);
+  }
+
+  UpdateTargetBlackboard(snapshot, snapshot.tagUpdates != consumedSnapshot.tagUpdates);
+  UpdateNestScheduler(snapshot);
+
+  consumedSnapshot = snapshot;
+}
+
+void LogicController::UpdateTargetBlackboard(const SensorSnapshot& snapshot, bool tagsChanged)
+{
+  // The shared frame is relative to the center
+  if (!centerLocationMapKnown) return;
+
+  targetBlackboard.Expire(current_time);
+
+  // Only while searching; a held cube is in view of the camera the rest of
+  // the time
+  if (processState != PROCCESS_STATE_SEARCHING) return;
+
+  float roverX = snapshot.mapPosition.x - centerLocationMap.x;
+  float roverY = snapshot.mapPosition.y - centerLocationMap.y;
+
+  if (tagsChanged && tickTagSummary.targets > 0)
+  {
+    // The same camera geometry as PickUpController::SetTagData()
+    const float cameraHeight = 0.195; // meters
+    const float cameraOffsetCorrection = 0.023;
+    // Cubes already dropped off are not worth sharing
+    const float collectionZoneRadius = 0.75;
+
+    tickTagBatch.GroundDistances(cameraHeight, tagGroundDistances);
+
+    seenCells.clear();
+    for (size_t i = 0; i < tickTagBatch.size(); i++)
+    {
+      if (tickTagBatch.id[i] != TagSummary::TARGET_ID) continue;
+
+      float distance = tagGroundDistances[i];
+      float bearing = snapshot.mapPosition.theta - atan2(tickTagBatch.x[i] + cameraOffsetCorrection, distance);
+
+      float x = roverX + distance * cos(bearing);
+      float y = roverY + distance * sin(bearing);
+      if (hypot(x, y) < collectionZoneRadius) continue;
+
+      SeenCell cell = {targetBlackboard.Cell(x), targetBlackboard.Cell(y), 1};
+      auto same = std::find_if(seenCells.begin(), seenCells.end(),
+                               [&cell](const SeenCell& seen) { return seen.x == cell.x && seen.y == cell.y; });
+      if (same != seenCells.end()) same->count++;
+      else seenCells.push_back(cell);
+    }
+
+    for (const SeenCell& cell : seenCells)
+    {
+      targetBlackboard.ObserveCell(cell.x, cell.y, cell.count, current_time, true);
+    }
+  }
+
+  int cellX, cellY;
+
+  if (searchController.ReachedKnownTarget() && targetBlackboard.GetLocalClaim(cellX, cellY))
+  {
+    // Cubes there would have been seen on the way in
+    const long emptyBucketTime = 3000; // ms
+    if (current_time - targetBlackboard.LastSeen(cellX, cellY) > emptyBucketTime)
+    {
+      targetBlackboard.ObserveCell(cellX, cellY, 0, current_time, true);
+    }
+    else
+    {
+      // Otherwise the bucket is the nearest one again on the next tick
+      targetBlackboard.Visit(cellX, cellY, current_time);
+    }
+    targetBlackboard.ReleaseLocalClaim();
+  }
+
+  if (searchController.HasKnownTarget())
+  {
+    // Another rover found the bucket empty or it decayed
+    if (!targetBlackboard.GetLocalClaim(cellX, cellY))
+    {
+      searchController.ClearKnownTarget();
+    }
+    return;
+  }
+
+  if (targetBlackboard.NearestUnclaimed(roverX, roverY, cellX, cellY))
+  {
+    targetBlackboard.Claim(cellX, cellY, "", current_time);
+    searchController.SetKnownTarget(SharedToOdom(targetBlackboard.CellCenter(cellX), targetBlackboard.CellCenter(cellY), snapshot));
+  }
+}
+
+Point LogicController::SharedToOdom(float x, float y, const SensorSnapshot& snapshot) const
+{
+  // The map and odometry frames only differ by a rotation and the center
+  float rotation = snapshot.position.theta - snapshot.mapPosition.theta;
+
+  Point odom;
+  odom.x = centerLocationOdom.x + x * cos(rotation) - y * sin(rotation);
+  odom.y = centerLocationOdom.y + x * sin(rotation) + y * cos(rotation);
+  odom.theta = 0;
+  return odom;
+}
+
+void LogicController::UpdateNestScheduler(const SensorSnapshot& snapshot)
+{
+  // The shared frame is relative to the center
+  if (!centerLocationMapKnown) return;
+
+  bool returning = processState == PROCCESS_STATE_TARGET_PICKEDUP || processState == PROCCESS_STATE_DROP_OFF;
+  bool wanted = returning && dropOffController.HasTarget() && !dropOffController.HasReachedCollectionPoint();
+
+  Point rover;
+  rover.x = snapshot.mapPosition.x - centerLocationMap.x;
+  rover.y = snapshot.mapPosition.y - centerLocationMap.y;
+  rover.theta = snapshot.mapPosition.theta;
+  nestScheduler.Update(rover, wanted, current_time);
+
+  Point holding = nestScheduler.HoldingPoint();
+  dropOffController.SetNestAccess(!nestScheduler.IsRequesting() || nestScheduler.IsGranted(), SharedToOdom(holding.x, holding.y, snapshot));
+}
+
+void LogicController::SetNestScheduler(const std::string& rover, float holdingRadius, float requestRadius)
+{
+  recorder.Write("nest_scheduler %s %.9g %.9g", rover.c_str(), holdingRadius, requestRadius);
+  nestScheduler.SetName(rover);
+  nestScheduler.SetRadii(holdingRadius, requestRadius);
+}
+
+void LogicController::AddNestRequest(const std::string& rover, long requestTime, float bearing, bool granted)
 {
-  // The pickUpController only needs the center data in order to tell if
-  // an april tag cube has been picked up correctly.
-  pickUpController.SetSonarData(center);
+  recorder.Write("nest_request %s %ld %.9g %d", rover.c_str(), requestTime, bearing, (int)granted);
+  nestScheduler.AddRemote(rover, requestTime, bearing, granted, current_time);
+}
+
+void LogicController::RemoveNestRequest(const std::string& rover)
+{
+  recorder.Write("nest_release %s", rover.c_str());
+  nestScheduler.RemoveRemote(rover);
+}
+
+RoverAvoidance::Intent LogicController::GetIntent()
+{
+  if (processState == PROCESS_STATE_MANUAL) return RoverAvoidance::INTENT_MANUAL;
+  if (dropOffController.HasReachedCollectionPoint()) return RoverAvoidance::INTENT_LEAVING;
+  if (!dropOffController.HasTarget()) return RoverAvoidance::INTENT_SEARCHING;
+  if (dropOffController.IsApproachingCenter()) return RoverAvoidance::INTENT_DROPPING;
+  return RoverAvoidance::INTENT_RETURNING;
+}
+
+const char* LogicController::GetProcessStateName() const
+{
+  return ProcessStateName(processState);
+}
+
+const char* LogicController::ProcessStateName(uint8_t processState)
+{
+  switch (processState)
+  {
+  case PROCCESS_STATE_SEARCHING: return "SEARCHING";
+  case PROCCESS_STATE_TARGET_PICKEDUP: return "TARGET_PICKEDUP";
+  case PROCCESS_STATE_DROP_OFF: return "DROP_OFF";
+  case PROCESS_STATE_MANUAL: return "MANUAL";
+  default: return "UNKNOWN";
+  }
+}
 
-  obstacleController.setSonarData(left,center,right);
+bool LogicController::IsPrecisionDriving() const
+{
+  return logicState == LOGIC_STATE_PRECISION_COMMAND &&
+    (activeController == (const Controller*)(&pickUpController) ||
+     activeController == (const Controller*)(&dropOffController));
+}
+
+DetectionHint::Mode LogicController::GetDetectionMode() const
+{
+  if (activeController == (const Controller*)(&pickUpController))
+  {
+    return DetectionHint::DETECT_TARGETS;
+  }
+  if (activeController == (const Controller*)(&dropOffController) &&
+      dropOffController.IsApproachingCenter())
+  {
+    return DetectionHint::DETECT_CENTER;
+  }
+  return DetectionHint::DETECT_ALL;
+}
+
+void LogicController::SetTargetBlackboard(float resolution, float decayTime)
+{
+  recorder.Write("target_blackboard %.9g %.9g", resolution, decayTime);
+  targetBlackboard.SetResolution(resolution);
+  targetBlackboard.SetDecayTime(decayTime * 1000);
+}
+
+void LogicController::AddSharedSighting(float x, float y, int count)
+{
+  recorder.Write("shared_sighting %.9g %.9g %d", x, y, count);
+  targetBlackboard.Observe(x, y, count, current_time, false);
+}
+
+void LogicController::AddSharedClaim(const std::string& rover, float x, float y)
+{
+  recorder.Write("shared_claim %s %.9g %.9g", rover.c_str(), x, y);
+  targetBlackboard.Claim(targetBlackboard.Cell(x), targetBlackboard.Cell(y), rover, current_time);
+}
+
+std::vector<TargetBlackboard::Bucket> LogicController::TakeSharedSightings()
+{
+  return targetBlackboard.TakeLocalChanges();
+}
+
+bool LogicController::GetSharedClaim(int& cellX, int& cellY)
+{
+  return targetBlackboard.GetLocalClaim(cellX, cellY);
+}
+
+// Sensor inputs are recorded as they are consumed rather than when they
+// arrive, so a replay hands every controller the same values on the same
+// tick regardless of how the sensor threads were scheduled.
+void LogicController::RecordSensorInputs(const SensorSnapshot& snapshot)
+{
+  if (snapshot.positionUpdates != consumedSnapshot.positionUpdates)
+  {
+    recorder.Write("position %.9g %.9g %.9g", snapshot.position.x, snapshot.position.y, snapshot.position.theta);
+  }
+
+  if (snapshot.mapPositionUpdates != consumedSnapshot.mapPositionUpdates)
+  {
+    recorder.Write("map_position %.9g %.9g %.9g", snapshot.mapPosition.x, snapshot.mapPosition.y, snapshot.mapPosition.theta);
+  }
+
+  if (snapshot.velocityUpdates != consumedSnapshot.velocityUpdates)
+  {
+    recorder.Write("velocity %.9g %.9g", snapshot.linearVelocity, snapshot.angularVelocity);
+  }
+
+  if (snapshot.mapVelocityUpdates != consumedSnapshot.mapVelocityUpdates)
+  {
+    recorder.Write("map_velocity %.9g %.9g", snapshot.mapLinearVelocity, snapshot.mapAngularVelocity);
+  }
+
+  if (snapshot.sonarUpdates != consumedSnapshot.sonarUpdates)
+  {
+    recorder.Write("sonar %.9g %.9g %.9g", snapshot.sonarLeft, snapshot.sonarCenter, snapshot.sonarRight);
+  }
+
+  if (snapshot.tagUpdates != consumedSnapshot.tagUpdates)
+  {
+    string line = "tags " + to_string(tickTags.size());
+    char field[128];
+    for (const Tag& tag : tickTags)
+    {
+      snprintf(field, sizeof (field), " %d %.9g %.9g %.9g %.9g %.9g %.9g %.9g", tag.getID(),
+               tag.getPositionX(), tag.getPositionY(), tag.getPositionZ(),
+               tag.getOrientationX(), tag.getOrientationY(), tag.getOrientationZ(), tag.getOrientationW());
+      line += field;
+    }
+    recorder.Write("%s", line.c_str());
+  }
+}
+
+bool LogicController::RecordTo(const std::string& path)
+{
+  return recorder.Open(path);
+}
+
+bool LogicController::FlightRecordTo(const std::string& path, uint32_t records)
+{
+  return flightRecorder.Open(path, records);
+}
+
+bool LogicController::DumpFlightRecord(const std::string& path) const
+{
+  return flightRecorder.Dump(path);
+}
+
+void LogicController::RecordFlight(const Result& result)
+{
+  const SensorSnapshot& snapshot = consumedSnapshot;
+
+  FlightRecord record;
+  record.time = current_time;
+
+  record.x = snapshot.position.x;
+  record.y = snapshot.position.y;
+  record.theta = snapshot.position.theta;
+  record.mapX = snapshot.mapPosition.x;
+  record.mapY = snapshot.mapPosition.y;
+  record.mapTheta = snapshot.mapPosition.theta;
+  record.linearVelocity = snapshot.linearVelocity;
+  record.angularVelocity = snapshot.angularVelocity;
+  record.sonarLeft = snapshot.sonarLeft;
+  record.sonarCenter = snapshot.sonarCenter;
+  record.sonarRight = snapshot.sonarRight;
+
+  record.tags = tickTagSummary.tags;
+  record.targets = tickTagSummary.targets;
+  record.centers = tickTagSummary.centers;
+  record.closestTarget = tickTagSummary.closestTarget;
+  record.closestTargetRange = tickTagSummary.closestTargetRange;
+  record.centersDistance = tickTagSummary.centersDistance;
+  record.centersBearing = tickTagSummary.centersBearing;
+
+  record.processState = processState;
+  record.logicState = logicState;
+  record.controller = ControllerId(activeController);
+  record.workMask = workMask;
+
+  record.resultType = result.type;
+  record.behaviorTrigger = result.type == behavior ? result.b : 0;
+  record.left = result.pd.left;
+  record.right = result.pd.right;
+  record.fingerAngle = result.fingerAngle;
+  record.wristAngle = result.wristAngle;
+
+  flightRecorder.Record(record);
+}
+
+void LogicController::NoteStateChange(StateEventReason reason)
+{
+  StateEvent event;
+  event.time = current_time;
+  event.processState = processState;
+  event.logicState = logicState;
+  event.controller = ControllerId(activeController);
+  event.reason = reason;
+
+  if (event.processState == lastStateEvent.processState &&
+      event.logicState == lastStateEvent.logicState &&
+      event.controller == lastStateEvent.controller)
+  {
+    return;
+  }
+
+  if (stateEvents.size() >= MAX_STATE_EVENTS)
+  {
+    stateEvents.erase(stateEvents.begin());
+  }
+  stateEvents.push_back(event);
+  lastStateEvent = event;
+}
+
+std::vector<StateEvent> LogicController::TakeStateEvents()
+{
+  std::vector<StateEvent> events;
+  events.swap(stateEvents);
+  return events;
+}
+
+FlightController LogicController::ControllerId(const Controller* controller) const
+{
+  if (controller == (const Controller*)(&searchController)) return FLIGHT_SEARCH;
+  if (controller == (const Controller*)(&obstacleController)) return FLIGHT_OBSTACLE;
+  if (controller == (const Controller*)(&pickUpController)) return FLIGHT_PICKUP;
+  if (controller == (const Controller*)(&range_controller)) return FLIGHT_RANGE;
+  if (controller == (const Controller*)(&dropOffController)) return FLIGHT_DROPOFF;
+  if (controller == (const Controller*)(&manualWaypointController)) return FLIGHT_WAYPOINT;
+  if (controller == (const Controller*)(&driveController)) return FLIGHT_DRIVE;
+  return FLIGHT_NONE;
 }
 
 // Called once by RosAdapter in guarded init.
 void LogicController::SetCenterLocationOdom(Point centerLocationOdom)
 {
+  recorder.Write("center_odom %.9g %.9g %.9g", centerLocationOdom.x, centerLocationOdom.y, centerLocationOdom.theta);
+  this->centerLocationOdom = centerLocationOdom;
   searchController.SetCenterLocation(centerLocationOdom);
   dropOffController.SetCenterLocation(centerLocationOdom);
 }
 
 void LogicController::AddManualWaypoint(Point manualWaypoint, int waypoint_id)
 {
+  recorder.Write("waypoint_add %d %.9g %.9g", waypoint_id, manualWaypoint.x, manualWaypoint.y);
   manualWaypointController.AddManualWaypoint(manualWaypoint, waypoint_id);
 }
 
 void LogicController::RemoveManualWaypoint(int waypoint_id)
 {
+  recorder.Write("waypoint_remove %d", waypoint_id);
   manualWaypointController.RemoveManualWaypoint(waypoint_id);
 }
 
 std::vector<int> LogicController::GetClearedWaypoints()
 {
+  // Reading clears the list, so the replay has to make the same call.
+  recorder.Write("cleared_waypoints");
   return manualWaypointController.ReachedWaypoints();
 }
 
-void LogicController::setVirtualFenceOn( RangeShape* range )
+// Writes shape as the replay reads it: "circle <x> <y> <r>",
+// "rect <x> <y> <w> <h>", "polygon <n> <x> <y>..." or "multi <n> <shape>..."
+static void DescribeRangeShape(const RangeShape* shape, std::string& out)
+{
+  char buffer[128]; // room for a rectangle's four numbers at full %.9g length
+  Point center = shape->getCenter();
+
+  if (const RangeCircle* circle = dynamic_cast<const RangeCircle*>(shape))
+  {
+    snprintf(buffer, sizeof(buffer), "circle %.9g %.9g %.9g", center.x, center.y, circle->getRadius());
+    out += buffer;
+  }
+  else if (const RangeRectangle* rectangle = dynamic_cast<const RangeRectangle*>(shape))
+  {
+    snprintf(buffer, sizeof(buffer), "rect %.9g %.9g %.9g %.9g", center.x, center.y, rectangle->getWidth(), rectangle->getHeight());
+    out += buffer;
+  }
+  else if (const RangePolygon* polygon = dynamic_cast<const RangePolygon*>(shape))
+  {
+    snprintf(buffer, sizeof(buffer), "polygon %zu", polygon->getVertices().size());
+    out += buffer;
+    for (const Point& vertex : polygon->getVertices())
+    {
+      snprintf(buffer, sizeof(buffer), " %.9g %.9g", vertex.x, vertex.y);
+      out += buffer;
+    }
+  }
+  else if (const RangeMultiRegion* multi = dynamic_cast<const RangeMultiRegion*>(shape))
+  {
+    snprintf(buffer, sizeof(buffer), "multi %zu", multi->getRegions().size());
+    out += buffer;
+    for (const auto& region : multi->getRegions())
+    {
+      out += " ";
+      DescribeRangeShape(region.get(), out);
+    }
+  }
+}
+
+void LogicController::setVirtualFenceOn( std::shared_ptr<const RangeShape> range )
 {
+  if (recorder.IsOpen())
+  {
+    std::string shape;
+    DescribeRangeShape(range.get(), shape);
+    recorder.Write("fence %s", shape.c_str());
+  }
+
   range_controller.setRangeShape(range);
   range_controller.setEnabled(true);
 }
 
 void LogicController::setVirtualFenceOff()
 {
+  recorder.Write("fence_off");
   range_controller.setEnabled(false);
 }
 
 void LogicController::SetCenterLocationMap(Point centerLocationMap)
 {
+  recorder.Write("center_map %.9g %.9g %.9g", centerLocationMap.x, centerLocationMap.y, centerLocationMap.theta);
+  this->centerLocationMap = centerLocationMap;
+  centerLocationMapKnown = true;
 }
 
 void LogicController::SetCurrentTimeInMilliSecs( long int time )
 {
+  recorder.Write("time %ld", time);
   current_time = time;
   dropOffController.SetCurrentTimeInMilliSecs( time );
   pickUpController.SetCurrentTimeInMilliSecs( time );
   obstacleController.setCurrentTimeInMilliSecs( time );
+  driveController.SetCurrentTimeInMilliSecs( time );
+}
+
+void LogicController::SetSwarmPosition(int index, int count)
+{
+  recorder.Write("swarm_position %d %d", index, count);
+  searchController.SetSwarmPosition(index, count);
+}
+
+void LogicController::SetSearchLanes(float firstLaneRadius, float laneSpacing, float maxLaneRadius)
+{
+  recorder.Write("search_lanes %.9g %.9g %.9g", firstLaneRadius, laneSpacing, maxLaneRadius);
+  searchController.SetLanes(firstLaneRadius, laneSpacing, maxLaneRadius);
+}
+
+void LogicController::SetRandomSeed(uint64_t seed, uint64_t stream)
+{
+  recorder.Write("random_seed %llu %llu", (unsigned long long)seed, (unsigned long long)stream);
+  RandomStream root(seed, stream);
+  dropOffController.SetRandomStream(root.Split(RANDOM_STREAM_DROP_OFF));
+}
+
+void LogicController::SetRandomSpinStart(bool randomSpinStart)
+{
+  recorder.Write("random_spin_start %d", randomSpinStart ? 1 : 0);
+  dropOffController.SetRandomSpinStart(randomSpinStart);
 }
 
 void LogicController::SetModeAuto() {
+  recorder.Write("mode auto");
   if(processState == PROCESS_STATE_MANUAL) {
     // only do something if we are in manual mode
     this->Reset();
@@ -445,11 +1051,13 @@ void LogicController::SetModeAuto() {
 }
 void LogicController::SetModeManual()
 {
+  recorder.Write("mode manual");
   if(processState != PROCESS_STATE_MANUAL) {
     logicState = LOGIC_STATE_INTERRUPT;
     processState = PROCESS_STATE_MANUAL;
     ProcessData();
-    control_queue = priority_queue<PrioritizedController>();
+    activeController = nullptr;
     driveController.Reset();
+    NoteStateChange(STATE_REASON_MANUAL);
   }
 }
@@ -9,9 +9,22 @@
 #include "DriveController.h"
 #include "RangeController.h"
 #include "ManualWaypointController.h"
+#include "SensorSnapshot.h"
+#include "PoseSample.h"
+#include "SeqLock.h"
+#include "ControllerProfiler.h"
+#include "ReplayRecorder.h"
+#include "FlightRecorder.h"
+#include "TargetBlackboard.h"
+#include "TagSummary.h"
+#include "RoverAvoidance.h"
+#include "NestScheduler.h"
+#include "DetectionHint.h"
+#include "StateEvent.h"
 
 #include <vector>
-#include <queue>
+#include <array>
+#include <mutex>
 
 using namespace std;
 
@@ -21,6 +34,8 @@ struct PrioritizedController {
   int priority = -1;
   Controller* controller = nullptr;
 
+  PrioritizedController() {}
+
   PrioritizedController(int pri, Controller* cntrl) :
     priority(pri),
     controller(cntrl)
@@ -45,15 +60,26 @@ public:
   bool ShouldInterrupt() override;
   bool HasWork() override;
 
-  // Give the controller a list of visible april tags.
+  // Sensor setters. These may be called from a different thread than
+  // DoWork(); the values are published into the sensor snapshot and handed
+  // to the controllers at the start of the next DoWork().
+
+  // Give the controller a list of visible april tags. The contents of tags
+  // are taken over without copying and tags is handed back holding an older
+  // buffer, so a caller that keeps reusing the same vector does not allocate
+  // once the buffers have grown.
   // NOTE: This function may be named SetTagData() in other classes
   //       but they are the same function.
-  void SetAprilTags(vector<Tag> tags);
+  void SetAprilTags(vector<Tag>& tags);
   void SetSonarData(float left, float center, float right);
-  void SetPositionData(Point currentLocation);
-  void SetMapPositionData(Point currentLocationMap);
-  void SetVelocityData(float linearVelocity, float angularVelocity);
-  void SetMapVelocityData(float linearVelocity, float angularVelocity);
+  // Pose and velocity of the odometry and map (GPS fused) sources, each
+  // published together under one lock
+  void SetPositionData(const PoseSample& odom);
+  void SetMapPositionData(const PoseSample& map);
+
+  // Latest published sensor values, safe to call from any thread.
+  SensorSnapshot GetSensorSnapshot() const;
+
   void SetCenterLocationOdom(Point centerLocationOdom);
   void SetCenterLocationMap(Point centerLocationMap);
 
@@ -90,12 +116,90 @@ public:
 
   void SetCurrentTimeInMilliSecs( long int time );
 
+  // Passthroughs for the search lanes, see SearchController. index is this
+  // rover's position among the count rovers that are searching.
+  void SetSwarmPosition(int index, int count);
+  void SetSearchLanes(float firstLaneRadius, float laneSpacing, float maxLaneRadius);
+
+  // Hands every controller that draws random numbers its own stream split
+  // from seed and stream, see RandomStream.h. stream is usually
+  // RandomStream::Id() of the rover's name.
+  void SetRandomSeed(uint64_t seed, uint64_t stream);
+
+  // See DropOffController::SetRandomSpinStart(), off by default
+  void SetRandomSpinStart(bool randomSpinStart);
+
+  // The cubes known to the swarm, see TargetBlackboard.h. Positions are in
+  // the shared frame in meters. Cubes this rover sees while searching are
+  // added on their own; TakeSharedSightings() returns those seen since the
+  // last call for the other rovers, and AddSharedSighting() and
+  // AddSharedClaim() take in theirs. decayTime is in seconds.
+  void SetTargetBlackboard(float resolution, float decayTime);
+  void AddSharedSighting(float x, float y, int count);
+  void AddSharedClaim(const std::string& rover, float x, float y);
+  std::vector<TargetBlackboard::Bucket> TakeSharedSightings();
+  bool GetSharedClaim(int& cellX, int& cellY);
+  float GetSharedResolution() const { return targetBlackboard.GetResolution(); }
+
+  // Turns at the collection zone, see NestScheduler.h. rover is this
+  // rover's name, which breaks ties between requests. The requests of the
+  // other rovers come in with AddNestRequest() and go with
+  // RemoveNestRequest(); requestTime is in ms.
+  void SetNestScheduler(const std::string& rover, float holdingRadius, float requestRadius);
+  void AddNestRequest(const std::string& rover, long requestTime, float bearing, bool granted);
+  void RemoveNestRequest(const std::string& rover);
+  const NestScheduler& GetNestScheduler() const { return nestScheduler; }
+
+  // What the rover is doing, for the beacons other rovers avoid it by
+  RoverAvoidance::Intent GetIntent();
+
+  // The process state, "SEARCHING", "TARGET_PICKEDUP", "DROP_OFF" or
+  // "MANUAL", published on the state machine topic
+  const char* GetProcessStateName() const;
+  static const char* ProcessStateName(uint8_t processState);
+
+  // The changes of the process state, logic state and active controller
+  // since the last call, oldest first. Only the last MAX_STATE_EVENTS are
+  // kept between calls. Only call it from the thread that calls DoWork().
+  static const size_t MAX_STATE_EVENTS = 64;
+  std::vector<StateEvent> TakeStateEvents();
+
+  // Whether the pick up or drop off controller is commanding the drive
+  // directly, for the localization rate, see LocalizationRate.h
+  bool IsPrecisionDriving() const;
+
+  // See DriveController::PIDConfigsMatchPolicies()
+  bool PIDConfigsMatchPolicies() const { return driveController.PIDConfigsMatchPolicies(); }
+
+  // Which tags the running controller needs the detector to find, and the
+  // tags of the last tick, for the detection hint, see DetectionHint.h. Only
+  // use them from the thread that calls DoWork().
+  DetectionHint::Mode GetDetectionMode() const;
+  const std::vector<Tag>& GetTickTags() const { return tickTags; }
+
   // Tell the logic controller whether rovers should automatically
   // resstrict their foraging range. If so provide the shape of the
   // allowed range.
-  void setVirtualFenceOn( RangeShape* range );
+  void setVirtualFenceOn( std::shared_ptr<const RangeShape> range );
   void setVirtualFenceOff( );
 
+  // Timing of the controller calls made by DoWork(). Only use it from the
+  // thread that calls DoWork().
+  ControllerProfiler& GetProfiler() { return profiler; }
+
+  // Record every input DoWork() consumes and every Result it returns to
+  // path, for offline replay with behaviours_replay. Returns false if the
+  // file could not be opened. Only call it from the thread that calls
+  // DoWork(), like the non-sensor setters.
+  bool RecordTo(const std::string& path);
+
+  // Keep the last records ticks, with the inputs, the states and the Result
+  // of each, in a ring file at path, see FlightRecorder.h. DumpFlightRecord()
+  // copies them to another file. Both return false if the file could not be
+  // made. Only call them from the thread that calls DoWork().
+  bool FlightRecordTo(const std::string& path, uint32_t records);
+  bool DumpFlightRecord(const std::string& path) const;
+
 protected:
   void ProcessData();
 
@@ -127,12 +231,100 @@ private:
   RangeController range_controller;
   ManualWaypointController manualWaypointController;
 
-  std::vector<PrioritizedController> prioritizedControllers;
-  priority_queue<PrioritizedController> control_queue;
+  // Number of controllers that take part in the priority scheme. Teams
+  // adding a controller must add it to every table in ProcessData().
+  static const int NUM_PRIORITIZED_CONTROLLERS = 6;
+  typedef std::array<PrioritizedController, NUM_PRIORITIZED_CONTROLLERS> ControllerTable;
+
+  // Priorities for the current process state, as listed in ProcessData().
+  ControllerTable prioritizedControllers;
+
+  // prioritizedControllers sorted by descending priority, rebuilt by
+  // ProcessData(). The first activeControllerCount entries have a priority
+  // of 0 or above.
+  ControllerTable sortedControllers;
+  int activeControllerCount = 0;
+
+  // Bit i is set when sortedControllers[i] reported HasWork() on the last
+  // interrupt, so the lowest set bit is the most important controller.
+  unsigned int workMask = 0;
+
+  // The controller selected on the last interrupt, nullptr if none had work.
+  Controller* activeController = nullptr;
+
+  void SortControllers();
+
+  ControllerProfiler profiler;
+
+  ReplayRecorder recorder;
+  void RecordSensorInputs(const SensorSnapshot& snapshot);
+
+  FlightRecorder flightRecorder;
+  void RecordFlight(const Result& result);
+  FlightController ControllerId(const Controller* controller) const;
+
+  // Queues a StateEvent if the state differs from the last one queued.
+  // stateReason is what changed it during the current DoWork().
+  void NoteStateChange(StateEventReason reason);
+  StateEventReason stateReason = STATE_REASON_RESET;
+  StateEvent lastStateEvent = {0, 0xFF, 0xFF, 0xFF, 0};
+  std::vector<StateEvent> stateEvents;
 
   void controllerInterconnect();
 
+  // Hands the sensor inputs that changed since the last tick to the
+  // controllers. Called at the start of DoWork().
+  void ConsumeSensorSnapshot();
+
+  // Writers take sensorWriteMutex so concurrent setters do not lose each
+  // other's updates; DoWork() reads sensorSnapshot without locking.
+  std::mutex sensorWriteMutex;
+  SensorSnapshot pendingSnapshot;
+  SeqLock<SensorSnapshot> sensorSnapshot;
+  SensorSnapshot consumedSnapshot;
+
+  // Tags are double buffered. The setter fills pendingTags and DoWork()
+  // swaps it with tickTags under sensorWriteMutex. The setter also
+  // classifies the tags once for all controllers, and lays them out as a
+  // TagBatch in incomingTagBatch, which rotates through the same swaps.
+  vector<Tag> pendingTags;
+  vector<Tag> tickTags;
+  TagBatch incomingTagBatch; // only used by the setter
+  TagBatch pendingTagBatch;
+  TagBatch tickTagBatch;
+  TagSummary pendingTagSummary;
+  TagSummary tickTagSummary;
+
   long int current_time = 0;
+
+  Point centerLocationOdom = {0, 0, 0};
+  Point centerLocationMap = {0, 0, 0};
+  bool centerLocationMapKnown = false;
+
+  TargetBlackboard targetBlackboard;
+  // Scratch for UpdateTargetBlackboard(): the distances to the tags and the
+  // cubes seen per blackboard cell, a handful at most
+  std::vector<float> tagGroundDistances;
+  struct SeenCell {
+    int x;
+    int y;
+    int count;
+  };
+  std::vector<SeenCell> seenCells;
+
+  // Adds the cubes seen this tick to the blackboard and points the search
+  // controller at the nearest unclaimed bucket. Called by
+  // ConsumeSensorSnapshot().
+  void UpdateTargetBlackboard(const SensorSnapshot& snapshot, bool tagsChanged);
+
+  NestScheduler nestScheduler;
+
+  // Requests the collection zone while bringing a cube and tells the drop
+  // off controller whether to go in. Called by ConsumeSensorSnapshot().
+  void UpdateNestScheduler(const SensorSnapshot& snapshot);
+
+  // A point in the shared frame in the odometry frame
+  Point SharedToOdom(float x, float y, const SensorSnapshot& snapshot) const;
 };
 
 #endif // LOGICCONTROLLER_H
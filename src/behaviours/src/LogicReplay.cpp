@@ -0,0 +1,391 @@
+// behaviours_replay: feeds a recording made with the behaviours node's
+// replay_record_file parameter back into a fresh LogicController, as fast as
+// the CPU allows, and checks that every tick returns the recorded Result.
+//
+// usage: behaviours_replay [--tolerance <t>] [--quiet] <recording>
+//
+// Exits with 0 if every Result matched, 1 on a mismatch and 2 if the
+// recording could not be read. See ReplayRecorder.h for the file format.
+
+#include "LogicController.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct ReplayStats {
+  unsigned long lines = 0;
+  unsigned long ticks = 0;
+  unsigned long mismatches = 0;
+  long firstTime = -1;
+  long lastTime = -1;
+};
+
+static Point ReadPoint(istringstream& in)
+{
+  Point point = {0, 0, 0};
+  in >> point.x >> point.y >> point.theta;
+  return point;
+}
+
+// Reads a fence shape as written by LogicController, type first unless it
+// was already read.
+static shared_ptr<const RangeShape> ReadRangeShape(istringstream& in, string type = "")
+{
+  if (type.empty()) in >> type;
+
+  Point center = {0, 0, 0};
+  if (type == "circle")
+  {
+    float radius = 0;
+    in >> center.x >> center.y >> radius;
+    return make_shared<RangeCircle>(center, radius);
+  }
+  else if (type == "rect")
+  {
+    float width = 0, height = 0;
+    in >> center.x >> center.y >> width >> height;
+    return make_shared<RangeRectangle>(center, width, height);
+  }
+  else if (type == "polygon")
+  {
+    size_t count = 0;
+    in >> count;
+    vector<Point> vertices(count, center);
+    for (Point& vertex : vertices) in >> vertex.x >> vertex.y;
+    return make_shared<RangePolygon>(vertices);
+  }
+  else if (type == "multi")
+  {
+    size_t count = 0;
+    in >> count;
+    vector< shared_ptr<const RangeShape> > regions;
+    for (size_t i = 0; i < count; i++) regions.push_back(ReadRangeShape(in));
+    return make_shared<RangeMultiRegion>(regions);
+  }
+
+  throw RangeShapeInvalidParameterException("(unknown shape " + type + " in recording)");
+}
+
+static bool Close(float recorded, float replayed, double tolerance)
+{
+  return fabs(recorded - replayed) <= tolerance;
+}
+
+// Compares a recorded "result" line with what the replay returned.
+static bool Matches(istringstream& in, const Result& result, double tolerance)
+{
+  int type = -1, b = 0;
+  float left = 0, right = 0, finger = 0, wrist = 0;
+  if (!(in >> type >> b >> left >> right >> finger >> wrist))
+  {
+    return false;
+  }
+
+  int replayedB = result.type == behavior ? (int)result.b : 0;
+
+  return type == (int)result.type && b == replayedB &&
+         Close(left, result.pd.left, tolerance) &&
+         Close(right, result.pd.right, tolerance) &&
+         Close(finger, result.fingerAngle, tolerance) &&
+         Close(wrist, result.wristAngle, tolerance);
+}
+
+static void PrintUsage()
+{
+  cerr << "usage: behaviours_replay [--tolerance <t>] [--quiet] <recording>" << endl;
+}
+
+int main(int argc, char** argv)
+{
+  double tolerance = 1e-4;
+  bool quiet = false;
+  string path;
+
+  for (int i = 1; i < argc; i++)
+  {
+    string arg = argv[i];
+    if (arg == "--tolerance" && i + 1 < argc)
+    {
+      tolerance = atof(argv[++i]);
+    }
+    else if (arg == "--quiet")
+    {
+      quiet = true;
+    }
+    else if (path.empty() && !arg.empty() && arg[0] != '-')
+    {
+      path = arg;
+    }
+    else
+    {
+      PrintUsage();
+      return 2;
+    }
+  }
+
+  if (path.empty())
+  {
+    PrintUsage();
+    return 2;
+  }
+
+  ifstream file(path.c_str());
+  if (!file)
+  {
+    cerr << "behaviours_replay: could not open " << path << endl;
+    return 2;
+  }
+
+  LogicController logicController;
+
+  vector<Tag> tags;
+  PoseSample odomSample;
+  PoseSample mapSample;
+
+  ReplayStats stats;
+  Result result{};
+  bool awaitingResult = false;
+
+  chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+  string line;
+  while (getline(file, line))
+  {
+    stats.lines++;
+
+    istringstream in(line);
+    string command;
+    in >> command;
+
+    if (command.empty())
+    {
+      continue;
+    }
+    else if (command == "time")
+    {
+      long time = 0;
+      in >> time;
+      if (stats.firstTime < 0)
+      {
+        stats.firstTime = time;
+      }
+      stats.lastTime = time;
+      logicController.SetCurrentTimeInMilliSecs(time);
+    }
+    else if (command == "mode")
+    {
+      string mode;
+      in >> mode;
+      if (mode == "auto")
+      {
+        logicController.SetModeAuto();
+      }
+      else
+      {
+        logicController.SetModeManual();
+      }
+    }
+    else if (command == "center_odom")
+    {
+      logicController.SetCenterLocationOdom(ReadPoint(in));
+    }
+    else if (command == "center_map")
+    {
+      logicController.SetCenterLocationMap(ReadPoint(in));
+    }
+    else if (command == "waypoint_add")
+    {
+      int id = 0;
+      Point waypoint = {0, 0, 0};
+      in >> id >> waypoint.x >> waypoint.y;
+      logicController.AddManualWaypoint(waypoint, id);
+    }
+    else if (command == "waypoint_remove")
+    {
+      int id = 0;
+      in >> id;
+      logicController.RemoveManualWaypoint(id);
+    }
+    else if (command == "cleared_waypoints")
+    {
+      logicController.GetClearedWaypoints();
+    }
+    else if (command == "swarm_position")
+    {
+      int index = 0, count = 1;
+      in >> index >> count;
+      logicController.SetSwarmPosition(index, count);
+    }
+    else if (command == "search_lanes")
+    {
+      float firstLaneRadius = 0, laneSpacing = 0, maxLaneRadius = 0;
+      in >> firstLaneRadius >> laneSpacing >> maxLaneRadius;
+      logicController.SetSearchLanes(firstLaneRadius, laneSpacing, maxLaneRadius);
+    }
+    else if (command == "random_seed")
+    {
+      unsigned long long seed = 0, stream = 0;
+      in >> seed >> stream;
+      logicController.SetRandomSeed(seed, stream);
+    }
+    else if (command == "random_spin_start")
+    {
+      int randomSpinStart = 0;
+      in >> randomSpinStart;
+      logicController.SetRandomSpinStart(randomSpinStart != 0);
+    }
+    else if (command == "target_blackboard")
+    {
+      float resolution = 0.5, decayTime = 600;
+      in >> resolution >> decayTime;
+      logicController.SetTargetBlackboard(resolution, decayTime);
+    }
+    else if (command == "shared_sighting")
+    {
+      float x = 0, y = 0;
+      int count = 0;
+      in >> x >> y >> count;
+      logicController.AddSharedSighting(x, y, count);
+    }
+    else if (command == "shared_claim")
+    {
+      string rover;
+      float x = 0, y = 0;
+      in >> rover >> x >> y;
+      logicController.AddSharedClaim(rover, x, y);
+    }
+    else if (command == "nest_scheduler")
+    {
+      string rover;
+      float holdingRadius = 1.5, requestRadius = 2.5;
+      in >> rover >> holdingRadius >> requestRadius;
+      logicController.SetNestScheduler(rover, holdingRadius, requestRadius);
+    }
+    else if (command == "nest_request")
+    {
+      string rover;
+      long requestTime = 0;
+      float bearing = 0;
+      int granted = 0;
+      in >> rover >> requestTime >> bearing >> granted;
+      logicController.AddNestRequest(rover, requestTime, bearing, granted != 0);
+    }
+    else if (command == "nest_release")
+    {
+      string rover;
+      in >> rover;
+      logicController.RemoveNestRequest(rover);
+    }
+    else if (command == "fence_off")
+    {
+      logicController.setVirtualFenceOff();
+    }
+    else if (command == "fence")
+    {
+      logicController.setVirtualFenceOn(ReadRangeShape(in));
+    }
+    else if (command == "fence_circle" || command == "fence_rect")
+    {
+      // older recordings, the same as "fence circle" and "fence rect"
+      logicController.setVirtualFenceOn(ReadRangeShape(in, command.substr(6)));
+    }
+    else if (command == "sonar")
+    {
+      float left = 0, center = 0, right = 0;
+      in >> left >> center >> right;
+      logicController.SetSonarData(left, center, right);
+    }
+    // Pose and velocity are recorded on their own lines but set together,
+    // so the other half comes from the latest sample of the same source
+    else if (command == "position")
+    {
+      odomSample.pose = ReadPoint(in);
+      logicController.SetPositionData(odomSample);
+    }
+    else if (command == "map_position")
+    {
+      mapSample.pose = ReadPoint(in);
+      logicController.SetMapPositionData(mapSample);
+    }
+    else if (command == "velocity")
+    {
+      in >> odomSample.linearVelocity >> odomSample.angularVelocity;
+      logicController.SetPositionData(odomSample);
+    }
+    else if (command == "map_velocity")
+    {
+      in >> mapSample.linearVelocity >> mapSample.angularVelocity;
+      logicController.SetMapPositionData(mapSample);
+    }
+    else if (command == "tags")
+    {
+      size_t count = 0;
+      in >> count;
+      tags.resize(count);
+      for (Tag& tag : tags)
+      {
+        int id = 0;
+        float x = 0, y = 0, z = 0, qx = 0, qy = 0, qz = 0, qw = 0;
+        in >> id >> x >> y >> z >> qx >> qy >> qz >> qw;
+        tag.setID(id);
+        tag.setPosition(x, y, z);
+        tag.setOrientation(qx, qy, qz, qw);
+      }
+      logicController.SetAprilTags(tags);
+    }
+    else if (command == "tick")
+    {
+      result = logicController.DoWork();
+      stats.ticks++;
+      awaitingResult = true;
+    }
+    else if (command == "result")
+    {
+      if (!awaitingResult)
+      {
+        continue;
+      }
+      awaitingResult = false;
+
+      if (!Matches(in, result, tolerance))
+      {
+        stats.mismatches++;
+        if (!quiet)
+        {
+          cout << "tick " << stats.ticks << " (line " << stats.lines << "): recorded \"" << line
+               << "\", replayed type " << result.type
+               << " b " << (result.type == behavior ? (int)result.b : 0)
+               << " left " << result.pd.left << " right " << result.pd.right
+               << " finger " << result.fingerAngle << " wrist " << result.wristAngle << endl;
+        }
+      }
+    }
+    else
+    {
+      cerr << "behaviours_replay: unknown record \"" << command << "\" on line " << stats.lines << endl;
+      return 2;
+    }
+  }
+
+  double wallSeconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+  double simulatedSeconds = stats.firstTime < 0 ? 0 : (stats.lastTime - stats.firstTime) / 1e3;
+
+  cout << "ticks " << stats.ticks
+       << ", mismatches " << stats.mismatches
+       << ", simulated " << simulatedSeconds << " s in " << wallSeconds << " s wall";
+  if (wallSeconds > 0)
+  {
+    cout << " (" << simulatedSeconds / wallSeconds << "x)";
+  }
+  cout << endl;
+
+  return stats.mismatches == 0 ? 0 : 1;
+}
@@ -1,7 +1,6 @@
-#include <map>
+#include <cmath>
 
 #include "ManualWaypointController.h"
-#include <angles/angles.h> // for hypot()
 
 ManualWaypointController::ManualWaypointController() {}
 
@@ -9,6 +8,7 @@ ManualWaypointController::~ManualWaypointController() {}
 
 void ManualWaypointController::Reset() {
   waypoints.clear();
+  waypoint_index.clear();
   num_waypoints = 0;
   cleared_waypoints.clear();
 }
@@ -30,7 +30,7 @@ bool ManualWaypointController::ShouldInterrupt() {
 Result ManualWaypointController::DoWork() {
   Result result;
   result.type = waypoint;
-  result.wpts.waypoints.push_back(waypoints.begin()->second);
+  result.wpts.waypoints.push_back(waypoints.front().second);
   result.PIDMode = FAST_PID;
   return result;
 }
@@ -39,12 +39,13 @@ void ManualWaypointController::SetCurrentLocation(Point currentLocation)
 {
   this->currentLocation = currentLocation;
   if(!waypoints.empty()) {
-    std::map<int, Point>::iterator first = waypoints.begin();
-    if(hypot(first->second.x-currentLocation.x,
-             first->second.y-currentLocation.y)
+    const std::pair<int,Point>& first = waypoints.front();
+    if(hypot(first.second.x-currentLocation.x,
+             first.second.y-currentLocation.y)
        < waypoint_tolerance) {
-      cleared_waypoints.push_back(first->first);
-      waypoints.erase(first);
+      cleared_waypoints.push_back(first.first);
+      waypoint_index.erase(first.first);
+      waypoints.pop_front();
     }
   }
 }
@@ -55,16 +56,26 @@ void ManualWaypointController::ProcessData()
 
 void ManualWaypointController::AddManualWaypoint(Point wpt, int id)
 {
-  waypoints[id] = wpt;
+  std::unordered_map<int, std::list< std::pair<int,Point> >::iterator>::iterator found = waypoint_index.find(id);
+  if(found != waypoint_index.end()) {
+    found->second->second = wpt;
+    return;
+  }
+  waypoint_index[id] = waypoints.insert(waypoints.end(), std::make_pair(id, wpt));
 }
 
 void ManualWaypointController::RemoveManualWaypoint(int id)
 {
-  waypoints.erase(id);
+  std::unordered_map<int, std::list< std::pair<int,Point> >::iterator>::iterator found = waypoint_index.find(id);
+  if(found == waypoint_index.end()) {
+    return;
+  }
+  waypoints.erase(found->second);
+  waypoint_index.erase(found);
 }
 
 std::vector<int> ManualWaypointController::ReachedWaypoints() {
-  std::vector<int> cleared = cleared_waypoints;
-  cleared_waypoints.clear();
+  std::vector<int> cleared;
+  cleared.swap(cleared_waypoints);
   return cleared;
 }
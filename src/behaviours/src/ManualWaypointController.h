@@ -1,7 +1,10 @@
 #ifndef MAUNALWAYPOINTCONTROLLER_H
 #define MANULAWAYPOINTCONTROLLER_H
 
-#include <map>
+#include <list>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 #include "Controller.h"
 
@@ -19,8 +22,9 @@ public:
    void Reset() override;
 
    
-   // Returns the next waypoint in the list. The result is set up to
-   // be used by DriveController for waypoint navigation.
+   // Returns the next waypoint in the list, the oldest one added. The
+   // result is set up to be used by DriveController for waypoint
+   // navigation.
    //
    Result DoWork() override;
 
@@ -36,19 +40,19 @@ public:
    // Tell the controller the current location of the robot.
    void SetCurrentLocation(Point currentLocation);
 
-   // Add the provided waypoint to the list of manual waypoints.
+   // Add the provided waypoint to the end of the list of manual
+   // waypoints.
    
    // NOTE: Waypoints should have unique ids, it is incumbent on the
-   // caller to ensure this. Providing the same IDs for multiple
-   // waypoints may cause undefined behavior in the GUI. Further more
-   // if the ID is removed using RemoveManualWaypoint() then all
-   // waypoints with that ID may be removed.
+   // caller to ensure this. Adding a waypoint with the id of one
+   // still in the list moves that waypoint without changing its place
+   // in the list.
    void AddManualWaypoint(Point wpt, int id);
 
    
    // Remove the waypoint with the given ID from the list of waypoints
-   // to visit. If no maypoint exists with the given ID, the no action
-   // is taken.
+   // to visit in constant time. If no maypoint exists with the given
+   // ID, the no action is taken.
    void RemoveManualWaypoint(int id);
 
    // Get a vector containing all waypoint IDs that have been visited
@@ -62,8 +66,10 @@ protected:
    
 private:
    Point currentLocation;
-   // list of manual waypoints
-   std::map<int,Point> waypoints;
+   // list of manual waypoints in the order they were added, indexed
+   // by id so they can be removed without searching the list
+   std::list< std::pair<int,Point> > waypoints;
+   std::unordered_map<int, std::list< std::pair<int,Point> >::iterator> waypoint_index;
    std::vector<int> cleared_waypoints;
    int num_waypoints = 0;
 
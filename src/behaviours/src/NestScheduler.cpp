@@ -0,0 +1,173 @@
+#include "NestScheduler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+NestScheduler::NestScheduler(float holdingRadius, float requestRadius, int slots, long leaseTime, long timeout)
+{
+  this->holdingRadius = holdingRadius;
+  this->requestRadius = requestRadius;
+  this->slots = max(1, slots);
+  this->leaseTime = leaseTime;
+  this->timeout = timeout;
+}
+
+void NestScheduler::SetRadii(float holdingRadius, float requestRadius)
+{
+  this->holdingRadius = holdingRadius;
+  this->requestRadius = max(holdingRadius, requestRadius);
+}
+
+bool NestScheduler::Before(const Request& a, const string& aName, const Request& b, const string& bName)
+{
+  if (a.requestTime != b.requestTime) return a.requestTime < b.requestTime;
+  return aName < bName;
+}
+
+void NestScheduler::Update(Point position, bool wanted, long time)
+{
+  if (!wanted)
+  {
+    requesting = false;
+    self.granted = false;
+  }
+  else if (!requesting && hypot(position.x, position.y) <= requestRadius)
+  {
+    requesting = true;
+    self.requestTime = time;
+    self.bearing = atan2(position.y, position.x);
+    self.granted = false;
+  }
+
+  self.lastHeard = time;
+  Schedule(time);
+}
+
+void NestScheduler::AddRemote(const string& rover, long requestTime, float bearing, bool granted, long time)
+{
+  if (rover == name) return;
+
+  Request& remote = remotes[rover];
+  if (granted && !remote.granted) remote.grantTime = time;
+  remote.requestTime = requestTime;
+  remote.bearing = bearing;
+  remote.granted = granted;
+  remote.lastHeard = time;
+}
+
+void NestScheduler::RemoveRemote(const string& rover)
+{
+  remotes.erase(rover);
+}
+
+void NestScheduler::Schedule(long time)
+{
+  // Also drop requests heard before a clock reset
+  for (map<string, Request>::iterator it = remotes.begin(); it != remotes.end();)
+  {
+    if (time - it->second.lastHeard > timeout || it->second.lastHeard > time) remotes.erase(it++);
+    else ++it;
+  }
+
+  queuePosition = 0;
+  if (!requesting) return;
+
+  // Go to the back of the queue when the lease lapses
+  if (self.granted && time - self.grantTime > leaseTime)
+  {
+    self.granted = false;
+    self.requestTime = time;
+  }
+
+  vector<pair<const Request*, const string*> > queue;
+  queue.push_back(make_pair(&self, &name));
+
+  bool heldBefore = false; // by a rover ahead of this one
+  bool held = false;
+  for (const auto& entry : remotes)
+  {
+    const Request& remote = entry.second;
+    queue.push_back(make_pair(&remote, &entry.first));
+
+    // A rover that overran its lease gives it up on its own
+    if (!remote.granted || time - remote.grantTime > leaseTime) continue;
+
+    held = true;
+    if (Before(remote, entry.first, self, name)) heldBefore = true;
+  }
+
+  sort(queue.begin(), queue.end(), [](const pair<const Request*, const string*>& a, const pair<const Request*, const string*>& b) {
+    return Before(*a.first, *a.second, *b.first, *b.second);
+  });
+
+  if (self.granted)
+  {
+    // Two rovers were granted at once before hearing of each other, the
+    // later request gives way
+    if (heldBefore) self.granted = false;
+  }
+  else if (!held && queue.front().first == &self)
+  {
+    self.granted = true;
+    self.grantTime = time;
+  }
+
+  if (self.granted) return;
+
+  // Each waiting rover in queue order takes the free slot nearest to where
+  // it came from, so every rover works out the same slots
+  const float slotAngle = 2 * M_PI / slots;
+  vector<bool> taken(slots, false);
+  int waiting = 0;
+  for (const auto& entry : queue)
+  {
+    const Request& request = *entry.first;
+    if (&request != &self && request.granted) continue;
+
+    // Once every slot is taken they are shared
+    if (waiting % slots == 0) fill(taken.begin(), taken.end(), false);
+    waiting++;
+
+    int best = 0;
+    float bestDistance = 2 * M_PI;
+    for (int slot = 0; slot < slots; slot++)
+    {
+      if (taken[slot]) continue;
+
+      float distance = fabs(remainder(slot * slotAngle - request.bearing, 2 * M_PI));
+      if (distance < bestDistance)
+      {
+        best = slot;
+        bestDistance = distance;
+      }
+    }
+    taken[best] = true;
+
+    if (&request == &self)
+    {
+      float angle = best * slotAngle;
+      holdingPoint.x = holdingRadius * cos(angle);
+      holdingPoint.y = holdingRadius * sin(angle);
+      holdingPoint.theta = angle + M_PI; // facing the center
+      break;
+    }
+  }
+
+  for (const auto& entry : queue)
+  {
+    if (entry.first == &self) break;
+    queuePosition++;
+  }
+}
+
+void NestScheduler::Clear()
+{
+  requesting = false;
+  self.granted = false;
+  queuePosition = 0;
+  remotes.clear();
+}
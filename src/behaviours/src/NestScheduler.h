@@ -0,0 +1,79 @@
+#ifndef NESTSCHEDULER_H
+#define NESTSCHEDULER_H
+
+#include <map>
+#include <string>
+
+#include "Point.h"
+
+// Takes turns at the collection zone. A rover bringing a cube requests the
+// zone once it is within requestRadius of the center and only drives in
+// while it holds the lease; the others wait in holding slots on a ring of
+// holdingRadius around the center until it is their turn.
+//
+// There is no arbiter: every rover broadcasts its request and all of them
+// order the requests the same way, by the time they were made and then by
+// rover name. The first in that order is granted the lease once no other
+// rover holds it. A lease is released after dropping off and lapses after
+// leaseTime ms, so a stuck rover cannot hold up the others; requests that
+// are not renewed for timeout ms are dropped.
+//
+// Positions are in the shared frame of TargetBlackboard.h. Times are in ms.
+class NestScheduler
+{
+public:
+  struct Request {
+    long requestTime;
+    float bearing; // radians, from the center to the rover when requesting
+    bool granted;
+    long grantTime;
+    long lastHeard;
+  };
+
+  NestScheduler(float holdingRadius = 1.5, float requestRadius = 2.5, int slots = 8, long leaseTime = 60000, long timeout = 2000);
+
+  void SetName(const std::string& name) { this->name = name; }
+  void SetRadii(float holdingRadius, float requestRadius);
+
+  // Whether the rover at position wants the collection zone. Requests once
+  // it is close enough and keeps asking until told it no longer wants it.
+  void Update(Point position, bool wanted, long time);
+
+  void AddRemote(const std::string& rover, long requestTime, float bearing, bool granted, long time);
+  void RemoveRemote(const std::string& rover);
+
+  bool IsRequesting() const { return requesting; }
+  bool IsGranted() const { return requesting && self.granted; }
+  const Request& GetRequest() const { return self; }
+
+  // Rovers ahead of this one in the queue, 0 when granted
+  int QueuePosition() const { return queuePosition; }
+
+  // Where to wait while not granted
+  Point HoldingPoint() const { return holdingPoint; }
+
+  void Clear();
+
+private:
+  static bool Before(const Request& a, const std::string& aName, const Request& b, const std::string& bName);
+
+  // Orders the requests, hands out the holding slots and decides the lease
+  void Schedule(long time);
+
+  float holdingRadius;
+  float requestRadius;
+  int slots;
+  long leaseTime;
+  long timeout;
+
+  std::string name;
+
+  bool requesting = false;
+  Request self = {0, 0, false, 0, 0};
+  int queuePosition = 0;
+  Point holdingPoint = {0, 0, 0};
+
+  std::map<std::string, Request> remotes;
+};
+
+#endif // NESTSCHEDULER_H
@@ -21,11 +21,11 @@ void ObstacleController::Reset() {
 // Avoid crashing into objects detected by the ultraound
 void ObstacleController::avoidObstacle() {
   
-    //always turn left to avoid obstacles
+    //turn the way chooseTurnDirection picked when the obstacle was first seen
     if (right < 0.8 || center < 0.8 || left < 0.8) {
       result.type = precisionDriving;
 
-      result.pd.cmdAngular = -K_angular;
+      result.pd.cmdAngular = turn_direction * K_angular;
 
       result.pd.setPointVel = 0.0;
       result.pd.cmdVel = 0.0;
@@ -89,7 +89,47 @@ Result ObstacleController::DoWork() {
 }
 
 
+void ObstacleController::chooseTurnDirection() {
+
+  float leftHeading = currentLocation.theta + M_PI/4;
+  float rightHeading = currentLocation.theta - M_PI/4;
+
+  int leftOccupied = occupancyGrid.CountOccupied(currentLocation.x + turn_lookahead * cos(leftHeading),
+                                                 currentLocation.y + turn_lookahead * sin(leftHeading),
+                                                 turn_lookahead_radius);
+  int rightOccupied = occupancyGrid.CountOccupied(currentLocation.x + turn_lookahead * cos(rightHeading),
+                                                  currentLocation.y + turn_lookahead * sin(rightHeading),
+                                                  turn_lookahead_radius);
+
+  // Turn right as before unless more is known to be in the way there
+  turn_direction = rightOccupied > leftOccupied ? 1 : -1;
+}
+
+void ObstacleController::updateOccupancyGrid(float sonarleft, float sonarcenter, float sonarright) {
+
+  float cosTheta = cos(currentLocation.theta);
+  float sinTheta = sin(currentLocation.theta);
+
+  auto addSonar = [&](float forward, float side, float yaw, float range) {
+    Point sensor;
+    sensor.x = currentLocation.x + forward * cosTheta - side * sinTheta;
+    sensor.y = currentLocation.y + forward * sinTheta + side * cosTheta;
+    sensor.theta = currentLocation.theta + yaw;
+    occupancyGrid.AddSonar(sensor, range, sonar_half_angle, sonar_max_range);
+  };
+
+  addSonar(sonar_forward, sonar_side, sonar_side_yaw, sonarleft);
+  addSonar(sonar_forward, -sonar_side, -sonar_side_yaw, sonarright);
+
+  // A held cube blocks the center sonar
+  if (!ignore_center_sonar) {
+    addSonar(sonar_forward, 0, 0, sonarcenter);
+  }
+}
+
 void ObstacleController::setSonarData(float sonarleft, float sonarcenter, float sonarright) {
+  updateOccupancyGrid(sonarleft, sonarcenter, sonarright);
+
   left = sonarleft;
   right = sonarright;
   center = sonarcenter;
@@ -99,6 +139,7 @@ void ObstacleController::setSonarData(float sonarleft, float sonarcenter, float
 
 void ObstacleController::setCurrentLocation(Point currentLocation) {
   this->currentLocation = currentLocation;
+  occupancyGrid.Recenter(currentLocation.x, currentLocation.y);
 }
 
 void ObstacleController::ProcessData() {
@@ -150,6 +191,11 @@ void ObstacleController::ProcessData() {
   //if physical obstacle or collection zone visible
   if (collection_zone_seen || phys)
   {
+    if (obstacleAvoided && !collection_zone_seen)
+    {
+      chooseTurnDirection();
+    }
+
     obstacleDetected = true;
     obstacleAvoided = false;
     can_set_waypoint = false;
@@ -165,47 +211,23 @@ void ObstacleController::ProcessData() {
 // Added relative pose information so we know whether the
 // top of the AprilTag is pointing towards the rover or away.
 // If the top of the tags are away from the rover then treat them as obstacles. 
-void ObstacleController::setTagData(vector<Tag> tags){
+void ObstacleController::setTagData(const TagSummary& tags){
   collection_zone_seen = false;
   count_left_collection_zone_tags = 0;
   count_right_collection_zone_tags = 0;
 
-  // this loop is to get the number of center tags
-  if (!targetHeld) {
-    for (int i = 0; i < tags.size(); i++) { //redundant for loop
-      if (tags[i].getID() == 256) {
-
-	collection_zone_seen = checkForCollectionZoneTags( tags );
-        timeSinceTags = current_time;
-      }
-    }
-  }
-}
-
-bool ObstacleController::checkForCollectionZoneTags( vector<Tag> tags ) {
-
-  for ( auto & tag : tags ) { 
+  // only if center tags are in view
+  if (!targetHeld && tags.centers > 0) {
 
-    // Check the orientation of the tag. If we are outside the collection zone the yaw will be positive so treat the collection zone as an obstacle. 
+    // If we are outside the collection zone the yaw will be positive so treat the collection zone as an obstacle. 
     //If the yaw is negative the robot is inside the collection zone and the boundary should not be treated as an obstacle. 
     //This allows the robot to leave the collection zone after dropping off a target.
-    if ( tag.calcYaw() > 0 ) 
-      {
-	// checks if tag is on the right or left side of the image
-	if (tag.getPositionX() + camera_offset_correction > 0) {
-	  count_right_collection_zone_tags++;
-	  
-	} else {
-	  count_left_collection_zone_tags++;
-	}
-      }
-    
-  }
-
-
-  // Did any tags indicate that the robot is inside the collection zone?
-  return count_left_collection_zone_tags + count_right_collection_zone_tags > 0;
+    count_left_collection_zone_tags = tags.facingAwayLeft;
+    count_right_collection_zone_tags = tags.facingAwayRight;
 
+    collection_zone_seen = count_left_collection_zone_tags + count_right_collection_zone_tags > 0;
+    timeSinceTags = current_time;
+  }
 }
 
 //obstacle controller should inrerupt is based upon the transition from not seeing and obstacle to seeing an obstacle
@@ -3,6 +3,8 @@
 
 #include "Controller.h"
 #include "Tag.h"
+#include "TagSummary.h"
+#include "OccupancyGrid.h"
 
 class ObstacleController : virtual Controller
 {
@@ -15,7 +17,7 @@ public:
   Result DoWork() override;
   void setSonarData(float left, float center, float right);
   void setCurrentLocation(Point currentLocation);
-  void setTagData(vector<Tag> tags);
+  void setTagData(const TagSummary& tags);
   bool ShouldInterrupt() override;
   bool HasWork() override;
   void setIgnoreCenterSonar();
@@ -27,6 +29,9 @@ public:
   //Asked by logiccontroller to determine if drive controller should have its waypoints cleared
   bool getShouldClearWaypoints() {bool tmp = clearWaypoints; clearWaypoints = false; return tmp;}
 
+  // What the sonars have seen around the rover, in the odometry frame
+  const OccupancyGrid& getOccupancyGrid() const { return occupancyGrid; }
+
 protected:
 
   void ProcessData();
@@ -39,10 +44,13 @@ private:
   // Try not to run into a physical object
   void avoidObstacle();
 
-  // Are there AprilTags in the camera view that mark the collection zone
-  // and are those AprilTags oriented towards or away from the camera.
-  bool checkForCollectionZoneTags( vector<Tag> );
-  
+  // Picks the side with fewer known obstacles to turn towards, so a rover
+  // does not keep turning into the same barrier
+  void chooseTurnDirection();
+
+  // Adds the sonar cones to the occupancy grid
+  void updateOccupancyGrid(float left, float center, float right);
+
   const float K_angular = 1.0; //radians a second turn rate to avoid obstacles
   const float reactivate_center_sonar_threshold = 0.8; //reactive center sonar if it goes back above this distance, assuming it is deactivated
   const int targetCountPivot = 6; ///unused variable
@@ -84,7 +92,21 @@ private:
   bool set_waypoint = false;
   bool can_set_waypoint = false;
 
-  float camera_offset_correction = 0.020; //meters;
+  OccupancyGrid occupancyGrid;
+
+  // The sonars relative to the rover, as in the simulated swarmie model
+  const float sonar_forward = 0.15; //meters
+  const float sonar_side = 0.07; //meters
+  const float sonar_side_yaw = 0.436; //radians
+  const float sonar_half_angle = 0.478; //radians
+  const float sonar_max_range = 2.9; //meters, readings beyond mean nothing seen
+
+  // Where to look for known obstacles on either side when choosing a turn
+  const float turn_lookahead = 0.8; //meters
+  const float turn_lookahead_radius = 0.5; //meters
+
+  // Sign of the turn for the current obstacle, negative turns right
+  float turn_direction = -1;
 };
 
 #endif // OBSTACLECONTOLLER_H
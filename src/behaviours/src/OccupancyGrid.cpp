@@ -0,0 +1,142 @@
+#include "OccupancyGrid.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+OccupancyGrid::OccupancyGrid(float resolution, int size)
+{
+  this->resolution = resolution;
+
+  this->size = 1;
+  while (this->size < size) this->size <<= 1;
+  mask = this->size - 1;
+
+  cells.assign(this->size * this->size, 0);
+}
+
+int OccupancyGrid::Cell(float position) const
+{
+  return (int)floor(position / resolution);
+}
+
+bool OccupancyGrid::InWindow(int cellX, int cellY) const
+{
+  return placed
+    && cellX >= originX && cellX < originX + size
+    && cellY >= originY && cellY < originY + size;
+}
+
+void OccupancyGrid::Recenter(float x, float y)
+{
+  int newOriginX = Cell(x) - size/2;
+  int newOriginY = Cell(y) - size/2;
+
+  if (!placed || abs(newOriginX - originX) >= size || abs(newOriginY - originY) >= size)
+  {
+    Clear();
+    originX = newOriginX;
+    originY = newOriginY;
+    placed = true;
+    return;
+  }
+
+  // The columns and rows that scroll out of one side wrap around to become
+  // the new ones on the other side
+  for (int cellX = originX; cellX < newOriginX; cellX++) ClearColumn(cellX);
+  for (int cellX = newOriginX + size; cellX < originX + size; cellX++) ClearColumn(cellX);
+  originX = newOriginX;
+
+  for (int cellY = originY; cellY < newOriginY; cellY++) ClearRow(cellY);
+  for (int cellY = newOriginY + size; cellY < originY + size; cellY++) ClearRow(cellY);
+  originY = newOriginY;
+}
+
+void OccupancyGrid::ClearColumn(int cellX)
+{
+  for (int row = 0; row < size; row++) cells[row * size + (cellX & mask)] = 0;
+}
+
+void OccupancyGrid::ClearRow(int cellY)
+{
+  fill(cells.begin() + (cellY & mask) * size, cells.begin() + ((cellY & mask) + 1) * size, 0);
+}
+
+void OccupancyGrid::Update(int cellX, int cellY, int change)
+{
+  if (!InWindow(cellX, cellY)) return;
+
+  int8_t& cell = At(cellX, cellY);
+  cell = max(-maxLogOdds, min((int)maxLogOdds, cell + change));
+}
+
+void OccupancyGrid::AddSonar(Point sensor, float range, float halfAngle, float maxRange)
+{
+  if (!placed || range <= 0) return;
+
+  bool hit = range < maxRange;
+  range = min(range, maxRange);
+
+  // Enough rays that neighbouring ones are at most a cell apart at the far end
+  int rays = max(3, (int)ceil(2 * halfAngle * range / resolution) + 1);
+  for (int i = 0; i < rays; i++)
+  {
+    float heading = sensor.theta - halfAngle + 2 * halfAngle * i / (rays - 1);
+    AddRay(sensor.x, sensor.y, heading, range, hit);
+  }
+}
+
+void OccupancyGrid::AddRay(float x, float y, float heading, float length, bool hit)
+{
+  int steps = (int)(length / resolution);
+  float dx = resolution * cos(heading);
+  float dy = resolution * sin(heading);
+
+  for (int i = 0; i < steps; i++)
+  {
+    Update(Cell(x + i*dx), Cell(y + i*dy), missChange);
+  }
+
+  if (hit)
+  {
+    Update(Cell(x + length * cos(heading)), Cell(y + length * sin(heading)), hitChange);
+  }
+}
+
+int8_t OccupancyGrid::LogOdds(float x, float y) const
+{
+  int cellX = Cell(x);
+  int cellY = Cell(y);
+  return InWindow(cellX, cellY) ? At(cellX, cellY) : 0;
+}
+
+bool OccupancyGrid::IsOccupied(float x, float y) const
+{
+  return LogOdds(x, y) >= occupiedLogOdds;
+}
+
+int OccupancyGrid::CountOccupied(float x, float y, float radius) const
+{
+  int count = 0;
+  int cells = (int)ceil(radius / resolution);
+  int centerX = Cell(x);
+  int centerY = Cell(y);
+
+  for (int cellY = centerY - cells; cellY <= centerY + cells; cellY++)
+  {
+    for (int cellX = centerX - cells; cellX <= centerX + cells; cellX++)
+    {
+      if (!InWindow(cellX, cellY)) continue;
+      if (hypot((cellX - centerX) * resolution, (cellY - centerY) * resolution) > radius) continue;
+      if (At(cellX, cellY) >= occupiedLogOdds) count++;
+    }
+  }
+
+  return count;
+}
+
+void OccupancyGrid::Clear()
+{
+  fill(cells.begin(), cells.end(), 0);
+}
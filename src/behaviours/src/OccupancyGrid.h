@@ -0,0 +1,75 @@
+#ifndef OCCUPANCYGRID_H
+#define OCCUPANCYGRID_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Point.h"
+
+// What the sonars have seen around the rover, in the odometry frame. Each
+// cell holds the log odds of being occupied as an int8; sonar cones lower the
+// cells they found empty and raise the cells at the range they measured.
+//
+// The grid is a window of size x size cells kept centered on the rover with
+// Recenter(). Cells are stored ring wrapped, so moving the window only
+// clears the rows and columns that scrolled out of it and every query is a
+// single array lookup. Cells outside the window read as unknown (0).
+class OccupancyGrid
+{
+public:
+  // size is rounded up to a power of two
+  OccupancyGrid(float resolution = 0.1, int size = 128);
+
+  float GetResolution() const { return resolution; }
+
+  void Recenter(float x, float y);
+
+  // A sonar at sensor, facing sensor.theta, measured range over a cone of
+  // halfAngle radians. Ranges of maxRange or more are treated as nothing
+  // seen, so only the free space is added.
+  void AddSonar(Point sensor, float range, float halfAngle, float maxRange);
+
+  int8_t LogOdds(float x, float y) const;
+  bool IsOccupied(float x, float y) const;
+
+  // Occupied cells within radius meters of (x, y)
+  int CountOccupied(float x, float y, float radius) const;
+
+  // The same by cell, for planners
+  int Cell(float position) const;
+  float CellCenter(int cell) const { return (cell + 0.5) * resolution; }
+  bool InWindow(int cellX, int cellY) const;
+  bool IsOccupiedCell(int cellX, int cellY) const { return InWindow(cellX, cellY) && At(cellX, cellY) >= occupiedLogOdds; }
+
+  void Clear();
+
+private:
+  int8_t& At(int cellX, int cellY) { return cells[(cellY & mask) * size + (cellX & mask)]; }
+  int8_t At(int cellX, int cellY) const { return cells[(cellY & mask) * size + (cellX & mask)]; }
+
+  void Update(int cellX, int cellY, int change);
+  void ClearColumn(int cellX);
+  void ClearRow(int cellY);
+
+  // Steps along a ray in cells, lowering the free cells and raising the
+  // last one if hit
+  void AddRay(float x, float y, float heading, float length, bool hit);
+
+  const int hitChange = 20;
+  const int missChange = -5;
+  const int8_t maxLogOdds = 100;
+  const int8_t occupiedLogOdds = 30;
+
+  float resolution;
+  int size;
+  int mask;
+
+  // The lowest cell of the window, valid once placed
+  int originX = 0;
+  int originY = 0;
+  bool placed = false;
+
+  std::vector<int8_t> cells;
+};
+
+#endif // OCCUPANCYGRID_H
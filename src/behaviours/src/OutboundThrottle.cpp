@@ -0,0 +1,35 @@
+#include "OutboundThrottle.h"
+
+#include <algorithm>
+
+int OutboundThrottle::AddTopic(int priority, double refreshInterval, float tolerance)
+{
+  Topic topic;
+  topic.priority = priority;
+  topic.refreshInterval = refreshInterval;
+  topic.tolerance = tolerance;
+  topics.push_back(topic);
+
+  int number = topics.size() - 1;
+  std::vector<int>::iterator position = std::upper_bound(order.begin(), order.end(), priority,
+    [this](int p, int other) { return p < topics[other].priority; });
+  order.insert(position, number);
+  return number;
+}
+
+void OutboundThrottle::Stage(int topic, float a, float b)
+{
+  topics[topic].staged = true;
+  topics[topic].stagedA = a;
+  topics[topic].stagedB = b;
+}
+
+void OutboundThrottle::Sent(int topic, float a, float b, double now)
+{
+  Topic& sentTopic = topics[topic];
+  sentTopic.sentBefore = true;
+  sentTopic.sentA = a;
+  sentTopic.sentB = b;
+  sentTopic.lastSent = now;
+  sent++;
+}
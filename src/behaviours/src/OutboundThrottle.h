@@ -0,0 +1,94 @@
+#ifndef OUTBOUNDTHROTTLE_H
+#define OUTBOUNDTHROTTLE_H
+
+#include <cmath>
+#include <vector>
+
+// Decides which of the node's actuator commands are sent. Most behaviour
+// ticks repeat the drive and gripper commands of the tick before, so a
+// command only goes out when it differs from the last one sent on its topic
+// by more than the topic's tolerance, or when that one is older than the
+// topic's refresh interval, so a subscriber that missed it still catches up.
+//
+// Commands are staged during a tick and Flush() sends the ones that are due
+// in priority order, so the drive command never waits behind the gripper.
+// A topic holds up to two values, e.g. the left and right of a drive
+// command. Not thread safe.
+class OutboundThrottle
+{
+public:
+
+  // Lower priorities are sent first
+  enum Priority {
+    PRIORITY_DRIVE = 0,
+    PRIORITY_GRIPPER = 1
+  };
+
+  // Returns the number to stage the topic's commands with
+  int AddTopic(int priority, double refreshInterval, float tolerance = 0);
+
+  void SetRefreshInterval(int topic, double refreshInterval) { topics[topic].refreshInterval = refreshInterval; }
+
+  // Stages a command, replacing one staged since the last Flush()
+  void Stage(int topic, float a, float b = 0);
+
+  // The next command staged for the topic is sent whatever it is. Use when
+  // something else may have moved the actuator, e.g. the GUI's joystick.
+  void Invalidate(int topic) { topics[topic].sentBefore = false; }
+
+  // Records a command that was sent without going through Flush()
+  void Sent(int topic, float a, float b, double now);
+
+  // Calls send(topic, a, b) once for each staged command that is due,
+  // lowest priority first, and forgets the staged commands
+  template <typename Send>
+  void Flush(double now, Send send)
+  {
+    for (size_t i = 0; i < order.size(); i++)
+    {
+      Topic& topic = topics[order[i]];
+      if (!topic.staged)
+      {
+        continue;
+      }
+      topic.staged = false;
+
+      if (topic.sentBefore && now - topic.lastSent < topic.refreshInterval &&
+          std::fabs(topic.stagedA - topic.sentA) <= topic.tolerance &&
+          std::fabs(topic.stagedB - topic.sentB) <= topic.tolerance)
+      {
+        suppressed++;
+        continue;
+      }
+
+      Sent(order[i], topic.stagedA, topic.stagedB, now);
+      send(order[i], topic.stagedA, topic.stagedB);
+    }
+  }
+
+  unsigned long SentCount() const { return sent; }
+  unsigned long SuppressedCount() const { return suppressed; }
+
+private:
+
+  struct Topic {
+    int priority;
+    double refreshInterval;
+    float tolerance;
+
+    bool staged = false;
+    float stagedA = 0, stagedB = 0;
+
+    bool sentBefore = false;
+    float sentA = 0, sentB = 0;
+    double lastSent = 0;
+  };
+
+  std::vector<Topic> topics;
+  std::vector<int> order; // topic numbers by priority, in the order they were added within one
+
+  unsigned long sent = 0;
+  unsigned long suppressed = 0;
+};
+
+#endif // OUTBOUNDTHROTTLE_H
@@ -1,64 +1,137 @@
 #include "PID.h"
 
-PID::PID() {   }
+template <typename Policy>
+BasicPID<Policy>::BasicPID()
+{
+  ApplyConfiguration(config);
+}
+
+template <typename Policy>
+BasicPID<Policy>::BasicPID(PIDConfig config)
+{
+  SetConfiguration(config);
+}
+
+template <typename Policy>
+bool BasicPID<Policy>::SetConfiguration(PIDConfig config)
+{
+  bool matches =
+      Policy::alwaysIntegral(config) == config.alwaysIntegral &&
+      Policy::resetOnSetpoint(config) == config.resetOnSetpoint &&
+      Policy::feedForward(config) == (config.feedForwardMultiplier != 0) &&
+      Policy::derivative(config) == (config.Kd != 0);
+
+  ApplyConfiguration(config);
+  return matches;
+}
 
-PID::PID(PIDConfig config)
+template <typename Policy>
+void BasicPID<Policy>::ApplyConfiguration(PIDConfig config)
 {
   this->config = config;
-  integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+
+  errorHistLength = config.errorHistLength;
+  if (errorHistLength < 1) errorHistLength = 1;
+  if (errorHistLength > maxErrorHistLength) errorHistLength = maxErrorHistLength;
+  errorCount = 0;
+
+  int integralLength = config.integralErrorHistoryLength;
+  if (integralLength < 1) integralLength = 1;
+  integralErrorHistArray.assign(integralLength, 0.0);
+  ResetIntegral();
+}
+
+template <typename Policy>
+void BasicPID<Policy>::PushError(float error)
+{
+  errorHead = (errorHead + 1) % maxErrorHistLength;
+  errorHist[errorHead] = error;
+  if (errorCount < errorHistLength) errorCount++;
+}
+
+template <typename Policy>
+void BasicPID<Policy>::ResetErrors(float error)
+{
+  errorCount = 0;
+  PushError(error);
+}
+
+template <typename Policy>
+float BasicPID<Policy>::ErrorAt(int i) const
+{
+  if (i >= errorCount) return 0;
+  return errorHist[(errorHead - i + maxErrorHistLength) % maxErrorHistLength];
+}
+
+template <typename Policy>
+void BasicPID<Policy>::AddIntegralSample(float error)
+{
+  if (integralCount == (int)integralErrorHistArray.size())
+  {
+    integralSum -= integralErrorHistArray[step]; //oldest sample falls out of the window
+  }
+  else
+  {
+    integralCount++;
+  }
+  integralErrorHistArray[step] = error;
+  integralSum += error;
+
+  step++;
+  if (step >= (int)integralErrorHistArray.size()) step = 0;
 }
 
-float PID::PIDOut(float calculatedError, float setPoint)
+template <typename Policy>
+void BasicPID<Policy>::ResetIntegral()
 {
+  step = 0;
+  integralCount = 0;
+  integralSum = 0;
+}
 
-  //cout << "ErrorSize:  " << Error.size() << endl;
+template <typename Policy>
+float BasicPID<Policy>::PIDOut(float calculatedError, float setPoint, float dt)
+{
 
-  if (Error.size() >= config.errorHistLength)
+  if (dt <= 0)
   {
-    Error.pop_back();
+    dt = 1 / tunedHz;
   }
 
-  Error.insert(Error.begin(), calculatedError); //insert new error into vector for history purposes.
+  PushError(calculatedError); //insert new error into the history.
 
   float P = 0; //proportional yaw output
   float I = 0; //Integral yaw output
   float D = 0; //Derivative yaw output
 
-  if (setPoint != prevSetPoint && config.resetOnSetpoint)
+  if (Policy::resetOnSetpoint(config) && setPoint != prevSetPoint)
   {
-    Error.clear();
-    integralErrorHistArray.clear();
+    ResetErrors(calculatedError);
+    ResetIntegral();
     prevSetPoint = setPoint;
-    step = 0;
-    integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
   }
 
   //feed forward
   //float FF = config.feedForwardMultiplier * setPoint;
-    float FF = (pow(setPoint, 3) * config.feedForwardMultiplier) + (setPoint * (config.feedForwardMultiplier / 4.6));
+  float FF = 0;
+  if (Policy::feedForward(config))
+  {
+    FF = (setPoint * setPoint * setPoint * config.feedForwardMultiplier) + (setPoint * (config.feedForwardMultiplier / 4.6));
+  }
 
-    if (!config.alwaysIntegral && Error.size() > 1)
+    if (!Policy::alwaysIntegral(config) && errorCount > 1)
     {
         //check the change of sign to see if the rover overshot its goal
-        float sign_change = Error[0] / Error[1];
+        float sign_change = ErrorAt(0) / ErrorAt(1);
         //if the sign has changed between the previous error and the current error
         if(sign_change < 0)
         {
             //reset the integral history and values
-            integralErrorHistArray.clear();
-            integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+            ResetIntegral();
             I = 0;
-            step = 0;
-
-
-            //Store error zero into temp variable
-            float error_zero = Error[0];
 
             //clear the error history in order to prevent movement in the incorrect direction because of the sign change
-            Error.clear();
-
-            //put back into vector
-            Error.push_back(error_zero);
+            ResetErrors(ErrorAt(0));
         }
     }
 
@@ -66,13 +139,13 @@ float PID::PIDOut(float calculatedError, float setPoint)
 
   //error averager
   float avgError = 0;
-  if (Error.size() >= config.errorHistLength)
+  if (errorCount >= errorHistLength)
   {
-    for (int i = 0; i < config.errorHistLength; i++)
+    for (int i = 0; i < errorHistLength; i++)
     {
-      avgError += Error[i];
+      avgError += ErrorAt(i);
     }
-    avgError /= config.errorHistLength;//config.errorHistLength;
+    avgError /= errorHistLength;
   }
   else
   {
@@ -97,32 +170,21 @@ float PID::PIDOut(float calculatedError, float setPoint)
 
 
   //only use integral when error is larger than presumed noise.
-  if (fabs(Error.front()) > config.integralDeadZone)
+  if (fabs(ErrorAt(0)) > config.integralDeadZone)
   {
-    integralErrorHistArray[step] = Error.front(); //add error into the error Array.
-    step++;
+    AddIntegralSample(ErrorAt(0) * dt * tunedHz); //add error into the error Array, weighted by the time it was held.
 
-    if (step >= config.integralErrorHistoryLength) step = 0;
-    if (!config.alwaysIntegral) {
+    if (!Policy::alwaysIntegral(config)) {
       integralOn = true;
     }
   }
 
-
-  float sum = 0;
-  for (int i= 0; i < integralErrorHistArray.size(); i++) //sum the array to get the error over time from t = 0 to present.
-  {
-    sum += integralErrorHistArray[i];
-  }
-
-  if (config.alwaysIntegral || integralOn){
-    I = config.Ki * sum; //this is integrated output
+  if (Policy::alwaysIntegral(config) || integralOn){
+    I = config.Ki * integralSum; //this is integrated output
   }
   else {
-    integralErrorHistArray.clear();
-    integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+    ResetIntegral();
     I = 0;
-    step = 0;
   }
 
   //anti windup
@@ -132,33 +194,16 @@ float PID::PIDOut(float calculatedError, float setPoint)
   //if P is already commanding greater than half max PWM dont use the integral
   if (fabs(I) > config.integralMax || fabs(P) > config.antiWindup) //reset the integral to 0 if it hits its cap of half max PWM
   {
-    integralErrorHistArray.clear();
-    integralErrorHistArray.resize(config.integralErrorHistoryLength, 0.0);
+    ResetIntegral();
     I = 0;
-    step = 0;
   }
 
   //Derivative
-  if (Error.size() < 4 )//(fabs(P) < config.antiWindup)
+  if (Policy::derivative(config) && errorCount < 4 )//(fabs(P) < config.antiWindup)
   {
-    float avgPrevError = 0;
-    for (int i = 1; i < Error.size(); i++)
-    {
-      avgPrevError += Error[i];
-    }
-    if (Error.size() > 1)
-    {
-      avgPrevError /= Error.size()-1;
-    }
-    else
-    {
-      avgPrevError = Error[0];
-    }
+    D = config.Kd * ((ErrorAt(0)+ErrorAt(1))/2 - (ErrorAt(2)+ErrorAt(3))/2) / dt;
 
-
-    D = config.Kd * ((Error[0]+Error[1])/2 - (Error[2]+Error[3])/2) * hz;
-
-    //cout << "PID Error[0]:  " << Error[0] << ", Error[1]:  " << Error[1] << ", Error[2]:  " << Error[2] << ", Error[3]:  " << Error[3] << endl;
+    //cout << "PID Error[0]:  " << ErrorAt(0) << ", Error[1]:  " << ErrorAt(1) << ", Error[2]:  " << ErrorAt(2) << ", Error[3]:  " << ErrorAt(3) << endl;
 
   }
 
@@ -177,3 +222,11 @@ float PID::PIDOut(float calculatedError, float setPoint)
 
   return PIDOut;
 }
+
+// The implementation lives here, instantiate every PID type in use.
+template class BasicPID<RuntimePIDPolicy>;
+#ifndef PID_TUNING
+template class BasicPID< FixedPIDPolicy<true, true> >;
+template class BasicPID< FixedPIDPolicy<false, false> >;
+template class BasicPID< FixedPIDPolicy<true, false, false> >;
+#endif
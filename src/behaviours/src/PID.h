@@ -2,7 +2,9 @@
 #define PID_H
 
 #include <vector>
-#include <ros/ros.h>
+#include <limits>
+#include <cmath>
+#include <iostream>
 
 using namespace std;
 
@@ -23,7 +25,28 @@ struct PIDConfig {
   float derivativeAlpha = 0.7;
 };
 
-class PID
+// PID feature policies. DriveController's PIDs each use a fixed subset of
+// the PIDConfig switches, so their policy fixes those switches at compile
+// time and PIDOut() compiles to straight-line code for that mode. PID uses
+// the runtime policy, which reads every switch from PIDConfig; use it (or
+// build with PID_TUNING) when tuning the switches themselves.
+struct RuntimePIDPolicy {
+  static bool alwaysIntegral(const PIDConfig& config) { return config.alwaysIntegral; }
+  static bool resetOnSetpoint(const PIDConfig& config) { return config.resetOnSetpoint; }
+  static bool feedForward(const PIDConfig& config) { return config.feedForwardMultiplier != 0; }
+  static bool derivative(const PIDConfig& config) { return config.Kd != 0; }
+};
+
+template <bool AlwaysIntegral, bool FeedForward, bool Derivative = true, bool ResetOnSetpoint = true>
+struct FixedPIDPolicy {
+  static bool alwaysIntegral(const PIDConfig&) { return AlwaysIntegral; }
+  static bool resetOnSetpoint(const PIDConfig&) { return ResetOnSetpoint; }
+  static bool feedForward(const PIDConfig&) { return FeedForward; }
+  static bool derivative(const PIDConfig&) { return Derivative; }
+};
+
+template <typename Policy>
+class BasicPID
 {
 public:
 
@@ -31,21 +54,60 @@ public:
 
   PIDConfig config;
 
-  PID();
-  PID(PIDConfig config);
+  BasicPID();
+  BasicPID(PIDConfig config);
 
-  float PIDOut(float calculatedError, float setPoint);
+  // dt is the time in seconds since the previous call, the integral and
+  // derivative terms are scaled by it so the output does not depend on
+  // the rate the behaviour loop runs at.
+  float PIDOut(float calculatedError, float setPoint, float dt);
 
-  void SetConfiguration(PIDConfig config) {this->config = config;}
+  // Returns false if the switches of config differ from the policy's. The
+  // policy wins, the caller decides whether that is worth reporting.
+  bool SetConfiguration(PIDConfig config);
 
 private:
 
-  vector<float> Error;
-  float prevSetPoint = std::numeric_limits<float>::min();
+  // SetConfiguration() without the policy check, used for the default config
+  void ApplyConfiguration(PIDConfig config);
+
+  // Recent errors, read newest first through ErrorAt(). Kept in a fixed
+  // size ring so PIDOut() never shifts or reallocates the history.
+  static const int maxErrorHistLength = 16;
+  float errorHist[maxErrorHistLength];
+  int errorHead = 0; // index of the newest error
+  int errorCount = 0;
+  int errorHistLength = 4; // config.errorHistLength clamped to the ring size
+
+  void PushError(float error);
+  void ResetErrors(float error); // history holds only error afterwards
+  float ErrorAt(int i) const; // i = 0 is the newest, 0 if not recorded
+
+  // Integral history ring, sized once from config.integralErrorHistoryLength,
+  // with a running sum so the integral is not re-added every call.
   vector<float> integralErrorHistArray;
-  int step = 0;
-  float hz = 10;	//Rate that PID is running at
+  int step = 0; // next write index
+  int integralCount = 0;
+  double integralSum = 0;
+
+  void AddIntegralSample(float error);
+  void ResetIntegral();
+
+  float prevSetPoint = std::numeric_limits<float>::min();
+  float tunedHz = 10;	//Rate the integral gains were tuned at
 
 };
 
+typedef BasicPID<RuntimePIDPolicy> PID;
+
+#ifdef PID_TUNING
+typedef PID VelocityPID;
+typedef PID YawPID;
+typedef PID ConstYawPID;
+#else
+typedef BasicPID< FixedPIDPolicy<true, true> > VelocityPID; // fast, slow and const velocity
+typedef BasicPID< FixedPIDPolicy<false, false> > YawPID; // fast and slow yaw
+typedef BasicPID< FixedPIDPolicy<true, false, false> > ConstYawPID; // constant angular rate, no derivative
+#endif
+
 #endif // PID_H
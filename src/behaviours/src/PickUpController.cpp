@@ -1,6 +1,8 @@
 #include "PickUpController.h"
+#include "TraceLog.h"
 #include <limits> // For numeric limits
 #include <cmath> // For hypot
+#include "Angles.h"
 
 PickUpController::PickUpController()
 {
@@ -22,58 +24,41 @@ PickUpController::PickUpController()
 
 PickUpController::~PickUpController() { /*Destructor*/  }
 
-void PickUpController::SetTagData(vector<Tag> tags)
+void PickUpController::SetTagData(const TagBatch& tags, const TagSummary& summary)
 {
 
-  if (tags.size() > 0)
+  blockTracker.Expire(current_time);
+
+  if (summary.tags > 0)
   {
 
-    nTargetsSeen = tags.size();
+    nTargetsSeen = summary.tags;
 
     //we saw a target, set target_timer
     target_timer = current_time;
 
-    double closest = std::numeric_limits<double>::max();
-    int target  = 0;
-
-    //this loop selects the closest visible block to makes goals for it
-    for (int i = 0; i < tags.size(); i++)
+    // If the center is seen, then don't try to pick up the cube.
+    if (summary.centers > 0)
     {
 
-      if (tags[i].getID() == 0)
-      {
-
-        targetFound = true;
-
-        //absolute distance to block from camera lens
-        double test = hypot(hypot(tags[i].getPositionX(), tags[i].getPositionY()), tags[i].getPositionZ());
+      Reset();
 
-        if (closest > test)
-        {
-          target = i;
-          closest = test;
-        }
-      }
-      else
+      if (has_control)
       {
-        // If the center is seen, then don't try to pick up the cube.
-        if(tags[i].getID() == 256)
-        {
-
-          Reset();
-
-          if (has_control)
-          {
-            cout << "pickup reset return interupt free" << endl;
-            release_control = true;
-          }
-
-          return;
-        }
+        Trace(TRACE_PICKUP, TRACE_INFO, TRACE_PICKUP_RESET_INTERRUPT_FREE);
+        release_control = true;
       }
+
+      return;
     }
 
-    float cameraOffsetCorrection = 0.023; //meters;
+    //make goals for the closest visible block
+    int target = 0;
+    if (summary.closestTarget >= 0)
+    {
+      targetFound = true;
+      target = summary.closestTarget;
+    }
 
     // using a^2 + b^2 = c^2 to find the distance to the block
     // 0.195 is the height of the camera lens above the ground in cm.
@@ -81,7 +66,7 @@ void PickUpController::SetTagData(vector<Tag> tags)
     // a is the linear distance from the robot to the block, c is the
     // distance from the camera lens, and b is the height of the
     // camera above the ground.
-    blockDistanceFromCamera = hypot(hypot(tags[target].getPositionX(), tags[target].getPositionY()), tags[target].getPositionZ());
+    blockDistanceFromCamera = tags.range[target];
 
     if ( (blockDistanceFromCamera*blockDistanceFromCamera - 0.195*0.195) > 0 )
     {
@@ -95,9 +80,29 @@ void PickUpController::SetTagData(vector<Tag> tags)
 
     //cout << "blockDistance  TAGDATA:  " << blockDistance << endl;
 
-    blockYawError = atan((tags[target].getPositionX() + cameraOffsetCorrection)/blockDistance)*1.05; //angle to block from bottom center of chassis on the horizontal.
+    blockYawError = atan((tags.x[target] + cameraOffsetCorrection)/blockDistance)*blockYawGain; //angle to block from bottom center of chassis on the horizontal.
 
-    cout << "blockYawError TAGDATA:  " << blockYawError << endl;
+    Trace(TRACE_PICKUP, TRACE_DEBUG, TRACE_PICKUP_BLOCK_YAW_ERROR, target, blockYawError);
+
+    //track every visible block in the odometry frame
+    if (hasLocation)
+    {
+      tags.GroundDistances(TagSummary::cameraHeight, groundDistances);
+
+      for (size_t i = 0; i < tags.size(); i++)
+      {
+        if (tags.id[i] != TagSummary::TARGET_ID) continue;
+
+        float distance = groundDistances[i];
+        float heading = currentLocation.theta - atan2(tags.x[i] + cameraOffsetCorrection, distance);
+
+        Point position;
+        position.x = currentLocation.x + distance * cos(heading);
+        position.y = currentLocation.y + distance * sin(heading);
+        position.theta = 0;
+        blockTracker.AddSighting(position, current_time);
+      }
+    }
 
   }
 
@@ -200,6 +205,8 @@ Result PickUpController::DoWork()
 
   if (!targetHeld)
   {
+    PredictBlock();
+
     //threshold distance to be from the target block before attempting pickup
     float targetDistance = 0.15; //meters
 
@@ -251,9 +258,6 @@ Result PickUpController::DoWork()
     //Calculate time difference between last seen tag
     float target_timeout = (current_time - target_timer)/1e3;
 
-    //delay between the camera refresh and rover runtime is 6/10's of a second
-    float target_timeout_limit = 0.61;
-
     //Timer to deal with delay in refresh from camera and the runtime of rover code
     if( target_timeout >= target_timeout_limit )
     {
@@ -355,6 +359,31 @@ Result PickUpController::DoWork()
   return result;
 }
 
+void PickUpController::PredictBlock()
+{
+  //once locked the pickup routine is timed, not steered
+  if (!hasLocation || lockTarget || !targetFound) return;
+
+  //only as long as the camera still counts the block as seen
+  if ((current_time - target_timer)/1e3 >= target_timeout_limit) return;
+
+  Point block;
+  if (!blockTracker.PredictNearest(currentLocation, current_time, block)) return;
+
+  float distance = hypot(block.x - currentLocation.x, block.y - currentLocation.y);
+  float heading = atan2(block.y - currentLocation.y, block.x - currentLocation.x);
+
+  float epsilon = 0.00001; // A small non-zero positive number
+  blockDistance = std::max(distance, epsilon);
+  blockYawError = -ShortestAngularDistance(currentLocation.theta, heading)*blockYawGain;
+}
+
+void PickUpController::SetCurrentLocation(Point currentLocation)
+{
+  this->currentLocation = currentLocation;
+  hasLocation = true;
+}
+
 bool PickUpController::HasWork()
 {
   return targetFound;
@@ -3,6 +3,9 @@
 
 #include "Controller.h"
 #include "Tag.h"
+#include "TagSummary.h"
+#include "TagBatch.h"
+#include "BlockTracker.h"
 
 class PickUpController : virtual Controller
 {
@@ -14,7 +17,7 @@ public:
   Result DoWork() override;
 
   // Give the controller a list of visible april tags.
-  void SetTagData(vector<Tag> tags);
+  void SetTagData(const TagBatch& tags, const TagSummary& summary);
   bool ShouldInterrupt() override;
   bool HasWork() override;
 
@@ -33,11 +36,29 @@ public:
 
   void SetCurrentTimeInMilliSecs( long int time );
 
+  // Odometry pose, used to predict where the block is between camera frames
+  void SetCurrentLocation(Point currentLocation);
+
 protected:
 
   void ProcessData();
 
 private:
+  // Steers on the tracked block nearest to the rover, so the yaw error and
+  // distance follow the rover's motion at the control rate
+  void PredictBlock();
+
+  BlockTracker blockTracker;
+  vector<float> groundDistances; // scratch for SetTagData()
+  Point currentLocation;
+  bool hasLocation = false;
+
+  const float cameraOffsetCorrection = 0.023; //meters
+  const float blockYawGain = 1.05; //scales the angle to the block for steering
+
+  //delay between the camera refresh and rover runtime is 6/10's of a second
+  const float target_timeout_limit = 0.61;
+
   //Set true when the target block is less than targetDist so we continue attempting to pick it up rather than
   //switching to another block that is in view. In other words, the robot focuses on one particular target so
   //it doesn't get confused by having a whole bunch of targets in its view.
@@ -0,0 +1,84 @@
+#include "PoseConvergence.h"
+
+#include <algorithm>
+#include <cmath>
+
+PoseConvergence::PoseConvergence(double window, double tolerance)
+{
+  this->window = window;
+  this->tolerance = tolerance;
+}
+
+void PoseConvergence::Add(double time, Point position, Point mapPosition)
+{
+  if (firstTime < 0)
+  {
+    firstTime = time;
+  }
+
+  Sample sample = {time, position, mapPosition};
+  samples.push_back(sample);
+
+  while (!samples.empty() && samples.front().time < time - window)
+  {
+    samples.pop_front();
+  }
+}
+
+bool PoseConvergence::IsStable() const
+{
+  // A couple of samples could agree by chance
+  const unsigned int minSamples = 3;
+
+  if (samples.size() < minSamples || samples.back().time - firstTime < window)
+  {
+    return false;
+  }
+
+  return Spread() <= tolerance;
+}
+
+void PoseConvergence::Reset()
+{
+  samples.clear();
+  firstTime = -1;
+}
+
+double PoseConvergence::Spread() const
+{
+  if (samples.empty())
+  {
+    return 0;
+  }
+
+  double sum[4] = {0, 0, 0, 0};
+  double sumSquares[4] = {0, 0, 0, 0};
+
+  // Relative to the first sample so the squares stay small
+  const Sample& first = samples.front();
+  for (const Sample& sample : samples)
+  {
+    double values[4] = {
+      sample.position.x - first.position.x,
+      sample.position.y - first.position.y,
+      sample.mapPosition.x - first.mapPosition.x,
+      sample.mapPosition.y - first.mapPosition.y
+    };
+
+    for (int i = 0; i < 4; i++)
+    {
+      sum[i] += values[i];
+      sumSquares[i] += values[i] * values[i];
+    }
+  }
+
+  double spread = 0;
+  for (int i = 0; i < 4; i++)
+  {
+    double mean = sum[i] / samples.size();
+    double variance = std::max(0.0, sumSquares[i] / samples.size() - mean * mean);
+    spread = std::max(spread, sqrt(variance));
+  }
+
+  return spread;
+}
@@ -0,0 +1,45 @@
+#ifndef POSECONVERGENCE_H
+#define POSECONVERGENCE_H
+
+#include <deque>
+
+#include "Point.h"
+
+// Decides when the rover's pose estimates have settled enough to fix the
+// collection zone location from them. Samples of the odometry and map (GPS
+// fused) positions are kept for the last window seconds. The pose is stable
+// once samples cover the whole window and the standard deviation of x and y
+// in both frames is at most tolerance meters.
+class PoseConvergence
+{
+public:
+  PoseConvergence(double window = 5, double tolerance = 0.05);
+
+  void SetWindow(double window) { this->window = window; }
+  void SetTolerance(double tolerance) { this->tolerance = tolerance; }
+  double GetWindow() const { return window; }
+  double GetTolerance() const { return tolerance; }
+
+  // time in seconds
+  void Add(double time, Point position, Point mapPosition);
+  bool IsStable() const;
+  void Reset();
+
+  // Largest standard deviation of x or y in either frame over the window
+  double Spread() const;
+
+private:
+  struct Sample {
+    double time;
+    Point position;
+    Point mapPosition;
+  };
+
+  double window;
+  double tolerance;
+
+  std::deque<Sample> samples;
+  double firstTime = -1; // time of the first sample since Reset()
+};
+
+#endif // POSECONVERGENCE_H
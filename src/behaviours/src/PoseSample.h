@@ -0,0 +1,25 @@
+#ifndef POSESAMPLE_H
+#define POSESAMPLE_H
+
+#include <cmath>
+
+#include "Point.h"
+
+// One odometry message reduced to what the behaviours use: the pose in the
+// plane and the forward and turning speeds. The odometry and map sources
+// each hand their own to LogicController.
+struct PoseSample {
+  Point pose = {0, 0, 0}; // theta is the yaw
+  float linearVelocity = 0; // meters per second
+  float angularVelocity = 0; // radians per second
+};
+
+// The yaw of a quaternion, the same as tf::Matrix3x3::getRPY() gives for
+// it without building the matrix. Needs no normalized quaternion: both
+// arguments carry the same squared norm.
+inline float PlanarYaw(double x, double y, double z, double w)
+{
+  return atan2(2 * (w*z + x*y), w*w + x*x - y*y - z*z);
+}
+
+#endif // POSESAMPLE_H
@@ -1,13 +1,10 @@
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 
 // ROS libraries
 #include <angles/angles.h>
-#include <random_numbers/random_numbers.h>
 #include <tf/transform_datatypes.h>
 #include <tf/transform_listener.h>
-#include <message_filters/subscriber.h>
-#include <message_filters/synchronizer.h>
-#include <message_filters/sync_policies/approximate_time.h>
 
 // ROS messages
 #include <std_msgs/Float32.h>
@@ -19,17 +16,45 @@
 #include <geometry_msgs/Pose2D.h>
 #include <geometry_msgs/Twist.h>
 #include <nav_msgs/Odometry.h>
+#include <sensor_msgs/Imu.h>
 #include <apriltags_ros/AprilTagDetectionArray.h>
 #include <std_msgs/Float32MultiArray.h>
 #include "swarmie_msgs/Waypoint.h"
+#include "swarmie_msgs/WaypointBatch.h"
+#include "swarmie_msgs/TargetSightings.h"
+#include "swarmie_msgs/RoverBeacon.h"
+#include "swarmie_msgs/NestRequest.h"
+#include "swarmie_msgs/MotionState.h"
+#include "swarmie_msgs/DetectionHint.h"
+#include "swarmie_msgs/BehaviourState.h"
+#include "swarmie_msgs/ControlTrace.h"
+#include <sbridge/sbridge.h>
+#include <shm_transport/SharedRing.h>
+#include <shm_transport/RoverSamples.h>
 
 // Include Controllers
 #include "LogicController.h"
+#include "SonarFusion.h"
+#include "SonarFilter.h"
 #include <vector>
+#include <cmath>
+#include <algorithm>
+#include <thread>
+#include <map>
+#include <limits>
 
 #include "Point.h"
 #include "Tag.h"
 #include "SearchController.h"
+#include "SeqLock.h"
+#include "DeadlineMonitor.h"
+#include "OutboundThrottle.h"
+#include "LocalizationRate.h"
+#include "DetectionHint.h"
+#include "PoseConvergence.h"
+#include "TraceLog.h"
+#include "RoverAvoidance.h"
+#include "PoseSample.h"
 
 // To handle shutdown signals so the node quits
 // properly in response to "rosnode kill"
@@ -46,13 +71,12 @@ using namespace std;
 class ROSAdapterRangeShapeInvalidTypeException : public std::exception {
 public:
   ROSAdapterRangeShapeInvalidTypeException(std::string msg) {
-    this->msg = msg;
+    this->msg = "Invalid RangeShape type provided: " + msg;
   }
   
   virtual const char* what() const throw()
   {
-    std::string message = "Invalid RangeShape type provided: " + msg;
-    return message.c_str();
+    return msg.c_str();
   }
   
 private:
@@ -60,19 +84,42 @@ private:
 };
 
 
-// Random number generator
-random_numbers::RandomNumberGenerator* rng;
-
 // Create logic controller
 
 LogicController logicController;
 
+// Sensor topics are serviced from their own queue by an AsyncSpinner so a
+// slow behaviour tick does not delay sensor ingestion, and vice versa.
+// Sensor handlers only hand data to logicController through its sensor
+// snapshot setters, everything else runs on the main thread.
+ros::CallbackQueue sensorQueue;
+
+// The sonars get a queue and spinner of their own so obstacle detection is
+// not held up behind camera frames or odometry. Each sonar is handed on as it
+// arrives together with the latest range of the other two. Each range is
+// filtered first so a single spurious echo does not reach the controllers,
+// see SonarFilter.h.
+ros::CallbackQueue sonarQueue;
+SonarFusion sonarFusion;
+SonarFilter sonarFilters[SonarFusion::NUM_SONARS];
 
 
 void humanTime();
+unsigned long sonarRejectedCount();
+unsigned long sonarSampleCount();
+
+// Times along the path from a sonar reading to the drive command computed
+// from it, in ROS seconds. Sent to abridge after the drive command so it can
+// break the control latency down by stage, see sendDriveCommand().
+struct ControlTrace {
+  double sonarStamp;    // abridge read the newest sonar range
+  double sonarReceived; // sonarHandler received it
+  double workStart;     // the LogicController::DoWork() that used it started
+};
 
 // Behaviours Logic Functions
-void sendDriveCommand(double linearVel, double angularVel);
+void sendDriveCommand(double linearVel, double angularVel, const ControlTrace* trace = NULL);
+void flushActuatorCommands(const ControlTrace* trace);
 void openFingers(); // Open fingers to 90 degrees
 void closeFingers();// Close fingers to 0 degrees
 void raiseWrist();  // Return wrist back to 0 degrees
@@ -83,10 +130,11 @@ void resultHandler();
 Point updateCenterLocation();
 void transformMapCentertoOdom();
 
+Result timedDoWork();
+void recordLoopTiming(const ros::TimerEvent& event);
+
 
 // Numeric Variables for rover positioning
-geometry_msgs::Pose2D currentLocation;
-geometry_msgs::Pose2D currentLocationMap;
 geometry_msgs::Pose2D currentLocationAverage;
 
 geometry_msgs::Pose2D centerLocation;
@@ -95,17 +143,18 @@ geometry_msgs::Pose2D centerLocationOdom;
 geometry_msgs::Pose2D centerLocationMapRef;
 
 int currentMode = 0;
-const float behaviourLoopTimeStep = 0.1; // time between the behaviour loop calls
+float behaviourLoopTimeStep = 0.1; // time between the behaviour loop calls, set from ~behaviour_loop_rate
 const float status_publish_interval = 1;
 const float heartbeat_publish_interval = 2;
+const float profile_publish_interval = 5; // seconds covered by each controller timing summary
+const float trace_level_refresh_interval = 2; // seconds between re-reading the trace_level parameters
 const float waypointTolerance = 0.1; //10 cm tolerance.
+float waypointFeedbackInterval = 0.25; // seconds between reached waypoint batches, set from ~waypoint_feedback_rate
+double lastWaypointFeedbackTime = 0;
 
 // used for calling code once but not in main
 bool initilized = false;
 
-float linearVelocity = 0;
-float angularVelocity = 0;
-
 float prevWrist = 0;
 float prevFinger = 0;
 long int startTime = 0;
@@ -122,20 +171,48 @@ std_msgs::String msg;
 geometry_msgs::Twist velocity;
 char host[128];
 string publishedName;
-char prev_state_machine[128];
 
 // Publishers
+// LogicController's state changes, as BehaviourState messages on
+// "/<robot>/behaviour/state" and the process state name on
+// "/<robot>/state_machine", see publishStateEvents()
 ros::Publisher stateMachinePublish;
+ros::Publisher behaviourStatePublisher;
 ros::Publisher status_publisher;
 ros::Publisher fingerAnglePublish;
 ros::Publisher wristAnglePublish;
 ros::Publisher infoLogPublisher;
 ros::Publisher driveControlPublish;
+// The ControlTrace of each drive command DoWork computed, on
+// "/<robot>/driveControl/trace"
+ros::Publisher driveTracePublisher;
 ros::Publisher heartbeatPublisher;
-// Publishes swarmie_msgs::Waypoint messages on "/<robot>/waypooints"
-// to indicate when waypoints have been reached.
+ros::Publisher profilePublisher;
+ros::Publisher swarmPresencePublisher;
+// Cube sightings for the other rovers on "/targetSightings"
+ros::Publisher targetSightingsPublisher;
+// This rover's pose and intent for the others on "/roverBeacons"
+ros::Publisher roverBeaconPublisher;
+// This rover's turn at the collection zone on "/nestRequests"
+ros::Publisher nestRequestPublisher;
+// Publishes swarmie_msgs::WaypointBatch messages on "/<robot>/waypoints"
+// with the waypoints reached since the last one.
 ros::Publisher waypointFeedbackPublisher;
 
+// Drive bridge and sensor transport
+// In simulation the drive bridge can run in this process instead of as the
+// sbridge node. Drive commands then reach it as shared pointers, without
+// being serialized or waking another process.
+sbridge* embeddedSbridge = NULL;
+
+// When true the sonar ranges come from abridge and the drive commands go to
+// it through shared memory rings (see SharedRing.h in shm_transport) instead
+// of loopback TCPROS. Both nodes need the same shared_memory_transport
+// setting. The drive commands are still published for the other bridges.
+bool sharedMemoryTransport = false;
+shm_transport::SharedRingReader<shm_transport::SonarSample> sonarRing;
+shm_transport::SharedRingWriter<shm_transport::DriveSample> driveRing;
+
 // Subscribers
 ros::Subscriber joySubscriber;
 ros::Subscriber modeSubscriber; 
@@ -143,26 +220,122 @@ ros::Subscriber targetSubscriber;
 ros::Subscriber odometrySubscriber;
 ros::Subscriber mapSubscriber;
 ros::Subscriber virtualFenceSubscriber;
+ros::Subscriber sonarLeftSubscriber;
+ros::Subscriber sonarCenterSubscriber;
+ros::Subscriber sonarRightSubscriber;
 // manualWaypointSubscriber listens on "/<robot>/waypoints/cmd" for
-// swarmie_msgs::Waypoint messages.
+// swarmie_msgs::WaypointBatch messages.
 ros::Subscriber manualWaypointSubscriber;
+// Names of the autonomous rovers on "/swarmPresence", see updateSwarmPosition()
+ros::Subscriber swarmPresenceSubscriber;
+// The other rovers' cube sightings and claims, see TargetBlackboard.h
+ros::Subscriber targetSightingsSubscriber;
+// The other rovers' poses, see RoverAvoidance.h
+ros::Subscriber roverBeaconSubscriber;
+// The other rovers' requests for the collection zone, see NestScheduler.h
+ros::Subscriber nestRequestSubscriber;
+// Paths on "/<robot>/behaviour/flight_record_dump" to copy the flight record to
+ros::Subscriber flightRecordDumpSubscriber;
+// The localization filters' sensor inputs, only with ~adaptive_localization
+ros::Subscriber rawOdometrySubscriber;
+ros::Subscriber imuSubscriber;
 
 // Timers
 ros::Timer stateMachineTimer;
 ros::Timer publish_status_timer;
 ros::Timer publish_heartbeat_timer;
+ros::Timer publish_profile_timer;
+ros::Timer trace_level_timer;
+ros::Timer tfRefreshTimer;
+ros::Timer roverBeaconTimer;
+
+// Steers the drive commands clear of the other rovers. Only used on the
+// main thread.
+RoverAvoidance roverAvoidance;
+// Whether the last nest request sent was still requesting, so a withdrawal
+// is sent once
+bool nestRequestSent = false;
+float roverBeaconInterval = 0.25; // seconds, set from ~rover_beacon_rate
+const float avoidanceTurnGain = 60; // PWM of turn per radian of heading change
+
+// When each autonomous rover, including this one, last announced itself.
+// Rovers not heard from for swarmPresenceTimeout seconds have dropped out
+// and their search lanes are handed to the others.
+map<string, double> swarmLastSeen;
+const float swarmPresenceTimeout = 3 * heartbeat_publish_interval;
 
 // records time for delays in sequanced actions, 1 second resolution.
 time_t timerStartTime;
 
-// An initial delay to allow the rover to gather enough position data to 
-// average its location.
+// The rover waits until its pose estimates are stable before it fixes the
+// center location, see PoseConvergence. startDelayInSeconds bounds the wait.
 unsigned int startDelayInSeconds = 30;
 float timerTimeElapsed = 0;
+PoseConvergence startPoseConvergence;
+unsigned int startPositionUpdates = 0; // SensorSnapshot update counts at the last sample
+unsigned int startMapPositionUpdates = 0;
 
 //Transforms
 tf::TransformListener *tfListener;
 
+// Latest map to odom transform. Refreshed from the sensor queue and read by
+// the behaviour loop without blocking on TF.
+struct MapToOdomTransform {
+  double x;
+  double y;
+  double yaw;
+  double stamp; // ROS time of the transform in seconds
+};
+SeqLock<MapToOdomTransform> mapToOdomCache;
+const float tfRefreshInterval = 0.05; // seconds between cache refreshes
+double tfCacheMaxAge = 1.0; // cached transforms older than this are counted as stale
+unsigned long tfCacheStaleUses = 0; // ticks that used a transform older than tfCacheMaxAge
+
+// The behaviour loop's drive and gripper commands are staged here and only
+// sent when they change or are due a refresh, see OutboundThrottle.h
+OutboundThrottle actuatorThrottle;
+int driveTopic = actuatorThrottle.AddTopic(OutboundThrottle::PRIORITY_DRIVE, 1.0);
+int fingerTopic = actuatorThrottle.AddTopic(OutboundThrottle::PRIORITY_GRIPPER, 1.0, 0.001);
+int wristTopic = actuatorThrottle.AddTopic(OutboundThrottle::PRIORITY_GRIPPER, 1.0, 0.001);
+
+// With ~adaptive_localization the odometry and IMU messages the localization
+// filters use are relayed to "<topic>/localization" at a rate that follows
+// the motion state, see LocalizationRate.h. The state is published on
+// "/<robot>/motion_state" when it changes.
+bool adaptiveLocalization = false;
+LocalizationRate localizationRate;
+int odomInput = localizationRate.AddInput();
+int imuInput = localizationRate.AddInput();
+int filteredOdomInput = localizationRate.AddInput();
+ros::Publisher motionStatePublisher;
+
+// Where the tags the running controller needs are in the camera image, for
+// the crop stage in front of the tag detector, see DetectionHint.h. Sent on
+// "/<robot>/targets/hint" each tick while there is a region and once when it
+// goes back to the whole image.
+DetectionHint detectionHint;
+ros::Publisher detectionHintPublisher;
+ros::Publisher odomRelayPublisher;
+ros::Publisher imuRelayPublisher;
+ros::Publisher filteredOdomRelayPublisher;
+bool driveCommanded = false; // whether the last drive command sent was not a stop
+const float parkedLinearSpeed = 0.02; // m/s, measured speeds below these count as still
+const float parkedAngularSpeed = 0.05; // rad/s
+
+// Behaviour loop timing statistics
+DeadlineMonitor behaviourLoopMonitor;
+double lastWorkTime = 0; // seconds spent in the last LogicController::DoWork()
+
+// Written by sonarHandler on the sensor thread, only sonarStamp and
+// sonarReceived are used. lastWorkTrace is set by timedDoWork().
+SeqLock<ControlTrace> sonarTrace;
+ControlTrace lastWorkTrace = {0, 0, 0};
+const float loopStatsLogInterval = 30; // seconds between timing summaries
+
+// Ring file of the last behaviour ticks, see FlightRecorder.h. Empty when
+// the flight recorder is off.
+string flightRecordFile;
+
 // OS Signal Handler
 void sigintEventHandler(int signal);
 
@@ -173,11 +346,31 @@ void targetHandler(const apriltags_ros::AprilTagDetectionArray::ConstPtr& tagInf
 void odometryHandler(const nav_msgs::Odometry::ConstPtr& message);
 void mapHandler(const nav_msgs::Odometry::ConstPtr& message);
 void virtualFenceHandler(const std_msgs::Float32MultiArray& message);
-void manualWaypointHandler(const swarmie_msgs::Waypoint& message);
-void behaviourStateMachine(const ros::TimerEvent&);
+void manualWaypointHandler(const swarmie_msgs::WaypointBatch& message);
+void swarmPresenceHandler(const std_msgs::String::ConstPtr& message);
+void updateSwarmPosition();
+void targetSightingsHandler(const swarmie_msgs::TargetSightings::ConstPtr& message);
+void publishTargetSightings();
+void roverBeaconHandler(const swarmie_msgs::RoverBeacon::ConstPtr& message);
+void roverBeaconTimerEventHandler(const ros::TimerEvent& event);
+void nestRequestHandler(const swarmie_msgs::NestRequest::ConstPtr& message);
+void flightRecordDumpHandler(const std_msgs::String::ConstPtr& message);
+void rawOdometryHandler(const nav_msgs::Odometry::ConstPtr& message);
+void imuHandler(const sensor_msgs::Imu::ConstPtr& message);
+void updateMotionState();
+void updateDetectionHint();
+void publishStateEvents();
+void publishNestRequest();
+void applySwarmAvoidance(float& left, float& right);
+void behaviourStateMachine(const ros::TimerEvent& event);
 void publishStatusTimerEventHandler(const ros::TimerEvent& event);
 void publishHeartBeatTimerEventHandler(const ros::TimerEvent& event);
-void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight);
+void publishProfileTimerEventHandler(const ros::TimerEvent& event);
+void traceLevelTimerEventHandler(const ros::TimerEvent& event);
+void tfRefreshTimerEventHandler(const ros::TimerEvent& event);
+void sonarHandler(SonarFusion::Sonar sonar, const sensor_msgs::Range::ConstPtr& message);
+void handleSonar(float left, float center, float right, double stamp);
+void sharedSonarLoop();
 
 // Converts the time passed as reported by ROS (which takes Gazebo simulation rate into account) into milliseconds as an integer.
 long int getROSTimeInMilliSecs();
@@ -200,46 +393,281 @@ int main(int argc, char **argv) {
   ros::init(argc, argv, (publishedName + "_BEHAVIOUR"), ros::init_options::NoSigintHandler);
   ros::NodeHandle mNH;
   
+  // Sensor subscriptions go on their own callback queue
+  ros::NodeHandle sensorNH;
+  sensorNH.setCallbackQueue(&sensorQueue);
+  ros::NodeHandle sonarNH;
+  sonarNH.setCallbackQueue(&sonarQueue);
+  
+  ros::NodeHandle privateNH("~");
+  privateNH.param("tf_cache_max_age", tfCacheMaxAge, tfCacheMaxAge);
+  
+  double behaviourLoopRate = 1 / behaviourLoopTimeStep;
+  privateNH.param("behaviour_loop_rate", behaviourLoopRate, behaviourLoopRate);
+  if (behaviourLoopRate > 0)
+  {
+    behaviourLoopTimeStep = 1 / behaviourLoopRate;
+  }
+  else
+  {
+    ROS_WARN("Ignoring invalid behaviour_loop_rate %f, using %f Hz", behaviourLoopRate, 1 / behaviourLoopTimeStep);
+  }
+  behaviourLoopMonitor.SetPeriod(behaviourLoopTimeStep);
+  
+  // Search lanes around the collection zone, see SearchController.h
+  double searchFirstLaneRadius = 1.0;
+  double searchLaneSpacing = 0.75;
+  double searchMaxLaneRadius = 7.0;
+  privateNH.param("search_first_lane_radius", searchFirstLaneRadius, searchFirstLaneRadius);
+  privateNH.param("search_lane_spacing", searchLaneSpacing, searchLaneSpacing);
+  privateNH.param("search_max_lane_radius", searchMaxLaneRadius, searchMaxLaneRadius);
+  logicController.SetSearchLanes(searchFirstLaneRadius, searchLaneSpacing, searchMaxLaneRadius);
+  
+  // Cube sightings shared with the other rovers, see TargetBlackboard.h
+  double targetBucketSize = 0.5; // meters
+  double targetDecayTime = 600; // seconds
+  privateNH.param("target_bucket_size", targetBucketSize, targetBucketSize);
+  privateNH.param("target_decay_time", targetDecayTime, targetDecayTime);
+  logicController.SetTargetBlackboard(targetBucketSize, targetDecayTime);
+  
+  // Unchanged actuator commands are resent this often
+  double actuatorRefreshInterval = 1.0;
+  privateNH.param("actuator_refresh_interval", actuatorRefreshInterval, actuatorRefreshInterval);
+  actuatorThrottle.SetRefreshInterval(driveTopic, actuatorRefreshInterval);
+  actuatorThrottle.SetRefreshInterval(fingerTopic, actuatorRefreshInterval);
+  actuatorThrottle.SetRefreshInterval(wristTopic, actuatorRefreshInterval);
+  
+  // How often the localization filters are fed while parked, cruising
+  // and on a precision approach, 0 for every message
+  privateNH.param("adaptive_localization", adaptiveLocalization, adaptiveLocalization);
+  double parkedLocalizationRate = 1;
+  double cruisingLocalizationRate = 0;
+  double precisionLocalizationRate = 0;
+  double localizationParkDelay = 2;
+  privateNH.param("localization_rate_parked", parkedLocalizationRate, parkedLocalizationRate);
+  privateNH.param("localization_rate_cruising", cruisingLocalizationRate, cruisingLocalizationRate);
+  privateNH.param("localization_rate_precision", precisionLocalizationRate, precisionLocalizationRate);
+  privateNH.param("localization_park_delay", localizationParkDelay, localizationParkDelay);
+  localizationRate.SetRate(LocalizationRate::MOTION_PARKED, parkedLocalizationRate);
+  localizationRate.SetRate(LocalizationRate::MOTION_CRUISING, cruisingLocalizationRate);
+  localizationRate.SetRate(LocalizationRate::MOTION_PRECISION, precisionLocalizationRate);
+  localizationRate.SetParkDelay(localizationParkDelay);
+  
+  // Meters around the tags the detector is asked to search, and the ticks
+  // it keeps searching there once it stopped seeing them
+  double detectionHintMargin = detectionHint.GetMargin();
+  int detectionHintHoldTicks = 5;
+  privateNH.param("detection_hint_margin", detectionHintMargin, detectionHintMargin);
+  privateNH.param("detection_hint_hold_ticks", detectionHintHoldTicks, detectionHintHoldTicks);
+  detectionHint.SetMargin(detectionHintMargin);
+  detectionHint.SetHoldTicks(detectionHintHoldTicks);
+  
+  // Reached manual waypoints are reported in batches
+  double waypointFeedbackRate = 1 / waypointFeedbackInterval;
+  privateNH.param("waypoint_feedback_rate", waypointFeedbackRate, waypointFeedbackRate);
+  if (waypointFeedbackRate > 0) waypointFeedbackInterval = 1 / waypointFeedbackRate;
+  
+  // Keeping clear of the other rovers, see RoverAvoidance.h
+  double roverBeaconRate = 1 / roverBeaconInterval;
+  privateNH.param("rover_beacon_rate", roverBeaconRate, roverBeaconRate);
+  if (roverBeaconRate > 0) roverBeaconInterval = 1 / roverBeaconRate;
+  
+  // Taking turns at the collection zone, see NestScheduler.h
+  double nestHoldingRadius = 1.5; // meters
+  double nestRequestRadius = 2.5; // meters
+  privateNH.param("nest_holding_radius", nestHoldingRadius, nestHoldingRadius);
+  privateNH.param("nest_request_radius", nestRequestRadius, nestRequestRadius);
+  logicController.SetNestScheduler(publishedName, nestHoldingRadius, nestRequestRadius);
+  
+  int startDelayMax = startDelayInSeconds;
+  privateNH.param("start_delay_max", startDelayMax, startDelayMax);
+  startDelayInSeconds = std::max(0, startDelayMax);
+  double startPoseWindow = startPoseConvergence.GetWindow();
+  privateNH.param("start_pose_window", startPoseWindow, startPoseWindow);
+  startPoseConvergence.SetWindow(startPoseWindow);
+  double startPoseTolerance = startPoseConvergence.GetTolerance();
+  privateNH.param("start_pose_tolerance", startPoseTolerance, startPoseTolerance);
+  startPoseConvergence.SetTolerance(startPoseTolerance);
+  
+  // Binary trace of the behaviour hot path, see TraceLog.h. Disabled unless
+  // a file is given.
+  string traceFile;
+  privateNH.param("trace_file", traceFile, string(""));
+  if (!traceFile.empty())
+  {
+    if (TraceLog::Instance().Open(traceFile))
+    {
+      ROS_INFO("Writing behaviour trace to %s", traceFile.c_str());
+    }
+    else
+    {
+      ROS_WARN("Could not open behaviour trace file %s", traceFile.c_str());
+    }
+  }
+  
+  // Recording of the logic controller inputs and results for offline replay
+  // with behaviours_replay. Disabled unless a file is given.
+  string replayRecordFile;
+  privateNH.param("replay_record_file", replayRecordFile, string(""));
+  if (!replayRecordFile.empty())
+  {
+    if (logicController.RecordTo(replayRecordFile))
+    {
+      ROS_INFO("Recording logic controller replay to %s", replayRecordFile.c_str());
+    }
+    else
+    {
+      ROS_WARN("Could not open logic controller replay file %s", replayRecordFile.c_str());
+    }
+  }
+  
+  // The controllers draw their random numbers from streams split from this
+  // seed and the rover's name, after the replay recording is opened so a
+  // replay draws the same ones. A negative seed is taken from the clock.
+  int randomSeed = 0;
+  privateNH.param("random_seed", randomSeed, randomSeed);
+  uint64_t seed = randomSeed >= 0 ? (uint64_t)randomSeed : (uint64_t)ros::WallTime::now().toNSec();
+  logicController.SetRandomSeed(seed, RandomStream::Id(publishedName));
+  ROS_INFO("Random seed %llu", (unsigned long long)seed);
+
+  // Off by default so drop offs behave as they did before the seeds
+  bool randomSpinStart = false;
+  privateNH.param("random_spin_start", randomSpinStart, randomSpinStart);
+  logicController.SetRandomSpinStart(randomSpinStart);
+
+  if (!logicController.PIDConfigsMatchPolicies())
+  {
+    ROS_WARN("PID configuration switches differ from the compiled PID policies, the policies win");
+  }
+  
+  // The last flight_record_minutes of behaviour ticks in a ring file that
+  // outlives a crash of the node. Disabled unless a file is given.
+  double flightRecordMinutes = 10;
+  privateNH.param("flight_record_file", flightRecordFile, string(""));
+  privateNH.param("flight_record_minutes", flightRecordMinutes, flightRecordMinutes);
+  if (!flightRecordFile.empty())
+  {
+    uint32_t flightRecords = std::max(1.0, flightRecordMinutes * 60 / behaviourLoopTimeStep);
+    if (logicController.FlightRecordTo(flightRecordFile, flightRecords))
+    {
+      ROS_INFO("Keeping the last %.1f minutes of behaviour ticks in %s", flightRecordMinutes, flightRecordFile.c_str());
+    }
+    else
+    {
+      ROS_WARN("Could not create flight record file %s", flightRecordFile.c_str());
+      flightRecordFile.clear();
+    }
+  }
+  
+  
   // Register the SIGINT event handler so the node can shutdown properly
   signal(SIGINT, sigintEventHandler);
   
   joySubscriber = mNH.subscribe((publishedName + "/joystick"), 10, joyCmdHandler);
   modeSubscriber = mNH.subscribe((publishedName + "/mode"), 1, modeHandler);
-  targetSubscriber = mNH.subscribe((publishedName + "/targets"), 10, targetHandler);
-  odometrySubscriber = mNH.subscribe((publishedName + "/odom/filtered"), 10, odometryHandler);
-  mapSubscriber = mNH.subscribe((publishedName + "/odom/ekf"), 10, mapHandler);
+  targetSubscriber = sensorNH.subscribe((publishedName + "/targets"), 10, targetHandler);
+  odometrySubscriber = sensorNH.subscribe((publishedName + "/odom/filtered"), 10, odometryHandler);
+  mapSubscriber = sensorNH.subscribe((publishedName + "/odom/ekf"), 10, mapHandler);
   virtualFenceSubscriber = mNH.subscribe(("/virtualFence"), 10, virtualFenceHandler);
   manualWaypointSubscriber = mNH.subscribe((publishedName + "/waypoints/cmd"), 10, manualWaypointHandler);
-  message_filters::Subscriber<sensor_msgs::Range> sonarLeftSubscriber(mNH, (publishedName + "/sonarLeft"), 10);
-  message_filters::Subscriber<sensor_msgs::Range> sonarCenterSubscriber(mNH, (publishedName + "/sonarCenter"), 10);
-  message_filters::Subscriber<sensor_msgs::Range> sonarRightSubscriber(mNH, (publishedName + "/sonarRight"), 10);
+  swarmPresenceSubscriber = mNH.subscribe(("/swarmPresence"), 10, swarmPresenceHandler);
+  targetSightingsSubscriber = mNH.subscribe(("/targetSightings"), 10, targetSightingsHandler);
+  roverBeaconSubscriber = mNH.subscribe(("/roverBeacons"), 20, roverBeaconHandler);
+  nestRequestSubscriber = mNH.subscribe(("/nestRequests"), 20, nestRequestHandler);
+  if (!flightRecordFile.empty())
+  {
+    flightRecordDumpSubscriber = mNH.subscribe((publishedName + "/behaviour/flight_record_dump"), 1, flightRecordDumpHandler);
+  }
+  privateNH.param("shared_memory_transport", sharedMemoryTransport, sharedMemoryTransport);
+  double sonarStaleTimeout = sonarFusion.GetStaleTimeout();
+  privateNH.param("sonar_stale_timeout", sonarStaleTimeout, sonarStaleTimeout);
+  sonarFusion.SetStaleTimeout(sonarStaleTimeout);
+  
+  // The median window, the fastest a range may move before it is held back
+  // as an outlier (m/s, 0 for no gating) and the outliers in a row taken as
+  // a real change
+  int sonarMedianWindow = sonarFilters[0].GetWindow();
+  double sonarMaxRate = sonarFilters[0].GetMaxRate();
+  int sonarConfirmSamples = sonarFilters[0].GetConfirmSamples();
+  privateNH.param("sonar_median_window", sonarMedianWindow, sonarMedianWindow);
+  privateNH.param("sonar_max_rate", sonarMaxRate, sonarMaxRate);
+  privateNH.param("sonar_confirm_samples", sonarConfirmSamples, sonarConfirmSamples);
+  for (SonarFilter& filter : sonarFilters)
+  {
+    filter.SetWindow(sonarMedianWindow);
+    filter.SetMaxRate(sonarMaxRate);
+    filter.SetConfirmSamples(sonarConfirmSamples);
+  }
+  std::thread sharedSonarThread;
+  if (sharedMemoryTransport)
+  {
+    if (!driveRing.Open(shm_transport::SegmentName(publishedName, "driveControl"), shm_transport::driveRingCapacity))
+    {
+      ROS_WARN("Could not create the shared memory drive ring, abridge will not get drive commands");
+    }
+    sharedSonarThread = std::thread(sharedSonarLoop);
+  }
+  else
+  {
+    sonarLeftSubscriber = sonarNH.subscribe<sensor_msgs::Range>((publishedName + "/sonarLeft"), 10, boost::bind(&sonarHandler, SonarFusion::LEFT, _1));
+    sonarCenterSubscriber = sonarNH.subscribe<sensor_msgs::Range>((publishedName + "/sonarCenter"), 10, boost::bind(&sonarHandler, SonarFusion::CENTER, _1));
+    sonarRightSubscriber = sonarNH.subscribe<sensor_msgs::Range>((publishedName + "/sonarRight"), 10, boost::bind(&sonarHandler, SonarFusion::RIGHT, _1));
+  }
   
   status_publisher = mNH.advertise<std_msgs::String>((publishedName + "/status"), 1, true);
   stateMachinePublish = mNH.advertise<std_msgs::String>((publishedName + "/state_machine"), 1, true);
+  behaviourStatePublisher = mNH.advertise<swarmie_msgs::BehaviourState>((publishedName + "/behaviour/state"), 20, true);
   fingerAnglePublish = mNH.advertise<std_msgs::Float32>((publishedName + "/fingerAngle/cmd"), 1, true);
   wristAnglePublish = mNH.advertise<std_msgs::Float32>((publishedName + "/wristAngle/cmd"), 1, true);
   infoLogPublisher = mNH.advertise<std_msgs::String>("/infoLog", 1, true);
   driveControlPublish = mNH.advertise<geometry_msgs::Twist>((publishedName + "/driveControl"), 10);
+  driveTracePublisher = mNH.advertise<swarmie_msgs::ControlTrace>((publishedName + "/driveControl/trace"), 10);
+  bool embedSbridge = false;
+  privateNH.param("embed_sbridge", embedSbridge, embedSbridge);
+  if (embedSbridge)
+  {
+    embeddedSbridge = new sbridge(publishedName);
+  }
   heartbeatPublisher = mNH.advertise<std_msgs::String>((publishedName + "/behaviour/heartbeat"), 1, true);
-  waypointFeedbackPublisher = mNH.advertise<swarmie_msgs::Waypoint>((publishedName + "/waypoints"), 1, true);
+  profilePublisher = mNH.advertise<std_msgs::String>((publishedName + "/behaviour/profile"), 1, true);
+  swarmPresencePublisher = mNH.advertise<std_msgs::String>("/swarmPresence", 10);
+  targetSightingsPublisher = mNH.advertise<swarmie_msgs::TargetSightings>("/targetSightings", 10);
+  roverBeaconPublisher = mNH.advertise<swarmie_msgs::RoverBeacon>("/roverBeacons", 10);
+  nestRequestPublisher = mNH.advertise<swarmie_msgs::NestRequest>("/nestRequests", 10);
+  waypointFeedbackPublisher = mNH.advertise<swarmie_msgs::WaypointBatch>((publishedName + "/waypoints"), 1, true);
+  motionStatePublisher = mNH.advertise<swarmie_msgs::MotionState>((publishedName + "/motion_state"), 1, true);
+  swarmie_msgs::MotionState motionState;
+  motionState.state = localizationRate.State();
+  motionStatePublisher.publish(motionState);
+  detectionHintPublisher = mNH.advertise<swarmie_msgs::DetectionHint>((publishedName + "/targets/hint"), 1, true);
+  if (adaptiveLocalization)
+  {
+    odomRelayPublisher = mNH.advertise<nav_msgs::Odometry>((publishedName + "/odom/localization"), 10);
+    imuRelayPublisher = mNH.advertise<sensor_msgs::Imu>((publishedName + "/imu/localization"), 10);
+    filteredOdomRelayPublisher = mNH.advertise<nav_msgs::Odometry>((publishedName + "/odom/filtered/localization"), 10);
+    rawOdometrySubscriber = sensorNH.subscribe((publishedName + "/odom"), 10, rawOdometryHandler);
+    imuSubscriber = sensorNH.subscribe((publishedName + "/imu"), 10, imuHandler);
+  }
 
   publish_status_timer = mNH.createTimer(ros::Duration(status_publish_interval), publishStatusTimerEventHandler);
   stateMachineTimer = mNH.createTimer(ros::Duration(behaviourLoopTimeStep), behaviourStateMachine);
   
   publish_heartbeat_timer = mNH.createTimer(ros::Duration(heartbeat_publish_interval), publishHeartBeatTimerEventHandler);
-  
-  typedef message_filters::sync_policies::ApproximateTime<sensor_msgs::Range, sensor_msgs::Range, sensor_msgs::Range> sonarSyncPolicy;
-  
-  message_filters::Synchronizer<sonarSyncPolicy> sonarSync(sonarSyncPolicy(10), sonarLeftSubscriber, sonarCenterSubscriber, sonarRightSubscriber);
-  sonarSync.registerCallback(boost::bind(&sonarHandler, _1, _2, _3));
+  publish_profile_timer = mNH.createTimer(ros::Duration(profile_publish_interval), publishProfileTimerEventHandler);
+  trace_level_timer = mNH.createTimer(ros::Duration(trace_level_refresh_interval), traceLevelTimerEventHandler);
+  roverBeaconTimer = mNH.createTimer(ros::Duration(roverBeaconInterval), roverBeaconTimerEventHandler);
+  traceLevelTimerEventHandler(ros::TimerEvent());
   
   tfListener = new tf::TransformListener();
+  tfRefreshTimer = sensorNH.createTimer(ros::Duration(tfRefreshInterval), tfRefreshTimerEventHandler);
   std_msgs::String msg;
   msg.data = "Log Started";
   infoLogPublisher.publish(msg);
   
   stringstream ss;
-  ss << "Rover start delay set to " << startDelayInSeconds << " seconds";
+  ss << "Rover starts once its pose is stable to " << startPoseConvergence.GetTolerance()
+     << " m over " << startPoseConvergence.GetWindow() << " seconds, or after "
+     << startDelayInSeconds << " seconds";
   msg.data = ss.str();
   infoLogPublisher.publish(msg);
 
@@ -251,8 +679,24 @@ int main(int argc, char **argv) {
 
   timerStartTime = time(0);
   
+  // Sensor ingestion runs in the background, the behaviour loop and command
+  // topics are serviced by the global queue on this thread.
+  ros::AsyncSpinner sensorSpinner(1, &sensorQueue);
+  sensorSpinner.start();
+  ros::AsyncSpinner sonarSpinner(1, &sonarQueue);
+  sonarSpinner.start();
+  
   ros::spin();
   
+  sonarSpinner.stop();
+  sensorSpinner.stop();
+  if (sharedSonarThread.joinable())
+  {
+    sharedSonarThread.join();
+  }
+  delete embeddedSbridge;
+  TraceLog::Instance().Close();
+  
   return EXIT_SUCCESS;
 }
 
@@ -261,11 +705,10 @@ int main(int argc, char **argv) {
 // This function calls the dropOff, pickUp, and search controllers.
 // This block passes the goal location to the proportional-integral-derivative
 // controllers in the abridge package.
-void behaviourStateMachine(const ros::TimerEvent&)
+void behaviourStateMachine(const ros::TimerEvent& event)
 {
 
 	
-  std_msgs::String stateMachineMsg;
 
   // time since timerStartTime was set to current time
   timerTimeElapsed = time(0) - timerStartTime;
@@ -274,22 +717,49 @@ void behaviourStateMachine(const ros::TimerEvent&)
   // auto mode but wont work in main goes here)
   if (!initilized)
   {
-
-    if (timerTimeElapsed > startDelayInSeconds)
+    // the location globals belong to the sensor thread, use the snapshot
+    SensorSnapshot sensors = logicController.GetSensorSnapshot();
+    
+    // Only sample once both estimates have been updated
+    if (sensors.positionUpdates != startPositionUpdates && sensors.mapPositionUpdates != startMapPositionUpdates)
+    {
+      startPositionUpdates = sensors.positionUpdates;
+      startMapPositionUpdates = sensors.mapPositionUpdates;
+      startPoseConvergence.Add(ros::Time::now().toSec(), sensors.position, sensors.mapPosition);
+    }
+    
+    bool stable = startPoseConvergence.IsStable();
+    
+    if (stable || timerTimeElapsed > startDelayInSeconds)
     {
 
       // initialization has run
       initilized = true;
+      
+      std_msgs::String startMsg;
+      stringstream ss;
+      if (stable)
+      {
+        ss << "Pose stable after " << timerTimeElapsed << " seconds, starting";
+      }
+      else
+      {
+        ss << "Pose not stable after " << startDelayInSeconds << " seconds (spread "
+           << startPoseConvergence.Spread() << " m), starting anyway";
+      }
+      startMsg.data = ss.str();
+      infoLogPublisher.publish(startMsg);
+      
       //TODO: this just sets center to 0 over and over and needs to change
       Point centerOdom;
-      centerOdom.x = 1.3 * cos(currentLocation.theta);
-      centerOdom.y = 1.3 * sin(currentLocation.theta);
+      centerOdom.x = 1.3 * cos(sensors.position.theta);
+      centerOdom.y = 1.3 * sin(sensors.position.theta);
       centerOdom.theta = centerLocation.theta;
       logicController.SetCenterLocationOdom(centerOdom);
       
       Point centerMap;
-      centerMap.x = currentLocationMap.x + (1.3 * cos(currentLocationMap.theta));
-      centerMap.y = currentLocationMap.y + (1.3 * sin(currentLocationMap.theta));
+      centerMap.x = sensors.mapPosition.x + (1.3 * cos(sensors.mapPosition.theta));
+      centerMap.y = sensors.mapPosition.y + (1.3 * sin(sensors.mapPosition.theta));
       centerMap.theta = centerLocationMap.theta;
       logicController.SetCenterLocationMap(centerMap);
       
@@ -318,11 +788,11 @@ void behaviourStateMachine(const ros::TimerEvent&)
     //update the time used by all the controllers
     logicController.SetCurrentTimeInMilliSecs( getROSTimeInMilliSecs() );
     
-    //update center location
+    //update center location from the cached map to odom transform
     logicController.SetCenterLocationOdom( updateCenterLocation() );
     
     //ask logic controller for the next set of actuator commands
-    result = logicController.DoWork();
+    result = timedDoWork();
     
     bool wait = false;
     
@@ -338,45 +808,41 @@ void behaviourStateMachine(const ros::TimerEvent&)
     //do this when wait behaviour happens
     if (wait)
     {
-      sendDriveCommand(0.0,0.0);
-      std_msgs::Float32 angle;
-      
-      angle.data = prevFinger;
-      fingerAnglePublish.publish(angle);
-      angle.data = prevWrist;
-      wristAnglePublish.publish(angle);
+      actuatorThrottle.Stage(driveTopic, 0.0, 0.0);
+      actuatorThrottle.Stage(fingerTopic, prevFinger);
+      actuatorThrottle.Stage(wristTopic, prevWrist);
     }
     
     //normally interpret logic controllers actuator commands and deceminate them over the appropriate ROS topics
     else
     {
       
-      sendDriveCommand(result.pd.left,result.pd.right);
+      applySwarmAvoidance(result.pd.left, result.pd.right);
+      actuatorThrottle.Stage(driveTopic, result.pd.left, result.pd.right);
       
 
       //Alter finger and wrist angle is told to reset with last stored value if currently has -1 value
-      std_msgs::Float32 angle;
       if (result.fingerAngle != -1)
       {
-        angle.data = result.fingerAngle;
-        fingerAnglePublish.publish(angle);
+        actuatorThrottle.Stage(fingerTopic, result.fingerAngle);
         prevFinger = result.fingerAngle;
       }
 
       if (result.wristAngle != -1)
       {
-        angle.data = result.wristAngle;
-        wristAnglePublish.publish(angle);
+        actuatorThrottle.Stage(wristTopic, result.wristAngle);
         prevWrist = result.wristAngle;
       }
     }
     
+    flushActuatorCommands(&lastWorkTrace);
+    
     //publishHandeling here
     //logicController.getPublishData(); suggested
     
     
-    //adds a blank space between sets of debugging data to easily tell one tick from the next
-    cout << endl;
+    //marks the end of a tick so the trace is easy to split into ticks
+    Trace(TRACE_ADAPTER, TRACE_DEBUG, TRACE_TICK, result.type, result.pd.left, result.pd.right);
     
   }
   
@@ -387,47 +853,147 @@ void behaviourStateMachine(const ros::TimerEvent&)
 
     logicController.SetCurrentTimeInMilliSecs( getROSTimeInMilliSecs() );
 
-    // publish current state for the operator to see
-    stateMachineMsg.data = "WAITING";
-
-    // poll the logicController to get the waypoints that have been
-    // reached.
-    std::vector<int> cleared_waypoints = logicController.GetClearedWaypoints();
-
-    for(std::vector<int>::iterator it = cleared_waypoints.begin();
-        it != cleared_waypoints.end(); it++)
+    // poll the logicController for the waypoints that have been
+    // reached, a few times a second rather than every tick, and send
+    // them to the GUI in one message.
+    double now = ros::Time::now().toSec();
+    if (now - lastWaypointFeedbackTime >= waypointFeedbackInterval)
     {
-      swarmie_msgs::Waypoint wpt;
-      wpt.action = swarmie_msgs::Waypoint::ACTION_REACHED;
-      wpt.id = *it;
-      waypointFeedbackPublisher.publish(wpt);
+      lastWaypointFeedbackTime = now;
+      std::vector<int> cleared_waypoints = logicController.GetClearedWaypoints();
+
+      if (!cleared_waypoints.empty())
+      {
+        swarmie_msgs::WaypointBatch feedback;
+        feedback.action.assign(cleared_waypoints.size(), swarmie_msgs::Waypoint::ACTION_REACHED);
+        feedback.id.assign(cleared_waypoints.begin(), cleared_waypoints.end());
+        feedback.x.assign(cleared_waypoints.size(), 0);
+        feedback.y.assign(cleared_waypoints.size(), 0);
+        waypointFeedbackPublisher.publish(feedback);
+      }
     }
-    result = logicController.DoWork();
+    result = timedDoWork();
     if(result.type != behavior || result.b != wait)
     {
       // if the logic controller requested that the robot drive, then
       // drive. Otherwise there are no manual waypoints and the robot
       // should sit idle. (ie. only drive according to joystick
       // input).
-      sendDriveCommand(result.pd.left,result.pd.right);
+      actuatorThrottle.Stage(driveTopic, result.pd.left, result.pd.right);
+      flushActuatorCommands(&lastWorkTrace);
     }
   }
 
-  // publish state machine string for user, only if it has changed, though
-  if (strcmp(stateMachineMsg.data.c_str(), prev_state_machine) != 0)
+  updateMotionState();
+  updateDetectionHint();
+  publishStateEvents();
+  
+  recordLoopTiming(event);
+}
+
+// Runs the logic controller and records how long it took.
+Result timedDoWork()
+{
+  lastWorkTrace = sonarTrace.Load();
+  lastWorkTrace.workStart = ros::Time::now().toSec();
+
+  ros::WallTime start = ros::WallTime::now();
+  Result work = logicController.DoWork();
+  lastWorkTime = (ros::WallTime::now() - start).toSec();
+  return work;
+}
+
+void recordLoopTiming(const ros::TimerEvent& event)
+{
+  // last_real is zero on the first timer event so the interval is unknown
+  double interval = event.last_real.isZero() ? 0 : (event.current_real - event.last_real).toSec();
+  
+  if (behaviourLoopMonitor.Record(interval, lastWorkTime))
   {
-    stateMachinePublish.publish(stateMachineMsg);
-    sprintf(prev_state_machine, "%s", stateMachineMsg.data.c_str());
+    ROS_WARN_THROTTLE(5, "Behaviour loop overran its %.1f ms deadline: DoWork took %.1f ms (%lu overruns in %lu ticks)",
+                      behaviourLoopTimeStep * 1e3, lastWorkTime * 1e3,
+                      behaviourLoopMonitor.Overruns(), behaviourLoopMonitor.Ticks());
   }
+  
+  ROS_INFO_THROTTLE(loopStatsLogInterval, "Behaviour loop at %.1f Hz: %lu ticks, %lu overruns, DoWork mean %.2f ms worst %.2f ms, jitter mean %.2f ms worst %.2f ms, "
+                    "%lu actuator commands sent and %lu unchanged ones suppressed, "
+                    "%lu localization inputs relayed and %lu dropped, "
+                    "%lu of %lu sonar ranges rejected as outliers",
+                    1 / behaviourLoopTimeStep, behaviourLoopMonitor.Ticks(), behaviourLoopMonitor.Overruns(),
+                    behaviourLoopMonitor.MeanWorkTime() * 1e3, behaviourLoopMonitor.WorstWorkTime() * 1e3,
+                    behaviourLoopMonitor.MeanJitter() * 1e3, behaviourLoopMonitor.WorstJitter() * 1e3,
+                    actuatorThrottle.SentCount(), actuatorThrottle.SuppressedCount(),
+                    localizationRate.ForwardedCount(), localizationRate.DroppedCount(),
+                    sonarRejectedCount(), sonarSampleCount());
+  
+  lastWorkTime = 0;
 }
 
-void sendDriveCommand(double left, double right)
+// Sends the staged actuator commands that changed or are due a refresh,
+// the drive command first
+void flushActuatorCommands(const ControlTrace* trace)
+{
+  actuatorThrottle.Flush(ros::Time::now().toSec(), [trace](int topic, float a, float b) {
+    if (topic == driveTopic)
+    {
+      sendDriveCommand(a, b, trace);
+      return;
+    }
+    
+    std_msgs::Float32 angle;
+    angle.data = a;
+    if (topic == fingerTopic)
+    {
+      fingerAnglePublish.publish(angle);
+    }
+    else
+    {
+      wristAnglePublish.publish(angle);
+    }
+  });
+}
+
+// The drive bridges only use linear.x and angular.z. A command computed by
+// DoWork is followed by its control trace on driveControl/trace, and its
+// shared memory sample carries the same times; untraced commands such as
+// joystick input have none.
+void sendDriveCommand(double left, double right, const ControlTrace* trace)
 {
   velocity.linear.x = left,
       velocity.angular.z = right;
+  driveCommanded = left != 0 || right != 0;
+  
+  // publish the drive commands, as a pointer so subscribers in this process
+  // such as an embedded sbridge share the message instead of a serialized
+  // copy
+  geometry_msgs::TwistPtr command(new geometry_msgs::Twist(velocity));
+  driveControlPublish.publish(command);
+  
+  bool traced = trace != NULL && trace->sonarStamp > 0;
+  double commandSent = traced ? ros::Time::now().toSec() : 0;
+  
+  if (sharedMemoryTransport)
+  {
+    shm_transport::DriveSample sample = {left, right, 0, 0, 0, 0};
+    if (traced)
+    {
+      sample.sonarStamp = trace->sonarStamp;
+      sample.sonarReceived = trace->sonarReceived;
+      sample.workStart = trace->workStart;
+      sample.commandSent = commandSent;
+    }
+    driveRing.Write(sample);
+  }
   
-  // publish the drive commands
-  driveControlPublish.publish(velocity);
+  if (traced)
+  {
+    swarmie_msgs::ControlTrace msg;
+    msg.sonar_stamp = ros::Time(trace->sonarStamp);
+    msg.sonar_received = ros::Time(trace->sonarReceived);
+    msg.work_start = ros::Time(trace->workStart);
+    msg.command_sent = ros::Time(commandSent);
+    driveTracePublisher.publish(msg);
+  }
 }
 
 /*************************
@@ -444,29 +1010,30 @@ void targetHandler(const apriltags_ros::AprilTagDetectionArray::ConstPtr& messag
   //}
 
   if (message->detections.size() > 0) {
-    vector<Tag> tags;
+    // Reused between callbacks, SetAprilTags() hands back an older buffer
+    static vector<Tag> tags;
+    tags.resize(message->detections.size());
 
     for (int i = 0; i < message->detections.size(); i++) {
 
       // Package up the ROS AprilTag data into our own type that does not rely on ROS.
-      Tag loc;
+      Tag& loc = tags[i];
       loc.setID( message->detections[i].id );
 
       // Pass the position of the AprilTag
-      geometry_msgs::PoseStamped tagPose = message->detections[i].pose;
-      loc.setPosition( make_tuple( tagPose.pose.position.x,
-				   tagPose.pose.position.y,
-				   tagPose.pose.position.z ) );
+      const geometry_msgs::Pose& tagPose = message->detections[i].pose.pose;
+      loc.setPosition( tagPose.position.x,
+		       tagPose.position.y,
+		       tagPose.position.z );
 
       // Pass the orientation of the AprilTag
-      loc.setOrientation( ::boost::math::quaternion<float>( tagPose.pose.orientation.x,
-							    tagPose.pose.orientation.y,
-							    tagPose.pose.orientation.z,
-							    tagPose.pose.orientation.w ) );
-      tags.push_back(loc);
+      loc.setOrientation( tagPose.orientation.x,
+			  tagPose.orientation.y,
+			  tagPose.orientation.z,
+			  tagPose.orientation.w );
     }
     
-	cout<<"i come here"<<endl;
+    Trace(TRACE_ADAPTER, TRACE_DEBUG, TRACE_TAGS_RECEIVED, message->detections.size());
     logicController.SetAprilTags(tags);
    
   }
@@ -482,106 +1049,288 @@ void modeHandler(const std_msgs::UInt8::ConstPtr& message) {
     logicController.SetModeManual();
   }
   sendDriveCommand(0.0, 0.0);
+  
+  // The GUI moves the gripper in manual mode, so whatever the behaviours
+  // command next has to be sent
+  actuatorThrottle.Sent(driveTopic, 0.0, 0.0, ros::Time::now().toSec());
+  actuatorThrottle.Invalidate(fingerTopic);
+  actuatorThrottle.Invalidate(wristTopic);
 }
 
-void sonarHandler(const sensor_msgs::Range::ConstPtr& sonarLeft, const sensor_msgs::Range::ConstPtr& sonarCenter, const sensor_msgs::Range::ConstPtr& sonarRight) {
+// Runs for every sonar message on the sonar spinner thread
+void sonarHandler(SonarFusion::Sonar sonar, const sensor_msgs::Range::ConstPtr& message) {
+  double stamp = message->header.stamp.toSec();
+  unsigned int changed = sonarFusion.Update(sonar, sonarFilters[sonar].Filter(message->range, stamp), stamp);
+  
+  for (int i = 0; i < SonarFusion::NUM_SONARS; i++) {
+    if (!((changed >> i) & 1)) continue;
+    
+    SonarFusion::Sonar side = (SonarFusion::Sonar)i;
+    if (sonarFusion.IsStale(side)) {
+      ROS_WARN("The %s sonar has not updated for %.2f s, holding its last range", SonarFusion::Name(side), sonarFusion.GetStaleTimeout());
+    }
+    else {
+      ROS_INFO("The %s sonar is updating again", SonarFusion::Name(side));
+    }
+  }
   
-  logicController.SetSonarData(sonarLeft->range, sonarCenter->range, sonarRight->range);
+  // Until every sonar has reported the others would read as obstacles at 0
+  if (!sonarFusion.IsComplete()) return;
+  
+  handleSonar(sonarFusion.Range(SonarFusion::LEFT), sonarFusion.Range(SonarFusion::CENTER), sonarFusion.Range(SonarFusion::RIGHT), sonarFusion.Newest());
+}
+
+unsigned long sonarRejectedCount() {
+  unsigned long count = 0;
+  for (const SonarFilter& filter : sonarFilters) count += filter.RejectedCount();
+  return count;
+}
+
+unsigned long sonarSampleCount() {
+  unsigned long count = 0;
+  for (const SonarFilter& filter : sonarFilters) count += filter.SampleCount();
+  return count;
+}
+
+// Only one of sonarHandler and sharedSonarLoop runs, so sonarTrace keeps a
+// single writer
+void handleSonar(float left, float center, float right, double stamp) {
+  
+  logicController.SetSonarData(left, center, right);
+  
+  ControlTrace trace = {0, 0, 0};
+  trace.sonarStamp = stamp;
+  trace.sonarReceived = ros::Time::now().toSec();
+  sonarTrace.Store(trace);
+  
+}
+
+// Takes the sonar ranges abridge writes to shared memory, opening the ring
+// once abridge has created it
+void sharedSonarLoop() {
+  string name = shm_transport::SegmentName(publishedName, "sonar");
+  while (ros::ok())
+  {
+    if (!sonarRing.IsOpen() && !sonarRing.Open(name))
+    {
+      usleep(100000);
+      continue;
+    }
+    
+    shm_transport::SonarSample sample;
+    if (sonarRing.Next(sample, 100))
+    {
+      handleSonar(sonarFilters[SonarFusion::LEFT].Filter(sample.left, sample.stamp),
+                  sonarFilters[SonarFusion::CENTER].Filter(sample.center, sample.stamp),
+                  sonarFilters[SonarFusion::RIGHT].Filter(sample.right, sample.stamp),
+                  sample.stamp);
+    }
+  }
+}
+
+// The planar pose and velocities of an odometry message
+PoseSample poseSampleFromOdometry(const nav_msgs::Odometry& message) {
+  const geometry_msgs::Quaternion& orientation = message.pose.pose.orientation;
   
+  PoseSample sample;
+  sample.pose.x = message.pose.pose.position.x;
+  sample.pose.y = message.pose.pose.position.y;
+  sample.pose.theta = PlanarYaw(orientation.x, orientation.y, orientation.z, orientation.w);
+  sample.linearVelocity = message.twist.twist.linear.x;
+  sample.angularVelocity = message.twist.twist.angular.z;
+  return sample;
 }
 
 void odometryHandler(const nav_msgs::Odometry::ConstPtr& message) {
-  //Get (x,y) location directly from pose
-  currentLocation.x = message->pose.pose.position.x;
-  currentLocation.y = message->pose.pose.position.y;
+  PoseSample sample = poseSampleFromOdometry(*message);
   
-  //Get theta rotation by converting quaternion orientation to pitch/roll/yaw
-  tf::Quaternion q(message->pose.pose.orientation.x, message->pose.pose.orientation.y, message->pose.pose.orientation.z, message->pose.pose.orientation.w);
-  tf::Matrix3x3 m(q);
-  double roll, pitch, yaw;
-  m.getRPY(roll, pitch, yaw);
-  currentLocation.theta = yaw;
+  logicController.SetPositionData(sample);
   
-  linearVelocity = message->twist.twist.linear.x;
-  angularVelocity = message->twist.twist.angular.z;
+  // The map filter fuses the odometry filter's output
+  if (adaptiveLocalization && localizationRate.Accept(filteredOdomInput, ros::Time::now().toSec()))
+  {
+    filteredOdomRelayPublisher.publish(message);
+  }
+}
+
+// Relays the wheel odometry to the localization filters, the message is
+// passed on as received
+void rawOdometryHandler(const nav_msgs::Odometry::ConstPtr& message) {
+  if (localizationRate.Accept(odomInput, ros::Time::now().toSec()))
+  {
+    odomRelayPublisher.publish(message);
+  }
+}
+
+void imuHandler(const sensor_msgs::Imu::ConstPtr& message) {
+  if (localizationRate.Accept(imuInput, ros::Time::now().toSec()))
+  {
+    imuRelayPublisher.publish(message);
+  }
+}
+
+// Called every behaviour tick. The rover is moving while a drive is
+// commanded, or while it is measured to move, e.g. when pushed.
+void updateMotionState()
+{
+  SensorSnapshot sensors = logicController.GetSensorSnapshot();
+  bool moving = driveCommanded ||
+    fabs(sensors.linearVelocity) > parkedLinearSpeed ||
+    fabs(sensors.angularVelocity) > parkedAngularSpeed;
+  
+  if (localizationRate.Update(ros::Time::now().toSec(), moving, logicController.IsPrecisionDriving()))
+  {
+    // The MotionState constants are numbered like LocalizationRate::MotionState
+    swarmie_msgs::MotionState msg;
+    msg.state = localizationRate.State();
+    motionStatePublisher.publish(msg);
+  }
+}
+
+// Called every behaviour tick. Only LogicController's state changes are
+// sent, the state machine string only when the process state changed.
+void publishStateEvents()
+{
+  static int publishedProcessState = -1;
+  
+  for (const StateEvent& event : logicController.TakeStateEvents())
+  {
+    // The BehaviourState constants are numbered like the StateEvent fields
+    swarmie_msgs::BehaviourState msg;
+    msg.stamp = ros::Time().fromSec(event.time / 1e3);
+    msg.process_state = event.processState;
+    msg.logic_state = event.logicState;
+    msg.controller = event.controller;
+    msg.reason = event.reason;
+    behaviourStatePublisher.publish(msg);
+    
+    if (event.processState != publishedProcessState)
+    {
+      publishedProcessState = event.processState;
+      std_msgs::String name;
+      name.data = LogicController::ProcessStateName(event.processState);
+      stateMachinePublish.publish(name);
+    }
+  }
+}
+
+// Called every behaviour tick. In manual mode no controller runs, so the
+// whole image is searched.
+void updateDetectionHint()
+{
+  DetectionHint::Mode mode = DetectionHint::DETECT_ALL;
+  if (currentMode == 2 || currentMode == 3)
+  {
+    mode = logicController.GetDetectionMode();
+  }
   
+  bool changed = detectionHint.Update(mode, logicController.GetTickTags());
+  if (!changed && detectionHint.IsFullFrame())
+  {
+    return;
+  }
   
-  Point currentLoc;
-  currentLoc.x = currentLocation.x;
-  currentLoc.y = currentLocation.y;
-  currentLoc.theta = currentLocation.theta;
-  logicController.SetPositionData(currentLoc);
-  logicController.SetVelocityData(linearVelocity, angularVelocity);
+  // The DetectionHint constants are numbered like DetectionHint::Mode
+  swarmie_msgs::DetectionHint msg;
+  msg.stamp = ros::Time::now();
+  msg.mode = detectionHint.GetMode();
+  msg.margin = detectionHint.GetMargin();
+  for (const DetectionHint::Point& point : detectionHint.GetPoints())
+  {
+    msg.x.push_back(point.x);
+    msg.y.push_back(point.y);
+    msg.z.push_back(point.z);
+  }
+  detectionHintPublisher.publish(msg);
 }
 
 // Allows a virtual fence to be defined and enabled or disabled through ROS
-void virtualFenceHandler(const std_msgs::Float32MultiArray& message) 
+// Builds the fence shape in data[begin, end). The first element is the
+// shape type, the rest depend on it:
+// 1 = circle: center x, center y, radius
+// 2 = rectangle: center x, center y, width, height
+// 3 = polygon: x and y of each of at least three vertices, in order
+// 4 = multiple regions: for each region its number of elements followed
+//     by the region in this same format
+shared_ptr<const RangeShape> fenceShapeFromArray(const vector<float>& data, size_t begin, size_t end)
 {
-  // Read data from the message array
-  // The first element is an integer indicating the shape type
-  // 0 = Disable the virtual fence
-  // 1 = circle
-  // 2 = rectangle
-  int shape_type = static_cast<int>(message.data[0]); // Shape type
+  if ( begin >= end || end > data.size() ) throw ROSAdapterRangeShapeInvalidTypeException("Missing shape in ROSAdapter.cpp:virtualFenceHandler()");
+  
+  int shape_type = static_cast<int>(data[begin]); // Shape type
+  size_t count = end - begin - 1; // Number of parameters
+  const float* parameters = &data[begin] + 1;
   
-  if (shape_type == 0)
+  switch ( shape_type )
+  {
+  case 1: // Circle
+  {
+    if ( count != 3 ) throw ROSAdapterRangeShapeInvalidTypeException("Wrong number of parameters for circle shape type in ROSAdapter.cpp:virtualFenceHandler()");
+    Point center = {parameters[0], parameters[1], 0};
+    return make_shared<RangeCircle>(center, parameters[2]);
+  }
+  case 2: // Rectangle 
+  {
+    if ( count != 4 ) throw ROSAdapterRangeShapeInvalidTypeException("Wrong number of parameters for rectangle shape type in ROSAdapter.cpp:virtualFenceHandler()");
+    Point center = {parameters[0], parameters[1], 0};
+    return make_shared<RangeRectangle>(center, parameters[2], parameters[3]);
+  }
+  case 3: // Polygon
+  {
+    if ( count < 6 || count % 2 != 0 ) throw ROSAdapterRangeShapeInvalidTypeException("Wrong number of parameters for polygon shape type in ROSAdapter.cpp:virtualFenceHandler()");
+    vector<Point> vertices;
+    for (size_t i = 0; i < count; i += 2) {
+      Point vertex = {parameters[i], parameters[i+1], 0};
+      vertices.push_back(vertex);
+    }
+    return make_shared<RangePolygon>(vertices);
+  }
+  case 4: // Multiple regions
+  {
+    vector< shared_ptr<const RangeShape> > regions;
+    for (size_t i = begin + 1; i < end;) {
+      // The length must be a whole number of elements that are all there;
+      // anything else would index past the region or the message
+      float value = data[i];
+      if ( !std::isfinite(value) || value < 0 || value != std::floor(value) || value > end - i - 1 ) throw ROSAdapterRangeShapeInvalidTypeException("Invalid region length for multiple regions shape type in ROSAdapter.cpp:virtualFenceHandler()");
+      size_t length = static_cast<size_t>(value);
+      regions.push_back(fenceShapeFromArray(data, i + 1, i + 1 + length));
+      i += 1 + length;
+    }
+    return make_shared<RangeMultiRegion>(regions);
+  }
+  default:
+  { // Unknown shape type specified
+    throw ROSAdapterRangeShapeInvalidTypeException("Unknown Shape type in ROSAdapter.cpp:virtualFenceHandler()");
+  }
+  }
+}
+
+void virtualFenceHandler(const std_msgs::Float32MultiArray& message) 
+{
+  // The first element is an integer indicating the shape type, 0 disables
+  // the virtual fence. See fenceShapeFromArray() for the others.
+  if (message.data.empty() || static_cast<int>(message.data[0]) == 0)
   {
     logicController.setVirtualFenceOff();
   }
   else
   {
-    // Elements 2 and 3 are the x and y coordinates of the range center
-    Point center;
-    center.x = message.data[1]; // Range center x
-    center.y = message.data[2]; // Range center y
-    
-    // If the shape type is "circle" then element 4 is the radius, if rectangle then width
-    switch ( shape_type )
+    // The shape is built completely before it replaces the current one, so
+    // a malformed message leaves the current fence in place
+    try
     {
-    case 1: // Circle
-    {
-      if ( message.data.size() != 4 ) throw ROSAdapterRangeShapeInvalidTypeException("Wrong number of parameters for circle shape type in ROSAdapter.cpp:virtualFenceHandler()");
-      float radius = message.data[3]; 
-      logicController.setVirtualFenceOn( new RangeCircle(center, radius) );
-      break;
+      logicController.setVirtualFenceOn( fenceShapeFromArray(message.data, 0, message.data.size()) );
     }
-    case 2: // Rectangle 
+    catch (const std::exception& e)
     {
-      if ( message.data.size() != 5 ) throw ROSAdapterRangeShapeInvalidTypeException("Wrong number of parameters for rectangle shape type in ROSAdapter.cpp:virtualFenceHandler()");
-      float width = message.data[3]; 
-      float height = message.data[4]; 
-      logicController.setVirtualFenceOn( new RangeRectangle(center, width, height) );
-      break;
-    }
-    default:
-    { // Unknown shape type specified
-      throw ROSAdapterRangeShapeInvalidTypeException("Unknown Shape type in ROSAdapter.cpp:virtualFenceHandler()");
-    }
+      ROS_ERROR("Ignoring virtual fence message, keeping the current fence: %s", e.what());
     }
   }
 }
 
 void mapHandler(const nav_msgs::Odometry::ConstPtr& message) {
-  //Get (x,y) location directly from pose
-  currentLocationMap.x = message->pose.pose.position.x;
-  currentLocationMap.y = message->pose.pose.position.y;
-  
-  //Get theta rotation by converting quaternion orientation to pitch/roll/yaw
-  tf::Quaternion q(message->pose.pose.orientation.x, message->pose.pose.orientation.y, message->pose.pose.orientation.z, message->pose.pose.orientation.w);
-  tf::Matrix3x3 m(q);
-  double roll, pitch, yaw;
-  m.getRPY(roll, pitch, yaw);
-  currentLocationMap.theta = yaw;
-  
-  linearVelocity = message->twist.twist.linear.x;
-  angularVelocity = message->twist.twist.angular.z;
-  
-  Point curr_loc;
-  curr_loc.x = currentLocationMap.x;
-  curr_loc.y = currentLocationMap.y;
-  curr_loc.theta = currentLocationMap.theta;
-  logicController.SetMapPositionData(curr_loc);
-  logicController.SetMapVelocityData(linearVelocity, angularVelocity);
+  PoseSample sample = poseSampleFromOdometry(*message);
+  logicController.SetMapPositionData(sample);
 }
 
 void joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message) {
@@ -608,6 +1357,7 @@ void joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message) {
     }
 
     sendDriveCommand(left, right);
+    actuatorThrottle.Sent(driveTopic, left, right, ros::Time::now().toSec());
   }
 }
 
@@ -615,21 +1365,35 @@ void joyCmdHandler(const sensor_msgs::Joy::ConstPtr& message) {
 void publishStatusTimerEventHandler(const ros::TimerEvent&) {
   std_msgs::String msg;
   msg.data = "online";
+  
+  // The GUI shows the status next to the rover name
+  const NestScheduler& nest = logicController.GetNestScheduler();
+  if (nest.IsGranted()) {
+    msg.data += ", dropping off";
+  }
+  else if (nest.IsRequesting()) {
+    msg.data += ", waiting for the collection zone (" + to_string(nest.QueuePosition()) + " ahead)";
+  }
   status_publisher.publish(msg);
 }
 
-void manualWaypointHandler(const swarmie_msgs::Waypoint& message) {
-  Point wp;
-  wp.x = message.x;
-  wp.y = message.y;
-  wp.theta = 0.0;
-  switch(message.action) {
-  case swarmie_msgs::Waypoint::ACTION_ADD:
-    logicController.AddManualWaypoint(wp, message.id);
-    break;
-  case swarmie_msgs::Waypoint::ACTION_REMOVE:
-    logicController.RemoveManualWaypoint(message.id);
-    break;
+void manualWaypointHandler(const swarmie_msgs::WaypointBatch& message) {
+  size_t count = std::min(message.action.size(), message.id.size());
+  for (size_t i = 0; i < count; i++) {
+    switch(message.action[i]) {
+    case swarmie_msgs::Waypoint::ACTION_ADD:
+      if (i < message.x.size() && i < message.y.size()) {
+        Point wp;
+        wp.x = message.x[i];
+        wp.y = message.y[i];
+        wp.theta = 0.0;
+        logicController.AddManualWaypoint(wp, message.id[i]);
+      }
+      break;
+    case swarmie_msgs::Waypoint::ACTION_REMOVE:
+      logicController.RemoveManualWaypoint(message.id[i]);
+      break;
+    }
   }
 }
 
@@ -642,6 +1406,235 @@ void publishHeartBeatTimerEventHandler(const ros::TimerEvent&) {
   std_msgs::String msg;
   msg.data = "";
   heartbeatPublisher.publish(msg);
+  
+  // Only rovers that are searching take search lanes
+  if (currentMode == 2 || currentMode == 3) {
+    std_msgs::String presence;
+    presence.data = publishedName;
+    swarmPresencePublisher.publish(presence);
+    
+    publishTargetSightings();
+  }
+  
+  updateSwarmPosition();
+}
+
+// Sends the buckets this rover saw change since the last heartbeat, and
+// renews its claim. Runs on the main thread like behaviourStateMachine.
+void publishTargetSightings() {
+  vector<TargetBlackboard::Bucket> changes = logicController.TakeSharedSightings();
+  
+  int claimX = 0, claimY = 0;
+  bool claiming = logicController.GetSharedClaim(claimX, claimY);
+  
+  if (changes.empty() && !claiming) return;
+  
+  swarmie_msgs::TargetSightings msg;
+  msg.claiming = claiming;
+  msg.claim_x = claimX;
+  msg.claim_y = claimY;
+  
+  msg.rover = publishedName;
+  msg.resolution = logicController.GetSharedResolution();
+  
+  for (const TargetBlackboard::Bucket& bucket : changes) {
+    // Cells outside the int16 range are far outside any arena
+    if (bucket.x < numeric_limits<int16_t>::min() || bucket.x > numeric_limits<int16_t>::max()) continue;
+    if (bucket.y < numeric_limits<int16_t>::min() || bucket.y > numeric_limits<int16_t>::max()) continue;
+    
+    msg.x.push_back(bucket.x);
+    msg.y.push_back(bucket.y);
+    msg.count.push_back(min(bucket.count, (int)numeric_limits<uint8_t>::max()));
+  }
+  
+  targetSightingsPublisher.publish(msg);
+}
+
+// Runs on the main thread like behaviourStateMachine
+void targetSightingsHandler(const swarmie_msgs::TargetSightings::ConstPtr& message) {
+  if (message->rover == publishedName) return;
+  
+  // The sender's cells may differ in size from ours
+  float resolution = message->resolution;
+  if (!(resolution > 0)) return;
+  
+  size_t n = min(message->x.size(), min(message->y.size(), message->count.size()));
+  for (size_t i = 0; i < n; i++) {
+    logicController.AddSharedSighting((message->x[i] + 0.5) * resolution, (message->y[i] + 0.5) * resolution, message->count[i]);
+  }
+  
+  if (message->claiming) {
+    logicController.AddSharedClaim(message->rover, (message->claim_x + 0.5) * resolution, (message->claim_y + 0.5) * resolution);
+  }
+}
+
+// Runs on the main thread like behaviourStateMachine
+void roverBeaconTimerEventHandler(const ros::TimerEvent&) {
+  if (!initilized) return;
+  
+  // Also withdraws the request when switched to manual
+  publishNestRequest();
+  
+  if (!(currentMode == 2 || currentMode == 3)) return;
+  
+  // The pose comes from the snapshot, mapHandler writes it on the sensor
+  // thread
+  SensorSnapshot sensors = logicController.GetSensorSnapshot();
+  swarmie_msgs::RoverBeacon msg;
+  msg.rover = publishedName;
+  msg.x = sensors.mapPosition.x - centerLocationMap.x;
+  msg.y = sensors.mapPosition.y - centerLocationMap.y;
+  msg.heading = sensors.mapPosition.theta;
+  msg.speed = sensors.linearVelocity;
+  msg.intent = logicController.GetIntent();
+  roverBeaconPublisher.publish(msg);
+}
+
+// Renews this rover's nest request with every beacon so the others see
+// the lease change within a beacon interval. Runs on the main thread like
+// behaviourStateMachine.
+void publishNestRequest() {
+  const NestScheduler& nest = logicController.GetNestScheduler();
+  if (!nest.IsRequesting() && !nestRequestSent) return;
+  
+  swarmie_msgs::NestRequest msg;
+  msg.rover = publishedName;
+  msg.requesting = nest.IsRequesting();
+  msg.request_time = nest.GetRequest().requestTime;
+  msg.bearing = nest.GetRequest().bearing;
+  msg.granted = nest.IsGranted();
+  nestRequestPublisher.publish(msg);
+  
+  nestRequestSent = msg.requesting;
+}
+
+// Runs on the main thread like behaviourStateMachine
+void nestRequestHandler(const swarmie_msgs::NestRequest::ConstPtr& message) {
+  if (message->rover == publishedName) return;
+  
+  if (message->requesting) {
+    logicController.AddNestRequest(message->rover, message->request_time, message->bearing, message->granted);
+  }
+  else {
+    logicController.RemoveNestRequest(message->rover);
+  }
+}
+
+// Copies the flight record to the path in the message, or next to the ring
+// file if it is empty. Runs on the main thread like behaviourStateMachine.
+void flightRecordDumpHandler(const std_msgs::String::ConstPtr& message) {
+  string path = message->data.empty() ? flightRecordFile + ".dump" : message->data;
+
+  if (logicController.DumpFlightRecord(path)) {
+    ROS_INFO("Dumped the flight record to %s", path.c_str());
+  }
+  else {
+    ROS_WARN("Could not dump the flight record to %s", path.c_str());
+  }
+}
+
+// Runs on the main thread like behaviourStateMachine
+void roverBeaconHandler(const swarmie_msgs::RoverBeacon::ConstPtr& message) {
+  if (message->rover == publishedName) return;
+  if (message->intent > swarmie_msgs::RoverBeacon::MANUAL) return;
+  
+  Point position;
+  position.x = message->x;
+  position.y = message->y;
+  position.theta = message->heading;
+  roverAvoidance.UpdateNeighbour(message->rover, position, message->speed, (RoverAvoidance::Intent)message->intent, ros::Time::now().toSec());
+}
+
+// Bends the wheel commands of the behaviours around the other rovers: the
+// forward part is slowed or stopped and the turn part takes the heading
+// change. Reversing and turning on the spot are left alone, they do not
+// close on anyone.
+void applySwarmAvoidance(float& left, float& right) {
+  float forward = (left + right) / 2;
+  float turn = (right - left) / 2;
+  if (forward <= 0) return;
+  
+  double now = ros::Time::now().toSec();
+  
+  SensorSnapshot sensors = logicController.GetSensorSnapshot();
+  Point self;
+  self.x = sensors.mapPosition.x - centerLocationMap.x;
+  self.y = sensors.mapPosition.y - centerLocationMap.y;
+  self.theta = sensors.mapPosition.theta;
+  float speed = sensors.linearVelocity;
+  roverAvoidance.SetSelf(self, speed, logicController.GetIntent());
+  
+  float speedScale = 1;
+  float headingChange = 0;
+  roverAvoidance.Adjust(now, max(speed, 0.f), speedScale, headingChange);
+  
+  if (speedScale == 1 && headingChange == 0) return;
+  
+  forward *= speedScale;
+  turn = max(-180.f, min(180.f, turn + avoidanceTurnGain * headingChange));
+  
+  left = forward - turn;
+  right = forward + turn;
+}
+
+void swarmPresenceHandler(const std_msgs::String::ConstPtr& message) {
+  swarmLastSeen[message->data] = ros::Time::now().toSec();
+}
+
+// Tells the search controller where this rover is in the name order of the
+// autonomous rovers, which decides its search lanes. Runs on the main thread
+// like behaviourStateMachine.
+void updateSwarmPosition() {
+  double now = ros::Time::now().toSec();
+  
+  for (map<string, double>::iterator it = swarmLastSeen.begin(); it != swarmLastSeen.end();) {
+    // Also drop times from before a clock reset
+    if (now - it->second > swarmPresenceTimeout || it->second > now) {
+      swarmLastSeen.erase(it++);
+    }
+    else {
+      ++it;
+    }
+  }
+  
+  // Count this rover even before its own announcement comes back
+  int index = 0;
+  int count = 1;
+  for (map<string, double>::const_iterator it = swarmLastSeen.begin(); it != swarmLastSeen.end(); ++it) {
+    if (it->first == publishedName) continue;
+    if (it->first < publishedName) index++;
+    count++;
+  }
+  
+  logicController.SetSwarmPosition(index, count);
+}
+
+// Publishes how long each controller's calls took over the last interval.
+// Runs on the main thread like behaviourStateMachine so it can read the
+// profiler directly.
+void publishProfileTimerEventHandler(const ros::TimerEvent&) {
+  std_msgs::String msg;
+  msg.data = logicController.GetProfiler().Summary();
+  logicController.GetProfiler().Reset();
+  
+  if (!msg.data.empty()) {
+    profilePublisher.publish(msg);
+  }
+}
+
+// Verbosity is ~trace_level for every source, overridden per source by
+// ~trace_levels/<source> (0 off, 1 info, 2 debug). Re-read periodically so
+// it can be changed with rosparam while the node runs.
+void traceLevelTimerEventHandler(const ros::TimerEvent&) {
+  int defaultLevel = TRACE_INFO;
+  ros::param::getCached("~trace_level", defaultLevel);
+  
+  for (int i = 0; i < TRACE_NUM_SOURCES; i++) {
+    TraceSource source = (TraceSource)i;
+    int level = defaultLevel;
+    ros::param::getCached(string("~trace_levels/") + TraceLog::SourceName(source), level);
+    TraceLog::Instance().SetLevel(source, (TraceLevel)level);
+  }
 }
 
 long int getROSTimeInMilliSecs()
@@ -666,42 +1659,49 @@ Point updateCenterLocation()
   return tmp;
 }
 
-void transformMapCentertoOdom()
+void tfRefreshTimerEventHandler(const ros::TimerEvent&)
 {
+  tf::StampedTransform transform;
   
-  // map frame
-  geometry_msgs::PoseStamped mapPose;
+  try
+  { //get the latest available map to odom transform, never waits for a new one
+    tfListener->lookupTransform(publishedName + "/odom", publishedName + "/map", ros::Time(0), transform);
+  }
+  catch(tf::TransformException& ex) {
+    ROS_DEBUG("Map to odom transform not available yet: %s", ex.what());
+    return;
+  }
   
-  // setup msg to represent the center location in map frame
-  mapPose.header.stamp = ros::Time::now();
+  MapToOdomTransform cached;
+  cached.x = transform.getOrigin().x();
+  cached.y = transform.getOrigin().y();
+  cached.yaw = tf::getYaw(transform.getRotation());
+  cached.stamp = transform.stamp_.toSec();
+  mapToOdomCache.Store(cached);
+}
+
+void transformMapCentertoOdom()
+{
+  if (mapToOdomCache.Version() == 0)
+  {
+    // nothing to correct against until the first transform arrives
+    return;
+  }
   
-  mapPose.header.frame_id = publishedName + "/map";
-  mapPose.pose.orientation = tf::createQuaternionMsgFromRollPitchYaw(0, 0, centerLocationMap.theta);
-  mapPose.pose.position.x = centerLocationMap.x;
-  mapPose.pose.position.y = centerLocationMap.y;
-  geometry_msgs::PoseStamped odomPose;
-  string x = "";
+  MapToOdomTransform transform = mapToOdomCache.Load();
   
-  try
-  { //attempt to get the transform of the center point in map frame to odom frame.
-    tfListener->waitForTransform(publishedName + "/map", publishedName + "/odom", ros::Time::now(), ros::Duration(1.0));
-    tfListener->transformPose(publishedName + "/odom", mapPose, odomPose);
+  double age = ros::Time::now().toSec() - transform.stamp;
+  if (age > tfCacheMaxAge)
+  {
+    tfCacheStaleUses++;
+    ROS_WARN_THROTTLE(5, "Using a map to odom transform %.2f s old, stale uses so far: %lu", age, tfCacheStaleUses);
   }
   
-  catch(tf::TransformException& ex) {
-    ROS_INFO("Received an exception trying to transform a point from \"map\" to \"odom\": %s", ex.what());
-    x = "Exception thrown " + (string)ex.what();
-    std_msgs::String msg;
-    stringstream ss;
-    ss << "Exception in mapAverage() " + (string)ex.what();
-    msg.data = ss.str();
-    infoLogPublisher.publish(msg);
-    cout << msg.data << endl;
-  }
-  
-  // Use the position and orientation provided by the ros transform.
-  centerLocationMapRef.x = odomPose.pose.position.x; //set centerLocation in odom frame
-  centerLocationMapRef.y = odomPose.pose.position.y;
+  // Apply the cached transform to the center location in map frame.
+  double c = cos(transform.yaw);
+  double s = sin(transform.yaw);
+  centerLocationMapRef.x = c * centerLocationMap.x - s * centerLocationMap.y + transform.x; //set centerLocation in odom frame
+  centerLocationMapRef.y = s * centerLocationMap.x + c * centerLocationMap.y + transform.y;
   
  // cout << "x ref : "<< centerLocationMapRef.x << " y ref : " << centerLocationMapRef.y << endl;
   
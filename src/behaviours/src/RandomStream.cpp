@@ -0,0 +1,65 @@
+#include "RandomStream.h"
+
+#include <cmath>
+
+using namespace std;
+
+static const uint64_t golden = 0x9e3779b97f4a7c15ULL;
+
+RandomStream::RandomStream(uint64_t seed, uint64_t stream)
+{
+  key = Mix(seed ^ Mix(stream + golden));
+}
+
+uint64_t RandomStream::Mix(uint64_t x)
+{
+  x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  x = (x ^ (x >> 27)) * 0x94d049bb133111ebULL;
+  return x ^ (x >> 31);
+}
+
+// FNV-1a
+uint64_t RandomStream::Id(const string& name)
+{
+  uint64_t hash = 0xcbf29ce484222325ULL;
+  for (size_t i = 0; i < name.size(); i++)
+  {
+    hash ^= (unsigned char)name[i];
+    hash *= 0x100000001b3ULL;
+  }
+  return hash;
+}
+
+uint64_t RandomStream::Next()
+{
+  counter++;
+  return Mix(key + counter * golden);
+}
+
+double RandomStream::Uniform()
+{
+  // the top 53 bits fill a double's mantissa
+  return (Next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+double RandomStream::Uniform(double low, double high)
+{
+  return low + Uniform() * (high - low);
+}
+
+int RandomStream::UniformInt(int low, int high)
+{
+  if (high <= low) return low;
+
+  uint64_t span = (uint64_t)((int64_t)high - low) + 1;
+  return (int)(low + (int64_t)(Next() % span));
+}
+
+// Box-Muller, without keeping the second number so the stream stays a
+// plain counter
+double RandomStream::Gaussian(double mean, double sigma)
+{
+  double u = 1.0 - Uniform(); // (0, 1], log(0) is not a number
+  double v = Uniform();
+  return mean + sigma * sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
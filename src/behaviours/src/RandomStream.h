@@ -0,0 +1,51 @@
+#ifndef RANDOMSTREAM_H
+#define RANDOMSTREAM_H
+
+#include <stdint.h>
+#include <string>
+
+// Which stream of a rover's random numbers a controller draws from, see
+// LogicController::SetRandomSeed(). Append new ones at the end, or the
+// numbers every other controller draws change.
+enum RandomStreamId {
+  RANDOM_STREAM_DROP_OFF = 1
+};
+
+// A counter based random number generator. The n-th number of a stream is
+// a hash of the stream's key and n, so a stream is just its key and how far
+// it got. Streams split from one seed are independent of each other and of
+// the order they are drawn from in, and need no locking, so every
+// controller gets its own and a trial run with the same seed draws the same
+// numbers in every controller whatever the thread timing.
+//
+// The hash is the SplitMix64 finalizer, which is plenty for picking
+// headings and delays, but not for cryptography.
+class RandomStream
+{
+public:
+  RandomStream(uint64_t seed = 0, uint64_t stream = 0);
+
+  // An independent stream for id, e.g. a RandomStreamId
+  RandomStream Split(uint64_t id) const { return RandomStream(key, id); }
+
+  // A stream id for a name, e.g. the rover's, so every rover of a swarm
+  // started with the same seed draws different numbers
+  static uint64_t Id(const std::string& name);
+
+  uint64_t Next();
+  double Uniform();                            // [0, 1)
+  double Uniform(double low, double high);     // [low, high)
+  int UniformInt(int low, int high);           // [low, high]
+  double Gaussian(double mean, double sigma);
+
+  uint64_t Counter() const { return counter; }
+  void Seek(uint64_t counter) { this->counter = counter; }
+
+private:
+  static uint64_t Mix(uint64_t x);
+
+  uint64_t key;
+  uint64_t counter = 0;
+};
+
+#endif // RANDOMSTREAM_H
@@ -1,16 +1,29 @@
 #include "RangeController.h"
+#include "TraceLog.h"
+#include <algorithm>
 #include <cmath> // For square root function
+#include <limits>
 #include <iostream>
 
 RangeShape::RangeShape()
 {
 }
 
-Point RangeShape::getCenter()
+Point RangeShape::getCenter() const
 {
   return center;
 }
 
+Point RangeShape::getReturnPoint( Point /* coords */ ) const
+{
+  return center;
+}
+
+bool RangeShape::inBounds( Point coords ) const
+{
+  return coords.x >= min_x && coords.x <= max_x && coords.y >= min_y && coords.y <= max_y;
+}
+
 RangeCircle::RangeCircle( Point center, float radius )
 {
   // Don't allow circles with negative radii
@@ -18,13 +31,23 @@ RangeCircle::RangeCircle( Point center, float radius )
 
   this->center = center;
   this->radius = radius;
+
+  min_x = center.x - radius;
+  max_x = center.x + radius;
+  min_y = center.y - radius;
+  max_y = center.y + radius;
 }
 
-bool RangeCircle::isInside( Point coords)
+bool RangeCircle::isInside( Point coords) const
 {  
   // Return whether the coordinates given are within the
-  // radius of the circle. The mathematical expression is just the Euclidean norm.
-  return sqrt((center.x-coords.x)*(center.x-coords.x) + (center.y-coords.y)*(center.y-coords.y)) < radius;
+  // radius of the circle. Compared squared to save the square root.
+  return (center.x-coords.x)*(center.x-coords.x) + (center.y-coords.y)*(center.y-coords.y) < radius*radius;
+}
+
+float RangeCircle::getRadius() const
+{
+  return radius;
 }
 
 RangeRectangle::RangeRectangle( Point center, float width, float height )
@@ -35,9 +58,14 @@ RangeRectangle::RangeRectangle( Point center, float width, float height )
   this->center = center;
   this->width = width;
   this->height = height;
+
+  min_x = center.x - width/2.0;
+  max_x = center.x + width/2.0;
+  min_y = center.y - height/2.0;
+  max_y = center.y + height/2.0;
 }
 
-bool RangeRectangle::isInside( Point coords )
+bool RangeRectangle::isInside( Point coords ) const
 {  
   if ( coords.x < center.x+width/2.0 
        && coords.x > center.x-width/2.0 
@@ -51,6 +79,192 @@ bool RangeRectangle::isInside( Point coords )
 return false;
 }
 
+float RangeRectangle::getWidth() const
+{
+  return width;
+}
+
+float RangeRectangle::getHeight() const
+{
+  return height;
+}
+
+RangePolygon::RangePolygon( const std::vector<Point>& vertices )
+{
+  // A polygon needs an area
+  if ( vertices.size() < 3 ) throw RangeShapeInvalidParameterException("(Polygon Range)");
+
+  this->vertices = vertices;
+
+  center.x = 0;
+  center.y = 0;
+  center.theta = 0;
+  min_x = max_x = vertices[0].x;
+  min_y = max_y = vertices[0].y;
+
+  for ( size_t i = 0; i < vertices.size(); i++ )
+    {
+      const Point& a = vertices[i];
+      const Point& b = vertices[(i+1) % vertices.size()];
+
+      min_x = std::min(min_x, a.x);
+      max_x = std::max(max_x, a.x);
+      min_y = std::min(min_y, a.y);
+      max_y = std::max(max_y, a.y);
+
+      if ( a.y != b.y )
+	{
+	  edges.push_back(Edge{a.x, a.y, b.y, (b.x - a.x) / (b.y - a.y)});
+	}
+    }
+
+  center = interiorPoint();
+}
+
+Point RangePolygon::interiorPoint() const
+{
+  // The centroid of the area, which only lies outside concave polygons
+  double area = 0;
+  double cx = 0;
+  double cy = 0;
+  for ( size_t i = 0; i < vertices.size(); i++ )
+    {
+      const Point& a = vertices[i];
+      const Point& b = vertices[(i+1) % vertices.size()];
+      double cross = (double)a.x * b.y - (double)b.x * a.y;
+      area += cross;
+      cx += (a.x + b.x) * cross;
+      cy += (a.y + b.y) * cross;
+    }
+
+  Point point;
+  point.theta = 0;
+  if ( area != 0 )
+    {
+      point.x = cx / (3 * area);
+      point.y = cy / (3 * area);
+      if ( isInside(point) ) return point;
+    }
+
+  // Otherwise the middle of the widest stretch of the polygon along a
+  // horizontal line halfway between two vertices, so the line passes
+  // through none of them
+  std::vector<float> ys;
+  for ( const Point& vertex : vertices ) ys.push_back(vertex.y);
+  std::sort(ys.begin(), ys.end());
+
+  float widest = 0;
+  std::vector<float> crossings;
+  for ( size_t i = 1; i < ys.size(); i++ )
+    {
+      if ( ys[i] == ys[i-1] ) continue;
+      float y = (ys[i-1] + ys[i]) / 2;
+
+      crossings.clear();
+      for ( const Edge& edge : edges )
+	{
+	  if ( (edge.y0 > y) != (edge.y1 > y) ) crossings.push_back(edge.x0 + (y - edge.y0) * edge.dx_dy);
+	}
+      std::sort(crossings.begin(), crossings.end());
+
+      // Between the first and second crossing is inside, then outside...
+      for ( size_t j = 1; j < crossings.size(); j += 2 )
+	{
+	  if ( crossings[j] - crossings[j-1] > widest )
+	    {
+	      widest = crossings[j] - crossings[j-1];
+	      point.x = (crossings[j-1] + crossings[j]) / 2;
+	      point.y = y;
+	    }
+	}
+    }
+  if ( widest > 0 ) return point;
+
+  // No area at all, the mean of the vertices is as good as anything
+  point.x = 0;
+  point.y = 0;
+  for ( const Point& vertex : vertices )
+    {
+      point.x += vertex.x / vertices.size();
+      point.y += vertex.y / vertices.size();
+    }
+  return point;
+}
+
+bool RangePolygon::isInside( Point coords ) const
+{
+  if ( !inBounds(coords) ) return false;
+
+  // Count the edges a ray from coords towards +x crosses, odd is inside
+  bool inside = false;
+  for ( const Edge& edge : edges )
+    {
+      if ( (edge.y0 > coords.y) != (edge.y1 > coords.y)
+	   && coords.x < edge.x0 + (coords.y - edge.y0) * edge.dx_dy )
+	{
+	  inside = !inside;
+	}
+    }
+
+  return inside;
+}
+
+RangeMultiRegion::RangeMultiRegion( const std::vector< std::shared_ptr<const RangeShape> >& regions )
+{
+  if ( regions.empty() ) throw RangeShapeInvalidParameterException("(Multi Region Range)");
+
+  this->regions = regions;
+
+  center.x = 0;
+  center.y = 0;
+  center.theta = 0;
+  min_x = min_y = std::numeric_limits<float>::max();
+  max_x = max_y = -std::numeric_limits<float>::max();
+
+  for ( const auto& region : regions )
+    {
+      if ( !region ) throw RangeShapeInvalidParameterException("(Multi Region Range)");
+
+      center.x += region->getCenter().x / regions.size();
+      center.y += region->getCenter().y / regions.size();
+      min_x = std::min(min_x, region->getMinX());
+      max_x = std::max(max_x, region->getMaxX());
+      min_y = std::min(min_y, region->getMinY());
+      max_y = std::max(max_y, region->getMaxY());
+    }
+}
+
+bool RangeMultiRegion::isInside( Point coords ) const
+{
+  if ( !inBounds(coords) ) return false;
+
+  for ( const auto& region : regions )
+    {
+      if ( region->inBounds(coords) && region->isInside(coords) ) return true;
+    }
+
+  return false;
+}
+
+Point RangeMultiRegion::getReturnPoint( Point coords ) const
+{
+  Point nearest = center;
+  float nearest_distance = std::numeric_limits<float>::max();
+
+  for ( const auto& region : regions )
+    {
+      Point point = region->getReturnPoint(coords);
+      float distance = hypot(point.x - coords.x, point.y - coords.y);
+      if ( distance < nearest_distance )
+	{
+	  nearest = point;
+	  nearest_distance = distance;
+	}
+    }
+
+  return nearest;
+}
+
 // Default constructor
 RangeController::RangeController()
 {
@@ -61,7 +275,7 @@ RangeController::RangeController( float backtrack_distance )
   setBacktrackDistance( backtrack_distance );
 }
 
-RangeController::RangeController( float backtrack_distance, RangeShape* range )
+RangeController::RangeController( float backtrack_distance, std::shared_ptr<const RangeShape> range )
 {
   setBacktrackDistance( backtrack_distance );
   setRangeShape( range );
@@ -82,14 +296,17 @@ Result RangeController::DoWork()
   // between the current location and the origin, store it in the result object,
   // and return it to the logic controller.
   
-  Point point_in_range = distAlongLineSegment(current_location, range->getCenter(), backtrack_distance);
+  std::shared_ptr<const RangeShape> range = std::atomic_load(&this->range);
+  if (!range) return result;
+
+  Point point_in_range = distAlongLineSegment(current_location, range->getReturnPoint(current_location), backtrack_distance);
 
   result.type = waypoint;
   result.wpts.waypoints.clear();
   result.wpts.waypoints.push_back( point_in_range );
   result.PIDMode = FAST_PID;
   
-  cout << "Range controller doing work: moving to (" << point_in_range.x << ", " << point_in_range.y << ")" << endl;  
+  Trace(TRACE_RANGE, TRACE_INFO, TRACE_RANGE_DO_WORK, 0, point_in_range.x, point_in_range.y);
 
   return result;
   
@@ -100,12 +317,13 @@ bool RangeController::ShouldInterrupt()
   // Cause an interrupt if the rover leaves the specified foraging range
   // Note use of shortcircuiting "and"
   bool should_interrupt = false;
+  std::shared_ptr<const RangeShape> range = std::atomic_load(&this->range);
   if (enabled 
       && range != NULL
       && !range->isInside(current_location) 
       && !requested_return_to_valid_range)
     {
-      cout << "Range controller interrupt" << endl;
+      Trace(TRACE_RANGE, TRACE_INFO, TRACE_RANGE_INTERRUPT);
       requested_return_to_valid_range = true;
       should_interrupt = true;
     }
@@ -116,9 +334,10 @@ bool RangeController::ShouldInterrupt()
 bool RangeController::HasWork() 
 {
   bool has_work = false;
+  std::shared_ptr<const RangeShape> range = std::atomic_load(&this->range);
   if (enabled && range != NULL && !range->isInside(current_location)) 
     {
-      cout << "Range controller has work:  current location (" << current_location.x << ", " << current_location.y << ")" << endl;
+      Trace(TRACE_RANGE, TRACE_DEBUG, TRACE_RANGE_HAS_WORK, 0, current_location.x, current_location.y);
       has_work = true;
       // Report that there is work to be done if the rover is outside the specified forgaing range.
       // Note use of shortcircuiting "and"
@@ -146,10 +365,10 @@ void RangeController::setBacktrackDistance( float backtrack_distance )
 }
 
 // Set the shape of the valid foraging range
-void RangeController::setRangeShape( RangeShape* range )
+void RangeController::setRangeShape( std::shared_ptr<const RangeShape> range )
 {
-  if ( this->range != NULL ) delete this->range; // Clean up memory
-  this->range = range;
+  // The previous shape is freed when the last user lets go of it
+  std::atomic_store(&this->range, range);
 }
 
 // Given two points, start and end, that define a line segment, L, this function returns a new point
@@ -186,5 +405,4 @@ void RangeController::ProcessData()
 
 RangeController::~RangeController() 
 {
-  if ( range != NULL ) delete range;
 }
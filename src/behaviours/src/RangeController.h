@@ -3,13 +3,16 @@
 
 // This class implements behaviour that prevents robots from
 // leaving the defined foraging range. The range can be
-// defined as a circle, square, or rectangle. 
+// defined as a circle, square, rectangle, polygon, or a
+// union of those. 
 // The center and dimensions of the allowed foraging range
 // are specified by the user.
  
 #include "Controller.h"
 #include <exception> // For exception handling
+#include <memory> // For shared_ptr
 #include <string> // For dynamic exception messages
+#include <vector>
 
 // Define the possible range shapes
 
@@ -18,13 +21,12 @@
 class RangeShapeInvalidParameterException : public std::exception {
  public:
   RangeShapeInvalidParameterException(std::string msg) {
-    this->msg = msg;
+    this->msg = "Invalid parameter used to define a class derived from RangeShape: " + msg;
   }
 
   virtual const char* what() const throw()
   {
-    std::string message = "Invalid parameter used to define a class derived from RangeShape: " + msg;
-    return message.c_str();
+    return msg.c_str();
   }
 
  private:
@@ -40,16 +42,37 @@ class RangeShapeInvalidParameterException : public std::exception {
 // of isInside() being called using the appropriate
 // shape.
 
+//
+// Every shape has an axis aligned bounding box that isInside()
+// checks first, so points far outside cost a few comparisons.
+// Shapes do not change once built.
+
 class RangeShape {
  public: 
   RangeShape();
+  virtual ~RangeShape() {}
   
-  virtual bool isInside( Point coords ) = 0;
-  Point getCenter();
+  virtual bool isInside( Point coords ) const = 0;
+  Point getCenter() const;
+
+  // Where a rover at coords should head to get back into range
+  virtual Point getReturnPoint( Point coords ) const;
+
+  bool inBounds( Point coords ) const;
+  float getMinX() const { return min_x; }
+  float getMaxX() const { return max_x; }
+  float getMinY() const { return min_y; }
+  float getMaxY() const { return max_y; }
 
  protected:
   // All shapes have a center
   Point center;
+
+  // and a bounding box
+  float min_x = 0.0;
+  float max_x = 0.0;
+  float min_y = 0.0;
+  float max_y = 0.0;
 };
 
 // RangeCircle is a derived type that can calculate
@@ -60,7 +83,8 @@ class RangeCircle : public RangeShape {
  public:
   RangeCircle( Point center, float radius ); 
   
-  bool isInside( Point coords ) override;
+  bool isInside( Point coords ) const override;
+  float getRadius() const;
 
  private: 
   float radius = 0.0;
@@ -75,24 +99,68 @@ class RangeRectangle : public RangeShape {
   RangeRectangle(); // Default constructor
   RangeRectangle( Point center, float width, float height ); 
   
-  bool isInside( Point coords ) override;
+  bool isInside( Point coords ) const override;
+  float getWidth() const;
+  float getHeight() const;
 
  protected: 
   float width = 0.0;
   float height = 0.0;
 };
 
+// RangePolygon is a derived type for a simple polygon given by
+// its vertices in order, either direction. The edges are
+// precomputed so isInside() is one crossing test per edge. The
+// center is the centroid of the area, or for concave polygons
+// whose centroid lies outside another point that is inside.
+class RangePolygon : public RangeShape {
+
+ public:
+  RangePolygon( const std::vector<Point>& vertices );
+
+  bool isInside( Point coords ) const override;
+  const std::vector<Point>& getVertices() const { return vertices; }
+
+ private:
+  struct Edge {
+    float x0;
+    float y0;
+    float y1;
+    float dx_dy; // change in x per y along the edge
+  };
+
+  Point interiorPoint() const;
+
+  std::vector<Point> vertices;
+  std::vector<Edge> edges; // without the horizontal ones, they never cross
+};
+
+// RangeMultiRegion is the union of several shapes, for example
+// one arena partition per team. A rover outside all of them
+// returns to the center of the nearest one.
+class RangeMultiRegion : public RangeShape {
+
+ public:
+  RangeMultiRegion( const std::vector< std::shared_ptr<const RangeShape> >& regions );
+
+  bool isInside( Point coords ) const override;
+  Point getReturnPoint( Point coords ) const override;
+  const std::vector< std::shared_ptr<const RangeShape> >& getRegions() const { return regions; }
+
+ private:
+  std::vector< std::shared_ptr<const RangeShape> > regions;
+};
+
 // Define exceptions for RangeController
 class RangeControllerInvalidParameterException : public std::exception {
  public:
   RangeControllerInvalidParameterException(std::string msg) {
-    this->msg = msg;
+    this->msg = "Invalid parameter used in RangeController: " + msg;
   }
 
   virtual const char* what() const throw()
   {
-    std::string message = "Invalid parameter used in RangeController: " + msg;
-    return message.c_str();
+    return msg.c_str();
   }
 
  private:
@@ -113,7 +181,7 @@ class RangeController : virtual Controller {
   // Constructors
   RangeController();
   RangeController( float backtrack_distance );
-  RangeController(float backtrack_distance, RangeShape* range);
+  RangeController(float backtrack_distance, std::shared_ptr<const RangeShape> range);
     
   // Required interface for controllers
   void Reset() override;
@@ -121,8 +189,9 @@ class RangeController : virtual Controller {
   bool ShouldInterrupt() override;
   bool HasWork() override;
 
-  // Setters
-  void setRangeShape( RangeShape* range );
+  // Setters. The shape is swapped atomically, so it can be
+  // replaced from another thread while the controller runs.
+  void setRangeShape( std::shared_ptr<const RangeShape> range );
   void setBacktrackDistance( float backtrack_distance );
   void setCurrentLocation( Point current );
   void setEnabled( bool enabled );  
@@ -137,7 +206,7 @@ class RangeController : virtual Controller {
 
   Point distAlongLineSegment(Point start, Point end, float dist);
 
-  RangeShape* range = NULL;
+  std::shared_ptr<const RangeShape> range;
   
   // Distance in meters to move towards the center
   // when a rover leaves the allowed range.
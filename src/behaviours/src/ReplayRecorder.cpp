@@ -0,0 +1,33 @@
+#include "ReplayRecorder.h"
+
+#include <cstdarg>
+
+bool ReplayRecorder::Open(const std::string& path)
+{
+  Close();
+  file = fopen(path.c_str(), "w");
+  return file != NULL;
+}
+
+void ReplayRecorder::Close()
+{
+  if (file != NULL)
+  {
+    fclose(file);
+    file = NULL;
+  }
+}
+
+void ReplayRecorder::Write(const char* format, ...)
+{
+  if (file == NULL)
+  {
+    return;
+  }
+
+  va_list args;
+  va_start(args, format);
+  vfprintf(file, format, args);
+  va_end(args);
+  fputc('\n', file);
+}
@@ -0,0 +1,65 @@
+#ifndef REPLAYRECORDER_H
+#define REPLAYRECORDER_H
+
+#include <cstdio>
+#include <string>
+
+// Writes the inputs LogicController consumes and the Results it produces to
+// a text file that the behaviours_replay tool (LogicReplay.cpp) can feed
+// back into a fresh LogicController. One line per call:
+//
+//   time <ms>                      SetCurrentTimeInMilliSecs
+//   mode auto|manual               SetModeAuto / SetModeManual
+//   center_odom <x> <y> <theta>    SetCenterLocationOdom
+//   center_map <x> <y> <theta>     SetCenterLocationMap
+//   waypoint_add <id> <x> <y>      AddManualWaypoint
+//   waypoint_remove <id>           RemoveManualWaypoint
+//   cleared_waypoints              GetClearedWaypoints
+//   swarm_position <index> <n>     SetSwarmPosition
+//   search_lanes <r0> <dr> <rmax>  SetSearchLanes
+//   random_seed <seed> <stream>    SetRandomSeed
+//   random_spin_start <0|1>        SetRandomSpinStart
+//   target_blackboard <res> <s>    SetTargetBlackboard
+//   shared_sighting <x> <y> <n>    AddSharedSighting
+//   shared_claim <rover> <x> <y>   AddSharedClaim
+//   nest_scheduler <rover> <r> <r> SetNestScheduler
+//   nest_request <rover> <ms> <bearing> <granted>
+//                                  AddNestRequest
+//   nest_release <rover>           RemoveNestRequest
+//   fence_off                      setVirtualFenceOff
+//   fence <shape>                  setVirtualFenceOn, shape is one of
+//                                    circle <x> <y> <r>
+//                                    rect <x> <y> <w> <h>
+//                                    polygon <n> [<x> <y>]...
+//                                    multi <n> [<shape>]...
+//   fence_circle <x> <y> <r>       the same for a circle or rectangle, in
+//   fence_rect <x> <y> <w> <h>     older recordings
+//   sonar <left> <center> <right>  sensor inputs, written when a tick
+//   position <x> <y> <theta>       consumes them so the replay sees them
+//   map_position <x> <y> <theta>   at exactly the same tick
+//   velocity <linear> <angular>
+//   map_velocity <linear> <angular>
+//   tags <n> [<id> <x> <y> <z> <qx> <qy> <qz> <qw>]...
+//   tick                           DoWork
+//   result <type> <b> <left> <right> <finger> <wrist>
+//
+// Floats are written with enough digits to round trip exactly. Only use a
+// recorder from the thread that calls DoWork().
+class ReplayRecorder
+{
+public:
+  ReplayRecorder() : file(NULL) {}
+  ~ReplayRecorder() { Close(); }
+
+  bool Open(const std::string& path);
+  void Close();
+  bool IsOpen() const { return file != NULL; }
+
+  // printf style, a newline is appended.
+  void Write(const char* format, ...) __attribute__((format(printf, 2, 3)));
+
+private:
+  FILE* file;
+};
+
+#endif // REPLAYRECORDER_H
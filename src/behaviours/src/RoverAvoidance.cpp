@@ -0,0 +1,117 @@
+#include "RoverAvoidance.h"
+
+#include <cmath>
+#include <algorithm>
+#include <limits>
+
+using namespace std;
+
+RoverAvoidance::RoverAvoidance(float radius, float range, float neighbourTimeout)
+{
+  this->radius = radius;
+  this->range = range;
+  this->neighbourTimeout = neighbourTimeout;
+}
+
+void RoverAvoidance::SetSelf(Point position, float speed, Intent intent)
+{
+  self = position;
+  selfSpeed = speed;
+  selfIntent = intent;
+}
+
+void RoverAvoidance::UpdateNeighbour(const string& name, Point position, float speed, Intent intent, double time)
+{
+  Neighbour& neighbour = neighbours[name];
+  neighbour.position = position;
+  neighbour.speed = speed;
+  neighbour.intent = intent;
+  neighbour.time = time;
+}
+
+bool RoverAvoidance::IsFresh(const Neighbour& neighbour, double time) const
+{
+  // Also ignore beacons from before a clock reset
+  return time - neighbour.time <= neighbourTimeout && neighbour.time <= time;
+}
+
+float RoverAvoidance::TimeToCollision(float px, float py, float vx, float vy) const
+{
+  float combined = 2 * radius;
+  float c = px*px + py*py - combined*combined;
+
+  // b > 0 while the velocity closes on the other rover
+  float b = px*vx + py*vy;
+  if (c <= 0) return b > 0 ? 0 : numeric_limits<float>::max();
+
+  // Smallest t >= 0 with |p - v t| = combined
+  float a = vx*vx + vy*vy;
+  float discriminant = b*b - a*c;
+  if (a == 0 || b <= 0 || discriminant <= 0) return numeric_limits<float>::max();
+
+  return (b - sqrt(discriminant)) / a;
+}
+
+void RoverAvoidance::Adjust(double time, float preferredSpeed, float& speedScale, float& headingChange) const
+{
+  speedScale = 1;
+  headingChange = 0;
+
+  float speed = max(selfSpeed, preferredSpeed);
+  float vx = selfSpeed * cos(self.theta);
+  float vy = selfSpeed * sin(self.theta);
+  float preferredX = speed * cos(self.theta);
+  float preferredY = speed * sin(self.theta);
+
+  // Only neighbours close enough to matter
+  vector<const Neighbour*> near;
+  for (const auto& entry : neighbours)
+  {
+    const Neighbour& neighbour = entry.second;
+    if (!IsFresh(neighbour, time)) continue;
+    if (hypot(neighbour.position.x - self.x, neighbour.position.y - self.y) > range) continue;
+    near.push_back(&neighbour);
+  }
+  if (near.empty()) return;
+
+  const float scales[] = {1, 0.5, 0};
+  const float turns[] = {0, -0.35, 0.35, -0.7, 0.7};
+
+  float best = numeric_limits<float>::max();
+  for (float scale : scales)
+  {
+    for (float turn : turns)
+    {
+      float candidateX = scale * speed * cos(self.theta + turn);
+      float candidateY = scale * speed * sin(self.theta + turn);
+
+      float soonest = numeric_limits<float>::max();
+      for (const Neighbour* neighbour : near)
+      {
+        float otherX = neighbour->speed * cos(neighbour->position.theta);
+        float otherY = neighbour->speed * sin(neighbour->position.theta);
+
+        // Reciprocal: the velocity relative to the other rover as if both
+        // moved halfway from their current velocity to the candidate
+        float relativeX = 2 * candidateX - vx - otherX;
+        float relativeY = 2 * candidateY - vy - otherY;
+
+        float t = TimeToCollision(neighbour->position.x - self.x, neighbour->position.y - self.y, relativeX, relativeY);
+        soonest = min(soonest, t);
+      }
+
+      float penalty = hypot(candidateX - preferredX, candidateY - preferredY);
+      if (soonest < numeric_limits<float>::max())
+      {
+        penalty += collisionWeight / max(soonest, 0.01f);
+      }
+
+      if (penalty < best)
+      {
+        best = penalty;
+        speedScale = scale;
+        headingChange = turn;
+      }
+    }
+  }
+}
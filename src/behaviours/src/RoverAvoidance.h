@@ -0,0 +1,71 @@
+#ifndef ROVERAVOIDANCE_H
+#define ROVERAVOIDANCE_H
+
+#include <map>
+#include <vector>
+#include <string>
+
+#include "Point.h"
+
+// Keeps rovers from driving into each other, using the beacons every rover
+// broadcasts with its pose, speed and intent. Positions are in the shared
+// frame of TargetBlackboard.h: map frame axes with the collection zone
+// center as the origin.
+//
+// Adjust() picks, from a few candidate speeds and headings around the
+// rover's own, the velocity that best trades staying close to it against
+// the time until a collision. It uses reciprocal velocity obstacles, where
+// each rover of a pair is expected to take half of the avoiding, so two
+// rovers do not both swerve to the same side.
+class RoverAvoidance
+{
+public:
+  enum Intent {
+    INTENT_SEARCHING = 0,
+    INTENT_RETURNING, // holding a cube, on the way to the collection zone
+    INTENT_DROPPING, // lined up on the collection zone tags
+    INTENT_LEAVING, // backing out after dropping off
+    INTENT_MANUAL,
+  };
+
+  RoverAvoidance(float radius = 0.35, float range = 3.0, float neighbourTimeout = 1.5);
+
+  // time in seconds. position.theta is the heading. speed in meters per second.
+  void SetSelf(Point position, float speed, Intent intent);
+  void UpdateNeighbour(const std::string& name, Point position, float speed, Intent intent, double time);
+
+  // The velocity to drive at instead of driving straight on at the current
+  // heading and at least preferredSpeed, as a factor for the speed and a
+  // change of heading in radians, positive to the left.
+  void Adjust(double time, float preferredSpeed, float& speedScale, float& headingChange) const;
+
+private:
+  struct Neighbour {
+    Point position;
+    float speed;
+    Intent intent;
+    double time;
+  };
+
+  bool IsFresh(const Neighbour& neighbour, double time) const;
+
+  // Seconds until the disks of two rovers touch if their relative velocity
+  // is (vx, vy), a large number if never. When they already overlap it is
+  // 0 while the velocity closes the gap and a large number once it opens
+  // it, so the way out wins over pushing on.
+  float TimeToCollision(float px, float py, float vx, float vy) const;
+
+  const float collisionWeight = 1.0; // meters per second times seconds
+
+  float radius;
+  float range;
+  float neighbourTimeout;
+
+  Point self = {0, 0, 0};
+  float selfSpeed = 0;
+  Intent selfIntent = INTENT_SEARCHING;
+
+  std::map<std::string, Neighbour> neighbours;
+};
+
+#endif // ROVERAVOIDANCE_H
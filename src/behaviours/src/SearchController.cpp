@@ -1,8 +1,8 @@
 #include "SearchController.h"
-#include <angles/angles.h>
+#include "TraceLog.h"
+#include "Angles.h"
 
 SearchController::SearchController() {
-  rng = new random_numbers::RandomNumberGenerator();
   currentLocation.x = 0;
   currentLocation.y = 0;
   currentLocation.theta = 0;
@@ -21,116 +21,164 @@ void SearchController::Reset() {
 }
 
 /**
- * This code implements a basic random walk search.
+ * This code drives the rover around its search lanes, see SearchController.h.
  */
 Result SearchController::DoWork() {
 
-  if (!result.wpts.waypoints.empty()) {
-    if (hypot(result.wpts.waypoints[0].x-currentLocation.x, result.wpts.waypoints[0].y-currentLocation.y) < 0.15) {
-      attemptCount = 0;
-    }
+  // A cube was found, so keep trying to reach the current waypoint
+  if (succesfullPickup) {
+    succesfullPickup = false;
+    attemptCount = 0;
   }
 
-  if (attemptCount > 0 && attemptCount < 5) {
-    attemptCount++;
-    if (succesfullPickup) {
-      succesfullPickup = false;
-      attemptCount = 1;
+  if (hasKnownTarget) {
+    if (attemptCount < 5) {
+      attemptCount++;
+
+      result.type = waypoint;
+      result.reset = true;
+      result.wpts.waypoints.assign(1, knownTarget);
+      return result;
     }
-    return result;
+
+    // Could not get there, leave it to the other rovers
+    hasKnownTarget = false;
+    reachedKnownTarget = true;
+    attemptCount = 0;
   }
-  else if (attemptCount >= 5 || attemptCount == 0) 
-  {
-    attemptCount = 1;
-
-
-    result.type = waypoint;
-    Point  searchLocation;
-
-    //select new position 50 cm from current location
-    if (first_waypoint)
-    {
-      first_waypoint = false;
-
-      //searchLocation.theta = tags[0].currentLocation.theta;
-      //searchLocation.x = tags[0].currentLocation.x;
-      //searchLocation.e-e-y = tags[0].currentLocation.y;
-      
-        /* searchLocation.theta = tags[1].getPositionZ();
-	      searchLocation.x = tags[1].getPositionX();
-	      searchLocation.y =tags[1].getPositionY();
-		 
-              result.wpts.waypoints.clear();
-	      result.wpts.waypoints.insert(result.wpts.waypoints.begin(), searchLocation);
-	      index++;
-
-	      return result;*/
-	 
-      //searchLocation.theta = tags[20].getPositionZ();
-      //searchLocation.x = tags[20].getPositionX();
-      //searchLocation.y = tags[20].getPositionY();
-
-      //searchLocation.theta = currentLocation.theta + M_PI;
-      //searchLocatione-.x = currentLocation.x + (0.5 * cos(searchLocation.theta));
-      //searchLocation.y = currentLocation.y + (0.5 * sin(searchLocation.theta));
-
-      searchLocation.theta = 0.3;
-      searchLocation.x = 0.1;
-      searchLocation.y = 0.1;
 
-    }
-    else
-    {
-
-    
-	     /* searchLocation.theta = tags[1].getPositionZ();
-	      searchLocation.x = tags[1].getPositionX();
-	      searchLocation.y =tags[1].getPositionY();
-		 
-              result.wpts.waypoints.clear();
-	      result.wpts.waypoints.insert(result.wpts.waypoints.begin(), searchLocation);
-	      index++;
-
-	      return result;
-	*/
-	//select new heading from for(int i=index; i < tags.size(); i++)	
-	// Gaussian distribution around current heading
-      //searchLocation.theta = rng->gaussian(currentLocation.theta, 0.785398); //45 degrees in radians
-      //searchLocation.x = currentLocation.x + (0.5 * cos(searchLocation.theta));
-      //searchLocation.y = currentLocation.y + (0.5 * sin(searchLocation.theta));
-
-      //searchLocation.theta = tags[0].currentLocation.theta;
-      //searchLocation.x = tags[0].currentLocation.x;
-      //searchLocation.y = tags[0].currentLocation.y;
-
-      searchLocation.theta = 0.3;
-      searchLocation.x = 0.2;
-      searchLocation.y = 0.2;
+  // The rover did not get to the waypoint after several tries, an obstacle
+  // is probably in the way
+  if (!plan.empty() && attemptCount >= 5) {
+    plan.pop_front();
+    attemptCount = 0;
+  }
+
+  if (plan.empty()) {
+    PlanLane(lane < 0);
+  }
+
+  attemptCount++;
+
+  result.type = waypoint;
+  // The drive controller drives to the last waypoint first. Clear the ones it
+  // still has, they are part of the plan that is handed over again.
+  result.reset = true;
+  result.wpts.waypoints.assign(plan.rbegin(), plan.rend());
+
+  return result;
+}
 
+int SearchController::LaneCount() const {
+  if (laneSpacing <= 0 || maxLaneRadius < firstLaneRadius) return 1;
+
+  return (int)floor((maxLaneRadius - firstLaneRadius) / laneSpacing) + 1;
+}
+
+void SearchController::PlanLane(bool nearest) {
+  int lanes = LaneCount();
+
+  // With more rovers than lanes some rovers share a lane
+  int firstLane = swarmIndex % lanes;
+
+  float dx = currentLocation.x - centerLocation.x;
+  float dy = currentLocation.y - centerLocation.y;
+
+  if (nearest) {
+    // The lane of this rover closest to where it is now
+    float radius = hypot(dx, dy);
+    lane = firstLane;
+    for (int i = firstLane; i < lanes; i += swarmCount) {
+      float laneRadius = firstLaneRadius + i * laneSpacing;
+      if (fabs(laneRadius - radius) < fabs(firstLaneRadius + lane * laneSpacing - radius)) {
+        lane = i;
+      }
     }
+  }
+  else {
+    // Work outwards, then start from the inner lane again since cubes are
+    // easily missed
+    lane += swarmCount;
+    if (lane >= lanes) lane = firstLane;
+  }
+
+  float radius = firstLaneRadius + lane * laneSpacing;
+
+  // Start on the lane next to the rover and go around once, alternating the
+  // direction between lanes
+  float startAngle = atan2(dy, dx);
+  int steps = max(8, (int)ceil(2 * M_PI * radius / waypointSpacing));
+  float step = (lane % 2 == 0 ? 1 : -1) * 2 * M_PI / steps;
+
+  plan.clear();
+  for (int i = 0; i <= steps; i++) {
+    Point waypoint;
+    waypoint.theta = NormalizeAngle(startAngle + i * step + (step > 0 ? M_PI/2 : -M_PI/2));
+    waypoint.x = centerLocation.x + radius * cos(startAngle + i * step);
+    waypoint.y = centerLocation.y + radius * sin(startAngle + i * step);
+    plan.push_back(waypoint);
+  }
 
+  attemptCount = 0;
 }
-    result.wpts.waypoints.clear();
-    result.wpts.waypoints.insert(result.wpts.waypoints.begin(), searchLocation);
-    
-    return result;
 
-  
+void SearchController::SetSwarmPosition(int index, int count) {
+  if (count < 1 || index < 0 || index >= count) return;
+  if (index == swarmIndex && count == swarmCount) return;
+
+  swarmIndex = index;
+  swarmCount = count;
 
+  // Move to one of the new lanes on the next DoWork
+  if (lane >= 0) {
+    lane = -1;
+    plan.clear();
+    replanned = true;
+  }
+}
+
+void SearchController::SetKnownTarget(Point target) {
+  knownTarget = target;
+  hasKnownTarget = true;
+  reachedKnownTarget = false;
+  attemptCount = 0;
+  replanned = true;
+}
+
+void SearchController::ClearKnownTarget() {
+  if (!hasKnownTarget) return;
+
+  hasKnownTarget = false;
+  attemptCount = 0;
+  replanned = true;
+}
+
+bool SearchController::ReachedKnownTarget() {
+  bool reached = reachedKnownTarget;
+  reachedKnownTarget = false;
+  return reached;
+}
+
+void SearchController::SetLanes(float firstLaneRadius, float laneSpacing, float maxLaneRadius) {
+  this->firstLaneRadius = firstLaneRadius;
+  this->laneSpacing = laneSpacing;
+  this->maxLaneRadius = maxLaneRadius;
+
+  if (lane >= 0) {
+    lane = -1;
+    plan.clear();
+    replanned = true;
+  }
 }
 
-void SearchController::setTags(vector<Tag> argTags)
+void SearchController::setTags(const vector<Tag>& argTags)
 {
 
-	cout<<"set tags"<<endl;
+  Trace(TRACE_SEARCH, TRACE_DEBUG, TRACE_SEARCH_SET_TAGS, argTags.size());
   
 
-   tags.clear();
-
-   for(int i=0; i < argTags.size(); i++)
-   {
-	tags.push_back(argTags[i]);
-   }
+   // reuses the storage of the previous tag list
+   tags.assign(argTags.begin(), argTags.end());
       //for(int i=0; i < tags.size(); i++)
 	//cout<<"tag :" << tags[i]<<endl;
 	
@@ -142,16 +190,39 @@ void SearchController::SetCenterLocation(Point centerLocation) {
   float diffY = this->centerLocation.y - centerLocation.y;
   this->centerLocation = centerLocation;
   
-  if (!result.wpts.waypoints.empty())
+  // The lanes are around the center, so they move with it
+  for (Point& waypoint : plan)
   {
-  result.wpts.waypoints.back().x -= diffX;
-  result.wpts.waypoints.back().y -= diffY;
+    waypoint.x -= diffX;
+    waypoint.y -= diffY;
   }
+  knownTarget.x -= diffX;
+  knownTarget.y -= diffY;
   
 }
 
 void SearchController::SetCurrentLocation(Point currentLocation) {
   this->currentLocation = currentLocation;
+
+  // Looser than the drive controller's tolerance so a waypoint it counts as
+  // reached is always dropped here too
+  const float reachedTolerance = 0.25;
+
+  // A bucket of known cubes is reached once the rover is in it
+  const float knownTargetTolerance = 0.5;
+
+  if (hasKnownTarget && hypot(knownTarget.x - currentLocation.x, knownTarget.y - currentLocation.y) < knownTargetTolerance)
+  {
+    hasKnownTarget = false;
+    reachedKnownTarget = true;
+    attemptCount = 0;
+  }
+
+  while (!plan.empty() && hypot(plan.front().x - currentLocation.x, plan.front().y - currentLocation.y) < reachedTolerance)
+  {
+    plan.pop_front();
+    attemptCount = 0;
+  }
 }
 
 void SearchController::ProcessData() {
@@ -160,6 +231,14 @@ void SearchController::ProcessData() {
 bool SearchController::ShouldInterrupt(){
   ProcessData();
 
+  // Stop driving the old lane once the lanes were handed out again or a
+  // known target came up
+  if (replanned)
+  {
+    replanned = false;
+    return true;
+  }
+
   return false;
 }
 
@@ -1,14 +1,24 @@
 #ifndef SEARCH_CONTROLLER
 #define SEARCH_CONTROLLER
 
-#include <random_numbers/random_numbers.h>
 #include "Controller.h"
 #include "Tag.h"
 #include "vector"
+#include <deque>
 
 /**
  * This class implements the search control algorithm for the rovers. The code
  * here should be modified and enhanced to improve search performance.
+ *
+ * The arena is divided into circular lanes around the collection zone, the
+ * first firstLaneRadius from the center and every laneSpacing after that up
+ * to maxLaneRadius. The rover with index i of the n active rovers searches
+ * lanes i, i + n, i + 2n... so the rovers cover the arena without driving
+ * over each other's lanes, whatever their odometry frames. Circles look the
+ * same from every frame, only the center has to be known. When the number
+ * of rovers changes the lanes are handed out again.
+ *
+ * Known cubes, see TargetBlackboard.h, come before the lanes.
  */
 class SearchController : virtual Controller {
 
@@ -24,7 +34,7 @@ public:
   bool HasWork() override;
 
   // added code to perform better search
-  void setTags(vector<Tag> argTags);
+  void setTags(const vector<Tag>& argTags);
 
   // sets the value of the current location
   //void UpdateData(geometry_msgs::Pose2D currentLocation, geometry_msgs::Pose2D centerLocation);
@@ -32,13 +42,25 @@ public:
   void SetCenterLocation(Point centerLocation);
   void SetSuccesfullPickup();
 
+  // index is this rover's position among the count active rovers
+  void SetSwarmPosition(int index, int count);
+  void SetLanes(float firstLaneRadius, float laneSpacing, float maxLaneRadius);
+
+  // Cubes the swarm knows about, in the odometry frame. The search drives
+  // there before it goes on with its lanes.
+  void SetKnownTarget(Point target);
+  void ClearKnownTarget();
+  bool HasKnownTarget() const { return hasKnownTarget; }
+
+  // True once after the rover got to the known target, or gave up on it
+  bool ReachedKnownTarget();
+
 protected:
 
   void ProcessData();
 
 private:
 
-  random_numbers::RandomNumberGenerator* rng;
   Point currentLocation;
   Point centerLocation;
   Point searchLocation;
@@ -47,11 +69,32 @@ private:
   Result result;
 
   // Search state
-  // Flag to allow special behaviour for the first waypoint
-  bool first_waypoint = true;
   bool succesfullPickup = false;
   vector<Tag> tags;
   int index = 0;
+
+  int swarmIndex = 0;
+  int swarmCount = 1;
+
+  float firstLaneRadius = 1.0; // meters from the center
+  float laneSpacing = 0.75;
+  float maxLaneRadius = 7.0;
+  float waypointSpacing = 1.0; // meters between waypoints along a lane
+
+  // The lane being searched and its waypoints not reached yet, in driving
+  // order. lane is -1 until the first lane is planned.
+  int lane = -1;
+  deque<Point> plan;
+  bool hasKnownTarget = false;
+  bool reachedKnownTarget = false;
+  Point knownTarget = {0, 0, 0};
+
+  bool replanned = false; // the plan changed since the last ShouldInterrupt
+
+  // Plans the next of this rover's lanes, or the one nearest the rover if
+  // the lanes were handed out again
+  void PlanLane(bool nearest);
+  int LaneCount() const;
 };
 
 #endif /* SEARCH_CONTROLLER */
@@ -0,0 +1,35 @@
+#ifndef SENSORSNAPSHOT_H
+#define SENSORSNAPSHOT_H
+
+#include "Point.h"
+
+// The latest value of every sensor input the LogicController hands down to
+// its controllers. Sensor callbacks publish into it and DoWork() consumes
+// one consistent copy per tick, see LogicController::ConsumeSensorSnapshot().
+//
+// Each input has an update counter that its setter increments, so the
+// consumer can tell which inputs changed since the previous tick.
+struct SensorSnapshot {
+  float sonarLeft = 0;
+  float sonarCenter = 0;
+  float sonarRight = 0;
+  unsigned int sonarUpdates = 0;
+
+  Point position = {0, 0, 0}; // odometry frame
+  unsigned int positionUpdates = 0;
+
+  Point mapPosition = {0, 0, 0}; // map frame (GPS fused)
+  unsigned int mapPositionUpdates = 0;
+
+  float linearVelocity = 0;
+  float angularVelocity = 0;
+  unsigned int velocityUpdates = 0;
+
+  float mapLinearVelocity = 0;
+  float mapAngularVelocity = 0;
+  unsigned int mapVelocityUpdates = 0;
+
+  unsigned int tagUpdates = 0;
+};
+
+#endif // SENSORSNAPSHOT_H
@@ -0,0 +1,56 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <atomic>
+#include <type_traits>
+
+// Single writer, multiple reader sequence lock. The writer never blocks and
+// readers retry until they copy a value that was not being written at the
+// same time, so a reader always gets one consistent snapshot of T without
+// taking a mutex.
+//
+// T must be trivially copyable since it is copied while a write may be in
+// progress. Only one thread may call Store().
+template <typename T>
+class SeqLock
+{
+public:
+  SeqLock() : sequence(0), data() {}
+
+  void Store(const T& value)
+  {
+    unsigned int seq = sequence.load(std::memory_order_relaxed);
+    sequence.store(seq + 1, std::memory_order_relaxed); // odd, write in progress
+    std::atomic_thread_fence(std::memory_order_release);
+    data = value;
+    sequence.store(seq + 2, std::memory_order_release);
+  }
+
+  T Load() const
+  {
+    T value;
+    unsigned int before, after;
+    do {
+      before = sequence.load(std::memory_order_acquire);
+      value = data;
+      std::atomic_thread_fence(std::memory_order_acquire);
+      after = sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) || before != after);
+    return value;
+  }
+
+  // Number of completed Store() calls, useful to tell whether anything
+  // has been published yet.
+  unsigned int Version() const
+  {
+    return sequence.load(std::memory_order_acquire) / 2;
+  }
+
+private:
+  static_assert(std::is_trivially_copyable<T>::value, "SeqLock requires a trivially copyable type");
+
+  std::atomic<unsigned int> sequence;
+  T data;
+};
+
+#endif // SEQLOCK_H
@@ -0,0 +1,95 @@
+#include "SonarFilter.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+SonarFilter::SonarFilter(int window, float maxRate, int confirmSamples) :
+  samples(0),
+  rejected(0)
+{
+  SetWindow(window);
+  SetMaxRate(maxRate);
+  SetConfirmSamples(confirmSamples);
+}
+
+void SonarFilter::SetWindow(int window)
+{
+  this->window = max(1, min(window, (int)MAX_WINDOW));
+  Reset();
+}
+
+void SonarFilter::SetConfirmSamples(int samples)
+{
+  confirmSamples = max(1, min(samples, (int)MAX_WINDOW));
+  pendingCount = 0;
+}
+
+void SonarFilter::Reset()
+{
+  count = 0;
+  next = 0;
+  pendingCount = 0;
+}
+
+float SonarFilter::Filter(float range, double stamp)
+{
+  samples.fetch_add(1, std::memory_order_relaxed);
+
+  if (count == 0 || maxRate <= 0)
+  {
+    Accept(range, stamp);
+    return filtered;
+  }
+
+  // The allowed change grows with the time since the last accepted range,
+  // so a sonar that skipped a few readings is not gated too tightly
+  double elapsed = max(0.0, stamp - lastStamp);
+  if (fabs(range - lastRange) <= maxRate * elapsed)
+  {
+    // The outliers before it did not last, they were spurious echoes
+    rejected.fetch_add(pendingCount, std::memory_order_relaxed);
+    pendingCount = 0;
+    Accept(range, stamp);
+    return filtered;
+  }
+
+  pending[pendingCount] = range;
+  pendingStamps[pendingCount] = stamp;
+  pendingCount++;
+
+  if (pendingCount >= confirmSamples)
+  {
+    for (int i = 0; i < pendingCount; i++)
+    {
+      Accept(pending[i], pendingStamps[i]);
+    }
+    pendingCount = 0;
+  }
+
+  return filtered;
+}
+
+void SonarFilter::Accept(float range, double stamp)
+{
+  if (count == window)
+  {
+    // Drop the oldest range from the sorted ones
+    float* oldest = lower_bound(sorted, sorted + count, ring[next]);
+    copy(oldest + 1, sorted + count, oldest);
+    count--;
+  }
+
+  float* slot = upper_bound(sorted, sorted + count, range);
+  copy_backward(slot, sorted + count, sorted + count + 1);
+  *slot = range;
+  count++;
+
+  ring[next] = range;
+  next = (next + 1) % window;
+
+  filtered = sorted[count / 2];
+  lastRange = range;
+  lastStamp = stamp;
+}
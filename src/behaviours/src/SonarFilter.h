@@ -0,0 +1,75 @@
+#ifndef SONARFILTER_H
+#define SONARFILTER_H
+
+#include <atomic>
+
+// Filters the ranges of one sonar before the controllers see them, so a
+// single spurious echo does not start an avoidance turn or make the pick up
+// controller think it holds a cube.
+//
+// A range that moved from the last accepted one faster than the maximum
+// rate is held back as an outlier. When confirmSamples outliers come in a
+// row the range really changed, e.g. the rover turned to face a wall, and
+// they are all accepted. Accepted ranges go into a fixed window and the
+// filtered range is their median, which costs a bounded amount of work per
+// range whatever the stream length.
+//
+// Times are in seconds. Not thread safe, each sonar is filtered on the
+// thread that receives it. Only the counts may be read from other threads.
+class SonarFilter
+{
+public:
+  static const int MAX_WINDOW = 15;
+
+  SonarFilter(int window = 3, float maxRate = 1, int confirmSamples = 2);
+
+  // Ranges the median is taken over, 1 turns it off
+  void SetWindow(int window);
+  int GetWindow() const { return window; }
+
+  // Meters per second a range may move by and still be accepted at once,
+  // 0 accepts every range
+  void SetMaxRate(float maxRate) { this->maxRate = maxRate; }
+  float GetMaxRate() const { return maxRate; }
+
+  // Outliers in a row that are accepted as a real change
+  void SetConfirmSamples(int samples);
+  int GetConfirmSamples() const { return confirmSamples; }
+
+  // Takes one range and returns the filtered range
+  float Filter(float range, double stamp);
+
+  float Range() const { return filtered; }
+
+  unsigned long SampleCount() const { return samples.load(std::memory_order_relaxed); }
+  unsigned long RejectedCount() const { return rejected.load(std::memory_order_relaxed); }
+
+  void Reset();
+
+private:
+  void Accept(float range, double stamp);
+
+  int window;
+  float maxRate;
+  int confirmSamples;
+
+  // The accepted ranges in arrival order, a ring, and sorted
+  float ring[MAX_WINDOW];
+  float sorted[MAX_WINDOW];
+  int count = 0;
+  int next = 0;
+
+  float lastRange = 0;
+  double lastStamp = 0;
+
+  // Outliers held back since the last accepted range
+  float pending[MAX_WINDOW];
+  double pendingStamps[MAX_WINDOW];
+  int pendingCount = 0;
+
+  float filtered = 0;
+  std::atomic<unsigned long> samples;
+  std::atomic<unsigned long> rejected; // outliers that did not last
+};
+
+#endif // SONARFILTER_H
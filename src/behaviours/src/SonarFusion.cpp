@@ -0,0 +1,38 @@
+#include "SonarFusion.h"
+
+SonarFusion::SonarFusion(double staleTimeout)
+{
+  this->staleTimeout = staleTimeout;
+}
+
+unsigned int SonarFusion::Update(Sonar sonar, float range, double stamp)
+{
+  ranges[sonar] = range;
+  stamps[sonar] = stamp;
+  seen |= 1u << sonar;
+  if (stamp > newest) newest = stamp;
+
+  // Staleness is measured against the newest range so it does not depend on
+  // the delay from the arduino to here. A sonar that never reported is not
+  // stale yet, it has nothing to hold.
+  unsigned int mask = 0;
+  for (int i = 0; i < NUM_SONARS; i++)
+  {
+    if ((seen >> i) & 1 && newest - stamps[i] > staleTimeout) mask |= 1u << i;
+  }
+
+  unsigned int changed = mask ^ staleMask;
+  staleMask = mask;
+  return changed;
+}
+
+const char* SonarFusion::Name(Sonar sonar)
+{
+  switch (sonar)
+  {
+  case LEFT: return "left";
+  case CENTER: return "center";
+  case RIGHT: return "right";
+  default: return "unknown";
+  }
+}
@@ -0,0 +1,48 @@
+#ifndef SONARFUSION_H
+#define SONARFUSION_H
+
+// Keeps the latest range of each sonar so the three can be handed on as
+// soon as any one of them updates, instead of waiting for a matching triple.
+// A sonar that has not updated for staleTimeout seconds is stale; its last
+// range is kept rather than assumed clear.
+//
+// Times are in seconds. Not thread safe, the sonar callbacks share a single
+// spinner thread.
+class SonarFusion
+{
+public:
+  enum Sonar { LEFT = 0, CENTER = 1, RIGHT = 2, NUM_SONARS = 3 };
+
+  SonarFusion(double staleTimeout = 0.5);
+
+  void SetStaleTimeout(double staleTimeout) { this->staleTimeout = staleTimeout; }
+  double GetStaleTimeout() const { return staleTimeout; }
+
+  // Records one sonar's range and works out which sonars are stale at stamp.
+  // Returns the sonars whose staleness changed, one bit per Sonar.
+  unsigned int Update(Sonar sonar, float range, double stamp);
+
+  float Range(Sonar sonar) const { return ranges[sonar]; }
+  double Stamp(Sonar sonar) const { return stamps[sonar]; }
+  bool IsStale(Sonar sonar) const { return (staleMask >> sonar) & 1; }
+  unsigned int StaleMask() const { return staleMask; }
+
+  // Stamp of the newest range
+  double Newest() const { return newest; }
+
+  // Whether every sonar has reported at least once
+  bool IsComplete() const { return seen == (1u << NUM_SONARS) - 1; }
+
+  static const char* Name(Sonar sonar);
+
+private:
+  double staleTimeout;
+
+  float ranges[NUM_SONARS] = {0, 0, 0};
+  double stamps[NUM_SONARS] = {0, 0, 0};
+  double newest = 0;
+  unsigned int seen = 0;
+  unsigned int staleMask = 0;
+};
+
+#endif // SONARFUSION_H
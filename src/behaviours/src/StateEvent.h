@@ -0,0 +1,33 @@
+#ifndef STATEEVENT_H
+#define STATEEVENT_H
+
+#include <stdint.h>
+
+#include "FlightRecorder.h"
+
+// Why LogicController's state changed. Numbered like the swarmie_msgs/
+// BehaviourState reasons, append new ones at the end.
+enum StateEventReason {
+  STATE_REASON_RESET = 0,       // Reset(), e.g. switching to auto mode
+  STATE_REASON_MANUAL,          // SetModeManual()
+  STATE_REASON_INTERRUPT,       // a controller's ShouldInterrupt()
+  STATE_REASON_NO_WORK,         // no controller has work
+  STATE_REASON_PRIORITY,        // another controller with work took over
+  STATE_REASON_NEXT_PROCESS,    // a controller asked for the next process state
+  STATE_REASON_PREV_PROCESS,    // or the previous one
+  STATE_REASON_PRECISION,       // a controller took direct command of the drive
+  STATE_REASON_WAYPOINT,        // a controller handed waypoints to the drive controller
+  STATE_REASON_WAYPOINTS_DONE   // the drive controller ran out of waypoints
+};
+
+// A change of LogicController's process state, logic state or active
+// controller, see LogicController::TakeStateEvents().
+struct StateEvent {
+  long time;              // ms, LogicController's current time
+  uint8_t processState;   // LogicController::ProcessState
+  uint8_t logicState;     // LogicController::LogicState
+  uint8_t controller;     // FlightController
+  uint8_t reason;         // StateEventReason
+};
+
+#endif // STATEEVENT_H
@@ -1,10 +1,15 @@
 #include "Tag.h"
 
 #include <cmath> // For trig functions
+#include <type_traits>
 
 using namespace std;
 using namespace boost::math;
 
+// Tag buffers are handed between threads and reused without reallocating,
+// keep the type flat.
+static_assert(std::is_trivially_copyable<Tag>::value, "Tag must stay trivially copyable");
+
 // Extend ostream.
 // Output stream operator. Allows easy writing of tag data to an output stream.
 ostream& operator<<(ostream& output_stream, const Tag& tag) {
@@ -30,19 +35,6 @@ ostream& operator<<(ostream& output_stream, const Tag& tag) {
 }
 
 
-// Constructors
-Tag::Tag() {
-  // Initialize orientation and position
-  orientation = ::boost::math::quaternion<float>(0,0,0,0);
-  position = make_tuple(0,0,0);
-}
-
-Tag::Tag(const Tag &that) {
-  this->setPosition( that.position );
-  this->setOrientation( that.orientation );
-  this->setID( that.id );
-}
-
 int Tag::getID() const {
   return id;
 }
@@ -52,79 +44,33 @@ void Tag::setID( int id) {
 }
 
 tuple<float, float, float> Tag::getPosition() const {
-  return position;
+  return make_tuple(position[0], position[1], position[2]);
 }
 
 void Tag::setPosition( tuple<float, float, float> position ) {
-  this->position = position;
-}
-
-quaternion<float> Tag::getOrientation() const {
-  return orientation;
-}
-
-void Tag::setOrientation( quaternion<float> orientation ) {
-  this->orientation = orientation;
-}
-
-// convenience accessor functions
-float Tag::getPositionX() const {
-  return std::get<0>(position);
-}
-
-float Tag::getPositionY() const {
-  return std::get<1>(position);
-}
-
-float Tag::getPositionZ() const {
-  return std::get<2>(position);
+  setPosition( get<0>(position), get<1>(position), get<2>(position) );
 }
 
-float Tag::getOrientationX() const {
-  return orientation.R_component_1();
+void Tag::setPosition( float x, float y, float z ) {
+  position[0] = x;
+  position[1] = y;
+  position[2] = z;
 }
 
-float Tag::getOrientationY() const {
-  orientation.R_component_2();
-}
-
-float Tag::getOrientationZ() const {
-  orientation.R_component_3();
-}
-
-float Tag::getOrientationW() const {
-  orientation.R_component_4();
-}
-
-void Tag::setPositionX( float x ) {
-  std::get<0>(position) = x;
-}
-
-void Tag::setPositionY( float y ) {
-  std::get<1>(position) = y;
-}
-
-void Tag::setPositionZ( float z ) {
-  std::get<2>(position) = z;
-}
-
-// The following functions recreate the entire quaternion each time a value is changed
-// becuase you cannot change quaternion components without rebuilding the whole quaternion.
-// This is a limitation of the boost quaternion.
-void Tag::setOrientationX( float x ){
-  orientation = quaternion<float>( x, getOrientationY(), getOrientationZ(), getOrientationW() );
-}
-
-void Tag::setOrientationY( float y ){
-  orientation = quaternion<float>( getOrientationX(), y, getOrientationZ(), getOrientationW() );
+quaternion<float> Tag::getOrientation() const {
+  return quaternion<float>( orientation[0], orientation[1], orientation[2], orientation[3] );
 }
 
-void Tag::setOrientationZ( float z ){
-  orientation = quaternion<float>( getOrientationX(), getOrientationY(), z, getOrientationW() );
+void Tag::setOrientation( quaternion<float> orientation ) {
+  setOrientation( orientation.R_component_1(), orientation.R_component_2(),
+		  orientation.R_component_3(), orientation.R_component_4() );
 }
 
-void Tag::setOrientationW( float w ){
-  orientation = quaternion<float>( getOrientationX(), getOrientationY(), getOrientationZ(), w );
+void Tag::setOrientation( float x, float y, float z, float w ) {
+  orientation[0] = x;
+  orientation[1] = y;
+  orientation[2] = z;
+  orientation[3] = w;
 }
 
 // ***
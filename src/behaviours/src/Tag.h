@@ -7,12 +7,14 @@
 #include "Point.h"
 
 // Stores AprilTag data
+// The layout is plain floats so tags are trivially copyable and the hot
+// accessors below are inlined. The tuple and quaternion getters build their
+// return value on demand.
 class Tag {
  public:
 
   // Contructors
-  Tag();
-  Tag( const Tag &that);
+  Tag() = default;
   
   // Getters and setters
   int getID() const;
@@ -28,21 +30,25 @@ class Tag {
 
   // convenience accessor functions. The const keyword promises that we will not modify
   // class data as a side-effect of getting data.
-  float getPositionX() const;
-  float getPositionY() const;
-  float getPositionZ() const;
-  float getOrientationX() const;
-  float getOrientationY() const;
-  float getOrientationZ() const;
-  float getOrientationW() const;
+  float getPositionX() const { return position[0]; }
+  float getPositionY() const { return position[1]; }
+  float getPositionZ() const { return position[2]; }
+  float getOrientationX() const { return orientation[0]; }
+  float getOrientationY() const { return orientation[1]; }
+  float getOrientationZ() const { return orientation[2]; }
+  float getOrientationW() const { return orientation[3]; }
 
-  void setPositionX( float );
-  void setPositionY( float );
-  void setPositionZ( float );
-  void setOrientationX( float );
-  void setOrientationY( float );
-  void setOrientationZ( float );
-  void setOrientationW( float );
+  void setPositionX( float x ) { position[0] = x; }
+  void setPositionY( float y ) { position[1] = y; }
+  void setPositionZ( float z ) { position[2] = z; }
+  void setOrientationX( float x ) { orientation[0] = x; }
+  void setOrientationY( float y ) { orientation[1] = y; }
+  void setOrientationZ( float z ) { orientation[2] = z; }
+  void setOrientationW( float w ) { orientation[3] = w; }
+
+  // Set the whole pose without building a tuple or quaternion
+  void setPosition( float x, float y, float z );
+  void setOrientation( float x, float y, float z, float w );
   
   std::tuple<float,float,float> calcRollPitchYaw() const;;
   float calcRoll() const;
@@ -59,11 +65,11 @@ class Tag {
   // Tag ID
   int id = 0;
   
-  // Position in 3D coords
-  std::tuple<float,float,float> position;
+  // Position in 3D coords <x,y,z>
+  float position[3] = {0, 0, 0};
 
-  // Orientation as a quaternion
-  ::boost::math::quaternion<float> orientation;
+  // Orientation as a quaternion <x,y,z,w>
+  float orientation[4] = {0, 0, 0, 0};
 };
 
 #endif // TAG_H
@@ -0,0 +1,272 @@
+#include "TagBatch.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+// Each kernel does the blocks of four with the vector unit, then the rest
+// of the tags one at a time with the same arithmetic. ARMv7 NEON has no
+// vector square root, so only AArch64 gets the NEON kernels.
+
+void TagBatch::Assign(const vector<Tag>& tags)
+{
+  size_t n = tags.size();
+  id.resize(n);
+  x.resize(n);
+  y.resize(n);
+  z.resize(n);
+  qx.resize(n);
+  qy.resize(n);
+  qz.resize(n);
+  qw.resize(n);
+
+  for (size_t i = 0; i < n; i++)
+  {
+    const Tag& tag = tags[i];
+    id[i] = tag.getID();
+    x[i] = tag.getPositionX();
+    y[i] = tag.getPositionY();
+    z[i] = tag.getPositionZ();
+    qx[i] = tag.getOrientationX();
+    qy[i] = tag.getOrientationY();
+    qz[i] = tag.getOrientationZ();
+    qw[i] = tag.getOrientationW();
+  }
+
+  ComputeRanges();
+  ComputeFacingAway();
+}
+
+void TagBatch::ComputeRanges()
+{
+  size_t n = size();
+  range.resize(n);
+
+  size_t i = 0;
+#if defined(__SSE2__)
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 vx = _mm_loadu_ps(&x[i]);
+    __m128 vy = _mm_loadu_ps(&y[i]);
+    __m128 vz = _mm_loadu_ps(&z[i]);
+    __m128 squared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+    _mm_storeu_ps(&range[i], _mm_sqrt_ps(squared));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  for (; i + 4 <= n; i += 4)
+  {
+    float32x4_t vx = vld1q_f32(&x[i]);
+    float32x4_t vy = vld1q_f32(&y[i]);
+    float32x4_t vz = vld1q_f32(&z[i]);
+    float32x4_t squared = vaddq_f32(vaddq_f32(vmulq_f32(vx, vx), vmulq_f32(vy, vy)), vmulq_f32(vz, vz));
+    vst1q_f32(&range[i], vsqrtq_f32(squared));
+  }
+#endif
+  for (; i < n; i++)
+  {
+    range[i] = sqrt(x[i]*x[i] + y[i]*y[i] + z[i]*z[i]);
+  }
+}
+
+void TagBatch::Clear()
+{
+  id.clear();
+  x.clear();
+  y.clear();
+  z.clear();
+  qx.clear();
+  qy.clear();
+  qz.clear();
+  qw.clear();
+  range.clear();
+  facingAway.clear();
+}
+
+Tag TagBatch::At(size_t i) const
+{
+  Tag tag;
+  tag.setID(id[i]);
+  tag.setPosition(x[i], y[i], z[i]);
+  tag.setOrientation(qx[i], qy[i], qz[i], qw[i]);
+  return tag;
+}
+
+void TagBatch::GroundDistances(float height, vector<float>& out) const
+{
+  size_t n = size();
+  out.resize(n);
+  float heightSquared = height * height;
+
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128 vh = _mm_set1_ps(heightSquared);
+  __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 r = _mm_loadu_ps(&range[i]);
+    _mm_storeu_ps(&out[i], _mm_sqrt_ps(_mm_max_ps(zero, _mm_sub_ps(_mm_mul_ps(r, r), vh))));
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  float32x4_t vh = vdupq_n_f32(heightSquared);
+  float32x4_t zero = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4)
+  {
+    float32x4_t r = vld1q_f32(&range[i]);
+    vst1q_f32(&out[i], vsqrtq_f32(vmaxq_f32(zero, vsubq_f32(vmulq_f32(r, r), vh))));
+  }
+#endif
+  for (; i < n; i++)
+  {
+    out[i] = sqrt(max(0.0f, range[i]*range[i] - heightSquared));
+  }
+}
+
+// calcYaw() is atan2(2(y z + w x), w w - x x - y y + z z), which is above 0
+// when the first argument is, or when it is 0 and the second is negative
+void TagBatch::ComputeFacingAway()
+{
+  size_t n = size();
+  facingAway.resize(n);
+
+  size_t i = 0;
+#if defined(__SSE2__)
+  __m128 zero = _mm_setzero_ps();
+  for (; i + 4 <= n; i += 4)
+  {
+    __m128 vx = _mm_loadu_ps(&qx[i]);
+    __m128 vy = _mm_loadu_ps(&qy[i]);
+    __m128 vz = _mm_loadu_ps(&qz[i]);
+    __m128 vw = _mm_loadu_ps(&qw[i]);
+    __m128 sine = _mm_add_ps(_mm_mul_ps(vy, vz), _mm_mul_ps(vw, vx));
+    __m128 cosine = _mm_sub_ps(_mm_add_ps(_mm_mul_ps(vw, vw), _mm_mul_ps(vz, vz)), _mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)));
+    __m128 away = _mm_or_ps(_mm_cmpgt_ps(sine, zero), _mm_and_ps(_mm_cmpeq_ps(sine, zero), _mm_cmplt_ps(cosine, zero)));
+
+    int mask = _mm_movemask_ps(away);
+    for (int lane = 0; lane < 4; lane++) facingAway[i + lane] = (mask >> lane) & 1;
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  float32x4_t zero = vdupq_n_f32(0);
+  for (; i + 4 <= n; i += 4)
+  {
+    float32x4_t vx = vld1q_f32(&qx[i]);
+    float32x4_t vy = vld1q_f32(&qy[i]);
+    float32x4_t vz = vld1q_f32(&qz[i]);
+    float32x4_t vw = vld1q_f32(&qw[i]);
+    float32x4_t sine = vaddq_f32(vmulq_f32(vy, vz), vmulq_f32(vw, vx));
+    float32x4_t cosine = vsubq_f32(vaddq_f32(vmulq_f32(vw, vw), vmulq_f32(vz, vz)), vaddq_f32(vmulq_f32(vx, vx), vmulq_f32(vy, vy)));
+    uint32x4_t away = vorrq_u32(vcgtq_f32(sine, zero), vandq_u32(vceqq_f32(sine, zero), vcltq_f32(cosine, zero)));
+
+    uint32_t lanes[4];
+    vst1q_u32(lanes, away);
+    for (int lane = 0; lane < 4; lane++) facingAway[i + lane] = lanes[lane] != 0;
+  }
+#endif
+  for (; i < n; i++)
+  {
+    float sine = qy[i]*qz[i] + qw[i]*qx[i];
+    float cosine = (qw[i]*qw[i] + qz[i]*qz[i]) - (qx[i]*qx[i] + qy[i]*qy[i]);
+    facingAway[i] = sine > 0 || (sine == 0 && cosine < 0);
+  }
+}
+
+int TagBatch::Nearest(int tagID) const
+{
+  size_t n = size();
+  const float none = numeric_limits<float>::max();
+
+  // Every lane keeps its own nearest, the lanes are compared at the end.
+  // Ties go to the lower index, as in a plain loop.
+  int best = -1;
+  float bestRange = none;
+
+  size_t i = 0;
+#if defined(__SSE2__)
+  if (n >= 4)
+  {
+    __m128i wanted = _mm_set1_epi32(tagID);
+    __m128i index = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i four = _mm_set1_epi32(4);
+    __m128 laneRange = _mm_set1_ps(none);
+    __m128i laneIndex = _mm_set1_epi32(-1);
+
+    for (; i + 4 <= n; i += 4)
+    {
+      __m128i ids = _mm_loadu_si128((const __m128i*)&id[i]);
+      __m128 r = _mm_loadu_ps(&range[i]);
+      __m128 closer = _mm_and_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(ids, wanted)), _mm_cmplt_ps(r, laneRange));
+
+      laneRange = _mm_or_ps(_mm_and_ps(closer, r), _mm_andnot_ps(closer, laneRange));
+      __m128i closerInt = _mm_castps_si128(closer);
+      laneIndex = _mm_or_si128(_mm_and_si128(closerInt, index), _mm_andnot_si128(closerInt, laneIndex));
+      index = _mm_add_epi32(index, four);
+    }
+
+    float ranges[4];
+    int indices[4];
+    _mm_storeu_ps(ranges, laneRange);
+    _mm_storeu_si128((__m128i*)indices, laneIndex);
+    for (int lane = 0; lane < 4; lane++)
+    {
+      if (indices[lane] < 0) continue;
+      if (best < 0 || ranges[lane] < bestRange || (ranges[lane] == bestRange && indices[lane] < best))
+      {
+        best = indices[lane];
+        bestRange = ranges[lane];
+      }
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  if (n >= 4)
+  {
+    int32x4_t wanted = vdupq_n_s32(tagID);
+    const int32_t first[4] = {0, 1, 2, 3};
+    int32x4_t index = vld1q_s32(first);
+    int32x4_t four = vdupq_n_s32(4);
+    float32x4_t laneRange = vdupq_n_f32(none);
+    int32x4_t laneIndex = vdupq_n_s32(-1);
+
+    for (; i + 4 <= n; i += 4)
+    {
+      int32x4_t ids = vld1q_s32(&id[i]);
+      float32x4_t r = vld1q_f32(&range[i]);
+      uint32x4_t closer = vandq_u32(vceqq_s32(ids, wanted), vcltq_f32(r, laneRange));
+
+      laneRange = vbslq_f32(closer, r, laneRange);
+      laneIndex = vbslq_s32(closer, index, laneIndex);
+      index = vaddq_s32(index, four);
+    }
+
+    float ranges[4];
+    int32_t indices[4];
+    vst1q_f32(ranges, laneRange);
+    vst1q_s32(indices, laneIndex);
+    for (int lane = 0; lane < 4; lane++)
+    {
+      if (indices[lane] < 0) continue;
+      if (best < 0 || ranges[lane] < bestRange || (ranges[lane] == bestRange && indices[lane] < best))
+      {
+        best = indices[lane];
+        bestRange = ranges[lane];
+      }
+    }
+  }
+#endif
+  for (; i < n; i++)
+  {
+    if (id[i] == tagID && (best < 0 || range[i] < bestRange))
+    {
+      best = i;
+      bestRange = range[i];
+    }
+  }
+
+  return best;
+}
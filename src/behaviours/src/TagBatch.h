@@ -0,0 +1,48 @@
+#ifndef TAGBATCH_H
+#define TAGBATCH_H
+
+#include <cstdint>
+#include <vector>
+
+#include "Tag.h"
+
+// The tags of one camera frame as a structure of arrays, one array per
+// field, so the per tag geometry of a frame full of clustered cubes runs
+// four tags at a time with SSE2 or NEON where the compiler targets them
+// and one at a time otherwise. Tag stays the type of single tags.
+//
+// The distance from the camera lens and which way the tags face are worked
+// out once in Assign().
+class TagBatch
+{
+public:
+  void Assign(const std::vector<Tag>& tags);
+  void Clear();
+
+  size_t size() const { return id.size(); }
+  bool empty() const { return id.empty(); }
+
+  Tag At(size_t i) const;
+
+  // Distance along the ground for a camera height above it, 0 for tags
+  // closer than that
+  void GroundDistances(float height, std::vector<float>& out) const;
+
+  // The index of the tag with the given ID nearest to the lens, -1 if none
+  int Nearest(int tagID) const;
+
+  std::vector<int> id;
+  std::vector<float> x, y, z;
+  std::vector<float> qx, qy, qz, qw;
+  std::vector<float> range; // meters from the camera lens
+
+  // Whether each tag's top points away from the camera, the same as
+  // Tag::calcYaw() > 0 without the atan2
+  std::vector<uint8_t> facingAway;
+
+private:
+  void ComputeRanges();
+  void ComputeFacingAway();
+};
+
+#endif // TAGBATCH_H
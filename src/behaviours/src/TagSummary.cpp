@@ -0,0 +1,51 @@
+#include "TagSummary.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+constexpr float TagSummary::cameraOffsetCorrection;
+constexpr float TagSummary::cameraHeight;
+
+void TagSummary::Build(const TagBatch& tags)
+{
+  *this = TagSummary();
+  this->tags = tags.size();
+
+  closestTarget = tags.Nearest(TARGET_ID);
+  if (closestTarget >= 0) closestTargetRange = tags.range[closestTarget];
+
+  for (size_t i = 0; i < tags.size(); i++)
+  {
+    bool right = tags.x[i] + cameraOffsetCorrection > 0;
+
+    if (tags.id[i] == TARGET_ID)
+    {
+      targets++;
+    }
+    else if (tags.id[i] == CENTER_ID)
+    {
+      centers++;
+      if (right) centersRight++;
+      else centersLeft++;
+
+      float range = tags.range[i];
+      float distance = sqrt(max(0.0f, range*range - cameraHeight*cameraHeight));
+      centersDistance += distance;
+      centersBearing += -atan2(tags.x[i] + cameraOffsetCorrection, distance);
+    }
+
+    if (tags.facingAway[i])
+    {
+      if (right) facingAwayRight++;
+      else facingAwayLeft++;
+    }
+  }
+
+  if (centers > 0)
+  {
+    centersDistance /= centers;
+    centersBearing /= centers;
+  }
+}
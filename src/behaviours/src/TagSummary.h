@@ -0,0 +1,46 @@
+#ifndef TAGSUMMARY_H
+#define TAGSUMMARY_H
+
+#include <vector>
+
+#include "Tag.h"
+#include "TagBatch.h"
+
+// What the controllers need to know about the tags of one camera frame,
+// worked out in a single pass by LogicController::SetAprilTags() so each
+// controller does not walk the tags again.
+struct TagSummary
+{
+  // Tags seen left of this camera x offset are on the left of the rover
+  static constexpr float cameraOffsetCorrection = 0.020; //meters
+  static constexpr float cameraHeight = 0.195; //meters above the ground
+
+  static const int TARGET_ID = 0;
+  static const int CENTER_ID = 256;
+
+  int tags = 0;
+  int targets = 0;
+  int centers = 0;
+
+  // Collection zone tags by side of the image
+  int centersLeft = 0;
+  int centersRight = 0;
+
+  // The mean collection zone tag relative to the rover: meters along the
+  // ground and radians left of straight ahead. Valid when centers > 0.
+  float centersDistance = 0;
+  float centersBearing = 0;
+
+  // Tags of any ID whose top points away from the camera, as they do on
+  // the collection zone edge facing a rover outside it
+  int facingAwayLeft = 0;
+  int facingAwayRight = 0;
+
+  // The target nearest to the camera lens, -1 if there is none
+  int closestTarget = -1;
+  float closestTargetRange = 0; // meters from the camera lens
+
+  void Build(const TagBatch& tags);
+};
+
+#endif // TAGSUMMARY_H
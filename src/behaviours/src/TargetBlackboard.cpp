@@ -0,0 +1,215 @@
+#include "TargetBlackboard.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+TargetBlackboard::TargetBlackboard(float resolution, long decayTime, long claimTime)
+{
+  this->resolution = resolution;
+  this->decayTime = decayTime;
+  this->claimTime = claimTime;
+}
+
+void TargetBlackboard::SetResolution(float resolution)
+{
+  if (resolution <= 0 || resolution == this->resolution) return;
+
+  // Cells of the old size mean nothing with the new one
+  this->resolution = resolution;
+  Clear();
+}
+
+int TargetBlackboard::Cell(float position) const
+{
+  return (int)floor(position / resolution);
+}
+
+float TargetBlackboard::CellCenter(int cell) const
+{
+  return (cell + 0.5) * resolution;
+}
+
+void TargetBlackboard::Observe(float x, float y, int count, long time, bool local)
+{
+  ObserveCell(Cell(x), Cell(y), count, time, local);
+}
+
+void TargetBlackboard::ObserveCell(int x, int y, int count, long time, bool local)
+{
+  CellKey key(x, y);
+
+  if (local)
+  {
+    localChanges.insert(key);
+  }
+
+  if (count <= 0)
+  {
+    buckets.erase(key);
+    if (hasLocalClaim && localClaim == key) hasLocalClaim = false;
+    return;
+  }
+
+  map<CellKey, Bucket>::iterator found = buckets.find(key);
+  if (found == buckets.end())
+  {
+    Bucket bucket = {x, y, count, time, "", 0, false, 0, false};
+    buckets[key] = bucket;
+    return;
+  }
+
+  // Sightings from other rovers may arrive late
+  if (time >= found->second.lastSeen)
+  {
+    found->second.count = count;
+    found->second.lastSeen = time;
+  }
+}
+
+void TargetBlackboard::Claim(int x, int y, const string& rover, long time)
+{
+  CellKey key(x, y);
+
+  if (rover.empty())
+  {
+    ReleaseLocalClaim();
+    hasLocalClaim = true;
+    localClaim = key;
+  }
+
+  map<CellKey, Bucket>::iterator found = buckets.find(key);
+  if (found == buckets.end()) return;
+
+  if (!rover.empty() && hasLocalClaim && localClaim == key) return;
+
+  found->second.claimed = true;
+  found->second.claimedBy = rover;
+  found->second.claimTime = time;
+}
+
+void TargetBlackboard::ReleaseLocalClaim()
+{
+  if (!hasLocalClaim) return;
+  hasLocalClaim = false;
+
+  map<CellKey, Bucket>::iterator found = buckets.find(localClaim);
+  if (found != buckets.end() && found->second.claimed && found->second.claimedBy.empty())
+  {
+    found->second.claimed = false;
+  }
+}
+
+bool TargetBlackboard::GetLocalClaim(int& x, int& y) const
+{
+  if (!hasLocalClaim) return false;
+
+  x = localClaim.first;
+  y = localClaim.second;
+  return true;
+}
+
+void TargetBlackboard::Visit(int x, int y, long time)
+{
+  map<CellKey, Bucket>::iterator found = buckets.find(CellKey(x, y));
+  if (found == buckets.end()) return;
+
+  found->second.visited = true;
+  found->second.visitTime = time;
+}
+
+void TargetBlackboard::Expire(long time)
+{
+  for (map<CellKey, Bucket>::iterator it = buckets.begin(); it != buckets.end();)
+  {
+    Bucket& bucket = it->second;
+
+    // Our own claim lasts until it is released
+    if (bucket.claimed && !bucket.claimedBy.empty() && time - bucket.claimTime > claimTime)
+    {
+      bucket.claimed = false;
+    }
+
+    if (bucket.visited && time - bucket.visitTime > decayTime)
+    {
+      bucket.visited = false;
+    }
+
+    if (time - bucket.lastSeen > decayTime)
+    {
+      if (hasLocalClaim && localClaim == it->first) hasLocalClaim = false;
+      buckets.erase(it++);
+    }
+    else
+    {
+      ++it;
+    }
+  }
+}
+
+bool TargetBlackboard::NearestUnclaimed(float x, float y, int& cellX, int& cellY) const
+{
+  float nearest = numeric_limits<float>::max();
+  bool found = false;
+
+  for (map<CellKey, Bucket>::const_iterator it = buckets.begin(); it != buckets.end(); ++it)
+  {
+    const Bucket& bucket = it->second;
+    if (bucket.claimed && !bucket.claimedBy.empty()) continue;
+    if (bucket.visited) continue;
+
+    float distance = hypot(CellCenter(bucket.x) - x, CellCenter(bucket.y) - y);
+    if (distance < nearest)
+    {
+      nearest = distance;
+      cellX = bucket.x;
+      cellY = bucket.y;
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+int TargetBlackboard::Count(int x, int y) const
+{
+  map<CellKey, Bucket>::const_iterator found = buckets.find(CellKey(x, y));
+  return found == buckets.end() ? 0 : found->second.count;
+}
+
+long TargetBlackboard::LastSeen(int x, int y) const
+{
+  map<CellKey, Bucket>::const_iterator found = buckets.find(CellKey(x, y));
+  return found == buckets.end() ? 0 : found->second.lastSeen;
+}
+
+vector<TargetBlackboard::Bucket> TargetBlackboard::TakeLocalChanges()
+{
+  vector<Bucket> changes;
+  changes.reserve(localChanges.size());
+
+  for (set<CellKey>::const_iterator it = localChanges.begin(); it != localChanges.end(); ++it)
+  {
+    map<CellKey, Bucket>::const_iterator found = buckets.find(*it);
+    if (found != buckets.end())
+    {
+      changes.push_back(found->second);
+    }
+    else
+    {
+      Bucket empty = {it->first, it->second, 0, 0, "", 0, false, 0, false};
+      changes.push_back(empty);
+    }
+  }
+
+  localChanges.clear();
+  return changes;
+}
+
+void TargetBlackboard::Clear()
+{
+  buckets.clear();
+  localChanges.clear();
+  hasLocalClaim = false;
+}
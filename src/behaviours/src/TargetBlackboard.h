@@ -0,0 +1,93 @@
+#ifndef TARGETBLACKBOARD_H
+#define TARGETBLACKBOARD_H
+
+#include <map>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+// The cubes the swarm knows about. Positions are in the shared frame: the
+// map frame axes, which every rover's map frame has in common, with the
+// collection zone center as the origin. Sightings are bucketed into square
+// cells of resolution meters so many cubes of a cluster cost one entry, and
+// repeated sightings of the same cubes by several rovers land in the same
+// bucket.
+//
+// A bucket is forgotten decayTime ms after its cubes were last seen. A rover
+// driving to a bucket claims it so the others leave it alone; a claim lapses
+// claimTime ms after it was last renewed. Claims made by this rover have an
+// empty rover name, and another rover's claim does not take a bucket this
+// rover already claimed. A bucket this rover drove to and still found cubes
+// in is visited: it is not picked again for decayTime ms, since the cubes
+// left there were in view and will be picked up from the camera if at all.
+class TargetBlackboard
+{
+public:
+  struct Bucket {
+    int x; // cell
+    int y;
+    int count; // cubes seen at the last sighting
+    long lastSeen;
+    std::string claimedBy;
+    long claimTime;
+    bool claimed;
+    long visitTime;
+    bool visited; // by this rover, not shared
+  };
+
+  TargetBlackboard(float resolution = 0.5, long decayTime = 600000, long claimTime = 30000);
+
+  void SetResolution(float resolution);
+  void SetDecayTime(long decayTime) { this->decayTime = decayTime; }
+  float GetResolution() const { return resolution; }
+
+  int Cell(float position) const;
+  float CellCenter(int cell) const;
+
+  // count 0 means the bucket was found empty. Local sightings are also kept
+  // for TakeLocalChanges().
+  void Observe(float x, float y, int count, long time, bool local);
+  void ObserveCell(int x, int y, int count, long time, bool local);
+
+  // Pass an empty rover for this rover's own claim. This rover holds at most
+  // one claim, a new one releases the previous.
+  void Claim(int x, int y, const std::string& rover, long time);
+  void ReleaseLocalClaim();
+  bool GetLocalClaim(int& x, int& y) const;
+
+  // This rover reached the bucket, see above
+  void Visit(int x, int y, long time);
+
+  // Drops buckets, claims and visits that are too old
+  void Expire(long time);
+
+  // The cell with cubes that is nearest to (x, y), not claimed by another
+  // rover and not visited. Returns false if there is none.
+  bool NearestUnclaimed(float x, float y, int& cellX, int& cellY) const;
+
+  // Cubes in the bucket, 0 if it is not known
+  int Count(int x, int y) const;
+  long LastSeen(int x, int y) const;
+
+  // The buckets this rover observed since the last call, with their current
+  // count, so they can be sent to the other rovers
+  std::vector<Bucket> TakeLocalChanges();
+
+  void Clear();
+
+private:
+  typedef std::pair<int, int> CellKey;
+
+  float resolution;
+  long decayTime;
+  long claimTime;
+
+  std::map<CellKey, Bucket> buckets;
+  std::set<CellKey> localChanges;
+
+  bool hasLocalClaim = false;
+  CellKey localClaim;
+};
+
+#endif // TARGETBLACKBOARD_H
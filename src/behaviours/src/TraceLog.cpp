@@ -0,0 +1,186 @@
+#include "TraceLog.h"
+
+#include <chrono>
+#include <cstring>
+
+using namespace std;
+
+TraceLog& TraceLog::Instance()
+{
+  static TraceLog log;
+  return log;
+}
+
+TraceLog::TraceLog() : numQueues(0), dropped(0), writing(false), file(NULL)
+{
+  for (int i = 0; i < MAX_PRODUCERS; i++)
+  {
+    queues[i].head = 0;
+    queues[i].tail = 0;
+  }
+
+  for (int i = 0; i < TRACE_NUM_SOURCES; i++)
+  {
+    levels[i] = TRACE_INFO;
+  }
+}
+
+TraceLog::~TraceLog()
+{
+  Close();
+}
+
+bool TraceLog::Open(const string& path)
+{
+  lock_guard<mutex> lock(openMutex);
+
+  if (file != NULL)
+  {
+    return true;
+  }
+
+  file = fopen(path.c_str(), "wb");
+  if (file == NULL)
+  {
+    return false;
+  }
+
+  TraceFileHeader header;
+  memcpy(header.magic, "SWTR", 4);
+  header.version = FILE_VERSION;
+  header.recordSize = sizeof (TraceRecord);
+  fwrite(&header, sizeof (header), 1, file);
+
+  writing = true;
+  writer = thread(&TraceLog::WriterLoop, this);
+  return true;
+}
+
+void TraceLog::Close()
+{
+  lock_guard<mutex> lock(openMutex);
+
+  if (file == NULL)
+  {
+    return;
+  }
+
+  writing = false;
+  if (writer.joinable())
+  {
+    writer.join();
+  }
+
+  Drain();
+  fclose(file);
+  file = NULL;
+}
+
+const char* TraceLog::SourceName(TraceSource source)
+{
+  static const char* names[TRACE_NUM_SOURCES] = {
+    "adapter", "logic", "search", "obstacle", "pickup", "dropoff", "range", "drive"
+  };
+  return names[source];
+}
+
+void TraceLog::SetLevel(TraceSource source, TraceLevel level)
+{
+  levels[source].store(level, memory_order_relaxed);
+}
+
+TraceLog::Queue* TraceLog::ProducerQueue()
+{
+  // Each thread claims a ring the first time it records. Threads beyond
+  // MAX_PRODUCERS get none and their records are dropped.
+  thread_local Queue* queue = NULL;
+  thread_local bool claimed = false;
+
+  if (!claimed)
+  {
+    claimed = true;
+    int index = numQueues.fetch_add(1);
+    if (index < MAX_PRODUCERS)
+    {
+      queue = &queues[index];
+    }
+  }
+  return queue;
+}
+
+void TraceLog::Record(TraceSource source, TraceLevel level, TraceEvent event,
+                      int32_t arg, float v0, float v1, float v2, float v3)
+{
+  Queue* queue = ProducerQueue();
+  if (queue == NULL)
+  {
+    dropped.fetch_add(1, memory_order_relaxed);
+    return;
+  }
+
+  uint32_t head = queue->head.load(memory_order_relaxed);
+  if (head - queue->tail.load(memory_order_acquire) >= QUEUE_SIZE)
+  {
+    dropped.fetch_add(1, memory_order_relaxed);
+    return;
+  }
+
+  TraceRecord& record = queue->records[head & (QUEUE_SIZE - 1)];
+  record.time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now().time_since_epoch()).count();
+  record.source = source;
+  record.level = level;
+  record.event = event;
+  record.arg = arg;
+  record.values[0] = v0;
+  record.values[1] = v1;
+  record.values[2] = v2;
+  record.values[3] = v3;
+
+  queue->head.store(head + 1, memory_order_release);
+}
+
+bool TraceLog::Drain()
+{
+  bool wrote = false;
+  int producers = numQueues.load();
+  if (producers > MAX_PRODUCERS)
+  {
+    producers = MAX_PRODUCERS;
+  }
+
+  for (int i = 0; i < producers; i++)
+  {
+    Queue& queue = queues[i];
+    uint32_t tail = queue.tail.load(memory_order_relaxed);
+    uint32_t head = queue.head.load(memory_order_acquire);
+
+    // Write the ready records in at most two contiguous runs of the ring.
+    while (tail != head)
+    {
+      uint32_t start = tail & (QUEUE_SIZE - 1);
+      uint32_t count = head - tail;
+      if (start + count > QUEUE_SIZE)
+      {
+        count = QUEUE_SIZE - start;
+      }
+      fwrite(&queue.records[start], sizeof (TraceRecord), count, file);
+      tail += count;
+      wrote = true;
+    }
+
+    queue.tail.store(tail, memory_order_release);
+  }
+  return wrote;
+}
+
+void TraceLog::WriterLoop()
+{
+  while (writing)
+  {
+    if (!Drain())
+    {
+      fflush(file);
+      this_thread::sleep_for(chrono::milliseconds(20));
+    }
+  }
+}
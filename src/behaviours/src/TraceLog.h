@@ -0,0 +1,145 @@
+#ifndef TRACELOG_H
+#define TRACELOG_H
+
+#include <atomic>
+#include <cstdio>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <thread>
+
+// Low overhead structured trace for the behaviour hot path. Trace() copies a
+// fixed size record into a lock-free single producer, single consumer ring
+// owned by the calling thread and returns; a background thread drains the
+// rings into a compact binary file. Records are dropped (and counted) when
+// a ring is full or no file is open, so tracing never blocks the caller.
+//
+// The file starts with a TraceFileHeader followed by TraceRecords.
+// scripts/decode_trace.py turns it back into text; keep its source and
+// event tables in sync with the enums below.
+
+// Who produced a record. Verbosity is selected per source.
+enum TraceSource {
+  TRACE_ADAPTER = 0,
+  TRACE_LOGIC,
+  TRACE_SEARCH,
+  TRACE_OBSTACLE,
+  TRACE_PICKUP,
+  TRACE_DROPOFF,
+  TRACE_RANGE,
+  TRACE_DRIVE,
+  TRACE_NUM_SOURCES
+};
+
+enum TraceLevel {
+  TRACE_OFF = 0,
+  TRACE_INFO,
+  TRACE_DEBUG
+};
+
+// What happened. Append new events at the end so old files still decode.
+enum TraceEvent {
+  TRACE_TICK = 0,               // values: left, right drive command
+  TRACE_TAGS_RECEIVED,          // arg: number of detections
+  TRACE_LOGIC_RESET,
+  TRACE_SEARCH_SET_TAGS,        // arg: number of tags
+  TRACE_PICKUP_RESET_INTERRUPT_FREE,
+  TRACE_PICKUP_BLOCK_YAW_ERROR, // values: blockYawError
+  TRACE_RANGE_DO_WORK,          // values: target x, y
+  TRACE_RANGE_INTERRUPT,
+  TRACE_RANGE_HAS_WORK          // values: current x, y
+};
+
+#pragma pack(push, 1)
+
+struct TraceFileHeader {
+  char magic[4];          // "SWTR"
+  uint16_t version;
+  uint16_t recordSize;
+};
+
+struct TraceRecord {
+  uint64_t time;          // steady clock nanoseconds
+  uint8_t source;         // TraceSource
+  uint8_t level;          // TraceLevel
+  uint16_t event;         // TraceEvent
+  int32_t arg;
+  float values[4];
+};
+
+#pragma pack(pop)
+
+class TraceLog
+{
+public:
+
+  static const uint16_t FILE_VERSION = 1;
+
+  static TraceLog& Instance();
+
+  // Opens path and starts the writer thread. Returns false if the file
+  // could not be opened, tracing then stays disabled.
+  bool Open(const std::string& path);
+  // Drains what is left, stops the writer thread and closes the file.
+  void Close();
+
+  // Lower case source name, as used for the trace_levels parameters and by
+  // the decoder.
+  static const char* SourceName(TraceSource source);
+
+  void SetLevel(TraceSource source, TraceLevel level);
+  bool Enabled(TraceSource source, TraceLevel level) const
+  {
+    return writing.load(std::memory_order_relaxed) &&
+           level <= levels[source].load(std::memory_order_relaxed);
+  }
+
+  void Record(TraceSource source, TraceLevel level, TraceEvent event,
+              int32_t arg, float v0, float v1, float v2, float v3);
+
+  unsigned long Dropped() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+  TraceLog();
+  ~TraceLog();
+
+  static const int MAX_PRODUCERS = 4;
+  static const uint32_t QUEUE_SIZE = 4096; // records per producer, power of two
+
+  // One ring per producing thread, claimed on the thread's first record.
+  struct Queue {
+    std::atomic<uint32_t> head; // next slot to write, owned by the producer
+    std::atomic<uint32_t> tail; // next slot to read, owned by the writer thread
+    TraceRecord records[QUEUE_SIZE];
+  };
+
+  Queue* ProducerQueue();
+  bool Drain(); // returns true if anything was written
+  void WriterLoop();
+
+  Queue queues[MAX_PRODUCERS];
+  std::atomic<int> numQueues;
+
+  std::atomic<TraceLevel> levels[TRACE_NUM_SOURCES];
+  std::atomic<unsigned long> dropped;
+
+  std::mutex openMutex; // guards Open() and Close()
+  std::atomic<bool> writing;
+  FILE* file;
+  std::thread writer;
+};
+
+// Records an event if the source is traced at this level. Cheap enough to
+// leave in the control loop: a disabled call is two relaxed loads.
+inline void Trace(TraceSource source, TraceLevel level, TraceEvent event,
+                  int32_t arg = 0, float v0 = 0, float v1 = 0, float v2 = 0, float v3 = 0)
+{
+  TraceLog& log = TraceLog::Instance();
+  if (log.Enabled(source, level))
+  {
+    log.Record(source, level, event, arg, v0, v1, v2, v3);
+  }
+}
+
+#endif // TRACELOG_H
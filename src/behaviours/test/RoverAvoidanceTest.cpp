@@ -0,0 +1,51 @@
+#include "RoverAvoidance.h"
+
+#include <gtest/gtest.h>
+
+static Point At(float x, float y, float theta)
+{
+  Point point = {x, y, theta};
+  return point;
+}
+
+// Two rovers whose disks already overlap, the other one standing still
+// straight ahead: pushing on at full speed is the worst choice.
+TEST(RoverAvoidance, OverlapAheadDoesNotDriveOn)
+{
+  RoverAvoidance avoidance;
+  avoidance.SetSelf(At(0, 0, 0), 0.3, RoverAvoidance::INTENT_SEARCHING);
+  avoidance.UpdateNeighbour("other", At(0.5, 0, 0), 0, RoverAvoidance::INTENT_SEARCHING, 10);
+
+  float speedScale = 1, headingChange = 0;
+  avoidance.Adjust(10, 0.3, speedScale, headingChange);
+
+  EXPECT_LT(speedScale, 1);
+}
+
+// The same overlap with the other rover behind: driving on opens the gap.
+TEST(RoverAvoidance, OverlapBehindDrivesOn)
+{
+  RoverAvoidance avoidance;
+  avoidance.SetSelf(At(0, 0, 0), 0.3, RoverAvoidance::INTENT_SEARCHING);
+  avoidance.UpdateNeighbour("other", At(-0.5, 0, 0), 0, RoverAvoidance::INTENT_SEARCHING, 10);
+
+  float speedScale = 0, headingChange = 1;
+  avoidance.Adjust(10, 0.3, speedScale, headingChange);
+
+  EXPECT_EQ(1, speedScale);
+  EXPECT_EQ(0, headingChange);
+}
+
+// Far apart rovers are left alone
+TEST(RoverAvoidance, FarNeighbourIgnored)
+{
+  RoverAvoidance avoidance;
+  avoidance.SetSelf(At(0, 0, 0), 0.3, RoverAvoidance::INTENT_SEARCHING);
+  avoidance.UpdateNeighbour("other", At(10, 0, 0), 0, RoverAvoidance::INTENT_SEARCHING, 10);
+
+  float speedScale = 0, headingChange = 1;
+  avoidance.Adjust(10, 0.3, speedScale, headingChange);
+
+  EXPECT_EQ(1, speedScale);
+  EXPECT_EQ(0, headingChange);
+}
@@ -0,0 +1,27 @@
+#include "TargetBlackboard.h"
+
+#include <gtest/gtest.h>
+
+// A bucket that still had cubes when this rover got there is not picked
+// again until it decays, so the search is not sent back every tick.
+TEST(TargetBlackboard, VisitedBucketNotPickedUntilDecay)
+{
+  TargetBlackboard blackboard(0.5, 1000, 30000);
+  blackboard.ObserveCell(4, 0, 2, 0, true);
+  blackboard.ObserveCell(-8, 0, 1, 0, true);
+
+  int x, y;
+  ASSERT_TRUE(blackboard.NearestUnclaimed(0, 0, x, y));
+  EXPECT_EQ(4, x);
+
+  blackboard.Visit(4, 0, 100);
+  blackboard.ObserveCell(4, 0, 2, 500, true);
+  blackboard.Expire(500);
+  ASSERT_TRUE(blackboard.NearestUnclaimed(0, 0, x, y));
+  EXPECT_EQ(-8, x);
+
+  blackboard.ObserveCell(4, 0, 2, 1200, true);
+  blackboard.Expire(1200);
+  ASSERT_TRUE(blackboard.NearestUnclaimed(0, 0, x, y));
+  EXPECT_EQ(4, x);
+}
@@ -5,11 +5,14 @@
 #include <sys/stat.h> // To check if a file exists
 #include <std_msgs/String.h> // For creating ROS string messages
 #include <ctime> // For time()
+#include <cmath> // For atan2()
 
 using namespace std;
 using namespace gazebo;
 
-Diagnostics::Diagnostics(std::string name) {
+// Gazebo publishes world statistics every 0.2 s, a period twice that long
+// counts as dropped
+Diagnostics::Diagnostics(std::string name) : simRateStats(simRateWindow, 0.4) {
 
   node_heartbeat_timeout = 5.0;
   device_heartbeat_timeout = 2.0;
@@ -19,8 +22,9 @@ Diagnostics::Diagnostics(std::string name) {
   this->publishedName = name;
   diagLogPublisher = nodeHandle.advertise<std_msgs::String>("/diagsLog", 1, true);
   diagnosticDataPublisher  = nodeHandle.advertise<std_msgs::Float32MultiArray>("/"+publishedName+"/diagnostics", 1);
+  simRateStatsPublisher = nodeHandle.advertise<swarmie_msgs::SimRateStats>("/"+publishedName+"/sim_rate", 1);
   fingerAngleSubscribe = nodeHandle.subscribe(publishedName + "/fingerAngle/prev_cmd", 10, &Diagnostics::fingerTimestampUpdate, this);
-  wristAngleSubscribe = nodeHandle.subscribe(publishedName + "/fingerAngle/prev_cmd", 10, &Diagnostics::wristTimestampUpdate, this);
+  wristAngleSubscribe = nodeHandle.subscribe(publishedName + "/wristAngle/prev_cmd", 10, &Diagnostics::wristTimestampUpdate, this);
   imuSubscribe = nodeHandle.subscribe(publishedName + "/imu", 10, &Diagnostics::imuTimestampUpdate, this);
   odometrySubscribe = nodeHandle.subscribe(publishedName + "/odom", 10, &Diagnostics::odometryTimestampUpdate, this);
   sonarLeftSubscribe = nodeHandle.subscribe(publishedName + "/sonarLeft", 10, &Diagnostics::sonarLeftTimestampUpdate, this);
@@ -30,20 +34,53 @@ Diagnostics::Diagnostics(std::string name) {
   sbdridgeNodeSubscribe = nodeHandle.subscribe(publishedName + "/sbridge/heartbeat", 1, &Diagnostics::sbridgeNode,this);
   behaviourNodeSubscribe = nodeHandle.subscribe(publishedName + "/behaviour/heartbeat", 1, &Diagnostics::behaviourNode,this);
   ubloxNodeSubscribe = nodeHandle.subscribe(publishedName + "/fix" , 1, &Diagnostics::ubloxNode,this);
+  statusSubscribe = nodeHandle.subscribe(publishedName + "/status", 1, &Diagnostics::statusUpdate, this);
 
   // Initialize the variables we use to track the simulation update rate
   prevRealTime = common::Time(0.0);
   prevSimTime = common::Time(0.0);
-  simRate = 0.0f;
+  ros::param::param("~sim_rate_warning_threshold", simRateWarningThreshold, 0.5f);
+  ros::param::param("~dropped_updates_warning_threshold", droppedUpdatesWarningThreshold, 5);
 
   // Setup sensor check timers
   sensorCheckTimer = nodeHandle.createTimer(ros::Duration(sensorCheckInterval), &Diagnostics::sensorCheckTimerEventHandler, this);
 
+  // Setup the sensor topic statistics, in SensorTopic order
+  const char* sensorTopicNames[NUM_SENSOR_TOPICS] = {
+    "fingerAngle/prev_cmd", "wristAngle/prev_cmd", "imu", "odom", "sonarLeft", "sonarCenter", "sonarRight", "fix"
+  };
+  for (int i = 0; i < NUM_SENSOR_TOPICS; i++) {
+    topicStats.push_back(TopicStats(publishedName + "/" + sensorTopicNames[i]));
+  }
+  topicStatsPublisher = nodeHandle.advertise<swarmie_msgs::TopicStatsArray>("/"+publishedName+"/topic_stats", 1);
+  ros::param::param("~topic_stats_interval", topicStatsInterval, topicStatsInterval);
+  topicStatsTimer = nodeHandle.createTimer(ros::Duration(topicStatsInterval), &Diagnostics::topicStatsTimerEventHandler, this);
+
+  // Setup the wireless sampling timer
+  ros::param::param("~wireless_sample_interval", wirelessSampleInterval, wirelessSampleInterval);
+  wirelessSampleTimer = nodeHandle.createTimer(ros::Duration(wirelessSampleInterval), &Diagnostics::wirelessSampleTimerEventHandler, this);
+
   // Setup Node check timer
   nodeCheckTimer = nodeHandle.createTimer(ros::Duration(nodeCheckInterval), &Diagnostics::nodeCheckTimerEventHandler, this);
   
   simCheckTimer = nodeHandle.createTimer(ros::Duration(sensorCheckInterval), &Diagnostics::simCheckTimerEventHandler, this);
 
+  // Latched so a GUI that starts later gets the status straight away
+  telemetryPublisher = nodeHandle.advertise<swarmie_msgs::RoverTelemetry>("/"+publishedName+"/telemetry", 1, true);
+  ros::param::param("~telemetry_rate", telemetryRate, telemetryRate);
+  telemetryTimer = nodeHandle.createTimer(ros::Duration(1.0 / telemetryRate), &Diagnostics::telemetryTimerEventHandler, this);
+
+  float pathEpsilon, pathTurnThreshold;
+  ros::param::param("~path_epsilon", pathEpsilon, 0.05f);
+  ros::param::param("~path_turn_threshold", pathTurnThreshold, 0.2f);
+  ros::param::param("~path_batch_interval", pathBatchInterval, pathBatchInterval);
+  pathDecimators.assign(swarmie_msgs::PathBatch::GPS + 1, PathDecimator(pathEpsilon, pathTurnThreshold, pathResolution));
+  pathPublisher = nodeHandle.advertise<swarmie_msgs::PathBatch>("/"+publishedName+"/path", 10);
+  encoderPathSubscribe = nodeHandle.subscribe(publishedName + "/odom/filtered", 10, &Diagnostics::encoderPathUpdate, this);
+  ekfPathSubscribe = nodeHandle.subscribe(publishedName + "/odom/ekf", 10, &Diagnostics::ekfPathUpdate, this);
+  gpsPathSubscribe = nodeHandle.subscribe(publishedName + "/odom/navsat", 10, &Diagnostics::gpsPathUpdate, this);
+  pathTimer = nodeHandle.createTimer(ros::Duration(pathBatchInterval), &Diagnostics::pathTimerEventHandler, this);
+
   if ( checkIfSimulatedRover() ) {
     // For processing gazebo messages from the world stats topic.
     // Used to gather information for simulated rovers
@@ -73,6 +110,12 @@ Diagnostics::Diagnostics(std::string name) {
     } catch( exception &e ) {
       publishErrorLogMessage("Error setting interface name for wireless diagnostics: " + string(e.what()));
     }
+
+    try {
+      usbPresence.start();
+    } catch( exception &e ) {
+      publishWarningLogMessage(string(e.what()) + ", scanning the USB busses on each sensor check instead");
+    }
   }
 }
 
@@ -94,10 +137,17 @@ void Diagnostics::publishDiagnosticData() {
   rosMsg.data.push_back(info.quality);
   rosMsg.data.push_back(info.bandwidthUsed);
   rosMsg.data.push_back(-1); // Sim update rate
-  diagnosticDataPublisher.publish(rosMsg);  
+  rosMsg.data.push_back(info.errors); // Interface errors since the last sample
+  rosMsg.data.push_back(info.dropped); // Dropped packets since the last sample
+  publishDiagnosticArray(rosMsg);
   }
 }
 
+void Diagnostics::publishDiagnosticArray(const std_msgs::Float32MultiArray& msg) {
+  latestDiagnosticData = msg.data;
+  diagnosticDataPublisher.publish(msg);
+}
+
 void Diagnostics::publishErrorLogMessage(std::string msg) {
 
   std_msgs::String ros_msg;
@@ -120,30 +170,37 @@ void Diagnostics::publishInfoLogMessage(std::string msg) {
 
 void Diagnostics::fingerTimestampUpdate(const geometry_msgs::QuaternionStamped::ConstPtr& message) {
 	fingersTimestamp = message->header.stamp;
+	recordSensorMessage(FINGER_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::wristTimestampUpdate(const geometry_msgs::QuaternionStamped::ConstPtr& message) {
 	wristTimestamp = message->header.stamp;
+	recordSensorMessage(WRIST_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::imuTimestampUpdate(const sensor_msgs::Imu::ConstPtr& message) {
 	imuTimestamp = message->header.stamp;
+	recordSensorMessage(IMU_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::odometryTimestampUpdate(const nav_msgs::Odometry::ConstPtr& message) {
 	odometryTimestamp = message->header.stamp;
+	recordSensorMessage(ODOMETRY_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::sonarLeftTimestampUpdate(const sensor_msgs::Range::ConstPtr& message) {
 	sonarLeftTimestamp = message->header.stamp;
+	recordSensorMessage(SONAR_LEFT_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::sonarCenterTimestampUpdate(const sensor_msgs::Range::ConstPtr& message) {
 	sonarCenterTimestamp = message->header.stamp;
+	recordSensorMessage(SONAR_CENTER_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::sonarRightTimestampUpdate(const sensor_msgs::Range::ConstPtr& message) {
     sonarRightTimestamp = message->header.stamp;
+    recordSensorMessage(SONAR_RIGHT_TOPIC, message->header.stamp);
 }
 
 void Diagnostics::abridgeNode(std_msgs::String msg) {
@@ -160,6 +217,103 @@ void Diagnostics::behaviourNode(std_msgs::String msg) {
 
 void Diagnostics::ubloxNode(const sensor_msgs::NavSatFix::ConstPtr& message) {
     ubloxNodeTimestamp = ros::Time::now();
+    recordSensorMessage(GPS_TOPIC, message->header.stamp);
+}
+
+void Diagnostics::statusUpdate(const std_msgs::String::ConstPtr& message) {
+    roverStatus = message->data;
+}
+
+void Diagnostics::encoderPathUpdate(const nav_msgs::Odometry::ConstPtr& message) {
+    addPathPose(swarmie_msgs::PathBatch::ENCODER, *message);
+}
+
+void Diagnostics::ekfPathUpdate(const nav_msgs::Odometry::ConstPtr& message) {
+    addPathPose(swarmie_msgs::PathBatch::EKF, *message);
+}
+
+void Diagnostics::gpsPathUpdate(const nav_msgs::Odometry::ConstPtr& message) {
+    addPathPose(swarmie_msgs::PathBatch::GPS, *message);
+}
+
+void Diagnostics::addPathPose(uint8_t source, const nav_msgs::Odometry& message) {
+  const geometry_msgs::Quaternion& q = message.pose.pose.orientation;
+  float yaw = atan2(2 * (q.w * q.z + q.x * q.y), 1 - 2 * (q.y * q.y + q.z * q.z));
+
+  pathDecimators[source].addPose(message.pose.pose.position.x, message.pose.pose.position.y, yaw);
+}
+
+void Diagnostics::recordSensorMessage(SensorTopic topic, const ros::Time& stamp) {
+  topicStats[topic].messageReceived(ros::Time::now().toSec(), stamp.toSec());
+}
+
+// Publishes the rate, jitter and latency of every sensor topic since the
+// last call. Topics without messages are included so a stalled sensor shows
+// up as a zero rate.
+void Diagnostics::topicStatsTimerEventHandler(const ros::TimerEvent& event) {
+  ros::Time now = ros::Time::now();
+
+  swarmie_msgs::TopicStatsArray msg;
+  msg.stamp = now;
+  msg.period = topicStatsInterval;
+  msg.latency_bucket_bounds = TopicStats::latencyBucketBounds();
+
+  for (size_t i = 0; i < topicStats.size(); i++) {
+    TopicStatsSummary summary = topicStats[i].summarize(now.toSec());
+
+    swarmie_msgs::TopicStats topic;
+    topic.topic = summary.topic;
+    topic.messages = summary.messages;
+    topic.rate = summary.rate;
+    topic.jitter = summary.jitter;
+    topic.latency_mean = summary.latencyMean;
+    topic.latency_max = summary.latencyMax;
+    topic.latency_histogram = summary.latencyHistogram;
+    msg.topics.push_back(topic);
+  }
+
+  topicStatsPublisher.publish(msg);
+}
+
+// Publishes what the GUI needs from this rover in one message. Nothing is
+// sent until the rover has reported a status, which is also what the GUI
+// uses to discover rovers.
+void Diagnostics::telemetryTimerEventHandler(const ros::TimerEvent& event) {
+  if (roverStatus.empty()) return;
+
+  ros::Time now = ros::Time::now();
+  ros::Duration timeout(node_heartbeat_timeout);
+
+  swarmie_msgs::RoverTelemetry msg;
+  msg.stamp = now;
+  msg.status = roverStatus;
+  msg.behaviour_running = now - behaviourNodeTimestamp <= timeout;
+  msg.abridge_running = now - abridgeNodeTimestamp <= timeout;
+  msg.sbridge_running = now - sbridgeNodeTimestamp <= timeout;
+  msg.diagnostics = latestDiagnosticData;
+  telemetryPublisher.publish(msg);
+}
+
+// Sends the path points kept since the last call. Nothing is sent while the
+// rover is standing still.
+void Diagnostics::pathTimerEventHandler(const ros::TimerEvent& event) {
+  for (size_t source = 0; source < pathDecimators.size(); source++) {
+    if (!pathDecimators[source].hasPoints()) continue;
+
+    vector<PathBatch> batches;
+    pathDecimators[source].takeBatches(batches);
+
+    for (size_t i = 0; i < batches.size(); i++) {
+      swarmie_msgs::PathBatch msg;
+      msg.source = source;
+      msg.x = batches[i].x;
+      msg.y = batches[i].y;
+      msg.resolution = pathResolution;
+      msg.dx = batches[i].dx;
+      msg.dy = batches[i].dy;
+      pathPublisher.publish(msg);
+    }
+  }
 }
 
 // Return the current time in this timezone in "WeekDay Month Day hr:mni:sec year" format.
@@ -180,18 +334,21 @@ string Diagnostics::getHumanFriendlyTime() {
 void Diagnostics::sensorCheckTimerEventHandler(const ros::TimerEvent& event) {
 
   if (!simulated) {
+  usbPresence.update();
   checkIMU();
   checkGPS();
   checkSonar();
   checkCamera();
   checkGripper();
   checkOdometry();
-  
-  publishDiagnosticData();
   }
 
 }
 
+void Diagnostics::wirelessSampleTimerEventHandler(const ros::TimerEvent& event) {
+  publishDiagnosticData();
+}
+
 void Diagnostics::nodeCheckTimerEventHandler(const ros::TimerEvent& event) {
 
 
@@ -217,13 +374,53 @@ void Diagnostics::simCheckTimerEventHandler(const ros::TimerEvent& event) {
     rosMsg.data.push_back(0.0f);
  rosMsg.data.push_back(0.0f);
     rosMsg.data.push_back(checkSimRate());
-    diagnosticDataPublisher.publish(rosMsg);
+    publishDiagnosticArray(rosMsg);
+
+    checkSimRateStats();
   }
   
 }
 
 float Diagnostics::checkSimRate() {
-  return simRate;
+  lock_guard<mutex> lock(simRateMutex);
+  return simRateStats.getSummary().mean;
+}
+
+void Diagnostics::checkSimRateStats() {
+  SimRateSummary summary;
+  {
+    lock_guard<mutex> lock(simRateMutex);
+    summary = simRateStats.getSummary();
+  }
+
+  if (summary.samples == 0) return;
+
+  swarmie_msgs::SimRateStats msg;
+  msg.stamp = ros::Time::now();
+  msg.window = summary.window;
+  msg.current = summary.current;
+  msg.min = summary.min;
+  msg.mean = summary.mean;
+  msg.p95 = summary.p95;
+  msg.samples = summary.samples;
+  msg.dropped_updates = summary.droppedUpdates;
+  simRateStatsPublisher.publish(msg);
+
+  // Only report changes so a slow simulation does not flood the log. The
+  // report includes the window statistics so score drops can be matched
+  // to slowdowns.
+  bool degraded = summary.mean < simRateWarningThreshold
+                  || summary.droppedUpdates >= droppedUpdatesWarningThreshold;
+
+  if (degraded && !simRateDegraded) {
+    publishWarningLogMessage("Simulation slowed down: sim rate mean " + to_string(summary.mean)
+                             + ", min " + to_string(summary.min)
+                             + ", " + to_string(summary.droppedUpdates) + " dropped updates in the last "
+                             + to_string((int)summary.window) + " s");
+  } else if (!degraded && simRateDegraded) {
+    publishInfoLogMessage("Simulation rate recovered: sim rate mean " + to_string(summary.mean));
+  }
+  simRateDegraded = degraded;
 }
 
 void Diagnostics::checkIMU() {
@@ -433,7 +630,9 @@ bool Diagnostics::checkCameraExists(){
 // Search through the connected USB devices for one that matches the
 // specified vendorID and productID
 bool Diagnostics::checkUSBDeviceExists(uint16_t vendorID, uint16_t productID){
-  
+
+  if (usbPresence.isStarted()) return usbPresence.deviceExists(vendorID, productID);
+
   struct usb_bus *bus;
   struct usb_device *dev;
   usb_init();
@@ -461,10 +660,16 @@ void Diagnostics::simWorldStatsEventHandler(ConstWorldStatisticsPtr &msg) {
   common::Time deltaSimTime = simTime - prevSimTime;
   common::Time deltaRealTime = realTime - prevRealTime;
 
+  // The first message only sets the reference times
+  bool first = prevRealTime == common::Time(0.0);
+
   prevSimTime = simTime;
   prevRealTime = realTime;
 
-  simRate = (deltaSimTime.Double())/(deltaRealTime.Double());
+  if (first) return;
+
+  lock_guard<mutex> lock(simRateMutex);
+  simRateStats.addSample(deltaSimTime.Double(), deltaRealTime.Double());
 }
 
 // Check whether a rover model file exists with the same name as this rover name
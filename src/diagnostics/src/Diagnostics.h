@@ -16,14 +16,25 @@
 #include <sensor_msgs/NavSatFix.h>
 
 #include "WirelessDiags.h"
+#include "SimRateStats.h"
+#include "TopicStats.h"
+#include "PathDecimator.h"
+#include "UsbPresence.h"
 
 // The following multiarray headers are for the diagnostics data publisher
 #include "std_msgs/MultiArrayLayout.h"
 #include "std_msgs/MultiArrayDimension.h"
 #include "std_msgs/Float32MultiArray.h"
 
+#include <swarmie_msgs/PathBatch.h>
+#include <swarmie_msgs/RoverTelemetry.h>
+#include <swarmie_msgs/SimRateStats.h>
+#include <swarmie_msgs/TopicStatsArray.h>
+
 #include <string>
 #include <exception>
+#include <mutex>
+#include <vector>
 
 class Diagnostics {
   
@@ -45,6 +56,10 @@ public:
   void sbridgeNode(std_msgs::String msg);
   void behaviourNode(std_msgs::String msg);
   void ubloxNode(const sensor_msgs::NavSatFixConstPtr& message);
+  void statusUpdate(const std_msgs::String::ConstPtr& message);
+  void encoderPathUpdate(const nav_msgs::Odometry::ConstPtr& message);
+  void ekfPathUpdate(const nav_msgs::Odometry::ConstPtr& message);
+  void gpsPathUpdate(const nav_msgs::Odometry::ConstPtr& message);
   
   // This function sends an array of floats
   // corresponding to predefined diagnostic values 
@@ -61,11 +76,39 @@ private:
   // These functions are called on a timer and check for problems with the sensors
   void sensorCheckTimerEventHandler(const ros::TimerEvent&);
   void simCheckTimerEventHandler(const ros::TimerEvent&);
+  void wirelessSampleTimerEventHandler(const ros::TimerEvent&);
+  void topicStatsTimerEventHandler(const ros::TimerEvent&);
+  void telemetryTimerEventHandler(const ros::TimerEvent&);
+  void pathTimerEventHandler(const ros::TimerEvent&);
+
+  // Source is one of the swarmie_msgs::PathBatch source constants
+  void addPathPose(uint8_t source, const nav_msgs::Odometry& message);
+
+  // Publishes diagnostic data and keeps a copy for the telemetry message
+  void publishDiagnosticArray(const std_msgs::Float32MultiArray& msg);
+
+  // The sensor topics whose rate, jitter and latency are tracked
+  enum SensorTopic {
+    FINGER_TOPIC = 0,
+    WRIST_TOPIC,
+    IMU_TOPIC,
+    ODOMETRY_TOPIC,
+    SONAR_LEFT_TOPIC,
+    SONAR_CENTER_TOPIC,
+    SONAR_RIGHT_TOPIC,
+    GPS_TOPIC,
+    NUM_SENSOR_TOPICS
+  };
+
+  void recordSensorMessage(SensorTopic topic, const ros::Time& stamp);
   void nodeCheckTimerEventHandler(const ros::TimerEvent&);
   
 
   // Get the rate the simulation is running for simulated rovers
   float checkSimRate();
+
+  // Publishes the sim rate statistics and warns when the simulation slows down
+  void checkSimRateStats();
   
   void checkIMU();
   void checkGPS();
@@ -89,12 +132,17 @@ private:
   // be bypassed.
   bool checkIfSimulatedRover();
   
-  // Takes the vendor and device IDs and searches the USB busses for a match
+  // Takes the vendor and device IDs and looks them up in the USB presence
+  // table, or searches the USB busses for a match if udev is unavailable
   bool checkUSBDeviceExists(uint16_t, uint16_t);
   
   ros::NodeHandle nodeHandle;
   ros::Publisher diagLogPublisher;
   ros::Publisher diagnosticDataPublisher;
+  ros::Publisher simRateStatsPublisher;
+  ros::Publisher topicStatsPublisher;
+  ros::Publisher telemetryPublisher;
+  ros::Publisher pathPublisher;
   std::string publishedName;
 
   ros::Subscriber fingerAngleSubscribe;
@@ -108,11 +156,38 @@ private:
   ros::Subscriber sbdridgeNodeSubscribe;
   ros::Subscriber behaviourNodeSubscribe;
   ros::Subscriber ubloxNodeSubscribe;
+  ros::Subscriber statusSubscribe;
+  ros::Subscriber encoderPathSubscribe;
+  ros::Subscriber ekfPathSubscribe;
+  ros::Subscriber gpsPathSubscribe;
   
   float sensorCheckInterval = 2; // Check sensors every 2 seconds
   float nodeCheckInterval = 5; //Check nodes every 5 seconds
+  float wirelessSampleInterval = 2; // Sample the wireless interface every 2 seconds, see ~wireless_sample_interval
   ros::Timer sensorCheckTimer;
+  ros::Timer wirelessSampleTimer;
+
+  // Sensor topic statistics, indexed by SensorTopic and published every
+  // topicStatsInterval seconds, see ~topic_stats_interval
+  float topicStatsInterval = 5;
+  std::vector<TopicStats> topicStats;
+  ros::Timer topicStatsTimer;
   ros::Timer simCheckTimer;
+
+  // The rover's status, node heartbeats and diagnostic data coalesced into
+  // one message, published telemetryRate times a second, see ~telemetry_rate
+  float telemetryRate = 1;
+  ros::Timer telemetryTimer;
+  std::string roverStatus;
+  std::vector<float> latestDiagnosticData;
+
+  // Decimated breadcrumbs for the GUI map, one decimator per PathBatch
+  // source. The points kept are sent in batches every pathBatchInterval
+  // seconds, see ~path_batch_interval, ~path_epsilon and ~path_turn_threshold
+  float pathBatchInterval = 1;
+  const float pathResolution = 0.01; // metres, the unit of the batch offsets
+  std::vector<PathDecimator> pathDecimators;
+  ros::Timer pathTimer;
   ros::Timer nodeCheckTimer;
 
   ros::Time diagnostics_start_time; // Time that this package started
@@ -151,14 +226,28 @@ private:
   // Max time since last heartbeat before notifying the user - in seconds
   float node_heartbeat_timeout, device_heartbeat_timeout;
 
-  // Simulation update rate as a fraction of real time
-  float simRate;
+  // Simulation update rate as a fraction of real time, over the last
+  // simRateWindow seconds. The world stats handler runs on a gazebo
+  // transport thread so the statistics are guarded by simRateMutex.
+  float simRateWindow = 10;
+  SimRateStats simRateStats;
+  std::mutex simRateMutex;
   gazebo::common::Time prevSimTime;
   gazebo::common::Time prevRealTime;
+
+  // Warn when the mean sim rate over the window falls below this fraction
+  // of real time, or when this many update periods in the window were dropped
+  float simRateWarningThreshold;
+  int droppedUpdatesWarningThreshold;
+  bool simRateDegraded = false;
   
   
   WirelessDiags wirelessDiags;
 
+  // Plugged in USB devices, kept current from udev hotplug events and
+  // brought up to date at the start of each sensor check
+  UsbPresence usbPresence;
+
   // So we can get Gazebo world stats
   gazebo::transport::NodePtr gazeboNode;
   gazebo::transport::SubscriberPtr worldStatsSubscriber;
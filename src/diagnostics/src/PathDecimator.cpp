@@ -0,0 +1,67 @@
+#include "PathDecimator.h"
+
+#include <cmath>
+#include <limits>
+
+using namespace std;
+
+PathDecimator::PathDecimator(float epsilon, float turnThreshold, float resolution) {
+  this->epsilon = epsilon;
+  this->turnThreshold = turnThreshold;
+  this->resolution = resolution;
+}
+
+bool PathDecimator::addPose(float x, float y, float theta) {
+  if (havePose) {
+    float turned = fabs(remainder(theta - lastTheta, 2 * M_PI));
+    if (hypot(x - lastX, y - lastY) <= epsilon && turned <= turnThreshold) return false;
+  }
+
+  havePose = true;
+  lastX = x;
+  lastY = y;
+  lastTheta = theta;
+
+  if (!batchOpen) {
+    startBatch(x, y);
+    return true;
+  }
+
+  long dx = lround((x - encodedX) / resolution);
+  long dy = lround((y - encodedY) / resolution);
+
+  // A jump too large to encode, such as a GPS fix after an outage, starts
+  // a new batch at the new point
+  if (labs(dx) > numeric_limits<int16_t>::max() || labs(dy) > numeric_limits<int16_t>::max()) {
+    startBatch(x, y);
+    return true;
+  }
+
+  PathBatch& batch = batches.back();
+  batch.dx.push_back(dx);
+  batch.dy.push_back(dy);
+  encodedX += dx * resolution;
+  encodedY += dy * resolution;
+  return true;
+}
+
+void PathDecimator::takeBatches(vector<PathBatch>& out) {
+  out.insert(out.end(), batches.begin(), batches.end());
+  batches.clear();
+  batchOpen = false;
+}
+
+void PathDecimator::clear() {
+  havePose = false;
+}
+
+void PathDecimator::startBatch(float x, float y) {
+  PathBatch batch;
+  batch.x = x;
+  batch.y = y;
+  batches.push_back(batch);
+
+  encodedX = x;
+  encodedY = y;
+  batchOpen = true;
+}
@@ -0,0 +1,62 @@
+#ifndef PathDecimator_h
+#define PathDecimator_h
+
+#include <stdint.h>
+#include <vector>
+
+// A run of decimated path points. The first point is absolute, each of the
+// others is an offset from the point before it in units of the decimator's
+// resolution.
+struct PathBatch {
+  float x;
+  float y;
+  std::vector<int16_t> dx;
+  std::vector<int16_t> dy;
+};
+
+// Thins a stream of poses down to the points needed to draw the path: a
+// pose is kept only when the rover has moved more than epsilon metres or
+// turned more than turnThreshold radians since the last kept pose. Kept
+// points are delta encoded into batches that are collected with
+// takeBatches().
+class PathDecimator {
+
+public:
+
+  PathDecimator(float epsilon, float turnThreshold, float resolution);
+
+  // Returns true if the pose was kept
+  bool addPose(float x, float y, float theta);
+
+  bool hasPoints() const { return !batches.empty(); }
+
+  // Moves the pending batches into out. The next kept point starts a new
+  // batch.
+  void takeBatches(std::vector<PathBatch>& out);
+
+  // Forget the last kept pose, for example after the estimate was reset
+  void clear();
+
+private:
+
+  void startBatch(float x, float y);
+
+  float epsilon;
+  float turnThreshold;
+  float resolution;
+
+  bool havePose = false;
+  float lastX = 0;
+  float lastY = 0;
+  float lastTheta = 0;
+
+  // The last point as the receiver decodes it. Offsets are taken from here
+  // rather than from the exact pose so rounding does not accumulate.
+  double encodedX = 0;
+  double encodedY = 0;
+  bool batchOpen = false;
+
+  std::vector<PathBatch> batches;
+};
+
+#endif // PathDecimator_h
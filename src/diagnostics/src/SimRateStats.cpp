@@ -0,0 +1,65 @@
+#include "SimRateStats.h"
+
+#include <algorithm> // For nth_element
+#include <vector>
+
+using namespace std;
+
+SimRateStats::SimRateStats(float windowLength, float droppedGap) {
+  this->windowLength = windowLength;
+  this->droppedGap = droppedGap;
+}
+
+void SimRateStats::addSample(double simDelta, double realDelta) {
+  // Gazebo restarts its clocks on a world reset
+  if (realDelta <= 0 || simDelta < 0) return;
+
+  Sample sample;
+  sample.simDelta = simDelta;
+  sample.realDelta = realDelta;
+  sample.dropped = realDelta > droppedGap || simDelta == 0;
+
+  samples.push_back(sample);
+  windowSimTime += simDelta;
+  windowRealTime += realDelta;
+  if (sample.dropped) windowDropped++;
+
+  // Keep the newest sample even if it alone is longer than the window
+  while (samples.size() > 1 && windowRealTime - samples.front().realDelta >= windowLength) {
+    windowSimTime -= samples.front().simDelta;
+    windowRealTime -= samples.front().realDelta;
+    if (samples.front().dropped) windowDropped--;
+    samples.pop_front();
+  }
+}
+
+SimRateSummary SimRateStats::getSummary() const {
+  SimRateSummary summary = {0, 0, 0, 0, 0, 0, 0};
+  if (samples.empty()) return summary;
+
+  vector<float> rates;
+  rates.reserve(samples.size());
+  for (deque<Sample>::const_iterator it = samples.begin(); it != samples.end(); ++it) {
+    rates.push_back(it->simDelta / it->realDelta);
+  }
+
+  summary.window = windowRealTime;
+  summary.current = rates.back();
+  summary.min = *min_element(rates.begin(), rates.end());
+  summary.mean = windowSimTime / windowRealTime;
+
+  size_t p95Index = (rates.size() - 1) * 95 / 100;
+  nth_element(rates.begin(), rates.begin() + p95Index, rates.end());
+  summary.p95 = rates[p95Index];
+
+  summary.samples = samples.size();
+  summary.droppedUpdates = windowDropped;
+  return summary;
+}
+
+void SimRateStats::clear() {
+  samples.clear();
+  windowSimTime = 0;
+  windowRealTime = 0;
+  windowDropped = 0;
+}
@@ -0,0 +1,49 @@
+#ifndef SimRateStats_h
+#define SimRateStats_h
+
+#include <deque>
+
+// Summary of the simulation rate over the statistics window
+struct SimRateSummary {
+  float window; // real seconds covered by the samples
+  float current; // rate of the most recent sample
+  float min;
+  float mean; // simulated time over real time for the whole window
+  float p95;
+  unsigned int samples;
+  unsigned int droppedUpdates;
+};
+
+// Keeps a rolling window of simulation rate samples, one per gazebo world
+// statistics message, and summarises them.
+class SimRateStats {
+
+public:
+
+  // windowLength and droppedGap are in real seconds. A sample whose real time
+  // gap is longer than droppedGap, or whose simulated time did not advance,
+  // counts as a dropped update period.
+  SimRateStats(float windowLength, float droppedGap);
+
+  void addSample(double simDelta, double realDelta);
+  SimRateSummary getSummary() const;
+  void clear();
+
+private:
+
+  struct Sample {
+    double simDelta;
+    double realDelta;
+    bool dropped;
+  };
+
+  std::deque<Sample> samples;
+  double windowSimTime = 0;
+  double windowRealTime = 0;
+  unsigned int windowDropped = 0;
+
+  float windowLength;
+  float droppedGap;
+};
+
+#endif // SimRateStats_h
@@ -0,0 +1,252 @@
+#include "SwarmMetrics.h"
+
+#include <algorithm> // For min and max
+#include <cmath> // For floor and hypot
+#include <cstdio> // For snprintf
+#include <sstream>
+
+using namespace std;
+
+// Beacon positions further apart than this are a jump of the shared frame,
+// not travel
+static const float maxPositionStep = 1.0; // meters
+
+SwarmMetrics::SwarmMetrics(double bucketLength, unsigned int bucketCount) {
+  this->bucketLength = bucketLength > 0 ? bucketLength : 60;
+  this->bucketCount = max(1u, bucketCount);
+}
+
+SwarmMetrics::Rover& SwarmMetrics::rover(const string& name, double time) {
+  if (!started) {
+    started = true;
+    start = time;
+  }
+  now = max(now, time);
+
+  map<string, Rover>::iterator found = rovers.find(name);
+  if (found == rovers.end()) {
+    found = rovers.insert(make_pair(name, Rover())).first;
+    found->second.countedTo = time;
+  }
+  return found->second;
+}
+
+long SwarmMetrics::bucketIndex(double time) const {
+  return (long)floor((time - start) / bucketLength);
+}
+
+RoverCounts& SwarmMetrics::bucket(Rover& rover, long index) {
+  // Events arrive in time order, so only the newest bucket can be the one
+  if (rover.buckets.empty() || rover.buckets.back().index < index) {
+    rover.buckets.push_back(Bucket());
+    rover.buckets.back().index = index;
+    while (rover.buckets.size() > bucketCount) rover.buckets.pop_front();
+  }
+  return rover.buckets.back().counts;
+}
+
+void SwarmMetrics::countTime(Rover& rover, double time) {
+  // Split the time at the bucket boundaries it crosses
+  while (rover.countedTo < time) {
+    long index = bucketIndex(rover.countedTo);
+    double end = min(start + (index + 1) * bucketLength, time);
+    double span = end - rover.countedTo;
+    if (span <= 0) break;
+
+    RoverCounts& counts = bucket(rover, index);
+    if (!rover.state.empty()) {
+      counts.stateSeconds[rover.state] += span;
+      rover.total.stateSeconds[rover.state] += span;
+    }
+    if (rover.obstacle) {
+      counts.obstacleSeconds += span;
+      rover.total.obstacleSeconds += span;
+    }
+    rover.countedTo = end;
+  }
+}
+
+void SwarmMetrics::stateChanged(const string& name, const string& state, double time) {
+  Rover& r = rover(name, time);
+  countTime(r, time);
+  if (state == r.state) return;
+
+  RoverCounts& counts = bucket(r, bucketIndex(time));
+  if (r.state == "SEARCHING" && state == "TARGET_PICKEDUP") {
+    counts.pickups++;
+    r.total.pickups++;
+  }
+  else if (r.state == "DROP_OFF" && state == "SEARCHING") {
+    counts.dropoffs++;
+    r.total.dropoffs++;
+  }
+  r.state = state;
+}
+
+void SwarmMetrics::obstacleReported(const string& name, bool obstacle, double time) {
+  Rover& r = rover(name, time);
+  countTime(r, time);
+
+  if (obstacle && !r.obstacle) {
+    bucket(r, bucketIndex(time)).obstacleCalls++;
+    r.total.obstacleCalls++;
+  }
+  r.obstacle = obstacle;
+}
+
+void SwarmMetrics::positionReported(const string& name, float x, float y, double time) {
+  Rover& r = rover(name, time);
+  countTime(r, time);
+
+  if (r.hasPosition) {
+    float step = hypot(x - r.x, y - r.y);
+    if (step <= maxPositionStep) {
+      bucket(r, bucketIndex(time)).distance += step;
+      r.total.distance += step;
+    }
+  }
+  r.hasPosition = true;
+  r.x = x;
+  r.y = y;
+}
+
+void SwarmMetrics::scoreReported(int score, double time) {
+  hasScore = true;
+  this->score = score;
+  now = max(now, time);
+}
+
+void SwarmMetrics::advance(double time) {
+  now = max(now, time);
+  for (map<string, Rover>::iterator i = rovers.begin(); i != rovers.end(); i++) {
+    countTime(i->second, time);
+  }
+}
+
+// Label values may not hold unescaped quotes, backslashes or new lines
+static string escapeLabel(const string& value) {
+  string escaped;
+  for (size_t i = 0; i < value.size(); i++) {
+    if (value[i] == '\\') escaped += "\\\\";
+    else if (value[i] == '"') escaped += "\\\"";
+    else if (value[i] == '\n') escaped += "\\n";
+    else escaped += value[i];
+  }
+  return escaped;
+}
+
+static string joinLabels(const string& labels, const string& more) {
+  if (labels.empty()) return more;
+  if (more.empty()) return labels;
+  return labels + "," + more;
+}
+
+static void family(ostringstream& out, const char* name, const char* type, const char* help) {
+  out << "# HELP " << name << " " << help << "\n";
+  out << "# TYPE " << name << " " << type << "\n";
+}
+
+static void sample(ostringstream& out, const char* name, const string& labels, double value) {
+  char number[32];
+  snprintf(number, sizeof(number), "%.6g", value);
+  out << name;
+  if (!labels.empty()) out << "{" << labels << "}";
+  out << " " << number << "\n";
+}
+
+string SwarmMetrics::exposition(const string& labels) const {
+  ostringstream out;
+
+  double elapsed = started ? now - start : 0;
+  unsigned int dropoffs = 0;
+  for (map<string, Rover>::const_iterator i = rovers.begin(); i != rovers.end(); i++) {
+    dropoffs += i->second.total.dropoffs;
+  }
+
+  family(out, "swarm_elapsed_seconds", "gauge", "Time since the first rover event.");
+  sample(out, "swarm_elapsed_seconds", labels, elapsed);
+
+  family(out, "swarm_rovers", "gauge", "Rovers heard from.");
+  sample(out, "swarm_rovers", labels, rovers.size());
+
+  if (hasScore) {
+    family(out, "swarm_score", "gauge", "Cubes in the collection zone, from /collectionZone/score.");
+    sample(out, "swarm_score", labels, score);
+  }
+
+  // The score counts the cubes that are really in the collection zone, the
+  // drop offs count the attempts
+  if (elapsed > 0 && !rovers.empty()) {
+    family(out, "swarm_cubes_per_minute_per_rover", "gauge", "Cubes collected per minute per rover over the run.");
+    sample(out, "swarm_cubes_per_minute_per_rover", labels,
+           (hasScore ? score : dropoffs) / (elapsed / 60) / rovers.size());
+  }
+
+  // The per rover totals, then the same counts by time bucket
+  struct Counter {
+    const char* total;
+    const char* bucket;
+    const char* help;
+    double (*value)(const RoverCounts&);
+  };
+  static const Counter counters[] = {
+    {"swarm_pickups_total", "swarm_bucket_pickups", "Cubes picked up.",
+     [](const RoverCounts& c) { return (double)c.pickups; }},
+    {"swarm_dropoffs_total", "swarm_bucket_dropoffs", "Cubes dropped off in the collection zone.",
+     [](const RoverCounts& c) { return (double)c.dropoffs; }},
+    {"swarm_obstacle_calls_total", "swarm_bucket_obstacle_calls", "Obstacles reported after a clear report.",
+     [](const RoverCounts& c) { return (double)c.obstacleCalls; }},
+    {"swarm_obstacle_seconds_total", "swarm_bucket_obstacle_seconds", "Time with an obstacle reported.",
+     [](const RoverCounts& c) { return c.obstacleSeconds; }},
+    {"swarm_distance_meters_total", "swarm_bucket_distance_meters", "Distance travelled.",
+     [](const RoverCounts& c) { return c.distance; }},
+  };
+
+  for (const Counter& counter : counters) {
+    family(out, counter.total, "counter", counter.help);
+    for (map<string, Rover>::const_iterator i = rovers.begin(); i != rovers.end(); i++) {
+      sample(out, counter.total, joinLabels(labels, "rover=\"" + escapeLabel(i->first) + "\""),
+             counter.value(i->second.total));
+    }
+  }
+
+  family(out, "swarm_state_seconds_total", "counter", "Time in each behaviour state.");
+  for (map<string, Rover>::const_iterator i = rovers.begin(); i != rovers.end(); i++) {
+    const map<string, double>& seconds = i->second.total.stateSeconds;
+    for (map<string, double>::const_iterator s = seconds.begin(); s != seconds.end(); s++) {
+      sample(out, "swarm_state_seconds_total",
+             joinLabels(labels, "rover=\"" + escapeLabel(i->first) + "\",state=\"" + escapeLabel(s->first) + "\""),
+             s->second);
+    }
+  }
+
+  for (const Counter& counter : counters) {
+    family(out, counter.bucket, "gauge", counter.help);
+    for (map<string, Rover>::const_iterator i = rovers.begin(); i != rovers.end(); i++) {
+      for (const Bucket& b : i->second.buckets) {
+        char bucketStart[32];
+        snprintf(bucketStart, sizeof(bucketStart), "%.0f", b.index * bucketLength);
+        sample(out, counter.bucket,
+               joinLabels(labels, "rover=\"" + escapeLabel(i->first) + "\",bucket_start=\"" + bucketStart + "\""),
+               counter.value(b.counts));
+      }
+    }
+  }
+
+  family(out, "swarm_bucket_state_seconds", "gauge", "Time in each behaviour state.");
+  for (map<string, Rover>::const_iterator i = rovers.begin(); i != rovers.end(); i++) {
+    for (const Bucket& b : i->second.buckets) {
+      char bucketStart[32];
+      snprintf(bucketStart, sizeof(bucketStart), "%.0f", b.index * bucketLength);
+      const map<string, double>& seconds = b.counts.stateSeconds;
+      for (map<string, double>::const_iterator s = seconds.begin(); s != seconds.end(); s++) {
+        sample(out, "swarm_bucket_state_seconds",
+               joinLabels(labels, "rover=\"" + escapeLabel(i->first) + "\",bucket_start=\"" + bucketStart +
+                          "\",state=\"" + escapeLabel(s->first) + "\""),
+               s->second);
+      }
+    }
+  }
+
+  return out.str();
+}
@@ -0,0 +1,83 @@
+#ifndef SwarmMetrics_h
+#define SwarmMetrics_h
+
+#include <deque>
+#include <map>
+#include <string>
+
+// What one rover did in a span of time
+struct RoverCounts {
+  unsigned int pickups = 0; // SEARCHING to TARGET_PICKEDUP
+  unsigned int dropoffs = 0; // DROP_OFF to SEARCHING
+  unsigned int obstacleCalls = 0; // obstacle reports after a clear one
+  double obstacleSeconds = 0; // time with an obstacle reported
+  double distance = 0; // meters travelled
+  std::map<std::string, double> stateSeconds; // time in each behaviour state
+};
+
+// Joins the events of every rover into per rover counters: pick ups and drop
+// offs from the behaviour state changes, time spent in each state and with
+// an obstacle reported, and distance travelled. The counters are kept in
+// total and in time buckets of bucketLength seconds, the last bucketCount of
+// which are kept.
+//
+// exposition() writes them out in the Prometheus text format, so a scraper,
+// e.g. the node exporter textfile collector, can follow the throughput
+// across runs and code versions. labels is added to every series, e.g.
+// version="1.2",trial="3".
+//
+// Times are in seconds, and must not go backwards.
+class SwarmMetrics {
+
+public:
+
+  SwarmMetrics(double bucketLength = 60, unsigned int bucketCount = 30);
+
+  void stateChanged(const std::string& rover, const std::string& state, double time);
+  void obstacleReported(const std::string& rover, bool obstacle, double time);
+  void positionReported(const std::string& rover, float x, float y, double time);
+  void scoreReported(int score, double time);
+
+  // Counts the time in each state and with an obstacle up to time
+  void advance(double time);
+
+  bool hasRover(const std::string& rover) const { return rovers.count(rover) > 0; }
+
+  std::string exposition(const std::string& labels) const;
+
+private:
+
+  struct Bucket {
+    long index; // starts at start + index * bucketLength
+    RoverCounts counts;
+  };
+
+  struct Rover {
+    std::string state;
+    bool obstacle = false;
+    double countedTo = 0; // state and obstacle time is counted up to here
+    bool hasPosition = false;
+    float x = 0, y = 0;
+    RoverCounts total;
+    std::deque<Bucket> buckets;
+  };
+
+  Rover& rover(const std::string& name, double time);
+  long bucketIndex(double time) const;
+  RoverCounts& bucket(Rover& rover, long index);
+  void countTime(Rover& rover, double time);
+
+  double bucketLength;
+  unsigned int bucketCount;
+
+  bool started = false;
+  double start = 0;
+  double now = 0;
+
+  bool hasScore = false;
+  int score = 0;
+
+  std::map<std::string, Rover> rovers;
+};
+
+#endif // SwarmMetrics_h
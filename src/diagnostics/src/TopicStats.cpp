@@ -0,0 +1,82 @@
+#include "TopicStats.h"
+
+#include <cmath> // For sqrt
+
+using namespace std;
+
+TopicStats::TopicStats(string topic) {
+  this->topic = topic;
+  periodStart = -1;
+  messages = 0;
+  prevReceiptTime = -1;
+  intervals = 0;
+  intervalSum = 0;
+  intervalSquaredSum = 0;
+  latencySum = 0;
+  latencyMax = 0;
+  latencyHistogram.assign(latencyBucketBounds().size() + 1, 0);
+}
+
+const vector<float>& TopicStats::latencyBucketBounds() {
+  static const vector<float> bounds = {0.001, 0.002, 0.005, 0.01, 0.02, 0.05, 0.1, 0.2, 0.5, 1.0};
+  return bounds;
+}
+
+void TopicStats::messageReceived(double receiptTime, double stampTime) {
+  if (periodStart < 0) periodStart = receiptTime;
+  messages++;
+
+  if (prevReceiptTime >= 0) {
+    double interval = receiptTime - prevReceiptTime;
+    intervals++;
+    intervalSum += interval;
+    intervalSquaredSum += interval*interval;
+  }
+  prevReceiptTime = receiptTime;
+
+  // Clocks of different machines are not perfectly in sync, so the latency
+  // can come out slightly negative
+  double latency = receiptTime - stampTime;
+  if (latency < 0) latency = 0;
+
+  latencySum += latency;
+  if (latency > latencyMax) latencyMax = latency;
+
+  const vector<float>& bounds = latencyBucketBounds();
+  size_t bucket = 0;
+  while (bucket < bounds.size() && latency > bounds[bucket]) bucket++;
+  latencyHistogram[bucket]++;
+}
+
+TopicStatsSummary TopicStats::summarize(double now) {
+  TopicStatsSummary summary;
+  summary.topic = topic;
+  summary.messages = messages;
+  summary.rate = 0;
+  summary.jitter = 0;
+  summary.latencyMean = 0;
+  summary.latencyMax = latencyMax;
+  summary.latencyHistogram = latencyHistogram;
+
+  if (periodStart >= 0 && now > periodStart) summary.rate = messages / (now - periodStart);
+
+  if (intervals > 0) {
+    double mean = intervalSum / intervals;
+    double variance = intervalSquaredSum / intervals - mean*mean;
+    summary.jitter = variance > 0 ? sqrt(variance) : 0;
+  }
+
+  if (messages > 0) summary.latencyMean = latencySum / messages;
+
+  // Start the next period
+  periodStart = now;
+  messages = 0;
+  intervals = 0;
+  intervalSum = 0;
+  intervalSquaredSum = 0;
+  latencySum = 0;
+  latencyMax = 0;
+  latencyHistogram.assign(latencyBucketBounds().size() + 1, 0);
+
+  return summary;
+}
@@ -0,0 +1,54 @@
+#ifndef TopicStats_h
+#define TopicStats_h
+
+#include <string>
+#include <vector>
+
+// Message rate, inter-arrival jitter and latency of one subscribed topic
+// since the last call to summarize().
+struct TopicStatsSummary {
+  std::string topic;
+  unsigned int messages;
+  float rate; // messages per second
+  float jitter; // standard deviation of the inter-arrival time in seconds
+  float latencyMean; // header stamp to receipt, in seconds
+  float latencyMax;
+  std::vector<unsigned int> latencyHistogram; // counts per TopicStats::latencyBucketBounds() bucket
+};
+
+// Collects the statistics for one topic. Times are in seconds.
+class TopicStats {
+
+public:
+
+  TopicStats(std::string topic);
+
+  void messageReceived(double receiptTime, double stampTime);
+
+  // Returns the statistics since the last call and starts a new period
+  TopicStatsSummary summarize(double now);
+
+  // Upper bounds of the latency histogram buckets in seconds. The last
+  // bucket counts everything above the last bound.
+  static const std::vector<float>& latencyBucketBounds();
+
+private:
+
+  std::string topic;
+
+  double periodStart;
+  unsigned int messages;
+
+  // Arrival of the previous message, carried over between periods so the
+  // first message of a period still has an inter-arrival time
+  double prevReceiptTime;
+  unsigned int intervals;
+  double intervalSum;
+  double intervalSquaredSum;
+
+  double latencySum;
+  double latencyMax;
+  std::vector<unsigned int> latencyHistogram;
+};
+
+#endif // TopicStats_h
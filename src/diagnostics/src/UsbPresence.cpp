@@ -0,0 +1,97 @@
+#include "UsbPresence.h"
+
+#include <libudev.h>
+#include <poll.h> // For checking the monitor without blocking
+#include <cstdlib> // For strtoul
+#include <cstring> // For strcmp
+#include <stdexcept> // For runtime_error
+
+using namespace std;
+
+UsbPresence::UsbPresence() {
+}
+
+UsbPresence::~UsbPresence() {
+  if (monitor) udev_monitor_unref(monitor);
+  if (context) udev_unref(context);
+}
+
+void UsbPresence::start() {
+  if (monitor) return;
+
+  context = udev_new();
+  if (!context) throw runtime_error("UsbPresence::start(): unable to create a udev context");
+
+  // Listen before enumerating so a device plugged in between the two is not
+  // missed. A device seen twice has the same sysfs path and is counted once.
+  monitor = udev_monitor_new_from_netlink(context, "udev");
+  if (!monitor
+      || udev_monitor_filter_add_match_subsystem_devtype(monitor, "usb", "usb_device") < 0
+      || udev_monitor_enable_receiving(monitor) < 0) {
+    if (monitor) udev_monitor_unref(monitor);
+    monitor = NULL;
+    udev_unref(context);
+    context = NULL;
+    throw runtime_error("UsbPresence::start(): unable to monitor udev for USB hotplug events");
+  }
+
+  udev_enumerate* enumerate = udev_enumerate_new(context);
+  udev_enumerate_add_match_subsystem(enumerate, "usb");
+  udev_enumerate_add_match_property(enumerate, "DEVTYPE", "usb_device");
+  udev_enumerate_scan_devices(enumerate);
+
+  udev_list_entry* entry;
+  udev_list_entry_foreach(entry, udev_enumerate_get_list_entry(enumerate)) {
+    udev_device* device = udev_device_new_from_syspath(context, udev_list_entry_get_name(entry));
+    if (!device) continue;
+    addDevice(device);
+    udev_device_unref(device);
+  }
+  udev_enumerate_unref(enumerate);
+}
+
+void UsbPresence::update() {
+  if (!monitor) return;
+
+  pollfd fd;
+  fd.fd = udev_monitor_get_fd(monitor);
+  fd.events = POLLIN;
+
+  while (poll(&fd, 1, 0) > 0 && (fd.revents & POLLIN)) {
+    udev_device* device = udev_monitor_receive_device(monitor);
+    if (!device) break;
+
+    const char* action = udev_device_get_action(device);
+    if (action && strcmp(action, "remove") == 0) removeDevice(device);
+    else if (action && strcmp(action, "add") == 0) addDevice(device);
+
+    udev_device_unref(device);
+  }
+}
+
+bool UsbPresence::deviceExists(uint16_t vendorID, uint16_t productID) {
+  return present.count(key(vendorID, productID)) > 0;
+}
+
+void UsbPresence::addDevice(udev_device* device) {
+  const char* path = udev_device_get_syspath(device);
+  const char* vendor = udev_device_get_sysattr_value(device, "idVendor");
+  const char* product = udev_device_get_sysattr_value(device, "idProduct");
+  if (!path || !vendor || !product || devices.count(path)) return;
+
+  uint32_t id = key(strtoul(vendor, NULL, 16), strtoul(product, NULL, 16));
+  devices[path] = id;
+  present[id]++;
+}
+
+void UsbPresence::removeDevice(udev_device* device) {
+  const char* path = udev_device_get_syspath(device);
+  if (!path) return;
+
+  unordered_map<string, uint32_t>::iterator found = devices.find(path);
+  if (found == devices.end()) return;
+
+  unordered_map<uint32_t, int>::iterator count = present.find(found->second);
+  if (count != present.end() && --count->second <= 0) present.erase(count);
+  devices.erase(found);
+}
@@ -0,0 +1,52 @@
+#ifndef UsbPresence_h
+#define UsbPresence_h
+
+#include <stdint.h> // uint16_t, uint32_t
+#include <string>
+#include <unordered_map>
+
+struct udev;
+struct udev_monitor;
+struct udev_device;
+
+// Keeps a table of the USB devices that are plugged in, by vendor and
+// product ID. The table is filled by enumerating the devices once and then
+// kept current from udev hotplug events, so a presence check does not have
+// to walk the USB busses.
+class UsbPresence {
+
+public:
+
+  UsbPresence();
+  ~UsbPresence();
+
+  // Connects to udev and enumerates the devices already plugged in.
+  // Throws runtime_error if udev can not be used.
+  void start();
+  bool isStarted() { return monitor != NULL; }
+
+  // Applies the hotplug events received since the last call. Does not
+  // block, call it before a round of deviceExists checks.
+  void update();
+
+  bool deviceExists(uint16_t vendorID, uint16_t productID);
+
+private:
+
+  void addDevice(udev_device* device);
+  void removeDevice(udev_device* device);
+
+  static uint32_t key(uint16_t vendorID, uint16_t productID) { return (uint32_t)vendorID << 16 | productID; }
+
+  udev* context = NULL;
+  udev_monitor* monitor = NULL;
+
+  // The key of each device by sysfs path, since a removed device's
+  // descriptor can no longer be read
+  std::unordered_map<std::string, uint32_t> devices;
+
+  // Number of devices plugged in with each key
+  std::unordered_map<uint32_t, int> present;
+};
+
+#endif // UsbPresence_h
@@ -12,6 +12,8 @@
 #include <cstring> // For memset
 #include <arpa/inet.h> // For IPPROTO_IP
 #include <ifaddrs.h> // For network interface struct
+#include <cerrno> // For errno
+#include <cstdlib> // For strtoull
 
 using namespace std;
 
@@ -19,6 +21,12 @@ WirelessDiags::WirelessDiags() {
   prev_total_bytes = 0;
   gettimeofday(&prev_time,NULL); // Set the prevtime to be the time this object was created using the default time zone
 
+  for (int i = 0; i < NUM_COUNTERS; i++) counterFds[i] = -1;
+}
+
+WirelessDiags::~WirelessDiags() {
+  closeCounters();
+  if (ioctlSocket >= 0) close(ioctlSocket);
 }
 
 // Sets the diagnostics to use the first wireless interfact found
@@ -30,7 +38,14 @@ string WirelessDiags::setInterface() {
 
   interfaceName = name;
 
+  openCounters();
+
+  if (ioctlSocket < 0) ioctlSocket = socket(AF_INET, SOCK_DGRAM, 0);
+  if (ioctlSocket < 0) throw runtime_error("Unable to open ioctl socket for " + name + ": " + string(strerror(errno)));
+
   calcBitRate(); // Initialize the previous byte counts
+  prev_errors = readCounter(RX_ERRORS) + readCounter(TX_ERRORS);
+  prev_dropped = readCounter(RX_DROPPED) + readCounter(TX_DROPPED);
 
   return name;
 }
@@ -100,57 +115,62 @@ bool WirelessDiags::isWireless(const char* name) {
   return wireless;
 }
 
-// Helper function to read the number of bytes sent and received over time to calculate
-// the current bitrate
-float WirelessDiags::calcBitRate() {
+// Opens the statistics files once. These files are pointers to memory
+// locations and are not on disk, so rereading them with pread returns the
+// current value without reopening them.
+void WirelessDiags::openCounters() {
+  static const char* counterNames[NUM_COUNTERS] = {
+    "rx_bytes", "tx_bytes", "rx_errors", "tx_errors", "rx_dropped", "tx_dropped"
+  };
+
+  closeCounters();
+
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    string path = "/sys/class/net/"+interfaceName+"/statistics/"+counterNames[i];
+    counterFds[i] = open(path.c_str(), O_RDONLY);
+    if (counterFds[i] < 0) {
+      string errorMsg = "WirelessDiags::openCounters(): unable to open " + path + ": " + string(strerror(errno));
+      closeCounters();
+      throw runtime_error(errorMsg);
+    }
+  }
+}
 
-  // Path to the linux provided stats. These files are pointers to memory locations
-  // and are not on disk.
-  string receive_bytes_stat_path = "/sys/class/net/"+interfaceName+"/statistics/rx_bytes";
-  string transmit_bytes_stat_path = "/sys/class/net/"+interfaceName+"/statistics/tx_bytes";
+void WirelessDiags::closeCounters() {
+  for (int i = 0; i < NUM_COUNTERS; i++) {
+    if (counterFds[i] >= 0) close(counterFds[i]);
+    counterFds[i] = -1;
+  }
+}
 
-  // Open, read and close the bytes received and bytes sent file pointers. 
-  ifstream receive_bytes_stat, transmit_bytes_stat;
+// Reads one counter as a 64 bit value. The byte counters pass 2^31 after
+// 2 GB of traffic. Returns 0 if the counter could not be read.
+uint64_t WirelessDiags::readCounter(Counter counter) {
+  if (counterFds[counter] < 0) return 0;
 
-  // Throw an exception if there was a problem
-  receive_bytes_stat.exceptions( std::ifstream::failbit | std::ifstream::badbit );
-  transmit_bytes_stat.exceptions( std::ifstream::failbit | std::ifstream::badbit );
-  
-  // Open the files
-  transmit_bytes_stat.open(transmit_bytes_stat_path.c_str());
-  receive_bytes_stat.open(receive_bytes_stat_path.c_str());
-  
-  string receive_stat;
-  getline(receive_bytes_stat,receive_stat);
-  receive_bytes_stat.close();
-   
-  string transmit_stat;
-  getline(transmit_bytes_stat,transmit_stat);
-  transmit_bytes_stat.close();
+  char buffer[32];
+  ssize_t length = pread(counterFds[counter], buffer, sizeof(buffer) - 1, 0);
+  if (length <= 0) return 0;
+  buffer[length] = '\0';
+
+  return strtoull(buffer, NULL, 10);
+}
+
+// Helper function to read the number of bytes sent and received over time to calculate
+// the current bitrate
+float WirelessDiags::calcBitRate() {
 
   // Remember the total bytes transmitted so we can take the difference 
   // between recordings at each time interval.
   prev_total_bytes = total_bytes;
-   
-  // Convert string to int
-  string::size_type sz;   // alias of size_t
-  long int rx_bytes = 0;
-  long int tx_bytes = 0;
-  if (!receive_stat.empty())
-  {
-    rx_bytes = stoi(receive_stat,&sz);
-  }
-  if (!transmit_stat.empty())
-  {
-    tx_bytes = stoi(transmit_stat,&sz);
-  }
 
   // Get the total bytes transmitted and recevied. This is the total bandwidth used.
-  total_bytes = rx_bytes + tx_bytes;
+  total_bytes = readCounter(RX_BYTES) + readCounter(TX_BYTES);
 
   // If we haven't set the value of the previous reading skip. This will never be zero since it is the number of
   // bytes sent and received since boot. 
-  if (prev_total_bytes == 0) return 0;
+  // The counters restart when the interface is reset.
+  if (prev_total_bytes == 0 || total_bytes < prev_total_bytes) return 0;
    
   // Get the bytes transmitted and received as a function of time.
   // This assumes the function is called using the sensor check function.
@@ -170,7 +190,7 @@ float WirelessDiags::calcBitRate() {
   // time it is called
   prev_time = now; 
   
-  float byte_rate = byte_rate = (total_bytes - prev_total_bytes)*1.0f/elapsedTime;
+  float byte_rate = (total_bytes - prev_total_bytes)*1.0f/elapsedTime;
    
   // Rate in B/s
   return byte_rate;
@@ -189,15 +209,12 @@ WirelessInfo WirelessDiags::getInfo(){
   // Populate the interface name in the request object
   strcpy(req.ifr_name, interfaceName.c_str());
 
-  // Declare an iw_statistics object to store the IOCTL results in
-  iw_statistics *stats;
+  // Reuse the socket opened by setInterface() to talk to the kernel
+  int sockfd = ioctlSocket;
 
-  // Create socket through which to talk to the kernel 
-  int sockfd = socket(AF_INET, SOCK_DGRAM, 0);
-
-  // Allocate space for the iw_statistics object, point to it from the request,
-  // and store the length of the object in the request.
-  req.u.data.pointer = (iw_statistics *)malloc(sizeof(iw_statistics));
+  // Point the request at the iw_statistics object the results are stored
+  // in, and store the length of the object in the request.
+  req.u.data.pointer = &wirelessStats;
   req.u.data.length = sizeof(iw_statistics);
 
   // Use IOCTL to request the wireless stats. If -1 there was an error.
@@ -208,11 +225,11 @@ WirelessInfo WirelessDiags::getInfo(){
     throw runtime_error(errorMsg);
     return sigInfo;
   }
-  else if(((iw_statistics *)req.u.data.pointer)->qual.updated & IW_QUAL_DBM){
+  else if(wirelessStats.qual.updated & IW_QUAL_DBM){
     // Opened the socket so read the data
-    sigInfo.level = ((iw_statistics *)req.u.data.pointer)->qual.level - 256;
-    sigInfo.quality=((iw_statistics *)req.u.data.pointer)->qual.qual;
-    sigInfo.noise=((iw_statistics *)req.u.data.pointer)->qual.noise;
+    sigInfo.level = wirelessStats.qual.level - 256;
+    sigInfo.quality = wirelessStats.qual.qual;
+    sigInfo.noise = wirelessStats.qual.noise;
   }
 
   //SIOCGIWESSID for ssid
@@ -264,10 +281,15 @@ WirelessInfo WirelessDiags::getInfo(){
     }
   }
 
-  // We are done so clean up
-  close(sockfd);
-
   sigInfo.bandwidthUsed = calcBitRate();  
 
+  // Report the errors and drops since the last sample
+  uint64_t errors = readCounter(RX_ERRORS) + readCounter(TX_ERRORS);
+  uint64_t dropped = readCounter(RX_DROPPED) + readCounter(TX_DROPPED);
+  sigInfo.errors = errors >= prev_errors ? errors - prev_errors : 0;
+  sigInfo.dropped = dropped >= prev_dropped ? dropped - prev_dropped : 0;
+  prev_errors = errors;
+  prev_dropped = dropped;
+
   return sigInfo;
 }
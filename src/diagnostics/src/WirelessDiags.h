@@ -3,6 +3,8 @@
 
 #include <string> // wireless device interface name
 #include <sys/time.h> // gettimeofday and timeval
+#include <stdint.h> // uint64_t
+#include <linux/wireless.h> // iw_statistics
 
 //struct to hold collected information
 struct WirelessInfo {
@@ -13,6 +15,10 @@ struct WirelessInfo {
   int quality;
   int noise;
   float bandwidthUsed;
+
+  // Errors and dropped packets since the previous sample
+  uint64_t errors;
+  uint64_t dropped;
 };
 
 class WirelessDiags {
@@ -20,16 +26,34 @@ class WirelessDiags {
 public:
 
   WirelessDiags();
+  ~WirelessDiags();
   
   // Sets the name of the interface
   // about which to provide information
   // returns the name of the wireless interface
   std::string setInterface();
 
+  // Samples link quality, bandwidth used and error counters in one pass.
+  // The statistics files and the ioctl socket stay open between calls.
   WirelessInfo getInfo();
   
 private:
 
+  // The interface counters read from /sys/class/net/<interface>/statistics
+  enum Counter {
+    RX_BYTES = 0,
+    TX_BYTES,
+    RX_ERRORS,
+    TX_ERRORS,
+    RX_DROPPED,
+    TX_DROPPED,
+    NUM_COUNTERS
+  };
+
+  void openCounters();
+  void closeCounters();
+  uint64_t readCounter(Counter counter);
+
 
   // We don't want to try and get info about a network interface that doesn't exist
   bool isInterfaceUp(std::string name);
@@ -42,12 +66,23 @@ private:
 
   std::string interfaceName;
 
+  // File descriptors of the statistics files, -1 if not open
+  int counterFds[NUM_COUNTERS];
+
+  // Socket for the wireless extension ioctls, -1 if not open
+  int ioctlSocket = -1;
+  iw_statistics wirelessStats;
+
   // State needed to keep track of
   // the number of bytes sent between calcBitRate calls
 
-  long int prev_total_bytes = 0;
-  long int total_bytes = 0;
+  uint64_t prev_total_bytes = 0;
+  uint64_t total_bytes = 0;
   struct timeval prev_time; // The wall time of the last call to calcBitRate;
+
+  // Error and drop totals at the previous sample
+  uint64_t prev_errors = 0;
+  uint64_t prev_dropped = 0;
 };
 
 #endif // WirelessDiags_h
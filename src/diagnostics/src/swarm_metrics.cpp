@@ -0,0 +1,146 @@
+// Driver for the swarm metrics node. Collects the behaviour state events,
+// obstacle reports and beacon positions of every rover and the collection
+// zone score into SwarmMetrics, and writes them to ~file in the Prometheus
+// text format every ~write_interval seconds, see SwarmMetrics.h.
+//
+// Rovers are found from their beacons on /roverBeacons. The file is
+// replaced atomically, so it can be read by the node exporter textfile
+// collector or copied at the end of a run at any time.
+
+#include "SwarmMetrics.h"
+
+#include <ros/ros.h>
+#include <std_msgs/String.h>
+#include <std_msgs/UInt8.h>
+#include "swarmie_msgs/RoverBeacon.h"
+#include "swarmie_msgs/BehaviourState.h"
+
+#include <cstdio> // For rename
+#include <cstdlib> // For atoi
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+SwarmMetrics* metrics;
+string labels;
+string metricsFile = "swarm_metrics.prom";
+
+ros::NodeHandle* nodeHandle;
+map<string, ros::Subscriber> stateSubscribers;
+map<string, ros::Subscriber> obstacleSubscribers;
+
+// Turns "version=1.2,trial=3" into the label set version="1.2",trial="3"
+string formatLabels(const string& spec) {
+  ostringstream formatted;
+  stringstream pairs(spec);
+  string pair;
+  while (getline(pairs, pair, ',')) {
+    size_t equals = pair.find('=');
+    if (equals == string::npos || equals == 0) continue;
+
+    string value;
+    for (size_t i = equals + 1; i < pair.size(); i++) {
+      if (pair[i] == '\\' || pair[i] == '"') value += '\\';
+      value += pair[i];
+    }
+
+    if (formatted.tellp() > 0) formatted << ",";
+    formatted << pair.substr(0, equals) << "=\"" << value << "\"";
+  }
+  return formatted.str();
+}
+
+// Only the process state is counted, logic state and controller changes
+// leave it as it is. Counted at receipt like the other inputs, since
+// SwarmMetrics takes its times in order and the latched first message can
+// be much older.
+void behaviourStateHandler(const string& rover, const swarmie_msgs::BehaviourState::ConstPtr& message) {
+  const char* state;
+  switch (message->process_state) {
+  case swarmie_msgs::BehaviourState::PROCESS_SEARCHING: state = "SEARCHING"; break;
+  case swarmie_msgs::BehaviourState::PROCESS_TARGET_PICKEDUP: state = "TARGET_PICKEDUP"; break;
+  case swarmie_msgs::BehaviourState::PROCESS_DROP_OFF: state = "DROP_OFF"; break;
+  case swarmie_msgs::BehaviourState::PROCESS_MANUAL: state = "MANUAL"; break;
+  default: state = "UNKNOWN"; break;
+  }
+  metrics->stateChanged(rover, state, ros::Time::now().toSec());
+}
+
+// 0 for no obstacle, 1 for right side obstacle, and 2 for left side obstacle
+void obstacleHandler(const string& rover, const std_msgs::UInt8::ConstPtr& message) {
+  metrics->obstacleReported(rover, message->data != 0, ros::Time::now().toSec());
+}
+
+void roverBeaconHandler(const swarmie_msgs::RoverBeacon::ConstPtr& message) {
+  const string& rover = message->rover;
+  if (!stateSubscribers.count(rover)) {
+    ROS_INFO("Collecting the metrics of %s", rover.c_str());
+    stateSubscribers[rover] = nodeHandle->subscribe<swarmie_msgs::BehaviourState>(
+      "/" + rover + "/behaviour/state", 20, boost::bind(&behaviourStateHandler, rover, _1));
+    obstacleSubscribers[rover] = nodeHandle->subscribe<std_msgs::UInt8>(
+      "/" + rover + "/obstacle", 10, boost::bind(&obstacleHandler, rover, _1));
+  }
+
+  metrics->positionReported(rover, message->x, message->y, ros::Time::now().toSec());
+}
+
+void scoreHandler(const std_msgs::String::ConstPtr& message) {
+  metrics->scoreReported(atoi(message->data.c_str()), ros::Time::now().toSec());
+}
+
+void writeTimerEventHandler(const ros::TimerEvent& event) {
+  metrics->advance(ros::Time::now().toSec());
+
+  // Written next to the file and moved over it so a reader never sees half
+  // of it
+  string temporary = metricsFile + ".tmp";
+  {
+    ofstream out(temporary.c_str());
+    out << metrics->exposition(labels);
+    if (!out) {
+      ROS_WARN_THROTTLE(60, "Could not write the swarm metrics to %s", temporary.c_str());
+      return;
+    }
+  }
+
+  if (rename(temporary.c_str(), metricsFile.c_str()) != 0) {
+    ROS_WARN_THROTTLE(60, "Could not replace the swarm metrics file %s", metricsFile.c_str());
+  }
+}
+
+int main(int argc, char** argv) {
+  ros::init(argc, argv, "swarm_metrics");
+  ros::NodeHandle nh;
+  ros::NodeHandle privateNH("~");
+  nodeHandle = &nh;
+
+  double bucketLength = 60;
+  int bucketCount = 30;
+  double writeInterval = 5;
+  string labelSpec;
+  privateNH.param("file", metricsFile, metricsFile);
+  privateNH.param("bucket_length", bucketLength, bucketLength);
+  privateNH.param("buckets", bucketCount, bucketCount);
+  privateNH.param("write_interval", writeInterval, writeInterval);
+  privateNH.param("labels", labelSpec, labelSpec);
+  labels = formatLabels(labelSpec);
+
+  metrics = new SwarmMetrics(bucketLength, bucketCount > 0 ? bucketCount : 1);
+
+  ros::Subscriber roverBeaconSubscriber = nh.subscribe("/roverBeacons", 20, roverBeaconHandler);
+  ros::Subscriber scoreSubscriber = nh.subscribe("/collectionZone/score", 10, scoreHandler);
+  ros::Timer writeTimer = nh.createTimer(ros::Duration(writeInterval), writeTimerEventHandler);
+
+  ROS_INFO("Writing the swarm metrics to %s every %.1f s", metricsFile.c_str(), writeInterval);
+
+  ros::spin();
+
+  // The last counts, for a run that just ended
+  writeTimerEventHandler(ros::TimerEvent());
+
+  delete metrics;
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,70 @@
+#ifndef CONTACT_EVENT_QUEUE_H
+#define CONTACT_EVENT_QUEUE_H
+
+#include <atomic>
+#include <string>
+
+/**
+ * A change in what a gripper finger is touching, as seen by the finger's
+ * contact sensor.
+ */
+struct ContactEvent {
+  // true when the finger started touching targetName, false when it stopped
+  // touching any target
+  bool touching;
+  std::string targetName;
+};
+
+/**
+ * A fixed size, lock-free queue with a single producer and a single consumer.
+ *
+ * <p>The gazebo transport thread that runs a finger's contact handler is the
+ * producer and the physics thread is the consumer, so neither ever waits on
+ * the other. push() fails instead of blocking when the queue is full.
+ *
+ * @see GripperPlugin
+ */
+class ContactEventQueue {
+
+ public:
+
+  ContactEventQueue() : head(0), tail(0) {}
+
+  // Called only by the producer
+  bool push(bool touching, const std::string& targetName) {
+    unsigned int currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead - tail.load(std::memory_order_acquire) >= SIZE) {
+      return false;
+    }
+
+    ContactEvent& event = events[currentHead % SIZE];
+    event.touching = touching;
+    event.targetName = targetName;
+
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+  }
+
+  // Called only by the consumer
+  bool pop(ContactEvent& event) {
+    unsigned int currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail == head.load(std::memory_order_acquire)) {
+      return false;
+    }
+
+    event = events[currentTail % SIZE];
+
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+  }
+
+ private:
+
+  static const unsigned int SIZE = 64;
+
+  std::atomic<unsigned int> head; // next slot to write, owned by the producer
+  std::atomic<unsigned int> tail; // next slot to read, owned by the consumer
+  ContactEvent events[SIZE];
+};
+
+#endif /* CONTACT_EVENT_QUEUE_H */
@@ -33,7 +33,7 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
 
   attachedTargetModel = NULL;
   dropStaticTarget = false;
-  dropStaticTargetCounter = 0;
+  carriedTargetPlaced = false;
   
   // 1.39626 is approximately equal to 80 degrees
   maxGrippingAngle = 1.39626;
@@ -45,6 +45,8 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   contactThreshold = common::Time(0.0001);
   noContactThreshold = common::Time(0.1);
   fingerNoContactThreshold = common::Time(0.1);
+  rightFingerTouching = false;
+  leftFingerTouching = false;
   prevHandleGraspingTime = model->GetWorld()->GetSimTime();
     
   // Create a ros node
@@ -87,7 +89,7 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
   // INITIALIZE GRIPPER MANAGER - begin
   PIDController::PIDSettings wristPID = loadPIDSettings("wrist");
   PIDController::PIDSettings fingerPID = loadPIDSettings("finger");
-  gripperManager = GripperManager(wristPID, fingerPID);
+  GripperManager gripperManager(wristPID, fingerPID);
   ROS_DEBUG_STREAM_COND(isDebuggingModeActive, "[Gripper Plugin : "
     << model->GetName() << "]\n    initialized the GripperManager:\n"
     << "        wristPID:  Kp=" << wristPID.Kp << ", Ki=" << wristPID.Ki
@@ -98,15 +100,12 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     << ", force max=" << fingerPID.max << ", dt=" << fingerPID.dt);
   // INITIALIZE GRIPPER MANAGER - end
 
-  // Connect the updateWorldEventHandler function to Gazebo;
-  // ConnectWorldUpdateBegin sets our handler to be called at the beginning of
-  // each physics update iteration
-  updateConnection = event::Events::ConnectWorldUpdateBegin(
-    boost::bind(&GripperPlugin::updateWorldEventHandler, this)
-  );
+  // Register with the service that updates every gripper at the beginning
+  // of each physics update iteration
+  GripperService::instance().add(this, wristJoint, leftFingerJoint, rightFingerJoint, gripperManager);
   ROS_DEBUG_STREAM_COND(isDebuggingModeActive, "[Gripper Plugin : "
-    << model->GetName() << "]\n    bind world update function to gazebo:\n"
-    << "        void GripperPlugin::updateWorldEventHandler()");
+    << model->GetName() << "]\n    registered with the gripper service:\n"
+    << "        bool GripperPlugin::updateGrasping()");
 
   // ROS must be initialized in order to set up this plugin's subscribers
   if (!ros::isInitialized()) {
@@ -122,7 +121,7 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     ros::SubscribeOptions::create<std_msgs::Float32>(
       wristTopic, 1,
       boost::bind(&GripperPlugin::setWristAngleHandler, this, _1),
-      ros::VoidPtr(), &rosQueue
+      ros::VoidPtr(), GripperService::instance().rosQueue()
     );
 
   string fingerTopic = loadSubscriptionTopic("fingerTopic");
@@ -130,7 +129,7 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     ros::SubscribeOptions::create<std_msgs::Float32>(
       fingerTopic, 1,
       boost::bind(&GripperPlugin::setFingerAngleHandler, this, _1),
-      ros::VoidPtr(), &rosQueue
+      ros::VoidPtr(), GripperService::instance().rosQueue()
     );
 
   wristAngleSubscriber = rosNode->subscribe(wristSubscriptionOptions);
@@ -141,13 +140,6 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     << "        " << wristTopic << endl << "        " << fingerTopic);
   // SUBSCRIBE TO ROS TOPICS - end
 
-  // spin up the queue helper thread
-  rosQueueThread =
-    std::thread(std::bind(&GripperPlugin::processRosQueue, this));
-  ROS_DEBUG_STREAM_COND(isDebuggingModeActive, "[Gripper Plugin : "
-    << model->GetName() << "]\n    bind queue helper function to private "
-    << "thread:\n        void GripperPlugin::processRosQueue()");
-
   // Create Gazebo node and init
 // Create Gazebo node and init
   gazebo::transport::NodePtr gazeboNode(new gazebo::transport::Node());
@@ -170,57 +162,63 @@ void GripperPlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
 
 /**
  * This function handles updates to the gripper plugin. It is called by the
- * Gazebo physics engine at the start of each update iteration. The subscribers
- * will handle updating the desiredWristAngle and desiredFingerAngle variables.
- * This function will take those updated values and apply them to the joints
- * of the gripper as needed to instigate the desired movements requested by the
- * gripper publishers.
+ * GripperService at the start of each physics update iteration. The
+ * subscribers will handle updating the desiredWristAngle and
+ * desiredFingerAngle variables. This function passes those updated values
+ * back to the service, which applies them to the joints of the gripper as
+ * needed to instigate the desired movements requested by the gripper
+ * publishers.
+ *
+ * @param currentTime  The simulation time of this update.
+ * @param desiredState Set to the angles the joints should move to.
+ * @return false if the gripper is not due an update, in which case its
+ *         joints are left alone this step.
  */
-void GripperPlugin::updateWorldEventHandler() {
-  common::Time currentTime = model->GetWorld()->GetSimTime();
+bool GripperPlugin::updateGrasping(const common::Time& currentTime, GripperManager::GripperState& desiredState) {
 
   // only update the gripper plugin once every updatePeriodInSeconds
   if((currentTime - previousUpdateTime).Float() < updatePeriodInSeconds) {
-    return;
+    return false;
   }
 
-  // grasp an object if conditions are met
-  handleGrasping();
+  // The contact handlers only post an event when a finger starts or stops
+  // touching a target, so with nothing touched or grasped there is no
+  // grasping work to do
+  bool contactsChanged = processContactEvents();
 
-  // Moves static models when grasped. Does nothing if the model is non-static
-  updateGraspedStaticTargetPose();
+  if (contactsChanged || isAttached || rightFingerTargetLink || leftFingerTargetLink) {
+    // grasp an object if conditions are met
+    handleGrasping();
 
-  previousUpdateTime = currentTime;
-
-  GripperManager::GripperState currentState;
-  GripperManager::GripperState desiredState;
+    // Moves static models when grasped. Does nothing if the model is non-static
+    updateGraspedStaticTargetPose();
+  } else {
+    // idle time must not count as contact or no contact time
+    prevHandleGraspingTime = currentTime;
+  }
 
-  // get the current gripper state
-  currentState.wristAngle = wristJoint->GetAngle(0).Radian();
-  currentState.leftFingerAngle = leftFingerJoint->GetAngle(0).Radian();
-  currentState.rightFingerAngle = rightFingerJoint->GetAngle(0).Radian();
+  previousUpdateTime = currentTime;
 
-  // get the total angle of both fingers:
+  // Set the desired gripper state:
   // => right finger joint angle is always negative
   // => left finger joint angle is always positive
   // total finger angle = left finger joint angle - (-right finger joint angle)
   // total finger angle is ALWAYS POSITIVE (or zero)
-  float leftFingerAngle = leftFingerJoint->GetAngle(0).Radian();
-  float rightFingerAngle = rightFingerJoint->GetAngle(0).Radian();
-
-  // Set the desired gripper state
   desiredState.leftFingerAngle = desiredFingerAngle.Radian() / 2.0;
   desiredState.rightFingerAngle = -desiredFingerAngle.Radian() / 2.0;
   desiredState.wristAngle = desiredWristAngle.Radian();
-  
-  // Get the forces to apply to the joints from the PID controllers
-  GripperManager::GripperForces commandForces =
-    gripperManager.getForces(desiredState, currentState);
 
-  // Apply the command forces to the joints
-  wristJoint->SetForce(0, commandForces.wristForce);
-  leftFingerJoint->SetForce(0, commandForces.leftFingerForce);
-  rightFingerJoint->SetForce(0, commandForces.rightFingerForce);
+  return true;
+}
+
+/**
+ * Prints the joint angles and the forces the GripperService applied to them
+ * if debugging mode is active, once every debugUpdatePeriodInSeconds.
+ */
+void GripperPlugin::printDebugState(const common::Time& currentTime,
+    const GripperManager::GripperState& currentState,
+    const GripperManager::GripperState& desiredState,
+    const GripperManager::GripperForces& commandForces) {
 
   // If debugging mode is active, print debugging statements
   if((currentTime - previousDebugUpdateTime).Float() >= debugUpdatePeriodInSeconds) {
@@ -291,19 +289,6 @@ void GripperPlugin::setFingerAngleHandler(const std_msgs::Float32ConstPtr& msg)
   }
 }
 
-/**
- * This function is used inside of a custom thread to process the messages
- * being passed from the publishers to the subscribers. It is the interface
- * between ROS and the setWristAngleHandler() and setFingerAngleHandler()
- * functions.
- */
-void GripperPlugin::processRosQueue() {
-  static const double timeout = 0.01;
-  while (rosNode->ok()) {
-    rosQueue.callAvailable(ros::WallDuration(timeout));
-  }
-}
-
 /**
  * This function sets the "isDebuggingModeActive" flag to true or false
  * depending on the <debug> tag for this plugin in the configuration SDF file.
@@ -534,12 +519,18 @@ void GripperPlugin::handleGrasping() {
   // The following conditionals check to see whether we should attach the
   // gripper to a target
 
-  // Add to finger contact timers. These values are reset to zero by the
-  // finger contact handlers whenever a contact with a targets occurs. If these
-  // timers reach the timeout threshold the target may be dropped.
+  // Add to finger contact timers. These values are reset to zero whenever a
+  // finger starts or stops touching a target. Once a finger has not touched
+  // its target for the timeout threshold the target link is released and
+  // the target may be dropped.
   rightFingerNoContactTime += deltaTime;
   leftFingerNoContactTime += deltaTime;
 
+  if (!rightFingerTouching && rightFingerNoContactTime > fingerNoContactThreshold)
+    rightFingerTargetLink = NULL;
+  if (!leftFingerTouching && leftFingerNoContactTime > fingerNoContactThreshold)
+    leftFingerTargetLink = NULL;
+
   // Check whether both fingers are in contact with a target
   if ( rightFingerTargetLink && leftFingerTargetLink )
       
@@ -650,7 +641,8 @@ void GripperPlugin::attach() {
      }
 
     attachedTargetOffset = targetModel->GetWorldPose() - gripperAttachLink->GetWorldPose();
-    
+    carriedTargetPlaced = false;
+
     attachedTargetModel = targetModel;
   }
 
@@ -716,73 +708,81 @@ void GripperPlugin::detach() {
 }
 
 // Contact handlers are triggered by contact with the gripper fingers.
-// Finds the link that the finger is in contact with and
-// sets the class link variable for use by the handleGrasp() function.
-// Set the link pointer to NULL if the finger is not in contact
-// with a target object.
+// They run on gazebo transport threads, so instead of touching the target
+// links they post an event for the physics thread whenever the target the
+// finger is in contact with changes. See processContactEvents().
+void GripperPlugin::rightFingerContactEventHandler(ConstContactsPtr& msg){
+  postFingerContacts(msg, rightFingerContactEvents, rightFingerPostedTargetName);
+}
+
+void GripperPlugin::leftFingerContactEventHandler(ConstContactsPtr& msg){
+  postFingerContacts(msg, leftFingerContactEvents, leftFingerPostedTargetName);
+}
+
+// Finds the target model, if any, that the finger is in contact with.
 // Since the collision involves two objects and we don't know which might
 // be a target object we have to check collision1 and collision2.
-void GripperPlugin::rightFingerContactEventHandler(ConstContactsPtr& msg){
-  if (attaching_mutex.try_lock()){
-    lock_guard<mutex> lock(attaching_mutex, adopt_lock_t());
-    
-    for(unsigned int i=0; i < msg->contact_size(); i++){
-      string name1 = msg->contact(i).collision1();
-      string name2 = msg->contact(i).collision2();
-      
-      // Parse the collision name to find the link name (approporate GetChildLink accerros not available) This is a hacky way around that.
-      string collision1ModelName = name1.substr(0, name1.find("::"));
-      string collision2ModelName = name2.substr(0, name2.find("::"));
-      
-      physics::ModelPtr modelInCollision;
-      
-      if (collision1ModelName.substr(0,2).compare("at")==0) {
-        modelInCollision = model->GetWorld()->GetModel(collision1ModelName);
-        rightFingerTargetLink = modelInCollision->GetLink("link");
-	rightFingerNoContactTime = 0.0f;
-        return;
-      } else if (collision2ModelName.substr(0,2).compare("at")==0) {
-        modelInCollision = model->GetWorld()->GetModel(collision2ModelName);
-        rightFingerTargetLink = modelInCollision->GetLink("link");
-	rightFingerNoContactTime = 0.0f;
-        return;
-      }
+// If the queue is full the event is posted again with the next message.
+void GripperPlugin::postFingerContacts(ConstContactsPtr& msg, ContactEventQueue& events,
+                                       string& postedTargetName){
+  string targetName;
+
+  for(unsigned int i=0; i < msg->contact_size(); i++){
+    string name1 = msg->contact(i).collision1();
+    string name2 = msg->contact(i).collision2();
+
+    // Parse the collision name to find the link name (approporate GetChildLink accerros not available) This is a hacky way around that.
+    string collision1ModelName = name1.substr(0, name1.find("::"));
+    string collision2ModelName = name2.substr(0, name2.find("::"));
+
+    if (collision1ModelName.compare(0, 2, "at")==0) {
+      targetName = collision1ModelName;
+      break;
+    } else if (collision2ModelName.compare(0, 2, "at")==0) {
+      targetName = collision2ModelName;
+      break;
     }
-    
-    if (rightFingerNoContactTime > fingerNoContactThreshold)
-      rightFingerTargetLink = NULL;
   }
+
+  if (targetName == postedTargetName) return;
+
+  if (events.push(!targetName.empty(), targetName))
+    postedTargetName = targetName;
 }
 
-void GripperPlugin::leftFingerContactEventHandler(ConstContactsPtr& msg){
-  if (attaching_mutex.try_lock()){
-    lock_guard<mutex> lock(attaching_mutex, adopt_lock_t());
-    
-    for(unsigned int i=0; i < msg->contact_size(); i++){
-      string name1 = msg->contact(i).collision1();
-      string name2 = msg->contact(i).collision2();
-      physics::ModelPtr modelInCollision;
-      
-      // Parse the collision name to find the link name (approporate GetChildLink accerros not available) This is a hacky way around that.
-      string collision1ModelName = name1.substr(0, name1.find("::"));
-      string collision2ModelName = name2.substr(0, name2.find("::"));
-      
-      if (collision1ModelName.substr(0,2).compare("at")==0) {
-        modelInCollision = model->GetWorld()->GetModel(collision1ModelName);
-        leftFingerTargetLink = modelInCollision->GetLink("link");
-	leftFingerNoContactTime = 0.0f;
-        return;
-      } else if (collision2ModelName.substr(0,2).compare("at")==0) {
-        modelInCollision = model->GetWorld()->GetModel(collision2ModelName);
-        leftFingerTargetLink = modelInCollision->GetLink("link");
-	leftFingerNoContactTime = 0.0f;
-        return;
-      }
-    }
-    
-    if (leftFingerNoContactTime > fingerNoContactThreshold)
-      leftFingerTargetLink = NULL;
+// Applies the contact events posted since the last update to the finger
+// target links. Called from the physics thread.
+// Returns true if there were any events.
+bool GripperPlugin::processContactEvents(){
+  bool received = false;
+  ContactEvent event;
+
+  while (rightFingerContactEvents.pop(event)) {
+    applyContactEvent(event, rightFingerTargetLink, rightFingerTouching, rightFingerNoContactTime);
+    received = true;
   }
+
+  while (leftFingerContactEvents.pop(event)) {
+    applyContactEvent(event, leftFingerTargetLink, leftFingerTouching, leftFingerNoContactTime);
+    received = true;
+  }
+
+  return received;
+}
+
+// Sets the link pointer when a finger touches a target. The link is kept
+// after the finger stops touching it until handleGrasping() decides the
+// contact is really gone.
+void GripperPlugin::applyContactEvent(const ContactEvent& event, physics::LinkPtr& targetLink,
+                                      bool& touching, common::Time& noContactTime){
+  touching = event.touching;
+  noContactTime = 0.0f;
+
+  if (!event.touching) return;
+
+  physics::ModelPtr modelInCollision = model->GetWorld()->GetModel(event.targetName);
+  if (modelInCollision)
+    targetLink = modelInCollision->GetLink("link");
 }
 
 void GripperPlugin::sendInfoLogMessage(string text) {
@@ -809,32 +809,53 @@ void GripperPlugin::updateGraspedStaticTargetPose() {
     // This isn't needed for non-static grasped targets
     if (!attachedTargetModel->IsStatic()) return; 
     
-    attachedTargetModel->SetWorldPose(attachedTargetOffset+gripperAttachLink->GetWorldPose());
+    math::Pose gripperPose = gripperAttachLink->GetWorldPose();
 
     if (dropStaticTarget) {
-      math::Pose p = attachedTargetModel->GetWorldPose();
-      
-      // Modify the position of the target so that its center is half the target height
-      // above the ground. This should make the bottom flush with the ground.
-      // Gazebo provides a convenient helper function for this.
-      p.rot = math::Quaternion(1,0,0,0);
-      attachedTargetModel->SetWorldPose(p,true);
-      attachedTargetModel->PlaceOnNearestEntityBelow();
-            
-      if ( dropStaticTargetCounter++ > 100 )
-      {
-        isAttached = false;
-        attachedTargetModel = NULL;
-        dropStaticTarget = false;
-        dropStaticTargetCounter = 0;
-      }
+      settleDroppedStaticTarget(attachedTargetOffset + gripperPose);
+      return;
     }
+
+    // A static target does not move by itself, so it only has to be moved
+    // when the gripper has. Pose comparison is within a millimetre.
+    if (carriedTargetPlaced && gripperPose == carriedFromGripperPose) return;
+
+    attachedTargetModel->SetWorldPose(attachedTargetOffset + gripperPose);
+    carriedFromGripperPose = gripperPose;
+    carriedTargetPlaced = true;
   }
 }
 
+/**
+ * Puts a dropped static target down where it is released and lets go of it.
+ * The resting pose is found once: the target is levelled at the pose it was
+ * carried at and lowered onto the nearest entity below it with a single ray
+ * query. Call with attaching_mutex held.
+ */
+void GripperPlugin::settleDroppedStaticTarget(math::Pose pose) {
+  // Level the target so its bottom is flush with the ground
+  pose.rot = math::Quaternion(1,0,0,0);
+  attachedTargetModel->SetWorldPose(pose, true);
+  attachedTargetModel->PlaceOnNearestEntityBelow();
+
+  stringstream poseStream;
+  poseStream << attachedTargetModel->GetWorldPose();
+  sendInfoLogMessage("Gripper dropped static model "
+                     + attachedTargetModel->GetName()
+                     + ". Target end pose: " + poseStream.str());
+
+  isAttached = false;
+  attachedTargetModel = NULL;
+  dropStaticTarget = false;
+  carriedTargetPlaced = false;
+  contactTime = common::Time(0.0);
+}
 
 GripperPlugin::~GripperPlugin() {
-  
+
+  // Stop being updated before the joints and subscribers go away
+  GripperService::instance().remove(this);
+
   rosNode->shutdown(); // Shutdown the ROS node
 
   // Stop the multi threaded ROS spinner
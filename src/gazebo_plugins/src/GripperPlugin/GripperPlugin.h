@@ -8,8 +8,9 @@
 #include <ros/ros.h>
 #include <ros/callback_queue.h>
 #include <std_msgs/Float32.h>
-#include <thread>
 #include "GripperManager.h"
+#include "GripperService.h"
+#include "ContactEventQueue.h"
 #include <string>
 #include <mutex>
 
@@ -24,6 +25,10 @@
  * three primary joints. A gripper manager is implemented to pass force and
  * angle data between this class and the PID controllers.
  *
+ * <p>The joints of every rover's gripper are driven by one GripperService,
+ * which calls updateGrasping() for each gripper once per physics step and
+ * then runs all of their PID controllers together.
+ *
  * <p>In order to maintain a stable contact with the target a joint
  * is created between the gripper and the target. This is necessary
  * because Gazebo 2.2 was not designed for gripper physics.
@@ -32,6 +37,7 @@
  * @author Antonio Griego
  * @see    ModelPlugin
  * @see    GripperManager
+ * @see    GripperService
  * @see    PIDController
  */
 namespace gazebo {
@@ -46,8 +52,13 @@ namespace gazebo {
       // required overloaded function from ModelPlugin class
       void Load(gazebo::physics::ModelPtr parent, sdf::ElementPtr sdf);
 
-      // Gazebo actuation function
-      void updateWorldEventHandler();
+      // Called by the GripperService at the start of each physics step.
+      // Handles grasping and sets the desired joint angles. Returns false
+      // if the gripper is not due an update.
+      bool updateGrasping(const common::Time& currentTime, GripperManager::GripperState& desiredState);
+      void printDebugState(const common::Time& currentTime, const GripperManager::GripperState& currentState,
+                           const GripperManager::GripperState& desiredState,
+                           const GripperManager::GripperForces& commandForces);
       void updateGraspedStaticTargetPose();
       
       // ROS topic handlers
@@ -62,26 +73,28 @@ namespace gazebo {
     private:
 
       // private helper functions
-      void processRosQueue();
       void loadDebugMode();
       void loadUpdatePeriod();
       std::string loadSubscriptionTopic(std::string topicTag);
       physics::JointPtr loadJoint(std::string jointTag);
       PIDController::PIDSettings loadPIDSettings(std::string PIDTag);
       void handleGrasping();
+      bool processContactEvents();
+      void applyContactEvent(const ContactEvent& event, physics::LinkPtr& targetLink,
+                             bool& touching, common::Time& noContactTime);
+      void postFingerContacts(ConstContactsPtr& msg, ContactEventQueue& events,
+                              std::string& postedTargetName);
 
       void attach();
       void detach();
+      void settleDroppedStaticTarget(math::Pose pose);
 
       // pointers to gazebo model and xml configuration file
       physics::ModelPtr model;
       sdf::ElementPtr sdf;
 
-      // interface for processing ROS message queue
-      event::ConnectionPtr updateConnection;
+      // ROS node, its subscriptions use the GripperService's queue
       std::unique_ptr<ros::NodeHandle> rosNode;
-      std::thread rosQueueThread;
-      ros::CallbackQueue rosQueue;
 
       // ROS subscribers
       ros::Subscriber wristAngleSubscriber;
@@ -91,7 +104,6 @@ namespace gazebo {
       ros::Publisher infoLogPublisher;
 
       // gripper component objects
-      GripperManager gripperManager;
       physics::JointPtr wristJoint;
       physics::JointPtr leftFingerJoint;
       physics::JointPtr rightFingerJoint;
@@ -147,6 +159,11 @@ namespace gazebo {
 
       // A pose offset so we can move grasped static objects around
       math::Pose attachedTargetOffset;
+
+      // The gripper link pose a grasped static target was last moved to
+      // follow. The target is only moved again once the gripper has moved.
+      math::Pose carriedFromGripperPose;
+      bool carriedTargetPlaced;
       
       // These pointers are only when a finger is in contact with a target
       // object
@@ -159,6 +176,21 @@ namespace gazebo {
       common::Time leftFingerNoContactTime;
       common::Time rightFingerNoContactTime;
 
+      // Changes in finger contact posted by the contact handlers and applied
+      // to the target links by the physics thread
+      ContactEventQueue rightFingerContactEvents;
+      ContactEventQueue leftFingerContactEvents;
+
+      // The target each contact handler last posted, empty for none. Only
+      // used by the contact handlers.
+      std::string rightFingerPostedTargetName;
+      std::string leftFingerPostedTargetName;
+
+      // Whether each finger is touching a target according to the last
+      // event applied
+      bool rightFingerTouching;
+      bool leftFingerTouching;
+
       // Target attach joint
       physics::JointPtr targetAttachJoint;
 
@@ -167,8 +199,6 @@ namespace gazebo {
 
       bool dropStaticTarget;
       gazebo::math::Angle maxGrippingAngle;
-
-      int  dropStaticTargetCounter;
   };
 
   // Register this plugin with the simulator
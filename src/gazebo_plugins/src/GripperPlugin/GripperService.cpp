@@ -0,0 +1,157 @@
+#include "GripperService.h"
+#include "GripperPlugin.h"
+
+using namespace gazebo;
+using namespace std;
+
+/**
+ * The grippers are model plugins loaded into the same gazebo server, so a
+ * single service is shared by all of them.
+ */
+GripperService& GripperService::instance() {
+  static GripperService service;
+  return service;
+}
+
+GripperService::GripperService() : isRosQueueRunning(false) {
+}
+
+GripperService::~GripperService() {
+  stop();
+}
+
+/**
+ * Adds a gripper to the arrays updated each physics step. Its desired angles
+ * are taken from the plugin and the forces computed by its GripperManager are
+ * applied to its joints.
+ */
+void GripperService::add(GripperPlugin* plugin, physics::JointPtr wristJoint,
+    physics::JointPtr leftFingerJoint, physics::JointPtr rightFingerJoint,
+    const GripperManager& manager) {
+  lock_guard<mutex> lock(grippersMutex);
+
+  plugins.push_back(plugin);
+  wristJoints.push_back(wristJoint);
+  leftFingerJoints.push_back(leftFingerJoint);
+  rightFingerJoints.push_back(rightFingerJoint);
+  managers.push_back(manager);
+  desiredStates.push_back(GripperManager::GripperState());
+  currentStates.push_back(GripperManager::GripperState());
+  forces.push_back(GripperManager::GripperForces());
+
+  if (!world) world = wristJoint->GetWorld();
+
+  // ConnectWorldUpdateBegin sets our handler to be called at the beginning
+  // of each physics update iteration
+  if (!updateConnection) {
+    updateConnection = event::Events::ConnectWorldUpdateBegin(
+      boost::bind(&GripperService::updateWorldEventHandler, this)
+    );
+  }
+
+  if (!isRosQueueRunning) {
+    isRosQueueRunning = true;
+    rosQueueThread = std::thread(std::bind(&GripperService::processRosQueue, this));
+  }
+}
+
+void GripperService::remove(GripperPlugin* plugin) {
+  bool isLast;
+
+  {
+    lock_guard<mutex> lock(grippersMutex);
+
+    for (size_t i = 0; i < plugins.size(); i++) {
+      if (plugins[i] != plugin) continue;
+
+      size_t last = plugins.size() - 1;
+      plugins[i] = plugins[last];
+      wristJoints[i] = wristJoints[last];
+      leftFingerJoints[i] = leftFingerJoints[last];
+      rightFingerJoints[i] = rightFingerJoints[last];
+      managers[i] = managers[last];
+
+      plugins.pop_back();
+      wristJoints.pop_back();
+      leftFingerJoints.pop_back();
+      rightFingerJoints.pop_back();
+      managers.pop_back();
+      desiredStates.pop_back();
+      currentStates.pop_back();
+      forces.pop_back();
+      break;
+    }
+
+    isLast = plugins.empty();
+  }
+
+  // Stopped without the lock so a physics step waiting for it can finish
+  if (isLast) stop();
+}
+
+void GripperService::stop() {
+  if (updateConnection) {
+    event::Events::DisconnectWorldUpdateBegin(updateConnection);
+    updateConnection.reset();
+  }
+
+  if (isRosQueueRunning) {
+    isRosQueueRunning = false;
+    if (rosQueueThread.joinable()) rosQueueThread.join();
+  }
+
+  world.reset();
+}
+
+/**
+ * Updates every registered gripper. Each plugin first handles its grasping
+ * and reports whether it is due a joint update, then the joint angles of the
+ * grippers that are due are read, their PID controllers run and the
+ * resulting forces applied, one array at a time.
+ */
+void GripperService::updateWorldEventHandler() {
+  lock_guard<mutex> lock(grippersMutex);
+
+  if (!world) return;
+  common::Time currentTime = world->GetSimTime();
+
+  due.clear();
+  for (size_t i = 0; i < plugins.size(); i++) {
+    if (plugins[i]->updateGrasping(currentTime, desiredStates[i])) due.push_back(i);
+  }
+
+  for (size_t n = 0; n < due.size(); n++) {
+    size_t i = due[n];
+    currentStates[i].wristAngle = wristJoints[i]->GetAngle(0).Radian();
+    currentStates[i].leftFingerAngle = leftFingerJoints[i]->GetAngle(0).Radian();
+    currentStates[i].rightFingerAngle = rightFingerJoints[i]->GetAngle(0).Radian();
+  }
+
+  // Get the forces to apply to the joints from the PID controllers
+  for (size_t n = 0; n < due.size(); n++) {
+    size_t i = due[n];
+    forces[i] = managers[i].getForces(desiredStates[i], currentStates[i]);
+  }
+
+  // Apply the command forces to the joints
+  for (size_t n = 0; n < due.size(); n++) {
+    size_t i = due[n];
+    wristJoints[i]->SetForce(0, forces[i].wristForce);
+    leftFingerJoints[i]->SetForce(0, forces[i].leftFingerForce);
+    rightFingerJoints[i]->SetForce(0, forces[i].rightFingerForce);
+
+    plugins[i]->printDebugState(currentTime, currentStates[i], desiredStates[i], forces[i]);
+  }
+}
+
+/**
+ * This function is used inside of the service's thread to process the
+ * messages being passed from the publishers to the subscribers of every
+ * gripper.
+ */
+void GripperService::processRosQueue() {
+  static const double timeout = 0.01;
+  while (isRosQueueRunning && ros::ok()) {
+    rosCallbackQueue.callAvailable(ros::WallDuration(timeout));
+  }
+}
@@ -0,0 +1,93 @@
+#ifndef GRIPPER_SERVICE_H
+#define GRIPPER_SERVICE_H
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GripperManager.h"
+
+/**
+ * This class runs the grippers of every rover in the simulation from a single
+ * world update callback and services their ROS subscriptions from a single
+ * callback queue thread.
+ *
+ * <p>Each GripperPlugin registers its joints and its GripperManager when it
+ * is loaded. The managers, joint angles and forces of all the registered
+ * grippers are kept in arrays indexed by gripper, so each physics step reads
+ * the joint angles, runs the PID controllers and applies the forces for all
+ * of the grippers due an update in one pass over each array. Grasping is
+ * still handled by each plugin, which the service calls first.
+ *
+ * <p>There is one service per gazebo server process, see instance().
+ *
+ * @see GripperPlugin
+ * @see GripperManager
+ */
+namespace gazebo {
+
+  class GripperPlugin;
+
+  class GripperService {
+
+    public:
+
+      static GripperService& instance();
+
+      // Registers a gripper. The update callback and the ROS queue thread
+      // are started with the first gripper.
+      void add(GripperPlugin* plugin, physics::JointPtr wristJoint,
+               physics::JointPtr leftFingerJoint, physics::JointPtr rightFingerJoint,
+               const GripperManager& manager);
+
+      // Unregisters a gripper. The update callback and the ROS queue thread
+      // are stopped with the last gripper.
+      void remove(GripperPlugin* plugin);
+
+      // The queue the grippers' ROS subscriptions should use
+      ros::CallbackQueue* rosQueue() { return &rosCallbackQueue; }
+
+      ~GripperService();
+
+    private:
+
+      GripperService();
+      GripperService(const GripperService&);
+      GripperService& operator=(const GripperService&);
+
+      void updateWorldEventHandler();
+      void processRosQueue();
+      void stop();
+
+      // Guards the gripper arrays against plugins being loaded or removed
+      // while the physics thread updates them
+      std::mutex grippersMutex;
+
+      // Indexed by gripper. Removing a gripper moves the last one into its place.
+      std::vector<GripperPlugin*> plugins;
+      std::vector<physics::JointPtr> wristJoints;
+      std::vector<physics::JointPtr> leftFingerJoints;
+      std::vector<physics::JointPtr> rightFingerJoints;
+      std::vector<GripperManager> managers;
+      std::vector<GripperManager::GripperState> desiredStates;
+      std::vector<GripperManager::GripperState> currentStates;
+      std::vector<GripperManager::GripperForces> forces;
+
+      // Indices of the grippers that are due an update this step
+      std::vector<size_t> due;
+
+      physics::WorldPtr world;
+      event::ConnectionPtr updateConnection;
+
+      ros::CallbackQueue rosCallbackQueue;
+      std::thread rosQueueThread;
+      std::atomic<bool> isRosQueueRunning;
+  };
+
+}
+
+#endif /* GRIPPER_SERVICE_H */
@@ -8,6 +8,9 @@ using namespace std;
  */
 void ScorePlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     score = 0;
+    publishedScore = -1;
+    publishedTotal = -1;
+    targetListChanged = true;
     model = _model;
     sdf = _sdf;
 
@@ -19,8 +22,20 @@ void ScorePlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     // Create a ros node
     rosNode.reset(new ros::NodeHandle(string(model->GetName()) + "_score"));
 
-    // Create publishers so we can send info messages to the UI
-    scorePublisher = rosNode->advertise<std_msgs::String>(loadPublisherTopic(), 1, true);
+    // Create publishers so we can send info messages to the UI. Of the shards
+    // of a sharded simulation only shard 0 publishes the score the UI reads.
+    string scoreTopic = loadPublisherTopic();
+    shard = Shard::load();
+    if(!shard.isSharded() || shard.index == 0) {
+        scorePublisher = rosNode->advertise<std_msgs::String>(scoreTopic, 1, true);
+    }
+    if(shard.isSharded()) {
+        shardScorePublisher = rosNode->advertise<std_msgs::String>(
+            Shard::topic(scoreTopic, shard.index), 1, true);
+        if(shard.index == 0) {
+            subscribeToShards(scoreTopic);
+        }
+    }
     infoLogPublisher = rosNode->advertise<std_msgs::String>("/infoLog", 1, true);
 
     // Connect the updateWorldEventHandler function to Gazebo;
@@ -29,6 +44,22 @@ void ScorePlugin::Load(physics::ModelPtr _model, sdf::ElementPtr _sdf) {
     updateConnection = event::Events::ConnectWorldUpdateBegin(
         boost::bind(&ScorePlugin::updateWorldEventHandler, this)
     );
+
+    // Models are spawned and removed while the simulation runs, so rebuild the
+    // target list on the next update after either happens
+    addEntityConnection = event::Events::ConnectAddEntity(
+        boost::bind(&ScorePlugin::entityChangedEventHandler, this, _1)
+    );
+    deleteEntityConnection = event::Events::ConnectDeleteEntity(
+        boost::bind(&ScorePlugin::entityChangedEventHandler, this, _1)
+    );
+}
+
+/**
+ * Called by Gazebo when a model is added to or removed from the world.
+ */
+void ScorePlugin::entityChangedEventHandler(std::string name) {
+    targetListChanged = true;
 }
 
 // Gazebo actuation function
@@ -41,18 +72,95 @@ void ScorePlugin::updateWorldEventHandler() {
     previousUpdateTime = currentTime;
 
     updateScore();
+    publishScore();
+}
 
+/**
+ * Publishes the score when it changed. The topics are latched, so the GUI
+ * still gets the current score when it subscribes after the last change.
+ */
+void ScorePlugin::publishScore() {
     std_msgs::String msg;
-    msg.data = std::to_string(score);
+
+    if(shard.isSharded() && score != publishedScore) {
+        msg.data = std::to_string(score);
+        shardScorePublisher.publish(msg);
+    }
+    publishedScore = score;
+
+    if(shard.isSharded() && shard.index != 0) {
+        return;
+    }
+
+    // the other shards' scores are handled here, on the physics thread
+    shardScoreQueue.callAvailable();
+    int total = score;
+    for(unsigned int i = 0; i < shardScores.size(); i++) {
+        if(shardScores[i] > 0) {
+            total += shardScores[i];
+        }
+    }
+
+    if(total == publishedTotal) {
+        return;
+    }
+    publishedTotal = total;
+
+    msg.data = std::to_string(total);
     scorePublisher.publish(msg);
 }
 
 /**
- * Updates the score based on the proximity of tag models in the tagModels list.
+ * Subscribes shard 0 to the scores of the other shards.
+ */
+void ScorePlugin::subscribeToShards(const std::string& scoreTopic) {
+    shardScores.assign(shard.count, -1);
+
+    for(int i = 0; i < shard.count; i++) {
+        if(i == shard.index) {
+            continue;
+        }
+
+        ros::SubscribeOptions options =
+            ros::SubscribeOptions::create<std_msgs::String>(
+                Shard::topic(scoreTopic, i), 1,
+                boost::bind(&ScorePlugin::shardScoreEventHandler, this, i, _1),
+                ros::VoidPtr(), &shardScoreQueue
+            );
+        shardScoreSubscribers.push_back(rosNode->subscribe(options));
+    }
+
+    ROS_INFO_STREAM("[Score Plugin : " << model->GetName() << "]: adding up the scores of "
+        << shard.count << " shards on " << scoreTopic);
+}
+
+/**
+ * Called with the score of another shard, from publishScore().
+ */
+void ScorePlugin::shardScoreEventHandler(int index, const std_msgs::String::ConstPtr& msg) {
+    shardScores[index] = atoi(msg->data.c_str());
+}
+
+/**
+ * Rebuilds the list of tag models, the models whose names start with "at".
+ */
+void ScorePlugin::updateTargetList() {
+    targetList.clear();
+
+    physics::Model_V models = model->GetWorld()->GetModels();
+    for(unsigned int i = 0; i < models.size(); i++) {
+        if(models[i]->GetName().compare(0, 2, "at") == 0) {
+            targetList.push_back(models[i]);
+        }
+    }
+}
+
+/**
+ * Updates the score based on the proximity of tag models in the targetList.
  */
 void ScorePlugin::updateScore() {
-    if(modelList.size() == 0 || modelList.size() != model->GetWorld()->GetModels().size()) {
-        modelList = model->GetWorld()->GetModels();
+    if(targetListChanged.exchange(false)) {
+        updateTargetList();
     }
 
     math::Pose nestPose = model->GetWorldPose();
@@ -63,14 +171,13 @@ void ScorePlugin::updateScore() {
 
     score = 0;
 
-    for(unsigned int i = 0; i < modelList.size(); i++) {
-        if (modelList[i]->GetName().substr(0,2).compare("at") == 0) {
-            if(modelList[i]->GetWorldPose().pos.x <= x_max &&
-               modelList[i]->GetWorldPose().pos.x >= x_min &&
-               modelList[i]->GetWorldPose().pos.y <= y_max &&
-               modelList[i]->GetWorldPose().pos.y >= y_min) {
-                score++;
-            }
+    for(unsigned int i = 0; i < targetList.size(); i++) {
+        math::Vector3 position = targetList[i]->GetWorldPose().pos;
+        if(position.x <= x_max &&
+           position.x >= x_min &&
+           position.y <= y_max &&
+           position.y >= y_min) {
+            score++;
         }
     }
 }
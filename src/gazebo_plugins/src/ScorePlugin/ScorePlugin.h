@@ -5,13 +5,22 @@
 #include <gazebo/physics/physics.hh>
 #include <gazebo/msgs/msgs.hh>
 #include <ros/ros.h>
+#include <ros/callback_queue.h>
 #include <std_msgs/String.h>
+#include <atomic>
 #include <string>
 #include <thread>
+#include <vector>
+
+#include "Shard.h"
 
 /**
  * This class implements a score counter which keeps track of the number of
  * tags within a square collection zone.
+ *
+ * In a sharded simulation every shard only holds the tags of its region, so
+ * each shard publishes its own count under <scoreTopic>/shard_<n> and the
+ * plugin of shard 0 publishes the sum of all of them on <scoreTopic>.
  */
 namespace gazebo {
 
@@ -27,6 +36,8 @@ namespace gazebo {
             // Gazebo actuation function
             void updateWorldEventHandler();
             void collectionZoneContactsEventHandler(ConstContactsPtr& msg);
+            void entityChangedEventHandler(std::string name);
+            void shardScoreEventHandler(int index, const std_msgs::String::ConstPtr& msg);
 
             // For sending informational messages to the UI
             void sendInfoLogMessage(std::string text);
@@ -34,14 +45,21 @@ namespace gazebo {
         private: // functions
 
             void updateScore();
+            void updateTargetList();
+            void publishScore();
+            void subscribeToShards(const std::string& scoreTopic);
             std::string loadPublisherTopic();
             void loadUpdatePeriod();
             void loadCollectionZoneSquareSize();
 
         private: // variables
 
-            physics::Model_V modelList;
+            // the tag models, rebuilt when a model is added or removed
+            physics::Model_V targetList;
+            std::atomic<bool> targetListChanged;
             int score;
+            int publishedScore;
+            int publishedTotal;
             float collectionZoneSquareSize;
 
             // time management variables
@@ -54,10 +72,20 @@ namespace gazebo {
 
             // interface for processing ROS message queue
             event::ConnectionPtr updateConnection;
+            event::ConnectionPtr addEntityConnection;
+            event::ConnectionPtr deleteEntityConnection;
             std::unique_ptr<ros::NodeHandle> rosNode;
 
+            // the other shards' scores, read by shard 0 on the physics
+            // thread, -1 until a shard first reports
+            Shard shard;
+            std::vector<int> shardScores;
+            std::vector<ros::Subscriber> shardScoreSubscribers;
+            ros::CallbackQueue shardScoreQueue;
+
             // ROS Publishers
             ros::Publisher scorePublisher;
+            ros::Publisher shardScorePublisher;
             ros::Publisher infoLogPublisher;
     };
 
@@ -4,18 +4,82 @@
 #include "gazebo/msgs/msgs.hh"
 #include "gazebo/physics/physics.hh"
 #include "gazebo/transport/transport.hh"
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
 using namespace std;
 
 namespace gazebo
 {
+  // Physics settings that trade accuracy for simulation speed.
+  // A real time update rate of 0 runs the simulation as fast as possible.
+  struct PhysicsProfile
+  {
+    const char* name;
+    double maxStepSize;        // seconds
+    int iterations;            // ODE solver iterations per step
+    double realTimeUpdateRate; // steps per real second
+  };
+
+  static const PhysicsProfile physicsProfiles[] =
+  {
+    // the settings this world has always used
+    { "default",   0.001, 50, 0 },
+    // real time with the default step, for watching and recording runs
+    { "fidelity",  0.001, 50, 1000 },
+    // larger steps and fewer iterations for headless batch evaluation
+    { "fast-eval", 0.002, 30, 0 },
+    // for pushing many rovers and targets through long runs
+    { "stress",    0.004, 20, 0 }
+  };
+
   class SetupWorld : public WorldPlugin
   {
+    // The profile is named by the SWARMATHON_PHYSICS_PROFILE environment
+    // variable, so it can be chosen without editing the world file, or by
+    // the <physicsProfile> element of this plugin. <maxStepSize>,
+    // <iterations> and <realTimeUpdateRate> elements override single values.
+    private: PhysicsProfile loadPhysicsProfile(sdf::ElementPtr _sdf)
+    {
+      string name = "default";
+      if (_sdf->HasElement("physicsProfile"))
+        name = _sdf->GetElement("physicsProfile")->Get<string>();
+
+      const char* env_name = getenv("SWARMATHON_PHYSICS_PROFILE");
+      if (env_name != NULL && env_name[0] != '\0')
+        name = env_name;
+
+      PhysicsProfile profile = physicsProfiles[0];
+      bool found = false;
+      for (unsigned int i = 0; i < sizeof(physicsProfiles)/sizeof(physicsProfiles[0]); i++)
+      {
+        if (name == physicsProfiles[i].name)
+        {
+          profile = physicsProfiles[i];
+          found = true;
+        }
+      }
+
+      if (!found)
+        cerr << "Unknown physics profile \"" << name << "\", using \"" << profile.name << "\". " << flush;
+
+      if (_sdf->HasElement("maxStepSize"))
+        profile.maxStepSize = _sdf->GetElement("maxStepSize")->Get<double>();
+      if (_sdf->HasElement("iterations"))
+        profile.iterations = _sdf->GetElement("iterations")->Get<int>();
+      if (_sdf->HasElement("realTimeUpdateRate"))
+        profile.realTimeUpdateRate = _sdf->GetElement("realTimeUpdateRate")->Get<double>();
+
+      return profile;
+    }
+
     public: void Load(physics::WorldPtr _parent, sdf::ElementPtr _sdf)
     {
       cout << "Setting up world..." << flush;
 
+      PhysicsProfile profile = loadPhysicsProfile(_sdf);
+
       // Create a new transport node
       transport::NodePtr node(new transport::Node());
 
@@ -30,17 +94,22 @@ namespace gazebo
       physicsMsg.set_type(msgs::Physics::ODE);
 
       // Set the step time
-      physicsMsg.set_max_step_size(0.001);
+      physicsMsg.set_max_step_size(profile.maxStepSize);
+
+      // Set the number of solver iterations per step
+      physicsMsg.set_iters(profile.iterations);
 
       // Set the real time update rate
-      physicsMsg.set_real_time_update_rate(0);
+      physicsMsg.set_real_time_update_rate(profile.realTimeUpdateRate);
 
       // Change gravity
       //msgs::Set(physicsMsg.mutable_gravity(), math::Vector3(0.01, 0, 0.1));
       
       physicsPub->Publish(physicsMsg);
 
-      cout << " done." << endl;
+      cout << " done, physics profile " << profile.name
+           << " (step " << profile.maxStepSize << " s, " << profile.iterations
+           << " iterations, update rate " << profile.realTimeUpdateRate << ")." << endl;
     }
   };
 
@@ -0,0 +1,48 @@
+#ifndef SHARD_H
+#define SHARD_H
+
+#include <cstdlib>
+#include <string>
+
+namespace gazebo {
+
+    /**
+     * The shard of a sharded simulation this gazebo server runs. A large
+     * arena can be split into regions that are each run by their own gazebo
+     * server, see misc/run_trials.py --shards. The servers share one ROS
+     * master and are told their shard by the SWARMATHON_SHARD and
+     * SWARMATHON_SHARDS environment variables, like the physics profile of
+     * SetupWorld. Without them there is one shard, the whole arena.
+     */
+    struct Shard {
+        int index;
+        int count;
+
+        bool isSharded() const { return count > 1; }
+
+        // The topic a shard publishes base under, e.g.
+        // /collectionZone/score/shard_2
+        static std::string topic(const std::string& base, int index) {
+            return base + "/shard_" + std::to_string(index);
+        }
+
+        static Shard load() {
+            Shard shard = { 0, 1 };
+
+            const char* count = getenv("SWARMATHON_SHARDS");
+            const char* index = getenv("SWARMATHON_SHARD");
+            if (count != NULL && index != NULL) {
+                shard.count = atoi(count);
+                shard.index = atoi(index);
+            }
+
+            if (shard.count < 1 || shard.index < 0 || shard.index >= shard.count) {
+                shard.count = 1;
+                shard.index = 0;
+            }
+            return shard;
+        }
+    };
+}
+
+#endif /* SHARD_H */
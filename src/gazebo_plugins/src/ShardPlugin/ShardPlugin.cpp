@@ -0,0 +1,151 @@
+#include "ShardPlugin.h"
+
+using namespace gazebo;
+using namespace std;
+
+/**
+ * This function loads the plugin and initializes it from an SDF file.
+ */
+void ShardPlugin::Load(physics::WorldPtr _world, sdf::ElementPtr _sdf) {
+    world = _world;
+    sdf = _sdf;
+    shard = Shard::load();
+
+    if(!shard.isSharded()) {
+        ROS_INFO_STREAM("[Shard Plugin]: not a sharded simulation, nothing to keep in step");
+        return;
+    }
+
+    // ROS must be initialized in order to set up this plugin's subscribers
+    if(!ros::isInitialized()) {
+        ROS_ERROR_STREAM("[Shard Plugin]: In ShardPlugin.cpp: Load(): ROS must "
+            << "be initialized before this plugin can be used!");
+        exit(1);
+    }
+
+    loadParameters();
+
+    rosNode.reset(new ros::NodeHandle("shard_" + to_string(shard.index) + "_pace"));
+    simTimePublisher = rosNode->advertise<rosgraph_msgs::Clock>(
+        Shard::topic("/shards", shard.index) + "/sim_time", 1, true);
+
+    // a shard that was never heard from counts as heard from now, so the
+    // shards wait for each other while they start
+    shardTimes.assign(shard.count, 0);
+    shardHeard.assign(shard.count, ros::WallTime::now());
+
+    for(int i = 0; i < shard.count; i++) {
+        if(i == shard.index) {
+            continue;
+        }
+
+        ros::SubscribeOptions options =
+            ros::SubscribeOptions::create<rosgraph_msgs::Clock>(
+                Shard::topic("/shards", i) + "/sim_time", 1,
+                boost::bind(&ShardPlugin::simTimeEventHandler, this, i, _1),
+                ros::VoidPtr(), &rosQueue
+            );
+        simTimeSubscribers.push_back(rosNode->subscribe(options));
+    }
+
+    previousPublishTime = world->GetSimTime();
+
+    // Connect the updateWorldEventHandler function to Gazebo;
+    // ConnectWorldUpdateBegin sets our handler to be called at the beginning of
+    // each physics update iteration
+    updateConnection = event::Events::ConnectWorldUpdateBegin(
+        boost::bind(&ShardPlugin::updateWorldEventHandler, this)
+    );
+
+    ROS_INFO_STREAM("[Shard Plugin]: shard " << shard.index << " of " << shard.count
+        << ", at most " << maxLead << " s ahead of the others");
+}
+
+// Gazebo actuation function
+void ShardPlugin::updateWorldEventHandler() {
+    common::Time currentTime = world->GetSimTime();
+    double now = currentTime.Double();
+
+    rosQueue.callAvailable();
+    double slowest = slowestShardTime();
+    bool waiting = slowest >= 0 && now - slowest > maxLead;
+
+    // the others must know where this shard is before it waits for them,
+    // or two shards could each wait for the other
+    if(waiting || (currentTime - previousPublishTime).Float() >= publishPeriod) {
+        previousPublishTime = currentTime;
+
+        rosgraph_msgs::Clock msg;
+        msg.clock = ros::Time(currentTime.sec, currentTime.nsec);
+        simTimePublisher.publish(msg);
+    }
+
+    while(waiting && ros::ok()) {
+        rosQueue.callAvailable(ros::WallDuration(0.001));
+        slowest = slowestShardTime();
+        waiting = slowest >= 0 && now - slowest > maxLead;
+    }
+}
+
+/**
+ * Called with the simulation time of another shard, from
+ * updateWorldEventHandler().
+ */
+void ShardPlugin::simTimeEventHandler(int index, const rosgraph_msgs::Clock::ConstPtr& msg) {
+    shardTimes[index] = msg->clock.toSec();
+    shardHeard[index] = ros::WallTime::now();
+}
+
+/**
+ * Returns the simulation time of the slowest other shard that is still
+ * reporting, or -1 if there is none.
+ */
+double ShardPlugin::slowestShardTime() {
+    ros::WallTime now = ros::WallTime::now();
+    double slowest = -1;
+
+    for(int i = 0; i < shard.count; i++) {
+        if(i == shard.index || (now - shardHeard[i]).toSec() > staleTimeout) {
+            continue;
+        }
+        if(slowest < 0 || shardTimes[i] < slowest) {
+            slowest = shardTimes[i];
+        }
+    }
+
+    return slowest;
+}
+
+/**
+ * This function loads the optional parameters of this plugin from the SDF
+ * configuration file.
+ */
+void ShardPlugin::loadParameters() {
+    maxLead = 0.1;
+    staleTimeout = 10.0;
+
+    if(sdf->HasElement("maxLead")) {
+        maxLead = sdf->GetElement("maxLead")->Get<float>();
+    }
+    if(sdf->HasElement("staleTimeout")) {
+        staleTimeout = sdf->GetElement("staleTimeout")->Get<float>();
+    }
+
+    // fatal error: the shards could not move at all
+    if(maxLead <= 0 || staleTimeout <= 0) {
+        ROS_ERROR_STREAM("[Shard Plugin]: In ShardPlugin.cpp: loadParameters(): "
+            << "maxLead = " << maxLead << ", staleTimeout = " << staleTimeout
+            << ", neither can be <= 0.0");
+        exit(1);
+    }
+
+    // published well within the lead, so the other shards never wait on an
+    // old time of this one
+    publishPeriod = maxLead / 4;
+}
+
+ShardPlugin::~ShardPlugin() {
+    if(rosNode) {
+        rosNode->shutdown(); // Shutdown the ROS node
+    }
+}
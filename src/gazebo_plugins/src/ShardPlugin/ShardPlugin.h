@@ -0,0 +1,77 @@
+#ifndef SHARD_PLUGIN_H
+#define SHARD_PLUGIN_H
+
+#include <gazebo/gazebo.hh>
+#include <gazebo/physics/physics.hh>
+#include <ros/ros.h>
+#include <ros/callback_queue.h>
+#include <rosgraph_msgs/Clock.h>
+#include <string>
+#include <vector>
+
+#include "Shard.h"
+
+/**
+ * This class keeps the gazebo servers of a sharded simulation close in
+ * simulated time. Each shard runs as fast as its own physics allows, so
+ * without it a shard with fewer rovers would run ahead of the others, and
+ * the rovers of different shards would no longer share a clock.
+ *
+ * Every shard publishes its simulation time on /shards/<n>/sim_time. At the
+ * beginning of each physics update a shard that is more than maxLead seconds
+ * ahead of the slowest other shard waits for it. A shard that has not
+ * reported for staleTimeout wall seconds, e.g. one that was paused or has
+ * stopped, no longer holds the others back.
+ */
+namespace gazebo {
+
+    class ShardPlugin : public WorldPlugin {
+
+        public:
+
+            ~ShardPlugin();
+
+            // required overloaded function from WorldPlugin class
+            void Load(physics::WorldPtr _world, sdf::ElementPtr _sdf);
+
+            // Gazebo actuation function
+            void updateWorldEventHandler();
+            void simTimeEventHandler(int index, const rosgraph_msgs::Clock::ConstPtr& msg);
+
+        private: // functions
+
+            double slowestShardTime();
+            void loadParameters();
+
+        private: // variables
+
+            Shard shard;
+            float maxLead;          // simulated seconds
+            float publishPeriod;    // simulated seconds
+            float staleTimeout;     // wall seconds
+
+            // the other shards' simulation times and when they were heard
+            // from, only used on the physics thread
+            std::vector<double> shardTimes;
+            std::vector<ros::WallTime> shardHeard;
+
+            common::Time previousPublishTime;
+
+            // pointers to gazebo world and xml configuration file
+            physics::WorldPtr world;
+            sdf::ElementPtr sdf;
+
+            // interface for processing ROS message queue
+            event::ConnectionPtr updateConnection;
+            std::unique_ptr<ros::NodeHandle> rosNode;
+            ros::CallbackQueue rosQueue;
+
+            ros::Publisher simTimePublisher;
+            std::vector<ros::Subscriber> simTimeSubscribers;
+    };
+
+    // Register this plugin with the simulator
+    GZ_REGISTER_WORLD_PLUGIN(ShardPlugin)
+}
+
+#endif /* SHARD_PLUGIN_H */
@@ -1,13 +1,16 @@
 #include <CameraFrame.h>
+#include <QTimer>
 
 namespace rqt_rover_gui {
 
 CameraFrame::CameraFrame(QWidget *parent, Qt::WindowFlags flags) : QFrame(parent)
 {
-  connect(this, SIGNAL(delayedUpdate()), this, SLOT(update()),
+  connect(this, SIGNAL(delayedUpdate()), this, SLOT(showLatestImage()),
           Qt::QueuedConnection);
 
   frames = 0;
+  image_pending = false;
+  max_frame_rate = 0;
 }
 
 void CameraFrame::paintEvent(QPaintEvent* event) {
@@ -67,11 +70,52 @@ void CameraFrame::paintEvent(QPaintEvent* event) {
   // end frames per second
 }
 
-void CameraFrame::setImage(const QImage& img) {
+void CameraFrame::setImage(const sensor_msgs::ImageConstPtr& img) {
     image_update_mutex.lock();
-    image = img.copy();
+    latest_image = img;
+    bool notify = !image_pending;
+    image_pending = true;
     image_update_mutex.unlock();
-    emit delayedUpdate();
+
+    // One showLatestImage() call is queued at a time however fast images
+    // arrive
+    if (notify) emit delayedUpdate();
+}
+
+void CameraFrame::setMaxFrameRate(double fps) {
+    max_frame_rate = fps;
+}
+
+void CameraFrame::showLatestImage() {
+    if (max_frame_rate > 0 && image_shown_timer.isValid()) {
+      int period = 1000.0 / max_frame_rate;
+      int elapsed = image_shown_timer.elapsed();
+
+      // Come back when the frame is due. image_pending stays set so no other
+      // call is queued meanwhile, and the newest image is taken then.
+      if (elapsed < period) {
+        QTimer::singleShot(period - elapsed, this, SLOT(showLatestImage()));
+        return;
+      }
+    }
+
+    image_update_mutex.lock();
+    sensor_msgs::ImageConstPtr img = latest_image;
+    latest_image.reset();
+    image_pending = false;
+    image_update_mutex.unlock();
+
+    if (!img || img->data.size() < img->step * img->height) return;
+
+    image_shown_timer.start();
+
+    // Wrap the message data without copying it, then scale to the frame
+    // before swapping to the rovers' BGR order so only the displayed pixels
+    // are converted
+    QImage raw(&(img->data[0]), img->width, img->height, img->step, QImage::Format_RGB888);
+    image = raw.scaled(contentsRect().size(), Qt::IgnoreAspectRatio, Qt::FastTransformation).rgbSwapped();
+
+    update();
 }
 
 void CameraFrame::addTarget(std::pair<double,double> c1,
@@ -18,6 +18,7 @@
 #include <QMutex>
 #include <QPainter>
 #include <QPointF>
+#include <sensor_msgs/Image.h>
 
 namespace rqt_rover_gui
 {
@@ -26,7 +27,16 @@ namespace rqt_rover_gui
 
     public:
       CameraFrame(QWidget *parent, Qt::WindowFlags = 0);
-      void setImage(const QImage& image);
+
+      // Called from the ROS thread. Only the newest image is kept until the
+      // GUI thread shows it, so images that arrive faster than they can be
+      // shown are dropped instead of queued.
+      void setImage(const sensor_msgs::ImageConstPtr& image);
+
+      // Limits how often a new image is shown. 0 shows every image the GUI
+      // thread keeps up with.
+      void setMaxFrameRate(double fps);
+
       // four corners of tag
       void addTarget(std::pair<double,double> c1, std::pair<double,double> c2,
                      std::pair<double,double> c3, std::pair<double,double> c4,
@@ -36,14 +46,22 @@ namespace rqt_rover_gui
       void delayedUpdate();
 
     private slots:
-      // currently, there are no class-defined slots in use
+      // Scales the newest image to the frame and repaints, at most at the
+      // maximum frame rate
+      void showLatestImage();
 
     protected:
       void paintEvent(QPaintEvent *event);
 
     private:
-      QImage image;
+      QImage image; // The image shown, already scaled. Only used by the GUI thread.
+
       mutable QMutex image_update_mutex;
+      sensor_msgs::ImageConstPtr latest_image; // Guarded by image_update_mutex
+      bool image_pending; // Guarded by image_update_mutex
+
+      double max_frame_rate;
+      QTime image_shown_timer; // Time since the last image was shown
 
       QTime frame_rate_timer;
       int frames;
@@ -1,6 +1,17 @@
 #include "GazeboSimManager.h"
 #include <QDir>
+#include <QEventLoop>
+#include <QFile>
+#include <QFileInfo>
+#include <QTimer>
+#include <ros/ros.h>
+#include <gazebo_msgs/SpawnModel.h>
+#include <atomic>
+#include <cmath>
+#include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
 #include <unistd.h>
 #include <iostream>
 #include <utility> // For pair
@@ -20,6 +31,7 @@ GazeboSimManager::GazeboSimManager()
     app_root = QString(app_root_cstr);
     log_root = app_root+"/"+"logs/";
     custom_world_path = "";
+    max_model_clearance = 0;
 }
 
 // Load a default world path unless a custom path has been specified
@@ -98,6 +110,9 @@ void GazeboSimManager::cleanUpGazeboServer()
     gazebo_server_process->deleteLater();
     gazebo_server_process = NULL;
     model_locations.clear();
+    max_model_clearance = 0;
+    queued_models.clear();
+    world_models.clear();
 }
 
 void GazeboSimManager::cleanUpGazeboClient()
@@ -135,11 +150,24 @@ QString GazeboSimManager::stopRoverNode( QString rover_name )
 {
     if (rover_processes.find(rover_name) == rover_processes.end()) return "Could not stop " + rover_name + " rover process since it does not exist.";
 
-    rover_processes[rover_name]->terminate();
-    rover_processes[rover_name]->waitForFinished();
+    vector<Job> jobs(1, stopRoverNodeJob(rover_name));
+    return runJobs(jobs);
+}
+
+void GazeboSimManager::queueStopRoverNode( QString rover_name )
+{
+    if (rover_processes.find(rover_name) == rover_processes.end()) return;
+
+    queued_jobs.push_back(stopRoverNodeJob(rover_name));
+}
+
+GazeboSimManager::Job GazeboSimManager::stopRoverNodeJob( QString rover_name )
+{
+    Job job;
+    job.wait_for = rover_processes[rover_name];
+    job.wait_for->terminate();
     rover_processes.erase(rover_name);
 
-    // Names of the nodes to kill. 
     vector<QString> nodes;
     nodes.push_back("APRILTAG");
     nodes.push_back("BASE2CAM");
@@ -151,18 +179,13 @@ QString GazeboSimManager::stopRoverNode( QString rover_name )
     nodes.push_back("OBSTACLE");
     nodes.push_back("ODOM");
 
-    // Kill nodes
-    QString output = "";
+    // rosnode kill takes several nodes, so one process stops them all
+    job.command = "rosnode kill";
     for (int i = 0; i < nodes.size(); i++) {
-      QString argument = "rosnode kill "+rover_name+"_"+nodes[i];
-      QProcess sh;
-      sh.start("sh", QStringList() << "-c" << argument);
-      sh.waitForFinished();
-      output += "<br>" + sh.readAll();
-      sh.close();
+      job.command += " "+rover_name+"_"+nodes[i];
     }
 
-    return output;
+    return job;
 }
 
 QString GazeboSimManager::startRoverNode( QString rover_name )
@@ -180,6 +203,9 @@ QString GazeboSimManager::startRoverNode( QString rover_name )
 
 QString GazeboSimManager::addGroundPlane( QString ground_name )
 {
+    QueuedModel ground = {ground_name, ground_name, 0, 0, 0, 0, 0, 0};
+    world_models.push_back(ground);
+
     QString argument = QString("rosrun gazebo_ros spawn_model -sdf -file ")+app_root+"/simulation/models/" + ground_name + "/model.sdf -model " + ground_name;
     QProcess sh;
     sh.start("sh", QStringList() << "-c" << argument);
@@ -196,9 +222,25 @@ QString GazeboSimManager::addGroundPlane( QString ground_name )
 QString GazeboSimManager::addRover(QString rover_name, float x, float y, float z, float roll, float pitch, float yaw)
 {
     float rover_clearance = 0.45; //meters
-    model_locations.insert(make_tuple(x, y, rover_clearance));
+    addModelLocation(x, y, rover_clearance);
+
+    Job job = {addRoverCommand(rover_name, x, y, z, roll, pitch, yaw), NULL};
+    vector<Job> jobs(1, job);
+    return runJobs(jobs);
+}
 
-    QString argument = "rosrun gazebo_ros spawn_model -sdf -file "+app_root+"/simulation/models/" + rover_name + "/model.sdf "
+void GazeboSimManager::queueAddRover(QString rover_name, float x, float y, float z, float roll, float pitch, float yaw)
+{
+    float rover_clearance = 0.45; //meters
+    addModelLocation(x, y, rover_clearance);
+
+    Job job = {addRoverCommand(rover_name, x, y, z, roll, pitch, yaw), NULL};
+    queued_jobs.push_back(job);
+}
+
+QString GazeboSimManager::addRoverCommand(QString rover_name, float x, float y, float z, float roll, float pitch, float yaw)
+{
+    return "rosrun gazebo_ros spawn_model -sdf -file "+app_root+"/simulation/models/" + rover_name + "/model.sdf "
                + "-model " + rover_name
                + " -x " + QString::number(x)
                + " -y " + QString::number(y)
@@ -206,17 +248,6 @@ QString GazeboSimManager::addRover(QString rover_name, float x, float y, float z
                + " -R " + QString::number(roll)
                + " -P " + QString::number(pitch)
                + " -Y " + QString::number(yaw);
-
-    QProcess sh;
-    sh.start("sh", QStringList() << "-c" << argument);
-
-    sh.waitForFinished();
-    QByteArray output = sh.readAll();
-    sh.close();
-
-    QString return_msg = "<br><font color='yellow'>" + output + "</font><br>";
-
-    return return_msg;
 }
 
 QString GazeboSimManager::removeRover( QString rover_name)
@@ -259,7 +290,10 @@ QString GazeboSimManager::addModel(QString model_name, QString unique_id, float
 
 QString GazeboSimManager::addModel(QString model_name, QString unique_id, float x, float y, float z, float roll, float pitch, float yaw, float clearance)
 {
-    model_locations.insert(make_tuple(x, y, clearance));
+    addModelLocation(x, y, clearance);
+
+    QueuedModel model = {model_name, unique_id, x, y, z, roll, pitch, yaw};
+    world_models.push_back(model);
 
     QString argument = "rosrun gazebo_ros spawn_model -sdf -file "+app_root+"/simulation/models/" + model_name + "/model.sdf "
             + "-model " + unique_id
@@ -282,18 +316,250 @@ QString GazeboSimManager::addModel(QString model_name, QString unique_id, float
     return return_msg;
 }
 
+void GazeboSimManager::queueModel(QString model_name, QString unique_id, float x, float y, float z, float clearance)
+{
+    queueModel(model_name, unique_id, x, y, z, 0, 0, 0, clearance);
+}
+
+void GazeboSimManager::queueModel(QString model_name, QString unique_id, float x, float y, float z, float roll, float pitch, float yaw, float clearance)
+{
+    addModelLocation(x, y, clearance);
+
+    QueuedModel model = {model_name, unique_id, x, y, z, roll, pitch, yaw};
+    queued_models.push_back(model);
+    world_models.push_back(model);
+}
+
+QString GazeboSimManager::spawnQueuedModels(std::function<void(int, int)> progress)
+{
+    // Several connections keep gazebo busy while earlier requests are still being answered
+    const int n_connections = 4;
+
+    vector<gazebo_msgs::SpawnModel> requests(queued_models.size());
+    for (int i = 0; i < queued_models.size(); i++)
+    {
+        const QueuedModel& model = queued_models[i];
+        gazebo_msgs::SpawnModel::Request& request = requests[i].request;
+
+        request.model_name = model.unique_id.toStdString();
+        request.model_xml = modelSDF(model.model_name);
+        request.reference_frame = "world";
+        request.initial_pose.position.x = model.x;
+        request.initial_pose.position.y = model.y;
+        request.initial_pose.position.z = model.z;
+
+        // roll, pitch, yaw to quaternion
+        double cr = cos(model.roll/2), sr = sin(model.roll/2);
+        double cp = cos(model.pitch/2), sp = sin(model.pitch/2);
+        double cy = cos(model.yaw/2), sy = sin(model.yaw/2);
+        request.initial_pose.orientation.w = cr*cp*cy + sr*sp*sy;
+        request.initial_pose.orientation.x = sr*cp*cy - cr*sp*sy;
+        request.initial_pose.orientation.y = cr*sp*cy + sr*cp*sy;
+        request.initial_pose.orientation.z = cr*cp*sy - sr*sp*cy;
+    }
+    queued_models.clear();
+
+    int total = requests.size();
+    if (total == 0) return "";
+
+    ros::NodeHandle nh;
+    if (!ros::service::waitForService("/gazebo/spawn_sdf_model", ros::Duration(30)))
+    {
+        return "<br><font color='red'>The gazebo spawn service is not available, " + QString::number(total) + " models were not spawned.</font><br>";
+    }
+
+    std::atomic<int> next(0);
+    std::atomic<int> done(0);
+    std::atomic<int> failed(0);
+
+    vector<std::thread> connections;
+    for (int i = 0; i < n_connections && i < total; i++)
+    {
+        connections.push_back(std::thread([&]() {
+            ros::ServiceClient client = nh.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model", true); // persistent
+            for (int j = next++; j < total; j = next++)
+            {
+                if (!client.isValid())
+                {
+                    client = nh.serviceClient<gazebo_msgs::SpawnModel>("/gazebo/spawn_sdf_model", true);
+                }
+                if (!client.call(requests[j]) || !requests[j].response.success)
+                {
+                    failed++;
+                }
+                done++;
+            }
+        }));
+    }
+
+    // Report progress from this thread so callers can update the GUI
+    while (done < total)
+    {
+        if (progress) progress(done, total);
+        usleep(50000);
+    }
+    if (progress) progress(total, total);
+
+    for (int i = 0; i < connections.size(); i++)
+    {
+        connections[i].join();
+    }
+
+    QString return_msg = "<br><font color='yellow'>Spawned " + QString::number(total - failed) + " of " + QString::number(total) + " models</font><br>";
+
+    for (int i = 0; i < requests.size(); i++)
+    {
+        if (!requests[i].response.success)
+        {
+            return_msg += "<font color='red'>" + QString::fromStdString(requests[i].request.model_name) + ": "
+                       + QString::fromStdString(requests[i].response.status_message) + "</font><br>";
+        }
+    }
+
+    return return_msg;
+}
+
+bool GazeboSimManager::saveWorldFile(QString path)
+{
+    QDir().mkpath(QFileInfo(path).absolutePath());
+
+    // Write to a temporary file first so an interrupted save never leaves a partial world behind
+    QString temporary_path = path + ".tmp";
+    ofstream world(temporary_path.toStdString().c_str());
+    if (!world) return false;
+
+    // Same base world as simulation/worlds/swarmathon.world, with every model included at its pose.
+    // Models are referenced by uri so they are found through GAZEBO_MODEL_PATH, see run.sh.
+    world << "<?xml version=\"1.0\" ?>\n"
+          << "<sdf version=\"1.4\">\n"
+          << "\t<world name=\"default\">\n"
+          << "\t\t<include>\n\t\t\t<uri>model://ground_plane</uri>\n\t\t</include>\n\n"
+          << "\t\t<include>\n\t\t\t<uri>model://sun</uri>\n\t\t</include>\n\n";
+
+    for (int i = 0; i < world_models.size(); i++)
+    {
+        const QueuedModel& model = world_models[i];
+        world << "\t\t<include>\n"
+              << "\t\t\t<uri>model://" << model.model_name.toStdString() << "</uri>\n"
+              << "\t\t\t<name>" << model.unique_id.toStdString() << "</name>\n"
+              << "\t\t\t<pose>" << model.x << " " << model.y << " " << model.z << " "
+              << model.roll << " " << model.pitch << " " << model.yaw << "</pose>\n"
+              << "\t\t</include>\n";
+    }
+
+    world << "\n\t\t<plugin name=\"SetupWorld\" filename=\"libgazebo_plugins.so\"/>\n"
+          << "\t</world>\n"
+          << "</sdf>\n";
+    world.close();
+
+    if (!world) return false;
+
+    QFile::remove(path);
+    return QFile::rename(temporary_path, path);
+}
+
+const string& GazeboSimManager::modelSDF(QString model_name)
+{
+    map<QString, string>::iterator it = model_sdf_cache.find(model_name);
+    if (it != model_sdf_cache.end()) return it->second;
+
+    ifstream file((app_root + "/simulation/models/" + model_name + "/model.sdf").toStdString().c_str());
+    stringstream sdf;
+    sdf << file.rdbuf();
+
+    return model_sdf_cache[model_name] = sdf.str();
+}
+
 QString GazeboSimManager::removeModel( QString model_name )
 {
-    QString argument = "rosservice call gazebo/delete_model '{model_name: "+model_name+"}'";
+    Job job = {removeModelCommand(model_name), NULL};
+    vector<Job> jobs(1, job);
+    return runJobs(jobs);
+}
 
-    QProcess sh;
-    sh.start("sh", QStringList() << "-c" << argument);
+QString GazeboSimManager::removeModelCommand( QString model_name )
+{
+    return "rosservice call gazebo/delete_model '{model_name: "+model_name+"}'";
+}
 
-    sh.waitForFinished();
-    QByteArray output = sh.readAll();
-    sh.close();
+QString GazeboSimManager::runQueuedJobs(std::function<void(int, int)> progress)
+{
+    vector<Job> jobs;
+    jobs.swap(queued_jobs);
 
-    QString return_msg = "<br><font color='yellow'>" + output + "</font><br>";
+    return runJobs(jobs, progress);
+}
+
+QString GazeboSimManager::runJobs(vector<Job>& jobs, std::function<void(int, int)> progress)
+{
+    // Each wait is as long as the single waitForFinished() the jobs used to make
+    const int job_timeout = 30000; // ms
+
+    // finished and error are overloaded, so the connections need the signatures spelled out
+    void (QProcess::*finished_signal)(int, QProcess::ExitStatus) = &QProcess::finished;
+    void (QProcess::*error_signal)(QProcess::ProcessError) = &QProcess::error;
+
+    int total = jobs.size();
+    int done = 0;
+
+    vector<QProcess*> processes(total, (QProcess*)NULL);
+    vector<QByteArray> outputs(total);
+    vector<bool> finished(total, false);
+
+    // Processes belong to this thread, so rather than blocking on each of them in turn the jobs are driven from
+    // their finished signals by a local event loop, which returns once the last one has finished. User input
+    // is held back so the GUI cannot start another batch meanwhile.
+    QEventLoop loop;
+
+    std::function<void(int)> finish = [&](int i) {
+        if (finished[i]) return;
+
+        finished[i] = true;
+        outputs[i] = processes[i]->readAll();
+        done++;
+        if (progress) progress(done, total);
+        if (done == total) loop.quit();
+    };
+
+    std::function<void(int)> start = [&](int i) {
+        if (processes[i] != NULL) return;
+
+        QProcess* process = new QProcess();
+        processes[i] = process;
+        QObject::connect(process, finished_signal, [&finish, i](int, QProcess::ExitStatus) { finish(i); });
+        QObject::connect(process, error_signal, [&finish, i](QProcess::ProcessError error) {
+            if (error == QProcess::FailedToStart) finish(i);
+        });
+        // Killing a process that is still running makes it finish. The timer goes with the process.
+        QTimer::singleShot(job_timeout, process, [process]() { process->kill(); });
+        process->start("sh", QStringList() << "-c" << jobs[i].command);
+    };
+
+    for (int i = 0; i < total; i++)
+    {
+        QProcess* wait_for = jobs[i].wait_for;
+        if (wait_for == NULL || wait_for->state() == QProcess::NotRunning)
+        {
+            start(i);
+            continue;
+        }
+
+        QObject::connect(wait_for, finished_signal, [&start, i](int, QProcess::ExitStatus) { start(i); });
+        QTimer::singleShot(job_timeout, wait_for, [wait_for]() { wait_for->kill(); });
+    }
+
+    if (done < total) loop.exec(QEventLoop::ExcludeUserInputEvents);
+
+    QString return_msg;
+    for (int i = 0; i < total; i++)
+    {
+        return_msg += "<br><font color='yellow'>" + outputs[i] + "</font><br>";
+
+        processes[i]->close();
+        delete processes[i];
+        delete jobs[i].wait_for;
+        jobs[i].wait_for = NULL;
+    }
 
     return return_msg;
 }
@@ -343,24 +609,53 @@ QString GazeboSimManager::applyForceToRover(QString rover_name, float x, float y
 // Takes the center x and center y positions of an object along with its clearance and checks if any objects are within that area
 bool GazeboSimManager::isLocationOccupied(float x, float y, float clearance)
 {
-    set<tuple<float, float, float>>::iterator it;
-    for (it = model_locations.begin(); it != model_locations.end(); it++)
+    // Only models whose center is within clearance + max_model_clearance can overlap, so only the cells touching
+    // that square need to be checked.
+    float reach = clearance + max_model_clearance;
+    int min_cell_x = floor((x - reach) / location_cell_size);
+    int max_cell_x = floor((x + reach) / location_cell_size);
+    int min_cell_y = floor((y - reach) / location_cell_size);
+    int max_cell_y = floor((y + reach) / location_cell_size);
+
+    for (int cell_x = min_cell_x; cell_x <= max_cell_x; cell_x++)
     {
-        float used_x = get<0>(*it);
-        float used_y = get<1>(*it);
-        float used_clearance = get<2>(*it);
-
-        // Distance between circle centers
-        float d = sqrt(pow(x-used_x,2)+pow(y-used_y,2));
-        if (d < clearance+used_clearance)
+        for (int cell_y = min_cell_y; cell_y <= max_cell_y; cell_y++)
         {
-            return true;
+            unordered_map< long long, vector< tuple<float, float, float> > >::const_iterator cell = model_locations.find(locationCellKey(cell_x, cell_y));
+            if (cell == model_locations.end()) continue;
+
+            for (vector< tuple<float, float, float> >::const_iterator it = cell->second.begin(); it != cell->second.end(); it++)
+            {
+                float dx = x - get<0>(*it);
+                float dy = y - get<1>(*it);
+                float min_distance = clearance + get<2>(*it);
+
+                // Compare squared distances between circle centers to avoid the square root
+                if (dx*dx + dy*dy < min_distance*min_distance)
+                {
+                    return true;
+                }
+            }
         }
     }
 
     return false;
 }
 
+void GazeboSimManager::addModelLocation(float x, float y, float clearance)
+{
+    int cell_x = floor(x / location_cell_size);
+    int cell_y = floor(y / location_cell_size);
+    model_locations[locationCellKey(cell_x, cell_y)].push_back(make_tuple(x, y, clearance));
+
+    if (clearance > max_model_clearance) max_model_clearance = clearance;
+}
+
+long long GazeboSimManager::locationCellKey(int cell_x, int cell_y)
+{
+    return ((long long)cell_x << 32) | (unsigned int)cell_y;
+}
+
 bool GazeboSimManager::isGazeboServerRunning()
 {
     return gazebo_server_process != NULL;
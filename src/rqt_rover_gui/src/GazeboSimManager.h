@@ -20,10 +20,12 @@
 
 #include <QProcess>
 #include <QString>
+#include <functional>
 #include <map>
-#include <set>
 #include <string>
 #include <tuple>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
@@ -47,6 +49,28 @@ public:
     QString removeModel( QString model_name );
     QString addModel(QString model_name, QString unique_id, float x, float y, float z, float clearance);
     QString addModel(QString model_name, QString unique_id, float x, float y, float z, float R, float P, float Y, float clearance);
+
+    // Bulk spawning. queueModel reserves the location immediately, so isLocationOccupied sees queued models,
+    // but the model is only sent to gazebo by spawnQueuedModels. spawnQueuedModels sends the queued models
+    // through a few persistent connections to the gazebo spawn service instead of starting a spawn_model
+    // process per model. The progress callback is called on the calling thread with the number of models
+    // spawned so far and the total.
+    void queueModel(QString model_name, QString unique_id, float x, float y, float z, float clearance);
+    void queueModel(QString model_name, QString unique_id, float x, float y, float z, float R, float P, float Y, float clearance);
+    QString spawnQueuedModels(std::function<void(int, int)> progress = std::function<void(int, int)>());
+
+    // Writes every model added so far, except rovers, to a gazebo world file at the pose it was added with.
+    // Starting the server with that file rebuilds the same arena and targets without spawning them again.
+    bool saveWorldFile(QString path);
+
+    // Concurrent jobs. The queue functions only record the operation, except that queueAddRover reserves the
+    // location and queueStopRoverNode signals the rover launch process right away. runQueuedJobs then starts
+    // every queued command at once, each in its own shell process, and runs the event loop until all of them
+    // have finished, so a batch takes about as long as its slowest command rather than the sum. The progress callback is called on the calling
+    // thread each time a job finishes with the number of jobs finished so far and the total.
+    void queueAddRover(QString rover_name, float x, float y, float z, float R, float P, float Y);
+    void queueStopRoverNode(QString rover_name);
+    QString runQueuedJobs(std::function<void(int, int)> progress = std::function<void(int, int)>());
     QString moveRover(QString rover_name, float x, float y, float z);
     QString applyForceToRover(QString rover_name, float x, float y, float z, float duration);
     bool isLocationOccupied(float x, float y, float clearence);
@@ -64,9 +88,47 @@ private:
     QProcess* command_process;
     map<QString, QProcess*> rover_processes;
 
+    struct QueuedModel
+    {
+        QString model_name;
+        QString unique_id;
+        float x, y, z, roll, pitch, yaw;
+    };
+
+    vector<QueuedModel> queued_models;
+
+    struct Job
+    {
+        QString command; // Run with sh -c
+        QProcess* wait_for; // If not NULL the command is only started once this process exits. Deleted by runJobs.
+    };
+
+    vector<Job> queued_jobs;
+
+    // Runs the jobs concurrently on the calling thread and returns their output in job order
+    QString runJobs(vector<Job>& jobs, std::function<void(int, int)> progress = std::function<void(int, int)>());
+    QString addRoverCommand(QString rover_name, float x, float y, float z, float R, float P, float Y);
+    Job stopRoverNodeJob(QString rover_name);
+    QString removeModelCommand(QString model_name);
+
+    // Everything but the rovers that was added since the server started, for saveWorldFile
+    vector<QueuedModel> world_models;
+
+    // model.sdf contents by model name, read once per model type
+    map<QString, string> model_sdf_cache;
+    const string& modelSDF(QString model_name);
+
+    // Records a placed model for isLocationOccupied
+    void addModelLocation(float x, float y, float clearance);
+    static long long locationCellKey(int cell_x, int cell_y);
+
     // Contains the positions of objects in the simulation and clearance value (the xy plane radius of the object)
     // center x, center y, clearance
-    set< tuple<float, float, float> > model_locations;
+    // The locations are bucketed into a uniform grid of location_cell_size square cells so an occupancy check
+    // only looks at the cells within reach of the proposed object instead of every placed model.
+    static constexpr float location_cell_size = 0.5; // meters
+    unordered_map< long long, vector< tuple<float, float, float> > > model_locations;
+    float max_model_clearance;
 
     QString custom_world_path;
     
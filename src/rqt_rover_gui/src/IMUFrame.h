@@ -24,6 +24,8 @@
 #include <tuple> //  For standard template library tuples
 #include <utility> // For STL pair
 
+#include "Transform3D.h"
+
 using namespace std;
 
 // ROS rqt requires gui elements be in the UI plugin namespace
@@ -35,6 +37,9 @@ class IMUFrame : public QFrame
     Q_OBJECT
 public:
     IMUFrame(QWidget *parent, Qt::WindowFlags = 0);
+
+    // These are called from the ROS thread and only store the values. The
+    // frame rotates the cube and repaints on the next refresh().
     void setLinearAcceleration(float x, float y, float z);
     void setAngularVelocity(float x, float y, float z);
     void setOrientation(float w, float x, float y, float z);
@@ -46,37 +51,58 @@ signals:
 public slots:
     void rotateTimerEventHandler();
 
+    // Called by the GUI refresh timer. Repaints if new IMU data arrived.
+    void refresh();
+
 
 protected:
 
     void paintEvent(QPaintEvent *event);
 
 private:
-    QPoint cameraTransform( tuple<float, float, float> point_3D, tuple<float, float, float> eye, tuple<float, float, float> camera_position, tuple<float, float, float> camera_angle );
-    tuple<float, float, float> rotateByQuaternion( tuple<float, float, float> point,  tuple<float, float, float, float> quaternion);
-    tuple<float, float, float> inverseRotateByQuaternion( tuple<float, float, float> point,  tuple<float, float, float, float> quaternion);
-    tuple<float, float, float> rotateAboutAxis(tuple<float, float, float> point, float angle,  tuple<float, float, float> axis_of_rotation);
-    float** setUpRotationMatrix(float angle, tuple<float, float, float> axis_rotation); // angle in radians   
-
-    tuple<float, float, float> linear_acceleration; // ROS Geometry Messages Vector3: <x, y, z>
-    tuple<float, float, float> angular_velocity; // ROS Geometry Messages Vector3: <x, y, z>
-    tuple<float, float, float, float> orientation; // ROS Geometry Messages Quaternion: <w, x, y, z>
+    // Projects points in the camera frame onto the screen, relative to the
+    // center of the frame
+    void project(const Vec4* points, QPoint* projected, int count) const;
 
-    // Test points to render
-    tuple<float, float, float> cube[8];
-    tuple<float, float, float> rotated_cube[8];
+    // Rotates the model for the current orientation and projects it and the
+    // acceleration arrow. Returns whether anything moved on the screen.
+    bool updateProjection(bool rotate);
 
-    tuple<float, float, float> line1_start;
-    tuple<float, float, float> line1_end;
+    enum {
+        CUBE = 0, // 8 vertices, 0-3 the top face and 4-7 the bottom face
+        LINE1_START = 8, // bars orthogonal to the yz faces of the cube
+        LINE1_END,
+        LINE2_START,
+        LINE2_END,
+        MODEL_POINTS
+    };
 
-    tuple<float, float, float> line2_start;
-    tuple<float, float, float> line2_end;
+    enum { ACCEL_START = 0, ACCEL_END, ACCEL_HEAD_LEFT, ACCEL_HEAD_RIGHT, ACCEL_POINTS };
 
-    tuple<float, float, float> rotated_line1_start;
-    tuple<float, float, float> rotated_line1_end;
+    tuple<float, float, float> linear_acceleration; // ROS Geometry Messages Vector3: <x, y, z>
+    tuple<float, float, float> angular_velocity; // ROS Geometry Messages Vector3: <x, y, z>
+    tuple<float, float, float, float> orientation; // ROS Geometry Messages Quaternion: <w, x, y, z>
 
-    tuple<float, float, float> rotated_line2_start;
-    tuple<float, float, float> rotated_line2_end;
+    // The cube and bars in the rover frame, and rotated by the orientation
+    Vec4 model[MODEL_POINTS];
+    Vec4 rotated[MODEL_POINTS];
+
+    Mat4 camera; // view transform, fixed
+    Mat4 accel_rotation; // turns the acceleration so z is up and down on the screen
+    float eye_x, eye_y, eye_z;
+
+    // The last projection, redrawn by paintEvent() until something moves
+    QPoint projected_model[MODEL_POINTS];
+    QPoint projected_accel[ACCEL_POINTS];
+    bool top_farthest; // the top face is drawn first
+
+    // The IMU data received since the last refresh
+    tuple<float, float, float> received_linear_acceleration;
+    tuple<float, float, float> received_angular_velocity;
+    tuple<float, float, float, float> received_orientation;
+    bool received_changed;
+    bool received_orientation_changed;
+    QMutex received_mutex;
 
     QTime frame_rate_timer;
     int frames;
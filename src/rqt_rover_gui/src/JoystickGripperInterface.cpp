@@ -1,6 +1,7 @@
 #include "JoystickGripperInterface.h"
 
 #include <std_msgs/Float32.h> // For Gripper ROS messages
+#include <cmath> // For NAN
 
 using namespace std;
 
@@ -31,6 +32,10 @@ JoystickGripperInterface::JoystickGripperInterface(const JoystickGripperInterfac
     this->fingerAngleMin                    = source.fingerAngleMin;
     this->fingerJoystickVector              = source.fingerJoystickVector;
 
+    // Published state
+    this->publishedWristAngle               = source.publishedWristAngle;
+    this->publishedFingerAngle              = source.publishedFingerAngle;
+
     this->nh                                = source.nh;
 }
 
@@ -62,6 +67,10 @@ JoystickGripperInterface::JoystickGripperInterface(ros::NodeHandle nh, string ro
     // Representation of the desired movement speed and direction generated by the joystick
     fingerJoystickVector = 0.0;
     wristJoystickVector = 0.0;
+
+    // Nothing sent yet, so the first angles always go out
+    publishedWristAngle = NAN;
+    publishedFingerAngle = NAN;
     
     // Setup the gripper angle command publishers
     gripperWristAnglePublisher = nh.advertise<std_msgs::Float32>("/"+roverName+"/wristAngle/cmd", 10, this);
@@ -91,6 +100,10 @@ void JoystickGripperInterface::moveWrist(float vec) {
     // negative exponents confuse the downstream conversion to string
     if (fabs(wristAngle) < 0.001) wristAngle = 0.0f;
 
+    // Only send angles that changed, the joystick is sampled at a fixed rate
+    if (wristAngle == publishedWristAngle) return;
+    publishedWristAngle = wristAngle;
+
     std_msgs::Float32 angleMsg;
     angleMsg.data = wristAngle;
     gripperWristAnglePublisher.publish(angleMsg);
@@ -117,7 +130,10 @@ void JoystickGripperInterface::moveFingers(float vec){
     // negative exponents confuse the downstream conversion to string
     if (fabs(fingerAngle) < 0.001) fingerAngle = 0.0f;
 
-    // Publish the finger angle commands
+    // Publish the finger angle commands that changed
+    if (fingerAngle == publishedFingerAngle) return;
+    publishedFingerAngle = fingerAngle;
+
     std_msgs::Float32 angleMsg;
     angleMsg.data = fingerAngle;
     gripperFingerAnglePublisher.publish(angleMsg);
@@ -139,6 +155,10 @@ void JoystickGripperInterface::changeRovers(string roverName)
     fingerJoystickVector = 0.0;
     wristJoystickVector = 0.0;
 
+    // The new rover gets the angles even if they match the old one's
+    publishedWristAngle = NAN;
+    publishedFingerAngle = NAN;
+
     this->roverName = roverName;
 
     // Setup the gripper angle command publishers
@@ -11,7 +11,9 @@
 // This file recieves input from a Microsoft Xbox 360 compatable joystick
 // and sends actuation commands to the gripper ROS topics.
 // A local autorepeat is implemented so that when users are holding the control
-// stick at a constant position the gripper continues to move.
+// stick at a constant position the gripper continues to move: RoverGUIPlugin
+// samples the stick at a fixed rate and calls the move functions every time.
+// Angles that did not change are not sent again.
 // This meets user expectations about how joysticks should work without
 // enabling autorepeat at the ROS driver level. Autorepeat at the driver level
 // causes high CPU usage and causes the drive joystick to also repeat (where it is not
@@ -79,6 +81,9 @@ private:
     // The finger movements are symmetric so we just refer to one finger angle etc
     float fingerAngle, fingerAngleChangeRate, fingerAngleMax, fingerAngleMin, fingerJoystickVector;
 
+    // The angles last sent, NAN before the first
+    float publishedWristAngle, publishedFingerAngle;
+
     std::string roverName;
 
     ros::NodeHandle nh;
@@ -0,0 +1,165 @@
+#include "LogModel.h"
+
+#include <QColor>
+#include <QMutexLocker>
+#include <QRegExp>
+#include <QTextDocumentFragment>
+
+using namespace std;
+
+namespace rqt_rover_gui
+{
+
+// How many of the newest lines a new line is compared with for collapsing.
+// More than one so the same message from several rovers collapses too.
+static const size_t collapse_window = 16;
+
+LogModel::LogModel(int max_lines, QObject* parent) : QAbstractListModel(parent)
+{
+  this->max_lines = max_lines;
+}
+
+void LogModel::collapse(deque<Line>& lines, const QString& text, int count)
+{
+  size_t first = lines.size() > collapse_window ? lines.size() - collapse_window : 0;
+  for (size_t i = lines.size(); i > first; i--)
+  {
+    if (lines[i-1].text == text)
+    {
+      lines[i-1].count += count;
+      return;
+    }
+  }
+
+  Line line;
+  line.text = text;
+  line.color = QColor(Qt::white);
+  line.count = count;
+  lines.push_back(line);
+}
+
+void LogModel::stripMarkup(Line& line)
+{
+  if (!line.text.contains('<')) return;
+
+  // The severity of a message is only in its markup, e.g.
+  // <font color='red'> for errors, so the colour is read before it goes
+  QRegExp font_color("<font[^>]*color\\s*=\\s*['\"]?([#\\w]+)", Qt::CaseInsensitive);
+  if (font_color.indexIn(line.text) >= 0)
+  {
+    QColor color(font_color.cap(1).toLower());
+    if (color.isValid()) line.color = color;
+  }
+
+  line.text = QTextDocumentFragment::fromHtml(line.text).toPlainText();
+}
+
+void LogModel::append(QString line)
+{
+  if (line.isEmpty()) line = "Message is empty";
+
+  QMutexLocker locker(&pending_mutex);
+
+  collapse(pending, line, 1);
+
+  // If the GUI thread falls behind keep only the newest lines
+  while (pending.size() > (size_t)max_lines) pending.pop_front();
+}
+
+void LogModel::flush()
+{
+  deque<Line> batch;
+  {
+    QMutexLocker locker(&pending_mutex);
+    batch.swap(pending);
+  }
+
+  if (batch.empty()) return;
+
+  // Markup is removed here rather than in append() so the ROS threads only
+  // copy the string
+  for (Line& line : batch)
+  {
+    stripMarkup(line);
+  }
+
+  // Count repeats of the lines already shown against those rows, so only
+  // really new lines are inserted
+  size_t existing = lines.size();
+  size_t first_changed = existing;
+  size_t last_changed = 0;
+
+  vector<Line> new_lines;
+  for (const Line& line : batch)
+  {
+    size_t first = existing > collapse_window ? existing - collapse_window : 0;
+    size_t match = existing;
+    for (size_t i = existing; i > first; i--)
+    {
+      if (lines[i-1].text == line.text && lines[i-1].color == line.color)
+      {
+        match = i-1;
+        break;
+      }
+    }
+
+    if (match < existing)
+    {
+      lines[match].count += line.count;
+      if (match < first_changed) first_changed = match;
+      if (match > last_changed) last_changed = match;
+    }
+    else
+    {
+      new_lines.push_back(line);
+    }
+  }
+
+  if (first_changed < existing)
+  {
+    emit dataChanged(index(first_changed), index(last_changed));
+  }
+
+  if (!new_lines.empty())
+  {
+    beginInsertRows(QModelIndex(), existing, existing + new_lines.size() - 1);
+    lines.insert(lines.end(), new_lines.begin(), new_lines.end());
+    endInsertRows();
+  }
+
+  if (lines.size() > (size_t)max_lines)
+  {
+    size_t excess = lines.size() - max_lines;
+    beginRemoveRows(QModelIndex(), 0, excess - 1);
+    lines.erase(lines.begin(), lines.begin() + excess);
+    endRemoveRows();
+  }
+
+  emit linesAdded();
+}
+
+int LogModel::rowCount(const QModelIndex& parent) const
+{
+  return parent.isValid() ? 0 : lines.size();
+}
+
+QVariant LogModel::data(const QModelIndex& index, int role) const
+{
+  if (!index.isValid() || index.row() >= (int)lines.size()) return QVariant();
+
+  const Line& line = lines[index.row()];
+
+  if (role == Qt::DisplayRole)
+  {
+    if (line.count > 1) return line.text + " (x" + QString::number(line.count) + ")";
+    return line.text;
+  }
+  else if (role == Qt::ForegroundRole)
+  {
+    return line.color;
+  }
+
+  return QVariant();
+}
+
+}
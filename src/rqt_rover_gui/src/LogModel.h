@@ -0,0 +1,68 @@
+/*!
+ * \brief  A bounded list of log lines for the info and diagnostics log panes.
+ *         Lines can be appended from any thread; they are added to the model
+ *         in one batch when the GUI thread calls flush(). Repeats of a recent
+ *         line are collapsed into that line with an "xN" count, and only the
+ *         newest max_lines lines are kept, so bursts of the same message from
+ *         many rovers cost one row update per refresh.
+ * \class  LogModel
+ */
+
+#ifndef LOGMODEL_H
+#define LOGMODEL_H
+
+#include <deque>
+#include <vector>
+#include <QAbstractListModel>
+#include <QColor>
+#include <QMutex>
+#include <QString>
+
+namespace rqt_rover_gui
+{
+  class LogModel : public QAbstractListModel {
+    Q_OBJECT
+
+    public:
+      LogModel(int max_lines = 1000, QObject* parent = 0);
+
+      // Thread safe. The line is kept as given until flush(), which removes
+      // the HTML markup and shows the line in the colour of its first
+      // <font color=...> tag, white without one.
+      void append(QString line);
+
+      int rowCount(const QModelIndex& parent = QModelIndex()) const;
+      QVariant data(const QModelIndex& index, int role = Qt::DisplayRole) const;
+
+    signals:
+      // Emitted by flush() when it added or changed lines
+      void linesAdded();
+
+    public slots:
+      // Adds the lines appended since the last flush. Call from the GUI thread.
+      void flush();
+
+    private:
+      struct Line {
+        QString text;
+        QColor color;
+        int count;
+      };
+
+      // Adds the text to lines, or counts it against one of the last few
+      // lines if it repeats it
+      static void collapse(std::deque<Line>& lines, const QString& text, int count);
+
+      // Replaces the markup of the line's text with its plain text and colour
+      static void stripMarkup(Line& line);
+
+      int max_lines;
+
+      std::deque<Line> lines; // Only used by the GUI thread
+
+      std::deque<Line> pending; // Guarded by pending_mutex
+      QMutex pending_mutex;
+  };
+}
+
+#endif // LOGMODEL_H
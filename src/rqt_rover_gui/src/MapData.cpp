@@ -2,31 +2,58 @@
 
 using namespace std;
 
+void RoverMapData::clear()
+{
+    gps_path.clear();
+    ekf_path.clear();
+    encoder_path.clear();
+
+    gps_bounds = PathBounds();
+    ekf_bounds = PathBounds();
+    encoder_bounds = PathBounds();
+
+    waypoint_path.clear();
+    target_locations.clear();
+    collection_points.clear();
+    mode = 0;
+    generation++;
+}
+
 MapData::MapData()
 {
     display_global_offset = false;
+    waypoint_id_counter = 0;
 }
 
-void MapData::addToGPSRoverPath(string rover, float x, float y)
+RoverMapData* MapData::getRover(string rover_name)
 {
-  // Negate the y direction to orient the map so up is north.
-  y = -y;
+    {
+        QReadLocker locker(&rovers_lock);
+        map<string, int>::iterator found = rover_ids.find(rover_name);
+        if (found != rover_ids.end()) return rovers[found->second].get();
+    }
 
-    if (x > max_gps_seen_x[rover]) max_gps_seen_x[rover] = x;
-    if (y > max_gps_seen_y[rover]) max_gps_seen_y[rover] = y;
-    if (x < min_gps_seen_x[rover]) min_gps_seen_x[rover] = x;
-    if (y < min_gps_seen_y[rover]) min_gps_seen_y[rover] = y;
+    QWriteLocker locker(&rovers_lock);
 
-    update_mutex.lock();
+    // Another thread may have added the rover while we waited for the lock
+    map<string, int>::iterator found = rover_ids.find(rover_name);
+    if (found != rover_ids.end()) return rovers[found->second].get();
 
-    float offset_x = rover_global_offsets[rover].first;
-    float offset_y = rover_global_offsets[rover].second;
-    global_offset_gps_rover_path[rover].push_back(pair<float,float>(x+offset_x,y-offset_y));
+    rover_ids[rover_name] = rovers.size();
+    rovers.push_back(unique_ptr<RoverMapData>(new RoverMapData()));
+    return rovers.back().get();
+}
 
-    gps_rover_path[rover].push_back(pair<float,float>(x,y));
+void MapData::addToGPSRoverPath(string rover, float x, float y)
+{
+  // Negate the y direction to orient the map so up is north.
+  y = -y;
 
-    update_mutex.unlock();
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
 
+    data->gps_bounds.add(x,y);
+    data->gps_path.add(x,y);
 }
 
 void MapData::addToEncoderRoverPath(string rover, float x, float y)
@@ -34,21 +61,11 @@ void MapData::addToEncoderRoverPath(string rover, float x, float y)
   // Negate the y direction to orient the map so up is north.
   y = -y;
 
-    if (x > max_encoder_seen_x[rover]) max_encoder_seen_x[rover] = x;
-    if (y > max_encoder_seen_y[rover]) max_encoder_seen_y[rover] = y;
-    if (x < min_encoder_seen_x[rover]) min_encoder_seen_x[rover] = x;
-    if (y < min_encoder_seen_y[rover]) min_encoder_seen_y[rover] = y;
-
-    update_mutex.lock();
-
-    float offset_x = rover_global_offsets[rover].first;
-    float offset_y = rover_global_offsets[rover].second;
-    global_offset_encoder_rover_path[rover].push_back(pair<float,float>(x+offset_x,y-offset_y));
-
-    encoder_rover_path[rover].push_back(pair<float,float>(x,y));
-
-    update_mutex.unlock();
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
 
+    data->encoder_bounds.add(x,y);
+    data->encoder_path.add(x,y);
 }
 
 // Expects the input y to be flipped with respect to y the map coordinate system
@@ -57,79 +74,80 @@ void MapData::addToEKFRoverPath(string rover, float x, float y)
   // Negate the y direction to orient the map so up is north.
   y = -y;
 
-    if (x > max_ekf_seen_x[rover]) max_ekf_seen_x[rover] = x;
-    if (y > max_ekf_seen_y[rover]) max_ekf_seen_y[rover] = y;
-    if (x < min_ekf_seen_x[rover]) min_ekf_seen_x[rover] = x;
-    if (y < min_ekf_seen_y[rover]) min_ekf_seen_y[rover] = y;
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
 
-    update_mutex.lock();
-
-    float offset_x = rover_global_offsets[rover].first;
-    float offset_y = rover_global_offsets[rover].second;
-    global_offset_ekf_rover_path[rover].push_back(pair<float,float>(x+offset_x,y-offset_y));
+    data->ekf_bounds.add(x,y);
+    data->ekf_path.add(x,y);
+}
 
-    ekf_rover_path[rover].push_back(pair<float,float>(x,y));
+void MapData::addToRoverPath(string rover, int source, const float* x, const float* y, size_t count)
+{
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
 
-    update_mutex.unlock();
+    RoverPath* path;
+    PathBounds* bounds;
+    switch (source)
+    {
+    case 0: path = &data->encoder_path; bounds = &data->encoder_bounds; break;
+    case 1: path = &data->ekf_path; bounds = &data->ekf_bounds; break;
+    case 2: path = &data->gps_path; bounds = &data->gps_bounds; break;
+    default: return;
+    }
 
+    for (size_t i = 0; i < count; i++)
+    {
+        // Negate the y direction to orient the map so up is north.
+        bounds->add(x[i], -y[i]);
+        path->add(x[i], -y[i]);
+    }
 }
 
 // Expects the input y to be consistent with the map coordinate system
 int MapData::addToWaypointPath(string rover, float x, float y)
 {
-  update_mutex.lock();
-
-  float offset_x = rover_global_offsets[rover].first;
-  float offset_y = rover_global_offsets[rover].second;
   int this_id = waypoint_id_counter++; // Get the next waypoint id.
 
-  global_offset_waypoint_path[rover][this_id]=make_tuple(x+offset_x,y-offset_y,false);
-  waypoint_path[rover][this_id]=make_tuple(x,y,false);
+  RoverMapData* data = getRover(rover);
+  QWriteLocker locker(&data->lock);
 
-  update_mutex.unlock();
+  data->waypoint_path[this_id]=make_tuple(x,y,false);
 
   return this_id;
 }
 
 void MapData::removeFromWaypointPath(std::string rover, int id)
 {
-  update_mutex.lock();
-
-  global_offset_waypoint_path[rover].erase(id);
-  waypoint_path[rover].erase(id);
+  RoverMapData* data = getRover(rover);
+  QWriteLocker locker(&data->lock);
 
-  update_mutex.unlock();
+  data->waypoint_path.erase(id);
 }
 
 void MapData::reachedWaypoint(int waypoint_id)
 {
-  update_mutex.lock();
-
-  // Update the reached waypoint in both the normal waypoint path AND the global
-  // waypoint path. We must update both to prevent incorrect color display for
-  // reached waypoints when switching back and forth between the global frame.
+  QReadLocker rovers_locker(&rovers_lock);
 
-  for (auto &rover : global_offset_waypoint_path)
+  for (auto &data : rovers)
   {
+    QWriteLocker locker(&data->lock);
+
     map<int, std::tuple<float,float,bool>>::iterator found;
 
-    if ((found = rover.second.find(waypoint_id)) != rover.second.end())
+    if ((found = data->waypoint_path.find(waypoint_id)) != data->waypoint_path.end())
     {
       get<2>(found->second) = true;
     }
   }
+}
 
-  for (auto &rover : waypoint_path)
-  {
-    map<int, std::tuple<float,float,bool>>::iterator found;
+size_t MapData::getWaypointCount(string rover_name)
+{
+  RoverMapData* data = getRover(rover_name);
+  QReadLocker locker(&data->lock);
 
-    if ((found = rover.second.find(waypoint_id)) != rover.second.end())
-    {
-      get<2>(found->second) = true;
-    }
-  }
-   
-  update_mutex.unlock();
+  return data->waypoint_path.size();
 }
 
 void MapData::addTargetLocation(string rover, float x, float y)
@@ -137,10 +155,9 @@ void MapData::addTargetLocation(string rover, float x, float y)
   //The QT drawing coordinate system is reversed from the robot coordinate system in the y direction
     y = -y;
 
-    update_mutex.lock();
-    target_locations[rover].push_back(pair<float,float>(x,y));
-    update_mutex.unlock();
-
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
+    data->target_locations.push_back(pair<float,float>(x,y));
 }
 
 
@@ -149,10 +166,9 @@ void MapData::addCollectionPoint(string rover, float x, float y)
     // The QT drawing coordinate system is reversed from the robot coordinate system in the y direction
     y = -y;
 
-    update_mutex.lock();
-    collection_points[rover].push_back(pair<float,float>(x,y));
-    update_mutex.unlock();
-
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
+    data->collection_points.push_back(pair<float,float>(x,y));
 }
 
 void MapData::setGlobalOffset(bool display)
@@ -162,275 +178,92 @@ void MapData::setGlobalOffset(bool display)
 
 void MapData::setGlobalOffsetForRover(string rover, float x, float y)
 {
-    rover_global_offsets[rover] = pair<float,float>(x,y);
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
+    data->global_offset = pair<float,float>(x,y);
 }
 
 std::pair<float,float> MapData::getGlobalOffsetForRover(string rover)
 {
-  return rover_global_offsets[rover];
-}
-
-bool MapData::isDisplayingGlobalOffset()
-{
-  return display_global_offset;
+  RoverMapData* data = getRover(rover);
+  QReadLocker locker(&data->lock);
+  return data->global_offset;
 }
 
-void MapData::clear()
+// Offsets are applied when drawing so the data is only stored once. The y
+// offset is subtracted because the stored y is negated.
+std::pair<float,float> MapData::getDisplayOffset(const RoverMapData* rover)
 {
-    update_mutex.lock();
-
-    ekf_rover_path.clear();
-    encoder_rover_path.clear();
-    gps_rover_path.clear();
-    waypoint_path.clear();
-
-    global_offset_ekf_rover_path.clear();
-    global_offset_encoder_rover_path.clear();
-    global_offset_gps_rover_path.clear();
-    global_offset_waypoint_path.clear();
-
-    target_locations.clear();
-    collection_points.clear();
-    waypoint_path.clear();
-    rover_mode.clear();
+  if (!display_global_offset) return pair<float,float>(0,0);
 
-    update_mutex.unlock();
+  return pair<float,float>(rover->global_offset.first, -rover->global_offset.second);
 }
 
-void MapData::clear(string rover)
+bool MapData::isDisplayingGlobalOffset()
 {
-    update_mutex.lock();
-
-    ekf_rover_path[rover].clear();
-    global_offset_ekf_rover_path[rover].clear();
-    ekf_rover_path.erase(rover);
-    global_offset_ekf_rover_path.erase(rover);
-
-    encoder_rover_path[rover].clear();
-    global_offset_encoder_rover_path[rover].clear();
-    encoder_rover_path.erase(rover);
-    global_offset_encoder_rover_path.erase(rover);
-
-    gps_rover_path[rover].clear();
-    global_offset_gps_rover_path[rover].clear();
-    gps_rover_path.erase(rover);
-    global_offset_gps_rover_path.erase(rover);
-
-    waypoint_path[rover].clear();
-    global_offset_waypoint_path[rover].clear();
-    waypoint_path.erase(rover);
-    global_offset_waypoint_path.erase(rover);
-
-    target_locations[rover].clear();
-    collection_points[rover].clear();
-    target_locations.erase(rover);
-    collection_points.erase(rover);
-    rover_mode.erase(rover);
-
-    update_mutex.unlock();
+  return display_global_offset;
 }
 
-std::vector< std::pair<float,float> >* MapData::getEKFPath(std::string rover_name)
+void MapData::clear()
 {
-    if(display_global_offset)
-    {
-        return &global_offset_ekf_rover_path[rover_name];
-    }
+    QReadLocker rovers_locker(&rovers_lock);
 
-    return &ekf_rover_path[rover_name];
-}
-
-std::vector< std::pair<float,float> >* MapData::getGPSPath(std::string rover_name)
-{
-    if(display_global_offset)
+    for (auto &data : rovers)
     {
-        return &global_offset_gps_rover_path[rover_name];
+        QWriteLocker locker(&data->lock);
+        data->clear();
     }
-
-    return &gps_rover_path[rover_name];
 }
 
-std::vector< std::pair<float,float> >* MapData::getEncoderPath(std::string rover_name)
-{
-    if(display_global_offset)
-    {
-        return &global_offset_encoder_rover_path[rover_name];
-    }
-
-    return &encoder_rover_path[rover_name];
-}
-
-std::vector< std::pair<float,float> >* MapData::getTargetLocations(std::string rover_name)
-{
-    return &target_locations[rover_name];
-}
-
-std::vector< std::pair<float,float> >* MapData::getCollectionPoints(std::string rover_name)
+void MapData::clear(string rover)
 {
-    return &collection_points[rover_name];
-}
-
-std::map<int, std::tuple<float,float,bool> >* MapData::getWaypointPath(std::string rover_name) {
-    if(display_global_offset)
-    {
-      return &global_offset_waypoint_path[rover_name];
-    }
-
-    return &waypoint_path[rover_name];
+    RoverMapData* data = getRover(rover);
+    QWriteLocker locker(&data->lock);
+    data->clear();
 }
 
 void MapData::resetAllWaypointPaths()
 {
-    waypoint_path.clear();
-    global_offset_waypoint_path.clear();
-    waypoint_id_counter = 0;
-}
-
-void MapData::resetWaypointPathForSelectedRover(std::string rover)
-{
-   waypoint_path[rover].clear();
-   global_offset_waypoint_path[rover].clear();
-}
-
-// These functions report the maximum and minimum map values seen. This is useful for the GUI when it is calculating the map coordinate system.
-float MapData::getMaxGPSX(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return max_gps_seen_x[rover_name] + rover_global_offsets[rover_name].first;
-    }
-
-    return max_gps_seen_x[rover_name];
-}
-
-float MapData::getMaxGPSY(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return max_gps_seen_y[rover_name] - rover_global_offsets[rover_name].second;
-    }
-
-    return max_gps_seen_y[rover_name];
-}
-
-float MapData::getMinGPSX(string rover_name)
-{
-    if(display_global_offset)
     {
-        return min_gps_seen_x[rover_name] + rover_global_offsets[rover_name].first;
-    }
+        QReadLocker rovers_locker(&rovers_lock);
 
-    return min_gps_seen_x[rover_name];
-}
-
-float MapData::getMinGPSY(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return min_gps_seen_y[rover_name] - rover_global_offsets[rover_name].second;
+        for (auto &data : rovers)
+        {
+            QWriteLocker locker(&data->lock);
+            data->waypoint_path.clear();
+        }
     }
 
-    return min_gps_seen_y[rover_name];
-}
-
-float MapData::getMaxEKFX(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return max_ekf_seen_x[rover_name] + rover_global_offsets[rover_name].first;
-    }
-
-    return max_ekf_seen_x[rover_name];
-}
-
-float MapData::getMaxEKFY(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return max_ekf_seen_y[rover_name] - rover_global_offsets[rover_name].second;
-    }
-
-    return max_ekf_seen_y[rover_name];
-}
-
-float MapData::getMinEKFX(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return min_ekf_seen_x[rover_name] + rover_global_offsets[rover_name].first;
-    }
-
-    return min_ekf_seen_x[rover_name];
-}
-
-float MapData::getMinEKFY(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return min_ekf_seen_y[rover_name] - rover_global_offsets[rover_name].second;
-    }
-
-    return min_ekf_seen_y[rover_name];
-}
-
-float MapData::getMaxEncoderX(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return max_encoder_seen_x[rover_name] + rover_global_offsets[rover_name].first;
-    }
-
-    return max_encoder_seen_x[rover_name];
-}
-
-float MapData::getMaxEncoderY(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return max_encoder_seen_y[rover_name] - rover_global_offsets[rover_name].second;
-    }
-
-    return max_encoder_seen_y[rover_name];
-}
-
-float MapData::getMinEncoderX(string rover_name)
-{
-    if(display_global_offset)
-    {
-        return min_encoder_seen_x[rover_name] + rover_global_offsets[rover_name].first;
-    }
-
-    return min_encoder_seen_x[rover_name];
+    waypoint_id_counter = 0;
 }
 
-float MapData::getMinEncoderY(string rover_name)
+void MapData::resetWaypointPathForSelectedRover(std::string rover)
 {
-    if(display_global_offset)
-    {
-        return min_encoder_seen_y[rover_name] - rover_global_offsets[rover_name].second;
-    }
-
-    return min_encoder_seen_y[rover_name];
+   RoverMapData* data = getRover(rover);
+   QWriteLocker locker(&data->lock);
+   data->waypoint_path.clear();
 }
 
 bool MapData::inManualMode(string rover_name)
 {
-   return rover_mode[rover_name] == 0;
+   RoverMapData* data = getRover(rover_name);
+   QReadLocker locker(&data->lock);
+   return data->mode == 0;
 }
 
 void MapData::setAutonomousMode(string rover_name)
 {
-   update_mutex.lock();
-   rover_mode[rover_name] = 1;
-   resetWaypointPathForSelectedRover(rover_name);
-   update_mutex.unlock();
+   RoverMapData* data = getRover(rover_name);
+   QWriteLocker locker(&data->lock);
+   data->mode = 1;
+   data->waypoint_path.clear();
 }
 
 void MapData::setManualMode(string rover_name)
 {
-   update_mutex.lock();
-   rover_mode[rover_name] = 0;
-   update_mutex.unlock();
+   RoverMapData* data = getRover(rover_name);
+   QWriteLocker locker(&data->lock);
+   data->mode = 0;
 }
 
 void MapData::lock()
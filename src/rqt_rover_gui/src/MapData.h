@@ -5,15 +5,69 @@
 #include <set>
 #include <utility> // For STL std::pair
 #include <map>
+#include <memory>
 #include <tuple>
 #include <string>
+#include <atomic>
 #include <QMutex>
+#include <QReadWriteLock>
+
+#include "RoverPath.h"
+
+// The extent of a path in map coordinates. Like the map origin it always
+// includes (0,0).
+struct PathBounds {
+    float min_x = 0;
+    float max_x = 0;
+    float min_y = 0;
+    float max_y = 0;
+
+    void add(float x, float y)
+    {
+        if (x > max_x) max_x = x;
+        if (y > max_y) max_y = y;
+        if (x < min_x) min_x = x;
+        if (y < min_y) min_y = y;
+    }
+};
+
+// Everything the map shows for one rover. The ROS callbacks hold a write lock
+// while they change it and MapFrame holds a read lock while drawing it, so
+// adding to one rover never waits for a repaint of another and repaints only
+// wait for the single point being added.
+struct RoverMapData {
+    QReadWriteLock lock;
+
+    RoverPath gps_path;
+    RoverPath ekf_path;
+    RoverPath encoder_path;
+
+    PathBounds gps_bounds;
+    PathBounds ekf_bounds;
+    PathBounds encoder_bounds;
+
+    std::map< int, std::tuple<float,float,bool> > waypoint_path;
+    std::vector< std::pair<float,float> > target_locations;
+    std::vector< std::pair<float,float> > collection_points;
+
+    std::pair<float,float> global_offset = std::pair<float,float>(0,0);
+    int mode = 0;
 
-#include "MapData.h"
+    // Changes whenever the paths are cleared, so a view that has drawn the
+    // paths knows it has to start again
+    unsigned long generation = 0;
+
+    // Clears everything but the global offset. Hold the write lock.
+    void clear();
+};
 
 // This class is the "model" for std::map frame in the model-view UI pattern,
 // where std::mapFrame is the view.
 // This allows the creation of multiple std::maps without duplicating large amounts of std::map data.
+//
+// Rovers are interned: the first use of a rover name creates its
+// RoverMapData, which then lives as long as the MapData so pointers to it
+// can be kept without holding any lock on the rover table.
 class MapData
 {
 public:
@@ -22,6 +76,11 @@ public:
     void addToGPSRoverPath(std::string rover, float x, float y);
     void addToEncoderRoverPath(std::string rover, float x, float y);
     void addToEKFRoverPath(std::string rover, float x, float y);
+
+    // Adds count points to one of the rover's paths under a single lock.
+    // Source is numbered like the sources in PathBatch.msg.
+    void addToRoverPath(std::string rover, int source, const float* x, const float* y, size_t count);
+
     void addTargetLocation(std::string rover, float x, float y);
     void addCollectionPoint(std::string rover, float x, float y);
 
@@ -37,37 +96,27 @@ public:
     std::pair<float,float> getGlobalOffsetForRover(std::string rover);
     bool isDisplayingGlobalOffset();
 
+    // The offset to add to the rover's stored points and bounds when drawing
+    // them. Hold the rover's read lock.
+    std::pair<float,float> getDisplayOffset(const RoverMapData* rover);
+
     void clear();
     void clear(std::string rover_name);
+
+    // Guards MapFrame's display list. Not needed to access rover data.
     void lock();
     void unlock();
 
-    std::vector< std::pair<float,float> >* getEKFPath(std::string rover_name);
-    std::vector< std::pair<float,float> >* getGPSPath(std::string rover_name);
-    std::vector< std::pair<float,float> >* getEncoderPath(std::string rover_name);
-    std::vector< std::pair<float,float> >* getTargetLocations(std::string rover_name);
-    std::vector< std::pair<float,float> >* getCollectionPoints(std::string rover_name);
-    std::map< int, std::tuple<float,float,bool> >* getWaypointPath(std::string rover_name);
+    // Returns the data for the rover, creating it on first use. Hold the
+    // rover's lock while reading or changing it.
+    RoverMapData* getRover(std::string rover_name);
+
+    // Number of waypoints, for log messages
+    size_t getWaypointCount(std::string rover_name);
 
     void resetAllWaypointPaths();
     void resetWaypointPathForSelectedRover(std::string rover);
 
-    // These functions provide a fast way to get the min and max coords
-    float getMaxGPSX(std::string rover_name);
-    float getMaxGPSY(std::string rover_name);
-    float getMinGPSX(std::string rover_name);
-    float getMinGPSY(std::string rover_name);
-
-    float getMaxEKFX(std::string rover_name);
-    float getMaxEKFY(std::string rover_name);
-    float getMinEKFX(std::string rover_name);
-    float getMinEKFY(std::string rover_name);
-
-    float getMaxEncoderX(std::string rover_name);
-    float getMaxEncoderY(std::string rover_name);
-    float getMinEncoderX(std::string rover_name);
-    float getMinEncoderY(std::string rover_name);
-
     bool inManualMode(std::string rover_name);
     void setAutonomousMode(std::string rover_name);
     void setManualMode(std::string rover_name);
@@ -76,44 +125,16 @@ public:
 
 private:
 
-    std::map<std::string, std::pair<float,float> > rover_global_offsets;
-
-    std::map<std::string, std::vector< std::pair<float,float> > > gps_rover_path;
-    std::map<std::string, std::vector< std::pair<float,float> > > ekf_rover_path;
-    std::map<std::string, std::vector< std::pair<float,float> > > encoder_rover_path;
-    std::map<std::string, std::map< int, std::tuple<float,float,bool> > >  waypoint_path;
-
-    std::map<std::string, std::vector< std::pair<float,float> > > global_offset_gps_rover_path;
-    std::map<std::string, std::vector< std::pair<float,float> > > global_offset_ekf_rover_path;
-    std::map<std::string, std::vector< std::pair<float,float> > > global_offset_encoder_rover_path;
-    std::map<std::string, std::map< int, std::tuple<float,float,bool> > >  global_offset_waypoint_path;
-
-    std::map<std::string, std::vector< std::pair<float,float> > >  collection_points;
-    std::map<std::string, std::vector< std::pair<float,float> > >  target_locations;
-
-    std::map<std::string, float> max_gps_seen_x;
-    std::map<std::string, float> max_gps_seen_y;
-    std::map<std::string, float> min_gps_seen_x;
-    std::map<std::string, float> min_gps_seen_y;
-
-    std::map<std::string, float> max_encoder_seen_x;
-    std::map<std::string, float> max_encoder_seen_y;
-    std::map<std::string, float> min_encoder_seen_x;
-    std::map<std::string, float> min_encoder_seen_y;
-
-    std::map<std::string, float> max_ekf_seen_x;
-    std::map<std::string, float> max_ekf_seen_y;
-    std::map<std::string, float> min_ekf_seen_x;
-    std::map<std::string, float> min_ekf_seen_y;
-
-    bool display_global_offset;
+    // Interned rovers, indexed by the id in rover_ids
+    std::map<std::string, int> rover_ids;
+    std::vector< std::unique_ptr<RoverMapData> > rovers;
+    QReadWriteLock rovers_lock; // Guards rover_ids and rovers, not the rover data
 
-    QMutex update_mutex; // To prevent race conditions when the data is being displayed by MapFrame
+    std::atomic<bool> display_global_offset;
 
-    std::string currently_selected_rover;
-    std::map<std::string, int> rover_mode;
+    QMutex update_mutex; // Guards MapFrame's display list, see lock()
 
-    int waypoint_id_counter = 0;
+    std::atomic<int> waypoint_id_counter;
 };
 
 #endif // MAPDATA_H
@@ -8,12 +8,24 @@
 #include <QGridLayout>
 #include <QLabel>
 #include <QMouseEvent>
+#include <QReadLocker>
 #include <MapData.h>
 #include "MapFrame.h"
+#include "MapGLView.h"
 
 namespace rqt_rover_gui
 {
 
+// Widens the min and max seen values to include the bounds of a path, moved
+// by the offset the path is displayed at.
+static void includeBounds(const PathBounds& bounds, pair<float,float> offset, float& min_x, float& min_y, float& max_x, float& max_y)
+{
+  if (min_x > bounds.min_x + offset.first) min_x = bounds.min_x + offset.first;
+  if (min_y > bounds.min_y + offset.second) min_y = bounds.min_y + offset.second;
+  if (max_x < bounds.max_x + offset.first) max_x = bounds.max_x + offset.first;
+  if (max_y < bounds.max_y + offset.second) max_y = bounds.max_y + offset.second;
+}
+
 MapFrame::MapFrame(QWidget *parent, Qt::WindowFlags flags) : QFrame(parent)
 {
   connect(this, SIGNAL(delayedUpdate()), this, SLOT(update()), Qt::QueuedConnection);
@@ -48,6 +60,8 @@ MapFrame::MapFrame(QWidget *parent, Qt::WindowFlags flags) : QFrame(parent)
   popout_window = NULL;
 
   map_data = NULL;
+  gl_view = NULL;
+  map_data_changed = false;
 
   // Trigger mouseMoveEvent even when button not pressed
   setMouseTracking(true);
@@ -83,8 +97,15 @@ void MapFrame::createPopoutWindow( MapData * map_data )
 }
 
 void MapFrame::paintEvent(QPaintEvent* event) {
-  // Begin drawing the map
+  // The OpenGL view covers the frame and draws the map itself
+  if (gl_view) return;
+
   QPainter painter(this);
+  paintMap(painter, NULL);
+}
+
+void MapFrame::paintMap(QPainter& painter, MapGLView* gl) {
+  // Begin drawing the map
   painter.setPen(Qt::white);
   QFont font = painter.font();
   qreal font_size = font.pointSizeF();
@@ -123,6 +144,16 @@ void MapFrame::paintEvent(QPaintEvent* event) {
 
   map_data->lock();
 
+  // Read lock the displayed rovers for the whole repaint so the bounds and the
+  // paths drawn with them come from the same data. The ROS callbacks only wait
+  // for the rovers being drawn, and only while this frame is painted.
+  std::vector< pair<std::string, RoverMapData*> > displayed_rovers;
+  for(auto rover_to_display : display_list) {
+    RoverMapData* data = map_data->getRover(rover_to_display);
+    data->lock.lockForRead();
+    displayed_rovers.push_back(pair<std::string, RoverMapData*>(rover_to_display, data));
+  }
+
   QColor green(17, 192, 131);
   QColor red(255, 65, 30);
 
@@ -138,13 +169,16 @@ void MapFrame::paintEvent(QPaintEvent* event) {
   int no_data_offset = 0; // So the "no data" message is not overlayed if there are multiple rovers with no data.
 
   // Repeat the display code for each rover selected by the user - Using C++11 range syntax
-  for(auto rover_to_display : display_list) {
-    if (map_data->getEKFPath(rover_to_display)->empty() && map_data->getEncoderPath(rover_to_display)->empty() && map_data->getGPSPath(rover_to_display)->empty() && map_data->getTargetLocations(rover_to_display)->empty() && map_data->getCollectionPoints(rover_to_display)->empty()) {
+  for(auto& displayed : displayed_rovers) {
+    const std::string& rover_to_display = displayed.first;
+    RoverMapData* data = displayed.second;
+
+    if (data->ekf_path.empty() && data->encoder_path.empty() && data->gps_path.empty() && data->target_locations.empty() && data->collection_points.empty()) {
       painter.drawText(QPoint(50,50+no_data_offset), QString::fromStdString(rover_to_display) + ": No data.");
       no_data_offset += 10;
     }
     // Check extended kalman filter has any values in it
-    else if (map_data->getEKFPath(rover_to_display)->empty()) {
+    else if (data->ekf_path.empty()) {
       painter.drawText(QPoint(50,50+no_data_offset), "Map Frame: No EKF data received.");
       no_data_offset += 10;
     }
@@ -155,40 +189,17 @@ void MapFrame::paintEvent(QPaintEvent* event) {
   // these values
   if (auto_transform)
   {
-    for(auto rover_to_display : display_list)
+    for(auto& displayed : displayed_rovers)
     {
+      RoverMapData* data = displayed.second;
+      pair<float,float> offset = map_data->getDisplayOffset(data);
+
       // Set the max and min seen values depending on which data the user
       // has selected to view
 
-      // Check each of the display data options and choose the most
-      // extreme value from those selected by the user
-
-      // Always include the ekf data because that is what we are using to
-      // position the current position marker for the rover
-
-      if (display_ekf_data)
-      {
-      if (min_seen_x > map_data->getMinEKFX(rover_to_display)) min_seen_x = map_data->getMinEKFX(rover_to_display);
-      if (min_seen_y > map_data->getMinEKFY(rover_to_display)) min_seen_y = map_data->getMinEKFY(rover_to_display);
-      if (max_seen_x < map_data->getMaxEKFX(rover_to_display)) max_seen_x = map_data->getMaxEKFX(rover_to_display);
-      if (max_seen_y < map_data->getMaxEKFY(rover_to_display)) max_seen_y = map_data->getMaxEKFY(rover_to_display);
-      }
-
-      if (display_gps_data)
-      {
-      if (min_seen_x > map_data->getMinGPSX(rover_to_display)) min_seen_x = map_data->getMinGPSX(rover_to_display);
-      if (min_seen_y > map_data->getMinGPSY(rover_to_display)) min_seen_y = map_data->getMinGPSY(rover_to_display);
-      if (max_seen_x < map_data->getMaxGPSX(rover_to_display)) max_seen_x = map_data->getMaxGPSX(rover_to_display);
-      if (max_seen_y < map_data->getMaxGPSY(rover_to_display)) max_seen_y = map_data->getMaxGPSY(rover_to_display);
-      }
-
-      if (display_encoder_data)
-      {
-      if (min_seen_x > map_data->getMinEncoderX(rover_to_display)) min_seen_x = map_data->getMinEncoderX(rover_to_display);
-      if (min_seen_y > map_data->getMinEncoderY(rover_to_display)) min_seen_y = map_data->getMinEncoderY(rover_to_display);
-      if (max_seen_x < map_data->getMaxEncoderX(rover_to_display)) max_seen_x = map_data->getMaxEncoderX(rover_to_display);
-      if (max_seen_y < map_data->getMaxEncoderY(rover_to_display)) max_seen_y = map_data->getMaxEncoderY(rover_to_display);
-      }
+      if (display_ekf_data) includeBounds(data->ekf_bounds, offset, min_seen_x, min_seen_y, max_seen_x, max_seen_y);
+      if (display_gps_data) includeBounds(data->gps_bounds, offset, min_seen_x, min_seen_y, max_seen_x, max_seen_y);
+      if (display_encoder_data) includeBounds(data->encoder_bounds, offset, min_seen_x, min_seen_y, max_seen_x, max_seen_y);
 
       // Normalize the displayed coordinates to the largest coordinates
       // seen since we don't know the coordinate system.
@@ -219,101 +230,147 @@ void MapFrame::paintEvent(QPaintEvent* event) {
   map_width = this->width()-1;// Minus 1 or will go off the edge
   map_height = this->height()-1;//
 
-  int map_center_x = map_origin_x+((map_width-map_origin_x)/2);
-  int map_center_y = map_origin_y+((map_height-map_origin_y)/2);
+  map_center_x = map_origin_x+((map_width-map_origin_x)/2);
+  map_center_y = map_origin_y+((map_height-map_origin_y)/2);
 
-  // The map axes do not need to be redrawn for each rover so this code is
-  // sandwiched between the two rover display list loops
+  int hardware_rover_color_index = 0;
 
-  // Draw the scale bars
-  //painter.setPen(Qt::gray);
-  //painter.drawLine(QPoint(map_center_x, map_origin_y), QPoint(map_center_x, map_height));
-  //painter.drawLine(QPoint(map_origin_x, map_center_y), QPoint(map_width, map_center_y));
-  //painter.setPen(Qt::white);
+  std::vector<QColor> rover_colors;
+  for(auto& displayed : displayed_rovers)
+  {
+    const std::string& rover_to_display = displayed.first;
+    QColor rover_color = QColor(255, 255, 255); // white
 
-  // Cross hairs at map display center
-  QPoint axes_origin(map_origin_x,map_origin_y);
-  QPoint x_axis(map_width,map_origin_y);
-  QPoint y_axis(map_origin_x,map_height);
-  painter.drawLine(axes_origin, x_axis);
-  painter.drawLine(axes_origin, y_axis);
-  painter.drawLine(QPoint(map_width, map_origin_y), QPoint(map_width, map_height));
-  painter.drawLine(QPoint(map_origin_x, map_height), QPoint(map_width, map_height));
+    // if we have properly set a color for simulated rovers initialise the color here
+    // also make the popout map frame aware of the colors we use here
+    if(unique_simulated_rover_colors.find(rover_to_display) != unique_simulated_rover_colors.end())
+    {
+      rover_color = unique_simulated_rover_colors[rover_to_display];
+      
+      if(popout_mapframe)
+      {
+        popout_mapframe->setUniqueRoverColor(rover_to_display, unique_simulated_rover_colors[rover_to_display]);
+      }
+    }
+    // caveat in the case that
+    //     1) we haven't set sim rover colors properly
+    //     2) we are using hardware rovers
+    else if(display_unique_rover_colors)
+    {
+      rover_color = unique_physical_rover_colors[hardware_rover_color_index];
+    }
 
-  // Draw north arrow
-  QPoint northArrow_point(map_center_x, 0);
-  QPoint northArrow_left(map_center_x - 5, 5);
-  QPoint northArrow_right(map_center_x + 5, 5);
-  QRect northArrow_textBox(northArrow_left.x(), northArrow_left.y(), 10, 15);
-  painter.drawLine(northArrow_left, northArrow_right);
-  painter.drawLine(northArrow_left, northArrow_point);
-  painter.drawLine(northArrow_right, northArrow_point);
-  painter.drawText(northArrow_textBox, QString("N"));
+    rover_colors.push_back(rover_color);
+    hardware_rover_color_index = (hardware_rover_color_index + 1) % 8;
+  }
 
-  // Draw rover origin crosshairs
-  // painter.setPen(green);
+  // The axes and the rover paths are kept in path_layer between repaints.
+  // Usually only the points added since the last repaint are drawn into it.
+  // It is drawn from scratch when the view, a rover's colour or offset
+  // changes, or when a rover's paths were cleared.
+  LayerView view;
+  view.width = this->width();
+  view.height = this->height();
+  view.min_seen_x = min_seen_x;
+  view.min_seen_y = min_seen_y;
+  view.max_seen_width = max_seen_width;
+  view.max_seen_height = max_seen_height;
+  view.display_gps_data = display_gps_data;
+  view.display_ekf_data = display_ekf_data;
+  view.display_encoder_data = display_encoder_data;
+  view.display_unique_rover_colors = display_unique_rover_colors;
+
+  if(gl)
+  {
+    drawAxes(painter);
 
-  float initial_x = 0.0; //map_data->getEKFPath(rover_to_display).begin()->first;
-  float initial_y = 0.001; //map_data->getEKFPath(rover_to_display).begin()->second;
-  float rover_origin_x = map_origin_x+((initial_x-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-  float rover_origin_y = map_origin_y+((initial_y-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
-  painter.setPen(Qt::gray);
-  painter.drawLine(QPoint(rover_origin_x, map_origin_y), QPoint(rover_origin_x, map_height));
-  painter.drawLine(QPoint(map_origin_x, rover_origin_y), QPoint(map_width, rover_origin_y));
-  painter.setPen(Qt::white);
+    // Take map coordinates straight to normalised device coordinates, the
+    // same transform as toMapFrame() followed by the viewport transform
+    float frame_width = this->width();
+    float frame_height = this->height();
+    QVector2D transform_scale(2*(map_width-map_origin_x)/(max_seen_width*frame_width),
+                              -2*(map_height-map_origin_y)/(max_seen_height*frame_height));
+    QVector2D transform_translate(2*(map_origin_x-min_seen_x*(map_width-map_origin_x)/max_seen_width)/frame_width-1,
+                                  1-2*(map_origin_y-min_seen_y*(map_height-map_origin_y)/max_seen_height)/frame_height);
 
-  int n_ticks = 6;
-  float tick_length = 5;
-  QPoint x_axis_ticks[n_ticks];
-  QPoint y_axis_ticks[n_ticks];
+    painter.beginNativePainting();
+    gl->setTransform(transform_scale, transform_translate);
 
-  for (int i = 0; i < n_ticks-1; i++)
-  {
-    x_axis_ticks[i].setX(axes_origin.x()+(i+1)*map_width/n_ticks);
-    x_axis_ticks[i].setY(axes_origin.y());
+    for(size_t i = 0; i < displayed_rovers.size(); i++)
+    {
+      const std::string& rover_to_display = displayed_rovers[i].first;
+      RoverMapData* data = displayed_rovers[i].second;
+      pair<float,float> offset = map_data->getDisplayOffset(data);
+      QVector2D path_offset(offset.first, offset.second);
+
+      if (display_gps_data) gl->drawPath(rover_to_display + "/gps", data->gps_path, data->generation, path_offset, display_unique_rover_colors ? rover_colors[i] : red, true);
+      if (display_ekf_data) gl->drawPath(rover_to_display + "/ekf", data->ekf_path, data->generation, path_offset, display_unique_rover_colors ? rover_colors[i] : QColor(Qt::white), false);
+      if (display_encoder_data) gl->drawPath(rover_to_display + "/encoder", data->encoder_path, data->generation, path_offset, display_unique_rover_colors ? rover_colors[i] : green, false);
+    }
 
-    y_axis_ticks[i].setX(axes_origin.x());
-    y_axis_ticks[i].setY(axes_origin.y()+(i+1)*map_height/n_ticks);
+    painter.endNativePainting();
   }
-
-  for (int i = 0; i < n_ticks-1; i++)
+  else
   {
-    painter.drawLine(x_axis_ticks[i], QPoint(x_axis_ticks[i].x(), x_axis_ticks[i].y()+tick_length));
-    painter.drawLine(y_axis_ticks[i], QPoint(y_axis_ticks[i].x()+tick_length, y_axis_ticks[i].y()));
-  }
+    bool redraw_path_layer = !(view == path_layer_view) || drawn_paths.size() != displayed_rovers.size();
 
-  for (int i = 0; i < n_ticks-1; i++)
-  {
-    float fraction_of_map_to_rover_x = (rover_origin_x-map_origin_x)/map_width;
-    float fraction_of_map_to_rover_y = (rover_origin_y-map_origin_y)/map_height;
-    float x_label_f = (i+1)*max_seen_width/n_ticks-fraction_of_map_to_rover_x*max_seen_width;
-    float y_label_f = (i+1)*max_seen_height/n_ticks-fraction_of_map_to_rover_y*max_seen_height;
+    for(size_t i = 0; i < displayed_rovers.size() && !redraw_path_layer; i++)
+    {
+      std::map<std::string, DrawnPaths>::iterator drawn = drawn_paths.find(displayed_rovers[i].first);
+      redraw_path_layer = drawn == drawn_paths.end()
+        || drawn->second.generation != displayed_rovers[i].second->generation
+        || drawn->second.offset != map_data->getDisplayOffset(displayed_rovers[i].second)
+        || drawn->second.color != rover_colors[i];
+    }
 
-    QString x_label = QString::number(x_label_f, 'f', 1) + "m";
-    QString y_label = QString::number(-y_label_f, 'f', 1) + "m";
+    if(!redraw_path_layer)
+    {
+      QPainter layer_painter(&path_layer);
+      for(size_t i = 0; i < displayed_rovers.size() && !redraw_path_layer; i++)
+      {
+        redraw_path_layer = !drawPaths(layer_painter, displayed_rovers[i].second, rover_colors[i], drawn_paths[displayed_rovers[i].first]);
+      }
+    }
 
-    int x_labels_offset_x = -(fm.width(x_label))/2;
-    int x_labels_offset_y = 0;
+    if(redraw_path_layer)
+    {
+      path_layer = QPixmap(this->size());
+      path_layer.fill(Qt::transparent);
+      drawn_paths.clear();
 
-    int y_labels_offset_x = -(fm.width(y_label));
-    int y_labels_offset_y = fm.height()/3;
+      QPainter layer_painter(&path_layer);
+      layer_painter.setFont(font);
+      layer_painter.setPen(Qt::white);
+      drawAxes(layer_painter);
 
-    painter.drawText(x_axis_ticks[i].x()+x_labels_offset_x, axes_origin.y()+x_labels_offset_y, x_label);
-    painter.drawText(axes_origin.x()+y_labels_offset_x, y_axis_ticks[i].y()+y_labels_offset_y, y_label);
-  }
+      for(size_t i = 0; i < displayed_rovers.size(); i++)
+      {
+        DrawnPaths& drawn = drawn_paths[displayed_rovers[i].first];
+        drawn.generation = displayed_rovers[i].second->generation;
+        drawn.offset = map_data->getDisplayOffset(displayed_rovers[i].second);
+        drawn.color = rover_colors[i];
+        drawPaths(layer_painter, displayed_rovers[i].second, rover_colors[i], drawn);
+      }
 
-  // End draw scale bars
+      path_layer_view = view;
+    }
 
-  int hardware_rover_color_index = 0;
+    painter.drawPixmap(0, 0, path_layer);
+  }
 
-  // Repeat the display code for each rover selected by the user - Using C++11 range syntax
-  for(auto rover_to_display : display_list)
+  // The markers, waypoints and current positions change on most repaints and
+  // are cheap to draw, so they are drawn directly
+  for(size_t i = 0; i < displayed_rovers.size(); i++)
   {
+    const std::string& rover_to_display = displayed_rovers[i].first;
+    RoverMapData* data = displayed_rovers[i].second;
+    QColor rover_color = rover_colors[i];
+
     // scale coordinates
     std::vector<QPoint> scaled_target_locations;
-    for(std::vector< pair<float,float> >::iterator it = map_data->getTargetLocations(rover_to_display)->begin(); it < map_data->getTargetLocations(rover_to_display)->end(); ++it)
+    scaled_target_locations.reserve(data->target_locations.size());
+    for(const pair<float,float>& coordinate : data->target_locations)
     {
-      pair<float,float> coordinate  = *it;
       QPoint point;
       point.setX(map_origin_x+coordinate.first*map_width);
       point.setY(map_origin_y+coordinate.second*map_height);
@@ -321,152 +378,30 @@ void MapFrame::paintEvent(QPaintEvent* event) {
     }
     
     std::vector<QPoint> scaled_collection_points;
-    for(std::vector< pair<float,float> >::iterator it = map_data->getCollectionPoints(rover_to_display)->begin(); it < map_data->getCollectionPoints(rover_to_display)->end(); ++it)
+    scaled_collection_points.reserve(data->collection_points.size());
+    for(const pair<float,float>& coordinate : data->collection_points)
     {
-      pair<float,float> coordinate  = *it;
       QPoint point;
       point.setX(map_origin_x+coordinate.first*map_width);
       point.setY(map_origin_y+coordinate.second*map_height);
       scaled_collection_points.push_back(point);
     }
 
-    std::vector<QPoint> scaled_gps_rover_points;
-    for(std::vector< pair<float,float> >::iterator it = map_data->getGPSPath(rover_to_display)->begin(); it < map_data->getGPSPath(rover_to_display)->end(); ++it)
-    {
-      pair<float,float> coordinate  = *it;
-      
-      float x = map_origin_x+((coordinate.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-      float y = map_origin_y+((coordinate.second-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
-      scaled_gps_rover_points.push_back( QPoint(x,y) );
-    }
-
-
-    // Maintain aspect ratio
-    max_seen_height > max_seen_width ? max_seen_width = max_seen_height : max_seen_height = max_seen_width;
-
-    // Calculate the axis positions
-    map_origin_x = fm.width(QString::number(-max_seen_height, 'f', 1)+"m");
-    map_origin_y = 2*fm.height();
-    
-    map_width = this->width()-1;// Minus 1 or will go off the edge
-    map_height = this->height()-1;//
-    
-    map_center_x = map_origin_x+((map_width-map_origin_x)/2);
-    map_center_y = map_origin_y+((map_height-map_origin_y)/2);
-
-    // The map axes do not need to be redrawn for each rover so this code is
-    // sandwiched between the two rover display list loops
-
-    // Draw the scale bars
-    //painter.setPen(Qt::gray);
-    //painter.drawLine(QPoint(map_center_x, map_origin_y), QPoint(map_center_x, map_height));
-    //painter.drawLine(QPoint(map_origin_x, map_center_y), QPoint(map_width, map_center_y));
-    //painter.setPen(Qt::white);
-
-    // Cross hairs at map display center
-    QPoint axes_origin(map_origin_x,map_origin_y);
-    QPoint x_axis(map_width,map_origin_y);
-    QPoint y_axis(map_origin_x,map_height);
-    painter.drawLine(axes_origin, x_axis);
-    painter.drawLine(axes_origin, y_axis);
-    painter.drawLine(QPoint(map_width, map_origin_y), QPoint(map_width, map_height));
-    painter.drawLine(QPoint(map_origin_x, map_height), QPoint(map_width, map_height));
-
-    // Draw north arrow
-    QPoint northArrow_point(map_center_x, 0);
-    QPoint northArrow_left(map_center_x - 5, 5);
-    QPoint northArrow_right(map_center_x + 5, 5);
-    QRect northArrow_textBox(northArrow_left.x(), northArrow_left.y(), 10, 15);
-    painter.drawLine(northArrow_left, northArrow_right);
-    painter.drawLine(northArrow_left, northArrow_point);
-    painter.drawLine(northArrow_right, northArrow_point);
-    painter.drawText(northArrow_textBox, QString("N"));
-
-    // Draw rover origin crosshairs
-    // painter.setPen(green);
-
-    float initial_x = 0.0; //map_data->getEKFPath(rover_to_display).begin()->first;
-    float initial_y = 0.001; //map_data->getEKFPath(rover_to_display).begin()->second;
-    float rover_origin_x = map_origin_x+((initial_x-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-    float rover_origin_y = map_origin_y+((initial_y-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
-    painter.setPen(Qt::gray);
-    painter.drawLine(QPoint(rover_origin_x, map_origin_y), QPoint(rover_origin_x, map_height));
-    painter.drawLine(QPoint(map_origin_x, rover_origin_y), QPoint(map_width, rover_origin_y));
-    painter.setPen(Qt::white);
-
-    QPainterPath scaled_ekf_rover_path;
-    for(std::vector< pair<float,float> >::iterator it = map_data->getEKFPath(rover_to_display)->begin(); it < map_data->getEKFPath(rover_to_display)->end(); ++it)
-    {
-      pair<float,float> coordinate  = *it;
-      QPoint point;
-      float x = map_origin_x+((coordinate.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-      float y = map_origin_y+((coordinate.second-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
-      
-      // Move to the starting point of the path without drawing a line
-      if (it == map_data->getEKFPath(rover_to_display)->begin()) scaled_ekf_rover_path.moveTo(x, y);
-      scaled_ekf_rover_path.lineTo(x, y);
-    }
-
-    QPainterPath scaled_encoder_rover_path;
-    for(std::vector< pair<float,float> >::iterator it = map_data->getEncoderPath(rover_to_display)->begin(); it < map_data->getEncoderPath(rover_to_display)->end(); ++it)
-    { 
-      pair<float,float> coordinate  = *it;
-      QPoint point;
-      float x = map_origin_x+((coordinate.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-      float y = map_origin_y+((coordinate.second-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
-      
-      // Move to the starting point of the path without drawing a line
-      if (it == map_data->getEncoderPath(rover_to_display)->begin()) scaled_encoder_rover_path.moveTo(x, y);
-
-      scaled_encoder_rover_path.lineTo(x, y);
-    }
-    
-    QColor rover_color = QColor(255, 255, 255); // white
-
-    // if we have properly set a color for simulated rovers initialise the color here
-    // also make the popout map frame aware of the colors we use here
-    if(unique_simulated_rover_colors.find(rover_to_display) != unique_simulated_rover_colors.end())
-    {
-      rover_color = unique_simulated_rover_colors[rover_to_display];
-      
-      if(popout_mapframe)
-      {
-        popout_mapframe->setUniqueRoverColor(rover_to_display, unique_simulated_rover_colors[rover_to_display]);
-      }
-    }
-    // caveat in the case that
-    //     1) we haven't set sim rover colors properly
-    //     2) we are using hardware rovers
-    else if(display_unique_rover_colors)
-    {
-      rover_color = unique_physical_rover_colors[hardware_rover_color_index];
-    }
+    // The paths and waypoints are stored without the global offset
+    pair<float,float> path_offset = map_data->getDisplayOffset(data);
 
     painter.setPen(rover_color);
-
-    if(!display_unique_rover_colors) painter.setPen(red);
-
-    if (display_gps_data) painter.drawPoints(&scaled_gps_rover_points[0], scaled_gps_rover_points.size());
-    // if (display_gps_data) painter.drawPath(scaled_gps_rover_path);
-
-    if(!display_unique_rover_colors) painter.setPen(Qt::white);
-
-    if (display_ekf_data) painter.drawPath(scaled_ekf_rover_path);
-
     if(!display_unique_rover_colors) painter.setPen(green);
 
-    if (display_encoder_data) {
-       painter.drawPath(scaled_encoder_rover_path);
-       std::pair<float, float> odom_point = map_data->getEncoderPath(rover_to_display)->back();
-       float o_x = map_origin_x+((odom_point.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-       float o_y = map_origin_y+((odom_point.second-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
+    if (display_encoder_data && !data->encoder_path.empty()) {
+       std::pair<float, float> odom_point = data->encoder_path.back();
        QPen old_pen = painter.pen();
        QPen pen;
        pen.setWidth(10);
        pen.setColor(old_pen.color());
        pen.setCapStyle(Qt::RoundCap);
        painter.setPen(pen);
-       painter.drawPoint(QPoint(o_x,o_y));
+       painter.drawPoint(toMapFrame(odom_point.first, odom_point.second, path_offset));
        painter.setPen(old_pen);
     }
 
@@ -482,12 +417,13 @@ void MapFrame::paintEvent(QPaintEvent* event) {
     painter.setPen(Qt::cyan);
     
     QPainterPath scaled_waypoint_rover_path;
-    for(map< int, std::tuple<float,float,bool> >::iterator it = map_data->getWaypointPath(rover_to_display)->begin(); it != map_data->getWaypointPath(rover_to_display)->end(); ++it)
+    const map< int, std::tuple<float,float,bool> >& waypoint_path = data->waypoint_path;
+    for(map< int, std::tuple<float,float,bool> >::const_iterator it = waypoint_path.begin(); it != waypoint_path.end(); ++it)
     {	
-      tuple<float,float,bool> coordinate  = it->second; // Get the value from the map
+      const tuple<float,float,bool>& coordinate  = it->second; // Get the value from the map
       
-      float x = map_origin_x+((get<0>(coordinate)-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
-      float y = map_origin_y+((get<1>(coordinate)-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
+      float x = map_origin_x+((get<0>(coordinate)+path_offset.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
+      float y = map_origin_y+((get<1>(coordinate)+path_offset.second-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
       
       
       QPoint point(x,y);
@@ -512,7 +448,7 @@ void MapFrame::paintEvent(QPaintEvent* event) {
       painter.setPen(Qt::blue);
       
       // Move to the starting point of the path without drawing a line
-      if (it == map_data->getWaypointPath(rover_to_display)->begin())
+      if (it == waypoint_path.begin())
       {
 	scaled_waypoint_rover_path.moveTo(x, y);
       }
@@ -529,9 +465,11 @@ void MapFrame::paintEvent(QPaintEvent* event) {
     else painter.setPen(Qt::yellow);
     
     pair<float,float> current_coordinate;
-    if(! map_data->getEKFPath(rover_to_display)->empty() )
+    if(! data->ekf_path.empty() )
     {
-       current_coordinate = map_data->getEKFPath(rover_to_display)->back();
+       current_coordinate = data->ekf_path.back();
+       current_coordinate.first += path_offset.first;
+       current_coordinate.second += path_offset.second;
     }
     
     float x = map_origin_x+((current_coordinate.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
@@ -541,11 +479,11 @@ void MapFrame::paintEvent(QPaintEvent* event) {
     painter.drawEllipse(QPointF(x,y), radius, radius);
     painter.drawText(QPoint(x,y), QString::fromStdString(rover_to_display));
 
-    hardware_rover_color_index = (hardware_rover_color_index + 1) % 8;
-
     painter.setPen(Qt::white);
   } // End rover display list set iteration
 
+  for(auto& displayed : displayed_rovers) displayed.second->lock.unlock();
+
   map_data->unlock();
   
   // Diagnostic output
@@ -565,6 +503,152 @@ void MapFrame::paintEvent(QPaintEvent* event) {
 }
 
 
+// Draws the axes, scale and north arrow
+void MapFrame::drawAxes(QPainter& painter)
+{
+  QFontMetrics fm(painter.font());
+
+  // Draw the scale bars
+  //painter.setPen(Qt::gray);
+  //painter.drawLine(QPoint(map_center_x, map_origin_y), QPoint(map_center_x, map_height));
+  //painter.drawLine(QPoint(map_origin_x, map_center_y), QPoint(map_width, map_center_y));
+  //painter.setPen(Qt::white);
+
+  // Cross hairs at map display center
+  QPoint axes_origin(map_origin_x,map_origin_y);
+  QPoint x_axis(map_width,map_origin_y);
+  QPoint y_axis(map_origin_x,map_height);
+  painter.drawLine(axes_origin, x_axis);
+  painter.drawLine(axes_origin, y_axis);
+  painter.drawLine(QPoint(map_width, map_origin_y), QPoint(map_width, map_height));
+  painter.drawLine(QPoint(map_origin_x, map_height), QPoint(map_width, map_height));
+
+  // Draw north arrow
+  QPoint northArrow_point(map_center_x, 0);
+  QPoint northArrow_left(map_center_x - 5, 5);
+  QPoint northArrow_right(map_center_x + 5, 5);
+  QRect northArrow_textBox(northArrow_left.x(), northArrow_left.y(), 10, 15);
+  painter.drawLine(northArrow_left, northArrow_right);
+  painter.drawLine(northArrow_left, northArrow_point);
+  painter.drawLine(northArrow_right, northArrow_point);
+  painter.drawText(northArrow_textBox, QString("N"));
+
+  // Draw rover origin crosshairs
+  // painter.setPen(green);
+
+  float initial_x = 0.0; //map_data->getEKFPath(rover_to_display).begin()->first;
+  float initial_y = 0.001; //map_data->getEKFPath(rover_to_display).begin()->second;
+  float rover_origin_x = map_origin_x+((initial_x-min_seen_x)/max_seen_width)*(map_width-map_origin_x);
+  float rover_origin_y = map_origin_y+((initial_y-min_seen_y)/max_seen_height)*(map_height-map_origin_y);
+  painter.setPen(Qt::gray);
+  painter.drawLine(QPoint(rover_origin_x, map_origin_y), QPoint(rover_origin_x, map_height));
+  painter.drawLine(QPoint(map_origin_x, rover_origin_y), QPoint(map_width, rover_origin_y));
+  painter.setPen(Qt::white);
+
+  int n_ticks = 6;
+  float tick_length = 5;
+  QPoint x_axis_ticks[n_ticks];
+  QPoint y_axis_ticks[n_ticks];
+
+  for (int i = 0; i < n_ticks-1; i++)
+  {
+    x_axis_ticks[i].setX(axes_origin.x()+(i+1)*map_width/n_ticks);
+    x_axis_ticks[i].setY(axes_origin.y());
+
+    y_axis_ticks[i].setX(axes_origin.x());
+    y_axis_ticks[i].setY(axes_origin.y()+(i+1)*map_height/n_ticks);
+  }
+
+  for (int i = 0; i < n_ticks-1; i++)
+  {
+    painter.drawLine(x_axis_ticks[i], QPoint(x_axis_ticks[i].x(), x_axis_ticks[i].y()+tick_length));
+    painter.drawLine(y_axis_ticks[i], QPoint(y_axis_ticks[i].x()+tick_length, y_axis_ticks[i].y()));
+  }
+
+  for (int i = 0; i < n_ticks-1; i++)
+  {
+    float fraction_of_map_to_rover_x = (rover_origin_x-map_origin_x)/map_width;
+    float fraction_of_map_to_rover_y = (rover_origin_y-map_origin_y)/map_height;
+    float x_label_f = (i+1)*max_seen_width/n_ticks-fraction_of_map_to_rover_x*max_seen_width;
+    float y_label_f = (i+1)*max_seen_height/n_ticks-fraction_of_map_to_rover_y*max_seen_height;
+
+    QString x_label = QString::number(x_label_f, 'f', 1) + "m";
+    QString y_label = QString::number(-y_label_f, 'f', 1) + "m";
+
+    int x_labels_offset_x = -(fm.width(x_label))/2;
+    int x_labels_offset_y = 0;
+
+    int y_labels_offset_x = -(fm.width(y_label));
+    int y_labels_offset_y = fm.height()/3;
+
+    painter.drawText(x_axis_ticks[i].x()+x_labels_offset_x, axes_origin.y()+x_labels_offset_y, x_label);
+    painter.drawText(axes_origin.x()+y_labels_offset_x, y_axis_ticks[i].y()+y_labels_offset_y, y_label);
+  }
+
+  // End draw scale bars
+}
+
+QPointF MapFrame::toMapFrame(float x, float y, pair<float,float> offset) const
+{
+  return QPointF(map_origin_x+((x+offset.first-min_seen_x)/max_seen_width)*(map_width-map_origin_x),
+                 map_origin_y+((y+offset.second-min_seen_y)/max_seen_height)*(map_height-map_origin_y));
+}
+
+// Draws the points added to the path since it was last drawn, or all of it if
+// drawn is 0. Lines carry on from the last point drawn before. Returns false
+// if those points are no longer stored exactly, in which case the layer has to
+// be drawn from scratch.
+bool MapFrame::drawPath(QPainter& painter, const RoverPath& path, pair<float,float> offset, bool as_points, unsigned long& drawn)
+{
+  std::vector<QPointF> points;
+  auto scale_point = [&](float x, float y) { points.push_back(toMapFrame(x, y, offset)); };
+
+  if (drawn == 0)
+  {
+    points.reserve(path.size());
+    path.forEach(scale_point);
+  }
+  else if (!path.forEachSince(as_points ? drawn : drawn-1, scale_point))
+  {
+    return false;
+  }
+
+  drawn = path.addedCount();
+
+  if (as_points) painter.drawPoints(points.data(), points.size());
+  else if (points.size() > 1) painter.drawPolyline(points.data(), points.size());
+
+  return true;
+}
+
+// Draws the new points of the rover paths selected for display
+bool MapFrame::drawPaths(QPainter& painter, const RoverMapData* data, QColor rover_color, DrawnPaths& drawn)
+{
+  QColor green(17, 192, 131);
+  QColor red(255, 65, 30);
+
+  if (display_gps_data)
+  {
+    painter.setPen(display_unique_rover_colors ? rover_color : red);
+    if (!drawPath(painter, data->gps_path, drawn.offset, true, drawn.gps_drawn)) return false;
+  }
+
+  if (display_ekf_data)
+  {
+    painter.setPen(display_unique_rover_colors ? rover_color : QColor(Qt::white));
+    if (!drawPath(painter, data->ekf_path, drawn.offset, false, drawn.ekf_drawn)) return false;
+  }
+
+  if (display_encoder_data)
+  {
+    painter.setPen(display_unique_rover_colors ? rover_color : green);
+    if (!drawPath(painter, data->encoder_path, drawn.offset, false, drawn.encoder_drawn)) return false;
+  }
+
+  return true;
+}
+
+
 void MapFrame::setDisplayEncoderData(bool display)
 {
   display_encoder_data = display;
@@ -672,8 +756,17 @@ void MapFrame::mousePressEvent(QMouseEvent *event)
     emit sendInfoLogMessage("MOX: " + QString::number(map_origin_x) + " map_width: " + QString::number(map_width) + " max_seen_width: " +  QString::number(min_seen_x));
     
     // If click is within eplison of an existing waypoint remove the waypoint
+    // Work on a copy of the waypoints because removing one takes the rover's
+    // write lock
+    map< int, std::tuple<float,float,bool> > waypoint_path;
+    {
+      RoverMapData* data = map_data->getRover(rover_currently_selected);
+      QReadLocker locker(&data->lock);
+      waypoint_path = data->waypoint_path;
+    }
+
     bool waypoint_removed = false;
-    for(map< int, std::tuple<float,float,bool> >::iterator it = map_data->getWaypointPath(rover_currently_selected)->begin(); it != map_data->getWaypointPath(rover_currently_selected)->end(); ++it)
+    for(map< int, std::tuple<float,float,bool> >::iterator it = waypoint_path.begin(); it != waypoint_path.end(); ++it)
     {
       // Get the distance between the mouse click and the coordinates of the existing waypoints
       tuple<float,float,bool> coordinate  = it->second;
@@ -792,33 +885,21 @@ void MapFrame::setManualTransform()
   float min_seen_x = std::numeric_limits<float>::max();
   float min_seen_y = std::numeric_limits<float>::max();
 
+  map_data->lock();
+
   for (auto rover_to_display : display_list)
   {
-      if (display_ekf_data)
-      {
-        if (min_seen_x > map_data->getMinEKFX(rover_to_display)) min_seen_x = map_data->getMinEKFX(rover_to_display);
-        if (min_seen_y > map_data->getMinEKFY(rover_to_display)) min_seen_y = map_data->getMinEKFY(rover_to_display);
-        if (max_seen_x < map_data->getMaxEKFX(rover_to_display)) max_seen_x = map_data->getMaxEKFX(rover_to_display);
-        if (max_seen_y < map_data->getMaxEKFY(rover_to_display)) max_seen_y = map_data->getMaxEKFY(rover_to_display);
-      }
-
-      if (display_gps_data)
-      {
-        if (min_seen_x > map_data->getMinGPSX(rover_to_display)) min_seen_x = map_data->getMinGPSX(rover_to_display);
-        if (min_seen_y > map_data->getMinGPSY(rover_to_display)) min_seen_y = map_data->getMinGPSY(rover_to_display);
-        if (max_seen_x < map_data->getMaxGPSX(rover_to_display)) max_seen_x = map_data->getMaxGPSX(rover_to_display);
-        if (max_seen_y < map_data->getMaxGPSY(rover_to_display)) max_seen_y = map_data->getMaxGPSY(rover_to_display);
-      }
+      RoverMapData* data = map_data->getRover(rover_to_display);
+      QReadLocker locker(&data->lock);
+      pair<float,float> offset = map_data->getDisplayOffset(data);
 
-      if (display_encoder_data)
-      {
-        if (min_seen_x > map_data->getMinEncoderX(rover_to_display)) min_seen_x = map_data->getMinEncoderX(rover_to_display);
-        if (min_seen_y > map_data->getMinEncoderY(rover_to_display)) min_seen_y = map_data->getMinEncoderY(rover_to_display);
-        if (max_seen_x < map_data->getMaxEncoderX(rover_to_display)) max_seen_x = map_data->getMaxEncoderX(rover_to_display);
-        if (max_seen_y < map_data->getMaxEncoderY(rover_to_display)) max_seen_y = map_data->getMaxEncoderY(rover_to_display);
-      }
+      if (display_ekf_data) includeBounds(data->ekf_bounds, offset, min_seen_x, min_seen_y, max_seen_x, max_seen_y);
+      if (display_gps_data) includeBounds(data->gps_bounds, offset, min_seen_x, min_seen_y, max_seen_x, max_seen_y);
+      if (display_encoder_data) includeBounds(data->encoder_bounds, offset, min_seen_x, min_seen_y, max_seen_x, max_seen_y);
   }
 
+  map_data->unlock();
+
   // Normalize the displayed coordinates to the largest coordinates seen since we don't know the coordinate system.
   float max_seen_width = max_seen_x-min_seen_x;
   float max_seen_height = max_seen_y-min_seen_y;
@@ -862,6 +943,30 @@ void MapFrame::popout()
   if (popout_window) popout_window->show();
 }
 
+void MapFrame::setUseOpenGL(bool use)
+{
+  if (use && !gl_view)
+  {
+    gl_view = new MapGLView(this);
+
+    QGridLayout* gl_layout = new QGridLayout();
+    gl_layout->setContentsMargins(0, 0, 0, 0);
+    gl_layout->addWidget(gl_view);
+    setLayout(gl_layout);
+
+    connect(this, SIGNAL(delayedUpdate()), gl_view, SLOT(update()), Qt::QueuedConnection);
+  }
+  else if (!use && gl_view)
+  {
+    delete layout();
+    delete gl_view;
+    gl_view = NULL;
+    update();
+  }
+
+  if (popout_mapframe) popout_mapframe->setUseOpenGL(use);
+}
+
  void MapFrame::setMapData(MapData* data)
  {
    map_data = data;
@@ -872,7 +977,7 @@ void MapFrame::popout()
    if (map_data)
    {
       map_data->addToGPSRoverPath(rover, x, y);
-      emit delayedUpdate();
+      map_data_changed = true;
    }
  }
 
@@ -881,7 +986,7 @@ void MapFrame::addToEncoderRoverPath(std::string rover, float x, float y)
   if (map_data)
   {
     map_data->addToEncoderRoverPath(rover, x, y);
-    emit delayedUpdate();
+    map_data_changed = true;
   }
 }
 
@@ -890,7 +995,16 @@ void MapFrame::addToEKFRoverPath(std::string rover, float x, float y)
   if (map_data)
   {
     map_data->addToEKFRoverPath(rover, x, y);
-    emit delayedUpdate();
+    map_data_changed = true;
+  }
+}
+
+void MapFrame::addToRoverPath(std::string rover, int source, const float* x, const float* y, size_t count)
+{
+  if (map_data)
+  {
+    map_data->addToRoverPath(rover, source, x, y, count);
+    map_data_changed = true;
   }
 }
 
@@ -898,7 +1012,7 @@ void MapFrame::addWaypoint( string rover, float x, float y ) {
   if (map_data)
   {
     int id = map_data->addToWaypointPath(rover, x, y);
-    cout << "Waypoint created. There are now " << map_data->getWaypointPath(rover_currently_selected)->size() << " waypoints" << endl;
+    cout << "Waypoint created. There are now " << map_data->getWaypointCount(rover) << " waypoints" << endl;
     emit delayedUpdate();
     // The y coordinate must be negated to translatAe between the
     // map frame and the rover frame.
@@ -910,7 +1024,7 @@ void MapFrame::removeWaypoint( string rover, int id ) {
   if (map_data)
   {
     map_data->removeFromWaypointPath(rover, id );
-    cout << "Waypoint removed. There are now " << map_data->getWaypointPath(rover_currently_selected)->size() << " waypoints" << endl;
+    cout << "Waypoint removed. There are now " << map_data->getWaypointCount(rover) << " waypoints" << endl;
     emit delayedUpdate();
     emit sendWaypointCmd(REMOVE, id, 0, 0); // x and y are 0 here because they are unused in a remove command
   }
@@ -942,6 +1056,11 @@ void MapFrame::receiveCurrentRoverName( QString rover_name )
   }
 }
 
+void MapFrame::refresh()
+{
+  if (map_data_changed.exchange(false)) emit delayedUpdate();
+}
+
 void MapFrame::enableWaypoints(string rover_name)
 {
   map_data->setManualMode(rover_name);
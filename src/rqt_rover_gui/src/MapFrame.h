@@ -22,15 +22,19 @@
 #include <QImage>
 #include <QMutex>
 #include <QPainter>
+#include <QPixmap>
 #include <vector>
 #include <set>
 #include <utility> // For STL pair
 #include <map>
 #include <QString>
+#include <atomic>
 
 // Forward declarations
 class QMainWindow;
 class MapData;
+class RoverPath;
+struct RoverMapData;
 
 using namespace std;
 
@@ -41,10 +45,14 @@ enum WaypointCmd {ADD, REMOVE};
 namespace rqt_rover_gui
 {
 
+  class MapGLView;
+
   class MapFrame : public QFrame
   {
     Q_OBJECT
 
+    friend class MapGLView;
+
     public:
 
       MapFrame(QWidget *parent, Qt::WindowFlags = 0);
@@ -63,6 +71,7 @@ namespace rqt_rover_gui
       void addToGPSRoverPath(std::string rover, float x, float y);
       void addToEncoderRoverPath(std::string rover, float x, float y);
       void addToEKFRoverPath(std::string rover, float x, float y);
+      void addToRoverPath(std::string rover, int source, const float* x, const float* y, size_t count);
 
       void setMapData(MapData* map_data);
 
@@ -91,6 +100,10 @@ namespace rqt_rover_gui
       // Show a copy of the map in its own resizable window
       void popout();
 
+      // Draw the map with OpenGL instead of QPainter. Also applies to the
+      // popout map.
+      void setUseOpenGL(bool use);
+
       ~MapFrame();
 
     signals:
@@ -103,6 +116,10 @@ namespace rqt_rover_gui
 
         void receiveWaypointReached(int);
         void receiveCurrentRoverName(QString);
+
+        // Called by the GUI refresh timer. Repaints if rover data was added
+        // since the last refresh.
+        void refresh();
         
     protected:
 
@@ -114,6 +131,52 @@ namespace rqt_rover_gui
 
     private:
 
+      // The view the path layer was drawn for
+      struct LayerView {
+        int width = 0;
+        int height = 0;
+        float min_seen_x = 0;
+        float min_seen_y = 0;
+        float max_seen_width = 0;
+        float max_seen_height = 0;
+        bool display_gps_data = false;
+        bool display_ekf_data = false;
+        bool display_encoder_data = false;
+        bool display_unique_rover_colors = false;
+
+        bool operator==(const LayerView& other) const
+        {
+          return width == other.width && height == other.height
+            && min_seen_x == other.min_seen_x && min_seen_y == other.min_seen_y
+            && max_seen_width == other.max_seen_width && max_seen_height == other.max_seen_height
+            && display_gps_data == other.display_gps_data && display_ekf_data == other.display_ekf_data
+            && display_encoder_data == other.display_encoder_data
+            && display_unique_rover_colors == other.display_unique_rover_colors;
+        }
+      };
+
+      // How much of a rover's paths is in the path layer. The counts are
+      // RoverPath::addedCount() when the path was last drawn.
+      struct DrawnPaths {
+        unsigned long generation = 0;
+        unsigned long gps_drawn = 0;
+        unsigned long ekf_drawn = 0;
+        unsigned long encoder_drawn = 0;
+        pair<float,float> offset = pair<float,float>(0,0);
+        QColor color;
+      };
+
+      // Draws the whole map with painter. With an OpenGL view the paths are
+      // drawn by the view, otherwise they come from the path layer.
+      void paintMap(QPainter& painter, MapGLView* gl);
+
+      void drawAxes(QPainter& painter);
+      bool drawPaths(QPainter& painter, const RoverMapData* data, QColor rover_color, DrawnPaths& drawn);
+      bool drawPath(QPainter& painter, const RoverPath& path, pair<float,float> offset, bool as_points, unsigned long& drawn);
+
+      // Converts map coordinates to frame coordinates with the current transform
+      QPointF toMapFrame(float x, float y, pair<float,float> offset) const;
+
       mutable QMutex update_mutex;
       int frame_width;
       int frame_height;
@@ -165,6 +228,16 @@ namespace rqt_rover_gui
       
       MapData* map_data;
 
+      // The axes and rover paths drawn so far, see paintEvent
+      QPixmap path_layer;
+      LayerView path_layer_view;
+      std::map<std::string, DrawnPaths> drawn_paths;
+
+      MapGLView* gl_view; // NULL when drawing with QPainter
+
+      // Set by the ROS threads when they add rover data, see refresh()
+      std::atomic<bool> map_data_changed;
+
       // Map coordinate data
       // Calculate the axis positions
       int map_origin_x = 0;
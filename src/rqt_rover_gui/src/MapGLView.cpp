@@ -0,0 +1,149 @@
+#include "MapGLView.h"
+
+#include <vector>
+#include <QPainter>
+
+#include "MapFrame.h"
+#include "RoverPath.h"
+
+using namespace std;
+
+namespace rqt_rover_gui
+{
+
+static const char* vertex_shader =
+  "attribute vec2 position;\n"
+  "uniform vec2 offset;\n"
+  "uniform vec2 scale;\n"
+  "uniform vec2 translate;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_Position = vec4((position + offset) * scale + translate, 0.0, 1.0);\n"
+  "}\n";
+
+static const char* fragment_shader =
+  "#ifdef GL_ES\n"
+  "precision mediump float;\n"
+  "#endif\n"
+  "uniform vec4 color;\n"
+  "void main()\n"
+  "{\n"
+  "  gl_FragColor = color;\n"
+  "}\n";
+
+MapGLView::MapGLView(MapFrame* frame) : QOpenGLWidget(frame)
+{
+  this->frame = frame;
+
+  // Zooming, panning and waypoints are handled by the frame
+  setAttribute(Qt::WA_TransparentForMouseEvents);
+}
+
+void MapGLView::initializeGL()
+{
+  initializeOpenGLFunctions();
+
+  program.addShaderFromSourceCode(QOpenGLShader::Vertex, vertex_shader);
+  program.addShaderFromSourceCode(QOpenGLShader::Fragment, fragment_shader);
+  program.bindAttributeLocation("position", 0);
+  program.link();
+
+  // A new context, e.g. after the view moved to another window, starts
+  // without the buffers of the old one
+  paths.clear();
+}
+
+void MapGLView::paintGL()
+{
+  QPainter painter(this);
+
+  painter.beginNativePainting();
+  glClearColor(0, 0, 0, 1);
+  glClear(GL_COLOR_BUFFER_BIT);
+  painter.endNativePainting();
+
+  frame->paintMap(painter, this);
+}
+
+void MapGLView::setTransform(QVector2D scale, QVector2D translate)
+{
+  program.bind();
+  program.setUniformValue("scale", scale);
+  program.setUniformValue("translate", translate);
+}
+
+void MapGLView::drawPath(const string& key, const RoverPath& path, unsigned long generation, QVector2D offset, QColor color, bool as_points)
+{
+  MapGLPathBuffer& buffer = paths[key];
+
+  if (!buffer.vertices.isCreated())
+  {
+    buffer.vertices.create();
+    buffer.vertices.setUsagePattern(QOpenGLBuffer::DynamicDraw);
+  }
+
+  buffer.vertices.bind();
+
+  if (buffer.generation != generation || buffer.uploaded != path.addedCount())
+  {
+    upload(buffer, path, generation);
+  }
+
+  if (buffer.count > 0)
+  {
+    program.bind();
+    program.setUniformValue("offset", offset);
+    program.setUniformValue("color", color);
+    program.enableAttributeArray(0);
+    program.setAttributeBuffer(0, GL_FLOAT, 0, 2);
+
+    glDrawArrays(as_points ? GL_POINTS : GL_LINE_STRIP, 0, buffer.count);
+
+    program.disableAttributeArray(0);
+  }
+
+  buffer.vertices.release();
+}
+
+void MapGLView::upload(MapGLPathBuffer& buffer, const RoverPath& path, unsigned long generation)
+{
+  vector<GLfloat> vertices;
+  auto add_vertex = [&](float x, float y) { vertices.push_back(x); vertices.push_back(y); };
+
+  bool append = buffer.generation == generation
+    && buffer.uploaded > 0 && buffer.uploaded <= path.addedCount()
+    && path.forEachSince(buffer.uploaded, add_vertex)
+    && buffer.count + (int)vertices.size()/2 <= buffer.capacity;
+
+  if (append)
+  {
+    buffer.vertices.write(buffer.count*2*sizeof(GLfloat), vertices.data(), vertices.size()*sizeof(GLfloat));
+    buffer.count += vertices.size()/2;
+  }
+  else
+  {
+    // Leave room to append as many points again before the next full upload.
+    // RoverPath bounds the points it stores, so this bounds the buffer too.
+    vertices.clear();
+    vertices.reserve(2*path.size());
+    path.forEach(add_vertex);
+
+    buffer.count = vertices.size()/2;
+    buffer.capacity = 2*buffer.count + 1024;
+    buffer.vertices.allocate(buffer.capacity*2*sizeof(GLfloat));
+    buffer.vertices.write(0, vertices.data(), vertices.size()*sizeof(GLfloat));
+    buffer.generation = generation;
+  }
+
+  buffer.uploaded = path.addedCount();
+}
+
+MapGLView::~MapGLView()
+{
+  // The buffers must be deleted with their context current
+  makeCurrent();
+  paths.clear();
+  doneCurrent();
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef MAPGLVIEW_H
+#define MAPGLVIEW_H
+
+#include <map>
+#include <string>
+#include <QColor>
+#include <QOpenGLBuffer>
+#include <QOpenGLFunctions>
+#include <QOpenGLShaderProgram>
+#include <QOpenGLWidget>
+#include <QVector2D>
+
+class RoverPath;
+
+namespace rqt_rover_gui
+{
+
+  class MapFrame;
+
+  // The vertex buffer holding one rover path, in map coordinates
+  struct MapGLPathBuffer {
+    QOpenGLBuffer vertices;
+    unsigned long generation = 0; // RoverMapData::generation of the uploaded points
+    unsigned long uploaded = 0; // RoverPath::addedCount() when last uploaded
+    int count = 0; // Vertices in the buffer
+    int capacity = 0; // Vertices the buffer has room for
+  };
+
+  // Draws the map of a MapFrame with OpenGL. It covers the frame and lets
+  // mouse events through to it, so zooming, panning and waypoints work as in
+  // the QPainter map. The frame still works out the transform and draws the
+  // axes, markers and text with a QPainter on top of the view; the view only
+  // draws the rover paths, from vertex buffers that get the new points of
+  // each path appended on every repaint. Zooming and panning only change
+  // the transform uniforms, nothing is uploaded again.
+  class MapGLView : public QOpenGLWidget, protected QOpenGLFunctions
+  {
+    public:
+
+      MapGLView(MapFrame* frame);
+      ~MapGLView();
+
+      // These are called by MapFrame::paintMap between beginNativePainting()
+      // and endNativePainting().
+
+      // scale and translate take map coordinates to normalised device
+      // coordinates
+      void setTransform(QVector2D scale, QVector2D translate);
+
+      // Uploads the points added to path since the last call with the same
+      // key, then draws the path as a line strip or as points. offset is
+      // added to every point.
+      void drawPath(const std::string& key, const RoverPath& path, unsigned long generation, QVector2D offset, QColor color, bool as_points);
+
+    protected:
+
+      void initializeGL();
+      void paintGL();
+
+    private:
+
+      // Uploads the points of path that are not in buffer yet, or all of
+      // them if they don't fit or the path changed
+      void upload(MapGLPathBuffer& buffer, const RoverPath& path, unsigned long generation);
+
+      MapFrame* frame;
+      QOpenGLShaderProgram program;
+      // The path buffers of all rovers. Each view has its own: the main map
+      // and the popout are in different windows, and rqt creates the
+      // application without Qt::AA_ShareOpenGLContexts, so their contexts
+      // cannot share buffers.
+      std::map<std::string, MapGLPathBuffer> paths;
+  };
+
+}
+
+#endif // MAPGLVIEW_H
@@ -0,0 +1,99 @@
+#include "RoverPath.h"
+
+#include <cmath>
+
+using namespace std;
+
+RoverPath::RoverPath(size_t recent_capacity, size_t history_capacity, float tolerance)
+{
+    this->recent_capacity = recent_capacity;
+    this->history_capacity = history_capacity;
+    initial_tolerance = tolerance;
+    history_tolerance = tolerance;
+    added = 0;
+}
+
+void RoverPath::add(float x, float y)
+{
+    recent.push_back(pair<float,float>(x,y));
+    added++;
+
+    if (recent.size() <= recent_capacity) return;
+
+    // Move the oldest half of the recent points to the history
+    vector< pair<float,float> > older(recent.begin(), recent.begin() + recent_capacity/2);
+    recent.erase(recent.begin(), recent.begin() + recent_capacity/2);
+
+    simplify(older, history_tolerance);
+    history.insert(history.end(), older.begin(), older.end());
+
+    while (history.size() > history_capacity)
+    {
+        history_tolerance *= 2;
+        simplify(history, history_tolerance);
+    }
+}
+
+void RoverPath::clear()
+{
+    history.clear();
+    recent.clear();
+    history_tolerance = initial_tolerance;
+    added = 0;
+}
+
+// Iterative Douglas-Peucker so long paths cannot overflow the stack. The end
+// points are always kept.
+void RoverPath::simplify(vector< pair<float,float> >& path, float tolerance)
+{
+    if (path.size() < 3) return;
+
+    vector<bool> keep(path.size(), false);
+    keep.front() = true;
+    keep.back() = true;
+
+    vector< pair<size_t,size_t> > spans;
+    spans.push_back(pair<size_t,size_t>(0, path.size()-1));
+
+    while (!spans.empty())
+    {
+        size_t first = spans.back().first;
+        size_t last = spans.back().second;
+        spans.pop_back();
+
+        float dx = path[last].first - path[first].first;
+        float dy = path[last].second - path[first].second;
+        float length = hypot(dx, dy);
+
+        size_t farthest = first;
+        float max_distance = 0;
+        for (size_t i = first+1; i < last; i++)
+        {
+            float px = path[i].first - path[first].first;
+            float py = path[i].second - path[first].second;
+
+            // Distance to the line through the span ends, or to the first end
+            // if they coincide
+            float distance = length > 0 ? fabs(px*dy - py*dx)/length : hypot(px, py);
+            if (distance > max_distance)
+            {
+                max_distance = distance;
+                farthest = i;
+            }
+        }
+
+        if (max_distance > tolerance)
+        {
+            keep[farthest] = true;
+            if (farthest - first > 1) spans.push_back(pair<size_t,size_t>(first, farthest));
+            if (last - farthest > 1) spans.push_back(pair<size_t,size_t>(farthest, last));
+        }
+    }
+
+    size_t kept = 0;
+    for (size_t i = 0; i < path.size(); i++)
+    {
+        if (keep[i]) path[kept++] = path[i];
+    }
+    path.resize(kept);
+}
@@ -0,0 +1,71 @@
+#ifndef ROVERPATH_H
+#define ROVERPATH_H
+
+#include <cstddef> // For size_t
+#include <deque>
+#include <utility> // For STL std::pair
+#include <vector>
+
+// Bounded storage for one rover path in the map display.
+//
+// The newest points are kept exactly in a fixed size ring. When the ring
+// fills up its oldest half is simplified with the Douglas-Peucker algorithm
+// and moved to the history. When the history fills up it is simplified
+// again with twice the tolerance, so old parts of the path lose detail
+// gradually and the total size never exceeds the two capacities.
+class RoverPath
+{
+public:
+    // Capacities are in points, the tolerance is the initial Douglas-Peucker
+    // tolerance for the history in map units (metres)
+    RoverPath(size_t recent_capacity = 2000, size_t history_capacity = 4000, float tolerance = 0.01);
+
+    void add(float x, float y);
+    void clear();
+
+    bool empty() const { return history.empty() && recent.empty(); }
+    size_t size() const { return history.size() + recent.size(); }
+    std::pair<float,float> back() const { return recent.empty() ? history.back() : recent.back(); }
+
+    // Number of points added since the path was cleared, including the ones
+    // simplified away. Used as a position in the path by forEachSince().
+    unsigned long addedCount() const { return added; }
+
+    // Calls visit(x, y) for the points added at or after position first,
+    // oldest first. Returns false without visiting anything if some of them
+    // are no longer stored exactly.
+    template <typename Visitor>
+    bool forEachSince(unsigned long first, Visitor visit) const
+    {
+        unsigned long recent_first = added - recent.size();
+        if (first < recent_first) return false;
+
+        for (size_t i = first - recent_first; i < recent.size(); i++) visit(recent[i].first, recent[i].second);
+        return true;
+    }
+
+    // Calls visit(x, y) for every stored point, oldest first
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        for (const std::pair<float,float>& point : history) visit(point.first, point.second);
+        for (const std::pair<float,float>& point : recent) visit(point.first, point.second);
+    }
+
+private:
+
+    // Removes the points of path that are within tolerance of the line
+    // through the points kept around them
+    static void simplify(std::vector< std::pair<float,float> >& path, float tolerance);
+
+    size_t recent_capacity;
+    size_t history_capacity;
+    float initial_tolerance;
+    float history_tolerance;
+    unsigned long added;
+
+    std::vector< std::pair<float,float> > history;
+    std::deque< std::pair<float,float> > recent;
+};
+
+#endif // ROVERPATH_H
@@ -0,0 +1,132 @@
+#include "RoverSession.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace rqt_rover_gui
+{
+
+void RoverSession::shutdown()
+{
+  control_mode_publisher.shutdown();
+  waypoint_cmd_publisher.shutdown();
+
+  telemetry_subscriber.shutdown();
+  waypoint_subscriber.shutdown();
+  obstacle_subscriber.shutdown();
+  behaviour_state_subscriber.shutdown();
+  path_subscriber.shutdown();
+  gps_nav_solution_subscriber.shutdown();
+}
+
+void RoverRegistry::sync(const set<string>& names, vector<unique_ptr<RoverSession>>& disconnected, vector<int>& connected_ids)
+{
+  vector<int> removed_ids;
+  vector<string> added_names;
+
+  map<string, int>::iterator current = by_name.begin();
+  set<string>::const_iterator wanted = names.begin();
+  while (current != by_name.end() || wanted != names.end())
+  {
+    if (wanted == names.end() || (current != by_name.end() && current->first < *wanted))
+    {
+      // Registered but no longer connected
+      removed_ids.push_back(current->second);
+      disconnected.push_back(remove(current->second));
+      current = by_name.erase(current);
+    }
+    else if (current == by_name.end() || *wanted < current->first)
+    {
+      added_names.push_back(*wanted);
+      ++wanted;
+    }
+    else
+    {
+      ++current;
+      ++wanted;
+    }
+  }
+
+  for (size_t i = 0; i < added_names.size(); i++)
+  {
+    connected_ids.push_back(add(added_names[i]).id);
+  }
+
+  // Only now so none of the new rovers get an id the old rovers' callbacks may still use
+  free_ids.insert(free_ids.end(), removed_ids.begin(), removed_ids.end());
+}
+
+void RoverRegistry::clear(vector<unique_ptr<RoverSession>>& disconnected)
+{
+  for (map<string, int>::iterator it = by_name.begin(); it != by_name.end(); ++it)
+  {
+    disconnected.push_back(remove(it->second));
+    free_ids.push_back(it->second);
+  }
+  by_name.clear();
+}
+
+RoverSession* RoverRegistry::find(int id)
+{
+  if (id < 0 || id >= (int)sessions.size()) return NULL;
+  return sessions[id].get();
+}
+
+RoverSession* RoverRegistry::find(const string& name)
+{
+  map<string, int>::const_iterator it = by_name.find(name);
+  if (it == by_name.end()) return NULL;
+  return sessions[it->second].get();
+}
+
+vector<int> RoverRegistry::ids() const
+{
+  vector<int> result;
+  result.reserve(by_name.size());
+  for (map<string, int>::const_iterator it = by_name.begin(); it != by_name.end(); ++it)
+  {
+    result.push_back(it->second);
+  }
+  return result;
+}
+
+vector<string> RoverRegistry::names() const
+{
+  vector<string> result;
+  result.reserve(by_name.size());
+  for (map<string, int>::const_iterator it = by_name.begin(); it != by_name.end(); ++it)
+  {
+    result.push_back(it->first);
+  }
+  return result;
+}
+
+// The lowest free id is used so the ids stay dense when rovers come and go
+RoverSession& RoverRegistry::add(const string& name)
+{
+  int id;
+  if (free_ids.empty())
+  {
+    id = sessions.size();
+    sessions.push_back(unique_ptr<RoverSession>());
+  }
+  else
+  {
+    vector<int>::iterator lowest = min_element(free_ids.begin(), free_ids.end());
+    id = *lowest;
+    free_ids.erase(lowest);
+  }
+
+  sessions[id].reset(new RoverSession(id, name));
+  by_name[name] = id;
+  return *sessions[id];
+}
+
+// Leaves the id out of free_ids and name in by_name, the callers deal with both
+unique_ptr<RoverSession> RoverRegistry::remove(int id)
+{
+  return move(sessions[id]);
+}
+
+}
@@ -0,0 +1,112 @@
+/*!
+ * \brief  The GUI's bookkeeping for each connected rover. A RoverSession
+ *         owns the publishers and subscribers the GUI keeps for one rover
+ *         along with the rover's status and control state, so connecting
+ *         and disconnecting a rover is one add or remove. Sessions are
+ *         numbered with small dense ids that index straight into the
+ *         registry; the per rover ROS callbacks are bound to the id so they
+ *         find their session without parsing topic names.
+ * \class  RoverSession, RoverRegistry
+ */
+
+#ifndef ROVERSESSION_H
+#define ROVERSESSION_H
+
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <vector>
+#include <ros/ros.h>
+#include "swarmie_msgs/WaypointBatch.h"
+
+// RoverStaus holds status messages from rovers and time
+// time they were received. The time is used to detect
+// disconnected rovers. The status message can be any string
+// in the past it has been used to display the team name
+// in the GUI
+struct RoverStatus {
+    std::string status_msg;
+    ros::Time timestamp;
+};
+
+namespace rqt_rover_gui
+{
+  struct RoverSession {
+
+      // The control states a rover can be put in from the GUI
+      enum ControlState {
+          UNSET = 0, // Not selected in this session yet
+          MANUAL = 1,
+          AUTONOMOUS = 2
+      };
+
+      RoverSession(int id, const std::string& name) : id(id), name(name) {}
+
+      // Shuts down every publisher and subscriber of the rover
+      void shutdown();
+
+      const int id;
+      const std::string name;
+
+      ros::Publisher control_mode_publisher;
+      ros::Publisher waypoint_cmd_publisher;
+
+      ros::Subscriber telemetry_subscriber;
+      ros::Subscriber waypoint_subscriber;
+      ros::Subscriber obstacle_subscriber;
+      ros::Subscriber behaviour_state_subscriber;
+      ros::Subscriber path_subscriber;
+      ros::Subscriber gps_nav_solution_subscriber;
+
+      RoverStatus status;
+      int control_state = UNSET;
+      int num_satellites = 0;
+
+      // Waypoint commands from the map not yet sent, see
+      // RoverGUIPlugin::sendWaypointCmdsTimerEventHandler(). Only used by
+      // the GUI thread.
+      swarmie_msgs::WaypointBatch pending_waypoint_cmds;
+  };
+
+  // The sessions of the connected rovers. Not thread safe, the owner guards it.
+  class RoverRegistry {
+
+    public:
+
+      // Brings the registry in line with the rovers now connected. Sessions of
+      // rovers that went away are moved to disconnected, and sessions are
+      // made for names that are new, their ids appended to connected_ids.
+      // One pass over both name lists, which are kept in order. The ids of
+      // the disconnected sessions are only given out again by later calls, so
+      // shut those sessions down before the next one.
+      void sync(const std::set<std::string>& names,
+                std::vector<std::unique_ptr<RoverSession>>& disconnected,
+                std::vector<int>& connected_ids);
+
+      // Moves every session to disconnected, see sync()
+      void clear(std::vector<std::unique_ptr<RoverSession>>& disconnected);
+
+      // NULL if there is no such rover
+      RoverSession* find(int id);
+      RoverSession* find(const std::string& name);
+
+      // Ids in order of rover name, the order the rover list shows them in
+      std::vector<int> ids() const;
+      std::vector<std::string> names() const;
+
+      bool empty() const { return by_name.empty(); }
+      size_t size() const { return by_name.size(); }
+
+    private:
+
+      RoverSession& add(const std::string& name);
+      std::unique_ptr<RoverSession> remove(int id);
+
+      std::vector<std::unique_ptr<RoverSession>> sessions; // Indexed by id, NULL where a rover left
+      std::vector<int> free_ids;
+      std::map<std::string, int> by_name;
+  };
+}
+
+#endif // ROVERSESSION_H
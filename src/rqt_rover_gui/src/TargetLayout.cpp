@@ -0,0 +1,86 @@
+#include "TargetLayout.h"
+
+#include <cstdlib>
+
+using namespace std;
+
+namespace rqt_rover_gui
+{
+
+TargetLayout::TargetLayout(float arena_dim, float barrier_clearance, float cube_clearance,
+                           function<bool(float, float, float)> is_occupied)
+    : arena_dim(arena_dim), barrier_clearance(barrier_clearance), cube_clearance(cube_clearance), is_occupied(is_occupied)
+{
+}
+
+int TargetLayout::addSingles(int count)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float x, y;
+        if (!draw(cube_clearance, x, y)) return i;
+        place(x, y);
+    }
+    return count;
+}
+
+int TargetLayout::addClusters(int count, int length, int width, float cluster_clearance)
+{
+    for (int i = 0; i < count; i++)
+    {
+        float x, y;
+        if (!draw(cluster_clearance, x, y)) return i;
+
+        // The cubes are laid out from one cube row and column before the drawn position
+        float cube_y = y - cube_clearance * length;
+        for (int j = 0; j < length; j++)
+        {
+            float cube_x = x - cube_clearance * width;
+            for (int k = 0; k < width; k++)
+            {
+                place(cube_x, cube_y);
+                cube_x += cube_clearance;
+            }
+            cube_y += cube_clearance;
+        }
+    }
+    return count;
+}
+
+// d is the distance from the center of the arena to the boundary minus the barrier clearance, i.e. the region where
+// targets can be placed is d - U(0,2d) where U(a,b) is a uniform distribition bounded by a and b.
+bool TargetLayout::draw(float clearance, float& x, float& y)
+{
+    float d = arena_dim/2.0 - (barrier_clearance + clearance);
+
+    for (int attempt = 0; attempt < max_attempts; attempt++)
+    {
+        x = d - ((float) rand()) / RAND_MAX*2*d;
+        y = d - ((float) rand()) / RAND_MAX*2*d;
+        if (!isOccupied(x, y, clearance)) return true;
+    }
+    return false;
+}
+
+// The same test as GazeboSimManager::isLocationOccupied for the targets not yet queued there
+bool TargetLayout::isOccupied(float x, float y, float clearance) const
+{
+    if (is_occupied(x, y, clearance)) return true;
+
+    float min_distance = clearance + cube_clearance;
+    for (size_t i = 0; i < targets.size(); i++)
+    {
+        float dx = x - targets[i].x;
+        float dy = y - targets[i].y;
+        if (dx*dx + dy*dy < min_distance*min_distance) return true;
+    }
+    return false;
+}
+
+void TargetLayout::place(float x, float y)
+{
+    TargetPlacement target = {x, y};
+    targets.push_back(target);
+}
+
+}
@@ -0,0 +1,64 @@
+/*!
+ * \brief  Computes where the targets of a distribution go before any of them
+ *         is spawned. Positions are drawn uniformly in the arena and rejected
+ *         while they overlap something already in the world or a target
+ *         placed before them (Poisson disk sampling by dart throwing), so
+ *         no two targets are closer than their clearances allow. Every draw
+ *         uses rand() in a fixed order, so the same world_seed always gives
+ *         the same layout.
+ * \class  TargetLayout
+ */
+
+#ifndef TARGETLAYOUT_H
+#define TARGETLAYOUT_H
+
+#include <functional>
+#include <vector>
+
+namespace rqt_rover_gui
+{
+  struct TargetPlacement {
+      float x;
+      float y;
+  };
+
+  class TargetLayout {
+
+    public:
+      // is_occupied(x, y, clearance) tells whether a model with the
+      // clearance at x, y would overlap a model already in the world.
+      // cube_clearance is the clearance of one target, which is also the
+      // spacing of the targets in a cluster.
+      TargetLayout(float arena_dim, float barrier_clearance, float cube_clearance,
+                   std::function<bool(float, float, float)> is_occupied);
+
+      // Places count single targets. Returns how many found room.
+      int addSingles(int count);
+
+      // Places count clusters of length rows by width columns of targets,
+      // keeping cluster_clearance around each cluster's corner position.
+      // Returns how many clusters found room.
+      int addClusters(int count, int length, int width, float cluster_clearance);
+
+      // In the order they were placed, target i is model "at<i>"
+      const std::vector<TargetPlacement>& placements() const { return targets; }
+
+    private:
+      // Draws positions until one is free, giving up after max_attempts
+      bool draw(float clearance, float& x, float& y);
+      bool isOccupied(float x, float y, float clearance) const;
+      void place(float x, float y);
+
+      static const int max_attempts = 100000;
+
+      float arena_dim;
+      float barrier_clearance;
+      float cube_clearance;
+      std::function<bool(float, float, float)> is_occupied;
+
+      // At most a few hundred, so isOccupied checks them all
+      std::vector<TargetPlacement> targets;
+  };
+}
+
+#endif // TARGETLAYOUT_H
@@ -0,0 +1,151 @@
+#ifndef TRANSFORM3D_H
+#define TRANSFORM3D_H
+
+#include <cmath>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Fixed size 3D math for the IMU display. Points are packed float4s and
+// transforms 4x4 matrices stored by column, so transforming a point is four
+// multiply-adds of whole columns, done with SSE2 where the compiler targets
+// it. The matrices are set up once per orientation or camera, not per point.
+
+namespace rqt_rover_gui
+{
+
+struct alignas(16) Vec4
+{
+    float v[4];
+
+    static Vec4 point(float x, float y, float z)
+    {
+        Vec4 p = {{x, y, z, 1}};
+        return p;
+    }
+
+    float x() const { return v[0]; }
+    float y() const { return v[1]; }
+    float z() const { return v[2]; }
+};
+
+struct alignas(16) Mat4
+{
+    float column[4][4];
+
+    // Element in row r and column c
+    float& at(int r, int c) { return column[c][r]; }
+    float at(int r, int c) const { return column[c][r]; }
+
+    static Mat4 identity()
+    {
+        Mat4 m = {};
+        for (int i = 0; i < 4; i++) m.column[i][i] = 1;
+        return m;
+    }
+
+    // Rotates by the quaternion w + xi + yj + zk in the way w + uv - u x v
+    // rotates vectors, without normalizing it first
+    static Mat4 fromQuaternion(float w, float x, float y, float z)
+    {
+        float scale = w*w - (x*x + y*y + z*z);
+
+        Mat4 m = identity();
+        m.at(0,0) = scale + 2*x*x;
+        m.at(0,1) = 2*x*y - 2*w*z;
+        m.at(0,2) = 2*x*z + 2*w*y;
+        m.at(1,0) = 2*x*y + 2*w*z;
+        m.at(1,1) = scale + 2*y*y;
+        m.at(1,2) = 2*y*z - 2*w*x;
+        m.at(2,0) = 2*x*z - 2*w*y;
+        m.at(2,1) = 2*y*z + 2*w*x;
+        m.at(2,2) = scale + 2*z*z;
+        return m;
+    }
+
+    // Rotates by angle radians about an axis of any length
+    static Mat4 aboutAxis(float angle, float u, float v, float w)
+    {
+        float length = std::sqrt(u*u + v*v + w*w);
+        u /= length;
+        v /= length;
+        w /= length;
+
+        float c = std::cos(angle);
+        float s = std::sin(angle);
+
+        Mat4 m = identity();
+        m.at(0,0) = u*u + (v*v + w*w) * c;
+        m.at(0,1) = u*v * (1 - c) - w * s;
+        m.at(0,2) = u*w * (1 - c) + v * s;
+        m.at(1,0) = u*v * (1 - c) + w * s;
+        m.at(1,1) = v*v + (u*u + w*w) * c;
+        m.at(1,2) = v*w * (1 - c) - u * s;
+        m.at(2,0) = u*w * (1 - c) - v * s;
+        m.at(2,1) = v*w * (1 - c) + u * s;
+        m.at(2,2) = w*w + (u*u + v*v) * c;
+        return m;
+    }
+
+    // Moves a point by -position, then rotates it by the x, y and z Euler
+    // angles of a camera, the view transform of IMUFrame's camera
+    static Mat4 camera(float x, float y, float z, float angle_x, float angle_y, float angle_z)
+    {
+        float c_x = std::cos(angle_x), s_x = std::sin(angle_x);
+        float c_y = std::cos(angle_y), s_y = std::sin(angle_y);
+        float c_z = std::cos(angle_z), s_z = std::sin(angle_z);
+
+        Mat4 m = identity();
+        m.at(0,0) = c_y*c_z;
+        m.at(0,1) = c_y*s_z;
+        m.at(0,2) = -s_y;
+        m.at(1,0) = s_x*s_y*c_z - c_x*s_z;
+        m.at(1,1) = s_x*s_y*s_z + c_x*c_z;
+        m.at(1,2) = s_x*c_y;
+        m.at(2,0) = c_x*s_y*c_z + s_x*s_z;
+        m.at(2,1) = c_x*s_y*s_z - s_x*c_z;
+        m.at(2,2) = c_x*c_y;
+
+        for (int r = 0; r < 3; r++)
+            m.at(r,3) = -(m.at(r,0)*x + m.at(r,1)*y + m.at(r,2)*z);
+        return m;
+    }
+
+    // Transforms count points from in to out, which may be the same array
+    void transform(const Vec4* in, Vec4* out, int count) const
+    {
+#if defined(__SSE2__)
+        __m128 c0 = _mm_load_ps(column[0]);
+        __m128 c1 = _mm_load_ps(column[1]);
+        __m128 c2 = _mm_load_ps(column[2]);
+        __m128 c3 = _mm_load_ps(column[3]);
+        for (int i = 0; i < count; i++)
+        {
+            __m128 sum = _mm_mul_ps(c0, _mm_set1_ps(in[i].v[0]));
+            sum = _mm_add_ps(sum, _mm_mul_ps(c1, _mm_set1_ps(in[i].v[1])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(c2, _mm_set1_ps(in[i].v[2])));
+            sum = _mm_add_ps(sum, _mm_mul_ps(c3, _mm_set1_ps(in[i].v[3])));
+            _mm_store_ps(out[i].v, sum);
+        }
+#else
+        for (int i = 0; i < count; i++)
+        {
+            Vec4 p = in[i];
+            for (int r = 0; r < 4; r++)
+                out[i].v[r] = column[0][r]*p.v[0] + column[1][r]*p.v[1] + column[2][r]*p.v[2] + column[3][r]*p.v[3];
+        }
+#endif
+    }
+
+    Vec4 operator*(const Vec4& p) const
+    {
+        Vec4 out;
+        transform(&p, &out, 1);
+        return out;
+    }
+};
+
+}
+
+#endif // TRANSFORM3D_H
@@ -0,0 +1,339 @@
+#include "TrialLog.h"
+
+#include <algorithm>
+#include <cstring>
+
+using namespace std;
+
+namespace rqt_rover_gui
+{
+
+static size_t padded(size_t bytes)
+{
+    return (bytes + 7) & ~(size_t)7;
+}
+
+static bool isPathStream(int stream)
+{
+    return stream < TRIAL_SCORE;
+}
+
+bool TrialLogWriter::open(const string& path, double start_time)
+{
+    close();
+
+    lock_guard<std::mutex> lock(mutex);
+
+    file = fopen(path.c_str(), "wb");
+    if (file == NULL) return false;
+
+    TrialLogHeader header;
+    memcpy(header.magic, "SWTL", 4);
+    header.version = TRIAL_LOG_VERSION;
+    header.reserved = 0;
+    header.start_time = start_time;
+
+    if (fwrite(&header, sizeof(header), 1, file) != 1)
+    {
+        fclose(file);
+        file = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void TrialLogWriter::close()
+{
+    flush();
+
+    lock_guard<std::mutex> lock(mutex);
+
+    if (file == NULL) return;
+
+    fclose(file);
+    file = NULL;
+    rover_numbers.clear();
+    buffers.clear();
+}
+
+bool TrialLogWriter::isOpen()
+{
+    lock_guard<std::mutex> lock(mutex);
+    return file != NULL;
+}
+
+void TrialLogWriter::addPathPoints(const string& rover, TrialStream stream, double time, const float* x, const float* y, size_t count)
+{
+    lock_guard<std::mutex> lock(mutex);
+
+    if (file == NULL || !isPathStream(stream)) return;
+
+    uint16_t number = roverNumber(rover);
+    Buffer& samples = buffer(number, stream, time);
+    samples.time.insert(samples.time.end(), count, time);
+    samples.x.insert(samples.x.end(), x, x + count);
+    samples.y.insert(samples.y.end(), y, y + count);
+
+    if (samples.time.size() >= CHUNK_SAMPLES) writeBuffer(number, stream, samples);
+}
+
+void TrialLogWriter::addEvent(const string& rover, TrialStream stream, double time, int32_t value)
+{
+    lock_guard<std::mutex> lock(mutex);
+
+    if (file == NULL || isPathStream(stream) || stream >= TRIAL_ROVER_NAME) return;
+
+    uint16_t number = rover.empty() ? TRIAL_ROVER : roverNumber(rover);
+    Buffer& samples = buffer(number, stream, time);
+    samples.time.push_back(time);
+    samples.value.push_back(value);
+
+    if (samples.time.size() >= CHUNK_SAMPLES) writeBuffer(number, stream, samples);
+}
+
+void TrialLogWriter::flush()
+{
+    lock_guard<std::mutex> lock(mutex);
+
+    if (file == NULL) return;
+
+    for (map<pair<uint16_t,int>, Buffer>::iterator it = buffers.begin(); it != buffers.end(); ++it)
+    {
+        writeBuffer(it->first.first, it->first.second, it->second);
+    }
+    fflush(file);
+}
+
+// Rovers are numbered when they are first logged and their name chunk is
+// written then, so it always comes before the rover's samples
+uint16_t TrialLogWriter::roverNumber(const string& rover)
+{
+    map<string, uint16_t>::iterator found = rover_numbers.find(rover);
+    if (found != rover_numbers.end()) return found->second;
+
+    uint16_t number = rover_numbers.size();
+    rover_numbers[rover] = number;
+
+    vector<const void*> columns(1, rover.data());
+    vector<size_t> sizes(1, rover.size());
+    writeChunk(number, TRIAL_ROVER_NAME, rover.size(), columns, sizes);
+
+    return number;
+}
+
+TrialLogWriter::Buffer& TrialLogWriter::buffer(uint16_t rover, TrialStream stream, double& time)
+{
+    // Callbacks on different threads can take their times out of order
+    Buffer& samples = buffers[make_pair(rover, (int)stream)];
+    if (time < samples.last_time) time = samples.last_time;
+    samples.last_time = time;
+    return samples;
+}
+
+void TrialLogWriter::writeChunk(uint16_t rover, int stream, uint32_t count, const vector<const void*>& columns, const vector<size_t>& sizes)
+{
+    size_t bytes = 0;
+    for (size_t i = 0; i < sizes.size(); i++) bytes += sizes[i];
+
+    TrialChunkHeader header;
+    memcpy(header.magic, "SWTC", 4);
+    header.stream = stream;
+    header.rover = rover;
+    header.count = count;
+    header.bytes = padded(bytes);
+
+    static const char padding[8] = {0};
+
+    fwrite(&header, sizeof(header), 1, file);
+    for (size_t i = 0; i < columns.size(); i++) fwrite(columns[i], 1, sizes[i], file);
+    fwrite(padding, 1, header.bytes - bytes, file);
+}
+
+void TrialLogWriter::writeBuffer(uint16_t rover, int stream, Buffer& samples)
+{
+    if (samples.time.empty()) return;
+
+    vector<const void*> columns;
+    vector<size_t> sizes;
+
+    columns.push_back(samples.time.data());
+    sizes.push_back(samples.time.size() * sizeof(double));
+    if (isPathStream(stream))
+    {
+        columns.push_back(samples.x.data());
+        sizes.push_back(samples.x.size() * sizeof(float));
+        columns.push_back(samples.y.data());
+        sizes.push_back(samples.y.size() * sizeof(float));
+    }
+    else
+    {
+        columns.push_back(samples.value.data());
+        sizes.push_back(samples.value.size() * sizeof(int32_t));
+    }
+
+    writeChunk(rover, stream, samples.time.size(), columns, sizes);
+
+    samples.time.clear();
+    samples.x.clear();
+    samples.y.clear();
+    samples.value.clear();
+}
+
+bool TrialLogReader::open(const QString& path, QString& error)
+{
+    close();
+
+    file.setFileName(path);
+    if (!file.open(QIODevice::ReadOnly))
+    {
+        error = file.errorString();
+        return false;
+    }
+
+    qint64 size = file.size();
+    if (size < (qint64)sizeof(TrialLogHeader) || (data = file.map(0, size)) == NULL)
+    {
+        error = "Could not map " + path;
+        close();
+        return false;
+    }
+
+    const TrialLogHeader* header = (const TrialLogHeader*)data;
+    if (memcmp(header->magic, "SWTL", 4) != 0 || header->version != TRIAL_LOG_VERSION)
+    {
+        error = path + " is not a trial log this version of the GUI can read";
+        close();
+        return false;
+    }
+
+    start_time = end_time = header->start_time;
+
+    // Index the chunks, stopping at the first that is not whole
+    size_t offset = sizeof(TrialLogHeader);
+    while (offset + sizeof(TrialChunkHeader) <= (size_t)size)
+    {
+        const TrialChunkHeader* chunk_header = (const TrialChunkHeader*)(data + offset);
+        const uchar* payload = data + offset + sizeof(TrialChunkHeader);
+        size_t next = offset + sizeof(TrialChunkHeader) + chunk_header->bytes;
+
+        if (memcmp(chunk_header->magic, "SWTC", 4) != 0 || next > (size_t)size) break;
+        offset = next;
+
+        if (chunk_header->stream == TRIAL_ROVER_NAME)
+        {
+            // The name is count bytes of the payload, a chunk claiming more is damaged
+            if (chunk_header->count > chunk_header->bytes) continue;
+            if (chunk_header->rover >= rover_names.size()) rover_names.resize(chunk_header->rover + 1);
+            rover_names[chunk_header->rover] = string((const char*)payload, chunk_header->count);
+            continue;
+        }
+
+        // Skip streams from later versions and chunks whose columns do not fit
+        size_t sample_size = isPathStream(chunk_header->stream) ? sizeof(double) + 2 * sizeof(float) : sizeof(double) + sizeof(int32_t);
+        if (chunk_header->count == 0 || chunk_header->stream >= TRIAL_NUM_STREAMS ||
+            chunk_header->count * sample_size > chunk_header->bytes) continue;
+
+        Column& samples = column(chunk_header->rover, chunk_header->stream);
+
+        Chunk chunk;
+        chunk.first = samples.count;
+        chunk.count = chunk_header->count;
+        chunk.time = (const double*)payload;
+        chunk.x = (const float*)(chunk.time + chunk.count);
+        chunk.y = chunk.x + chunk.count;
+        chunk.value = (const int32_t*)(chunk.time + chunk.count);
+
+        samples.chunks.push_back(chunk);
+        samples.count += chunk.count;
+
+        end_time = max(end_time, chunk.time[chunk.count - 1]);
+    }
+
+    // Name chunks always come first, but a rover whose name is missing can still be shown
+    for (size_t i = 0; i < rover_names.size(); i++)
+    {
+        if (rover_names[i].empty()) rover_names[i] = "rover " + to_string(i);
+    }
+
+    return true;
+}
+
+void TrialLogReader::close()
+{
+    if (data) file.unmap((uchar*)data);
+    data = NULL;
+    file.close();
+
+    rover_names.clear();
+    rover_columns.clear();
+    trial_columns.clear();
+    start_time = end_time = 0;
+}
+
+size_t TrialLogReader::count(int rover, TrialStream stream) const
+{
+    const Column* samples = findColumn(rover, stream);
+    return samples ? samples->count : 0;
+}
+
+size_t TrialLogReader::countUntil(int rover, TrialStream stream, double time) const
+{
+    const Column* samples = findColumn(rover, stream);
+    if (!samples) return 0;
+
+    // The first chunk that ends after time holds the answer
+    vector<Chunk>::const_iterator chunk = upper_bound(samples->chunks.begin(), samples->chunks.end(), time,
+        [](double t, const Chunk& c) { return t < c.time[c.count - 1]; });
+    if (chunk == samples->chunks.end()) return samples->count;
+
+    return chunk->first + (upper_bound(chunk->time, chunk->time + chunk->count, time) - chunk->time);
+}
+
+double TrialLogReader::timeAt(int rover, TrialStream stream, size_t index) const
+{
+    const Column* samples = findColumn(rover, stream);
+    if (!samples || index >= samples->count) return 0;
+
+    const Chunk& chunk = samples->chunks[chunkContaining(*samples, index)];
+    return chunk.time[index - chunk.first];
+}
+
+int32_t TrialLogReader::valueAt(int rover, TrialStream stream, size_t index) const
+{
+    const Column* samples = findColumn(rover, stream);
+    if (!samples || index >= samples->count || isPathStream(stream)) return 0;
+
+    const Chunk& chunk = samples->chunks[chunkContaining(*samples, index)];
+    return chunk.value[index - chunk.first];
+}
+
+const TrialLogReader::Column* TrialLogReader::findColumn(int rover, TrialStream stream) const
+{
+    if (stream < 0 || stream >= TRIAL_NUM_STREAMS) return NULL;
+    if (rover == TRIAL_ROVER) return trial_columns.empty() ? NULL : &trial_columns[stream];
+    if (rover < 0 || rover >= (int)rover_columns.size()) return NULL;
+    return &rover_columns[rover][stream];
+}
+
+TrialLogReader::Column& TrialLogReader::column(uint16_t rover, int stream)
+{
+    if (rover == TRIAL_ROVER)
+    {
+        trial_columns.resize(TRIAL_NUM_STREAMS);
+        return trial_columns[stream];
+    }
+
+    if (rover >= rover_columns.size()) rover_columns.resize(rover + 1, vector<Column>(TRIAL_NUM_STREAMS));
+    if (rover >= rover_names.size()) rover_names.resize(rover + 1);
+    return rover_columns[rover][stream];
+}
+
+size_t TrialLogReader::chunkContaining(const Column& column, size_t index)
+{
+    vector<Chunk>::const_iterator chunk = upper_bound(column.chunks.begin(), column.chunks.end(), index,
+        [](size_t i, const Chunk& c) { return i < c.first; });
+    return chunk == column.chunks.begin() ? 0 : chunk - column.chunks.begin() - 1;
+}
+
+}
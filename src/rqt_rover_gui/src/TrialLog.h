@@ -0,0 +1,200 @@
+/*!
+ * \brief  A log of what the GUI received from the rovers during a trial:
+ *         their paths, obstacle calls, waypoints reached and control
+ *         modes, and the trial's score. TrialLogWriter appends it while
+ *         the trial runs, TrialLogReader maps a log into memory so
+ *         TrialPlayer can seek anywhere in it without parsing the file.
+ *
+ *         The file is a TrialLogHeader followed by chunks. A chunk is a
+ *         TrialChunkHeader followed by the columns of count samples of one
+ *         stream of one rover:
+ *           path streams:  double time[count], float x[count], float y[count]
+ *           other streams: double time[count], int32_t value[count]
+ *           rover names:   count bytes of the name, padded
+ *         Chunk payloads are padded to 8 bytes so the columns can be read
+ *         in place. Times are ROS seconds and never decrease within a
+ *         stream. Chunks are appended as the writer's buffers fill and on
+ *         flush(), so a log cut short by a crash is readable up to its
+ *         last whole chunk.
+ * \class  TrialLogWriter, TrialLogReader
+ */
+
+#ifndef TRIALLOG_H
+#define TRIALLOG_H
+
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <mutex>
+#include <stdint.h>
+#include <string>
+#include <utility>
+#include <vector>
+#include <QFile>
+#include <QString>
+
+namespace rqt_rover_gui
+{
+  // The path streams are numbered like the sources in PathBatch.msg. Append
+  // new streams before TRIAL_NUM_STREAMS so old logs still read.
+  enum TrialStream {
+      TRIAL_ENCODER_PATH = 0,
+      TRIAL_EKF_PATH = 1,
+      TRIAL_GPS_PATH = 2,
+      TRIAL_SCORE,            // targets collected, trial wide
+      TRIAL_OBSTACLE,         // obstacle call code, left or right
+      TRIAL_WAYPOINT_REACHED, // waypoint id
+      TRIAL_MODE,             // RoverSession::ControlState
+      TRIAL_ROVER_NAME,
+      TRIAL_BEHAVIOUR_STATE,  // BehaviourState process state, logic state << 8, controller << 16, reason << 24
+      TRIAL_NUM_STREAMS
+  };
+
+  // The rover number of the trial wide streams
+  const uint16_t TRIAL_ROVER = 0xFFFF;
+
+#pragma pack(push, 1)
+
+  struct TrialLogHeader {
+      char magic[4];       // "SWTL"
+      uint16_t version;
+      uint16_t reserved;
+      double start_time;   // when the log was opened
+  };
+
+  struct TrialChunkHeader {
+      char magic[4];       // "SWTC"
+      uint16_t stream;     // TrialStream
+      uint16_t rover;      // numbered in the order the rovers were first logged, or TRIAL_ROVER
+      uint32_t count;      // samples in the chunk
+      uint32_t bytes;      // size of the padded payload
+  };
+
+#pragma pack(pop)
+
+  const uint16_t TRIAL_LOG_VERSION = 1;
+
+  // Thread safe
+  class TrialLogWriter {
+
+    public:
+      TrialLogWriter() : file(NULL) {}
+      ~TrialLogWriter() { close(); }
+
+      // Replaces the file at path. Returns false if it could not be created.
+      bool open(const std::string& path, double start_time);
+
+      // Writes what is buffered and closes the file
+      void close();
+      bool isOpen();
+
+      // Adds path points of a stream below TRIAL_SCORE
+      void addPathPoints(const std::string& rover, TrialStream stream, double time, const float* x, const float* y, size_t count);
+
+      // Adds a sample to one of the other streams. Use an empty rover name
+      // for the trial wide streams.
+      void addEvent(const std::string& rover, TrialStream stream, double time, int32_t value);
+
+      // Writes the buffered samples as chunks
+      void flush();
+
+    private:
+      struct Buffer {
+          std::vector<double> time;
+          std::vector<float> x;
+          std::vector<float> y;
+          std::vector<int32_t> value;
+          double last_time = 0; // kept across flushes to keep the times in order
+      };
+
+      // Samples per buffer before it is written out
+      static const size_t CHUNK_SAMPLES = 1024;
+
+      // Hold mutex for these
+      uint16_t roverNumber(const std::string& rover);
+      Buffer& buffer(uint16_t rover, TrialStream stream, double& time);
+      void writeChunk(uint16_t rover, int stream, uint32_t count, const std::vector<const void*>& columns, const std::vector<size_t>& sizes);
+      void writeBuffer(uint16_t rover, int stream, Buffer& buffer);
+
+      std::mutex mutex;
+      FILE* file;
+      std::map<std::string, uint16_t> rover_numbers;
+      std::map<std::pair<uint16_t,int>, Buffer> buffers;
+  };
+
+  // Reads a log through a read only mapping of the file. The columns point
+  // into the mapping, so nothing is copied when the log is opened.
+  class TrialLogReader {
+
+    public:
+      TrialLogReader() : data(NULL), start_time(0), end_time(0) {}
+      ~TrialLogReader() { close(); }
+
+      // Returns false and sets error if the file can not be mapped or is
+      // not a trial log
+      bool open(const QString& path, QString& error);
+      void close();
+
+      double startTime() const { return start_time; }
+      double endTime() const { return end_time; }
+
+      // Indexed by the rover numbers used by the other methods
+      const std::vector<std::string>& roverNames() const { return rover_names; }
+
+      size_t count(int rover, TrialStream stream) const;
+
+      // Number of samples of the stream at or before time
+      size_t countUntil(int rover, TrialStream stream, double time) const;
+
+      double timeAt(int rover, TrialStream stream, size_t index) const;
+      int32_t valueAt(int rover, TrialStream stream, size_t index) const;
+
+      // Calls visit(x, y, n) with the runs of points first to last - 1 of a
+      // path stream, oldest first. Each run is contiguous in the mapping.
+      template <typename Visitor>
+      void forEachPathRun(int rover, TrialStream stream, size_t first, size_t last, Visitor visit) const
+      {
+          const Column* column = findColumn(rover, stream);
+          if (!column || first >= last) return;
+
+          for (size_t i = chunkContaining(*column, first); i < column->chunks.size() && column->chunks[i].first < last; i++)
+          {
+              const Chunk& chunk = column->chunks[i];
+              size_t from = first > chunk.first ? first - chunk.first : 0;
+              size_t to = last - chunk.first < chunk.count ? last - chunk.first : chunk.count;
+              visit(chunk.x + from, chunk.y + from, to - from);
+          }
+      }
+
+    private:
+      struct Chunk {
+          size_t first; // index of the chunk's first sample in the column
+          size_t count;
+          const double* time;
+          const float* x;
+          const float* y;
+          const int32_t* value;
+      };
+
+      struct Column {
+          std::vector<Chunk> chunks;
+          size_t count = 0;
+      };
+
+      const Column* findColumn(int rover, TrialStream stream) const;
+      Column& column(uint16_t rover, int stream);
+      static size_t chunkContaining(const Column& column, size_t index);
+
+      QFile file;
+      const uchar* data;
+
+      std::vector<std::string> rover_names;
+      std::vector< std::vector<Column> > rover_columns;
+      std::vector<Column> trial_columns;
+
+      double start_time;
+      double end_time;
+  };
+}
+
+#endif // TRIALLOG_H
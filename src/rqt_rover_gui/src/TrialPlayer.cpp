@@ -0,0 +1,267 @@
+#include "TrialPlayer.h"
+
+#include <cmath>
+#include <QCheckBox>
+#include <QDoubleSpinBox>
+#include <QFileInfo>
+#include <QGridLayout>
+#include <QHBoxLayout>
+#include <QLabel>
+#include <QPushButton>
+#include <QSlider>
+#include <QTimer>
+
+#include "MapFrame.h"
+#include "RoverSession.h"
+#include "swarmie_msgs/BehaviourState.h"
+
+using namespace std;
+
+namespace rqt_rover_gui
+{
+
+// Slider steps per second of the trial
+static const int SLIDER_RESOLUTION = 10;
+
+TrialPlayer::TrialPlayer(QWidget* parent) : QWidget(parent, Qt::Window)
+{
+    position = 0;
+    playing = false;
+
+    map_frame = new MapFrame(this, 0);
+    map_frame->setMapData(&map_data);
+
+    play_button = new QPushButton("Play");
+    slider = new QSlider(Qt::Horizontal);
+    slider->setRange(0, 0);
+
+    speed_box = new QDoubleSpinBox();
+    speed_box->setRange(0.1, 1000);
+    speed_box->setDecimals(1);
+    speed_box->setValue(10);
+    speed_box->setSuffix("x");
+
+    gps_checkbox = new QCheckBox("GPS");
+    ekf_checkbox = new QCheckBox("EKF");
+    encoder_checkbox = new QCheckBox("Encoder");
+    ekf_checkbox->setChecked(true);
+    encoder_checkbox->setChecked(true);
+
+    time_label = new QLabel();
+    readout_label = new QLabel();
+    readout_label->setWordWrap(true);
+
+    QHBoxLayout* controls = new QHBoxLayout();
+    controls->addWidget(play_button);
+    controls->addWidget(slider, 1);
+    controls->addWidget(time_label);
+    controls->addWidget(speed_box);
+
+    QHBoxLayout* display = new QHBoxLayout();
+    display->addWidget(gps_checkbox);
+    display->addWidget(ekf_checkbox);
+    display->addWidget(encoder_checkbox);
+    display->addStretch(1);
+
+    QGridLayout* layout = new QGridLayout();
+    layout->addWidget(map_frame, 0, 0);
+    layout->setRowStretch(0, 1);
+    layout->addLayout(controls, 1, 0);
+    layout->addLayout(display, 2, 0);
+    layout->addWidget(readout_label, 3, 0);
+    setLayout(layout);
+
+    setGeometry(QRect(10, 10, 600, 700));
+    setStyleSheet("background-color: rgb(0, 0, 0); color: white; border-color: rgb(255, 255, 255);");
+    play_button->setStyleSheet("color: white; border:1px solid white; padding: 2px 8px");
+    speed_box->setStyleSheet("color: white; border:1px solid white;");
+
+    connect(play_button, SIGNAL(pressed()), this, SLOT(playButtonEventHandler()));
+    connect(slider, SIGNAL(valueChanged(int)), this, SLOT(sliderMovedEventHandler(int)));
+    connect(gps_checkbox, SIGNAL(toggled(bool)), this, SLOT(displayCheckboxToggledEventHandler()));
+    connect(ekf_checkbox, SIGNAL(toggled(bool)), this, SLOT(displayCheckboxToggledEventHandler()));
+    connect(encoder_checkbox, SIGNAL(toggled(bool)), this, SLOT(displayCheckboxToggledEventHandler()));
+    displayCheckboxToggledEventHandler();
+
+    // Advances playback and repaints the map when points were added
+    frame_timer = new QTimer(this);
+    connect(frame_timer, SIGNAL(timeout()), this, SLOT(frameTimerEventHandler()));
+    frame_timer->start(1000 / 30);
+}
+
+bool TrialPlayer::open(const QString& path, QString& error)
+{
+    pause();
+
+    const vector<string>& old_rovers = log.roverNames();
+    for (size_t i = 0; i < old_rovers.size(); i++)
+    {
+        map_data.clear(old_rovers[i]);
+        map_frame->clear(old_rovers[i]);
+    }
+    shown.clear();
+
+    bool opened = log.open(path, error);
+
+    const vector<string>& rovers = log.roverNames();
+    for (size_t i = 0; i < rovers.size(); i++)
+    {
+        map_frame->setWhetherToDisplay(rovers[i], true);
+    }
+    shown.assign(rovers.size(), array<size_t,3>{{0, 0, 0}});
+
+    double duration = log.endTime() - log.startTime();
+    slider->blockSignals(true);
+    slider->setRange(0, ceil(duration * SLIDER_RESOLUTION));
+    slider->setValue(0);
+    slider->blockSignals(false);
+
+    setWindowTitle(opened ? "Trial Playback: " + QFileInfo(path).fileName() : "Trial Playback");
+
+    position = 0;
+    seek(0);
+    map_frame->update();
+
+    return opened;
+}
+
+void TrialPlayer::play()
+{
+    // Play from the start again once the end was reached
+    if (position >= log.endTime() - log.startTime()) seek(0);
+
+    playing = true;
+    play_clock.start();
+    play_button->setText("Pause");
+}
+
+void TrialPlayer::pause()
+{
+    playing = false;
+    play_button->setText("Play");
+}
+
+void TrialPlayer::seek(double seconds)
+{
+    double duration = log.endTime() - log.startTime();
+    if (seconds < 0) seconds = 0;
+    if (seconds > duration) seconds = duration;
+
+    position = seconds;
+    double time = log.startTime() + seconds;
+
+    const vector<string>& rovers = log.roverNames();
+    for (size_t rover = 0; rover < rovers.size(); rover++)
+    {
+        array<size_t,3> wanted;
+        bool back = false;
+        for (int stream = TRIAL_ENCODER_PATH; stream <= TRIAL_GPS_PATH; stream++)
+        {
+            wanted[stream] = log.countUntil(rover, (TrialStream)stream, time);
+            if (wanted[stream] < shown[rover][stream]) back = true;
+        }
+
+        // RoverPath only appends, so going back starts the rover over
+        if (back)
+        {
+            map_data.clear(rovers[rover]);
+            shown[rover] = array<size_t,3>{{0, 0, 0}};
+            map_frame->update();
+        }
+
+        for (int stream = TRIAL_ENCODER_PATH; stream <= TRIAL_GPS_PATH; stream++)
+        {
+            const string& name = rovers[rover];
+            log.forEachPathRun(rover, (TrialStream)stream, shown[rover][stream], wanted[stream],
+                [this, &name, stream](const float* x, const float* y, size_t count) {
+                    map_frame->addToRoverPath(name, stream, x, y, count);
+                });
+            shown[rover][stream] = wanted[stream];
+        }
+    }
+
+    slider->blockSignals(true);
+    slider->setValue(round(seconds * SLIDER_RESOLUTION));
+    slider->blockSignals(false);
+
+    time_label->setText(formatTime(seconds) + " / " + formatTime(duration));
+    updateReadouts(time);
+}
+
+void TrialPlayer::playButtonEventHandler()
+{
+    if (playing) pause();
+    else play();
+}
+
+void TrialPlayer::sliderMovedEventHandler(int value)
+{
+    seek((double)value / SLIDER_RESOLUTION);
+}
+
+void TrialPlayer::frameTimerEventHandler()
+{
+    if (playing)
+    {
+        seek(position + play_clock.restart() / 1000.0 * speed_box->value());
+        if (position >= log.endTime() - log.startTime()) pause();
+    }
+
+    map_frame->refresh();
+}
+
+void TrialPlayer::displayCheckboxToggledEventHandler()
+{
+    map_frame->setDisplayGPSData(gps_checkbox->isChecked());
+    map_frame->setDisplayEKFData(ekf_checkbox->isChecked());
+    map_frame->setDisplayEncoderData(encoder_checkbox->isChecked());
+    map_frame->update();
+}
+
+void TrialPlayer::updateReadouts(double time)
+{
+    QString text;
+
+    size_t scores = log.countUntil(TRIAL_ROVER, TRIAL_SCORE, time);
+    text += "Targets collected: " + (scores ? QString::number(log.valueAt(TRIAL_ROVER, TRIAL_SCORE, scores - 1)) : QString("---"));
+
+    const vector<string>& rovers = log.roverNames();
+    for (size_t rover = 0; rover < rovers.size(); rover++)
+    {
+        size_t modes = log.countUntil(rover, TRIAL_MODE, time);
+        int mode = modes ? log.valueAt(rover, TRIAL_MODE, modes - 1) : RoverSession::UNSET;
+
+        text += "\n" + QString::fromStdString(rovers[rover]) + ": ";
+        text += mode == RoverSession::AUTONOMOUS ? "autonomous" : mode == RoverSession::MANUAL ? "manual" : "---";
+
+        size_t states = log.countUntil(rover, TRIAL_BEHAVIOUR_STATE, time);
+        if (states)
+        {
+            text += ", " + processStateName(log.valueAt(rover, TRIAL_BEHAVIOUR_STATE, states - 1) & 0xFF);
+        }
+        text += ", " + QString::number(log.countUntil(rover, TRIAL_OBSTACLE, time)) + " obstacle calls";
+        text += ", " + QString::number(log.countUntil(rover, TRIAL_WAYPOINT_REACHED, time)) + " waypoints reached";
+    }
+
+    readout_label->setText(text);
+}
+
+QString TrialPlayer::processStateName(int process_state)
+{
+    switch (process_state)
+    {
+    case swarmie_msgs::BehaviourState::PROCESS_SEARCHING: return "searching";
+    case swarmie_msgs::BehaviourState::PROCESS_TARGET_PICKEDUP: return "returning a target";
+    case swarmie_msgs::BehaviourState::PROCESS_DROP_OFF: return "dropping off";
+    case swarmie_msgs::BehaviourState::PROCESS_MANUAL: return "manual control";
+    default: return "unknown state";
+    }
+}
+
+QString TrialPlayer::formatTime(double seconds)
+{
+    int whole = seconds;
+    return QString("%1:%2:%3").arg(whole / 3600).arg(whole / 60 % 60, 2, 10, QChar('0')).arg(whole % 60, 2, 10, QChar('0'));
+}
+
+}
@@ -0,0 +1,86 @@
+/*!
+ * \brief  A window that plays back a trial log on a map of its own. The
+ *         position can be scrubbed with the slider or played at any speed.
+ *         Moving forward adds the logged points up to the new time to the
+ *         player's MapData, moving back clears the rovers and adds their
+ *         points again, so no message has to be received twice. Readouts
+ *         under the map show the score and each rover's mode, obstacle
+ *         calls and waypoints reached at the current time.
+ * \class  TrialPlayer
+ */
+
+#ifndef TRIALPLAYER_H
+#define TRIALPLAYER_H
+
+#include <array>
+#include <vector>
+#include <QElapsedTimer>
+#include <QWidget>
+
+#include "MapData.h"
+#include "TrialLog.h"
+
+class QCheckBox;
+class QDoubleSpinBox;
+class QLabel;
+class QPushButton;
+class QSlider;
+class QTimer;
+
+namespace rqt_rover_gui
+{
+  class MapFrame;
+
+  class TrialPlayer : public QWidget
+  {
+    Q_OBJECT
+
+    public:
+      TrialPlayer(QWidget* parent = 0);
+
+      // Replaces the open log. Returns false and sets error if the log
+      // could not be read.
+      bool open(const QString& path, QString& error);
+
+    public slots:
+      void play();
+      void pause();
+
+      // Shows the trial as it was seconds after the log was opened
+      void seek(double seconds);
+
+    private slots:
+      void playButtonEventHandler();
+      void sliderMovedEventHandler(int value);
+      void frameTimerEventHandler();
+      void displayCheckboxToggledEventHandler();
+
+    private:
+      void updateReadouts(double time);
+      QString formatTime(double seconds);
+      QString processStateName(int process_state);
+
+      TrialLogReader log;
+      MapData map_data;
+
+      // Points of each rover's paths currently in map_data, by path stream
+      std::vector< std::array<size_t,3> > shown;
+
+      double position; // seconds since the start of the log
+      bool playing;
+      QElapsedTimer play_clock;
+
+      MapFrame* map_frame;
+      QSlider* slider;
+      QPushButton* play_button;
+      QDoubleSpinBox* speed_box;
+      QCheckBox* gps_checkbox;
+      QCheckBox* ekf_checkbox;
+      QCheckBox* encoder_checkbox;
+      QLabel* time_label;
+      QLabel* readout_label;
+      QTimer* frame_timer;
+  };
+}
+
+#endif // TRIALPLAYER_H
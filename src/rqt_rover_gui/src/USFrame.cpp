@@ -4,6 +4,7 @@
 #include <iostream>
 #include <cmath>
 
+#include <QMutexLocker>
 #include <USFrame.h>
 
 namespace rqt_rover_gui {
@@ -21,9 +22,57 @@ USFrame::USFrame(QWidget *parent, Qt::WindowFlags flags) : QFrame(parent) {
   right_min_range = 0.0;
   center_min_range = 0.0;
 
+  received.center_range = center_range;
+  received.center_min_range = center_min_range;
+  received.center_max_range = center_max_range;
+  received.left_range = left_range;
+  received.left_min_range = left_min_range;
+  received.left_max_range = left_max_range;
+  received.right_range = right_range;
+  received.right_min_range = right_min_range;
+  received.right_max_range = right_max_range;
+  received_changed = false;
+
+  has_rendered = false;
   frames = 0;
 }
 
+bool USFrame::Rendered::operator==(const Rendered& other) const {
+  return left_end == other.left_end && center_end == other.center_end &&
+         right_end == other.right_end && left_label == other.left_label &&
+         center_label == other.center_label && right_label == other.right_label;
+}
+
+USFrame::Rendered USFrame::render() const {
+  float frame_width = this->width();
+  float frame_height = this->height();
+
+  // Use unit coordinate system and scale to the size of the frame
+  float frame_center_x = frame_width*0.5;
+
+  QPoint left_end_point(0, 0);
+  QPoint right_end_point(frame_width, 0);
+  QPoint center_end_point(frame_center_x, 0);
+
+  QPoint start_point(frame_width/2, frame_height-20);
+
+  float left_scale = left_range/left_max_range;
+  float right_scale = right_range/right_max_range;
+  float center_scale = center_range/center_max_range;
+
+  // Equation of a line from two points. The cooefficent (*_scale) scales the
+  // line. Presumes the range is on the interval [0,1]
+  Rendered state;
+  state.left_end = start_point + left_scale*(left_end_point-start_point);
+  state.right_end = start_point + right_scale*(right_end_point-start_point);
+  state.center_end = start_point + center_scale*(center_end_point-start_point);
+
+  state.left_label = roundf(left_range * 100) / 100;
+  state.right_label = roundf(right_range * 100) / 100;
+  state.center_label = roundf(center_range * 100) / 100;
+  return state;
+}
+
 void USFrame::paintEvent(QPaintEvent* event) {
   QPainter painter(this);
   painter.setPen(Qt::white);
@@ -47,38 +96,20 @@ void USFrame::paintEvent(QPaintEvent* event) {
 
   float frame_width = this->width();
   float frame_height = this->height();
-
-  // Use unit coordinate system and scale to the size of the frame
   float frame_center_x = frame_width*0.5;
-  float frame_center_y = frame_height*0.5;
-
-  QPoint left_end_point(0, 0);
-  QPoint right_end_point(frame_width, 0);
-  QPoint center_end_point(frame_center_x, 0);
 
   QPoint start_point(frame_width/2, frame_height-20);
 
-  float left_scale = left_range/left_max_range;
-  float right_scale = right_range/right_max_range;
-  float center_scale = center_range/center_max_range;
-
-  // Equation of a line from two points. The cooefficent (*_scale) scales the
-  // line. Presumes the range is on the interval [0,1]
-  QPoint left_vector = start_point + left_scale*(left_end_point-start_point);
-  QPoint right_vector = start_point + right_scale*(right_end_point-start_point);
-  QPoint center_vector = start_point + center_scale*(center_end_point-start_point);
-
-  painter.drawLine(start_point, left_vector);
-  painter.drawLine(start_point, center_vector);
-  painter.drawLine(start_point, right_vector);
+  rendered = render();
+  has_rendered = true;
 
-  float left_range_rounded = roundf(left_range * 100) / 100;
-  float right_range_rounded = roundf(right_range * 100) / 100;
-  float center_range_rounded = roundf(center_range * 100) / 100;
+  painter.drawLine(start_point, rendered.left_end);
+  painter.drawLine(start_point, rendered.center_end);
+  painter.drawLine(start_point, rendered.right_end);
 
-  QString left_range_in_meters_qstr = QString::number(left_range_rounded)+"m";
-  QString right_range_in_meters_qstr = QString::number(right_range_rounded)+"m";
-  QString center_range_in_meters_qstr = QString::number(center_range_rounded)+"m";
+  QString left_range_in_meters_qstr = QString::number(rendered.left_label)+"m";
+  QString right_range_in_meters_qstr = QString::number(rendered.right_label)+"m";
+  QString center_range_in_meters_qstr = QString::number(rendered.center_label)+"m";
 
   painter.drawText(QPoint(frame_center_x-frame_width/4 -
                    fm.width(left_range_in_meters_qstr)/2,frame_height),
@@ -92,24 +123,48 @@ void USFrame::paintEvent(QPaintEvent* event) {
 }
 
 void USFrame::setCenterRange(float r, float min, float max) {
-  center_range = r;
-  center_min_range = min;
-  center_max_range = max;
-  emit delayedUpdate();
+  QMutexLocker locker(&received_mutex);
+  received.center_range = r;
+  received.center_min_range = min;
+  received.center_max_range = max;
+  received_changed = true;
 }
 
 void USFrame::setLeftRange(float r, float min, float max) {
-  left_range = r;
-  left_min_range = min;
-  left_max_range = max;
-  emit delayedUpdate();
+  QMutexLocker locker(&received_mutex);
+  received.left_range = r;
+  received.left_min_range = min;
+  received.left_max_range = max;
+  received_changed = true;
 }
 
 void USFrame::setRightRange(float r, float min, float max) {
-  right_range = r;
-  right_min_range = min;
-  right_max_range = max;
-  emit delayedUpdate();
+  QMutexLocker locker(&received_mutex);
+  received.right_range = r;
+  received.right_min_range = min;
+  received.right_max_range = max;
+  received_changed = true;
+}
+
+void USFrame::refresh() {
+  {
+    QMutexLocker locker(&received_mutex);
+    if (!received_changed) return;
+    received_changed = false;
+
+    center_range = received.center_range;
+    center_min_range = received.center_min_range;
+    center_max_range = received.center_max_range;
+    left_range = received.left_range;
+    left_min_range = received.left_min_range;
+    left_max_range = received.left_max_range;
+    right_range = received.right_range;
+    right_min_range = received.right_min_range;
+    right_max_range = received.right_max_range;
+  }
+
+  if (has_rendered && render() == rendered) return;
+  update();
 }
 
 } /* END: namespace rqt_rover_gui */
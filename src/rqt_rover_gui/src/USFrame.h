@@ -31,6 +31,9 @@ namespace rqt_rover_gui {
 
     public:
       USFrame(QWidget *parent, Qt::WindowFlags = 0);
+
+      // These are called from the ROS thread and only store the range. The
+      // frame shows it on the next refresh().
       void setCenterRange(float r, float min, float max);
       void setLeftRange(float r, float min, float max);
       void setRightRange(float r, float min, float max);
@@ -39,12 +42,27 @@ namespace rqt_rover_gui {
       void delayedUpdate();
 
     public slots:
-      // currently, no class-defined slots are being used
+      // Called by the GUI refresh timer. Repaints if a range changed by
+      // enough to move a ray by a pixel or change its label.
+      void refresh();
 
     protected:
       void paintEvent(QPaintEvent *event);
 
     private:
+      // What paintEvent() draws for the current ranges and frame size
+      struct Rendered {
+        QPoint left_end, center_end, right_end;
+        float left_label, center_label, right_label; // rounded to cm
+
+        bool operator==(const Rendered& other) const;
+      };
+      Rendered render() const;
+
+      // What was drawn last, valid once painted
+      Rendered rendered;
+      bool has_rendered;
+
       float center_range;
       float left_range;
       float right_range;
@@ -58,6 +76,16 @@ namespace rqt_rover_gui {
       float right_max_range;
       float right_min_range;
 
+      // The ranges received since the last refresh
+      struct Ranges {
+        float center_range, center_min_range, center_max_range;
+        float left_range, left_min_range, left_max_range;
+        float right_range, right_min_range, right_max_range;
+      };
+      Ranges received;
+      bool received_changed;
+      QMutex received_mutex;
+
       QTime frame_rate_timer;
       int frames;
   };
@@ -37,6 +37,7 @@
 //#include <regex> // For regex expressions
 
 #include "MapData.h"
+#include "TrialPlayer.h"
 
 #include <cv_bridge/cv_bridge.h>
 #include <opencv/cv.h>
@@ -58,12 +59,8 @@ namespace rqt_rover_gui
       is_timer_on(false)
   {
     setObjectName("RoverGUI");
-    info_log_messages = "";
-    diag_log_messages = "";
-
-    // Arbitrarily chosen 10000. These values should be set after experimentation.
-    max_info_log_length = 10000;
-    max_diag_log_length = 10000;
+    // Arbitrarily chosen 1000. This value should be set after experimentation.
+    max_log_lines = 1000;
 
     joy_process = NULL;
     joystickGripperInterface = NULL;
@@ -102,6 +99,11 @@ namespace rqt_rover_gui
     
     context.addWidget(widget);
 
+    info_log_model = new LogModel(max_log_lines, this);
+    diag_log_model = new LogModel(max_log_lines, this);
+    setupLogView(ui.info_log, ui.info_log_filter, info_log_model, info_log_filter_model);
+    setupLogView(ui.diag_log, ui.diag_log_filter, diag_log_model, diag_log_filter_model);
+
     // Next two lines allow us to catch keyboard input
     widget->installEventFilter(this);
     widget->setFocus();
@@ -136,6 +138,7 @@ namespace rqt_rover_gui
     connect(ui.map_auto_radio_button, SIGNAL(toggled(bool)), this, SLOT(mapAutoRadioButtonEventHandler(bool)));
     connect(ui.map_manual_radio_button, SIGNAL(toggled(bool)), this, SLOT(mapManualRadioButtonEventHandler(bool)));
     connect(ui.map_popout_button, SIGNAL(pressed()), this, SLOT(mapPopoutButtonEventHandler()));
+    connect(ui.map_replay_button, SIGNAL(pressed()), this, SLOT(mapReplayButtonEventHandler()));
     connect(this, SIGNAL(allStopButtonSignal()), this, SLOT(allStopButtonEventHandler()));
 
 
@@ -178,8 +181,8 @@ namespace rqt_rover_gui
     // we don't have a real chackbox with toggle events
     connect(ui.map_selection_list, SIGNAL(itemChanged(QListWidgetItem*)), this, SLOT(mapSelectionListItemChangedHandler(QListWidgetItem*)));
 
-    // Create a subscriber to listen for joystick events
-    joystick_subscriber = nh.subscribe("/joy", 1000, &RoverGUIPlugin::joyEventHandler, this);
+    // Create a subscriber to listen for joystick events. Only the latest stick state is used.
+    joystick_subscriber = nh.subscribe("/joy", 1, &RoverGUIPlugin::joyEventHandler, this);
 
     emit sendInfoLogMessage("Searching for rovers...");
 
@@ -191,6 +194,56 @@ namespace rqt_rover_gui
     // Setup the initial display parameters for the map
     ui.map_frame->setMapData(map_data);
     ui.map_frame->createPopoutWindow(map_data); // This has to happen before the display radio buttons are set
+
+    // Large swarms can draw the map with OpenGL instead of QPainter
+    bool map_use_opengl = false;
+    ros::param::get("map_use_opengl", map_use_opengl);
+    ui.map_frame->setUseOpenGL(map_use_opengl);
+
+    // Showing camera images is costly, so cap the rate on slow laptops
+    double camera_max_fps = 15;
+    ros::param::get("camera_max_fps", camera_max_fps);
+    ui.camera_frame->setMaxFrameRate(camera_max_fps);
+
+    // The sonar, IMU and map handlers only store their data. The frames are
+    // repainted at a fixed rate however fast the messages arrive.
+    double display_refresh_rate = 30;
+    ros::param::get("display_refresh_rate", display_refresh_rate);
+    if (display_refresh_rate <= 0) display_refresh_rate = 30;
+
+    display_refresh_timer = new QTimer(this);
+    connect(display_refresh_timer, SIGNAL(timeout()), ui.us_frame, SLOT(refresh()));
+    connect(display_refresh_timer, SIGNAL(timeout()), ui.imu_frame, SLOT(refresh()));
+    connect(display_refresh_timer, SIGNAL(timeout()), ui.map_frame, SLOT(refresh()));
+    connect(display_refresh_timer, SIGNAL(timeout()), info_log_model, SLOT(flush()));
+    connect(display_refresh_timer, SIGNAL(timeout()), diag_log_model, SLOT(flush()));
+    display_refresh_timer->start(1000.0 / display_refresh_rate);
+
+    // Joystick and keyboard commands are sent at a fixed rate, only the latest stick state each time
+    double joystick_command_rate = 10;
+    ros::param::get("joystick_command_rate", joystick_command_rate);
+    if (joystick_command_rate <= 0) joystick_command_rate = 10;
+
+    joystick_command_timer = new QTimer(this);
+    connect(joystick_command_timer, SIGNAL(timeout()), this, SLOT(joystickCommandTimerEventHandler()));
+    connect(joystick_command_timer, SIGNAL(timeout()), this, SLOT(sendWaypointCmdsTimerEventHandler()));
+    joystick_command_timer->start(1000.0 / joystick_command_rate);
+
+    // Record the trial so it can be played back with the Replay button
+    string trial_log_file;
+    ros::param::get("trial_log_file", trial_log_file);
+    if (!trial_log_file.empty())
+    {
+        if (trial_log.open(trial_log_file, ros::Time::now().toSec()))
+        {
+            emit sendInfoLogMessage("Recording the trial to " + QString::fromStdString(trial_log_file));
+        }
+        else
+        {
+            emit sendInfoLogMessage("Could not create the trial log " + QString::fromStdString(trial_log_file));
+        }
+    }
+
     ui.map_frame->setDisplayGPSData(ui.gps_checkbox->isChecked());
     ui.map_frame->setDisplayEncoderData(ui.encoder_checkbox->isChecked());
     ui.map_frame->setDisplayEKFData(ui.ekf_checkbox->isChecked());
@@ -233,6 +286,9 @@ namespace rqt_rover_gui
     ui.map_frame->clear();
     clearSimulationButtonEventHandler();
     rover_poll_timer->stop();
+    display_refresh_timer->stop();
+    joystick_command_timer->stop();
+    trial_log.close();
     stopROSJoyNode();
     ros::shutdown();
   }
@@ -246,15 +302,62 @@ void RoverGUIPlugin::restoreSettings(const qt_gui_cpp::Settings& plugin_settings
 }
 
 
-// Receives messages from the ROS joystick driver and used them to articulate the gripper and drive the rover.
+// Receives messages from the ROS joystick driver. Only the latest stick state is kept, the joystick command timer
+// uses it to articulate the gripper and drive the rover. Runs on the ROS thread.
 void RoverGUIPlugin::joyEventHandler(const sensor_msgs::Joy::ConstPtr& joy_msg)
 {
   // Are we in autonomous mode? If so do not process manual drive and gripper controls.
-  if ( rover_control_state.count(selected_rover_name) == 2 )
   {
-    return;
+    std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+    RoverSession* session = rovers.find(selected_rover_name);
+    if (session && session->control_state == RoverSession::AUTONOMOUS)
+    {
+      return;
+    }
   }
-  
+
+  setJoystickState(*joy_msg);
+}
+
+void RoverGUIPlugin::setJoystickState(const sensor_msgs::Joy& joy_msg)
+{
+    lock_guard<mutex> lock(joystick_state_mutex);
+    joystick_state = joy_msg;
+    joystick_state_changed = true;
+    have_joystick_state = true;
+}
+
+// Forgets the stick state, so a stick held while the rover or its mode changes does not keep commanding it
+void RoverGUIPlugin::clearJoystickState()
+{
+    lock_guard<mutex> lock(joystick_state_mutex);
+    joystick_state = sensor_msgs::Joy();
+    joystick_state_changed = false;
+    have_joystick_state = false;
+}
+
+// Sends the latest stick state at joystick_command_rate however fast the joystick driver publishes, so a
+// physical rover's link is not flooded. Drive commands are only sent when the sticks moved; the gripper
+// keeps moving at a steady speed while its stick is held.
+void RoverGUIPlugin::joystickCommandTimerEventHandler()
+{
+    // Only a rover under manual control takes joystick commands
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        RoverSession* session = rovers.find(selected_rover_name);
+        if (!session || session->control_state != RoverSession::MANUAL) return;
+    }
+
+    sensor_msgs::Joy joy_msg;
+    bool changed;
+    {
+        lock_guard<mutex> lock(joystick_state_mutex);
+        if (!have_joystick_state) return;
+        joy_msg = joystick_state;
+        changed = joystick_state_changed;
+        joystick_state_changed = false;
+    }
+
      // Give the array values some helpful names:
     int left_stick_x_axis = 0; // Gripper fingers close and open
     int left_stick_y_axis = 1; // Gripper wrist up and down
@@ -264,39 +367,42 @@ void RoverGUIPlugin::joyEventHandler(const sensor_msgs::Joy::ConstPtr& joy_msg)
 
     // Note: joystick stick axis output value are between -1 and 1
 
-     if (joystick_publisher)
+     if (joystick_publisher && (int)joy_msg.axes.size() > right_stick_y_axis)
         {
          // Handle drive commands - BEGIN
 
-        //Set the gui values. Filter values to be large enough to move the physical rover.
-        if (joy_msg->axes[right_stick_y_axis] >= 0.1)
-        {
-            emit joystickDriveForwardUpdate(joy_msg->axes[right_stick_y_axis]);
-        }
-        if (joy_msg->axes[right_stick_y_axis] <= -0.1)
-        {
-            emit joystickDriveBackwardUpdate(-joy_msg->axes[right_stick_y_axis]);
-        }
-        //If value is too small, display 0.
-        if (abs(joy_msg->axes[right_stick_y_axis]) < 0.1)
+        if (changed)
         {
-            emit joystickDriveForwardUpdate(0);
-            emit joystickDriveBackwardUpdate(0);
-        }
+            //Set the gui values. Filter values to be large enough to move the physical rover.
+            if (joy_msg.axes[right_stick_y_axis] >= 0.1)
+            {
+                emit joystickDriveForwardUpdate(joy_msg.axes[right_stick_y_axis]);
+            }
+            if (joy_msg.axes[right_stick_y_axis] <= -0.1)
+            {
+                emit joystickDriveBackwardUpdate(-joy_msg.axes[right_stick_y_axis]);
+            }
+            //If value is too small, display 0.
+            if (abs(joy_msg.axes[right_stick_y_axis]) < 0.1)
+            {
+                emit joystickDriveForwardUpdate(0);
+                emit joystickDriveBackwardUpdate(0);
+            }
 
-        if (joy_msg->axes[right_stick_x_axis] >= 0.1)
-        {
-	  emit joystickDriveLeftUpdate(joy_msg->axes[right_stick_x_axis]);
-        }
-        if (joy_msg->axes[right_stick_x_axis] <= -0.1)
-        {
-	  emit joystickDriveRightUpdate(-joy_msg->axes[right_stick_x_axis]);
-        }
-        //If value is too small, display 0.
-        if (abs(joy_msg->axes[right_stick_x_axis]) < 0.1)
-        {
-            emit joystickDriveLeftUpdate(0);
-            emit joystickDriveRightUpdate(0);
+            if (joy_msg.axes[right_stick_x_axis] >= 0.1)
+            {
+                emit joystickDriveLeftUpdate(joy_msg.axes[right_stick_x_axis]);
+            }
+            if (joy_msg.axes[right_stick_x_axis] <= -0.1)
+            {
+                emit joystickDriveRightUpdate(-joy_msg.axes[right_stick_x_axis]);
+            }
+            //If value is too small, display 0.
+            if (abs(joy_msg.axes[right_stick_x_axis]) < 0.1)
+            {
+                emit joystickDriveLeftUpdate(0);
+                emit joystickDriveRightUpdate(0);
+            }
         }
 
         // Handle drive commands - END
@@ -305,45 +411,51 @@ void RoverGUIPlugin::joyEventHandler(const sensor_msgs::Joy::ConstPtr& joy_msg)
 
         // The joystick output is a 1D vector since it has a direction (-/+) and a magnitude.
         // This vector is processed by the JoystickGripperInterface to produce gripper angle commands
-        float wristCommandVector = joy_msg->axes[left_stick_y_axis];
-        float fingerCommandVector = joy_msg->axes[left_stick_x_axis];
+        float wristCommandVector = joy_msg.axes[left_stick_y_axis];
+        float fingerCommandVector = joy_msg.axes[left_stick_x_axis];
 
         // These if statements just determine which GUI element to update.
-        if (wristCommandVector >= 0.1)
+        if (changed)
         {
-            emit joystickGripperWristUpUpdate(wristCommandVector);
-        }
-        if (wristCommandVector <= -0.1)
-        {
-            emit joystickGripperWristDownUpdate(-wristCommandVector);
-        }
+            if (wristCommandVector >= 0.1)
+            {
+                emit joystickGripperWristUpUpdate(wristCommandVector);
+            }
+            if (wristCommandVector <= -0.1)
+            {
+                emit joystickGripperWristDownUpdate(-wristCommandVector);
+            }
 
-        //If value is too small, display 0
-        if (abs(wristCommandVector) < 0.1)
-        {
-            emit joystickGripperWristUpUpdate(0);
-            emit joystickGripperWristDownUpdate(0);
-        }
+            //If value is too small, display 0
+            if (abs(wristCommandVector) < 0.1)
+            {
+                emit joystickGripperWristUpUpdate(0);
+                emit joystickGripperWristDownUpdate(0);
+            }
 
-        if (fingerCommandVector >= 0.1)
-        {
-            emit joystickGripperFingersCloseUpdate(fingerCommandVector);
-        }
+            if (fingerCommandVector >= 0.1)
+            {
+                emit joystickGripperFingersCloseUpdate(fingerCommandVector);
+            }
 
-        if (fingerCommandVector <= -0.1)
-        {
-            emit joystickGripperFingersOpenUpdate(-fingerCommandVector);
-        }
+            if (fingerCommandVector <= -0.1)
+            {
+                emit joystickGripperFingersOpenUpdate(-fingerCommandVector);
+            }
 
-        //If value is too small, display 0
-        if (abs(fingerCommandVector) < 0.1)
-        {
-            emit joystickGripperFingersCloseUpdate(0);
-            emit joystickGripperFingersOpenUpdate(0);
+            //If value is too small, display 0
+            if (abs(fingerCommandVector) < 0.1)
+            {
+                emit joystickGripperFingersCloseUpdate(0);
+                emit joystickGripperFingersOpenUpdate(0);
+            }
         }
 
+        // The gripper is moved every tick, so a stick resting slightly off center must not creep it
+        if (abs(wristCommandVector) < 0.1) wristCommandVector = 0;
+        if (abs(fingerCommandVector) < 0.1) fingerCommandVector = 0;
+
         // Use the joystick output to generate ROS gripper commands
-        // Lock this section so the interface isnt recreated while in use
 
         if (joystickGripperInterface)
         {
@@ -351,11 +463,11 @@ void RoverGUIPlugin::joyEventHandler(const sensor_msgs::Joy::ConstPtr& joy_msg)
                 joystickGripperInterface->moveWrist(wristCommandVector);
                 joystickGripperInterface->moveFingers(fingerCommandVector);
             } catch (JoystickGripperInterfaceNotReadyException e) {
-                emit sendInfoLogMessage("Tried to use the joystick gripper interface before it was ready.");
+                if (changed) emit sendInfoLogMessage("Tried to use the joystick gripper interface before it was ready.");
             }
 
         }
-        else
+        else if (changed)
         {
             emit sendInfoLogMessage("Error: joystickGripperInterface has not been instantiated.");
         }
@@ -363,92 +475,54 @@ void RoverGUIPlugin::joyEventHandler(const sensor_msgs::Joy::ConstPtr& joy_msg)
         // Handle gripper commands - END
 
 
-        joystick_publisher.publish(joy_msg);
+        if (changed) joystick_publisher.publish(joy_msg);
      }
 }
 
-void RoverGUIPlugin::EKFEventHandler(const ros::MessageEvent<const nav_msgs::Odometry> &event)
-{
-    const std::string& publisher_name = event.getPublisherName();
-    const ros::M_string& header = event.getConnectionHeader();
-    ros::Time receipt_time = event.getReceiptTime();
-
-    const boost::shared_ptr<const nav_msgs::Odometry> msg = event.getMessage();
-
-    float x = msg->pose.pose.position.x;
-    float y = msg->pose.pose.position.y;
-
-    QString x_str; x_str.setNum(x);
-    QString y_str; y_str.setNum(y);
-    // Extract rover name from the message source. Publisher is in the format /*rover_name*_MAP
-    size_t found = publisher_name.find("_MAP");
-    string rover_name = publisher_name.substr(1,found-1);
-
-    // Store map info for the appropriate rover name
-    ui.map_frame->addToEKFRoverPath(rover_name, x, y);
-}
-
-
-void RoverGUIPlugin::encoderEventHandler(const ros::MessageEvent<const nav_msgs::Odometry> &event)
-{
-    const std::string& publisher_name = event.getPublisherName();
-    const ros::M_string& header = event.getConnectionHeader();
-    ros::Time receipt_time = event.getReceiptTime();
-
-    string topic = header.at("topic");
-
-    const boost::shared_ptr<const nav_msgs::Odometry> msg = event.getMessage();
-    float x = msg->pose.pose.position.x;
-    float y = msg->pose.pose.position.y;
-
-    QString x_str; x_str.setNum(x);
-    QString y_str; y_str.setNum(y);
-
-    // Extract rover name from the message source. Get the topic name from the event header. Can't use publisher_name here because it is just /gazebo.
-    size_t found = topic.find("/odom/filtered");
-    string rover_name = topic.substr(1,found-1);
-
-    // Store map info for the appropriate rover name
-   ui.map_frame->addToEncoderRoverPath(rover_name, x, y);
-}
-
-
-void RoverGUIPlugin::GPSEventHandler(const ros::MessageEvent<const nav_msgs::Odometry> &event)
+// Path points come from the rover's diagnostics node already decimated, so
+// this runs in proportion to the distance the rovers travel rather than the
+// odometry rate. See PathBatch.msg for the encoding.
+void RoverGUIPlugin::pathEventHandler(int rover_id, const swarmie_msgs::PathBatch::ConstPtr& msg)
 {
-    const std::string& publisher_name = event.getPublisherName();
-    const ros::M_string& header = event.getConnectionHeader();
-    ros::Time receipt_time = event.getReceiptTime();
-
-    const boost::shared_ptr<const nav_msgs::Odometry> msg = event.getMessage();
-    float x = msg->pose.pose.position.x;
-    float y = msg->pose.pose.position.y;
-
-    QString x_str; x_str.setNum(x);
-    QString y_str; y_str.setNum(y);
+    string rover_name;
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        RoverSession* session = rovers.find(rover_id);
+        if (!session) return;
+        rover_name = session->name;
+    }
 
-    // Extract rover name from the message source. Publisher is in the format /*rover_name*_NAVSAT
-    size_t found = publisher_name.find("_NAVSAT");
-    string rover_name = publisher_name.substr(1,found-1);
+    vector<float> xs(msg->dx.size() + 1);
+    vector<float> ys(msg->dy.size() + 1);
+    xs[0] = msg->x;
+    ys[0] = msg->y;
+    for (size_t i = 1; i < xs.size(); i++)
+    {
+        xs[i] = xs[i-1] + msg->dx[i-1] * msg->resolution;
+        ys[i] = ys[i-1] + msg->dy[i-1] * msg->resolution;
+    }
 
-    // Store map info for the appropriate rover name
-    ui.map_frame->addToGPSRoverPath(rover_name, x, y);
+    // Store map info for the appropriate rover name. The trial log streams
+    // are numbered like the batch sources.
+    if (msg->source > swarmie_msgs::PathBatch::GPS) return;
+    ui.map_frame->addToRoverPath(rover_name, msg->source, xs.data(), ys.data(), xs.size());
+    trial_log.addPathPoints(rover_name, (TrialStream)msg->source, ros::Time::now().toSec(), xs.data(), ys.data(), xs.size());
 }
 
-void RoverGUIPlugin::GPSNavSolutionEventHandler(const ros::MessageEvent<const ublox_msgs::NavSOL> &event) {
-    const boost::shared_ptr<const ublox_msgs::NavSOL> msg = event.getMessage();
-
-    // Extract rover name from the message source. Publisher is in the format /*rover_name*_UBLOX
-    size_t found = event.getPublisherName().find("_UBLOX");
-    QString rover_name = event.getPublisherName().substr(1,found-1).c_str();
+void RoverGUIPlugin::GPSNavSolutionEventHandler(int rover_id, const ublox_msgs::NavSOL::ConstPtr& msg) {
+    std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+    RoverSession* session = rovers.find(rover_id);
+    if (!session) return;
 
     // Update the number of sattellites detected for the specified rover
-    rover_numSV_state[rover_name.toStdString()] = msg.get()->numSV;
+    session->num_satellites = msg->numSV;
 
     // only update the label if a rover is selected by the user in the GUI
     // and the number of detected satellites is > 0
-    if (selected_rover_name.compare("") != 0 && msg.get()->numSV > 0) {
+    RoverSession* selected_session = rovers.find(selected_rover_name);
+    if (selected_session && msg->numSV > 0) {
         // Update the label in the GUI with the selected rover's information
-        QString newLabelText = QString::number(rover_numSV_state[selected_rover_name]);
+        QString newLabelText = QString::number(selected_session->num_satellites);
         emit updateNumberOfSatellites("<font color='white'>" + newLabelText + "</font>");
     } else {
         emit updateNumberOfSatellites("<font color='white'>---</font>");
@@ -457,42 +531,14 @@ void RoverGUIPlugin::GPSNavSolutionEventHandler(const ros::MessageEvent<const ub
 
  void RoverGUIPlugin::cameraEventHandler(const sensor_msgs::ImageConstPtr& image)
  {
-     cv_bridge::CvImagePtr cv_image_ptr;
-
-     try
-     {
-        cv_image_ptr = cv_bridge::toCvCopy(image);
-     }
-     catch (cv_bridge::Exception &e)
-     {
-         ROS_ERROR("In rover_gui_plugin.cpp: cv_bridge exception: %s", e.what());
-     }
-
-     int image_cols = cv_image_ptr->image.cols;
-     int image_rows = cv_image_ptr->image.rows;
-     int image_step = cv_image_ptr->image.step;
-
-     ostringstream cols_stream, rows_stream;
-     cols_stream << image_cols;
-     rows_stream << image_rows;
-
-     // For debugging
-     //QString debug_msg = "Received image ";
-     //debug_msg += "(" + QString::number(image_rows) + " x " + QString::number(image_cols) +")";
-     //cout << debug_msg.toStdString() << endl;
-
-    // ROS_INFO_STREAM("Image received Size:" + rows_stream.str() + "x" + cols_stream.str());
-
-     // Create QImage to hold the image
-     //const uchar* image_buffer = (const uchar*)cv_image_ptr->image.data; // extract the raw data
-     QImage qimg(&(image->data[0]), image_cols, image_rows, image_step, QImage::Format_RGB888);
-     qimg = qimg.rgbSwapped(); // Convert from RGB to BGR which is the output format for the rovers.
-     ui.camera_frame->setImage(qimg);
+     // The camera frame keeps a reference to the message and converts it on
+     // the GUI thread when it is shown
+     ui.camera_frame->setImage(image);
  }
 
 set<string> RoverGUIPlugin::findConnectedRovers()
 {
-    set<string> rovers;
+    set<string> rover_names;
 
     ros::master::V_TopicInfo master_topics;
     ros::master::getTopics(master_topics);
@@ -513,52 +559,120 @@ set<string> RoverGUIPlugin::findConnectedRovers()
             found = rover_name.find("/"); // Eliminate potential names with / in them
             if (found==std::string::npos)
             {
-                rovers.insert(rover_name);
+                rover_names.insert(rover_name);
             }
         }
     }
 
-    return rovers;
+    return rover_names;
 }
 
-// Receives and stores the status update messages from rovers
-void RoverGUIPlugin::statusEventHandler(const ros::MessageEvent<std_msgs::String const> &event)
+void RoverGUIPlugin::connectRover(RoverSession& session)
 {
-    const ros::M_string& header = event.getConnectionHeader();
-    ros::Time receipt_time = ros::Time::now();
+    const string& name = session.name;
 
-    // Extract rover name from the message source
+    //Set up publishers
+    session.control_mode_publisher = nh.advertise<std_msgs::UInt8>("/"+name+"/mode", 10, true); // last argument sets latch to true
+    session.waypoint_cmd_publisher = nh.advertise<swarmie_msgs::WaypointBatch>("/"+name+"/waypoints/cmd", 10, true);
 
-    // This method is used rather than reading the publisher name to accomodate teams that changed the node name.
-    string topic = header.at("topic");
-    size_t found = topic.find("/status");
-    string rover_name = topic.substr(1,found-1);
+    //Set up subscribers
+    session.telemetry_subscriber = nh.subscribe<swarmie_msgs::RoverTelemetry>("/"+name+"/telemetry", 1, boost::bind(&RoverGUIPlugin::telemetryEventHandler, this, session.id, _1));
+    session.waypoint_subscriber = nh.subscribe<swarmie_msgs::WaypointBatch>("/"+name+"/waypoints", 10, boost::bind(&RoverGUIPlugin::waypointEventHandler, this, session.id, _1));
+    session.obstacle_subscriber = nh.subscribe<std_msgs::UInt8>("/"+name+"/obstacle", 10, boost::bind(&RoverGUIPlugin::obstacleEventHandler, this, session.id, _1));
+    session.behaviour_state_subscriber = nh.subscribe<swarmie_msgs::BehaviourState>("/"+name+"/behaviour/state", 20, boost::bind(&RoverGUIPlugin::behaviourStateEventHandler, this, session.id, _1));
+    session.path_subscriber = nh.subscribe<swarmie_msgs::PathBatch>("/"+name+"/path", 10, boost::bind(&RoverGUIPlugin::pathEventHandler, this, session.id, _1));
+    session.gps_nav_solution_subscriber = nh.subscribe<ublox_msgs::NavSOL>("/"+name+"/navsol", 10, boost::bind(&RoverGUIPlugin::GPSNavSolutionEventHandler, this, session.id, _1));
+}
 
-    const std_msgs::StringConstPtr& msg = event.getMessage();
+void RoverGUIPlugin::disconnectRovers(vector<unique_ptr<RoverSession>>& sessions)
+{
+    for (size_t i = 0; i < sessions.size(); i++)
+    {
+        const string& name = sessions[i]->name;
+
+        emit sendInfoLogMessage(QString("Clearing interface data for disconnected rover ") + QString::fromStdString(name));
+        map_data->clear(name);
+        ui.map_frame->clear(name);
+
+        // If the currently selected rover disconnected, shutdown its subscribers and publishers
+        if (name.compare(selected_rover_name) == 0)
+        {
+            camera_subscriber.shutdown();
+            imu_subscriber.shutdown();
+            us_center_subscriber.shutdown();
+            us_left_subscriber.shutdown();
+            us_right_subscriber.shutdown();
+            joystick_publisher.shutdown();
+
+            //Reset selected rover name to empty string
+            selected_rover_name = "";
+        }
 
-    string status = msg->data;
+        // Waits for callbacks of the rover that are running, which may be
+        // waiting for rover_sessions_mutex, so it must not be held here
+        sessions[i]->shutdown();
 
-    RoverStatus rover_status;
-    rover_status.status_msg = status;
-    rover_status.timestamp = receipt_time;
+        ui.map_frame->resetWaypointPathForSelectedRover(name);
+    }
 
-    rover_statuses[rover_name] = rover_status;
+    sessions.clear();
 }
 
-void RoverGUIPlugin::waypointEventHandler(const swarmie_msgs::Waypoint& msg)
+// Receives and stores the status update messages from rovers
+// Telemetry from the rover's diagnostics node carries its status and
+// diagnostic data in one message, see RoverTelemetry.msg. The status
+// timestamp is only refreshed while the behaviour node is running so a rover
+// whose behaviours stopped is still shown as disconnected.
+void RoverGUIPlugin::telemetryEventHandler(int rover_id, const swarmie_msgs::RoverTelemetry::ConstPtr& msg)
 {
-  emit sendWaypointReached(msg.id);
+    ros::Time receipt_time = ros::Time::now();
+
+    string rover_name;
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        RoverSession* session = rovers.find(rover_id);
+        if (!session) return;
+
+        session->status.status_msg = msg->status;
+        if (msg->behaviour_running)
+        {
+            session->status.timestamp = receipt_time;
+        }
+        rover_name = session->name;
+    }
+
+    displayDiagnosticData(rover_name, msg->diagnostics);
 }
 
-// Counts the number of obstacle avoidance calls
-void RoverGUIPlugin::obstacleEventHandler(const ros::MessageEvent<const std_msgs::UInt8> &event)
+// Rovers report the waypoints they reached a few at a time
+void RoverGUIPlugin::waypointEventHandler(int rover_id, const swarmie_msgs::WaypointBatch::ConstPtr& msg)
 {
-    const std::string& publisher_name = event.getPublisherName();
-    const ros::M_string& header = event.getConnectionHeader();
-    ros::Time receipt_time = event.getReceiptTime();
+  for (size_t i = 0; i < msg->id.size(); i++)
+  {
+    emit sendWaypointReached(msg->id[i]);
+  }
 
-    const std_msgs::UInt8ConstPtr& msg = event.getMessage();
+  if (trial_log.isOpen())
+  {
+    string rover_name;
+    {
+      std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+      RoverSession* session = rovers.find(rover_id);
+      if (!session) return;
+      rover_name = session->name;
+    }
 
+    double time = ros::Time::now().toSec();
+    for (size_t i = 0; i < msg->id.size(); i++)
+    {
+      trial_log.addEvent(rover_name, TRIAL_WAYPOINT_REACHED, time, msg->id[i]);
+    }
+  }
+}
+
+// Counts the number of obstacle avoidance calls
+void RoverGUIPlugin::obstacleEventHandler(int rover_id, const std_msgs::UInt8::ConstPtr& msg)
+{
     //QString displ = QString("Target number ") + QString::number(msg->data) + QString(" found.");
 
     // 0 for no obstacle, 1 for right side obstacle, and 2 for left side obsticle
@@ -567,9 +681,40 @@ void RoverGUIPlugin::obstacleEventHandler(const ros::MessageEvent<const std_msgs
     if (code != 0)
     {
         emit updateObstacleCallCount("<font color='white'>"+QString::number(++obstacle_call_count)+"</font>");
+
+        if (trial_log.isOpen())
+        {
+            string rover_name;
+            {
+                std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+                RoverSession* session = rovers.find(rover_id);
+                if (!session) return;
+                rover_name = session->name;
+            }
+
+            trial_log.addEvent(rover_name, TRIAL_OBSTACLE, ros::Time::now().toSec(), code);
+        }
     }
 }
 
+// Logs the behaviour state changes of each rover, at the time the rover made
+// them, so the trial player can show what each rover was doing
+void RoverGUIPlugin::behaviourStateEventHandler(int rover_id, const swarmie_msgs::BehaviourState::ConstPtr& msg)
+{
+    if (!trial_log.isOpen()) return;
+
+    string rover_name;
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        RoverSession* session = rovers.find(rover_id);
+        if (!session) return;
+        rover_name = session->name;
+    }
+
+    int32_t value = msg->process_state | msg->logic_state << 8 | msg->controller << 16 | msg->reason << 24;
+    trial_log.addEvent(rover_name, TRIAL_BEHAVIOUR_STATE, msg->stamp.toSec(), value);
+}
+
 // Takes the published score value from the ScorePlugin and updates the GUI
 void RoverGUIPlugin::scoreEventHandler(const ros::MessageEvent<const std_msgs::String> &event) {
     const std::string& publisher_name = event.getPublisherName();
@@ -580,6 +725,8 @@ void RoverGUIPlugin::scoreEventHandler(const ros::MessageEvent<const std_msgs::S
     std::string tags_collected = msg->data;
 
     emit updateNumberOfTagsCollected("<font color='white'>"+QString::fromStdString(tags_collected)+"</font>");
+
+    trial_log.addEvent("", TRIAL_SCORE, receipt_time.toSec(), QString::fromStdString(tags_collected).toInt());
 }
 
 void RoverGUIPlugin::simulationTimerEventHandler(const rosgraph_msgs::Clock& msg) {
@@ -630,6 +777,7 @@ void RoverGUIPlugin::currentRoverChangedEventHandler(QListWidgetItem *current, Q
     string ui_rover_name = rover_name_and_status.substr(0, rover_name_length);
 
     selected_rover_name = ui_rover_name;
+    clearJoystickState();
 
     string rover_name_msg = "<font color='white'>Rover: " + selected_rover_name + "</font>";
     QString rover_name_msg_qstr = QString::fromStdString(rover_name_msg);
@@ -664,29 +812,38 @@ void RoverGUIPlugin::currentRoverChangedEventHandler(QListWidgetItem *current, Q
     QListWidgetItem* map_selection_item = ui.map_selection_list->item(ui.rover_list->row(current));
     map_selection_item->setCheckState(Qt::Checked);
 
-    // No entry for this rover name
-    if ( 0 == rover_control_state.count(selected_rover_name) )
+    int control_state = RoverSession::UNSET;
+    int num_satellites = 0;
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        RoverSession* session = rovers.find(selected_rover_name);
+        if (session)
+        {
+            control_state = session->control_state;
+            num_satellites = session->num_satellites;
+        }
+    }
+
+    // This rover has not been selected before
+    if ( control_state == RoverSession::UNSET )
     {
         // Default to joystick
         ui.joystick_control_radio_button->setChecked(true);
         ui.autonomous_control_radio_button->setChecked(false);
         joystickRadioButtonEventHandler(true); // Manually trigger the joystick selected event
-        rover_control_state[selected_rover_name]=1;
         emit sendInfoLogMessage("New rover selected");
     }
     else
     {
-        int control_state = rover_control_state.find(selected_rover_name)->second;
-
         switch (control_state)
         {
-        case 1: // manual
+        case RoverSession::MANUAL:
             ui.joystick_control_radio_button->setChecked(true);
             ui.autonomous_control_radio_button->setChecked(false);
             ui.joystick_frame->setHidden(false);
             joystickRadioButtonEventHandler(true); // Manually trigger the joystick selected event
             break;
-        case 2: // autonomous
+        case RoverSession::AUTONOMOUS:
             ui.joystick_control_radio_button->setChecked(false);
             ui.autonomous_control_radio_button->setChecked(true);
             ui.joystick_frame->setHidden(true);
@@ -700,8 +857,8 @@ void RoverGUIPlugin::currentRoverChangedEventHandler(QListWidgetItem *current, Q
     }
 
     // only update the number of satellites if a valid rover name has been selected
-    if (selected_rover_name.compare("") != 0 && rover_numSV_state[selected_rover_name] > 0) {
-        QString newLabelText = QString::number(rover_numSV_state[selected_rover_name]);
+    if (num_satellites > 0) {
+        QString newLabelText = QString::number(num_satellites);
         emit updateNumberOfSatellites("<font color='white'>" + newLabelText + "</font>");
     } else {
         emit updateNumberOfSatellites("<font color='white'>---</font>");
@@ -714,6 +871,9 @@ void RoverGUIPlugin::currentRoverChangedEventHandler(QListWidgetItem *current, Q
 
 void RoverGUIPlugin::pollRoversTimerEventHandler()
 {
+    // Keep the trial log readable up to the last poll if the GUI stops
+    trial_log.flush();
+
     //If there are no rovers connected to the GUI, reset the obstacle call count to 0
     if(ui.rover_list->count() == 0)
     {
@@ -721,76 +881,23 @@ void RoverGUIPlugin::pollRoversTimerEventHandler()
     }
 
     // Returns rovers that have created a status topic
-    set<string>new_rover_names = findConnectedRovers();
-
-    std::set<string> orphaned_rover_names;
+    set<string> connected_rover_names = findConnectedRovers();
 
-    // Calculate which of the old rover names are not in the new list of rovers then clear their maps and control states.
-    std::set_difference(rover_names.begin(), rover_names.end(), new_rover_names.begin(), new_rover_names.end(),
-        std::inserter(orphaned_rover_names, orphaned_rover_names.end()));
-
-    for (set<string>::iterator it = orphaned_rover_names.begin(); it != orphaned_rover_names.end(); ++it)
+    vector<unique_ptr<RoverSession>> disconnected;
+    vector<int> connected_ids;
     {
-        emit sendInfoLogMessage(QString("Clearing interface data for disconnected rover ") + QString::fromStdString(*it));
-        map_data->clear(*it);
-        ui.map_frame->clear(*it);
-        rover_control_state.erase(*it); // Remove the control state for orphaned rovers
-        rover_numSV_state.erase(*it);
-        rover_statuses.erase(*it);
-
-        // If the currently selected rover disconnected, shutdown its subscribers and publishers
-        if (it->compare(selected_rover_name) == 0)
-        {
-            camera_subscriber.shutdown();
-            imu_subscriber.shutdown();
-            us_center_subscriber.shutdown();
-            us_left_subscriber.shutdown();
-            us_right_subscriber.shutdown();
-            joystick_publisher.shutdown();
-
-            //Reset selected rover name to empty string
-            selected_rover_name = "";
-        }
-
-        // For the other rovers that disconnected...
-
-        // Shutdown the subscribers
-        status_subscribers[*it].shutdown();
-        waypoint_subscribers[*it].shutdown();
-        encoder_subscribers[*it].shutdown();
-        gps_subscribers[*it].shutdown();
-        gps_nav_solution_subscribers[*it].shutdown();
-        ekf_subscribers[*it].shutdown();
-        rover_diagnostic_subscribers[*it].shutdown();
-
-        // Delete the subscribers
-        status_subscribers.erase(*it);
-        waypoint_subscribers.erase(*it);
-        encoder_subscribers.erase(*it);
-        gps_subscribers.erase(*it);
-        gps_nav_solution_subscribers.erase(*it);
-        ekf_subscribers.erase(*it);
-        rover_diagnostic_subscribers.erase(*it);
-        
-        // Shudown Publishers
-        control_mode_publishers[*it].shutdown();
-        waypoint_cmd_publishers[*it].shutdown();
-
-        // Delete Publishers
-        control_mode_publishers.erase(*it);
-        waypoint_cmd_publishers.erase(*it);
-
-        ui.map_frame->resetWaypointPathForSelectedRover(*it);
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        rovers.sync(connected_rover_names, disconnected, connected_ids);
     }
 
+    // Clear the maps and control states of the rovers that are not in the list of rovers anymore
+    disconnectRovers(disconnected);
+
     // Wait for a rover to connect
-    if (new_rover_names.empty())
+    if (rovers.empty())
     {
         //displayLogMessage("Waiting for rover to connect...");
         selected_rover_name = "";
-        rover_control_state.clear();
-        rover_numSV_state.clear();
-        rover_names.clear();        
         ui.rover_list->clearSelection();
         ui.rover_list->clear();
         ui.rover_diags_list->clear();
@@ -805,7 +912,7 @@ void RoverGUIPlugin::pollRoversTimerEventHandler()
         ui.all_stop_button->setStyleSheet("color: grey; border:2px solid grey;");
 
     }
-    else if (new_rover_names == rover_names)
+    else if (disconnected.empty() && connected_ids.empty())
     {
 
         // Just update the statuses in ui rover list
@@ -813,27 +920,17 @@ void RoverGUIPlugin::pollRoversTimerEventHandler()
         {
             QListWidgetItem *item = ui.rover_list->item(row);
 
-            // Extract rover name
-            string rover_name_and_status = item->text().toStdString();
-
-            // Rover names start at the begining of the rover name and status string and end at the first space
-            size_t rover_name_length = rover_name_and_status.find_first_of(" ");
-            string ui_rover_name = rover_name_and_status.substr(0, rover_name_length);
-
             // Get current status
-
+            string ui_rover_name;
             RoverStatus updated_rover_status;
-            // Build new ui rover list string
-            try
-            {
-                updated_rover_status = rover_statuses.at(ui_rover_name);
-            }
-            catch (std::out_of_range& e)
             {
-                emit sendInfoLogMessage("Error: No status entry for rover " + QString::fromStdString(ui_rover_name));
+                std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+                RoverSession* session = rovers.find(item->data(Qt::UserRole).toInt());
+                if (!session) continue;
+                ui_rover_name = session->name;
+                updated_rover_status = session->status;
             }
 
-
             // Build new ui rover list string
             QString updated_rover_name_and_status = QString::fromStdString(ui_rover_name)
                                                     + " ("
@@ -846,8 +943,6 @@ void RoverGUIPlugin::pollRoversTimerEventHandler()
     }
     else
     {
-    rover_names = new_rover_names;
-    
     emit sendInfoLogMessage("List of connected rovers has changed");
     selected_rover_name = "";
     ui.rover_list->clearSelection();
@@ -861,41 +956,31 @@ void RoverGUIPlugin::pollRoversTimerEventHandler()
     ui.all_autonomous_button->setEnabled(true);
     ui.all_autonomous_button->setStyleSheet("color: white; border:2px solid white;");
 
-    // This code is from above. Consider moving into a function or restructuring
-    for(set<string>::const_iterator i = rover_names.begin(); i != rover_names.end(); ++i)
+    for (size_t i = 0; i < connected_ids.size(); i++)
     {
-        //Set up publishers
-        control_mode_publishers[*i]=nh.advertise<std_msgs::UInt8>("/"+*i+"/mode", 10, true); // last argument sets latch to true
-        waypoint_cmd_publishers[*i]=nh.advertise<swarmie_msgs::Waypoint>("/"+*i+"/waypoints/cmd", 10, true);
-        
-
-        //Set up subscribers
-        status_subscribers[*i] = nh.subscribe("/"+*i+"/status", 10, &RoverGUIPlugin::statusEventHandler, this);
-        waypoint_subscribers[*i] = nh.subscribe("/"+*i+"/waypoints", 10, &RoverGUIPlugin::waypointEventHandler, this);
-        obstacle_subscribers[*i] = nh.subscribe("/"+*i+"/obstacle", 10, &RoverGUIPlugin::obstacleEventHandler, this);
-        encoder_subscribers[*i] = nh.subscribe("/"+*i+"/odom/filtered", 10, &RoverGUIPlugin::encoderEventHandler, this);
-        ekf_subscribers[*i] = nh.subscribe("/"+*i+"/odom/ekf", 10, &RoverGUIPlugin::EKFEventHandler, this);
-        gps_subscribers[*i] = nh.subscribe("/"+*i+"/odom/navsat", 10, &RoverGUIPlugin::GPSEventHandler, this);
-        gps_nav_solution_subscribers[*i] = nh.subscribe("/"+*i+"/navsol", 10, &RoverGUIPlugin::GPSNavSolutionEventHandler, this);
-        rover_diagnostic_subscribers[*i] = nh.subscribe("/"+*i+"/diagnostics", 1, &RoverGUIPlugin::diagnosticEventHandler, this);
+        connectRover(*rovers.find(connected_ids[i]));
+    }
 
+    // The rows are in order of rover name and remember the id of their rover's session
+    vector<int> ids = rovers.ids();
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        string rover_name;
         RoverStatus rover_status;
-        // Build new ui rover list string
-        try
-        {
-            rover_status = rover_statuses.at(*i);
-        }
-        catch (std::out_of_range& e)
         {
-            emit sendInfoLogMessage("No status entry for rover " + QString::fromStdString(*i));
+            std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+            RoverSession* session = rovers.find(ids[i]);
+            rover_name = session->name;
+            rover_status = session->status;
         }
 
-        QString rover_name_and_status = QString::fromStdString(*i) // Add the rover name
+        QString rover_name_and_status = QString::fromStdString(rover_name) // Add the rover name
                                                 + " (" // Delimiters needed for parsing the rover name and status when read
                                                 +  QString::fromStdString(rover_status.status_msg) // Add the rover status
                                                 + ")";
 
         QListWidgetItem* new_item = new QListWidgetItem(rover_name_and_status);
+        new_item->setData(Qt::UserRole, ids[i]);
         new_item->setForeground(Qt::green);
         ui.rover_list->addItem(new_item);
 
@@ -927,16 +1012,15 @@ void RoverGUIPlugin::pollRoversTimerEventHandler()
         QListWidgetItem *rover_item = ui.rover_list->item(row);
         QListWidgetItem *diags_item = ui.rover_diags_list->item(row);
 
-        // Extract rover name
-        string rover_name_and_status = rover_item->text().toStdString();
-
-        // Rover names start at the begining of the rover name and status string and end at the first space
-        size_t rover_name_length = rover_name_and_status.find_first_of(" ");
-        string ui_rover_name = rover_name_and_status.substr(0, rover_name_length);
-
         // Check the time of last contact with this rover
-        RoverStatus rover_status = rover_statuses[ui_rover_name];
-        if (ros::Time::now() - rover_status.timestamp < disconnect_threshold)
+        ros::Time last_contact;
+        {
+            std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+            RoverSession* session = rovers.find(rover_item->data(Qt::UserRole).toInt());
+            if (session) last_contact = session->status.timestamp;
+        }
+
+        if (ros::Time::now() - last_contact < disconnect_threshold)
         {
           rover_item->setForeground(Qt::green);
         }
@@ -1001,33 +1085,23 @@ void RoverGUIPlugin::IMUEventHandler(const sensor_msgs::Imu::ConstPtr& msg)
 
 }
 
-// This handler receives data messages from the diagnostics package. It uses a float array to package the
+// Displays the diagnostic data from a rover's telemetry. The diagnostics package uses a float array to package the
 // data for flexibility. This means callers have to know what data is stored at each poistion.
 // When the data we cant to display stabalizes we should consider changing this to a custom
 // ROS message type that names the data being stored.
-// We extract the sender name from the ROS topic name rather than the publisher node name because that
-// tends to be more stable. Sometimes teams rename the nodes but renaming the topics would cause
-// other problems for them. This is distinct from the diagnostics log handler which received messages rather
+// This is distinct from the diagnostics log handler which received messages rather
 // than continual data readings.
-void RoverGUIPlugin::diagnosticEventHandler(const ros::MessageEvent<const std_msgs::Float32MultiArray> &event) {
-
-    const std::string& publisher_name = event.getPublisherName();
-    const ros::M_string& header = event.getConnectionHeader();
-    ros::Time receipt_time = event.getReceiptTime();
+void RoverGUIPlugin::displayDiagnosticData(const string& rover_name, const vector<float>& data) {
 
-    // Extract rover name from the message source
-    string topic = header.at("topic");
-    size_t found = topic.find("/diagnostics");
-    string rover_name = topic.substr(1,found-1);
-
-    const boost::shared_ptr<const std_msgs::Float32MultiArray> msg = event.getMessage();
+    // Nothing to show until the diagnostics node has sampled the rover
+    if (data.size() < 3) return;
 
     string diagnostic_display = "";
 
     // Read data from the message array
-    int wireless_quality = static_cast<int>(msg->data[0]); // Wireless quality is an integer value
-    float byte_rate = msg->data[1]; // Bandwidth used by the wireless interface
-    float sim_rate = msg->data[2]; // Simulation update rate
+    int wireless_quality = static_cast<int>(data[0]); // Wireless quality is an integer value
+    float byte_rate = data[1]; // Bandwidth used by the wireless interface
+    float sim_rate = data[2]; // Simulation update rate
 
     // Declare the output colour variables
     int red = 255;
@@ -1182,71 +1256,25 @@ void RoverGUIPlugin::uniqueRoverColorsCheckboxToggledEventHandler(bool checked)
     ui.map_frame->setDisplayUniqueRoverColors(checked);
 }
 
-void RoverGUIPlugin::displayDiagLogMessage(QString msg)
+void RoverGUIPlugin::setupLogView(QListView* view, QLineEdit* filter, LogModel* model, QSortFilterProxyModel*& filter_model)
 {
-    if (msg.isEmpty()) msg = "Message is empty";
-    if (msg == NULL) msg = "Message was a NULL pointer";
-
-
-     // replace new lines with <BR> in the message. Uppercase in order to differentiate from <br> below
-    msg.replace("\n","<BR>");
-
-
-    // Prevent the log from growning too large. Maintain a maximum specified size
-    // by removing characters from the beginning of the log.
-    // Calculate the number of characters in the log. If the log size is larger than the max size specified
-    // then find the position of the first newline that reduces the log size to less than the max size.
-    // Delete all characters up to that position.
-    int overflow = diag_log_messages.size() - max_diag_log_length; 
-    
-    // Get the position of the the first newline after the overflow amount
-    int newline_pos = diag_log_messages.indexOf( "<br>", overflow, Qt::CaseSensitive );
-    
-    // If the max size is exceeded and the number of characters to remove is less than
-    // the size of the log remove those characters.
-    if ( overflow > 0 && newline_pos < diag_log_messages.size() ) {   
-      diag_log_messages.remove(0, newline_pos);
-    }
+    filter_model = new QSortFilterProxyModel(this);
+    filter_model->setSourceModel(model);
+    filter_model->setFilterCaseSensitivity(Qt::CaseInsensitive);
+    view->setModel(filter_model);
 
-    diag_log_messages += "<font color='white'>"+msg+"</font><br>";
-
-    ui.diag_log->setText(diag_log_messages);
+    connect(filter, SIGNAL(textChanged(QString)), filter_model, SLOT(setFilterFixedString(QString)));
+    connect(model, SIGNAL(linesAdded()), view, SLOT(scrollToBottom()));
+}
 
-    QScrollBar *sb = ui.diag_log->verticalScrollBar();
-    sb->setValue(sb->maximum());
+void RoverGUIPlugin::displayDiagLogMessage(QString msg)
+{
+    diag_log_model->append(msg);
 }
 
 void RoverGUIPlugin::displayInfoLogMessage(QString msg)
 {
-    if (msg.isEmpty()) msg = "Message is empty";
-    if (msg == NULL) msg = "Message was a NULL pointer";
-
-    // replace new lines with <BR> in the message. Uppercase in order to differentiate from <br> below
-    msg.replace("\n","<BR>");
-
-    // Prevent the log from growning too large. Maintain a maximum specified size
-    // by removing characters from the beginning of the log.
-    // Calculate the number of characters in the log. If the log size is larger than the max size specified
-    // then find the position of the first newline that reduces the log size to less than the max size.
-    // Delete all characters up to that position.
-    int overflow = info_log_messages.size() - max_info_log_length; 
-    
-    // Get the position of the the first newline after the overflow amount
-    int newline_pos = info_log_messages.indexOf( "<br>", overflow, Qt::CaseSensitive );
-    
-    // If the max size is exceeded and the number of characters to remove is less than
-    // the size of the log remove those characters.
-    if ( overflow > 0 && newline_pos < info_log_messages.size() ) {   
-      info_log_messages.remove(0, newline_pos);
-    }
-    
-    // Use the <br> tag to make log messages atomic for easier deletion later.
-    info_log_messages += "<font color='white'>"+msg+"</font><br>";
-
-    ui.info_log->setText(info_log_messages);
-
-    QScrollBar *sb = ui.info_log->verticalScrollBar();
-    sb->setValue(sb->maximum());
+    info_log_model->append(msg);
 }
 
 // These button handlers allow the user to select whether to manually pan and zoom the map
@@ -1269,12 +1297,20 @@ void RoverGUIPlugin::autonomousRadioButtonEventHandler(bool marked)
 {
     if (!marked) return;
 
-    rover_control_state[selected_rover_name] = 2;
+    RoverSession* session = rovers.find(selected_rover_name);
+    if (!session) return;
+
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        session->control_state = RoverSession::AUTONOMOUS;
+    }
+    clearJoystickState();
 
     std_msgs::UInt8 control_mode_msg;
     control_mode_msg.data = 2; // 2 indicates autonomous control
 
-    control_mode_publishers[selected_rover_name].publish(control_mode_msg);
+    session->control_mode_publisher.publish(control_mode_msg);
+    trial_log.addEvent(selected_rover_name, TRIAL_MODE, ros::Time::now().toSec(), RoverSession::AUTONOMOUS);
     emit sendInfoLogMessage(QString::fromStdString(selected_rover_name)+" changed to autonomous control");
 
     QString return_msg = stopROSJoyNode();
@@ -1295,7 +1331,14 @@ void RoverGUIPlugin::joystickRadioButtonEventHandler(bool marked)
 {
     if (!marked) return;
 
-    rover_control_state[selected_rover_name] = 1;
+    RoverSession* session = rovers.find(selected_rover_name);
+    if (!session) return;
+
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        session->control_state = RoverSession::MANUAL;
+    }
+
     emit sendInfoLogMessage("Setting up joystick publisher " + QString::fromStdString("/"+selected_rover_name+"/joystick"));
 
     // Setup joystick publisher
@@ -1320,7 +1363,8 @@ void RoverGUIPlugin::joystickRadioButtonEventHandler(bool marked)
     std_msgs::UInt8 control_mode_msg;
     control_mode_msg.data = 1; // 1 indicates manual control
 
-    control_mode_publishers[selected_rover_name].publish(control_mode_msg);
+    session->control_mode_publisher.publish(control_mode_msg);
+    trial_log.addEvent(selected_rover_name, TRIAL_MODE, ros::Time::now().toSec(), RoverSession::MANUAL);
     emit sendInfoLogMessage(QString::fromStdString(selected_rover_name)+" changed to joystick control");\
 
     QString return_msg = startROSJoyNode();
@@ -1346,7 +1390,8 @@ void RoverGUIPlugin::allAutonomousButtonEventHandler()
     int selected_index = -1; // zero array indexing, ensure last selected index is in range
 
     // manually trigger the autonomous radio button event for all rovers
-    for (set<string>::iterator it = rover_names.begin(); it != rover_names.end(); it++)
+    vector<string> rover_names = rovers.names();
+    for (vector<string>::iterator it = rover_names.begin(); it != rover_names.end(); it++)
     {
         selected_index++;
         selected_rover_name = *it;
@@ -1525,7 +1570,8 @@ void RoverGUIPlugin::allStopButtonEventHandler()
     int selected_index = -1; // zero array indexing, ensure last selected index is in range
 
     // manually trigger the manual radio button event for all rovers
-    for (set<string>::iterator it = rover_names.begin(); it != rover_names.end(); it++)
+    vector<string> rover_names = rovers.names();
+    for (vector<string>::iterator it = rover_names.begin(); it != rover_names.end(); it++)
     {
         selected_index++;
         selected_rover_name = *it;
@@ -1663,6 +1709,28 @@ void RoverGUIPlugin::mapPopoutButtonEventHandler()
     ui.map_frame->popout();
 }
 
+// Opens a trial log in the playback window
+void RoverGUIPlugin::mapReplayButtonEventHandler()
+{
+    // See customWorldButtonEventHandler for why there is no parent widget
+    QString path = QFileDialog::getOpenFileName(NULL, tr("Open Trial Log"), QDir::homePath(),
+                                                tr("Trial Log (*.trial);;All Files (*)"));
+    if (path.isEmpty()) return;
+
+    if (!trial_player) trial_player = new TrialPlayer(widget);
+
+    QString error;
+    if (!trial_player->open(path, error))
+    {
+        emit sendInfoLogMessage("Could not open the trial log: " + error);
+        return;
+    }
+
+    emit sendInfoLogMessage("Playing back the trial log " + path);
+    trial_player->show();
+    trial_player->raise();
+}
+
 void RoverGUIPlugin::buildSimulationButtonEventHandler()
 {
     emit sendInfoLogMessage("Building simulation...");
@@ -1678,28 +1746,65 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
         return;
     }
 
-    QProcess* sim_server_process = sim_mgr.startGazeboServer();
+    if (ui.final_radio_button->isChecked() && !ui.create_savable_world_checkbox->isChecked())
+    {
+        arena_dim = 23.1;
+    }
+    else if (ui.prelim_radio_button->isChecked() && !ui.create_savable_world_checkbox->isChecked())
+    {
+        arena_dim = 15;
+    }
+    else
+    {
+        arena_dim = ui.unbounded_arena_size_combobox->currentText().toInt();
+    }
+
+    ros::param::get("rover_ready_timeout", rover_ready_timeout);
+
+    // Target placement only depends on the settings and the seed, so a world built once with them
+    // can be loaded straight into the server instead of placing and spawning every model again
+    ros::param::get("world_seed", world_seed);
+    srand(world_seed);
+
+    QString world_cache_path = worldCachePath();
+    bool use_cached_world = world_cache_path != "" && QFile::exists(world_cache_path);
+
+    QProcess* sim_server_process;
+    if (use_cached_world)
+    {
+        emit sendInfoLogMessage("Loading cached world " + world_cache_path + "...");
+        sim_server_process = sim_mgr.startGazeboServer(world_cache_path);
+    }
+    else
+    {
+        sim_server_process = sim_mgr.startGazeboServer();
+    }
     connect(sim_server_process, SIGNAL(finished(int)), this, SLOT(gazeboServerFinishedEventHandler()));
 
-    if (ui.final_radio_button->isChecked() && !ui.create_savable_world_checkbox->isChecked())
+    if (use_cached_world)
+    {
+        emit sendInfoLogMessage(QString("Set arena size to ")+QString::number(arena_dim)+"x"+QString::number(arena_dim));
+    }
+    else if (ui.final_radio_button->isChecked() && !ui.create_savable_world_checkbox->isChecked())
     {
-         arena_dim = 23.1;
          addFinalsWalls();
          emit sendInfoLogMessage(QString("Set arena size to ")+QString::number(arena_dim)+"x"+QString::number(arena_dim));
     }
     else if (ui.prelim_radio_button->isChecked() && !ui.create_savable_world_checkbox->isChecked())
     {
-        arena_dim = 15;
         addPrelimsWalls();
         emit sendInfoLogMessage(QString("Set arena size to ")+QString::number(arena_dim)+"x"+QString::number(arena_dim));
     }
     else
     {
-        arena_dim = ui.unbounded_arena_size_combobox->currentText().toInt();
         emit sendInfoLogMessage(QString("Set arena size to ")+QString::number(arena_dim)+"x"+QString::number(arena_dim)+" with no barriers");
     }
 
-    if(!ui.create_savable_world_checkbox->isChecked())
+    if (use_cached_world)
+    {
+        emit sendInfoLogMessage("Using the ground plane from the cached world...");
+    }
+    else if(!ui.create_savable_world_checkbox->isChecked())
     {
         if (ui.texture_combobox->currentText() == "Gravel")
         {
@@ -1731,9 +1836,16 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
 
     if(!ui.create_savable_world_checkbox->isChecked())
     {
-        emit sendInfoLogMessage("Adding collection disk...");
-        float collection_disk_radius = 0.5; // meters
-        sim_mgr.addModel("collection_disk", "collection_disk", 0, 0, 0, collection_disk_radius);
+        if (use_cached_world)
+        {
+            emit sendInfoLogMessage("Using the collection disk from the cached world...");
+        }
+        else
+        {
+            emit sendInfoLogMessage("Adding collection disk...");
+            float collection_disk_radius = 0.5; // meters
+            sim_mgr.addModel("collection_disk", "collection_disk", 0, 0, 0, collection_disk_radius);
+        }
         score_subscriber = nh.subscribe("/collectionZone/score", 10, &RoverGUIPlugin::scoreEventHandler, this);
         simulation_timer_subscriber = nh.subscribe("/clock", 10, &RoverGUIPlugin::simulationTimerEventHandler, this);
     }
@@ -1744,7 +1856,6 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
 
     if(!ui.create_savable_world_checkbox->isChecked())
     {
-        int n_rovers_created = 0;
         int n_rovers = 3;
         if (ui.final_radio_button->isChecked()) n_rovers = 6;
 
@@ -1846,27 +1957,68 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
            2.356  //  0.75 * PI
         };
 
-        // Add rovers to the simulation and start the associated ROS nodes
+        vector<QString> new_rovers(rovers, rovers + n_rovers);
+
         for (int i = 0; i < n_rovers; i++)
         {
             // add the global offset for sim rovers
             ui.map_frame->setGlobalOffsetForRover(rovers[i].toStdString(), rover_positions[i].x(), rover_positions[i].y());
             ui.map_frame->setUniqueRoverColor(rovers[i].toStdString(), rover_colors[i]);
+        }
 
-            emit sendInfoLogMessage("Adding rover "+rovers[i]+"...");
-            return_msg = sim_mgr.addRover(rovers[i], rover_positions[i].x(), rover_positions[i].y(), 0, 0, 0, rover_yaw[i]);
+        // Add rovers to the simulation. The first rover loads the gazebo plugins and adding the others before
+        // it has finished causes the plugins to fail under Ubuntu 16.04, so wait until its IMU plugin publishes.
+        // The others are then added together.
+        if (n_rovers > 0)
+        {
+            emit sendInfoLogMessage("Adding rover "+rovers[0]+"...");
+            return_msg = sim_mgr.addRover(rovers[0], rover_positions[0].x(), rover_positions[0].y(), 0, 0, 0, rover_yaw[0]);
             emit sendInfoLogMessage(return_msg);
 
+            map<QString, double> loaded = waitForFirstMessages<sensor_msgs::Imu>(vector<QString>(1, rovers[0]), "/imu", rover_ready_timeout);
+            if (loaded.find(rovers[0]) == loaded.end())
+            {
+                emit sendInfoLogMessage("<font color='red'>The plugins of " + rovers[0] + " did not load within " + QString::number(rover_ready_timeout) + " s.</font>");
+            }
+        }
+
+        for (int i = 1; i < n_rovers; i++)
+        {
+            emit sendInfoLogMessage("Adding rover "+rovers[i]+"...");
+            sim_mgr.queueAddRover(rovers[i], rover_positions[i].x(), rover_positions[i].y(), 0, 0, 0, rover_yaw[i]);
+        }
+
+        return_msg = sim_mgr.runQueuedJobs([&](int added, int total) {
+            progress_dialog.setValue(50.0f*(1 + added)/(1 + total));
+            qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        });
+        emit sendInfoLogMessage(return_msg);
+
+        // Start the associated ROS nodes together. startRoverNode does not wait for the launch to finish, so
+        // wait for the first heartbeat of each rover's behaviour node instead.
+        for (int i = 0; i < n_rovers; i++)
+        {
             emit sendInfoLogMessage("Starting rover node for "+rovers[i]+"...");
             return_msg = sim_mgr.startRoverNode(rovers[i]);
             emit sendInfoLogMessage(return_msg);
+        }
 
-            progress_dialog.setValue((++n_rovers_created)*100.0f/n_rovers);
-            qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        map<QString, double> started = waitForFirstMessages<std_msgs::String>(new_rovers, "/behaviour/heartbeat", rover_ready_timeout,
+            [&](int ready, int total) {
+                progress_dialog.setValue(50 + 50.0f*ready/total);
+                qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+            });
 
-            if(i == 0)
+        for (int i = 0; i < n_rovers; i++)
+        {
+            map<QString, double>::iterator found = started.find(rovers[i]);
+            if (found != started.end())
+            {
+                emit sendInfoLogMessage(rovers[i] + " started in " + QString::number(found->second, 'f', 1) + " s");
+            }
+            else
             {
-              sleep(rover_load_delay); // Gives plugins enough time to finish loading
+                emit sendInfoLogMessage("<font color='red'>" + rovers[i] + " did not report a heartbeat within " + QString::number(rover_ready_timeout) + " s.</font>");
             }
         }
     }
@@ -1875,7 +2027,11 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
         emit sendInfoLogMessage("Not creating rovers...");
     }
 
-    if (ui.powerlaw_distribution_radio_button->isChecked())
+    if (use_cached_world)
+    {
+       emit sendInfoLogMessage("Using the targets from the cached world...");
+    }
+    else if (ui.powerlaw_distribution_radio_button->isChecked())
     {
        emit sendInfoLogMessage("Adding powerlaw distribution of targets...");
        return_msg = addPowerLawTargets();
@@ -1894,6 +2050,22 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
        emit sendInfoLogMessage(return_msg);
     }
 
+    if (!use_cached_world && world_cache_path != "")
+    {
+        if (sim_mgr.saveWorldFile(world_cache_path))
+            emit sendInfoLogMessage("Cached the world in " + world_cache_path + " for the next build with these settings.");
+        else
+            emit sendInfoLogMessage("<font color='red'>Unable to cache the world in " + world_cache_path + "</font>");
+    }
+    else if (ui.create_savable_world_checkbox->isChecked())
+    {
+        QString savable_world_path = QString(getenv("SWARMATHON_APP_ROOT")) + "/simulation/worlds/savable_" + QString::number(world_seed) + ".world";
+        if (sim_mgr.saveWorldFile(savable_world_path))
+            emit sendInfoLogMessage("Saved the world in " + savable_world_path + ". Load it with a custom world distribution.");
+        else
+            emit sendInfoLogMessage("<font color='red'>Unable to save the world in " + savable_world_path + "</font>");
+    }
+
     // add walls given nw corner (x,y) and height and width (in meters)
 
     //addWalls(-arena_dim/2, -arena_dim/2, arena_dim, arena_dim);
@@ -1929,6 +2101,73 @@ void RoverGUIPlugin::buildSimulationButtonEventHandler()
     }
 }
 
+// Subscribes to topic under each rover's namespace and waits until every rover published once, or timeout
+// seconds passed. Returns the seconds each rover took, leaving out the rovers that timed out. The subscriptions
+// are served by the ROS spinner threads, so the GUI keeps processing events while waiting.
+template <class Message>
+map<QString, double> RoverGUIPlugin::waitForFirstMessages(const vector<QString>& rovers, string topic, double timeout, std::function<void(int, int)> progress)
+{
+    map<QString, double> ready;
+    std::mutex ready_mutex;
+    ros::WallTime start = ros::WallTime::now();
+
+    vector<ros::Subscriber> subscribers;
+    for (int i = 0; i < rovers.size(); i++)
+    {
+        QString rover = rovers[i];
+        boost::function<void(const typename Message::ConstPtr&)> first_message = [&, rover](const typename Message::ConstPtr&) {
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            if (ready.find(rover) == ready.end()) ready[rover] = (ros::WallTime::now() - start).toSec();
+        };
+        subscribers.push_back(nh.subscribe<Message>("/" + rover.toStdString() + topic, 1, first_message));
+    }
+
+    int n_ready = 0;
+    while (n_ready < rovers.size() && (ros::WallTime::now() - start).toSec() < timeout)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ready_mutex);
+            n_ready = ready.size();
+        }
+
+        if (progress) progress(n_ready, rovers.size());
+        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        usleep(50000);
+    }
+
+    // Shutting down waits for any callback still running, after that ready is no longer shared
+    for (int i = 0; i < subscribers.size(); i++)
+    {
+        subscribers[i].shutdown();
+    }
+
+    return ready;
+}
+
+// Where the world built from the current settings is cached, or an empty string if it should not be.
+// Custom worlds are loaded from their own file already and savable worlds are written out explicitly.
+QString RoverGUIPlugin::worldCachePath()
+{
+    if (ui.create_savable_world_checkbox->isChecked()) return "";
+
+    QString distribution;
+    if (ui.powerlaw_distribution_radio_button->isChecked()) distribution = "powerlaw";
+    else if (ui.uniform_distribution_radio_button->isChecked()) distribution = "uniform";
+    else if (ui.clustered_distribution_radio_button->isChecked()) distribution = "clustered";
+    else return "";
+
+    QString round = "unbounded";
+    if (ui.final_radio_button->isChecked()) round = "final";
+    else if (ui.prelim_radio_button->isChecked()) round = "prelim";
+
+    QString texture = ui.texture_combobox->currentText().toLower().replace(" ", "_");
+
+    QString key = round + "_" + QString::number(arena_dim) + "_" + texture + "_" + distribution
+                  + "_" + ui.number_of_tags_combobox->currentText() + "_" + QString::number(world_seed);
+
+    return QString(getenv("SWARMATHON_APP_ROOT")) + "/simulation/worlds/cache/" + key + ".world";
+}
+
 void RoverGUIPlugin::clearSimulationButtonEventHandler()
 {
     if (!sim_mgr.isGazeboServerRunning())
@@ -1949,99 +2188,41 @@ void RoverGUIPlugin::clearSimulationButtonEventHandler()
     progress_dialog.show();
 
     QString return_msg;
-    float count = 0.0f;
 
-    // Make a copy of the rover names because stopRoverNode will cause the original set to change
-    set<string> rover_names_copy = rover_names;
+    // Make a copy of the rover names because stopping the rover nodes will cause the registry to change
+    vector<string> rover_names_copy = rovers.names();
 
-    for(set<string>::const_iterator i = rover_names_copy.begin(); i != rover_names_copy.end(); ++i)
+    // The rovers are stopped together
+    for(vector<string>::const_iterator i = rover_names_copy.begin(); i != rover_names_copy.end(); ++i)
     {
-        return_msg += sim_mgr.stopRoverNode(QString::fromStdString(*i));
-        return_msg += "<br>";
-        progress_dialog.setValue((++count)*100.0f/rover_names_copy.size());
-        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        sim_mgr.queueStopRoverNode(QString::fromStdString(*i));
     }
 
-    // Unsubscribe from topics
-
-    emit sendInfoLogMessage("Shutting down subscribers...");
-
-    for (map<string,ros::Subscriber>::iterator it=encoder_subscribers.begin(); it!=encoder_subscribers.end(); ++it) 
-      {
-	qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-	it->second.shutdown();
-      }
-
-    encoder_subscribers.clear();
-
-    for (map<string,ros::Subscriber>::iterator it=gps_subscribers.begin(); it!=gps_subscribers.end(); ++it) {
-      qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-      it->second.shutdown();
-    }
+    return_msg += sim_mgr.runQueuedJobs([&](int stopped, int total) {
+        progress_dialog.setValue(stopped*100.0f/total);
+        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+    });
 
-    for (map<string,ros::Subscriber>::iterator it=gps_nav_solution_subscribers.begin(); it!=gps_nav_solution_subscribers.end(); ++it) {
-      qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-      it->second.shutdown();
-    }
+    // Unsubscribe from topics
 
-    gps_subscribers.clear();
-    gps_nav_solution_subscribers.clear();
+    emit sendInfoLogMessage("Shutting down subscribers and publishers...");
 
-    for (map<string,ros::Subscriber>::iterator it=ekf_subscribers.begin(); it!=ekf_subscribers.end(); ++it) {
-      qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-      it->second.shutdown();
+    vector<unique_ptr<RoverSession>> sessions;
+    {
+        std::lock_guard<std::mutex> lock(rover_sessions_mutex);
+        rovers.clear(sessions);
     }
+    disconnectRovers(sessions);
+    qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
-    ekf_subscribers.clear();
     us_center_subscriber.shutdown();
     us_left_subscriber.shutdown();
     us_right_subscriber.shutdown();
     imu_subscriber.shutdown();
-
-    // Possible error - the following seems to shutdown all subscribers not just those from simulation
-
-    for (map<string,ros::Subscriber>::iterator it=status_subscribers.begin(); it!=status_subscribers.end(); ++it) 
-      {
-	qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-	it->second.shutdown();
-      }
-    status_subscribers.clear();
-
-    for (map<string,ros::Subscriber>::iterator it=waypoint_subscribers.begin(); it!=waypoint_subscribers.end(); ++it) 
-      {
-	qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-	it->second.shutdown();
-      }
-    waypoint_subscribers.clear();
-
-    for (map<string,ros::Subscriber>::iterator it=obstacle_subscribers.begin(); it!=obstacle_subscribers.end(); ++it) 
-      {
-	qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-	it->second.shutdown();
-      }
-
-    obstacle_subscribers.clear();
     score_subscriber.shutdown();
     simulation_timer_subscriber.shutdown();
     camera_subscriber.shutdown();
 
-    emit sendInfoLogMessage("Shutting down publishers...");
-
-    for (map<string,ros::Publisher>::iterator it=control_mode_publishers.begin(); it!=control_mode_publishers.end(); ++it)
-      {
-	qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-	it->second.shutdown();
-      }
-    control_mode_publishers.clear();
-
-    for (map<string,ros::Publisher>::iterator it=waypoint_cmd_publishers.begin(); it!=waypoint_cmd_publishers.end(); ++it)
-      {
-	qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-	it->second.shutdown();
-      }
-    waypoint_cmd_publishers.clear();
-    
-    
     return_msg += sim_mgr.stopGazeboClient();
     qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
     return_msg += "<br>";
@@ -2142,6 +2323,7 @@ QString RoverGUIPlugin::stopROSJoyNode()
         joy_process->waitForFinished();
         delete joy_process;
         joy_process = NULL;
+        clearJoystickState();
 
         return "Stopped the running joystick node.";
 
@@ -2156,44 +2338,16 @@ QString RoverGUIPlugin::addUniformTargets()
 {
     QString number_of_tags = ui.number_of_tags_combobox->currentText();
 
-    QProgressDialog progress_dialog;
-    progress_dialog.setWindowTitle("Placing " + number_of_tags + " Targets");
-    progress_dialog.setCancelButton(NULL); // no cancel button
-    progress_dialog.setWindowModality(Qt::ApplicationModal);
-    progress_dialog.resize(500, 50);
-    progress_dialog.setWindowFlags(progress_dialog.windowFlags() | Qt::WindowStaysOnTopHint);
-    progress_dialog.show();
-
-    QString output;
-
-    float proposed_x;
-    float proposed_y;
-
-    // d is the distance from the center of the arena to the boundary minus the barrier clearance, i.e. the region where tags can be placed
-    // is d - U(0,2d) where U(a,b) is a uniform distribition bounded by a and b.
-    // (before checking for collisions including the collection disk at the center)
-    float d = arena_dim/2.0-(barrier_clearance+target_cluster_size_1_clearance);
-
-    progress_dialog.setValue(0.0);
-    qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-
-    for (int i = 0; i < number_of_tags.toInt(); i++)
+    TargetLayout layout = targetLayout();
+    int placed = layout.addSingles(number_of_tags.toInt());
+    if (placed < number_of_tags.toInt())
     {
-        do
-        {
-            emit sendInfoLogMessage("Tried to place target "+QString::number(0)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y) + "...");
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
-        }
-        while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_1_clearance));
-
-        emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
-        output = sim_mgr.addModel(QString("at")+QString::number(0),  QString("at")+QString::number(i), proposed_x, proposed_y, 0, target_cluster_size_1_clearance);
-        progress_dialog.setValue(i*100.0f/number_of_tags.toInt());
-        qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
+        emit sendInfoLogMessage("<font color='red'>Only found room for " + QString::number(placed) + " of " + number_of_tags + " targets.</font>");
     }
 
-    emit sendInfoLogMessage("Placed " + number_of_tags + " single targets");
+    QString output = spawnTargets(layout, "Placing " + number_of_tags + " Targets");
+
+    emit sendInfoLogMessage("Placed " + QString::number(placed) + " single targets");
 
     return output;
 }
@@ -2234,196 +2388,71 @@ QString RoverGUIPlugin::addClusteredTargets()
             cluster_width = 1;
     }
 
-    QProgressDialog progress_dialog;
-    progress_dialog.setWindowTitle("Placing " + number_of_tags + " Targets into four " + QString::number(cluster_length) + " x " + QString::number(cluster_width) + " clusters");
-    progress_dialog.setCancelButton(NULL); // no cancel button
-    progress_dialog.setWindowModality(Qt::ApplicationModal);
-    progress_dialog.setWindowFlags(progress_dialog.windowFlags() | Qt::WindowStaysOnTopHint);
-    progress_dialog.resize(500, 50);
-    progress_dialog.show();
-
-    QString output;
-
-    float proposed_x, proposed_x2;
-    float proposed_y, proposed_y2;
-
     float target_cluster_clearance = target_cluster_size_1_clearance * ((cluster_length > cluster_width) ? (cluster_length) : (cluster_width));
-    float d = arena_dim/2.0-(barrier_clearance+target_cluster_clearance);
-    int cube_index = 0;
-
-    progress_dialog.setValue(0.0);
-    qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
     // Four piles
-    for (int i = 0; i < 4; i++)
+    TargetLayout layout = targetLayout();
+    int placed = layout.addClusters(4, cluster_length, cluster_width, target_cluster_clearance);
+    if (placed < 4)
     {
-        do
-        {
-            emit sendInfoLogMessage("Tried to place cluster "+QString::number(i)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
-        }
-        while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_clearance));
+        emit sendInfoLogMessage("<font color='red'>Only found room for " + QString::number(placed) + " of 4 clusters.</font>");
+    }
 
-        proposed_y2 = proposed_y - (target_cluster_size_1_clearance * cluster_length);
+    QString output = spawnTargets(layout, "Placing " + number_of_tags + " Targets into four " + QString::number(cluster_length) + " x " + QString::number(cluster_width) + " clusters");
 
-        for(int j = 0; j < cluster_length; j++) {
-            proposed_x2 = proposed_x - (target_cluster_size_1_clearance * cluster_width);
+    emit sendInfoLogMessage("Placed " + QString::number(placed) + " " + QString::number(cluster_length) + " x " + QString::number(cluster_width) + " clusters of targets");
 
-            for(int k = 0; k < cluster_width; k++) {
-                output += sim_mgr.addModel(QString("at")+QString::number(0),  QString("at")+QString::number(cube_index), proposed_x2, proposed_y2, 0, target_cluster_size_1_clearance);
-                proposed_x2 += target_cluster_size_1_clearance;
-                cube_index++;
-                progress_dialog.setValue(cube_index*100.0f/256);
-                qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-            }
+    return output;
+}
 
-            proposed_y2 += target_cluster_size_1_clearance;
-        }
+QString RoverGUIPlugin::addPowerLawTargets()
+{
+    TargetLayout layout = targetLayout();
 
-        emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
+    // One pile of 64, four piles of 16, sixteen piles of 4 and sixty-four piles of 1. The targets are numbered in
+    // that order, so the single targets are 192 through 255.
+    int placed = layout.addClusters(1, 8, 8, target_cluster_size_64_clearance);
+    placed += layout.addClusters(4, 4, 4, target_cluster_size_16_clearance);
+    placed += layout.addClusters(16, 2, 2, target_cluster_size_4_clearance);
+    placed += layout.addSingles(64);
+    if (placed < 85)
+    {
+        emit sendInfoLogMessage("<font color='red'>Only found room for " + QString::number(placed) + " of 85 clusters.</font>");
     }
 
-    emit sendInfoLogMessage("Placed four " + QString::number(cluster_length) + " x " + QString::number(cluster_width) + " clusters of targets");
+    return spawnTargets(layout, "Placing 256 Targets into 85 Clusters (Power Law pattern)");
+}
 
-    return output;
+TargetLayout RoverGUIPlugin::targetLayout()
+{
+    return TargetLayout(arena_dim, barrier_clearance, target_cluster_size_1_clearance,
+        [this](float x, float y, float clearance) { return sim_mgr.isLocationOccupied(x, y, clearance); });
 }
 
-QString RoverGUIPlugin::addPowerLawTargets()
+// The layout is computed before this is called, so the progress dialog only waits for gazebo
+QString RoverGUIPlugin::spawnTargets(const TargetLayout& layout, QString title)
 {
     QProgressDialog progress_dialog;
-    progress_dialog.setWindowTitle("Placing 256 Targets into 85 Clusters (Power Law pattern)");
+    progress_dialog.setWindowTitle(title);
     progress_dialog.setCancelButton(NULL); // no cancel button
     progress_dialog.setWindowModality(Qt::ApplicationModal);
     progress_dialog.setWindowFlags(progress_dialog.windowFlags() | Qt::WindowStaysOnTopHint);
     progress_dialog.resize(500, 50);
     progress_dialog.show();
 
-
-    float total_number_of_clusters = 85;
-    float clusters_placed = 0;
-    int cube_index = 0;
-
-    QString output = "";
-
-    float proposed_x, proposed_x2;
-    float proposed_y, proposed_y2;
-
-    float d = arena_dim/2.0-(barrier_clearance+target_cluster_size_64_clearance);
-
     progress_dialog.setValue(0.0);
     qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
 
-    // One pile of 64
-    do
-    {
-        emit sendInfoLogMessage("Tried to place cluster "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-        proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-        proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
-    }
-    while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_64_clearance));
-
-    proposed_y2 = proposed_y - (target_cluster_size_1_clearance * 8);
-
-    for(int j = 0; j < 8; j++) {
-        proposed_x2 = proposed_x - (target_cluster_size_1_clearance * 8);
-
-        for(int k = 0; k < 8; k++) {
-            output += sim_mgr.addModel(QString("at")+QString::number(0),  QString("at")+QString::number(cube_index), proposed_x2, proposed_y2, 0, target_cluster_size_1_clearance);
-            proposed_x2 += target_cluster_size_1_clearance;
-            cube_index++;
-            progress_dialog.setValue(cube_index*100.0f/256);
-            qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-        }
-
-        proposed_y2 += target_cluster_size_1_clearance;
-    }
-
-    emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
-    d = arena_dim/2.0-(barrier_clearance+target_cluster_size_16_clearance);
-
-    // Four piles of 16
-    for (int i = 0; i < 4; i++)
+    const vector<TargetPlacement>& targets = layout.placements();
+    for (size_t i = 0; i < targets.size(); i++)
     {
-        do
-        {
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
-            emit sendInfoLogMessage("Tried to place cluster "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-        }
-        while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_16_clearance));
-
-        proposed_y2 = proposed_y - (target_cluster_size_1_clearance * 4);
-
-        for(int j = 0; j < 4; j++) {
-            proposed_x2 = proposed_x - (target_cluster_size_1_clearance * 4);
-
-            for(int k = 0; k < 4; k++) {
-                output += sim_mgr.addModel(QString("at")+QString::number(0),  QString("at")+QString::number(cube_index), proposed_x2, proposed_y2, 0, target_cluster_size_1_clearance);
-                proposed_x2 += target_cluster_size_1_clearance;
-                cube_index++;
-                progress_dialog.setValue(cube_index*100.0f/256);
-                qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-            }
-
-            proposed_y2 += target_cluster_size_1_clearance;
-        }
-
-        emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
+        sim_mgr.queueModel(QString("at")+QString::number(0), QString("at")+QString::number(i), targets[i].x, targets[i].y, 0, target_cluster_size_1_clearance);
     }
 
-    d = arena_dim/2.0-(barrier_clearance+target_cluster_size_4_clearance);
-
-    // Sixteen piles of 4
-    for (int i = 0; i < 16; i++)
-    {
-        do
-        {
-            emit sendInfoLogMessage("Tried to place cluster "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
-        }
-        while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_4_clearance));
-
-        proposed_y2 = proposed_y - (target_cluster_size_1_clearance * 2);
-
-        for(int j = 0; j < 2; j++) {
-            proposed_x2 = proposed_x - (target_cluster_size_1_clearance * 2);
-
-            for(int k = 0; k < 2; k++) {
-                output += sim_mgr.addModel(QString("at")+QString::number(0),  QString("at")+QString::number(cube_index), proposed_x2, proposed_y2, 0, target_cluster_size_1_clearance);
-                proposed_x2 += target_cluster_size_1_clearance;
-                cube_index++;
-                progress_dialog.setValue(cube_index*100.0f/256);
-                qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-            }
-
-            proposed_y2 += target_cluster_size_1_clearance;
-        }
-
-        emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
-    }
-
-    d = arena_dim/2.0-(barrier_clearance+target_cluster_size_1_clearance);
-
-    // Sixty-four piles of 1 (using tags 192 through 255 to avoid duplication with piles above)
-    for (int i = 192; i < 256; i++)
-    {
-        do
-        {
-            emit sendInfoLogMessage("Tried to place target "+QString::number(clusters_placed)+" at " + QString::number(proposed_x) + " " + QString::number(proposed_y));
-            proposed_x = d - ((float) rand()) / RAND_MAX*2*d;
-            proposed_y = d - ((float) rand()) / RAND_MAX*2*d;
-        }
-        while (sim_mgr.isLocationOccupied(proposed_x, proposed_y, target_cluster_size_1_clearance));
-
-        progress_dialog.setValue(i*100.0f/256);
+    return sim_mgr.spawnQueuedModels([&](int spawned, int total) {
+        progress_dialog.setValue(spawned*100.0f/total);
         qApp->processEvents(QEventLoop::ExcludeUserInputEvents);
-        emit sendInfoLogMessage("<font color=green>Succeeded.</font>");
-        output+= sim_mgr.addModel(QString("at")+QString::number(0), QString("at")+QString::number(i), proposed_x, proposed_y, 0, target_cluster_size_1_clearance);
-    }
-
-    return output;
+    });
 }
 
 // Add a cinder block wall to the simulation
@@ -2764,7 +2793,7 @@ bool RoverGUIPlugin::eventFilter(QObject *target, QEvent *event)
 
             if (direction_key )
             {
-                joystick_publisher.publish(joy_msg);
+                setJoystickState(joy_msg);
                 return true;
             }
         }
@@ -2792,7 +2821,7 @@ bool RoverGUIPlugin::eventFilter(QObject *target, QEvent *event)
                 ui.joy_lcd_drive_left->display(0);
                 ui.joy_lcd_drive_right->display(0);
 
-                joystick_publisher.publish(joy_msg);
+                setJoystickState(joy_msg);
                 return true;
 
             }
@@ -2827,10 +2856,9 @@ void RoverGUIPlugin::infoLogMessageEventHandler(const ros::MessageEvent<std_msgs
 
     string log_msg = msg->data;
 
-    emit sendInfoLogMessage(QString::fromStdString(publisher_name)
-                           + " <font color=Lime size=1>"
-                           + QString::fromStdString(log_msg)
-                           + "</font>");
+    // Straight to the model, which is thread safe, so bursts from the rovers
+    // don't queue an event on the GUI thread per message
+    info_log_model->append(QString::fromStdString(publisher_name) + ": " + QString::fromStdString(log_msg));
 }
 
 void RoverGUIPlugin::diagLogMessageEventHandler(const ros::MessageEvent<std_msgs::String const>& event)
@@ -2843,7 +2871,7 @@ void RoverGUIPlugin::diagLogMessageEventHandler(const ros::MessageEvent<std_msgs
 
     string log_msg = msg->data;
 
-    emit sendDiagLogMessage(QString::fromStdString(log_msg));
+    diag_log_model->append(QString::fromStdString(log_msg));
 }
 
 void RoverGUIPlugin::overrideNumRoversCheckboxToggledEventHandler(bool checked)
@@ -2948,21 +2976,34 @@ void RoverGUIPlugin::refocusKeyboardEventHandler()
 // Publish the waypoint commands recieved from MapFrame to ROS
 void RoverGUIPlugin::receiveWaypointCmd(WaypointCmd cmd, int id, float x, float y)
 {
-    std::set<std::string>::iterator it = rover_names.find(selected_rover_name);
+    RoverSession* session = rovers.find(selected_rover_name);
 
-    if(it == rover_names.end())
+    if(!session)
     {
       emit sendInfoLogMessage("Waypoints Error: a valid rover is not selected!");
       return;
     }
 
-    swarmie_msgs::Waypoint msg;
-    msg.action = cmd;
-    msg.id = id;
-    msg.x = x;
-    msg.y = y;
-    
-    waypoint_cmd_publishers[selected_rover_name].publish(msg);
+    // Queued and sent in one message by sendWaypointCmdsTimerEventHandler
+    swarmie_msgs::WaypointBatch& batch = session->pending_waypoint_cmds;
+    batch.action.push_back(cmd);
+    batch.id.push_back(id);
+    batch.x.push_back(x);
+    batch.y.push_back(y);
+}
+
+// Sends each rover the waypoint commands queued since the last time
+void RoverGUIPlugin::sendWaypointCmdsTimerEventHandler()
+{
+    vector<int> ids = rovers.ids();
+    for (size_t i = 0; i < ids.size(); i++)
+    {
+        RoverSession* session = rovers.find(ids[i]);
+        if (!session || session->pending_waypoint_cmds.id.empty()) continue;
+
+        session->waypoint_cmd_publisher.publish(session->pending_waypoint_cmds);
+        session->pending_waypoint_cmds = swarmie_msgs::WaypointBatch();
+    }
 }
 
 // Clean up memory when this object is deleted
@@ -47,11 +47,17 @@
 #include <QKeyEvent>
 #include <QListWidget> // Provides QListWidgetItem
 #include <QProcess>
+#include <functional>
 #include <map>
 #include <set>
+#include <vector>
 #include <mutex>
 #include <ublox_msgs/NavSOL.h>
 #include "swarmie_msgs/Waypoint.h" // For waypoint commands
+#include "swarmie_msgs/WaypointBatch.h"
+#include "swarmie_msgs/RoverTelemetry.h" // Status and diagnostics from each rover
+#include "swarmie_msgs/PathBatch.h" // Decimated rover paths for the map
+#include "swarmie_msgs/BehaviourState.h" // Behaviour state changes for the trial log
 
 //ROS msg types
 //#include "rover_onboard_target_detection/ATag.h"
@@ -60,26 +66,24 @@
 #include <QWidget>
 #include <QTimer>
 #include <QLabel>
+#include <QSortFilterProxyModel>
 
 #include "GazeboSimManager.h"
 #include "JoystickGripperInterface.h"
+#include "LogModel.h"
+#include "RoverSession.h"
+#include "TargetLayout.h"
+#include "TrialLog.h"
 
 
 // Forward declarations
 class MapData;
 
-using namespace std;
-
+namespace rqt_rover_gui {
+  class TrialPlayer;
+}
 
-// RoverStaus holds status messages from rovers and time
-// time they were received. The time is used to detect
-// disconnected rovers. The status message can be any string
-// in the past it has been used to display the team name
-// in the GUI
-struct RoverStatus {
-    string status_msg;
-    ros::Time timestamp;
-};
+using namespace std;
 
 
 namespace rqt_rover_gui {
@@ -103,18 +107,20 @@ namespace rqt_rover_gui {
     QString startROSJoyNode();
     QString stopROSJoyNode();
 
-    void statusEventHandler(const ros::MessageEvent<std_msgs::String const>& event);
-    void waypointEventHandler(const swarmie_msgs::Waypoint& event);
+    // The per rover handlers get the id of the rover's session
+    void telemetryEventHandler(int rover_id, const swarmie_msgs::RoverTelemetry::ConstPtr& msg);
+    void waypointEventHandler(int rover_id, const swarmie_msgs::WaypointBatch::ConstPtr& msg);
     void joyEventHandler(const sensor_msgs::Joy::ConstPtr& joy_msg);
+    void setJoystickState(const sensor_msgs::Joy& joy_msg);
+    void clearJoystickState();
     void cameraEventHandler(const sensor_msgs::ImageConstPtr& image);
-    void EKFEventHandler(const ros::MessageEvent<const nav_msgs::Odometry> &event);
-    void GPSEventHandler(const ros::MessageEvent<const nav_msgs::Odometry> &event);
-    void GPSNavSolutionEventHandler(const ros::MessageEvent<const ublox_msgs::NavSOL> &event);
-    void encoderEventHandler(const ros::MessageEvent<const nav_msgs::Odometry> &event);
-    void obstacleEventHandler(const ros::MessageEvent<std_msgs::UInt8 const> &event);
+    void pathEventHandler(int rover_id, const swarmie_msgs::PathBatch::ConstPtr& msg);
+    void GPSNavSolutionEventHandler(int rover_id, const ublox_msgs::NavSOL::ConstPtr& msg);
+    void obstacleEventHandler(int rover_id, const std_msgs::UInt8::ConstPtr& msg);
+    void behaviourStateEventHandler(int rover_id, const swarmie_msgs::BehaviourState::ConstPtr& msg);
     void scoreEventHandler(const ros::MessageEvent<std_msgs::String const> &event);
     void simulationTimerEventHandler(const rosgraph_msgs::Clock& msg);
-    void diagnosticEventHandler(const ros::MessageEvent<std_msgs::Float32MultiArray const> &event);
+    void displayDiagnosticData(const string& rover_name, const vector<float>& data);
 
     void centerUSEventHandler(const sensor_msgs::Range::ConstPtr& msg);
     void leftUSEventHandler(const sensor_msgs::Range::ConstPtr& msg);
@@ -128,8 +134,14 @@ namespace rqt_rover_gui {
     QString addPowerLawTargets();
     QString addUniformTargets();
     QString addClusteredTargets();
+    TargetLayout targetLayout();
+    QString spawnTargets(const TargetLayout& layout, QString title);
     QString addFinalsWalls();
     QString addPrelimsWalls();
+    QString worldCachePath();
+
+    template <class Message>
+    map<QString, double> waitForFirstMessages(const vector<QString>& rovers, string topic, double timeout, std::function<void(int, int)> progress = std::function<void(int, int)>());
 
 
    // void targetDetectedEventHandler( rover_onboard_target_detection::ATag tagInfo ); //rover_onboard_target_detection::ATag msg );
@@ -140,6 +152,13 @@ namespace rqt_rover_gui {
     // Detect rovers that are broadcasting information
     set<string> findConnectedRovers();
 
+    // Sets up the publishers and subscribers of a newly connected rover
+    void connectRover(RoverSession& session);
+
+    // Shuts down the sessions of rovers that went away and clears their data
+    // from the interface
+    void disconnectRovers(vector<unique_ptr<RoverSession>>& sessions);
+
   signals:
 
     void sendWaypointReached(int waypoint_id);
@@ -174,6 +193,8 @@ namespace rqt_rover_gui {
     void receiveDiagLogMessage(QString);
     void currentRoverChangedEventHandler(QListWidgetItem *current, QListWidgetItem *previous);
     void pollRoversTimerEventHandler();
+    void joystickCommandTimerEventHandler();
+    void sendWaypointCmdsTimerEventHandler();
     void GPSCheckboxToggledEventHandler(bool checked);
     void EKFCheckboxToggledEventHandler(bool checked);
     void encoderCheckboxToggledEventHandler(bool checked);
@@ -186,6 +207,7 @@ namespace rqt_rover_gui {
     void mapAutoRadioButtonEventHandler(bool marked);
     void mapManualRadioButtonEventHandler(bool marked);
     void mapPopoutButtonEventHandler();
+    void mapReplayButtonEventHandler();
 
     void joystickRadioButtonEventHandler(bool marked);
     void autonomousRadioButtonEventHandler(bool marked);
@@ -214,18 +236,10 @@ namespace rqt_rover_gui {
     void readRoverModelXML(QString path);
 
     // ROS Publishers
-    map<string,ros::Publisher> control_mode_publishers;
-    map<string,ros::Publisher> waypoint_cmd_publishers;
     ros::Publisher joystick_publisher;
 
     // ROS Subscribers
     ros::Subscriber joystick_subscriber;
-    map<string,ros::Subscriber> encoder_subscribers;
-    map<string,ros::Subscriber> gps_subscribers;
-    map<string,ros::Subscriber> gps_nav_solution_subscribers;
-    map<string,ros::Subscriber> ekf_subscribers;
-    map<string,ros::Subscriber> rover_diagnostic_subscribers;
-    map<string,ros::Subscriber> waypoint_subscribers;
     ros::Subscriber us_center_subscriber;
     ros::Subscriber us_left_subscriber;
     ros::Subscriber us_right_subscriber;
@@ -234,29 +248,42 @@ namespace rqt_rover_gui {
     ros::Subscriber diag_log_subscriber;
     ros::Subscriber score_subscriber;
     ros::Subscriber simulation_timer_subscriber;
-
-    map<string,ros::Subscriber> status_subscribers;
-    map<string,ros::Subscriber> obstacle_subscribers;
     image_transport::Subscriber camera_subscriber;
 
     string selected_rover_name;
-    set<string> rover_names;
+
+    // The publishers, subscribers and state of each connected rover.
+    // Sessions are added and removed by the GUI thread under
+    // rover_sessions_mutex, and the ROS callbacks look their session up
+    // under it. Fields the callbacks use (status, num_satellites and
+    // control_state) are only touched with the mutex held.
+    RoverRegistry rovers;
+    std::mutex rover_sessions_mutex;
     ros::NodeHandle nh;
     QWidget* widget;
     Ui::RoverGUI ui;
 
     QProcess* joy_process;
     QTimer* rover_poll_timer; // for rover polling
-
-    QString info_log_messages;
-    QString diag_log_messages;
+    QTimer* display_refresh_timer; // repaints the sensor and map frames with the latest data
+    QTimer* joystick_command_timer; // sends the latest joystick state and the queued waypoint commands to the rovers
+
+    // The latest stick state from the joystick driver or the keyboard,
+    // written on either thread and sent by joystick_command_timer
+    std::mutex joystick_state_mutex;
+    sensor_msgs::Joy joystick_state;
+    bool joystick_state_changed = false;
+    bool have_joystick_state = false;
+
+    // The log panes. The models are appended to from any thread and
+    // flushed by display_refresh_timer.
+    LogModel* info_log_model;
+    LogModel* diag_log_model;
+    QSortFilterProxyModel* info_log_filter_model;
+    QSortFilterProxyModel* diag_log_filter_model;
 
     GazeboSimManager sim_mgr;
 
-    map<string,int> rover_control_state;
-    map<string,int> rover_numSV_state;
-    map<string, RoverStatus> rover_statuses;
-
     float arena_dim; // in meters
 
     // simulation timer variables
@@ -293,14 +320,24 @@ namespace rqt_rover_gui {
 
     MapData* map_data;
 
-    // Limit the length of log messages in characters to prevent slowdowns when lots of data is added
-    size_t max_info_log_length;
-    size_t max_diag_log_length;
+    // Records the trial for TrialPlayer when the trial_log_file parameter
+    // is set. Flushed by rover_poll_timer.
+    TrialLogWriter trial_log;
+    TrialPlayer* trial_player = NULL;
+
+    // Limit the number of log lines to prevent slowdowns when lots of data is added
+    int max_log_lines;
+    void setupLogView(QListView* view, QLineEdit* filter, LogModel* model, QSortFilterProxyModel*& filter_model);
 
     std::mutex diag_update_mutex;
 
-    // Delay the between creating rovers. No delay causes Gazebo plugins to fail under Ubuntu 16.04
-    unsigned int rover_load_delay = 5;
+    // How long to wait for a new rover's gazebo plugins to load and for its nodes to start, in seconds.
+    // Override with the rover_ready_timeout parameter.
+    double rover_ready_timeout = 60;
+
+    // Seeds the target placement so that the same settings always build the same world, which
+    // is what lets a rebuild reuse the cached world file. Override with the world_seed parameter.
+    int world_seed = 1;
   };
 } // end namespace
 
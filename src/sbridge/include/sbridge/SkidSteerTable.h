@@ -0,0 +1,172 @@
+#ifndef SKIDSTEERTABLE_H
+#define SKIDSTEERTABLE_H
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include <ros/ros.h>
+
+/**
+ * Maps the per wheel motor commands DriveController emits (PWM style, the
+ * numbers abridge sends the arduino as "v,left,right") to wheel speeds and
+ * the twist they drive the rover at. sbridge drives the Gazebo rover with
+ * it and abridge caps the hardware motor commands with it, so both respond
+ * to a command the same way.
+ *
+ * The wheel speed of every whole command from -maxCommand to maxCommand is
+ * worked out once, by linear interpolation between calibration points
+ * measured on a real rover. A lookup is then a clamp and one interpolation
+ * between neighbouring entries without any branching. Without calibration
+ * the wheel speed is command / 390 m/s on a 0.282 m track, the constants
+ * sbridge used to divide by.
+ *
+ * The calibration is read from "<rover>/skid_steer/" parameters, see
+ * LoadSkidSteerTable().
+ */
+class SkidSteerTable {
+
+	public:
+
+		SkidSteerTable(int maxCommand = 120, double trackWidth = 2 * 55.0 / 390, double speedPerCommand = 1 / 390.0) {
+			this->trackWidth = trackWidth;
+			Linear(maxCommand, speedPerCommand);
+		}
+
+		// A straight line through zero, speedPerCommand m/s per command
+		void Linear(int maxCommand, double speedPerCommand) {
+			std::vector<double> commands(1, maxCommand);
+			std::vector<double> speeds(1, maxCommand * speedPerCommand);
+			Calibrate(maxCommand, commands, speeds);
+		}
+
+		// Wheel speeds in m/s measured at the given commands, in increasing
+		// order of command. Points for negative commands are optional, without
+		// them reversing is the mirror image of going forward. Returns false
+		// and keeps the table as it was if the points are not usable.
+		bool Calibrate(int maxCommand, const std::vector<double>& commands, const std::vector<double>& speeds) {
+			if (maxCommand <= 0 || commands.empty() || commands.size() != speeds.size()) return false;
+			for (size_t i = 1; i < commands.size(); i++) {
+				if (commands[i] <= commands[i - 1]) return false;
+			}
+
+			// Zero command is standing still unless measured otherwise, and the
+			// reverse half mirrors the forward half unless it was measured. A
+			// measured zero is shared by both halves rather than mirrored.
+			std::vector<double> x, y;
+			if (commands.front() >= 0) {
+				for (size_t i = commands.size(); i-- > 0 && commands[i] > 0;) {
+					x.push_back(-commands[i]);
+					y.push_back(-speeds[i]);
+				}
+				if (commands.front() > 0) {
+					x.push_back(0);
+					y.push_back(0);
+				}
+			}
+			x.insert(x.end(), commands.begin(), commands.end());
+			y.insert(y.end(), speeds.begin(), speeds.end());
+
+			this->maxCommand = maxCommand;
+			table.resize(2 * maxCommand + 2);
+			size_t segment = 0;
+			for (int command = -maxCommand; command <= maxCommand; command++) {
+				while (segment + 2 < x.size() && command > x[segment + 1]) segment++;
+
+				// Past the outer points the end segments are extended
+				double speed = y[segment];
+				if (x.size() > 1) {
+					speed += (command - x[segment]) * (y[segment + 1] - y[segment]) / (x[segment + 1] - x[segment]);
+				}
+				table[command + maxCommand] = speed;
+			}
+
+			// One past the end so the interpolation at maxCommand stays in range
+			table.back() = table[2 * maxCommand];
+			return true;
+		}
+
+		void SetTrackWidth(double trackWidth) { this->trackWidth = trackWidth; }
+		void SetLimits(double maxLinear, double maxAngular) {
+			this->maxLinear = maxLinear;
+			this->maxAngular = maxAngular;
+		}
+
+		int MaxCommand() const { return maxCommand; }
+		double TrackWidth() const { return trackWidth; }
+
+		double ClampCommand(double command) const {
+			return std::min<double>(maxCommand, std::max<double>(-maxCommand, command));
+		}
+
+		// m/s for a motor command, clamped to +-maxCommand
+		double WheelSpeed(double command) const {
+			double position = ClampCommand(command) + maxCommand;
+			int index = (int)position;
+			double fraction = position - index;
+			return table[index] + fraction * (table[index + 1] - table[index]);
+		}
+
+		// Forward speed in m/s and turn rate in rad/s for left and right motor
+		// commands, each clamped to the rover's limits
+		void Twist(double left, double right, double& linear, double& angular) const {
+			double leftSpeed = WheelSpeed(left);
+			double rightSpeed = WheelSpeed(right);
+			linear = std::min(maxLinear, std::max(-maxLinear, (leftSpeed + rightSpeed) / 2));
+			angular = std::min(maxAngular, std::max(-maxAngular, (rightSpeed - leftSpeed) / trackWidth));
+		}
+
+	private:
+
+		int maxCommand;
+		double trackWidth;
+		double maxLinear = 0.65; // m/s
+		double maxAngular = 4.5; // rad/s
+
+		// Speed of each command from -maxCommand, with the last entry repeated
+		std::vector<double> table;
+};
+
+/**
+ * Reads the calibration of a rover's drive from its "<rover>/skid_steer/"
+ * parameters, keeping the defaults of whatever is not set:
+ *
+ *   max_motor_command  commands are clamped to +- this, 120 by default.
+ *                      Higher values (180 and 255 were tried) can make the
+ *                      hardware fail when the rover moves too violently.
+ *   commands, speeds   calibration points, motor commands and the wheel
+ *                      speeds in m/s recorded for them on a real rover
+ *   track_width        m between the wheel centerlines
+ *   max_linear_velocity, max_turn_rate
+ *                      limits of the twist sent to Gazebo
+ */
+inline void LoadSkidSteerTable(const std::string& publishedName, SkidSteerTable& table) {
+	ros::NodeHandle nh(publishedName + "/skid_steer");
+
+	int maxCommand = table.MaxCommand();
+	nh.param("max_motor_command", maxCommand, maxCommand);
+
+	std::vector<double> commands, speeds;
+	nh.getParam("commands", commands);
+	nh.getParam("speeds", speeds);
+	if (commands.empty()) {
+		table.Linear(maxCommand, 1 / 390.0);
+	}
+	else if (!table.Calibrate(maxCommand, commands, speeds)) {
+		ROS_WARN("Ignoring the skid steer calibration of %s, it needs as many speeds as commands and increasing commands", publishedName.c_str());
+		table.Linear(maxCommand, 1 / 390.0);
+	}
+
+	double trackWidth = table.TrackWidth();
+	nh.param("track_width", trackWidth, trackWidth);
+	table.SetTrackWidth(trackWidth);
+
+	double maxLinear = 0.65;
+	double maxAngular = 4.5;
+	nh.param("max_linear_velocity", maxLinear, maxLinear);
+	nh.param("max_turn_rate", maxAngular, maxAngular);
+	table.SetLimits(maxLinear, maxAngular);
+}
+
+#endif /* SKIDSTEERTABLE_H */
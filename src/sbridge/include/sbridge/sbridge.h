@@ -9,12 +9,16 @@
 #include <geometry_msgs/QuaternionStamped.h>
 #include <geometry_msgs/Twist.h>
 #include <std_msgs/UInt8.h>
+#include <sbridge/SkidSteerTable.h>
 
 using namespace std;
 
 /**
  * This class translates drive controls into Gazebo
- * friendly velocities.
+ * friendly velocities. It runs as the sbridge node or
+ * inside the behaviours process, where drive commands
+ * reach cmdHandler as shared pointers without being
+ * serialized.
  */
 class sbridge {
 
@@ -41,6 +45,9 @@ class sbridge {
         ros::Timer publish_heartbeat_timer;
 
 		geometry_msgs::Twist velocity;
+
+		// The same mapping from motor commands to speeds abridge uses
+		SkidSteerTable skidSteer;
 };
 
 #endif /* SBRIDGE */
@@ -1,5 +1,5 @@
 #include <signal.h>
-#include "sbridge.h"
+#include <sbridge/sbridge.h>
 
 using namespace std;
 
@@ -1,9 +1,10 @@
-#include "sbridge.h"
+#include <sbridge/sbridge.h>
 
 sbridge::sbridge(std::string publishedName) {
 
     ros::NodeHandle sNH;
 
+    LoadSkidSteerTable(publishedName, skidSteer);
 
     driveControlSubscriber = sNH.subscribe((publishedName + "/driveControl"), 10, &sbridge::cmdHandler, this);
 
@@ -14,46 +15,16 @@ sbridge::sbridge(std::string publishedName) {
     float heartbeat_publish_interval = 2;
     publish_heartbeat_timer = sNH.createTimer(ros::Duration(heartbeat_publish_interval), &sbridge::publishHeartBeatTimerEventHandler, this);
 
-
-     ROS_INFO("constructor");
-
+    ROS_DEBUG("constructor");
 }
 
 void sbridge::cmdHandler(const geometry_msgs::Twist::ConstPtr& message) {
     double left = (message->linear.x);
     double right = (message->angular.z);
-    
-    float max_turn_rate = 4.5; //radians per second
-    float max_linear_velocity = 0.65; // meters per second
-
-    float turn = 0;
-    float forward = 0;
-
-    float linearVel = (left + right)/2;
-    float angularVel = (right-left)/2;
-
-    turn = angularVel/55;
-    forward = linearVel/390;
-    if (forward >= 150){
-      forward -= (abs(turn)/5);
-    }
-
-    if (linearVel >= 0 && forward <= 0)
-    {
-      forward = 0;
-    }
-    if (linearVel <= 0 && forward >= 0)
-    {
-      forward = 0;
-    }
-
-    if (fabs(forward) >= max_linear_velocity) {
-        forward = forward/fabs(forward) * max_linear_velocity;
-    }
 
-    if (fabs(turn) >= max_turn_rate) { //max value needs tuning
-        turn = turn/fabs(turn) * max_turn_rate;
-    }
+    double forward = 0;
+    double turn = 0;
+    skidSteer.Twist(left, right, forward, turn);
 
     velocity.linear.x = forward,
             velocity.angular.z = turn;
@@ -65,7 +36,7 @@ void sbridge::publishHeartBeatTimerEventHandler(const ros::TimerEvent& event) {
     msg.data = "";
     heartbeatPublisher.publish(msg);
 
-    ROS_INFO("%ds, %dnsec", event.last_real.sec, event.last_real.nsec);
+    ROS_DEBUG("%ds, %dnsec", event.last_real.sec, event.last_real.nsec);
 }
 
 sbridge::~sbridge() {
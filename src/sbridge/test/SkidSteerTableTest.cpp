@@ -0,0 +1,37 @@
+#include "sbridge/SkidSteerTable.h"
+
+#include <gtest/gtest.h>
+
+// Without reverse points reversing mirrors going forward
+TEST(SkidSteerTable, MirrorsForwardPoints) {
+	SkidSteerTable table;
+	ASSERT_TRUE(table.Calibrate(120, {30, 60, 120}, {0.15, 0.2, 0.3}));
+
+	EXPECT_DOUBLE_EQ(0, table.WheelSpeed(0));
+	EXPECT_DOUBLE_EQ(-0.15, table.WheelSpeed(-30));
+	EXPECT_DOUBLE_EQ(-0.2, table.WheelSpeed(-60));
+	EXPECT_DOUBLE_EQ(-0.3, table.WheelSpeed(-120));
+}
+
+// A measured zero is still mirrored around, not extended into reverse
+TEST(SkidSteerTable, MirrorsAroundMeasuredZero) {
+	SkidSteerTable table;
+	ASSERT_TRUE(table.Calibrate(120, {0, 30, 60, 120}, {0, 0.15, 0.2, 0.3}));
+
+	EXPECT_DOUBLE_EQ(0, table.WheelSpeed(0));
+	EXPECT_DOUBLE_EQ(0.075, table.WheelSpeed(15));
+	EXPECT_DOUBLE_EQ(-0.075, table.WheelSpeed(-15));
+	EXPECT_DOUBLE_EQ(-0.15, table.WheelSpeed(-30));
+	EXPECT_DOUBLE_EQ(-0.2, table.WheelSpeed(-60));
+	EXPECT_DOUBLE_EQ(-0.3, table.WheelSpeed(-120));
+}
+
+// Measured reverse points are used as they are
+TEST(SkidSteerTable, KeepsMeasuredReverse) {
+	SkidSteerTable table;
+	ASSERT_TRUE(table.Calibrate(120, {-120, 0, 120}, {-0.2, 0, 0.3}));
+
+	EXPECT_DOUBLE_EQ(-0.2, table.WheelSpeed(-120));
+	EXPECT_DOUBLE_EQ(-0.1, table.WheelSpeed(-60));
+	EXPECT_DOUBLE_EQ(0.15, table.WheelSpeed(60));
+}
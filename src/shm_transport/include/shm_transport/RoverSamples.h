@@ -0,0 +1,39 @@
+#ifndef ROVER_SAMPLES_H
+#define ROVER_SAMPLES_H
+
+#include <string>
+
+// The samples abridge and behaviours exchange through SharedRing.h when
+// their shared_memory_transport parameter is set. The ROS topics of the
+// same name stay the reference for everything else.
+namespace shm_transport {
+
+// The three sonar ranges as published on sonarLeft, sonarCenter and
+// sonarRight
+struct SonarSample
+{
+  double stamp; // ROS time in seconds of the newest range
+  float left, center, right; // meters
+};
+
+// A driveControl command, linear.x and angular.z of the Twist, and the
+// driveControl/trace times of the same command in ROS seconds, all zero for
+// an untraced command (see the ControlTrace message of swarmie_msgs)
+struct DriveSample
+{
+  double left, right;
+  double sonarStamp, sonarReceived, workStart, commandSent;
+};
+
+const unsigned int sonarRingCapacity = 16;
+const unsigned int driveRingCapacity = 16;
+
+// Segment names are per rover, e.g. "/achilles_sonar"
+inline std::string SegmentName(const std::string& rover, const std::string& topic)
+{
+  return "/" + rover + "_" + topic;
+}
+
+} // namespace shm_transport
+
+#endif // ROVER_SAMPLES_H
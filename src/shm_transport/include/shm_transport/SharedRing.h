@@ -0,0 +1,269 @@
+#ifndef SHARED_RING_H
+#define SHARED_RING_H
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Shared memory transport for fixed size samples between two processes on
+// the same host, used next to the ROS topics for the samples on the control
+// path so they skip the loopback TCPROS connection and its serialization.
+//
+// One writer process owns a ring of the latest capacity samples in a POSIX
+// shared memory segment. Readers map it read only and copy samples out
+// under a per slot sequence lock, so the writer never waits for them and a
+// reader that falls more than capacity samples behind skips to the oldest
+// one still in the ring. Readers sleep on a futex on the write count until
+// the next sample is written.
+//
+// T must be trivially copyable. Linux only.
+namespace shm_transport {
+
+struct RingHeader
+{
+  uint32_t magic;
+  uint32_t sampleSize;
+  uint32_t capacity;
+  std::atomic<uint32_t> written; // samples written, the futex readers wait on
+};
+
+template <typename T>
+struct RingSlot
+{
+  std::atomic<uint32_t> sequence; // 2n + 1 while sample n is written, 2n + 2 once it is complete
+  T sample;
+};
+
+static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "the ring counters must be plain words shared between processes");
+
+const uint32_t ringMagic = 0x53524e47; // "SRNG"
+
+inline size_t RingSize(uint32_t capacity, size_t slotSize)
+{
+  return sizeof(RingHeader) + capacity * slotSize;
+}
+
+template <typename T>
+class SharedRingWriter
+{
+public:
+  SharedRingWriter() : header(NULL), slots(NULL), length(0) {}
+  ~SharedRingWriter() { Close(); }
+
+  // Creates the segment, or takes over the one of an earlier writer with
+  // the same layout so its readers carry on where they were
+  bool Open(const std::string& name, uint32_t capacity)
+  {
+    Close();
+
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) return false;
+
+    length = RingSize(capacity, sizeof(RingSlot<T>));
+    struct stat info;
+    bool reuse = fstat(fd, &info) == 0 && (size_t)info.st_size == length;
+    if (!reuse && ftruncate(fd, length) != 0)
+    {
+      close(fd);
+      return false;
+    }
+
+    void* memory = mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return false;
+
+    header = static_cast<RingHeader*>(memory);
+    slots = reinterpret_cast<RingSlot<T>*>(static_cast<char*>(memory) + sizeof(RingHeader));
+
+    if (!reuse || header->magic != ringMagic || header->sampleSize != sizeof(T) || header->capacity != capacity)
+    {
+      header->magic = 0;
+      header->sampleSize = sizeof(T);
+      header->capacity = capacity;
+      header->written.store(0, std::memory_order_relaxed);
+      for (uint32_t i = 0; i < capacity; i++) slots[i].sequence.store(0, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      header->magic = ringMagic;
+    }
+
+    return true;
+  }
+
+  void Close()
+  {
+    if (header != NULL) munmap(header, length);
+    header = NULL;
+    slots = NULL;
+  }
+
+  bool IsOpen() const { return header != NULL; }
+
+  void Write(const T& sample)
+  {
+    if (header == NULL) return;
+
+    uint32_t n = header->written.load(std::memory_order_relaxed);
+    RingSlot<T>& slot = slots[n % header->capacity];
+
+    slot.sequence.store(2 * n + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.sample = sample;
+    slot.sequence.store(2 * n + 2, std::memory_order_release);
+
+    header->written.store(n + 1, std::memory_order_release);
+    syscall(SYS_futex, &header->written, FUTEX_WAKE, INT32_MAX, NULL, NULL, 0);
+  }
+
+private:
+  static_assert(std::is_trivially_copyable<T>::value, "SharedRingWriter requires a trivially copyable type");
+
+  RingHeader* header;
+  RingSlot<T>* slots;
+  size_t length;
+};
+
+template <typename T>
+class SharedRingReader
+{
+public:
+  SharedRingReader() : header(NULL), slots(NULL), length(0), next(0), skipped(0) {}
+  ~SharedRingReader() { Close(); }
+
+  // Maps the segment read only. Fails until the writer has created it, so it
+  // may be called again until it succeeds. Reading starts with the next
+  // sample written.
+  bool Open(const std::string& name)
+  {
+    Close();
+
+    int fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) return false;
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(RingHeader))
+    {
+      close(fd);
+      return false;
+    }
+
+    length = info.st_size;
+    void* memory = mmap(NULL, length, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (memory == MAP_FAILED) return false;
+
+    header = static_cast<const RingHeader*>(memory);
+    if (header->magic != ringMagic || header->sampleSize != sizeof(T)
+        || RingSize(header->capacity, sizeof(RingSlot<T>)) != length)
+    {
+      Close();
+      return false;
+    }
+
+    slots = reinterpret_cast<const RingSlot<T>*>(static_cast<const char*>(memory) + sizeof(RingHeader));
+    next = header->written.load(std::memory_order_acquire);
+    return true;
+  }
+
+  void Close()
+  {
+    if (header != NULL) munmap(const_cast<RingHeader*>(header), length);
+    header = NULL;
+    slots = NULL;
+  }
+
+  bool IsOpen() const { return header != NULL; }
+
+  // Copies the next sample, waiting up to timeoutMs for it to be written.
+  // Returns false on timeout.
+  bool Next(T& sample, int timeoutMs)
+  {
+    if (header == NULL) return false;
+
+    for (int attempt = 0; attempt < 2; attempt++)
+    {
+      uint32_t written = header->written.load(std::memory_order_acquire);
+
+      // A new writer started counting again
+      if (written < next) next = written;
+
+      if (written == next)
+      {
+        if (attempt > 0) return false;
+        Wait(written, timeoutMs);
+        continue;
+      }
+
+      if (written - next > header->capacity)
+      {
+        skipped += written - header->capacity - next;
+        next = written - header->capacity;
+      }
+
+      while (next != header->written.load(std::memory_order_acquire))
+      {
+        const RingSlot<T>& slot = slots[next % header->capacity];
+        uint32_t expected = 2 * next + 2;
+
+        uint32_t before = slot.sequence.load(std::memory_order_acquire);
+        T copy;
+        std::memcpy(&copy, &slot.sample, sizeof(T));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        uint32_t after = slot.sequence.load(std::memory_order_relaxed);
+
+        if (before == expected && after == expected)
+        {
+          sample = copy;
+          next++;
+          return true;
+        }
+
+        // Overwritten while being copied, the reader fell a whole ring behind
+        skipped++;
+        next++;
+      }
+    }
+
+    return false;
+  }
+
+  // Samples overwritten before they could be read
+  unsigned long Skipped() const { return skipped; }
+
+private:
+  static_assert(std::is_trivially_copyable<T>::value, "SharedRingReader requires a trivially copyable type");
+
+  void Wait(uint32_t written, int timeoutMs)
+  {
+    struct timespec timeout;
+    timeout.tv_sec = timeoutMs / 1000;
+    timeout.tv_nsec = (timeoutMs % 1000) * 1000000L;
+
+    // Kernels without futexes on read only mappings refuse with EFAULT,
+    // then poll instead
+    if (syscall(SYS_futex, &header->written, FUTEX_WAIT, written, &timeout, NULL, 0) != 0 && errno == EFAULT)
+    {
+      usleep(1000);
+    }
+  }
+
+  const RingHeader* header;
+  const RingSlot<T>* slots;
+  size_t length;
+  uint32_t next;
+  unsigned long skipped;
+};
+
+} // namespace shm_transport
+
+#endif // SHARED_RING_H